@@ -0,0 +1,228 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "AbrController.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#include <new>
+
+#define _FastHalfLifeSeconds_ 2.0
+#define _SlowHalfLifeSeconds_ 5.0
+#define _MinSampleBytes_ 16000				// smaller downloads mostly measure the round trip
+#define _MinEstimateBytes_ 128000			// sampled before the estimate is trusted
+#define _ThroughputSafetyFactor_ 0.9
+
+
+CThroughputEstimator::CThroughputEstimator()
+{
+	Reset();
+}
+
+_Use_decl_annotations_
+void CThroughputEstimator::AddSample(UINT64 bytes, INT64 downloadTime)
+{
+	if (bytes < _MinSampleBytes_ || downloadTime <= 0)
+		return;
+
+	double seconds = downloadTime / 10000000.0;
+	double bitsPerSecond = bytes * 8 / seconds;
+
+	AddToAverage(&m_fast, seconds, bitsPerSecond);
+	AddToAverage(&m_slow, seconds, bitsPerSecond);
+
+	m_bytesSampled += bytes;
+}
+
+UINT32 CThroughputEstimator::GetEstimate() const
+{
+	if (m_bytesSampled < _MinEstimateBytes_)
+		return 0;
+
+	double estimate = fmin(GetAverage(m_fast), GetAverage(m_slow));
+
+	return (estimate >= UINT32_MAX) ? UINT32_MAX : (UINT32)estimate;
+}
+
+void CThroughputEstimator::Reset()
+{
+	m_fast.alpha = exp(log(0.5) / _FastHalfLifeSeconds_);
+	m_fast.estimate = 0;
+	m_fast.totalWeight = 0;
+
+	m_slow.alpha = exp(log(0.5) / _SlowHalfLifeSeconds_);
+	m_slow.estimate = 0;
+	m_slow.totalWeight = 0;
+
+	m_bytesSampled = 0;
+}
+
+_Use_decl_annotations_
+void CThroughputEstimator::AddToAverage(EWMA* pAverage, double weight, double value)
+{
+	double adjustedAlpha = pow(pAverage->alpha, weight);
+
+	pAverage->estimate = value * (1 - adjustedAlpha) + adjustedAlpha * pAverage->estimate;
+	pAverage->totalWeight += weight;
+}
+
+_Use_decl_annotations_
+double CThroughputEstimator::GetAverage(const EWMA& average)
+{
+	// the average starts at 0, undo that bias while there are few samples
+	double zeroFactor = 1 - pow(average.alpha, average.totalWeight);
+
+	return (zeroFactor > 0) ? average.estimate / zeroFactor : 0;
+}
+
+
+CThroughputAbrController::CThroughputAbrController()
+{
+}
+
+_Use_decl_annotations_
+void CThroughputAbrController::OnSegmentDownloaded(UINT64 bytes, INT64 downloadTime)
+{
+	m_estimator.AddSample(bytes, downloadTime);
+}
+
+_Use_decl_annotations_
+UINT32 CThroughputAbrController::SelectBitrate(const std::vector<UINT32>& bitrates, INT64)
+{
+	UINT32 estimate = m_estimator.GetEstimate();
+	if (bitrates.empty() || estimate == 0)
+		return 0;
+
+	double affordable = estimate * _ThroughputSafetyFactor_;
+
+	UINT32 selected = bitrates[0];
+	for (UINT32 bitrate : bitrates)
+	{
+		if (bitrate <= affordable)
+			selected = bitrate;
+	}
+
+	return selected;
+}
+
+
+_Use_decl_annotations_
+void CBolaAbrController::OnSegmentDownloaded(UINT64, INT64)
+{
+}
+
+_Use_decl_annotations_
+UINT32 CBolaAbrController::SelectBitrate(const std::vector<UINT32>& bitrates, INT64 bufferLevel)
+{
+	if (bitrates.empty() || bitrates[0] == 0)
+		return 0;
+
+	// utilities ln(bitrate / lowest bitrate) + 1, so the lowest bitrate has utility 1
+	double lowest = log((double)bitrates[0]);
+	double highestUtility = log((double)bitrates.back()) - lowest + 1;
+
+	if (bitrates.size() == 1 || highestUtility <= 1)
+		return bitrates[0];
+
+	double bufferTarget = fmax(_AbrHybridBufferOnSeconds_, _AbrMinBufferSeconds_ + _AbrBufferPerLevelSeconds_ * bitrates.size());
+
+	// gp and V place the lowest bitrate at an empty buffer and the highest one at the buffer target
+	double gp = (highestUtility - 1) / (bufferTarget / _AbrMinBufferSeconds_ - 1);
+	double v = _AbrMinBufferSeconds_ / gp;
+
+	double buffer = (bufferLevel > 0) ? bufferLevel / 10000000.0 : 0;
+
+	UINT32 selected = bitrates[0];
+	double bestScore = -HUGE_VAL;
+	for (UINT32 bitrate : bitrates)
+	{
+		double utility = log((double)bitrate) - lowest + 1;
+		double score = (v * (utility + gp) - buffer) / bitrate;
+
+		if (score >= bestScore)
+		{
+			bestScore = score;
+			selected = bitrate;
+		}
+	}
+
+	return selected;
+}
+
+
+CHybridAbrController::CHybridAbrController()
+	: m_useBola(false)
+{
+}
+
+_Use_decl_annotations_
+void CHybridAbrController::OnSegmentDownloaded(UINT64 bytes, INT64 downloadTime)
+{
+	m_throughput.OnSegmentDownloaded(bytes, downloadTime);
+	m_bola.OnSegmentDownloaded(bytes, downloadTime);
+}
+
+_Use_decl_annotations_
+UINT32 CHybridAbrController::SelectBitrate(const std::vector<UINT32>& bitrates, INT64 bufferLevel)
+{
+	double buffer = bufferLevel / 10000000.0;
+
+	if (m_useBola && buffer < _AbrMinBufferSeconds_)
+		m_useBola = false;
+	else if (!m_useBola && buffer >= _AbrHybridBufferOnSeconds_)
+		m_useBola = true;
+
+	if (m_useBola)
+		return m_bola.SelectBitrate(bitrates, bufferLevel);
+
+	return m_throughput.SelectBitrate(bitrates, bufferLevel);
+}
+
+
+_Use_decl_annotations_
+HRESULT CreateAbrController(AbrPolicy policy, std::unique_ptr<IAbrController>* pController)
+{
+	NULL_CHK(pController);
+
+	pController->reset();
+
+	switch (policy)
+	{
+	case AbrPolicy::AbrPolicy_System:
+		return S_FALSE;
+	case AbrPolicy::AbrPolicy_Throughput:
+		pController->reset(new (std::nothrow) CThroughputAbrController());
+		break;
+	case AbrPolicy::AbrPolicy_Buffer:
+		pController->reset(new (std::nothrow) CBolaAbrController());
+		break;
+	case AbrPolicy::AbrPolicy_Hybrid:
+		pController->reset(new (std::nothrow) CHybridAbrController());
+		break;
+	default:
+		return E_INVALIDARG;
+	}
+
+	return *pController ? S_OK : E_OUTOFMEMORY;
+}
+
+_Use_decl_annotations_
+INT64 GetBufferLevel(const MEDIA_TIME_RANGE* pRanges, UINT32 rangeCount, INT64 position)
+{
+	for (UINT32 i = 0; i < rangeCount; i++)
+	{
+		if (pRanges[i].start <= position && position < pRanges[i].end)
+			return pRanges[i].end - position;
+	}
+
+	return 0;
+}
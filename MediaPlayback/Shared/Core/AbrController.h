@@ -0,0 +1,120 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Adaptive bitrate controllers picking the bitrate of the next segments while an adaptive stream plays.
+//
+// A controller is fed the download of every media segment and asked for a bitrate with the current buffer level.
+// CMediaPlayerPlayback applies the choice as DesiredMin/MaxBitrate of the AdaptiveMediaSource; AbrSimulator.h
+// runs the same controllers against bandwidth traces. Not thread safe, the owner serializes the calls.
+
+#include "PlaybackTypes.h"
+
+#include <memory>
+#include <vector>
+
+#define _AbrMinBufferSeconds_ 10.0		// BOLA keeps at least this much buffered before climbing above the lowest bitrate
+#define _AbrBufferPerLevelSeconds_ 2.0	// and this much more per available bitrate for its buffer target
+#define _AbrHybridBufferOnSeconds_ 12.0	// hybrid switches to BOLA at this buffer level, back to throughput below _AbrMinBufferSeconds_
+
+
+struct IAbrController
+{
+	virtual ~IAbrController() {}
+
+	// downloadTime in 100ns, from sending the request to the last byte
+	virtual void OnSegmentDownloaded(_In_ UINT64 bytes, _In_ INT64 downloadTime) = 0;
+
+	// bitrates in ascending order, bufferLevel in 100ns. Returns 0 while the controller has nothing to go by.
+	virtual UINT32 SelectBitrate(_In_ const std::vector<UINT32>& bitrates, _In_ INT64 bufferLevel) = 0;
+};
+
+
+// Sliding average of the download throughput: the lower of a fast and a slow exponentially weighted average,
+// weighted by download time, so drops are followed quickly and peaks slowly
+class CThroughputEstimator
+{
+public:
+	CThroughputEstimator();
+
+	void AddSample(_In_ UINT64 bytes, _In_ INT64 downloadTime);
+
+	// bits per second, 0 until the first sample
+	UINT32 GetEstimate() const;
+
+	void Reset();
+
+private:
+	typedef struct _EWMA
+	{
+		double alpha;
+		double estimate;
+		double totalWeight;
+	} EWMA;
+
+	static void AddToAverage(_Inout_ EWMA* pAverage, _In_ double weight, _In_ double value);
+	static double GetAverage(_In_ const EWMA& average);
+
+	EWMA m_fast;
+	EWMA m_slow;
+	UINT64 m_bytesSampled;
+};
+
+// Highest bitrate that fits the estimated throughput with a safety margin
+class CThroughputAbrController : public IAbrController
+{
+public:
+	CThroughputAbrController();
+
+	virtual void OnSegmentDownloaded(_In_ UINT64 bytes, _In_ INT64 downloadTime) override;
+	virtual UINT32 SelectBitrate(_In_ const std::vector<UINT32>& bitrates, _In_ INT64 bufferLevel) override;
+
+private:
+	CThroughputEstimator m_estimator;
+};
+
+// BOLA (Spiteri et al.): maximizes the utility (log bitrate) the buffer can afford, without looking at throughput.
+// Starts at the lowest bitrate and climbs as the buffer fills towards _AbrMinBufferSeconds_ + _AbrBufferPerLevelSeconds_ per level.
+class CBolaAbrController : public IAbrController
+{
+public:
+	virtual void OnSegmentDownloaded(_In_ UINT64 bytes, _In_ INT64 downloadTime) override;
+	virtual UINT32 SelectBitrate(_In_ const std::vector<UINT32>& bitrates, _In_ INT64 bufferLevel) override;
+};
+
+// Throughput based until the buffer holds _AbrHybridBufferOnSeconds_, BOLA from then on until it drops below
+// _AbrMinBufferSeconds_; BOLA is slow to start and throughput estimates oscillate once the buffer is full
+class CHybridAbrController : public IAbrController
+{
+public:
+	CHybridAbrController();
+
+	virtual void OnSegmentDownloaded(_In_ UINT64 bytes, _In_ INT64 downloadTime) override;
+	virtual UINT32 SelectBitrate(_In_ const std::vector<UINT32>& bitrates, _In_ INT64 bufferLevel) override;
+
+private:
+	CThroughputAbrController m_throughput;
+	CBolaAbrController m_bola;
+	bool m_useBola;
+};
+
+
+// S_FALSE and no controller for AbrPolicy_System
+HRESULT CreateAbrController(
+	_In_ AbrPolicy policy,
+	_Out_ std::unique_ptr<IAbrController>* pController);
+
+// 100ns of media buffered ahead of position, in the range containing it
+INT64 GetBufferLevel(
+	_In_reads_(rangeCount) const MEDIA_TIME_RANGE* pRanges,
+	_In_ UINT32 rangeCount,
+	_In_ INT64 position);
@@ -0,0 +1,207 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "AbrSimulator.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <sstream>
+
+
+typedef struct _TRACE_CURSOR
+{
+	size_t index;
+	INT64 offset;			// 100ns into trace[index]
+} TRACE_CURSOR;
+
+static void AdvanceTrace(_In_ const std::vector<BANDWIDTH_SAMPLE>& trace, _Inout_ TRACE_CURSOR* pCursor, _In_ INT64 time)
+{
+	while (time > 0)
+	{
+		INT64 remaining = trace[pCursor->index].duration - pCursor->offset;
+		if (time < remaining)
+		{
+			pCursor->offset += time;
+			return;
+		}
+
+		time -= remaining;
+		pCursor->index = (pCursor->index + 1) % trace.size();
+		pCursor->offset = 0;
+	}
+}
+
+// 100ns to receive bytes starting at cursor
+static INT64 GetTransferTime(_In_ const std::vector<BANDWIDTH_SAMPLE>& trace, _In_ TRACE_CURSOR cursor, _In_ UINT64 bytes)
+{
+	double bits = bytes * 8.0;
+	INT64 time = 0;
+
+	for (;;)
+	{
+		const BANDWIDTH_SAMPLE& sample = trace[cursor.index];
+		INT64 remaining = sample.duration - cursor.offset;
+		double capacity = sample.bitsPerSecond * (remaining / 10000000.0);
+
+		if (sample.bitsPerSecond > 0 && capacity >= bits)
+			return time + (INT64)ceil(bits / sample.bitsPerSecond * 10000000.0);
+
+		bits -= capacity;
+		time += remaining;
+		cursor.index = (cursor.index + 1) % trace.size();
+		cursor.offset = 0;
+	}
+}
+
+
+_Use_decl_annotations_
+HRESULT ParseBandwidthTrace(const std::string& text, std::vector<BANDWIDTH_SAMPLE>* pTrace)
+{
+	NULL_CHK(pTrace);
+
+	pTrace->clear();
+
+	std::vector<double> timestamps;
+	std::vector<double> bandwidths;
+
+	std::istringstream lines(text);
+	std::string line;
+	while (std::getline(lines, line))
+	{
+		size_t start = line.find_first_not_of(" \t\r");
+		if (start == std::string::npos || line[start] == '#')
+			continue;
+
+		double seconds = 0;
+		double mbps = 0;
+		std::istringstream values(line);
+		if (!(values >> seconds >> mbps) || mbps < 0 || (!timestamps.empty() && seconds <= timestamps.back()))
+			return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+		timestamps.push_back(seconds);
+		bandwidths.push_back(mbps);
+	}
+
+	if (timestamps.empty())
+		return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+	for (size_t i = 0; i < timestamps.size(); i++)
+	{
+		// the last sample lasts as long as the one before it, or a second
+		double seconds = (i + 1 < timestamps.size()) ? timestamps[i + 1] - timestamps[i] :
+			(i > 0) ? timestamps[i] - timestamps[i - 1] : 1.0;
+
+		BANDWIDTH_SAMPLE sample;
+		sample.duration = (INT64)(seconds * 10000000.0);
+		sample.bitsPerSecond = (UINT32)fmin(bandwidths[i] * 1000000.0, (double)UINT32_MAX);
+
+		if (sample.duration > 0)
+			pTrace->push_back(sample);
+	}
+
+	return pTrace->empty() ? HRESULT_FROM_WIN32(ERROR_INVALID_DATA) : S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT SimulateAbr(const std::vector<BANDWIDTH_SAMPLE>& trace, const ABR_SIMULATION_CONFIG& config, IAbrController* pController, ABR_SIMULATION_RESULT* pResult)
+{
+	NULL_CHK(pController);
+	NULL_CHK(pResult);
+
+	memset(pResult, 0, sizeof(ABR_SIMULATION_RESULT));
+
+	if (config.bitrates.empty() || config.segmentDuration <= 0 || config.segmentCount == 0 || config.maxBuffer < config.segmentDuration)
+		return E_INVALIDARG;
+
+	// a trace without bandwidth would never deliver a segment
+	bool hasBandwidth = false;
+	for (const BANDWIDTH_SAMPLE& sample : trace)
+	{
+		if (sample.duration <= 0)
+			return E_INVALIDARG;
+
+		hasBandwidth = hasBandwidth || sample.bitsPerSecond > 0;
+	}
+
+	if (!hasBandwidth)
+		return E_INVALIDARG;
+
+	TRACE_CURSOR cursor = { 0, 0 };
+	INT64 now = 0;
+	INT64 buffer = 0;
+	bool started = false;
+	bool stalled = false;
+
+	auto fnElapse = [&](INT64 time)
+	{
+		AdvanceTrace(trace, &cursor, time);
+		now += time;
+
+		if (!started)
+			return;
+
+		INT64 played = (buffer < time) ? buffer : time;
+		buffer -= played;
+
+		if (played < time)
+		{
+			pResult->rebufferTime += time - played;
+			if (!stalled)
+				pResult->rebufferCount++;
+			stalled = true;
+		}
+	};
+
+	UINT64 bitrateSum = 0;
+	UINT32 previousBitrate = 0;
+
+	for (UINT32 i = 0; i < config.segmentCount; i++)
+	{
+		// wait for room in the buffer
+		if (started && buffer + config.segmentDuration > config.maxBuffer)
+			fnElapse(buffer + config.segmentDuration - config.maxBuffer);
+
+		// a controller without an opinion yet leaves the stream at the lowest bitrate
+		UINT32 bitrate = pController->SelectBitrate(config.bitrates, buffer);
+		if (bitrate == 0)
+			bitrate = config.bitrates[0];
+
+		if (i > 0 && bitrate != previousBitrate)
+			pResult->switches++;
+
+		previousBitrate = bitrate;
+		bitrateSum += bitrate;
+
+		UINT64 bytes = (UINT64)(bitrate / 8.0 * (config.segmentDuration / 10000000.0));
+
+		fnElapse(config.requestLatency);
+		INT64 downloadTime = config.requestLatency + GetTransferTime(trace, cursor, bytes);
+		fnElapse(downloadTime - config.requestLatency);
+
+		pController->OnSegmentDownloaded(bytes, downloadTime);
+
+		buffer += config.segmentDuration;
+		stalled = false;
+
+		if (!started && (buffer >= config.startupBuffer || i + 1 == config.segmentCount))
+		{
+			started = true;
+			pResult->startupDelay = now;
+		}
+	}
+
+	pResult->averageBitrate = (UINT32)(bitrateSum / config.segmentCount);
+	pResult->totalTime = now + buffer;
+
+	return S_OK;
+}
@@ -0,0 +1,66 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Plays an adaptive stream against a bandwidth trace with an IAbrController, on a virtual clock,
+// so ABR policies can be compared offline (part of the portable core, runs on Linux).
+//
+// The stream is segmentCount segments of segmentDuration at every bitrate of the ladder, each segment
+// bitrate * segmentDuration large. Segments are downloaded back to back while the buffer has room for them;
+// playback starts once startupBuffer is buffered and stalls whenever the buffer runs dry.
+
+#include "AbrController.h"
+
+#include <string>
+#include <vector>
+
+
+// The bandwidth stays at bitsPerSecond for duration (100ns)
+typedef struct _BANDWIDTH_SAMPLE
+{
+	INT64 duration;
+	UINT32 bitsPerSecond;
+} BANDWIDTH_SAMPLE;
+
+typedef struct _ABR_SIMULATION_CONFIG
+{
+	std::vector<UINT32> bitrates;	// ascending
+	INT64 segmentDuration;			// 100ns
+	UINT32 segmentCount;
+	INT64 maxBuffer;				// 100ns the player buffers at most
+	INT64 startupBuffer;			// 100ns buffered before playback starts
+	INT64 requestLatency;			// 100ns from request to first byte of every segment
+} ABR_SIMULATION_CONFIG;
+
+typedef struct _ABR_SIMULATION_RESULT
+{
+	INT64 startupDelay;				// 100ns until playback started
+	INT64 rebufferTime;				// 100ns stalled after playback started
+	UINT32 rebufferCount;
+	UINT32 switches;				// bitrate changes between consecutive segments
+	UINT32 averageBitrate;			// over the segments
+	INT64 totalTime;				// 100ns until the last segment has played
+} ABR_SIMULATION_RESULT;
+
+
+// Text traces: one "<seconds> <Mbps>" pair per line, timestamps ascending, the bandwidth holds until the next
+// timestamp (the format of the Pensieve/FCC/HSDPA traces). Lines starting with # are comments.
+HRESULT ParseBandwidthTrace(
+	_In_ const std::string& text,
+	_Out_ std::vector<BANDWIDTH_SAMPLE>* pTrace);
+
+// Loops the trace if the stream outlasts it
+HRESULT SimulateAbr(
+	_In_ const std::vector<BANDWIDTH_SAMPLE>& trace,
+	_In_ const ABR_SIMULATION_CONFIG& config,
+	_In_ IAbrController* pController,
+	_Out_ ABR_SIMULATION_RESULT* pResult);
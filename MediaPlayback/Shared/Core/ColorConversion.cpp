@@ -0,0 +1,712 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ColorConversion.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <atomic>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define COLOR_CONVERSION_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#elif defined(_M_ARM) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define COLOR_CONVERSION_NEON
+#include <arm_neon.h>
+#endif
+
+// GCC and clang only emit SSE4.1/AVX2 instructions in functions that ask for them, MSVC always does
+#if defined(COLOR_CONVERSION_X86) && defined(__GNUC__)
+#define COLOR_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define COLOR_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define COLOR_TARGET_SSE41
+#define COLOR_TARGET_AVX2
+#endif
+
+#define _ColorFractionBits_ 14
+#define _ColorRounding_ (1 << (_ColorFractionBits_ - 1))
+#define _NoColorConversionKernel_ 0xFFFFFFFF
+
+
+// Q14 coefficients of one matrix / range / bit depth / output format combination:
+//   luma = (Y - yOffset) * yScale, U and V are relative to uvOffset
+//   R = luma + rv * V,  G = luma - gu * U - gv * V,  B = luma + bu * U
+typedef struct _COLOR_COEFFICIENTS
+{
+	INT32 yOffset;
+	INT32 yScale;
+	INT32 uvOffset;
+	INT32 rv;
+	INT32 gu;
+	INT32 gv;
+	INT32 bu;
+	UINT32 redShift;		// bit position of R in the output pixel: 16 for BGRA, 0 for RGBA
+	UINT32 blueShift;
+} COLOR_COEFFICIENTS;
+
+// One output row. NV12 and P010 keep interleaved UV in pU.
+typedef struct _YUV_ROW
+{
+	const BYTE* pY;
+	const BYTE* pU;
+	const BYTE* pV;
+	BYTE* pDestination;
+	UINT32 width;
+} YUV_ROW;
+
+typedef void (*ConvertRowFunction)(const YUV_ROW& row, const COLOR_COEFFICIENTS& coefficients);
+
+typedef struct _COLOR_KERNEL_ROWS
+{
+	ConvertRowFunction nv12;
+	ConvertRowFunction p010;
+	ConvertRowFunction i420;
+} COLOR_KERNEL_ROWS;
+
+static std::atomic<UINT32> s_colorConversionKernel(_NoColorConversionKernel_);
+
+
+static INT32 RoundCoefficient(_In_ double value)
+{
+	return (INT32)floor(value * (1 << _ColorFractionBits_) + 0.5);
+}
+
+static COLOR_COEFFICIENTS MakeCoefficients(_In_ ColorMatrix matrix, _In_ ColorRange range, _In_ RgbFormat format, _In_ UINT32 bitDepth)
+{
+	double kr = 0.0;
+	double kb = 0.0;
+	switch (matrix)
+	{
+	case ColorMatrix::ColorMatrix_BT601:
+		kr = 0.299;
+		kb = 0.114;
+		break;
+	case ColorMatrix::ColorMatrix_BT709:
+		kr = 0.2126;
+		kb = 0.0722;
+		break;
+	default:
+		kr = 0.2627;
+		kb = 0.0593;
+		break;
+	}
+	double kg = 1.0 - kr - kb;
+
+	UINT32 depthShift = bitDepth - 8;
+	double yRange = 0.0;
+	double uvRange = 0.0;
+
+	COLOR_COEFFICIENTS coefficients;
+	if (range == ColorRange::ColorRange_Limited)
+	{
+		coefficients.yOffset = 16 << depthShift;
+		yRange = (double)(219 << depthShift);
+		uvRange = (double)(224 << depthShift);
+	}
+	else
+	{
+		coefficients.yOffset = 0;
+		yRange = (double)((1 << bitDepth) - 1);
+		uvRange = yRange;
+	}
+
+	double uvScale = 255.0 / uvRange;
+
+	coefficients.yScale = RoundCoefficient(255.0 / yRange);
+	coefficients.uvOffset = 128 << depthShift;
+	coefficients.rv = RoundCoefficient(2.0 * (1.0 - kr) * uvScale);
+	coefficients.gu = RoundCoefficient(2.0 * kb * (1.0 - kb) / kg * uvScale);
+	coefficients.gv = RoundCoefficient(2.0 * kr * (1.0 - kr) / kg * uvScale);
+	coefficients.bu = RoundCoefficient(2.0 * (1.0 - kb) * uvScale);
+	coefficients.redShift = (format == RgbFormat::RgbFormat_BGRA) ? 16 : 0;
+	coefficients.blueShift = (format == RgbFormat::RgbFormat_BGRA) ? 0 : 16;
+
+	return coefficients;
+}
+
+static inline UINT32 Load32(_In_ const BYTE* p)
+{
+	UINT32 value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static inline UINT16 Load16(_In_ const BYTE* p)
+{
+	UINT16 value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+
+// Scalar reference. The row functions take the first pixel to convert, so SIMD kernels finish their rows with them.
+
+static inline INT32 Clamp8(_In_ INT32 value)
+{
+	return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+static inline void ConvertPixel(_In_ INT32 y, _In_ INT32 u, _In_ INT32 v, _In_ const COLOR_COEFFICIENTS& c, _Out_ BYTE* pDestination)
+{
+	INT32 luma = (y - c.yOffset) * c.yScale + _ColorRounding_;
+	u -= c.uvOffset;
+	v -= c.uvOffset;
+
+	UINT32 r = (UINT32)Clamp8((luma + c.rv * v) >> _ColorFractionBits_);
+	UINT32 g = (UINT32)Clamp8((luma - c.gu * u - c.gv * v) >> _ColorFractionBits_);
+	UINT32 b = (UINT32)Clamp8((luma + c.bu * u) >> _ColorFractionBits_);
+
+	UINT32 pixel = (r << c.redShift) | (g << 8) | (b << c.blueShift) | 0xFF000000;
+	memcpy(pDestination, &pixel, sizeof(pixel));
+}
+
+static void ConvertRowNV12Scalar(_In_ const YUV_ROW& row, _In_ const COLOR_COEFFICIENTS& c, _In_ UINT32 x)
+{
+	for (; x < row.width; x++)
+	{
+		const BYTE* pUV = row.pU + (x / 2) * 2;
+		ConvertPixel(row.pY[x], pUV[0], pUV[1], c, row.pDestination + (size_t)x * 4);
+	}
+}
+
+static void ConvertRowP010Scalar(_In_ const YUV_ROW& row, _In_ const COLOR_COEFFICIENTS& c, _In_ UINT32 x)
+{
+	for (; x < row.width; x++)
+	{
+		const BYTE* pUV = row.pU + (x / 2) * 4;
+		ConvertPixel(Load16(row.pY + (size_t)x * 2) >> 6, Load16(pUV) >> 6, Load16(pUV + 2) >> 6, c, row.pDestination + (size_t)x * 4);
+	}
+}
+
+static void ConvertRowI420Scalar(_In_ const YUV_ROW& row, _In_ const COLOR_COEFFICIENTS& c, _In_ UINT32 x)
+{
+	for (; x < row.width; x++)
+	{
+		ConvertPixel(row.pY[x], row.pU[x / 2], row.pV[x / 2], c, row.pDestination + (size_t)x * 4);
+	}
+}
+
+static void ConvertRowNV12Scalar(_In_ const YUV_ROW& row, _In_ const COLOR_COEFFICIENTS& c) { ConvertRowNV12Scalar(row, c, 0); }
+static void ConvertRowP010Scalar(_In_ const YUV_ROW& row, _In_ const COLOR_COEFFICIENTS& c) { ConvertRowP010Scalar(row, c, 0); }
+static void ConvertRowI420Scalar(_In_ const YUV_ROW& row, _In_ const COLOR_COEFFICIENTS& c) { ConvertRowI420Scalar(row, c, 0); }
+
+
+#if defined(COLOR_CONVERSION_X86)
+
+// SSE4.1: 4 pixels per iteration in 32-bit lanes (_mm_mullo_epi32 and the 32-bit min/max need SSE4.1)
+
+typedef struct _SSE_COEFFICIENTS
+{
+	__m128i yOffset;
+	__m128i yScale;
+	__m128i rounding;
+	__m128i uvOffset;
+	__m128i rv;
+	__m128i gu;
+	__m128i gv;
+	__m128i bu;
+	__m128i maxValue;
+	__m128i alpha;
+	__m128i redShift;
+	__m128i blueShift;
+} SSE_COEFFICIENTS;
+
+COLOR_TARGET_SSE41 static inline SSE_COEFFICIENTS LoadCoefficientsSse41(_In_ const COLOR_COEFFICIENTS& c)
+{
+	SSE_COEFFICIENTS coefficients;
+	coefficients.yOffset = _mm_set1_epi32(c.yOffset);
+	coefficients.yScale = _mm_set1_epi32(c.yScale);
+	coefficients.rounding = _mm_set1_epi32(_ColorRounding_);
+	coefficients.uvOffset = _mm_set1_epi32(c.uvOffset);
+	coefficients.rv = _mm_set1_epi32(c.rv);
+	coefficients.gu = _mm_set1_epi32(c.gu);
+	coefficients.gv = _mm_set1_epi32(c.gv);
+	coefficients.bu = _mm_set1_epi32(c.bu);
+	coefficients.maxValue = _mm_set1_epi32(255);
+	coefficients.alpha = _mm_set1_epi32((int)0xFF000000);
+	coefficients.redShift = _mm_cvtsi32_si128((int)c.redShift);
+	coefficients.blueShift = _mm_cvtsi32_si128((int)c.blueShift);
+	return coefficients;
+}
+
+COLOR_TARGET_SSE41 static inline void ConvertPixelsSse41(_In_ __m128i y, _In_ __m128i u, _In_ __m128i v, _In_ const SSE_COEFFICIENTS& c, _Out_ BYTE* pDestination)
+{
+	__m128i luma = _mm_add_epi32(_mm_mullo_epi32(_mm_sub_epi32(y, c.yOffset), c.yScale), c.rounding);
+	u = _mm_sub_epi32(u, c.uvOffset);
+	v = _mm_sub_epi32(v, c.uvOffset);
+
+	__m128i zero = _mm_setzero_si128();
+	__m128i r = _mm_srai_epi32(_mm_add_epi32(luma, _mm_mullo_epi32(v, c.rv)), _ColorFractionBits_);
+	__m128i g = _mm_srai_epi32(_mm_sub_epi32(_mm_sub_epi32(luma, _mm_mullo_epi32(u, c.gu)), _mm_mullo_epi32(v, c.gv)), _ColorFractionBits_);
+	__m128i b = _mm_srai_epi32(_mm_add_epi32(luma, _mm_mullo_epi32(u, c.bu)), _ColorFractionBits_);
+	r = _mm_min_epi32(_mm_max_epi32(r, zero), c.maxValue);
+	g = _mm_min_epi32(_mm_max_epi32(g, zero), c.maxValue);
+	b = _mm_min_epi32(_mm_max_epi32(b, zero), c.maxValue);
+
+	__m128i pixels = _mm_or_si128(_mm_or_si128(_mm_sll_epi32(r, c.redShift), _mm_slli_epi32(g, 8)), _mm_or_si128(_mm_sll_epi32(b, c.blueShift), c.alpha));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination), pixels);
+}
+
+COLOR_TARGET_SSE41 static void ConvertRowNV12Sse41(_In_ const YUV_ROW& row, _In_ const COLOR_COEFFICIENTS& coefficients)
+{
+	SSE_COEFFICIENTS c = LoadCoefficientsSse41(coefficients);
+
+	UINT32 x = 0;
+	for (; x + 4 <= row.width; x += 4)
+	{
+		__m128i y = _mm_cvtepu8_epi32(_mm_cvtsi32_si128((int)Load32(row.pY + x)));
+		__m128i uv = _mm_cvtepu8_epi32(_mm_cvtsi32_si128((int)Load32(row.pU + x)));		// u0 v0 u1 v1
+		__m128i u = _mm_shuffle_epi32(uv, _MM_SHUFFLE(2, 2, 0, 0));
+		__m128i v = _mm_shuffle_epi32(uv, _MM_SHUFFLE(3, 3, 1, 1));
+		ConvertPixelsSse41(y, u, v, c, row.pDestination + (size_t)x * 4);
+	}
+
+	ConvertRowNV12Scalar(row, coefficients, x);
+}
+
+COLOR_TARGET_SSE41 static void ConvertRowP010Sse41(_In_ const YUV_ROW& row, _In_ const COLOR_COEFFICIENTS& coefficients)
+{
+	SSE_COEFFICIENTS c = LoadCoefficientsSse41(coefficients);
+
+	UINT32 x = 0;
+	for (; x + 4 <= row.width; x += 4)
+	{
+		__m128i y = _mm_srli_epi32(_mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row.pY + (size_t)x * 2))), 6);
+		__m128i uv = _mm_srli_epi32(_mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row.pU + (size_t)x * 2))), 6);
+		__m128i u = _mm_shuffle_epi32(uv, _MM_SHUFFLE(2, 2, 0, 0));
+		__m128i v = _mm_shuffle_epi32(uv, _MM_SHUFFLE(3, 3, 1, 1));
+		ConvertPixelsSse41(y, u, v, c, row.pDestination + (size_t)x * 4);
+	}
+
+	ConvertRowP010Scalar(row, coefficients, x);
+}
+
+COLOR_TARGET_SSE41 static void ConvertRowI420Sse41(_In_ const YUV_ROW& row, _In_ const COLOR_COEFFICIENTS& coefficients)
+{
+	SSE_COEFFICIENTS c = LoadCoefficientsSse41(coefficients);
+
+	UINT32 x = 0;
+	for (; x + 4 <= row.width; x += 4)
+	{
+		__m128i y = _mm_cvtepu8_epi32(_mm_cvtsi32_si128((int)Load32(row.pY + x)));
+		__m128i u = _mm_shuffle_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(Load16(row.pU + x / 2))), _MM_SHUFFLE(1, 1, 0, 0));
+		__m128i v = _mm_shuffle_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(Load16(row.pV + x / 2))), _MM_SHUFFLE(1, 1, 0, 0));
+		ConvertPixelsSse41(y, u, v, c, row.pDestination + (size_t)x * 4);
+	}
+
+	ConvertRowI420Scalar(row, coefficients, x);
+}
+
+
+// AVX2: the same math on 8 pixels
+
+typedef struct _AVX_COEFFICIENTS
+{
+	__m256i yOffset;
+	__m256i yScale;
+	__m256i rounding;
+	__m256i uvOffset;
+	__m256i rv;
+	__m256i gu;
+	__m256i gv;
+	__m256i bu;
+	__m256i maxValue;
+	__m256i alpha;
+	__m128i redShift;
+	__m128i blueShift;
+} AVX_COEFFICIENTS;
+
+COLOR_TARGET_AVX2 static inline AVX_COEFFICIENTS LoadCoefficientsAvx2(_In_ const COLOR_COEFFICIENTS& c)
+{
+	AVX_COEFFICIENTS coefficients;
+	coefficients.yOffset = _mm256_set1_epi32(c.yOffset);
+	coefficients.yScale = _mm256_set1_epi32(c.yScale);
+	coefficients.rounding = _mm256_set1_epi32(_ColorRounding_);
+	coefficients.uvOffset = _mm256_set1_epi32(c.uvOffset);
+	coefficients.rv = _mm256_set1_epi32(c.rv);
+	coefficients.gu = _mm256_set1_epi32(c.gu);
+	coefficients.gv = _mm256_set1_epi32(c.gv);
+	coefficients.bu = _mm256_set1_epi32(c.bu);
+	coefficients.maxValue = _mm256_set1_epi32(255);
+	coefficients.alpha = _mm256_set1_epi32((int)0xFF000000);
+	coefficients.redShift = _mm_cvtsi32_si128((int)c.redShift);
+	coefficients.blueShift = _mm_cvtsi32_si128((int)c.blueShift);
+	return coefficients;
+}
+
+COLOR_TARGET_AVX2 static inline void ConvertPixelsAvx2(_In_ __m256i y, _In_ __m256i u, _In_ __m256i v, _In_ const AVX_COEFFICIENTS& c, _Out_ BYTE* pDestination)
+{
+	__m256i luma = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(y, c.yOffset), c.yScale), c.rounding);
+	u = _mm256_sub_epi32(u, c.uvOffset);
+	v = _mm256_sub_epi32(v, c.uvOffset);
+
+	__m256i zero = _mm256_setzero_si256();
+	__m256i r = _mm256_srai_epi32(_mm256_add_epi32(luma, _mm256_mullo_epi32(v, c.rv)), _ColorFractionBits_);
+	__m256i g = _mm256_srai_epi32(_mm256_sub_epi32(_mm256_sub_epi32(luma, _mm256_mullo_epi32(u, c.gu)), _mm256_mullo_epi32(v, c.gv)), _ColorFractionBits_);
+	__m256i b = _mm256_srai_epi32(_mm256_add_epi32(luma, _mm256_mullo_epi32(u, c.bu)), _ColorFractionBits_);
+	r = _mm256_min_epi32(_mm256_max_epi32(r, zero), c.maxValue);
+	g = _mm256_min_epi32(_mm256_max_epi32(g, zero), c.maxValue);
+	b = _mm256_min_epi32(_mm256_max_epi32(b, zero), c.maxValue);
+
+	__m256i pixels = _mm256_or_si256(_mm256_or_si256(_mm256_sll_epi32(r, c.redShift), _mm256_slli_epi32(g, 8)), _mm256_or_si256(_mm256_sll_epi32(b, c.blueShift), c.alpha));
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(pDestination), pixels);
+}
+
+COLOR_TARGET_AVX2 static void ConvertRowNV12Avx2(_In_ const YUV_ROW& row, _In_ const COLOR_COEFFICIENTS& coefficients)
+{
+	AVX_COEFFICIENTS c = LoadCoefficientsAvx2(coefficients);
+	__m256i uIndex = _mm256_setr_epi32(0, 0, 2, 2, 4, 4, 6, 6);
+	__m256i vIndex = _mm256_setr_epi32(1, 1, 3, 3, 5, 5, 7, 7);
+
+	UINT32 x = 0;
+	for (; x + 8 <= row.width; x += 8)
+	{
+		__m256i y = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row.pY + x)));
+		__m256i uv = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row.pU + x)));
+		ConvertPixelsAvx2(y, _mm256_permutevar8x32_epi32(uv, uIndex), _mm256_permutevar8x32_epi32(uv, vIndex), c, row.pDestination + (size_t)x * 4);
+	}
+
+	ConvertRowNV12Scalar(row, coefficients, x);
+}
+
+COLOR_TARGET_AVX2 static void ConvertRowP010Avx2(_In_ const YUV_ROW& row, _In_ const COLOR_COEFFICIENTS& coefficients)
+{
+	AVX_COEFFICIENTS c = LoadCoefficientsAvx2(coefficients);
+	__m256i uIndex = _mm256_setr_epi32(0, 0, 2, 2, 4, 4, 6, 6);
+	__m256i vIndex = _mm256_setr_epi32(1, 1, 3, 3, 5, 5, 7, 7);
+
+	UINT32 x = 0;
+	for (; x + 8 <= row.width; x += 8)
+	{
+		__m256i y = _mm256_srli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row.pY + (size_t)x * 2))), 6);
+		__m256i uv = _mm256_srli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row.pU + (size_t)x * 2))), 6);
+		ConvertPixelsAvx2(y, _mm256_permutevar8x32_epi32(uv, uIndex), _mm256_permutevar8x32_epi32(uv, vIndex), c, row.pDestination + (size_t)x * 4);
+	}
+
+	ConvertRowP010Scalar(row, coefficients, x);
+}
+
+COLOR_TARGET_AVX2 static void ConvertRowI420Avx2(_In_ const YUV_ROW& row, _In_ const COLOR_COEFFICIENTS& coefficients)
+{
+	AVX_COEFFICIENTS c = LoadCoefficientsAvx2(coefficients);
+	__m256i index = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+
+	UINT32 x = 0;
+	for (; x + 8 <= row.width; x += 8)
+	{
+		__m256i y = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row.pY + x)));
+		__m256i u = _mm256_cvtepu8_epi32(_mm_cvtsi32_si128((int)Load32(row.pU + x / 2)));
+		__m256i v = _mm256_cvtepu8_epi32(_mm_cvtsi32_si128((int)Load32(row.pV + x / 2)));
+		ConvertPixelsAvx2(y, _mm256_permutevar8x32_epi32(u, index), _mm256_permutevar8x32_epi32(v, index), c, row.pDestination + (size_t)x * 4);
+	}
+
+	ConvertRowI420Scalar(row, coefficients, x);
+}
+
+#endif // COLOR_CONVERSION_X86
+
+
+#if defined(COLOR_CONVERSION_NEON)
+
+// NEON: 8 pixels per iteration, converted as two halves of 4 pixels in 32-bit lanes
+
+typedef struct _NEON_COEFFICIENTS
+{
+	int32x4_t yOffset;
+	int32x4_t yScale;
+	int32x4_t rounding;
+	int32x4_t uvOffset;
+	int32x4_t rv;
+	int32x4_t gu;
+	int32x4_t gv;
+	int32x4_t bu;
+	int32x4_t maxValue;
+	uint32x4_t alpha;
+	int32x4_t redShift;
+	int32x4_t blueShift;
+} NEON_COEFFICIENTS;
+
+static inline NEON_COEFFICIENTS LoadCoefficientsNeon(_In_ const COLOR_COEFFICIENTS& c)
+{
+	NEON_COEFFICIENTS coefficients;
+	coefficients.yOffset = vdupq_n_s32(c.yOffset);
+	coefficients.yScale = vdupq_n_s32(c.yScale);
+	coefficients.rounding = vdupq_n_s32(_ColorRounding_);
+	coefficients.uvOffset = vdupq_n_s32(c.uvOffset);
+	coefficients.rv = vdupq_n_s32(c.rv);
+	coefficients.gu = vdupq_n_s32(c.gu);
+	coefficients.gv = vdupq_n_s32(c.gv);
+	coefficients.bu = vdupq_n_s32(c.bu);
+	coefficients.maxValue = vdupq_n_s32(255);
+	coefficients.alpha = vdupq_n_u32(0xFF000000);
+	coefficients.redShift = vdupq_n_s32((INT32)c.redShift);
+	coefficients.blueShift = vdupq_n_s32((INT32)c.blueShift);
+	return coefficients;
+}
+
+static inline void ConvertPixelsNeon(_In_ int32x4_t y, _In_ int32x4_t u, _In_ int32x4_t v, _In_ const NEON_COEFFICIENTS& c, _Out_ BYTE* pDestination)
+{
+	int32x4_t luma = vmlaq_s32(c.rounding, vsubq_s32(y, c.yOffset), c.yScale);
+	u = vsubq_s32(u, c.uvOffset);
+	v = vsubq_s32(v, c.uvOffset);
+
+	int32x4_t zero = vdupq_n_s32(0);
+	int32x4_t r = vshrq_n_s32(vmlaq_s32(luma, v, c.rv), _ColorFractionBits_);
+	int32x4_t g = vshrq_n_s32(vmlsq_s32(vmlsq_s32(luma, u, c.gu), v, c.gv), _ColorFractionBits_);
+	int32x4_t b = vshrq_n_s32(vmlaq_s32(luma, u, c.bu), _ColorFractionBits_);
+	r = vminq_s32(vmaxq_s32(r, zero), c.maxValue);
+	g = vminq_s32(vmaxq_s32(g, zero), c.maxValue);
+	b = vminq_s32(vmaxq_s32(b, zero), c.maxValue);
+
+	uint32x4_t pixels = vorrq_u32(
+		vorrq_u32(vshlq_u32(vreinterpretq_u32_s32(r), c.redShift), vshlq_n_u32(vreinterpretq_u32_s32(g), 8)),
+		vorrq_u32(vshlq_u32(vreinterpretq_u32_s32(b), c.blueShift), c.alpha));
+	vst1q_u8(pDestination, vreinterpretq_u8_u32(pixels));
+}
+
+// y, u and v hold 8 pixels as 16-bit lanes
+static inline void ConvertPixels8Neon(_In_ uint16x8_t y, _In_ uint16x8_t u, _In_ uint16x8_t v, _In_ const NEON_COEFFICIENTS& c, _Out_ BYTE* pDestination)
+{
+	ConvertPixelsNeon(
+		vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(y))),
+		vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(u))),
+		vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(v))),
+		c, pDestination);
+	ConvertPixelsNeon(
+		vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(y))),
+		vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(u))),
+		vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(v))),
+		c, pDestination + 16);
+}
+
+static void ConvertRowNV12Neon(_In_ const YUV_ROW& row, _In_ const COLOR_COEFFICIENTS& coefficients)
+{
+	NEON_COEFFICIENTS c = LoadCoefficientsNeon(coefficients);
+
+	UINT32 x = 0;
+	for (; x + 8 <= row.width; x += 8)
+	{
+		uint16x8_t y = vmovl_u8(vld1_u8(row.pY + x));
+		uint16x8x2_t uv = vuzpq_u16(vmovl_u8(vld1_u8(row.pU + x)), vdupq_n_u16(0));		// u0 u1 u2 u3 ..., v0 v1 v2 v3 ...
+		ConvertPixels8Neon(y, vzipq_u16(uv.val[0], uv.val[0]).val[0], vzipq_u16(uv.val[1], uv.val[1]).val[0], c, row.pDestination + (size_t)x * 4);
+	}
+
+	ConvertRowNV12Scalar(row, coefficients, x);
+}
+
+static void ConvertRowP010Neon(_In_ const YUV_ROW& row, _In_ const COLOR_COEFFICIENTS& coefficients)
+{
+	NEON_COEFFICIENTS c = LoadCoefficientsNeon(coefficients);
+
+	UINT32 x = 0;
+	for (; x + 8 <= row.width; x += 8)
+	{
+		uint16x8_t y = vshrq_n_u16(vld1q_u16(reinterpret_cast<const uint16_t*>(row.pY + (size_t)x * 2)), 6);
+		uint16x8x2_t uv = vuzpq_u16(vshrq_n_u16(vld1q_u16(reinterpret_cast<const uint16_t*>(row.pU + (size_t)x * 2)), 6), vdupq_n_u16(0));
+		ConvertPixels8Neon(y, vzipq_u16(uv.val[0], uv.val[0]).val[0], vzipq_u16(uv.val[1], uv.val[1]).val[0], c, row.pDestination + (size_t)x * 4);
+	}
+
+	ConvertRowP010Scalar(row, coefficients, x);
+}
+
+static void ConvertRowI420Neon(_In_ const YUV_ROW& row, _In_ const COLOR_COEFFICIENTS& coefficients)
+{
+	NEON_COEFFICIENTS c = LoadCoefficientsNeon(coefficients);
+
+	UINT32 x = 0;
+	for (; x + 8 <= row.width; x += 8)
+	{
+		uint16x8_t y = vmovl_u8(vld1_u8(row.pY + x));
+		uint16x8_t u = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(Load32(row.pU + x / 2))));	// u0 u1 u2 u3 u0 u1 u2 u3
+		uint16x8_t v = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(Load32(row.pV + x / 2))));
+		ConvertPixels8Neon(y, vzipq_u16(u, u).val[0], vzipq_u16(v, v).val[0], c, row.pDestination + (size_t)x * 4);
+	}
+
+	ConvertRowI420Scalar(row, coefficients, x);
+}
+
+#endif // COLOR_CONVERSION_NEON
+
+
+// Indexed by ColorConversionKernel
+static const COLOR_KERNEL_ROWS s_kernelRows[] =
+{
+	{ ConvertRowNV12Scalar, ConvertRowP010Scalar, ConvertRowI420Scalar },
+#if defined(COLOR_CONVERSION_X86)
+	{ ConvertRowNV12Sse41, ConvertRowP010Sse41, ConvertRowI420Sse41 },
+	{ ConvertRowNV12Avx2, ConvertRowP010Avx2, ConvertRowI420Avx2 },
+#else
+	{ nullptr, nullptr, nullptr },
+	{ nullptr, nullptr, nullptr },
+#endif
+#if defined(COLOR_CONVERSION_NEON)
+	{ ConvertRowNV12Neon, ConvertRowP010Neon, ConvertRowI420Neon },
+#else
+	{ nullptr, nullptr, nullptr },
+#endif
+};
+
+_Use_decl_annotations_
+bool IsColorConversionKernelSupported(ColorConversionKernel kernel)
+{
+	switch (kernel)
+	{
+	case ColorConversionKernel::ColorConversionKernel_Scalar:
+		return true;
+
+#if defined(COLOR_CONVERSION_X86)
+	case ColorConversionKernel::ColorConversionKernel_SSE41:
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		return (info[2] & (1 << 19)) != 0;
+#else
+		return __builtin_cpu_supports("sse4.1") != 0;
+#endif
+	}
+
+	case ColorConversionKernel::ColorConversionKernel_AVX2:
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+
+		// AVX and OSXSAVE, and the OS saves the YMM registers
+		__cpuid(info, 1);
+		if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+			return false;
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2") != 0;
+#endif
+	}
+#endif
+
+#if defined(COLOR_CONVERSION_NEON)
+	case ColorConversionKernel::ColorConversionKernel_NEON:
+		return true;
+#endif
+
+	default:
+		return false;
+	}
+}
+
+ColorConversionKernel GetColorConversionKernel()
+{
+	UINT32 kernel = s_colorConversionKernel.load(std::memory_order_relaxed);
+	if (kernel != _NoColorConversionKernel_)
+		return (ColorConversionKernel)kernel;
+
+	// fastest first; racing first calls pick the same one
+	const ColorConversionKernel preferred[] =
+	{
+		ColorConversionKernel::ColorConversionKernel_AVX2,
+		ColorConversionKernel::ColorConversionKernel_SSE41,
+		ColorConversionKernel::ColorConversionKernel_NEON
+	};
+
+	ColorConversionKernel selected = ColorConversionKernel::ColorConversionKernel_Scalar;
+	for (auto candidate : preferred)
+	{
+		if (IsColorConversionKernelSupported(candidate))
+		{
+			selected = candidate;
+			break;
+		}
+	}
+
+	s_colorConversionKernel.store((UINT32)selected, std::memory_order_relaxed);
+
+	return selected;
+}
+
+_Use_decl_annotations_
+HRESULT SetColorConversionKernel(ColorConversionKernel kernel)
+{
+	if (!IsColorConversionKernelSupported(kernel))
+		return E_INVALIDARG;
+
+	s_colorConversionKernel.store((UINT32)kernel, std::memory_order_relaxed);
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT ConvertYuvToRgb(const YUV_FRAME& source, ColorMatrix matrix, ColorRange range, RgbFormat destinationFormat, BYTE* pDestination, UINT32 destinationPitch)
+{
+	NULL_CHK(pDestination);
+	NULL_CHK(source.planes[0]);
+	NULL_CHK(source.planes[1]);
+
+	if (!source.width || !source.height || destinationPitch < source.width * 4)
+		return E_INVALIDARG;
+
+	if (matrix > ColorMatrix::ColorMatrix_BT2020 || range > ColorRange::ColorRange_Full || destinationFormat > RgbFormat::RgbFormat_RGBA)
+		return E_INVALIDARG;
+
+	const COLOR_KERNEL_ROWS& rows = s_kernelRows[(UINT32)GetColorConversionKernel()];
+	UINT32 chromaWidth = (source.width + 1) / 2;
+	ConvertRowFunction fnConvertRow = nullptr;
+	UINT32 bitDepth = 8;
+
+	switch (source.format)
+	{
+	case YuvFormat::YuvFormat_NV12:
+		if (source.pitches[0] < source.width || source.pitches[1] < chromaWidth * 2)
+			return E_INVALIDARG;
+		fnConvertRow = rows.nv12;
+		break;
+
+	case YuvFormat::YuvFormat_P010:
+		if (source.pitches[0] < source.width * 2 || source.pitches[1] < chromaWidth * 4)
+			return E_INVALIDARG;
+		fnConvertRow = rows.p010;
+		bitDepth = 10;
+		break;
+
+	case YuvFormat::YuvFormat_I420:
+		NULL_CHK(source.planes[2]);
+		if (source.pitches[0] < source.width || source.pitches[1] < chromaWidth || source.pitches[2] < chromaWidth)
+			return E_INVALIDARG;
+		fnConvertRow = rows.i420;
+		break;
+
+	default:
+		return E_INVALIDARG;
+	}
+
+	COLOR_COEFFICIENTS coefficients = MakeCoefficients(matrix, range, destinationFormat, bitDepth);
+
+	for (UINT32 y = 0; y < source.height; y++)
+	{
+		YUV_ROW row;
+		row.pY = source.planes[0] + (size_t)source.pitches[0] * y;
+		row.pU = source.planes[1] + (size_t)source.pitches[1] * (y / 2);
+		row.pV = (source.format == YuvFormat::YuvFormat_I420) ? source.planes[2] + (size_t)source.pitches[2] * (y / 2) : nullptr;
+		row.pDestination = pDestination + (size_t)destinationPitch * y;
+		row.width = source.width;
+
+		fnConvertRow(row, coefficients);
+	}
+
+	return S_OK;
+}
@@ -0,0 +1,83 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// CPU conversion of decoded YUV frames (NV12, P010, I420) to 32bpp BGRA/RGBA.
+//
+// Used where the GPU video processor behind CopyFrameToVideoSurface is not available (headless capture, WARP).
+// All kernels use the same Q14 fixed point math, so the AVX2, SSE4.1 and NEON kernels produce exactly the
+// output of the scalar reference. The fastest kernel the CPU supports is picked on first use.
+
+#include "PlaybackTypes.h"
+
+enum class YuvFormat : UINT32
+{
+	YuvFormat_NV12 = 0,		// 8-bit Y plane, interleaved half resolution UV plane
+	YuvFormat_P010,			// NV12 layout with 16-bit samples, 10 significant bits in the high bits
+	YuvFormat_I420			// 8-bit Y, U and V planes, U and V at half resolution
+};
+
+enum class RgbFormat : UINT32
+{
+	RgbFormat_BGRA = 0,		// DXGI_FORMAT_B8G8R8A8_UNORM
+	RgbFormat_RGBA			// DXGI_FORMAT_R8G8B8A8_UNORM
+};
+
+enum class ColorMatrix : UINT32
+{
+	ColorMatrix_BT601 = 0,
+	ColorMatrix_BT709,
+	ColorMatrix_BT2020
+};
+
+enum class ColorRange : UINT32
+{
+	ColorRange_Limited = 0,	// studio swing, 16-235 luma at 8 bits
+	ColorRange_Full
+};
+
+enum class ColorConversionKernel : UINT32
+{
+	ColorConversionKernel_Scalar = 0,
+	ColorConversionKernel_SSE41,
+	ColorConversionKernel_AVX2,
+	ColorConversionKernel_NEON
+};
+
+// Planes of a decoded frame. NV12 and P010 use planes 0 (Y) and 1 (UV), I420 uses 0 (Y), 1 (U) and 2 (V).
+typedef struct _YUV_FRAME
+{
+	YuvFormat format;
+	UINT32 width;
+	UINT32 height;
+	const BYTE* planes[3];
+	UINT32 pitches[3];
+} YUV_FRAME;
+
+
+HRESULT ConvertYuvToRgb(
+	_In_ const YUV_FRAME& source,
+	_In_ ColorMatrix matrix,
+	_In_ ColorRange range,
+	_In_ RgbFormat destinationFormat,
+	_Out_ BYTE* pDestination,
+	_In_ UINT32 destinationPitch);
+
+// Kernel ConvertYuvToRgb uses
+ColorConversionKernel GetColorConversionKernel();
+
+bool IsColorConversionKernelSupported(
+	_In_ ColorConversionKernel kernel);
+
+// Overrides the runtime selection, e.g. to compare a kernel with the scalar reference. Fails if the CPU lacks the kernel.
+HRESULT SetColorConversionKernel(
+	_In_ ColorConversionKernel kernel);
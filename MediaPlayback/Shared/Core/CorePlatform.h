@@ -0,0 +1,103 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Minimal platform layer for the portable playback core.
+// On Windows it maps to the SDK types, elsewhere it provides just enough of them (HRESULT, fixed size integers, SAL)
+// so the core keeps the same conventions as the rest of the plugin.
+
+#include <chrono>
+#include <stdint.h>
+
+#if defined(_WIN32)
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+
+#else // !_WIN32
+
+typedef int32_t HRESULT;
+typedef uint8_t byte;
+typedef uint8_t BYTE;
+typedef int32_t BOOL;
+typedef uint16_t UINT16;
+typedef uint32_t UINT;
+typedef int32_t INT32;
+typedef uint32_t UINT32;
+typedef int64_t INT64;
+typedef uint64_t UINT64;
+typedef int64_t LONGLONG;
+typedef uint32_t DWORD;
+typedef double DOUBLE;
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#define S_OK                    ((HRESULT)0x00000000L)
+#define S_FALSE                 ((HRESULT)0x00000001L)
+#define E_NOTIMPL               ((HRESULT)0x80004001L)
+#define E_POINTER               ((HRESULT)0x80004003L)
+#define E_ABORT                 ((HRESULT)0x80004004L)
+#define E_FAIL                  ((HRESULT)0x80004005L)
+#define E_UNEXPECTED            ((HRESULT)0x8000FFFFL)
+#define E_BOUNDS                ((HRESULT)0x8000000BL)
+#define E_ILLEGAL_METHOD_CALL   ((HRESULT)0x8000000EL)
+#define E_OUTOFMEMORY           ((HRESULT)0x8007000EL)
+#define E_NOT_SUFFICIENT_BUFFER ((HRESULT)0x8007007AL)
+#define E_INVALIDARG            ((HRESULT)0x80070057L)
+
+#define ERROR_FILE_NOT_FOUND    2L
+#define ERROR_INVALID_DATA      13L
+#define ERROR_HANDLE_EOF        38L
+#define ERROR_CANCELLED         1223L
+#define HRESULT_FROM_WIN32(x)   ((HRESULT)(x) <= 0 ? ((HRESULT)(x)) : ((HRESULT) (((x) & 0x0000FFFF) | (7 << 16) | 0x80000000)))
+
+#define SUCCEEDED(hr)           (((HRESULT)(hr)) >= 0)
+#define FAILED(hr)              (((HRESULT)(hr)) < 0)
+
+// SAL annotations are only meaningful to the MSVC code analysis
+#define _In_
+#define _In_opt_
+#define _In_reads_(size)
+#define _Out_
+#define _Out_opt_
+#define _Out_writes_(size)
+#define _Out_writes_to_(size, count)
+#define _Inout_
+#define _Outptr_
+#define _Outptr_opt_
+#define _COM_Outptr_
+#define _Use_decl_annotations_
+
+#endif // _WIN32
+
+#ifndef IFR
+#define IFR(hrToCheck) { HRESULT __hrCore = (hrToCheck); if (FAILED(__hrCore)) { return __hrCore; } }
+#endif
+
+#ifndef NULL_CHK
+#define NULL_CHK(pointer) if (nullptr == (pointer)) { return E_INVALIDARG; }
+#endif
+
+// Monotonic time in 100ns units, the clock of every timestamp and interval the core keeps
+inline INT64 CoreNow()
+{
+	return (INT64)std::chrono::duration_cast<std::chrono::duration<INT64, std::ratio<1, 10000000>>>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
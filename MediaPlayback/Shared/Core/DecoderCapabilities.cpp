@@ -0,0 +1,343 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "DecoderCapabilities.h"
+#include "FileSystem.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <sstream>
+
+#define _CapabilitiesHeader_ "# MediaPlayback decoder capabilities 1"
+#define _DriverPrefix_ "driver "
+
+#define _H264High10Profile_ 110
+#define _H264High422Profile_ 122
+#define _H264High444Profile_ 244
+#define _HevcMain10Profile_ 2
+
+
+static const struct
+{
+	VideoCodec codec;
+	const char* name;
+} c_codecNames[] =
+{
+	{ VideoCodec::VideoCodec_H264, "h264" },
+	{ VideoCodec::VideoCodec_HEVC, "hevc" },
+	{ VideoCodec::VideoCodec_VP9, "vp9" },
+	{ VideoCodec::VideoCodec_AV1, "av1" },
+};
+
+static const char* GetCodecName(VideoCodec codec)
+{
+	for (const auto& entry : c_codecNames)
+	{
+		if (entry.codec == codec)
+			return entry.name;
+	}
+
+	return nullptr;
+}
+
+static VideoCodec GetCodecByName(const std::string& name)
+{
+	for (const auto& entry : c_codecNames)
+	{
+		if (name == entry.name)
+			return entry.codec;
+	}
+
+	return VideoCodec::VideoCodec_Unknown;
+}
+
+static std::string ToUtf8(const std::wstring& value)
+{
+	// driver keys are ASCII, anything else is replaced and still compares equal to itself
+	std::string narrow;
+	for (wchar_t c : value)
+	{
+		narrow.push_back((c > 0 && c < 0x80) ? (char)c : '?');
+	}
+
+	return narrow;
+}
+
+// Dot separated field of a codec string, empty if there are fewer fields
+static std::string GetCodecField(const std::string& codec, size_t index)
+{
+	size_t start = 0;
+	for (size_t i = 0; i < index; i++)
+	{
+		start = codec.find('.', start);
+		if (start == std::string::npos)
+			return std::string();
+		start++;
+	}
+
+	size_t end = codec.find('.', start);
+	return codec.substr(start, (end == std::string::npos) ? std::string::npos : end - start);
+}
+
+static UINT32 ParseCodecNumber(const std::string& field, int base)
+{
+	// HEVC profiles carry their profile space as a letter prefix (hvc1.A1...)
+	size_t start = 0;
+	while (start < field.size() && base == 10 && (field[start] < '0' || field[start] > '9'))
+	{
+		start++;
+	}
+
+	return (UINT32)strtoul(field.c_str() + start, nullptr, base);
+}
+
+static bool ParseCodec(const std::string& codec, RENDITION_INFO* pRendition)
+{
+	std::string fourcc = codec.substr(0, codec.find('.'));
+
+	if (fourcc == "avc1" || fourcc == "avc3")
+	{
+		// avc1.PPCCLL, hexadecimal profile_idc
+		UINT32 profile = ParseCodecNumber(GetCodecField(codec, 1).substr(0, 2), 16);
+
+		pRendition->codec = VideoCodec::VideoCodec_H264;
+		pRendition->profile = profile;
+		pRendition->bitDepth = (profile == _H264High10Profile_ || profile == _H264High422Profile_ || profile == _H264High444Profile_) ? 10 : 8;
+		return true;
+	}
+
+	if (fourcc == "hvc1" || fourcc == "hev1" || fourcc == "dvh1" || fourcc == "dvhe")
+	{
+		// hvc1.P.C.T.L..., Dolby Vision profiles are 10-bit HEVC
+		UINT32 profile = (fourcc[0] == 'd') ? _HevcMain10Profile_ : ParseCodecNumber(GetCodecField(codec, 1), 10);
+
+		pRendition->codec = VideoCodec::VideoCodec_HEVC;
+		pRendition->profile = profile;
+		pRendition->bitDepth = (profile == 1) ? 8 : 10;
+		return true;
+	}
+
+	if (fourcc == "vp09" || fourcc == "vp9")
+	{
+		// vp09.PP.LL.DD...
+		std::string bitDepth = GetCodecField(codec, 3);
+
+		pRendition->codec = VideoCodec::VideoCodec_VP9;
+		pRendition->profile = ParseCodecNumber(GetCodecField(codec, 1), 10);
+		pRendition->bitDepth = bitDepth.empty() ? 8 : ParseCodecNumber(bitDepth, 10);
+		return true;
+	}
+
+	if (fourcc == "av01")
+	{
+		// av01.P.LLT.DD...
+		std::string bitDepth = GetCodecField(codec, 3);
+
+		pRendition->codec = VideoCodec::VideoCodec_AV1;
+		pRendition->profile = ParseCodecNumber(GetCodecField(codec, 1), 10);
+		pRendition->bitDepth = bitDepth.empty() ? 8 : ParseCodecNumber(bitDepth, 10);
+		return true;
+	}
+
+	return false;
+}
+
+
+_Use_decl_annotations_
+void CDecoderCapabilities::Add(const DECODER_CAPABILITY& capability)
+{
+	m_capabilities.push_back(capability);
+}
+
+_Use_decl_annotations_
+bool CDecoderCapabilities::CanDecode(const RENDITION_INFO& rendition) const
+{
+	VideoCodec codec = rendition.codec;
+	UINT32 bitDepth = rendition.bitDepth;
+	if (codec == VideoCodec::VideoCodec_Unknown)
+	{
+		codec = VideoCodec::VideoCodec_H264;
+		bitDepth = 8;
+	}
+
+	for (const DECODER_CAPABILITY& capability : m_capabilities)
+	{
+		if (capability.codec != codec)
+			continue;
+
+		if (capability.profile != 0 && rendition.profile != 0 && capability.profile != rendition.profile)
+			continue;
+
+		if (bitDepth > capability.bitDepth)
+			continue;
+
+		// portrait renditions fit a decoder of the same area
+		bool fits = (rendition.width <= capability.maxWidth && rendition.height <= capability.maxHeight) ||
+			(rendition.width <= capability.maxHeight && rendition.height <= capability.maxWidth);
+		if (!fits)
+			continue;
+
+		if (capability.maxFrameRate != 0 && rendition.frameRate > capability.maxFrameRate)
+			continue;
+
+		return true;
+	}
+
+	return false;
+}
+
+std::string CDecoderCapabilities::Serialize() const
+{
+	std::ostringstream text;
+
+	for (const DECODER_CAPABILITY& capability : m_capabilities)
+	{
+		const char* name = GetCodecName(capability.codec);
+		if (!name)
+			continue;
+
+		text << name << ' ' << capability.profile << ' ' << capability.bitDepth << ' '
+			<< capability.maxWidth << 'x' << capability.maxHeight << ' ' << capability.maxFrameRate << '\n';
+	}
+
+	return text.str();
+}
+
+_Use_decl_annotations_
+HRESULT CDecoderCapabilities::Parse(const std::string& text)
+{
+	std::vector<DECODER_CAPABILITY> capabilities;
+
+	std::istringstream lines(text);
+	std::string line;
+	while (std::getline(lines, line))
+	{
+		if (line.empty() || line[0] == '#' || line.compare(0, strlen(_DriverPrefix_), _DriverPrefix_) == 0)
+			continue;
+
+		std::string name;
+		std::string size;
+		DECODER_CAPABILITY capability;
+
+		std::istringstream values(line);
+		if (!(values >> name >> capability.profile >> capability.bitDepth >> size >> capability.maxFrameRate))
+			return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+		capability.codec = GetCodecByName(name);
+
+		size_t separator = size.find('x');
+		if (capability.codec == VideoCodec::VideoCodec_Unknown || separator == std::string::npos)
+			return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+		capability.maxWidth = (UINT32)strtoul(size.c_str(), nullptr, 10);
+		capability.maxHeight = (UINT32)strtoul(size.c_str() + separator + 1, nullptr, 10);
+
+		capabilities.push_back(capability);
+	}
+
+	m_capabilities.swap(capabilities);
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CDecoderCapabilities::Load(const std::wstring& path, const std::wstring& driverKey)
+{
+	std::vector<BYTE> data;
+	if (FAILED(ReadWholeFile(path, &data)))
+		return S_FALSE;
+
+	std::string text(data.begin(), data.end());
+	std::string expected = std::string(_CapabilitiesHeader_) + "\n" + _DriverPrefix_ + ToUtf8(driverKey) + "\n";
+
+	// probed with another driver (or by another version of the plugin), probe again
+	if (text.compare(0, expected.size(), expected) != 0)
+		return S_FALSE;
+
+	// a damaged file is not worth failing for either
+	return SUCCEEDED(Parse(text.substr(expected.size()))) ? S_OK : S_FALSE;
+}
+
+_Use_decl_annotations_
+HRESULT CDecoderCapabilities::Save(const std::wstring& path, const std::wstring& driverKey) const
+{
+	std::string text = std::string(_CapabilitiesHeader_) + "\n" + _DriverPrefix_ + ToUtf8(driverKey) + "\n" + Serialize();
+
+	// other processes of the same app may read it meanwhile
+	std::wstring tempPath = path + L".tmp";
+	IFR(WriteWholeFile(tempPath, (const BYTE*)text.data(), text.size()));
+
+	HRESULT hr = CommitFile(tempPath, path);
+	if (FAILED(hr))
+		RemoveFile(tempPath);
+
+	return hr;
+}
+
+
+_Use_decl_annotations_
+bool ParseCodecList(const std::string& codecs, RENDITION_INFO* pRendition)
+{
+	size_t start = 0;
+	while (start <= codecs.size())
+	{
+		size_t end = codecs.find(',', start);
+		if (end == std::string::npos)
+			end = codecs.size();
+
+		std::string codec = codecs.substr(start, end - start);
+		size_t first = codec.find_first_not_of(" \t");
+		size_t last = codec.find_last_not_of(" \t");
+
+		if (first != std::string::npos && ParseCodec(codec.substr(first, last - first + 1), pRendition))
+			return true;
+
+		start = end + 1;
+	}
+
+	return false;
+}
+
+_Use_decl_annotations_
+VideoCodec GetVideoCodecFromSubtype(const std::wstring& subtype)
+{
+	std::string name;
+	for (wchar_t c : subtype)
+	{
+		name.push_back((c >= L'a' && c <= L'z') ? (char)(c - L'a' + 'A') : (char)c);
+	}
+
+	if (name == "H264" || name == "AVC1")
+		return VideoCodec::VideoCodec_H264;
+	if (name == "HEVC" || name == "HVC1" || name == "HEV1")
+		return VideoCodec::VideoCodec_HEVC;
+	if (name == "VP9" || name == "VP90")
+		return VideoCodec::VideoCodec_VP9;
+	if (name == "AV1" || name == "AV01")
+		return VideoCodec::VideoCodec_AV1;
+
+	return VideoCodec::VideoCodec_Unknown;
+}
+
+_Use_decl_annotations_
+std::vector<RENDITION_INFO> FilterRenditions(const CDecoderCapabilities& capabilities, const std::vector<RENDITION_INFO>& renditions)
+{
+	std::vector<RENDITION_INFO> decodable;
+
+	for (const RENDITION_INFO& rendition : renditions)
+	{
+		if (capabilities.CanDecode(rendition))
+			decodable.push_back(rendition);
+	}
+
+	return decodable;
+}
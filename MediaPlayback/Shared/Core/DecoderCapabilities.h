@@ -0,0 +1,94 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// What the hardware video decoders of an adapter handle: codec, profile, bit depth, max resolution and frame rate.
+//
+// The plugin probes the D3D11 video device once per adapter and driver and keeps the result on disk (Save/Load),
+// keyed by the driver, so later sessions skip the probe. Renditions of adaptive streams are checked against it
+// before playback starts. Nothing here talks to D3D, synthetic capability sets work the same as probed ones.
+
+#include "CorePlatform.h"
+
+#include <string>
+#include <vector>
+
+
+enum class VideoCodec : UINT32
+{
+	VideoCodec_Unknown = 0,
+	VideoCodec_H264,
+	VideoCodec_HEVC,
+	VideoCodec_VP9,
+	VideoCodec_AV1
+};
+
+typedef struct _DECODER_CAPABILITY
+{
+	VideoCodec codec;
+	UINT32 profile;				// H.264 profile_idc, HEVC general_profile_idc, VP9/AV1 profile; 0 for every profile of the codec
+	UINT32 bitDepth;			// highest bit depth, lower ones are decoded as well
+	UINT32 maxWidth;
+	UINT32 maxHeight;
+	UINT32 maxFrameRate;		// 0 if not known, D3D11 does not report it
+} DECODER_CAPABILITY;
+
+// A video rendition as a manifest describes it, 0 and VideoCodec_Unknown where the manifest does not tell
+typedef struct _RENDITION_INFO
+{
+	UINT32 bitrate;
+	UINT32 width;
+	UINT32 height;
+	UINT32 frameRate;			// rounded up
+	VideoCodec codec;
+	UINT32 profile;
+	UINT32 bitDepth;
+} RENDITION_INFO;
+
+
+class CDecoderCapabilities
+{
+public:
+	void Add(_In_ const DECODER_CAPABILITY& capability);
+	const std::vector<DECODER_CAPABILITY>& GetCapabilities() const { return m_capabilities; }
+	bool IsEmpty() const { return m_capabilities.empty(); }
+
+	// Renditions of an unknown codec are taken for 8-bit H.264, unknown sizes and frame rates always fit
+	bool CanDecode(_In_ const RENDITION_INFO& rendition) const;
+
+	// One "<codec> <profile> <bitDepth> <maxWidth>x<maxHeight> <maxFrameRate>" line per capability
+	std::string Serialize() const;
+	HRESULT Parse(_In_ const std::string& text);
+
+	// S_FALSE if the file is missing, damaged or was written for another driver
+	HRESULT Load(_In_ const std::wstring& path, _In_ const std::wstring& driverKey);
+	HRESULT Save(_In_ const std::wstring& path, _In_ const std::wstring& driverKey) const;
+
+private:
+	std::vector<DECODER_CAPABILITY> m_capabilities;
+};
+
+
+// Fills codec, profile and bitDepth from the first video codec of an RFC 6381 list ("avc1.640028,mp4a.40.2").
+// Returns false if the list has no video codec this recognizes.
+bool ParseCodecList(
+	_In_ const std::string& codecs,
+	_Inout_ RENDITION_INFO* pRendition);
+
+// Media Foundation video subtypes as VideoEncodingProperties report them ("H264", "HEVC", "VP9", "AV1")
+VideoCodec GetVideoCodecFromSubtype(
+	_In_ const std::wstring& subtype);
+
+// The renditions the capabilities decode, in their original order
+std::vector<RENDITION_INFO> FilterRenditions(
+	_In_ const CDecoderCapabilities& capabilities,
+	_In_ const std::vector<RENDITION_INFO>& renditions);
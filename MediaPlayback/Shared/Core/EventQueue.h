@@ -0,0 +1,110 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Bounded lock-free multi-producer/single-consumer queue of POD records.
+//
+// Every cell carries a sequence number telling whose turn it is: producers claim a position with a CAS
+// and publish the cell by bumping its sequence, the consumer frees it by bumping it again by the capacity.
+// Push() never blocks and never allocates; it fails when the queue is full.
+
+#include "CorePlatform.h"
+
+#include <array>
+#include <atomic>
+
+
+template <typename T, UINT32 Capacity>
+class CEventQueue
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "CEventQueue capacity must be a power of 2");
+
+public:
+	CEventQueue()
+		: m_enqueuePosition(0)
+		, m_dequeuePosition(0)
+	{
+		for (UINT32 i = 0; i < Capacity; i++)
+		{
+			m_cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	static UINT32 GetCapacity() { return Capacity; }
+
+	// Any thread. Returns false if the queue is full.
+	bool Push(_In_ const T& value)
+	{
+		UINT64 position = m_enqueuePosition.load(std::memory_order_relaxed);
+		CELL* pCell = nullptr;
+
+		for (;;)
+		{
+			pCell = &m_cells[position & (Capacity - 1)];
+			INT64 difference = (INT64)pCell->sequence.load(std::memory_order_acquire) - (INT64)position;
+
+			if (difference == 0)
+			{
+				if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (difference < 0)
+			{
+				return false; // the consumer has not freed this cell yet
+			}
+			else
+			{
+				position = m_enqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		pCell->value = value;
+		pCell->sequence.store(position + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	// Consumer thread only. Returns false if there is nothing to take.
+	bool Pop(_Out_ T* pValue)
+	{
+		UINT64 position = m_dequeuePosition.load(std::memory_order_relaxed);
+		CELL* pCell = &m_cells[position & (Capacity - 1)];
+
+		if ((INT64)pCell->sequence.load(std::memory_order_acquire) - (INT64)(position + 1) < 0)
+			return false;
+
+		*pValue = pCell->value;
+		pCell->sequence.store(position + Capacity, std::memory_order_release);
+		m_dequeuePosition.store(position + 1, std::memory_order_relaxed);
+
+		return true;
+	}
+
+	// Approximate while producers are running
+	UINT32 GetDepth() const
+	{
+		UINT64 dequeued = m_dequeuePosition.load(std::memory_order_relaxed);
+		UINT64 enqueued = m_enqueuePosition.load(std::memory_order_relaxed);
+		return enqueued > dequeued ? (UINT32)(enqueued - dequeued) : 0;
+	}
+
+private:
+	typedef struct _CELL
+	{
+		std::atomic<UINT64> sequence;
+		T value;
+	} CELL;
+
+	std::array<CELL, Capacity> m_cells;
+	std::atomic<UINT64> m_enqueuePosition;
+	std::atomic<UINT64> m_dequeuePosition;
+};
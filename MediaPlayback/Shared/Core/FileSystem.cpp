@@ -0,0 +1,452 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "FileSystem.h"
+
+#if !defined(_WIN32)
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+#if defined(_WIN32)
+
+_Use_decl_annotations_
+HRESULT CreateDirectoryIfMissing(const std::wstring& path)
+{
+	if (CreateDirectoryW(path.c_str(), nullptr) || GetLastError() == ERROR_ALREADY_EXISTS)
+		return S_OK;
+
+	return HRESULT_FROM_WIN32(GetLastError());
+}
+
+_Use_decl_annotations_
+HRESULT WriteWholeFile(const std::wstring& path, const BYTE* pData, UINT64 size)
+{
+	HANDLE hFile = CreateFile2(path.c_str(), GENERIC_WRITE, 0, CREATE_ALWAYS, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return HRESULT_FROM_WIN32(GetLastError());
+
+	HRESULT hr = S_OK;
+
+	while (size > 0 && SUCCEEDED(hr))
+	{
+		DWORD chunk = (DWORD)(size < 0x40000000ull ? size : 0x40000000ull);
+		DWORD written = 0;
+		if (!WriteFile(hFile, pData, chunk, &written, nullptr) || written != chunk)
+			hr = HRESULT_FROM_WIN32(GetLastError());
+
+		pData += chunk;
+		size -= chunk;
+	}
+
+	// the data must be on disk before the rename publishes the file
+	if (SUCCEEDED(hr) && !FlushFileBuffers(hFile))
+		hr = HRESULT_FROM_WIN32(GetLastError());
+
+	CloseHandle(hFile);
+
+	return hr;
+}
+
+_Use_decl_annotations_
+HRESULT ReadWholeFile(const std::wstring& path, std::vector<BYTE>* pData)
+{
+	HANDLE hFile = CreateFile2(path.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return HRESULT_FROM_WIN32(GetLastError());
+
+	HRESULT hr = S_OK;
+
+	LARGE_INTEGER size = {};
+	if (!GetFileSizeEx(hFile, &size) || size.QuadPart > 0x40000000ll)
+	{
+		hr = E_FAIL;
+	}
+	else
+	{
+		pData->resize((size_t)size.QuadPart);
+
+		DWORD read = 0;
+		if (size.QuadPart > 0 && (!ReadFile(hFile, pData->data(), (DWORD)size.QuadPart, &read, nullptr) || read != (DWORD)size.QuadPart))
+			hr = E_FAIL;
+	}
+
+	CloseHandle(hFile);
+
+	return hr;
+}
+
+_Use_decl_annotations_
+HRESULT CommitFile(const std::wstring& from, const std::wstring& to)
+{
+	if (MoveFileExW(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+		return S_OK;
+
+	return HRESULT_FROM_WIN32(GetLastError());
+}
+
+_Use_decl_annotations_
+void RemoveFile(const std::wstring& path)
+{
+	DeleteFileW(path.c_str());
+}
+
+_Use_decl_annotations_
+HRESULT GetFileSizeAt(const std::wstring& path, UINT64* pSize)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data = {};
+	if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data))
+		return HRESULT_FROM_WIN32(GetLastError());
+
+	*pSize = ((UINT64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+void ListFiles(const std::wstring& directory, std::vector<std::wstring>* pNames)
+{
+	WIN32_FIND_DATAW data = {};
+	HANDLE hFind = FindFirstFileExW((directory + L"\\*").c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, nullptr, 0);
+	if (hFind == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+			pNames->push_back(data.cFileName);
+	} while (FindNextFileW(hFind, &data));
+
+	FindClose(hFind);
+}
+
+CFileReader::CFileReader()
+	: m_hFile(INVALID_HANDLE_VALUE)
+	, m_size(0)
+	, m_lastWriteTime(0)
+{
+}
+
+void CFileReader::Close()
+{
+	if (m_hFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+}
+
+_Use_decl_annotations_
+HRESULT CFileReader::Open(const std::wstring& path)
+{
+	Close();
+
+	// the file may be written meanwhile, e.g. by a download still in progress
+	m_hFile = CreateFile2(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, OPEN_EXISTING, nullptr);
+	if (m_hFile == INVALID_HANDLE_VALUE)
+		return HRESULT_FROM_WIN32(GetLastError());
+
+	FILE_BASIC_INFO basicInfo = {};
+	FILE_STANDARD_INFO standardInfo = {};
+	if (!GetFileInformationByHandleEx(m_hFile, FileBasicInfo, &basicInfo, sizeof(basicInfo)) ||
+		!GetFileInformationByHandleEx(m_hFile, FileStandardInfo, &standardInfo, sizeof(standardInfo)))
+	{
+		HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+		Close();
+		return hr;
+	}
+
+	m_size = (UINT64)standardInfo.EndOfFile.QuadPart;
+	m_lastWriteTime = basicInfo.LastWriteTime.QuadPart;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CFileReader::Read(UINT64 offset, BYTE* pBuffer, UINT32 size)
+{
+	NULL_CHK(pBuffer);
+
+	if (m_hFile == INVALID_HANDLE_VALUE)
+		return E_ILLEGAL_METHOD_CALL;
+
+	if (offset > m_size || size > m_size - offset)
+		return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+
+	OVERLAPPED overlapped = {};
+	overlapped.Offset = (DWORD)offset;
+	overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+	DWORD bytesRead = 0;
+	if (!ReadFile(m_hFile, pBuffer, size, &bytesRead, &overlapped))
+		return HRESULT_FROM_WIN32(GetLastError());
+
+	return (bytesRead == size) ? S_OK : HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+}
+
+#else // !_WIN32
+
+_Use_decl_annotations_
+std::string ToNativePath(const std::wstring& path)
+{
+	std::string utf8;
+	utf8.reserve(path.size());
+
+	for (wchar_t c : path)
+	{
+		UINT32 cp = (UINT32)c;
+		if (cp < 0x80)
+		{
+			utf8.push_back((char)cp);
+		}
+		else if (cp < 0x800)
+		{
+			utf8.push_back((char)(0xC0 | (cp >> 6)));
+			utf8.push_back((char)(0x80 | (cp & 0x3F)));
+		}
+		else if (cp < 0x10000)
+		{
+			utf8.push_back((char)(0xE0 | (cp >> 12)));
+			utf8.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+			utf8.push_back((char)(0x80 | (cp & 0x3F)));
+		}
+		else
+		{
+			utf8.push_back((char)(0xF0 | (cp >> 18)));
+			utf8.push_back((char)(0x80 | ((cp >> 12) & 0x3F)));
+			utf8.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+			utf8.push_back((char)(0x80 | (cp & 0x3F)));
+		}
+	}
+
+	return utf8;
+}
+
+HRESULT ErrnoToHResult()
+{
+	return (errno == ENOENT) ? HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) : E_FAIL;
+}
+
+_Use_decl_annotations_
+HRESULT CreateDirectoryIfMissing(const std::wstring& path)
+{
+	if (mkdir(ToNativePath(path).c_str(), 0755) == 0 || errno == EEXIST)
+		return S_OK;
+
+	return ErrnoToHResult();
+}
+
+_Use_decl_annotations_
+HRESULT WriteWholeFile(const std::wstring& path, const BYTE* pData, UINT64 size)
+{
+	int fd = open(ToNativePath(path).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0)
+		return ErrnoToHResult();
+
+	HRESULT hr = S_OK;
+
+	while (size > 0)
+	{
+		ssize_t written = write(fd, pData, (size_t)(size < 0x40000000ull ? size : 0x40000000ull));
+		if (written < 0 && errno == EINTR)
+			continue;
+
+		if (written <= 0)
+		{
+			hr = E_FAIL;
+			break;
+		}
+
+		pData += written;
+		size -= (UINT64)written;
+	}
+
+	// the data must be on disk before the rename publishes the file
+	if (SUCCEEDED(hr) && fsync(fd) != 0)
+		hr = E_FAIL;
+
+	close(fd);
+
+	return hr;
+}
+
+_Use_decl_annotations_
+HRESULT ReadWholeFile(const std::wstring& path, std::vector<BYTE>* pData)
+{
+	int fd = open(ToNativePath(path).c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return ErrnoToHResult();
+
+	HRESULT hr = S_OK;
+
+	struct stat info = {};
+	if (fstat(fd, &info) != 0 || info.st_size > 0x40000000ll)
+	{
+		hr = E_FAIL;
+	}
+	else
+	{
+		pData->resize((size_t)info.st_size);
+
+		size_t offset = 0;
+		while (offset < pData->size())
+		{
+			ssize_t bytesRead = read(fd, pData->data() + offset, pData->size() - offset);
+			if (bytesRead < 0 && errno == EINTR)
+				continue;
+
+			if (bytesRead <= 0)
+			{
+				hr = E_FAIL;
+				break;
+			}
+
+			offset += (size_t)bytesRead;
+		}
+	}
+
+	close(fd);
+
+	return hr;
+}
+
+_Use_decl_annotations_
+HRESULT CommitFile(const std::wstring& from, const std::wstring& to)
+{
+	if (rename(ToNativePath(from).c_str(), ToNativePath(to).c_str()) == 0)
+		return S_OK;
+
+	return ErrnoToHResult();
+}
+
+_Use_decl_annotations_
+void RemoveFile(const std::wstring& path)
+{
+	unlink(ToNativePath(path).c_str());
+}
+
+_Use_decl_annotations_
+HRESULT GetFileSizeAt(const std::wstring& path, UINT64* pSize)
+{
+	struct stat info = {};
+	if (stat(ToNativePath(path).c_str(), &info) != 0)
+		return ErrnoToHResult();
+
+	*pSize = (UINT64)info.st_size;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+void ListFiles(const std::wstring& directory, std::vector<std::wstring>* pNames)
+{
+	DIR* pDir = opendir(ToNativePath(directory).c_str());
+	if (!pDir)
+		return;
+
+	while (struct dirent* pEntry = readdir(pDir))
+	{
+		// the names the cache creates are ASCII, anything else is skipped by the callers anyway
+		std::wstring name;
+		for (const char* p = pEntry->d_name; *p; p++)
+		{
+			name.push_back((wchar_t)(unsigned char)*p);
+		}
+
+		if (name != L"." && name != L"..")
+			pNames->push_back(name);
+	}
+
+	closedir(pDir);
+}
+
+CFileReader::CFileReader()
+	: m_fd(-1)
+	, m_size(0)
+	, m_lastWriteTime(0)
+{
+}
+
+void CFileReader::Close()
+{
+	if (m_fd >= 0)
+	{
+		close(m_fd);
+		m_fd = -1;
+	}
+}
+
+_Use_decl_annotations_
+HRESULT CFileReader::Open(const std::wstring& path)
+{
+	Close();
+
+	m_fd = open(ToNativePath(path).c_str(), O_RDONLY | O_CLOEXEC);
+	if (m_fd < 0)
+		return ErrnoToHResult();
+
+	struct stat info = {};
+	if (fstat(m_fd, &info) != 0)
+	{
+		HRESULT hr = ErrnoToHResult();
+		Close();
+		return hr;
+	}
+
+	m_size = (UINT64)info.st_size;
+	m_lastWriteTime = (INT64)info.st_mtime * 10000000ll;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CFileReader::Read(UINT64 offset, BYTE* pBuffer, UINT32 size)
+{
+	NULL_CHK(pBuffer);
+
+	if (m_fd < 0)
+		return E_ILLEGAL_METHOD_CALL;
+
+	if (offset > m_size || size > m_size - offset)
+		return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+
+	UINT32 done = 0;
+	while (done < size)
+	{
+		ssize_t bytesRead = pread(m_fd, pBuffer + done, size - done, (off_t)(offset + done));
+		if (bytesRead < 0 && errno == EINTR)
+			continue;
+
+		if (bytesRead < 0)
+			return ErrnoToHResult();
+
+		// truncated since it was opened
+		if (bytesRead == 0)
+			return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+
+		done += (UINT32)bytesRead;
+	}
+
+	return S_OK;
+}
+
+
+#endif // _WIN32
+
+
+CFileReader::~CFileReader()
+{
+	Close();
+}
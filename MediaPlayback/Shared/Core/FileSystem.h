@@ -0,0 +1,94 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// File system helpers of the on-disk caches and the container parsers. Paths are wide on every platform and
+// converted to UTF-8 outside Windows.
+
+#include "CorePlatform.h"
+
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#define _PathSeparator_ L'\\'
+#else
+#define _PathSeparator_ L'/'
+#endif
+
+
+HRESULT CreateDirectoryIfMissing(_In_ const std::wstring& path);
+
+// Flushed to disk before returning, so a CommitFile of it afterwards never publishes a torn file
+HRESULT WriteWholeFile(_In_ const std::wstring& path, _In_ const BYTE* pData, _In_ UINT64 size);
+
+// Files of 1GB and more are refused
+HRESULT ReadWholeFile(_In_ const std::wstring& path, _Out_ std::vector<BYTE>* pData);
+
+// Renames from to to, replacing to
+HRESULT CommitFile(_In_ const std::wstring& from, _In_ const std::wstring& to);
+
+void RemoveFile(_In_ const std::wstring& path);
+
+HRESULT GetFileSizeAt(_In_ const std::wstring& path, _Out_ UINT64* pSize);
+
+// Names of the files in directory, without subdirectories
+void ListFiles(_In_ const std::wstring& directory, _Inout_ std::vector<std::wstring>* pNames);
+
+
+// Random access to the bytes of a file or a buffer, for parsers that walk a container without loading it
+struct IByteSource
+{
+	virtual ~IByteSource() {}
+
+	virtual UINT64 GetSize() const = 0;
+
+	// Fails with HRESULT_FROM_WIN32(ERROR_HANDLE_EOF) if fewer than size bytes follow offset
+	virtual HRESULT Read(_In_ UINT64 offset, _Out_writes_(size) BYTE* pBuffer, _In_ UINT32 size) = 0;
+};
+
+class CFileReader
+	: public IByteSource
+{
+public:
+	CFileReader();
+	virtual ~CFileReader();
+
+	HRESULT Open(_In_ const std::wstring& path);
+
+	// Tells versions of a file apart, the epoch depends on the platform
+	INT64 GetLastWriteTime() const { return m_lastWriteTime; }
+
+	// IByteSource
+	virtual UINT64 GetSize() const override { return m_size; }
+	virtual HRESULT Read(_In_ UINT64 offset, _Out_writes_(size) BYTE* pBuffer, _In_ UINT32 size) override;
+
+private:
+	CFileReader(const CFileReader&) = delete;
+	CFileReader& operator=(const CFileReader&) = delete;
+
+	void Close();
+
+#if defined(_WIN32)
+	HANDLE m_hFile;
+#else
+	int m_fd;
+#endif
+	UINT64 m_size;
+	INT64 m_lastWriteTime;
+};
+
+
+#if !defined(_WIN32)
+std::string ToNativePath(_In_ const std::wstring& path);
+HRESULT ErrnoToHResult();
+#endif
@@ -0,0 +1,218 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Cache of recently presented video frames keyed by presentation time, so stepping back and short rewinds are served
+// without the decoder seeking back to the previous keyframe and decoding its way up to the position again.
+//
+// Frames are kept in presentation order with the time they are on screen; a lookup hits the frame that is on screen
+// at the position. Once the cached bytes exceed the budget, the frames farthest from the playhead (the position of
+// the last frame put or hit) are evicted first, so the cache holds a window around it in both directions.
+// A budget of 0 disables the cache.
+//
+// TFrame is whatever holds a copy of a frame (a set of D3D11 textures, a CPU buffer, ...); it must be copyable,
+// e.g. a COM or shared pointer, and release its resources when destroyed. Thread safe.
+
+#include "PlaybackTypes.h"
+
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#define _DefaultFrameCacheBudget_ (64ULL * 1024 * 1024)
+
+
+template <typename TFrame>
+class CFrameCache
+{
+public:
+	explicit CFrameCache(_In_ UINT64 budgetBytes = _DefaultFrameCacheBudget_)
+		: m_budgetBytes(budgetBytes)
+		, m_cachedBytes(0)
+		, m_playhead(0)
+		, m_hits(0)
+		, m_misses(0)
+		, m_evictions(0)
+	{
+	}
+
+	bool IsEnabled() const
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		return m_budgetBytes != 0;
+	}
+
+	// Makes room for a frame of sizeBytes at position before it is copied. Hands out an evicted frame of that size
+	// to copy into instead of allocating one, returns false if none was evicted.
+	bool Reclaim(_In_ INT64 position, _In_ UINT64 sizeBytes, _Out_ TFrame* pFrame)
+	{
+		std::vector<TFrame> evicted;
+		bool reclaimed = false;
+
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		if (sizeBytes > m_budgetBytes)
+			return false;
+
+		m_playhead = position;
+
+		while (m_cachedBytes + sizeBytes > m_budgetBytes && !m_entries.empty())
+		{
+			auto it = GetFarthest();
+
+			if (!reclaimed && it->second.sizeBytes == sizeBytes)
+			{
+				*pFrame = std::move(it->second.frame);
+				reclaimed = true;
+			}
+			else
+			{
+				evicted.push_back(std::move(it->second.frame));
+			}
+
+			m_cachedBytes -= it->second.sizeBytes;
+			m_entries.erase(it);
+			m_evictions++;
+		}
+
+		// evicted frames are destroyed outside of the lock
+		return reclaimed;
+	}
+
+	// Keeps the frame presented at position for duration, replacing the one cached for the same position
+	void Put(_In_ INT64 position, _In_ INT64 duration, _In_ const TFrame& frame, _In_ UINT64 sizeBytes)
+	{
+		std::vector<TFrame> evicted;
+
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		if (sizeBytes > m_budgetBytes || duration <= 0)
+			return;
+
+		auto it = m_entries.find(position);
+		if (it != m_entries.end())
+		{
+			m_cachedBytes -= it->second.sizeBytes;
+			evicted.push_back(std::move(it->second.frame));
+			m_entries.erase(it);
+		}
+
+		ENTRY entry = { frame, duration, sizeBytes };
+		m_entries.insert(std::make_pair(position, std::move(entry)));
+		m_cachedBytes += sizeBytes;
+		m_playhead = position;
+
+		Trim(&evicted);
+	}
+
+	// Hit if a cached frame is on screen at position, pFramePosition receives the position that frame was put for
+	bool Lookup(_In_ INT64 position, _Out_ TFrame* pFrame, _Out_opt_ INT64* pFramePosition)
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		auto it = m_entries.upper_bound(position);
+		if (it == m_entries.begin() || position >= std::prev(it)->first + std::prev(it)->second.duration)
+		{
+			m_misses++;
+			return false;
+		}
+
+		--it;
+
+		*pFrame = it->second.frame;
+		if (pFramePosition)
+			*pFramePosition = it->first;
+
+		m_playhead = it->first;
+		m_hits++;
+
+		return true;
+	}
+
+	void SetBudget(_In_ UINT64 budgetBytes)
+	{
+		std::vector<TFrame> evicted;
+
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_budgetBytes = budgetBytes;
+		Trim(&evicted);
+	}
+
+	// Drops every frame, e.g. when the source, the video size or the device changes
+	void Clear()
+	{
+		EntryMap cleared;
+
+		std::lock_guard<std::mutex> lock(m_lock);
+		cleared.swap(m_entries);
+		m_cachedBytes = 0;
+	}
+
+	void GetStats(_Out_ FRAME_CACHE_STATS* pStats) const
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		pStats->frames = (UINT32)m_entries.size();
+		pStats->cachedBytes = m_cachedBytes;
+		pStats->budgetBytes = m_budgetBytes;
+		pStats->firstPosition = m_entries.empty() ? -1 : m_entries.begin()->first;
+		pStats->lastPosition = m_entries.empty() ? -1 : m_entries.rbegin()->first;
+		pStats->hits = m_hits;
+		pStats->misses = m_misses;
+		pStats->evictions = m_evictions;
+	}
+
+private:
+	typedef struct _ENTRY
+	{
+		TFrame frame;
+		INT64 duration;			// on screen until the next frame
+		UINT64 sizeBytes;
+	} ENTRY;
+
+	typedef std::map<INT64, ENTRY> EntryMap;
+
+	// Called with m_lock held on a non-empty cache; the first or the last frame, whichever is farther from the playhead
+	typename EntryMap::iterator GetFarthest()
+	{
+		auto first = m_entries.begin();
+		auto last = std::prev(m_entries.end());
+
+		return (m_playhead - first->first >= last->first - m_playhead) ? first : last;
+	}
+
+	// Called with m_lock held; moves the frames over the budget to pEvicted
+	void Trim(_Inout_ std::vector<TFrame>* pEvicted)
+	{
+		while (m_cachedBytes > m_budgetBytes && !m_entries.empty())
+		{
+			auto it = GetFarthest();
+
+			m_cachedBytes -= it->second.sizeBytes;
+			pEvicted->push_back(std::move(it->second.frame));
+			m_entries.erase(it);
+			m_evictions++;
+		}
+	}
+
+private:
+	mutable std::mutex m_lock;
+	EntryMap m_entries;
+	UINT64 m_budgetBytes;
+	UINT64 m_cachedBytes;
+	INT64 m_playhead;
+	UINT64 m_hits;
+	UINT64 m_misses;
+	UINT64 m_evictions;
+};
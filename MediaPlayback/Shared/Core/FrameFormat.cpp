@@ -0,0 +1,106 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "FrameFormat.h"
+
+#include <string.h>
+
+
+_Use_decl_annotations_
+FrameFormat SelectFrameFormat(FrameFormat preferredFormat, const FRAME_FORMAT_SUPPORT& support, bool isStereoscopic)
+{
+	if (isStereoscopic)
+		return FrameFormat::FrameFormat_BGRA32;
+
+	switch (preferredFormat)
+	{
+	case FrameFormat::FrameFormat_P010:
+		if (support.p010)
+			return FrameFormat::FrameFormat_P010;
+
+		// 10-bit content is dithered down by the video processor, still cheaper than RGB
+		return support.nv12 ? FrameFormat::FrameFormat_NV12 : FrameFormat::FrameFormat_BGRA32;
+
+	case FrameFormat::FrameFormat_NV12:
+		return support.nv12 ? FrameFormat::FrameFormat_NV12 : FrameFormat::FrameFormat_BGRA32;
+
+	default:
+		return FrameFormat::FrameFormat_BGRA32;
+	}
+}
+
+_Use_decl_annotations_
+HRESULT GetFrameLayout(FrameFormat format, UINT32 width, UINT32 height, FRAME_LAYOUT* pLayout)
+{
+	NULL_CHK(pLayout);
+
+	memset(pLayout, 0, sizeof(FRAME_LAYOUT));
+
+	if (!width || !height || width > _MaxFrameDimension_ || height > _MaxFrameDimension_)
+		return E_INVALIDARG;
+
+	pLayout->format = format;
+
+	switch (format)
+	{
+	case FrameFormat::FrameFormat_BGRA32:
+		pLayout->allocatedWidth = width;
+		pLayout->allocatedHeight = height;
+		pLayout->planeCount = 1;
+		pLayout->planes[0].width = width;
+		pLayout->planes[0].height = height;
+		pLayout->planes[0].bytesPerElement = 4;
+		break;
+
+	case FrameFormat::FrameFormat_NV12:
+	case FrameFormat::FrameFormat_P010:
+	{
+		UINT32 bytesPerSample = (format == FrameFormat::FrameFormat_P010) ? 2 : 1;
+
+		// 4:2:0 needs whole 2x2 blocks
+		pLayout->allocatedWidth = (width + 1) & ~1u;
+		pLayout->allocatedHeight = (height + 1) & ~1u;
+		pLayout->planeCount = 2;
+
+		pLayout->planes[0].width = pLayout->allocatedWidth;
+		pLayout->planes[0].height = pLayout->allocatedHeight;
+		pLayout->planes[0].bytesPerElement = bytesPerSample;
+
+		// interleaved U and V, one element per 2x2 block
+		pLayout->planes[1].width = pLayout->allocatedWidth / 2;
+		pLayout->planes[1].height = pLayout->allocatedHeight / 2;
+		pLayout->planes[1].bytesPerElement = bytesPerSample * 2;
+		break;
+	}
+
+	default:
+		return E_INVALIDARG;
+	}
+
+	UINT64 offset = 0;
+	for (UINT32 i = 0; i < pLayout->planeCount; i++)
+	{
+		FRAME_PLANE& plane = pLayout->planes[i];
+		plane.pitch = plane.width * plane.bytesPerElement;
+		plane.offset = offset;
+		offset += (UINT64)plane.pitch * plane.height;
+	}
+
+	pLayout->sizeBytes = offset;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+bool IsNativeFrameFormat(FrameFormat format)
+{
+	return format == FrameFormat::FrameFormat_NV12 || format == FrameFormat::FrameFormat_P010;
+}
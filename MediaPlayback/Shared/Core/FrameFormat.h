@@ -0,0 +1,66 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Which FrameFormat a player renders to, and how the planes of a frame of that format are laid out.
+//
+// NV12 and P010 textures must have even dimensions, so frames of odd sizes are allocated one pixel wider/taller
+// and the video processor scales the frame to the allocated size.
+
+#include "PlaybackTypes.h"
+
+#define _MaxFramePlanes_ 2
+#define _MaxFrameDimension_ 65536		// beyond any texture (stacked eyes included), keeps pitches and rounding in range
+
+
+typedef struct _FRAME_PLANE
+{
+	UINT32 width;				// in elements: pixels for luma, 2x2 pixel blocks for chroma
+	UINT32 height;
+	UINT32 bytesPerElement;
+	UINT32 pitch;				// bytes per row when the planes are packed in memory, as the CPU converters expect them
+	UINT64 offset;				// of the plane from the start of the packed frame
+} FRAME_PLANE;
+
+typedef struct _FRAME_LAYOUT
+{
+	FrameFormat format;
+	UINT32 allocatedWidth;		// texture size, the content size rounded up to what the format allows
+	UINT32 allocatedHeight;
+	UINT32 planeCount;
+	FRAME_PLANE planes[_MaxFramePlanes_];
+	UINT64 sizeBytes;
+} FRAME_LAYOUT;
+
+// What the device can do with the native formats; BGRA32 is always supported
+typedef struct _FRAME_FORMAT_SUPPORT
+{
+	bool nv12;
+	bool p010;
+} FRAME_FORMAT_SUPPORT;
+
+
+// Format to render to. Native formats fall back P010 -> NV12 -> BGRA32 when the device lacks them;
+// stereoscopic frames are always BGRA32, the over/under packing is done by copies that need an RGB layout.
+FrameFormat SelectFrameFormat(
+	_In_ FrameFormat preferredFormat,
+	_In_ const FRAME_FORMAT_SUPPORT& support,
+	_In_ bool isStereoscopic);
+
+HRESULT GetFrameLayout(
+	_In_ FrameFormat format,
+	_In_ UINT32 width,
+	_In_ UINT32 height,
+	_Out_ FRAME_LAYOUT* pLayout);
+
+bool IsNativeFrameFormat(
+	_In_ FrameFormat format);
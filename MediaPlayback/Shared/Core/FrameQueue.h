@@ -0,0 +1,139 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Bounded single-producer/single-consumer ring of frame slots.
+//
+// The producer (decoder thread) renders into the slot returned by BeginWrite() and calls Publish().
+// The consumer (render thread) calls AcquireLatest() and keeps the returned slot until its next AcquireLatest(),
+// frames published in between are skipped. The producer never touches the slot held by the consumer,
+// so with the default 3 slots one frame can be in flight while another one is pending and a third one is displayed.
+// If every free slot holds a pending frame, BeginWrite() fails and the new frame is dropped.
+//
+// Only two counters are shared: m_head (frames published) and m_tail (frames taken by the consumer).
+// Slots can be anything (textures, CPU buffers); the queue never allocates after construction.
+
+#include "PlaybackTypes.h"
+
+#include <array>
+#include <atomic>
+
+
+template <typename TSlot, UINT32 SlotCount = 3>
+class CFrameQueue
+{
+	static_assert(SlotCount >= 2, "CFrameQueue needs at least one slot for each side");
+
+public:
+	CFrameQueue()
+		: m_head(0)
+		, m_tail(0)
+		, m_latestTimestamp(0)
+		, m_presented(0)
+		, m_dropped(0)
+	{
+	}
+
+	static UINT32 GetCapacity() { return SlotCount; }
+
+	// Direct access for (re)creating slot resources. Only valid while neither side is running.
+	TSlot& GetSlot(_In_ UINT32 index) { return m_slots[index % SlotCount]; }
+
+	// Forgets every published frame. Only valid while neither side is running.
+	void Reset()
+	{
+		m_head.store(0, std::memory_order_relaxed);
+		m_tail.store(0, std::memory_order_relaxed);
+		m_latestTimestamp.store(0, std::memory_order_relaxed);
+	}
+
+	// Producer: returns the slot to render the next frame into, or nullptr (and counts a drop) if there is none free.
+	// Calling it again without Publish() returns the same slot.
+	TSlot* BeginWrite()
+	{
+		UINT64 head = m_head.load(std::memory_order_relaxed);
+		UINT64 tail = m_tail.load(std::memory_order_acquire);
+
+		// slot (tail - 1) belongs to the consumer, everything in [tail, head) is pending
+		if (head - tail > SlotCount - 2)
+		{
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		return &m_slots[head % SlotCount];
+	}
+
+	// Producer: makes the slot returned by BeginWrite() the latest frame
+	void Publish(_In_ INT64 timestamp = CoreNow())
+	{
+		m_latestTimestamp.store(timestamp, std::memory_order_relaxed);
+		m_head.fetch_add(1, std::memory_order_release);
+	}
+
+	// Producer: the slot published last, or nullptr if nothing has been published since Reset(). It is read only,
+	// the consumer may be holding it.
+	TSlot* GetLastPublished()
+	{
+		UINT64 head = m_head.load(std::memory_order_relaxed);
+
+		return head ? &m_slots[(head - 1) % SlotCount] : nullptr;
+	}
+
+	// Consumer: returns the latest published slot, or nullptr if nothing has been published since Reset().
+	// *pIsNew is set when the slot differs from the one returned by the previous call.
+	TSlot* AcquireLatest(_Out_opt_ bool* pIsNew = nullptr)
+	{
+		UINT64 head = m_head.load(std::memory_order_acquire);
+		UINT64 tail = m_tail.load(std::memory_order_relaxed);
+
+		bool isNew = head != tail;
+		if (isNew)
+		{
+			// everything published before the latest frame will never be shown
+			m_dropped.fetch_add(head - tail - 1, std::memory_order_relaxed);
+			m_presented.fetch_add(1, std::memory_order_relaxed);
+			m_tail.store(head, std::memory_order_release);
+			tail = head;
+		}
+
+		if (pIsNew)
+			*pIsNew = isNew;
+
+		return tail ? &m_slots[(tail - 1) % SlotCount] : nullptr;
+	}
+
+	// Safe to call from any thread
+	void GetStats(_Out_ FRAME_QUEUE_STATS* pStats) const
+	{
+		UINT64 tail = m_tail.load(std::memory_order_acquire);
+		UINT64 head = m_head.load(std::memory_order_acquire);
+		INT64 latest = m_latestTimestamp.load(std::memory_order_relaxed);
+
+		pStats->capacity = SlotCount;
+		pStats->depth = (UINT32)(head - tail);
+		pStats->publishedFrames = head;
+		pStats->presentedFrames = m_presented.load(std::memory_order_relaxed);
+		pStats->droppedFrames = m_dropped.load(std::memory_order_relaxed);
+		pStats->latestFrameAge = head ? CoreNow() - latest : -1;
+	}
+
+private:
+	std::array<TSlot, SlotCount> m_slots;
+
+	std::atomic<UINT64> m_head;
+	std::atomic<UINT64> m_tail;
+	std::atomic<INT64> m_latestTimestamp;
+
+	std::atomic<UINT64> m_presented;
+	std::atomic<UINT64> m_dropped;
+};
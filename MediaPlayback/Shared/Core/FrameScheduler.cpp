@@ -0,0 +1,211 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "FrameScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+CFrameScheduler::CFrameScheduler()
+	: m_rate(1.0)
+	, m_duration(0)
+	, m_running(false)
+	, m_anchorPosition(0)
+	, m_anchorTime(0)
+	, m_target(-1)
+	, m_targetTime(0)
+	, m_lastShown(-1)
+	, m_lastPosition(-1)
+	, m_frameDuration(_DefaultFrameDuration_)
+	, m_trickPlayFrames(0)
+	, m_skippedKeyframes(0)
+	, m_steps(0)
+{
+}
+
+_Use_decl_annotations_
+bool CFrameScheduler::IsValidRate(DOUBLE rate)
+{
+	DOUBLE magnitude = std::fabs(rate);
+	return magnitude >= _MinPlaybackRate_ && magnitude <= _MaxPlaybackRate_;
+}
+
+_Use_decl_annotations_
+bool CFrameScheduler::IsNativeRate(DOUBLE rate)
+{
+	return rate >= _MinPlaybackRate_ && rate <= _MaxNativePlaybackRate_;
+}
+
+_Use_decl_annotations_
+HRESULT CFrameScheduler::SetRate(DOUBLE rate)
+{
+	if (!IsValidRate(rate))
+		return E_INVALIDARG;
+
+	m_rate = rate;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+void CFrameScheduler::Start(INT64 position, INT64 now)
+{
+	m_running = true;
+	m_anchorPosition = position;
+	m_anchorTime = now;
+	m_target = -1;
+	m_lastShown = SnapToKeyframe(position);
+}
+
+void CFrameScheduler::Stop()
+{
+	m_running = false;
+	m_target = -1;
+}
+
+_Use_decl_annotations_
+bool CFrameScheduler::GetNextTarget(INT64 now, INT64* pPosition)
+{
+	*pPosition = 0;
+
+	if (!m_running)
+		return false;
+
+	if (m_target >= 0)
+	{
+		if (now - m_targetTime < _TrickPlayTargetTimeout_)
+			return false;
+
+		m_target = -1;
+	}
+
+	INT64 position = m_anchorPosition + (INT64)(m_rate * (DOUBLE)(now - m_anchorTime));
+
+	// trick play stops at either end, the last frame stays
+	bool atEnd = false;
+	if (position <= 0)
+	{
+		position = 0;
+		atEnd = true;
+	}
+	else if (m_duration > 0 && position >= m_duration)
+	{
+		position = m_duration;
+		atEnd = true;
+	}
+
+	INT64 target = SnapToKeyframe(position);
+
+	if (atEnd)
+		m_running = false;
+
+	if (target == m_lastShown)
+		return false;
+
+	if (m_lastShown >= 0)
+		m_skippedKeyframes += CountKeyframesBetween(m_lastShown, target);
+
+	m_target = target;
+	m_targetTime = now;
+
+	*pPosition = target;
+
+	return true;
+}
+
+_Use_decl_annotations_
+void CFrameScheduler::OnFrame(INT64 position)
+{
+	if (m_target >= 0)
+	{
+		m_lastShown = m_target;
+		m_target = -1;
+		m_trickPlayFrames++;
+	}
+	else if (!m_running && m_rate == 1.0 && m_lastPosition >= 0)
+	{
+		// only neighbouring frames of normal playback tell the frame duration, not seeks, steps or faster playback
+		INT64 delta = position - m_lastPosition;
+		if (delta > 0 && delta <= _DefaultFrameDuration_ * 4)
+			m_frameDuration = delta;
+	}
+
+	m_lastPosition = position;
+}
+
+_Use_decl_annotations_
+INT64 CFrameScheduler::GetStepTarget(INT64 position, INT32 frames)
+{
+	m_steps++;
+
+	OnSeek();
+
+	INT64 target = position + (INT64)frames * m_frameDuration;
+
+	if (target < 0)
+		target = 0;
+	if (m_duration > 0 && target > m_duration - m_frameDuration)
+		target = std::max<INT64>(m_duration - m_frameDuration, 0);
+
+	return target;
+}
+
+void CFrameScheduler::Reset()
+{
+	m_rate = 1.0;
+	m_spKeyframeIndex.reset();
+	m_duration = 0;
+	m_running = false;
+	m_target = -1;
+	m_lastShown = -1;
+	m_lastPosition = -1;
+	m_frameDuration = _DefaultFrameDuration_;
+}
+
+_Use_decl_annotations_
+void CFrameScheduler::GetStats(FRAME_SCHEDULER_STATS* pStats) const
+{
+	pStats->rate = m_rate;
+	pStats->frameDuration = m_frameDuration;
+	pStats->trickPlay = (m_running && IsTrickPlay()) ? 1 : 0;
+	pStats->trickPlayFrames = m_trickPlayFrames;
+	pStats->skippedKeyframes = m_skippedKeyframes;
+	pStats->steps = m_steps;
+}
+
+_Use_decl_annotations_
+INT64 CFrameScheduler::SnapToKeyframe(INT64 position) const
+{
+	if (m_spKeyframeIndex && !m_spKeyframeIndex->IsEmpty())
+		return m_spKeyframeIndex->FindSeekPosition(position, SeekMode::SeekMode_PreviousKeyframe);
+
+	return (position / _TrickPlayGrid_) * _TrickPlayGrid_;
+}
+
+_Use_decl_annotations_
+UINT32 CFrameScheduler::CountKeyframesBetween(INT64 from, INT64 to) const
+{
+	if (from > to)
+		std::swap(from, to);
+
+	if (m_spKeyframeIndex && !m_spKeyframeIndex->IsEmpty())
+	{
+		const std::vector<INT64>& times = m_spKeyframeIndex->GetKeyframeTimes();
+		auto first = std::upper_bound(times.begin(), times.end(), from);
+		auto last = std::lower_bound(times.begin(), times.end(), to);
+
+		return (last > first) ? (UINT32)(last - first) : 0;
+	}
+
+	INT64 steps = (to - from) / _TrickPlayGrid_;
+	return (steps > 1) ? (UINT32)(steps - 1) : 0;
+}
@@ -0,0 +1,98 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Playback rate and frame stepping on top of a decoder that only plays forward at moderate rates.
+// Rates the decoder plays itself (IsNativeRate) are handed to it. Faster and reverse rates are trick play: the
+// decoder stays paused and the player seeks to the keyframe due at each render tick, so only keyframes are decoded.
+// A new target is only handed out once the frame of the previous one was presented; keyframes that came due
+// meanwhile are skipped, so the decoder is never queued up behind the clock. Without a keyframe index (streams)
+// the targets are spaced _TrickPlayGrid_ apart.
+//
+// Not thread safe, players guard it with their own lock.
+
+#include "CorePlatform.h"
+#include "KeyframeIndex.h"
+#include "PlaybackTypes.h"
+
+#include <memory>
+
+#define _MinPlaybackRate_ 0.25
+#define _MaxPlaybackRate_ 4.0
+#define _MaxNativePlaybackRate_ 2.0
+#define _TrickPlayGrid_ ((INT64)5000000)				// 0.5s of media between targets without a keyframe index
+#define _TrickPlayTargetTimeout_ ((INT64)5000000)		// a target whose frame did not show up within 0.5s is given up
+#define _DefaultFrameDuration_ ((INT64)333333)			// 30 fps until frames have been seen
+
+
+class CFrameScheduler
+{
+public:
+	CFrameScheduler();
+
+	// 0.25 <= |rate| <= 4
+	static bool IsValidRate(_In_ DOUBLE rate);
+	static bool IsNativeRate(_In_ DOUBLE rate);
+
+	HRESULT SetRate(_In_ DOUBLE rate);
+	DOUBLE GetRate() const { return m_rate; }
+	bool IsTrickPlay() const { return !IsNativeRate(m_rate); }
+
+	// Keyframes trick play lands on, null without an index
+	void SetKeyframeIndex(_In_ const std::shared_ptr<const CKeyframeIndex>& spIndex) { m_spKeyframeIndex = spIndex; }
+	void SetDuration(_In_ INT64 duration) { m_duration = duration; }
+
+	// Trick play runs from position at time now (100ns) until Stop or either end of the media
+	void Start(_In_ INT64 position, _In_ INT64 now);
+	void Stop();
+	bool IsRunning() const { return m_running; }
+
+	// The position to seek to at time now; false while the frame of the previous target is due or nothing new is
+	bool GetNextTarget(_In_ INT64 now, _Out_ INT64* pPosition);
+
+	// A frame at position was presented, in any mode
+	void OnFrame(_In_ INT64 position);
+
+	// The session was sought, the next frame is no neighbour of the last one
+	void OnSeek() { m_lastPosition = -1; }
+
+	// Position frames away from position, within the media
+	INT64 GetStepTarget(_In_ INT64 position, _In_ INT32 frames);
+	INT64 GetFrameDuration() const { return m_frameDuration; }
+
+	// New source: normal rate, nothing known about its frames
+	void Reset();
+
+	void GetStats(_Out_ FRAME_SCHEDULER_STATS* pStats) const;
+
+private:
+	INT64 SnapToKeyframe(_In_ INT64 position) const;
+	UINT32 CountKeyframesBetween(_In_ INT64 from, _In_ INT64 to) const;
+
+	DOUBLE m_rate;
+	std::shared_ptr<const CKeyframeIndex> m_spKeyframeIndex;
+	INT64 m_duration;
+
+	bool m_running;
+	INT64 m_anchorPosition;			// trick play position at m_anchorTime
+	INT64 m_anchorTime;
+	INT64 m_target;					// seek whose frame has not been presented yet, -1 if none
+	INT64 m_targetTime;
+	INT64 m_lastShown;				// last trick play target presented, -1 if none
+
+	INT64 m_lastPosition;			// of the previous frame, -1 if none
+	INT64 m_frameDuration;
+
+	UINT32 m_trickPlayFrames;
+	UINT32 m_skippedKeyframes;
+	UINT32 m_steps;
+};
@@ -0,0 +1,1183 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "KeyframeIndex.h"
+#include "FileSystem.h"
+#include "LruCache.h"
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+
+#define _MaxTableSize_ (64 * 1024 * 1024)		// sample tables and cues of a few hours long file stay far below
+#define _MaxSampleCount_ (1u << 28)				// samples of a track, over 40 days at 60 fps
+#define _MaxMediaTicks_ (1ll << 60)				// media times in timescale units, beyond this they are damage
+#define _MaxMediaSeconds_ 3000000000ll			// about 95 years, keeps sums of two 100ns times from overflowing
+#define _IndexCacheCapacity_ 16
+#define _HundredNanosecondsPerSecond_ 10000000ll
+
+#define _FourCC_(a, b, c, d) (((UINT32)(a) << 24) | ((UINT32)(b) << 16) | ((UINT32)(c) << 8) | (UINT32)(d))
+
+// trun and tfhd flags, ISO/IEC 14496-12 8.8
+#define _TfhdBaseDataOffset_ 0x000001
+#define _TfhdSampleDescriptionIndex_ 0x000002
+#define _TfhdDefaultSampleDuration_ 0x000008
+#define _TfhdDefaultSampleSize_ 0x000010
+#define _TfhdDefaultSampleFlags_ 0x000020
+#define _TrunDataOffset_ 0x000001
+#define _TrunFirstSampleFlags_ 0x000004
+#define _TrunSampleDuration_ 0x000100
+#define _TrunSampleSize_ 0x000200
+#define _TrunSampleFlags_ 0x000400
+#define _TrunSampleCompositionOffset_ 0x000800
+#define _SampleIsNonSync_ 0x00010000
+
+// Matroska element IDs, marker bits included
+#define _EbmlHeaderId_ 0x1A45DFA3
+#define _SegmentId_ 0x18538067
+#define _SeekHeadId_ 0x114D9B74
+#define _SeekId_ 0x4DBB
+#define _SeekIdId_ 0x53AB
+#define _SeekPositionId_ 0x53AC
+#define _InfoId_ 0x1549A966
+#define _TimecodeScaleId_ 0x2AD7B1
+#define _TracksId_ 0x1654AE6B
+#define _TrackEntryId_ 0xAE
+#define _TrackNumberId_ 0xD7
+#define _TrackTypeId_ 0x83
+#define _CuesId_ 0x1C53BB6B
+#define _CuePointId_ 0xBB
+#define _CueTimeId_ 0xB3
+#define _CueTrackPositionsId_ 0xB7
+#define _CueTrackId_ 0xF7
+#define _ClusterId_ 0x1F43B675
+#define _MatroskaVideoTrackType_ 1
+#define _DefaultTimecodeScale_ 1000000			// ns per tick
+
+#define _UnknownElementSize_ UINT64_MAX
+
+
+// Big-endian reads from a table loaded in memory; reading past the end zeroes the value and sets failed
+class CByteReader
+{
+public:
+	CByteReader(_In_reads_(size) const BYTE* pData, _In_ size_t size)
+		: m_pData(pData)
+		, m_size(size)
+		, m_position(0)
+		, m_failed(false)
+	{
+	}
+
+	UINT64 Read(_In_ UINT32 bytes)
+	{
+		if (bytes > m_size - m_position)
+		{
+			m_position = m_size;
+			m_failed = true;
+			return 0;
+		}
+
+		UINT64 value = 0;
+		for (UINT32 i = 0; i < bytes; i++)
+		{
+			value = (value << 8) | m_pData[m_position++];
+		}
+
+		return value;
+	}
+
+	UINT32 ReadU32() { return (UINT32)Read(4); }
+
+	void Skip(_In_ UINT64 bytes)
+	{
+		if (bytes > m_size - m_position)
+		{
+			m_position = m_size;
+			m_failed = true;
+			return;
+		}
+
+		m_position += (size_t)bytes;
+	}
+
+	const BYTE* GetCurrent() const { return m_pData + m_position; }
+	size_t GetPosition() const { return m_position; }
+	size_t GetRemaining() const { return m_size - m_position; }
+	bool HasFailed() const { return m_failed; }
+
+private:
+	const BYTE* m_pData;
+	size_t m_size;
+	size_t m_position;
+	bool m_failed;
+};
+
+static INT64 ScaleTo100ns(INT64 time, UINT32 timescale)
+{
+	if (timescale == 0)
+		return 0;
+
+	// split so hours long media in fine timescales do not overflow, damaged times saturate
+	INT64 seconds = time / timescale;
+	if (seconds > _MaxMediaSeconds_)
+		return _MaxMediaSeconds_ * _HundredNanosecondsPerSecond_;
+	if (seconds < -_MaxMediaSeconds_)
+		return -_MaxMediaSeconds_ * _HundredNanosecondsPerSecond_;
+
+	return seconds * _HundredNanosecondsPerSecond_ + (time % timescale) * _HundredNanosecondsPerSecond_ / timescale;
+}
+
+static HRESULT ReadTable(IByteSource* pSource, UINT64 offset, UINT64 size, std::vector<BYTE>* pData)
+{
+	if (size > _MaxTableSize_)
+		return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+	pData->resize((size_t)size);
+	if (size == 0)
+		return S_OK;
+
+	return pSource->Read(offset, pData->data(), (UINT32)size);
+}
+
+
+//
+// MP4
+//
+
+typedef struct _MP4_BOX
+{
+	UINT32 type;
+	UINT64 offset;				// of the payload
+	UINT64 size;				// of the payload
+} MP4_BOX;
+
+typedef struct _MP4_TRACK
+{
+	UINT32 trackId;
+	UINT32 timescale;
+	bool isVideo;
+	bool hasSyncSamples;		// stss present, otherwise every sample is a sync sample
+	bool hasSampleCount;		// stsz or stz2 present
+	UINT32 sampleCount;			// as stsz or stz2 tell
+	std::vector<std::pair<UINT32, UINT32>> timeToSample;			// count, delta
+	std::vector<std::pair<UINT32, INT32>> compositionOffsets;		// count, offset
+	std::vector<UINT32> syncSamples;								// 1-based, ascending
+	INT64 editShift;			// 100ns, subtracted from media times to get presentation times
+} MP4_TRACK;
+
+typedef struct _MP4_TREX
+{
+	UINT32 trackId;
+	UINT32 defaultSampleDuration;
+	UINT32 defaultSampleFlags;
+} MP4_TREX;
+
+// Boxes directly inside [start, end), S_FALSE if one is truncated; the boxes before it are still returned
+static HRESULT ListBoxes(IByteSource* pSource, UINT64 start, UINT64 end, std::vector<MP4_BOX>* pBoxes)
+{
+	pBoxes->clear();
+
+	UINT64 offset = start;
+	while (end - offset >= 8)
+	{
+		BYTE header[16] = {};
+		IFR(pSource->Read(offset, header, 8));
+
+		CByteReader reader(header, sizeof(header));
+		UINT64 size = reader.ReadU32();
+		UINT32 type = reader.ReadU32();
+		UINT64 headerSize = 8;
+
+		if (size == 1)
+		{
+			if (end - offset < 16)
+				return S_FALSE;
+
+			IFR(pSource->Read(offset + 8, header + 8, 8));
+			size = reader.Read(8);
+			headerSize = 16;
+		}
+		else if (size == 0)
+		{
+			size = end - offset;
+		}
+
+		if (size < headerSize || size > end - offset)
+			return S_FALSE;
+
+		MP4_BOX box = { type, offset + headerSize, size - headerSize };
+		pBoxes->push_back(box);
+
+		offset += size;
+	}
+
+	return S_OK;
+}
+
+static const MP4_BOX* FindBox(const std::vector<MP4_BOX>& boxes, UINT32 type)
+{
+	for (const auto& box : boxes)
+	{
+		if (box.type == type)
+			return &box;
+	}
+
+	return nullptr;
+}
+
+static HRESULT ListChildBoxes(IByteSource* pSource, const MP4_BOX* pParent, std::vector<MP4_BOX>* pBoxes)
+{
+	if (pParent == nullptr)
+	{
+		pBoxes->clear();
+		return S_OK;
+	}
+
+	return ListBoxes(pSource, pParent->offset, pParent->offset + pParent->size, pBoxes);
+}
+
+// Reads version and flags of a full box
+static UINT32 ReadFullBoxHeader(CByteReader* pReader, UINT32* pFlags)
+{
+	UINT32 value = pReader->ReadU32();
+	*pFlags = value & 0x00FFFFFF;
+
+	return value >> 24;
+}
+
+static UINT32 ParseTimescale(const std::vector<BYTE>& mdhd)
+{
+	CByteReader reader(mdhd.data(), mdhd.size());
+
+	UINT32 flags = 0;
+	UINT32 version = ReadFullBoxHeader(&reader, &flags);
+	reader.Skip(version == 1 ? 16 : 8);			// creation and modification times
+
+	return reader.ReadU32();
+}
+
+static HRESULT ParseEditList(const std::vector<BYTE>& elst, UINT32 movieTimescale, UINT32 mediaTimescale, INT64* pEditShift)
+{
+	CByteReader reader(elst.data(), elst.size());
+
+	UINT32 flags = 0;
+	UINT32 version = ReadFullBoxHeader(&reader, &flags);
+	UINT32 entryCount = reader.ReadU32();
+
+	// empty edits delay the media, the first real edit tells where in the media presentation starts
+	INT64 emptyDuration = 0;
+	for (UINT32 i = 0; i < entryCount && !reader.HasFailed(); i++)
+	{
+		UINT64 segmentDuration = reader.Read(version == 1 ? 8 : 4);
+		INT64 mediaTime = (version == 1) ? (INT64)reader.Read(8) : (INT64)(INT32)reader.ReadU32();
+		reader.Skip(4);							// media rate
+
+		if (segmentDuration > (UINT64)_MaxMediaTicks_ || emptyDuration > _MaxMediaTicks_)
+			return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+		if (mediaTime == -1)
+		{
+			emptyDuration += (INT64)segmentDuration;
+			continue;
+		}
+
+		*pEditShift = ScaleTo100ns(mediaTime, mediaTimescale) - ScaleTo100ns(emptyDuration, movieTimescale);
+		break;
+	}
+
+	return reader.HasFailed() ? HRESULT_FROM_WIN32(ERROR_INVALID_DATA) : S_OK;
+}
+
+static HRESULT ParseSampleTables(IByteSource* pSource, const std::vector<MP4_BOX>& stbl, MP4_TRACK* pTrack)
+{
+	std::vector<BYTE> table;
+
+	const MP4_BOX* pStts = FindBox(stbl, _FourCC_('s', 't', 't', 's'));
+	if (pStts != nullptr)
+	{
+		IFR(ReadTable(pSource, pStts->offset, pStts->size, &table));
+
+		CByteReader reader(table.data(), table.size());
+		UINT32 flags = 0;
+		ReadFullBoxHeader(&reader, &flags);
+
+		UINT32 entryCount = reader.ReadU32();
+		if (entryCount > reader.GetRemaining() / 8)
+			return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+		pTrack->timeToSample.reserve(entryCount);
+		for (UINT32 i = 0; i < entryCount; i++)
+		{
+			UINT32 count = reader.ReadU32();
+			UINT32 delta = reader.ReadU32();
+			pTrack->timeToSample.push_back(std::make_pair(count, delta));
+		}
+	}
+
+	const MP4_BOX* pCtts = FindBox(stbl, _FourCC_('c', 't', 't', 's'));
+	if (pCtts != nullptr)
+	{
+		IFR(ReadTable(pSource, pCtts->offset, pCtts->size, &table));
+
+		CByteReader reader(table.data(), table.size());
+		UINT32 flags = 0;
+		ReadFullBoxHeader(&reader, &flags);
+
+		// version 0 offsets are unsigned, but writers put negative ones there as well
+		UINT32 entryCount = reader.ReadU32();
+		if (entryCount > reader.GetRemaining() / 8)
+			return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+		pTrack->compositionOffsets.reserve(entryCount);
+		for (UINT32 i = 0; i < entryCount; i++)
+		{
+			UINT32 count = reader.ReadU32();
+			INT32 offset = (INT32)reader.ReadU32();
+			pTrack->compositionOffsets.push_back(std::make_pair(count, offset));
+		}
+	}
+
+	// sample_count of stsz, or of its compact form
+	const MP4_BOX* pStsz = FindBox(stbl, _FourCC_('s', 't', 's', 'z'));
+	if (pStsz == nullptr)
+		pStsz = FindBox(stbl, _FourCC_('s', 't', 'z', '2'));
+
+	pTrack->hasSampleCount = (pStsz != nullptr);
+	if (pStsz != nullptr)
+	{
+		IFR(ReadTable(pSource, pStsz->offset, std::min<UINT64>(pStsz->size, 12), &table));
+
+		CByteReader reader(table.data(), table.size());
+		UINT32 flags = 0;
+		ReadFullBoxHeader(&reader, &flags);
+		reader.Skip(4);							// sample_size, or reserved and field_size
+		pTrack->sampleCount = reader.ReadU32();
+
+		if (reader.HasFailed())
+			return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+	}
+
+	const MP4_BOX* pStss = FindBox(stbl, _FourCC_('s', 't', 's', 's'));
+	pTrack->hasSyncSamples = (pStss != nullptr);
+	if (pStss != nullptr)
+	{
+		IFR(ReadTable(pSource, pStss->offset, pStss->size, &table));
+
+		CByteReader reader(table.data(), table.size());
+		UINT32 flags = 0;
+		ReadFullBoxHeader(&reader, &flags);
+
+		UINT32 entryCount = reader.ReadU32();
+		if (entryCount > reader.GetRemaining() / 4)
+			return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+		pTrack->syncSamples.reserve(entryCount);
+		for (UINT32 i = 0; i < entryCount; i++)
+		{
+			pTrack->syncSamples.push_back(reader.ReadU32());
+		}
+
+		std::sort(pTrack->syncSamples.begin(), pTrack->syncSamples.end());
+	}
+
+	return S_OK;
+}
+
+static HRESULT ParseTrack(IByteSource* pSource, const MP4_BOX& trak, UINT32 movieTimescale, MP4_TRACK* pTrack)
+{
+	std::vector<MP4_BOX> trakBoxes, mdiaBoxes, minfBoxes, stblBoxes;
+	std::vector<BYTE> table;
+
+	IFR(ListChildBoxes(pSource, &trak, &trakBoxes));
+
+	const MP4_BOX* pTkhd = FindBox(trakBoxes, _FourCC_('t', 'k', 'h', 'd'));
+	if (pTkhd == nullptr)
+		return S_FALSE;
+
+	IFR(ReadTable(pSource, pTkhd->offset, std::min<UINT64>(pTkhd->size, 24), &table));
+	{
+		CByteReader reader(table.data(), table.size());
+		UINT32 flags = 0;
+		UINT32 version = ReadFullBoxHeader(&reader, &flags);
+		reader.Skip(version == 1 ? 16 : 8);
+		pTrack->trackId = reader.ReadU32();
+	}
+
+	IFR(ListChildBoxes(pSource, FindBox(trakBoxes, _FourCC_('m', 'd', 'i', 'a')), &mdiaBoxes));
+
+	const MP4_BOX* pHdlr = FindBox(mdiaBoxes, _FourCC_('h', 'd', 'l', 'r'));
+	const MP4_BOX* pMdhd = FindBox(mdiaBoxes, _FourCC_('m', 'd', 'h', 'd'));
+	if (pHdlr == nullptr || pMdhd == nullptr)
+		return S_FALSE;
+
+	IFR(ReadTable(pSource, pHdlr->offset, std::min<UINT64>(pHdlr->size, 12), &table));
+	{
+		CByteReader reader(table.data(), table.size());
+		reader.Skip(8);							// version, flags and pre_defined
+		pTrack->isVideo = (reader.ReadU32() == _FourCC_('v', 'i', 'd', 'e'));
+	}
+
+	IFR(ReadTable(pSource, pMdhd->offset, std::min<UINT64>(pMdhd->size, 24), &table));
+	pTrack->timescale = ParseTimescale(table);
+
+	if (!pTrack->isVideo || pTrack->timescale == 0)
+		return S_OK;
+
+	std::vector<MP4_BOX> edtsBoxes;
+	IFR(ListChildBoxes(pSource, FindBox(trakBoxes, _FourCC_('e', 'd', 't', 's')), &edtsBoxes));
+
+	const MP4_BOX* pElst = FindBox(edtsBoxes, _FourCC_('e', 'l', 's', 't'));
+	if (pElst != nullptr)
+	{
+		IFR(ReadTable(pSource, pElst->offset, pElst->size, &table));
+		IFR(ParseEditList(table, movieTimescale, pTrack->timescale, &pTrack->editShift));
+	}
+
+	IFR(ListChildBoxes(pSource, FindBox(mdiaBoxes, _FourCC_('m', 'i', 'n', 'f')), &minfBoxes));
+	IFR(ListChildBoxes(pSource, FindBox(minfBoxes, _FourCC_('s', 't', 'b', 'l')), &stblBoxes));
+
+	return ParseSampleTables(pSource, stblBoxes, pTrack);
+}
+
+// Presentation times of the sync samples the sample tables describe. Tracks without stss have nothing but sync
+// samples, they are not listed. Fails with E_INVALIDARG if stts claims more samples than the track has.
+static HRESULT GetSyncSampleTimes(const MP4_TRACK& track, std::vector<INT64>* pTimes)
+{
+	UINT64 sampleCount = 0;
+	for (const auto& run : track.timeToSample)
+	{
+		sampleCount += run.first;
+	}
+
+	if (sampleCount > _MaxSampleCount_ || (track.hasSampleCount && sampleCount > track.sampleCount))
+		return E_INVALIDARG;
+
+	if (!track.hasSyncSamples)
+		return S_OK;
+
+	pTimes->reserve(track.syncSamples.size());
+
+	size_t timeRun = 0, offsetRun = 0, syncIndex = 0;
+	UINT64 timeRunFirst = 1, offsetRunFirst = 1;
+	INT64 timeRunStart = 0;
+
+	for (UINT64 sample = 1; sample <= sampleCount; sample++)
+	{
+		while (syncIndex < track.syncSamples.size() && track.syncSamples[syncIndex] < sample)
+		{
+			syncIndex++;
+		}
+
+		if (syncIndex == track.syncSamples.size())
+			break;
+
+		// jump straight to the next sync sample
+		sample = track.syncSamples[syncIndex];
+		if (sample > sampleCount)
+			break;
+
+		while (timeRun < track.timeToSample.size() && sample >= timeRunFirst + track.timeToSample[timeRun].first)
+		{
+			timeRunStart += (INT64)track.timeToSample[timeRun].first * track.timeToSample[timeRun].second;
+			timeRunFirst += track.timeToSample[timeRun].first;
+			timeRun++;
+		}
+
+		if (timeRun == track.timeToSample.size())
+			break;
+
+		INT64 decodeTime = timeRunStart + (INT64)(sample - timeRunFirst) * track.timeToSample[timeRun].second;
+
+		while (offsetRun < track.compositionOffsets.size() && sample >= offsetRunFirst + track.compositionOffsets[offsetRun].first)
+		{
+			offsetRunFirst += track.compositionOffsets[offsetRun].first;
+			offsetRun++;
+		}
+
+		INT64 compositionOffset = (offsetRun < track.compositionOffsets.size()) ? track.compositionOffsets[offsetRun].second : 0;
+
+		pTimes->push_back(ScaleTo100ns(decodeTime + compositionOffset, track.timescale) - track.editShift);
+	}
+
+	return S_OK;
+}
+
+static HRESULT ParseFragmentRandomAccess(const std::vector<BYTE>& tfra, const MP4_TRACK& track, std::vector<INT64>* pTimes)
+{
+	CByteReader reader(tfra.data(), tfra.size());
+
+	UINT32 flags = 0;
+	UINT32 version = ReadFullBoxHeader(&reader, &flags);
+	if (reader.ReadU32() != track.trackId)
+		return S_FALSE;
+
+	UINT32 lengths = reader.ReadU32();
+	UINT32 trafNumberSize = ((lengths >> 4) & 3) + 1;
+	UINT32 trunNumberSize = ((lengths >> 2) & 3) + 1;
+	UINT32 sampleNumberSize = (lengths & 3) + 1;
+	UINT32 entryCount = reader.ReadU32();
+
+	for (UINT32 i = 0; i < entryCount && !reader.HasFailed(); i++)
+	{
+		INT64 time = (INT64)reader.Read(version == 1 ? 8 : 4);
+		reader.Skip((version == 1 ? 8 : 4) + trafNumberSize + trunNumberSize + sampleNumberSize);
+
+		if (!reader.HasFailed())
+			pTimes->push_back(ScaleTo100ns(time, track.timescale) - track.editShift);
+	}
+
+	return reader.HasFailed() ? HRESULT_FROM_WIN32(ERROR_INVALID_DATA) : S_OK;
+}
+
+// Sync samples of one traf; pDecodeTime carries the decode time over to fragments without tfdt
+static HRESULT ParseTrackFragment(
+	IByteSource* pSource,
+	const MP4_BOX& traf,
+	const MP4_TRACK& track,
+	const MP4_TREX& trex,
+	INT64* pDecodeTime,
+	std::vector<INT64>* pTimes)
+{
+	std::vector<MP4_BOX> trafBoxes;
+	std::vector<BYTE> table;
+
+	IFR(ListChildBoxes(pSource, &traf, &trafBoxes));
+
+	const MP4_BOX* pTfhd = FindBox(trafBoxes, _FourCC_('t', 'f', 'h', 'd'));
+	if (pTfhd == nullptr)
+		return S_FALSE;
+
+	IFR(ReadTable(pSource, pTfhd->offset, pTfhd->size, &table));
+
+	UINT32 defaultDuration = trex.defaultSampleDuration;
+	UINT32 defaultFlags = trex.defaultSampleFlags;
+	{
+		CByteReader reader(table.data(), table.size());
+		UINT32 flags = 0;
+		ReadFullBoxHeader(&reader, &flags);
+
+		if (reader.ReadU32() != track.trackId)
+			return S_FALSE;
+
+		if (flags & _TfhdBaseDataOffset_)
+			reader.Skip(8);
+		if (flags & _TfhdSampleDescriptionIndex_)
+			reader.Skip(4);
+		if (flags & _TfhdDefaultSampleDuration_)
+			defaultDuration = reader.ReadU32();
+		if (flags & _TfhdDefaultSampleSize_)
+			reader.Skip(4);
+		if (flags & _TfhdDefaultSampleFlags_)
+			defaultFlags = reader.ReadU32();
+
+		if (reader.HasFailed())
+			return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+	}
+
+	const MP4_BOX* pTfdt = FindBox(trafBoxes, _FourCC_('t', 'f', 'd', 't'));
+	if (pTfdt != nullptr)
+	{
+		IFR(ReadTable(pSource, pTfdt->offset, pTfdt->size, &table));
+
+		CByteReader reader(table.data(), table.size());
+		UINT32 flags = 0;
+		UINT32 version = ReadFullBoxHeader(&reader, &flags);
+		UINT64 decodeTime = reader.Read(version == 1 ? 8 : 4);
+		if (decodeTime > (UINT64)_MaxMediaTicks_)
+			return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+		*pDecodeTime = (INT64)decodeTime;
+	}
+
+	for (const auto& box : trafBoxes)
+	{
+		if (box.type != _FourCC_('t', 'r', 'u', 'n'))
+			continue;
+
+		IFR(ReadTable(pSource, box.offset, box.size, &table));
+
+		CByteReader reader(table.data(), table.size());
+		UINT32 flags = 0;
+		ReadFullBoxHeader(&reader, &flags);
+		UINT32 sampleCount = reader.ReadU32();
+
+		if (flags & _TrunDataOffset_)
+			reader.Skip(4);
+
+		UINT32 firstSampleFlags = defaultFlags;
+		if (flags & _TrunFirstSampleFlags_)
+			firstSampleFlags = reader.ReadU32();
+
+		for (UINT32 i = 0; i < sampleCount && !reader.HasFailed(); i++)
+		{
+			UINT32 duration = (flags & _TrunSampleDuration_) ? reader.ReadU32() : defaultDuration;
+			if (flags & _TrunSampleSize_)
+				reader.Skip(4);
+
+			UINT32 sampleFlags = (i == 0) ? firstSampleFlags : defaultFlags;
+			if (flags & _TrunSampleFlags_)
+				sampleFlags = reader.ReadU32();
+
+			// signed in either version, as in ctts: writers put negative offsets in version 0 as well
+			INT64 compositionOffset = 0;
+			if (flags & _TrunSampleCompositionOffset_)
+				compositionOffset = (INT64)(INT32)reader.ReadU32();
+
+			if (reader.HasFailed() || *pDecodeTime > _MaxMediaTicks_)
+				break;
+
+			if ((sampleFlags & _SampleIsNonSync_) == 0)
+				pTimes->push_back(ScaleTo100ns(*pDecodeTime + compositionOffset, track.timescale) - track.editShift);
+
+			*pDecodeTime += duration;
+		}
+
+		if (reader.HasFailed() || *pDecodeTime > _MaxMediaTicks_)
+			return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+	}
+
+	return S_OK;
+}
+
+static HRESULT ParseSegmentIndex(const std::vector<BYTE>& sidx, const MP4_TRACK& track, bool anyTrack, std::vector<INT64>* pTimes)
+{
+	CByteReader reader(sidx.data(), sidx.size());
+
+	UINT32 flags = 0;
+	UINT32 version = ReadFullBoxHeader(&reader, &flags);
+	UINT32 referenceId = reader.ReadU32();
+	UINT32 timescale = reader.ReadU32();
+	UINT64 earliestTime = reader.Read(version == 1 ? 8 : 4);
+	reader.Skip((version == 1 ? 8 : 4) + 2);	// first_offset and reserved
+	UINT32 referenceCount = (UINT32)reader.Read(2);
+
+	if (reader.HasFailed() || earliestTime > (UINT64)_MaxMediaTicks_)
+		return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+	INT64 time = (INT64)earliestTime;
+
+	if (!anyTrack && referenceId != track.trackId)
+		return S_FALSE;
+
+	for (UINT32 i = 0; i < referenceCount; i++)
+	{
+		UINT32 reference = reader.ReadU32();
+		UINT32 duration = reader.ReadU32();
+		UINT32 sap = reader.ReadU32();
+
+		if (reader.HasFailed())
+			return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+		// references to other sidx boxes are indexed when the walk gets to them
+		bool isMedia = (reference & 0x80000000) == 0;
+		bool startsWithSap = (sap & 0x80000000) != 0;
+		UINT32 sapType = (sap >> 28) & 7;
+		UINT32 sapDelta = sap & 0x0FFFFFFF;
+
+		// types 1 to 3 are the ones a decoder can start at without artifacts
+		if (isMedia && (startsWithSap || (sapType >= 1 && sapType <= 3)))
+			pTimes->push_back(ScaleTo100ns(time + (startsWithSap ? 0 : sapDelta), timescale) - track.editShift);
+
+		time += duration;
+	}
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CKeyframeIndex::BuildMp4(IByteSource* pSource)
+{
+	std::vector<MP4_BOX> topBoxes, moovBoxes, boxes;
+	std::vector<BYTE> table;
+
+	// a truncated tail still leaves the boxes before it
+	IFR(ListBoxes(pSource, 0, pSource->GetSize(), &topBoxes));
+
+	MP4_TRACK track = {};
+	bool hasTrack = false;
+	std::vector<MP4_TREX> trexes;
+
+	const MP4_BOX* pMoov = FindBox(topBoxes, _FourCC_('m', 'o', 'o', 'v'));
+	if (pMoov != nullptr)
+	{
+		IFR(ListChildBoxes(pSource, pMoov, &moovBoxes));
+
+		UINT32 movieTimescale = 0;
+		const MP4_BOX* pMvhd = FindBox(moovBoxes, _FourCC_('m', 'v', 'h', 'd'));
+		if (pMvhd != nullptr)
+		{
+			IFR(ReadTable(pSource, pMvhd->offset, std::min<UINT64>(pMvhd->size, 24), &table));
+			movieTimescale = ParseTimescale(table);
+		}
+
+		for (const auto& box : moovBoxes)
+		{
+			if (box.type != _FourCC_('t', 'r', 'a', 'k'))
+				continue;
+
+			MP4_TRACK candidate = {};
+			IFR(ParseTrack(pSource, box, movieTimescale, &candidate));
+
+			if (candidate.isVideo && candidate.timescale != 0)
+			{
+				track = std::move(candidate);
+				hasTrack = true;
+				break;
+			}
+		}
+
+		IFR(ListChildBoxes(pSource, FindBox(moovBoxes, _FourCC_('m', 'v', 'e', 'x')), &boxes));
+		for (const auto& box : boxes)
+		{
+			if (box.type != _FourCC_('t', 'r', 'e', 'x'))
+				continue;
+
+			IFR(ReadTable(pSource, box.offset, box.size, &table));
+
+			CByteReader reader(table.data(), table.size());
+			UINT32 flags = 0;
+			ReadFullBoxHeader(&reader, &flags);
+
+			MP4_TREX trex = {};
+			trex.trackId = reader.ReadU32();
+			reader.Skip(4);						// default_sample_description_index
+			trex.defaultSampleDuration = reader.ReadU32();
+			reader.Skip(4);						// default_sample_size
+			trex.defaultSampleFlags = reader.ReadU32();
+
+			if (!reader.HasFailed())
+				trexes.push_back(trex);
+		}
+	}
+
+	// progressive files: the sample tables of the track
+	if (hasTrack && !track.timeToSample.empty())
+	{
+		IFR(GetSyncSampleTimes(track, &m_keyframeTimes));
+		m_everySampleIsSync = !track.hasSyncSamples;
+		return S_OK;
+	}
+
+	// fragmented files: tfra of the random access box at the end
+	const MP4_BOX* pMfra = FindBox(topBoxes, _FourCC_('m', 'f', 'r', 'a'));
+	if (hasTrack && pMfra != nullptr)
+	{
+		IFR(ListChildBoxes(pSource, pMfra, &boxes));
+		for (const auto& box : boxes)
+		{
+			if (box.type != _FourCC_('t', 'f', 'r', 'a'))
+				continue;
+
+			IFR(ReadTable(pSource, box.offset, box.size, &table));
+			IFR(ParseFragmentRandomAccess(table, track, &m_keyframeTimes));
+		}
+
+		if (!m_keyframeTimes.empty())
+			return S_OK;
+	}
+
+	// then the sync flags of the fragments themselves
+	if (hasTrack)
+	{
+		MP4_TREX trex = { track.trackId, 0, 0 };
+		for (const auto& entry : trexes)
+		{
+			if (entry.trackId == track.trackId)
+				trex = entry;
+		}
+
+		INT64 decodeTime = 0;
+		for (const auto& moof : topBoxes)
+		{
+			if (moof.type != _FourCC_('m', 'o', 'o', 'f'))
+				continue;
+
+			IFR(ListChildBoxes(pSource, &moof, &boxes));
+			for (const auto& box : boxes)
+			{
+				if (box.type == _FourCC_('t', 'r', 'a', 'f'))
+					IFR(ParseTrackFragment(pSource, box, track, trex, &decodeTime, &m_keyframeTimes));
+			}
+		}
+
+		if (!m_keyframeTimes.empty())
+			return S_OK;
+	}
+
+	// last the segment index, which only marks where subsegments start with a keyframe
+	for (const auto& box : topBoxes)
+	{
+		if (box.type != _FourCC_('s', 'i', 'd', 'x'))
+			continue;
+
+		IFR(ReadTable(pSource, box.offset, box.size, &table));
+		IFR(ParseSegmentIndex(table, track, !hasTrack, &m_keyframeTimes));
+	}
+
+	return m_keyframeTimes.empty() ? S_FALSE : S_OK;
+}
+
+
+//
+// Matroska
+//
+
+// EBML variable length integer: IDs keep their marker bits, sizes drop them
+static bool ReadVarInt(CByteReader* pReader, bool isId, UINT64* pValue)
+{
+	if (pReader->GetRemaining() == 0)
+		return false;
+
+	UINT64 first = pReader->Read(1);
+	UINT32 length = 1;
+	while (length <= 8 && (first & (0x80 >> (length - 1))) == 0)
+	{
+		length++;
+	}
+
+	if (length > (isId ? 4u : 8u))
+		return false;
+
+	UINT64 value = isId ? first : (first & (0xFF >> length));
+	bool allOnes = (value == (UINT64)(0xFF >> length));
+	for (UINT32 i = 1; i < length; i++)
+	{
+		UINT64 next = pReader->Read(1);
+		allOnes = allOnes && next == 0xFF;
+		value = (value << 8) | next;
+	}
+
+	if (pReader->HasFailed())
+		return false;
+
+	*pValue = (!isId && allOnes) ? _UnknownElementSize_ : value;
+
+	return true;
+}
+
+// Reads the header of the element at offset of the source
+static HRESULT ReadElementHeader(IByteSource* pSource, UINT64 offset, UINT64* pId, UINT64* pSize, UINT64* pHeaderSize)
+{
+	BYTE header[12] = {};
+	UINT32 available = (UINT32)std::min<UINT64>(sizeof(header), pSource->GetSize() - std::min(offset, pSource->GetSize()));
+	IFR(pSource->Read(offset, header, available));
+
+	CByteReader reader(header, available);
+	if (!ReadVarInt(&reader, true, pId) || !ReadVarInt(&reader, false, pSize))
+		return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+	*pHeaderSize = reader.GetPosition();
+
+	return S_OK;
+}
+
+static UINT64 ReadUnsigned(CByteReader* pReader, UINT64 size)
+{
+	if (size > 8)
+	{
+		pReader->Skip(size);
+		return 0;
+	}
+
+	return pReader->Read((UINT32)size);
+}
+
+// Calls element(id, size, pChild) for each child in the reader, pChild covers the payload of the child only
+template <typename TElement>
+static bool ForEachElement(CByteReader* pReader, TElement element)
+{
+	while (pReader->GetRemaining() > 0)
+	{
+		UINT64 id = 0, size = 0;
+		if (!ReadVarInt(pReader, true, &id) || !ReadVarInt(pReader, false, &size) || size > pReader->GetRemaining())
+			return false;
+
+		CByteReader child(pReader->GetCurrent(), (size_t)size);
+		element(id, size, &child);
+
+		pReader->Skip(size);
+	}
+
+	return true;
+}
+
+_Use_decl_annotations_
+HRESULT CKeyframeIndex::BuildMatroska(IByteSource* pSource)
+{
+	UINT64 fileSize = pSource->GetSize();
+	UINT64 id = 0, size = 0, headerSize = 0;
+
+	IFR(ReadElementHeader(pSource, 0, &id, &size, &headerSize));
+	if (id != _EbmlHeaderId_ || size == _UnknownElementSize_)
+		return S_FALSE;
+
+	UINT64 offset = headerSize + size;
+	IFR(ReadElementHeader(pSource, offset, &id, &size, &headerSize));
+	if (id != _SegmentId_)
+		return S_FALSE;
+
+	UINT64 segmentStart = offset + headerSize;
+	UINT64 segmentEnd = (size == _UnknownElementSize_ || size > fileSize - segmentStart) ? fileSize : segmentStart + size;
+
+	UINT64 cuesOffset = 0, infoOffset = 0, tracksOffset = 0;
+	UINT64 timecodeScale = _DefaultTimecodeScale_;
+	UINT64 videoTrack = 0;
+	bool hasInfo = false, hasTracks = false;
+	std::vector<BYTE> table;
+
+	auto parseElement = [&](UINT64 elementId, UINT64 elementOffset, UINT64 elementSize) -> HRESULT
+	{
+		IFR(ReadTable(pSource, elementOffset, elementSize, &table));
+		CByteReader reader(table.data(), table.size());
+
+		switch (elementId)
+		{
+		case _SeekHeadId_:
+			ForEachElement(&reader, [&](UINT64 childId, UINT64, CByteReader* pSeek)
+			{
+				if (childId != _SeekId_)
+					return;
+
+				UINT64 seekId = 0, seekPosition = 0;
+				ForEachElement(pSeek, [&](UINT64 fieldId, UINT64 fieldSize, CByteReader* pField)
+				{
+					if (fieldId == _SeekIdId_)
+						seekId = ReadUnsigned(pField, fieldSize);
+					else if (fieldId == _SeekPositionId_)
+						seekPosition = ReadUnsigned(pField, fieldSize);
+				});
+
+				if (seekId == _CuesId_)
+					cuesOffset = segmentStart + seekPosition;
+				else if (seekId == _InfoId_)
+					infoOffset = segmentStart + seekPosition;
+				else if (seekId == _TracksId_)
+					tracksOffset = segmentStart + seekPosition;
+			});
+			break;
+
+		case _InfoId_:
+			hasInfo = true;
+			ForEachElement(&reader, [&](UINT64 childId, UINT64 childSize, CByteReader* pChild)
+			{
+				if (childId == _TimecodeScaleId_)
+					timecodeScale = ReadUnsigned(pChild, childSize);
+
+				if (timecodeScale == 0)
+					timecodeScale = _DefaultTimecodeScale_;
+			});
+			break;
+
+		case _TracksId_:
+			hasTracks = true;
+			ForEachElement(&reader, [&](UINT64 childId, UINT64, CByteReader* pEntry)
+			{
+				if (childId != _TrackEntryId_ || videoTrack != 0)
+					return;
+
+				UINT64 number = 0, type = 0;
+				ForEachElement(pEntry, [&](UINT64 fieldId, UINT64 fieldSize, CByteReader* pField)
+				{
+					if (fieldId == _TrackNumberId_)
+						number = ReadUnsigned(pField, fieldSize);
+					else if (fieldId == _TrackTypeId_)
+						type = ReadUnsigned(pField, fieldSize);
+				});
+
+				if (type == _MatroskaVideoTrackType_)
+					videoTrack = number;
+			});
+			break;
+
+		case _CuesId_:
+			ForEachElement(&reader, [&](UINT64 childId, UINT64, CByteReader* pPoint)
+			{
+				if (childId != _CuePointId_)
+					return;
+
+				UINT64 time = 0;
+				bool hasTime = false, isVideo = false;
+				ForEachElement(pPoint, [&](UINT64 fieldId, UINT64 fieldSize, CByteReader* pField)
+				{
+					if (fieldId == _CueTimeId_)
+					{
+						time = ReadUnsigned(pField, fieldSize);
+						hasTime = true;
+					}
+					else if (fieldId == _CueTrackPositionsId_)
+					{
+						ForEachElement(pField, [&](UINT64 positionId, UINT64 positionSize, CByteReader* pPosition)
+						{
+							if (positionId == _CueTrackId_)
+								isVideo = isVideo || ReadUnsigned(pPosition, positionSize) == videoTrack;
+						});
+					}
+				});
+
+				// beyond INT64 nanoseconds (292 years) the cue point is damaged
+				if (time > (UINT64)INT64_MAX / timecodeScale)
+					return;
+
+				// without Tracks every cue point is taken, most files only cue their video track anyway
+				if (hasTime && (isVideo || videoTrack == 0))
+					m_keyframeTimes.push_back((INT64)(time * timecodeScale / 100));
+			});
+			break;
+		}
+
+		return S_OK;
+	};
+
+	// the index usually follows the clusters, the SeekHead tells where, otherwise every cluster has to be skipped
+	offset = segmentStart;
+	while (offset < segmentEnd)
+	{
+		IFR(ReadElementHeader(pSource, offset, &id, &size, &headerSize));
+
+		if (id == _ClusterId_ && cuesOffset > offset)
+		{
+			offset = cuesOffset;
+			continue;
+		}
+
+		// live recordings leave sizes unknown, nothing after such an element can be found without parsing it
+		UINT64 elementOffset = offset + headerSize;
+		if (size == _UnknownElementSize_ || size > segmentEnd - elementOffset)
+			break;
+
+		if (id == _SeekHeadId_ || id == _InfoId_ || id == _TracksId_)
+		{
+			IFR(parseElement(id, elementOffset, size));
+		}
+		else if (id == _CuesId_)
+		{
+			// the cues need the scale and the video track, which may be after them
+			if (!hasInfo && infoOffset > offset)
+			{
+				UINT64 infoId = 0, infoSize = 0, infoHeaderSize = 0;
+				if (SUCCEEDED(ReadElementHeader(pSource, infoOffset, &infoId, &infoSize, &infoHeaderSize)) && infoId == _InfoId_)
+					IFR(parseElement(infoId, infoOffset + infoHeaderSize, infoSize));
+			}
+
+			if (!hasTracks && tracksOffset > offset)
+			{
+				UINT64 tracksId = 0, tracksSize = 0, tracksHeaderSize = 0;
+				if (SUCCEEDED(ReadElementHeader(pSource, tracksOffset, &tracksId, &tracksSize, &tracksHeaderSize)) && tracksId == _TracksId_)
+					IFR(parseElement(tracksId, tracksOffset + tracksHeaderSize, tracksSize));
+			}
+
+			IFR(parseElement(id, elementOffset, size));
+			break;
+		}
+
+		offset = elementOffset + size;
+	}
+
+	return m_keyframeTimes.empty() ? S_FALSE : S_OK;
+}
+
+
+_Use_decl_annotations_
+HRESULT CKeyframeIndex::Build(IByteSource* pSource)
+{
+	NULL_CHK(pSource);
+
+	Clear();
+
+	if (pSource->GetSize() < 8)
+		return S_FALSE;
+
+	BYTE header[8] = {};
+	IFR(pSource->Read(0, header, sizeof(header)));
+
+	CByteReader reader(header, sizeof(header));
+	UINT32 first = reader.ReadU32();
+	UINT32 type = reader.ReadU32();
+
+	HRESULT hr = S_FALSE;
+	if (first == _EbmlHeaderId_)
+	{
+		hr = BuildMatroska(pSource);
+	}
+	else if (type == _FourCC_('f', 't', 'y', 'p') || type == _FourCC_('s', 't', 'y', 'p') || type == _FourCC_('m', 'o', 'o', 'v') ||
+		type == _FourCC_('s', 'i', 'd', 'x') || type == _FourCC_('f', 'r', 'e', 'e') || type == _FourCC_('w', 'i', 'd', 'e'))
+	{
+		hr = BuildMp4(pSource);
+	}
+
+	if (FAILED(hr))
+	{
+		Clear();
+		return hr;
+	}
+
+	// keyframes before the first edit are still where decoding of the start begins
+	for (auto& time : m_keyframeTimes)
+	{
+		time = std::max<INT64>(time, 0);
+	}
+
+	std::sort(m_keyframeTimes.begin(), m_keyframeTimes.end());
+	m_keyframeTimes.erase(std::unique(m_keyframeTimes.begin(), m_keyframeTimes.end()), m_keyframeTimes.end());
+
+	return IsIndexed() ? S_OK : S_FALSE;
+}
+
+_Use_decl_annotations_
+INT64 CKeyframeIndex::FindSeekPosition(INT64 position, SeekMode mode) const
+{
+	if (mode == SeekMode::SeekMode_Accurate || m_keyframeTimes.empty() || m_everySampleIsSync)
+		return position;
+
+	auto next = std::upper_bound(m_keyframeTimes.begin(), m_keyframeTimes.end(), position);
+	if (next == m_keyframeTimes.begin())
+		return m_keyframeTimes.front();
+
+	INT64 previous = *(next - 1);
+	if (mode == SeekMode::SeekMode_PreviousKeyframe || next == m_keyframeTimes.end())
+		return previous;
+
+	return (*next - position < position - previous) ? *next : previous;
+}
+
+
+_Use_decl_annotations_
+HRESULT GetFileKeyframeIndex(const std::wstring& path, std::shared_ptr<const CKeyframeIndex>* pIndex)
+{
+	NULL_CHK(pIndex);
+
+	static std::mutex s_cacheLock;
+	static CLruCache<std::wstring, std::shared_ptr<const CKeyframeIndex>> s_cache(_IndexCacheCapacity_);
+
+	CFileReader reader;
+	IFR(reader.Open(path));
+
+	// a rewritten file gets a new key, its old entry ages out
+	std::wstring key = path + L"|" + std::to_wstring(reader.GetSize()) + L"|" + std::to_wstring(reader.GetLastWriteTime());
+	{
+		std::lock_guard<std::mutex> lock(s_cacheLock);
+		if (s_cache.Get(key, pIndex))
+			return (*pIndex)->IsIndexed() ? S_OK : S_FALSE;
+	}
+
+	auto spIndex = std::make_shared<CKeyframeIndex>();
+	HRESULT hr = spIndex->Build(&reader);
+	if (FAILED(hr))
+		return hr;
+
+	*pIndex = spIndex;
+
+	std::lock_guard<std::mutex> lock(s_cacheLock);
+	s_cache.Put(key, *pIndex);
+
+	return hr;
+}
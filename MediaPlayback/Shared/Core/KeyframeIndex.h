@@ -0,0 +1,65 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Presentation times of the keyframes of the first video track of a local file, so seeks can land on a
+// keyframe instead of decoding up to the position.
+//
+// The index comes from what the container already carries: stss/stts/ctts of MP4, tfra, the sync flags of the
+// moof boxes or sidx of fragmented MP4, Cues of Matroska and WebM. The file is walked box by box (element by
+// element) through IByteSource, only the tables are read, never the media data.
+
+#include "CorePlatform.h"
+#include "PlaybackTypes.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+
+struct IByteSource;
+
+class CKeyframeIndex
+{
+public:
+	CKeyframeIndex() : m_everySampleIsSync(false) {}
+
+	// S_FALSE if the container is neither MP4 nor Matroska or does not index its video track
+	HRESULT Build(_In_ IByteSource* pSource);
+	void Clear() { m_keyframeTimes.clear(); m_everySampleIsSync = false; }
+
+	// Empty as well for tracks of nothing but keyframes, which IsEverySampleSync tells apart from unindexed ones
+	bool IsEmpty() const { return m_keyframeTimes.empty(); }
+	bool IsEverySampleSync() const { return m_everySampleIsSync; }
+	bool IsIndexed() const { return !m_keyframeTimes.empty() || m_everySampleIsSync; }
+
+	// 100ns units, ascending, without duplicates
+	const std::vector<INT64>& GetKeyframeTimes() const { return m_keyframeTimes; }
+
+	// Where a seek to position lands in the given mode; position itself for SeekMode_Accurate, without an index
+	// or when every sample is a keyframe
+	INT64 FindSeekPosition(_In_ INT64 position, _In_ SeekMode mode) const;
+
+private:
+	HRESULT BuildMp4(_In_ IByteSource* pSource);
+	HRESULT BuildMatroska(_In_ IByteSource* pSource);
+
+	std::vector<INT64> m_keyframeTimes;
+	bool m_everySampleIsSync;			// MP4 sample tables without stss, not listed in m_keyframeTimes
+};
+
+
+// Indexes the file, or returns the index an earlier call built while the file has not changed since.
+// Returns S_FALSE and an empty index for files without one.
+HRESULT GetFileKeyframeIndex(
+	_In_ const std::wstring& path,
+	_Out_ std::shared_ptr<const CKeyframeIndex>* pIndex);
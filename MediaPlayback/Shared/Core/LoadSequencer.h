@@ -0,0 +1,54 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Request ids for asynchronous loads. Only the most recent request is current:
+// starting a new one (or invalidating) cancels every request issued before it.
+// Workers poll IsCurrent() between steps and drop the result once it returns false.
+
+#include "CorePlatform.h"
+
+#include <atomic>
+
+
+class CLoadSequencer
+{
+public:
+	CLoadSequencer()
+		: m_latest(0)
+	{
+	}
+
+	// Returns the id of a new request, never 0
+	UINT32 Begin()
+	{
+		UINT32 id = m_latest.fetch_add(1) + 1;
+		if (id == 0)
+			id = m_latest.fetch_add(1) + 1; // wrapped around, 0 stays "no request"
+
+		return id;
+	}
+
+	// Cancels every pending request
+	void Invalidate()
+	{
+		Begin();
+	}
+
+	bool IsCurrent(_In_ UINT32 id) const
+	{
+		return id != 0 && m_latest.load() == id;
+	}
+
+private:
+	std::atomic<UINT32> m_latest;
+};
@@ -0,0 +1,113 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "LoopTracker.h"
+
+
+CLoopTracker::CLoopTracker()
+	: m_enabled(false)
+	, m_start(0)
+	, m_end(0)
+	, m_lastPosition(-1)
+	, m_lastFrameTime(0)
+	, m_frameInterval(0)
+	, m_seekIssued(false)
+	, m_loopCount(0)
+	, m_lastLoopGap(-1)
+	, m_maxLoopGap(-1)
+{
+}
+
+_Use_decl_annotations_
+HRESULT CLoopTracker::SetLoop(bool enabled, INT64 start, INT64 end)
+{
+	if (start < 0 || end < 0 || (end != 0 && start >= end))
+		return E_INVALIDARG;
+
+	m_enabled = enabled;
+	m_start = enabled ? start : 0;
+	m_end = enabled ? end : 0;
+	m_seekIssued = false;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+bool CLoopTracker::OnFrame(INT64 position, INT64 now)
+{
+	bool wrapped = false;
+
+	if (m_lastPosition >= 0)
+	{
+		if (position < m_lastPosition)
+		{
+			// only a jump back to the loop start is a wrap, anything else is a seek of the client
+			wrapped = m_enabled && position <= m_start + m_frameInterval * 2;
+
+			if (wrapped)
+			{
+				INT64 gap = now - m_lastFrameTime;
+				if (gap < 0)
+					gap = 0;
+
+				m_loopCount++;
+				m_lastLoopGap = gap;
+				if (gap > m_maxLoopGap)
+					m_maxLoopGap = gap;
+			}
+
+			m_seekIssued = false;
+		}
+		else if (position > m_lastPosition)
+		{
+			m_frameInterval = position - m_lastPosition;
+		}
+	}
+
+	m_lastPosition = position;
+	m_lastFrameTime = now;
+
+	return wrapped;
+}
+
+_Use_decl_annotations_
+bool CLoopTracker::ShouldSeekToStart(INT64 position)
+{
+	if (!IsRange() || m_seekIssued || m_frameInterval == 0)
+		return false;
+
+	// a position before the start plays up to the end like any other
+	if (position + m_frameInterval < m_end)
+		return false;
+
+	m_seekIssued = true;
+
+	return true;
+}
+
+void CLoopTracker::Reset()
+{
+	m_lastPosition = -1;
+	m_lastFrameTime = 0;
+	m_frameInterval = 0;
+	m_seekIssued = false;
+}
+
+_Use_decl_annotations_
+void CLoopTracker::GetStats(LOOP_STATS* pStats) const
+{
+	pStats->enabled = m_enabled ? 1 : 0;
+	pStats->loopCount = m_loopCount;
+	pStats->loopStart = m_start;
+	pStats->loopEnd = m_end;
+	pStats->lastLoopGap = m_lastLoopGap;
+	pStats->maxLoopGap = m_maxLoopGap;
+}
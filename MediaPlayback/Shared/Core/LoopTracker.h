@@ -0,0 +1,61 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Seamless loop of the whole media or of a [start, end) range. The session wraps without stopping: the whole media
+// loops natively, a range is sought back to its start one frame before its end so the start is decoded by the time
+// the end is reached. Players feed the position of every frame presented to detect the wraps and measure their gap.
+//
+// Not thread safe, players guard it with their own lock.
+
+#include "CorePlatform.h"
+#include "PlaybackTypes.h"
+
+
+class CLoopTracker
+{
+public:
+	CLoopTracker();
+
+	// end 0 loops the whole media, otherwise start must be before end
+	HRESULT SetLoop(_In_ bool enabled, _In_ INT64 start, _In_ INT64 end);
+
+	bool IsEnabled() const { return m_enabled; }
+	bool IsRange() const { return m_enabled && m_end != 0; }
+	INT64 GetStart() const { return m_start; }
+	INT64 GetEnd() const { return m_end; }
+
+	// Position of a frame presented at time now; true if it is the first one after a wrap
+	bool OnFrame(_In_ INT64 position, _In_ INT64 now);
+
+	// True once per wrap when the frame after position would reach the range end, the player seeks to the start then
+	bool ShouldSeekToStart(_In_ INT64 position);
+
+	// A new source, or a seek of the client: the next frame does not follow the previous one
+	void Reset();
+
+	void GetStats(_Out_ LOOP_STATS* pStats) const;
+
+private:
+	bool m_enabled;
+	INT64 m_start;
+	INT64 m_end;
+
+	INT64 m_lastPosition;			// -1 if no frame since Reset
+	INT64 m_lastFrameTime;
+	INT64 m_frameInterval;			// media time between the last two frames, 0 if not known
+	bool m_seekIssued;
+
+	UINT32 m_loopCount;
+	INT64 m_lastLoopGap;
+	INT64 m_maxLoopGap;
+};
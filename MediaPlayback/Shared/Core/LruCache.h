@@ -0,0 +1,96 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Fixed capacity key/value cache evicting the least recently used entry.
+// Not thread safe, owners serialize access.
+
+#include "CorePlatform.h"
+
+#include <stddef.h>
+
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+
+template <typename TKey, typename TValue, typename THash = std::hash<TKey>>
+class CLruCache
+{
+public:
+	explicit CLruCache(_In_ size_t capacity)
+		: m_capacity(capacity ? capacity : 1)
+	{
+	}
+
+	size_t GetCapacity() const { return m_capacity; }
+	size_t GetCount() const { return m_index.size(); }
+
+	// Returns false if there is no entry for the key; a hit makes the entry the most recently used one
+	bool Get(_In_ const TKey& key, _Out_ TValue* pValue)
+	{
+		auto it = m_index.find(key);
+		if (it == m_index.end())
+			return false;
+
+		m_entries.splice(m_entries.begin(), m_entries, it->second);
+		*pValue = it->second->second;
+
+		return true;
+	}
+
+	void Put(_In_ const TKey& key, _In_ const TValue& value)
+	{
+		auto it = m_index.find(key);
+		if (it != m_index.end())
+		{
+			it->second->second = value;
+			m_entries.splice(m_entries.begin(), m_entries, it->second);
+			return;
+		}
+
+		if (m_index.size() >= m_capacity)
+		{
+			m_index.erase(m_entries.back().first);
+			m_entries.pop_back();
+		}
+
+		m_entries.push_front(std::make_pair(key, value));
+		m_index[key] = m_entries.begin();
+	}
+
+	bool Remove(_In_ const TKey& key)
+	{
+		auto it = m_index.find(key);
+		if (it == m_index.end())
+			return false;
+
+		m_entries.erase(it->second);
+		m_index.erase(it);
+
+		return true;
+	}
+
+	void Clear()
+	{
+		m_index.clear();
+		m_entries.clear();
+	}
+
+private:
+	typedef std::list<std::pair<TKey, TValue>> EntryList;
+
+	EntryList m_entries;	// most recently used first
+	std::unordered_map<TKey, typename EntryList::iterator, THash> m_index;
+	size_t m_capacity;
+};
@@ -0,0 +1,971 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ManifestParser.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <utility>
+
+#define _HnsPerSecond_ 10000000ll
+
+// durations beyond this are damage, it keeps their arithmetic in 100ns from overflowing
+#define _MaxDurationSeconds_ 900000000000ll
+
+// bounds what a damaged or hostile manifest can make us allocate
+#define _MaxManifestSegments_ 100000
+
+
+// URIs in manifests are ASCII (RFC 3986), other bytes are kept as they are
+static std::wstring Widen(const std::string& value)
+{
+	std::wstring wide;
+	wide.reserve(value.size());
+
+	for (char c : value)
+	{
+		wide.push_back((wchar_t)(unsigned char)c);
+	}
+
+	return wide;
+}
+
+static std::string Trim(const std::string& value)
+{
+	size_t start = value.find_first_not_of(" \t\r\n");
+	if (start == std::string::npos)
+		return std::string();
+
+	size_t end = value.find_last_not_of(" \t\r\n");
+	return value.substr(start, end - start + 1);
+}
+
+static bool StartsWith(const std::string& value, const char* prefix)
+{
+	return value.compare(0, strlen(prefix), prefix) == 0;
+}
+
+static bool ParseUInt64(const std::string& value, UINT64* pValue)
+{
+	if (value.empty())
+		return false;
+
+	UINT64 result = 0;
+	for (char c : value)
+	{
+		if (c < '0' || c > '9')
+			return false;
+
+		if (result > (ULLONG_MAX - (UINT64)(c - '0')) / 10)
+			return false;
+
+		result = result * 10 + (UINT64)(c - '0');
+	}
+
+	*pValue = result;
+
+	return true;
+}
+
+static bool ParseInt64(const std::string& value, INT64* pValue)
+{
+	bool negative = !value.empty() && value[0] == '-';
+
+	UINT64 magnitude = 0;
+	if (!ParseUInt64(negative ? value.substr(1) : value, &magnitude))
+		return false;
+
+	if (magnitude > (UINT64)LLONG_MAX)
+		return false;
+
+	*pValue = negative ? -(INT64)magnitude : (INT64)magnitude;
+
+	return true;
+}
+
+// Decimal seconds ("10", "9.009") to 100ns, independent of the C locale
+static bool ParseSeconds(const std::string& value, INT64* pDuration)
+{
+	size_t dot = value.find('.');
+
+	UINT64 seconds = 0;
+	if (!ParseUInt64(value.substr(0, dot), &seconds) && dot != 0)
+		return false;
+
+	if (seconds > _MaxDurationSeconds_)
+		return false;
+
+	INT64 duration = (INT64)seconds * _HnsPerSecond_;
+
+	if (dot != std::string::npos)
+	{
+		INT64 scale = _HnsPerSecond_ / 10;
+		for (size_t i = dot + 1; i < value.size(); i++)
+		{
+			if (value[i] < '0' || value[i] > '9')
+				return false;
+
+			duration += (value[i] - '0') * scale;
+			scale /= 10;
+		}
+	}
+
+	*pDuration = duration;
+
+	return true;
+}
+
+// ISO 8601 durations as MPDs use them, e.g. "PT1H2M3.5S"; years and months are not used for media durations
+static bool ParseIsoDuration(const std::string& value, INT64* pDuration)
+{
+	if (value.empty() || value[0] != 'P')
+		return false;
+
+	INT64 duration = 0;
+	bool isTime = false;
+	std::string number;
+
+	for (size_t i = 1; i < value.size(); i++)
+	{
+		char c = value[i];
+		if ((c >= '0' && c <= '9') || c == '.')
+		{
+			number.push_back(c);
+			continue;
+		}
+
+		if (c == 'T')
+		{
+			isTime = true;
+			continue;
+		}
+
+		INT64 amount = 0;
+		if (!ParseSeconds(number, &amount))
+			return false;
+
+		number.clear();
+
+		INT64 multiplier;
+		if (c == 'D' && !isTime)
+			multiplier = 86400;
+		else if (c == 'H' && isTime)
+			multiplier = 3600;
+		else if (c == 'M' && isTime)
+			multiplier = 60;
+		else if (c == 'S' && isTime)
+			multiplier = 1;
+		else
+			return false;
+
+		if (amount > (_MaxDurationSeconds_ * _HnsPerSecond_ - duration) / multiplier)
+			return false;
+
+		duration += amount * multiplier;
+	}
+
+	*pDuration = duration;
+
+	return number.empty();
+}
+
+static std::wstring RemoveDotSegments(const std::wstring& path)
+{
+	std::vector<std::wstring> segments;
+	bool trailingSlash = false;
+
+	size_t start = 0;
+	while (start <= path.size())
+	{
+		size_t end = path.find(L'/', start);
+		if (end == std::wstring::npos)
+			end = path.size();
+
+		std::wstring segment = path.substr(start, end - start);
+		bool isLast = (end == path.size());
+
+		if (segment == L"..")
+		{
+			if (segments.size() > 1)
+				segments.pop_back();
+			trailingSlash = isLast;
+		}
+		else if (segment == L".")
+		{
+			trailingSlash = isLast;
+		}
+		else if (!segment.empty() || start == 0 || isLast)
+		{
+			segments.push_back(segment);
+			trailingSlash = false;
+		}
+
+		start = end + 1;
+	}
+
+	std::wstring result;
+	for (size_t i = 0; i < segments.size(); i++)
+	{
+		if (i > 0)
+			result.push_back(L'/');
+
+		result += segments[i];
+	}
+
+	if (trailingSlash)
+		result.push_back(L'/');
+
+	return result;
+}
+
+_Use_decl_annotations_
+std::wstring ResolveUri(const std::wstring& baseUri, const std::wstring& reference)
+{
+	if (reference.empty())
+		return baseUri;
+
+	// absolute: a scheme in front of any path, query or fragment delimiter
+	size_t colon = reference.find(L':');
+	if (colon != std::wstring::npos && colon > 0 && reference.find_first_of(L"/?#") > colon)
+		return reference;
+
+	size_t schemeEnd = baseUri.find(L"://");
+	if (schemeEnd == std::wstring::npos)
+		return reference;
+
+	std::wstring scheme = baseUri.substr(0, schemeEnd);
+	if (reference.compare(0, 2, L"//") == 0)
+		return scheme + L":" + reference;
+
+	size_t pathStart = baseUri.find_first_of(L"/?#", schemeEnd + 3);
+	std::wstring origin = baseUri.substr(0, pathStart);
+
+	std::wstring basePath;
+	if (pathStart != std::wstring::npos && baseUri[pathStart] == L'/')
+		basePath = baseUri.substr(pathStart, baseUri.find_first_of(L"?#", pathStart) - pathStart);
+
+	size_t queryStart = reference.find_first_of(L"?#");
+	std::wstring referencePath = reference.substr(0, queryStart);
+	std::wstring query = (queryStart == std::wstring::npos) ? std::wstring() : reference.substr(queryStart);
+
+	if (referencePath.empty())
+		return origin + (basePath.empty() ? L"/" : basePath) + query;
+
+	if (referencePath[0] == L'/')
+		return origin + RemoveDotSegments(referencePath) + query;
+
+	std::wstring directory = basePath.substr(0, basePath.rfind(L'/') + 1);
+	if (directory.empty())
+		directory = L"/";
+
+	return origin + RemoveDotSegments(directory + referencePath) + query;
+}
+
+
+// HLS
+
+// KEY=VALUE,KEY="quoted, value" as in #EXT-X-MAP and #EXT-X-MEDIA
+static std::string GetHlsAttribute(const std::string& attributes, const char* name)
+{
+	size_t pos = 0;
+	while (pos < attributes.size())
+	{
+		size_t equals = attributes.find('=', pos);
+		if (equals == std::string::npos)
+			break;
+
+		std::string key = Trim(attributes.substr(pos, equals - pos));
+
+		std::string value;
+		size_t next;
+		if (equals + 1 < attributes.size() && attributes[equals + 1] == '"')
+		{
+			size_t quote = attributes.find('"', equals + 2);
+			if (quote == std::string::npos)
+				quote = attributes.size();
+
+			value = attributes.substr(equals + 2, quote - equals - 2);
+			next = attributes.find(',', quote);
+		}
+		else
+		{
+			next = attributes.find(',', equals);
+			value = Trim(attributes.substr(equals + 1, next == std::string::npos ? std::string::npos : next - equals - 1));
+		}
+
+		if (key == name)
+			return value;
+
+		if (next == std::string::npos)
+			break;
+
+		pos = next + 1;
+	}
+
+	return std::string();
+}
+
+// "length[@offset]"; without an offset the range follows the previous range of the same resource
+// "30", "29.970" or "30000/1001", rounded up
+static UINT32 ParseFrameRate(const std::string& value)
+{
+	double rate = strtod(value.c_str(), nullptr);
+
+	size_t slash = value.find('/');
+	if (slash != std::string::npos)
+	{
+		double divisor = strtod(value.c_str() + slash + 1, nullptr);
+		rate = (divisor > 0) ? rate / divisor : 0;
+	}
+
+	return (rate > 0 && rate < 1000) ? (UINT32)(rate + 0.999) : 0;
+}
+
+// "1920x1080"
+static void ParseResolution(const std::string& value, UINT32* pWidth, UINT32* pHeight)
+{
+	size_t separator = value.find('x');
+	if (separator == std::string::npos)
+		return;
+
+	UINT64 width = 0;
+	UINT64 height = 0;
+	if (ParseUInt64(value.substr(0, separator), &width) && ParseUInt64(value.substr(separator + 1), &height) && width <= UINT_MAX && height <= UINT_MAX)
+	{
+		*pWidth = (UINT32)width;
+		*pHeight = (UINT32)height;
+	}
+}
+
+static RENDITION_INFO MakeRendition(UINT64 bandwidth)
+{
+	RENDITION_INFO rendition = {};
+	rendition.bitrate = (UINT32)(bandwidth < UINT_MAX ? bandwidth : UINT_MAX);
+	rendition.codec = VideoCodec::VideoCodec_Unknown;
+
+	return rendition;
+}
+
+static bool ParseHlsByteRange(const std::string& value, UINT64 previousEnd, UINT64* pOffset, UINT64* pLength)
+{
+	size_t at = value.find('@');
+
+	if (!ParseUInt64(Trim(value.substr(0, at)), pLength))
+		return false;
+
+	*pOffset = previousEnd;
+	if (at != std::string::npos && !ParseUInt64(Trim(value.substr(at + 1)), pOffset))
+		return false;
+
+	return true;
+}
+
+static HRESULT ParseHlsPlaylist(const std::string& text, const std::wstring& playlistUri, MANIFEST* pManifest)
+{
+	MANIFEST_REPRESENTATION representation;
+	representation.id = playlistUri;
+	representation.bandwidth = 0;
+
+	INT64 segmentDuration = 0;
+	bool hasRange = false;
+	UINT64 rangeOffset = 0, rangeLength = 0;
+	UINT64 previousRangeEnd = 0;
+	bool expectVariantUri = false;
+	std::wstring currentMapKey;
+
+	size_t pos = 0;
+	while (pos < text.size())
+	{
+		size_t end = text.find('\n', pos);
+		if (end == std::string::npos)
+			end = text.size();
+
+		std::string line = Trim(text.substr(pos, end - pos));
+		pos = end + 1;
+
+		if (line.empty())
+			continue;
+
+		if (line[0] != '#')
+		{
+			std::wstring uri = ResolveUri(playlistUri, Widen(line));
+
+			if (expectVariantUri)
+			{
+				pManifest->playlistUris.push_back(uri);
+				expectVariantUri = false;
+				continue;
+			}
+
+			if (representation.segments.size() >= _MaxManifestSegments_)
+				break;
+
+			MANIFEST_SEGMENT segment;
+			segment.key.uri = uri;
+			segment.key.rangeOffset = hasRange ? rangeOffset : 0;
+			segment.key.rangeLength = hasRange ? rangeLength : 0;
+			segment.duration = segmentDuration;
+			representation.segments.push_back(segment);
+
+			if (hasRange)
+				previousRangeEnd = rangeOffset + rangeLength;
+
+			segmentDuration = 0;
+			hasRange = false;
+		}
+		else if (StartsWith(line, "#EXTINF:"))
+		{
+			std::string duration = line.substr(8, line.find(',') == std::string::npos ? std::string::npos : line.find(',') - 8);
+			if (!ParseSeconds(Trim(duration), &segmentDuration))
+				segmentDuration = 0;
+		}
+		else if (StartsWith(line, "#EXT-X-BYTERANGE:"))
+		{
+			// an offset-less range continues the previous range, playlists use that form for one resource only
+			hasRange = ParseHlsByteRange(line.substr(17), previousRangeEnd, &rangeOffset, &rangeLength);
+		}
+		else if (StartsWith(line, "#EXT-X-MAP:"))
+		{
+			std::string attributes = line.substr(11);
+			std::string uri = GetHlsAttribute(attributes, "URI");
+			if (uri.empty())
+				continue;
+
+			MANIFEST_SEGMENT segment;
+			segment.key.uri = ResolveUri(playlistUri, Widen(uri));
+			segment.key.rangeOffset = 0;
+			segment.key.rangeLength = 0;
+			segment.duration = 0;
+
+			std::string byteRange = GetHlsAttribute(attributes, "BYTERANGE");
+			if (!byteRange.empty())
+				ParseHlsByteRange(byteRange, 0, &segment.key.rangeOffset, &segment.key.rangeLength);
+
+			// repeated only at discontinuities that change the initialization
+			std::wstring mapKey = CSegmentCache::GetLookupKey(segment.key);
+			if (mapKey != currentMapKey && representation.segments.size() < _MaxManifestSegments_)
+			{
+				representation.segments.push_back(segment);
+				currentMapKey = mapKey;
+			}
+		}
+		else if (StartsWith(line, "#EXT-X-STREAM-INF:"))
+		{
+			std::string attributes = line.substr(18);
+
+			UINT64 bandwidth = 0;
+			ParseUInt64(GetHlsAttribute(attributes, "BANDWIDTH"), &bandwidth);
+
+			RENDITION_INFO rendition = MakeRendition(bandwidth);
+			ParseResolution(GetHlsAttribute(attributes, "RESOLUTION"), &rendition.width, &rendition.height);
+			rendition.frameRate = ParseFrameRate(GetHlsAttribute(attributes, "FRAME-RATE"));
+			ParseCodecList(GetHlsAttribute(attributes, "CODECS"), &rendition);
+			pManifest->renditions.push_back(rendition);
+
+			expectVariantUri = true;
+		}
+		else if (StartsWith(line, "#EXT-X-MEDIA:"))
+		{
+			std::string uri = GetHlsAttribute(line.substr(13), "URI");
+			if (!uri.empty())
+				pManifest->playlistUris.push_back(ResolveUri(playlistUri, Widen(uri)));
+		}
+	}
+
+	if (!representation.segments.empty())
+		pManifest->representations.push_back(std::move(representation));
+
+	return S_OK;
+}
+
+
+// DASH
+
+typedef struct _TIMELINE_ENTRY
+{
+	bool hasTime;
+	UINT64 time;
+	UINT64 duration;
+	INT64 repeat;				// -1 repeats until the end of the period
+} TIMELINE_ENTRY;
+
+typedef struct _DASH_TEMPLATE
+{
+	std::string media;
+	std::string initialization;
+	UINT64 startNumber;
+	UINT64 timescale;
+	UINT64 duration;
+	bool hasTimeline;
+	std::vector<TIMELINE_ENTRY> timeline;
+} DASH_TEMPLATE;
+
+typedef std::vector<std::pair<std::string, std::string>> XmlAttributes;
+
+// MPD, Period, AdaptationSet and Representation elements, each inheriting from the enclosing one
+typedef struct _DASH_LEVEL
+{
+	std::string element;
+	XmlAttributes attributes;
+	std::wstring baseUri;
+	DASH_TEMPLATE segmentTemplate;
+} DASH_LEVEL;
+
+static std::string DecodeXmlEntities(const std::string& value)
+{
+	if (value.find('&') == std::string::npos)
+		return value;
+
+	static const struct { const char* entity; char c; } entities[] =
+	{
+		{ "&amp;", '&' }, { "&lt;", '<' }, { "&gt;", '>' }, { "&quot;", '"' }, { "&apos;", '\'' }
+	};
+
+	std::string decoded;
+	for (size_t i = 0; i < value.size(); i++)
+	{
+		bool replaced = false;
+		if (value[i] == '&')
+		{
+			for (const auto& entity : entities)
+			{
+				size_t length = strlen(entity.entity);
+				if (value.compare(i, length, entity.entity) == 0)
+				{
+					decoded.push_back(entity.c);
+					i += length - 1;
+					replaced = true;
+					break;
+				}
+			}
+		}
+
+		if (!replaced)
+			decoded.push_back(value[i]);
+	}
+
+	return decoded;
+}
+
+static std::string GetXmlAttribute(const XmlAttributes& attributes, const char* name)
+{
+	for (const auto& attribute : attributes)
+	{
+		if (attribute.first == name)
+			return attribute.second;
+	}
+
+	return std::string();
+}
+
+// $RepresentationID$, $Number$, $Time$ and $Bandwidth$, with an optional %0<width>d format
+static std::wstring ExpandDashTemplate(const std::string& pattern, const std::string& representationId, UINT32 bandwidth, UINT64 number, UINT64 time)
+{
+	std::string expanded;
+
+	size_t pos = 0;
+	while (pos < pattern.size())
+	{
+		size_t start = pattern.find('$', pos);
+		size_t end = (start == std::string::npos) ? std::string::npos : pattern.find('$', start + 1);
+		if (end == std::string::npos)
+		{
+			expanded += pattern.substr(pos);
+			break;
+		}
+
+		expanded += pattern.substr(pos, start - pos);
+		pos = end + 1;
+
+		std::string identifier = pattern.substr(start + 1, end - start - 1);
+		if (identifier.empty())
+		{
+			expanded.push_back('$');
+			continue;
+		}
+
+		size_t width = 0;
+		size_t format = identifier.find('%');
+		if (format != std::string::npos)
+		{
+			UINT64 parsedWidth = 0;
+			std::string widthText = identifier.substr(format + 1);
+			if (widthText.size() > 2 && widthText[0] == '0' && widthText.back() == 'd' && ParseUInt64(widthText.substr(1, widthText.size() - 2), &parsedWidth))
+				width = (size_t)(parsedWidth < 32 ? parsedWidth : 32);
+
+			identifier = identifier.substr(0, format);
+		}
+
+		std::string value;
+		if (identifier == "RepresentationID")
+			value = representationId;
+		else if (identifier == "Number")
+			value = std::to_string(number);
+		else if (identifier == "Time")
+			value = std::to_string(time);
+		else if (identifier == "Bandwidth")
+			value = std::to_string(bandwidth);
+		else
+			value = "$" + identifier + "$";
+
+		if (value.size() < width)
+			value.insert(0, width - value.size(), '0');
+
+		expanded += value;
+	}
+
+	return Widen(expanded);
+}
+
+static void AddDashRepresentation(
+	const DASH_LEVEL& level,
+	const std::wstring& manifestUri,
+	UINT32 periodIndex,
+	INT64 periodDuration,
+	bool isDynamic,
+	MANIFEST* pManifest)
+{
+	const DASH_TEMPLATE& segmentTemplate = level.segmentTemplate;
+	if (segmentTemplate.media.empty() || !segmentTemplate.timescale)
+		return;
+
+	std::string id = GetXmlAttribute(level.attributes, "id");
+	UINT64 bandwidth = 0;
+	ParseUInt64(GetXmlAttribute(level.attributes, "bandwidth"), &bandwidth);
+
+	MANIFEST_REPRESENTATION representation;
+	representation.id = manifestUri + L"#" + std::to_wstring(periodIndex) + L"/" + Widen(id);
+	representation.bandwidth = (UINT32)bandwidth;
+
+	if (!segmentTemplate.initialization.empty())
+	{
+		MANIFEST_SEGMENT segment;
+		segment.key.uri = ResolveUri(level.baseUri, ExpandDashTemplate(segmentTemplate.initialization, id, representation.bandwidth, 0, 0));
+		segment.key.rangeOffset = 0;
+		segment.key.rangeLength = 0;
+		segment.duration = 0;
+		representation.segments.push_back(segment);
+	}
+
+	auto addSegment = [&](UINT64 number, UINT64 time, UINT64 duration)
+	{
+		MANIFEST_SEGMENT segment;
+		segment.key.uri = ResolveUri(level.baseUri, ExpandDashTemplate(segmentTemplate.media, id, representation.bandwidth, number, time));
+		segment.key.rangeOffset = 0;
+		segment.key.rangeLength = 0;
+		segment.duration = (INT64)(duration * _HnsPerSecond_ / segmentTemplate.timescale);
+		representation.segments.push_back(segment);
+	};
+
+	// in timescale units, 0 if not known
+	UINT64 periodEnd = (periodDuration > 0) ? (UINT64)periodDuration * segmentTemplate.timescale / _HnsPerSecond_ : 0;
+
+	if (segmentTemplate.hasTimeline)
+	{
+		UINT64 number = segmentTemplate.startNumber;
+		UINT64 time = 0;
+
+		for (const TIMELINE_ENTRY& entry : segmentTemplate.timeline)
+		{
+			if (entry.hasTime)
+				time = entry.time;
+
+			if (!entry.duration)
+				continue;
+
+			INT64 repeat = entry.repeat;
+			if (repeat < 0)
+				repeat = (periodEnd > time) ? (INT64)((periodEnd - time + entry.duration - 1) / entry.duration) - 1 : 0;
+
+			for (INT64 i = 0; i <= repeat && representation.segments.size() < _MaxManifestSegments_; i++)
+			{
+				addSegment(number++, time, entry.duration);
+				time += entry.duration;
+			}
+		}
+	}
+	else if (segmentTemplate.duration && periodEnd && !isDynamic)
+	{
+		UINT64 count = (periodEnd + segmentTemplate.duration - 1) / segmentTemplate.duration;
+		for (UINT64 i = 0; i < count && representation.segments.size() < _MaxManifestSegments_; i++)
+		{
+			addSegment(segmentTemplate.startNumber + i, i * segmentTemplate.duration, segmentTemplate.duration);
+		}
+	}
+
+	if (representation.segments.size() > (segmentTemplate.initialization.empty() ? 0u : 1u))
+		pManifest->representations.push_back(std::move(representation));
+}
+
+// Representation attribute, or the AdaptationSet one it inherits
+static std::string GetDashAttribute(const DASH_LEVEL& representation, const DASH_LEVEL* pAdaptationSet, const char* name)
+{
+	std::string value = GetXmlAttribute(representation.attributes, name);
+	if (value.empty() && pAdaptationSet)
+		value = GetXmlAttribute(pAdaptationSet->attributes, name);
+
+	return value;
+}
+
+static void AddDashRendition(const DASH_LEVEL& representation, const DASH_LEVEL* pAdaptationSet, MANIFEST* pManifest)
+{
+	std::string mimeType = GetDashAttribute(representation, pAdaptationSet, "mimeType");
+	std::string contentType = GetDashAttribute(representation, pAdaptationSet, "contentType");
+	if ((!mimeType.empty() && !StartsWith(mimeType, "video/")) || (!contentType.empty() && contentType != "video"))
+		return;
+
+	UINT64 bandwidth = 0;
+	ParseUInt64(GetXmlAttribute(representation.attributes, "bandwidth"), &bandwidth);
+
+	RENDITION_INFO rendition = MakeRendition(bandwidth);
+	bool isVideo = ParseCodecList(GetDashAttribute(representation, pAdaptationSet, "codecs"), &rendition);
+
+	UINT64 value = 0;
+	if (ParseUInt64(GetDashAttribute(representation, pAdaptationSet, "width"), &value) && value <= UINT_MAX)
+	{
+		rendition.width = (UINT32)value;
+		isVideo = true;
+	}
+	if (ParseUInt64(GetDashAttribute(representation, pAdaptationSet, "height"), &value) && value <= UINT_MAX)
+	{
+		rendition.height = (UINT32)value;
+		isVideo = true;
+	}
+	rendition.frameRate = ParseFrameRate(GetDashAttribute(representation, pAdaptationSet, "frameRate"));
+
+	// audio and subtitle representations without a mimeType
+	if (!isVideo && mimeType.empty() && contentType.empty())
+		return;
+
+	pManifest->renditions.push_back(rendition);
+}
+
+static HRESULT ParseDashManifest(const std::string& text, const std::wstring& manifestUri, MANIFEST* pManifest)
+{
+	std::vector<DASH_LEVEL> levels;
+	bool isDynamic = false;
+	INT64 presentationDuration = 0;
+	INT64 periodDuration = 0;
+	INT32 periodIndex = -1;
+	bool inTimeline = false;
+	size_t baseUrlTextStart = std::string::npos;
+
+	size_t pos = 0;
+	while ((pos = text.find('<', pos)) != std::string::npos)
+	{
+		size_t tagStart = pos;
+
+		if (text.compare(pos, 4, "<!--") == 0)
+		{
+			size_t end = text.find("-->", pos);
+			pos = (end == std::string::npos) ? text.size() : end + 3;
+			continue;
+		}
+
+		if (text.compare(pos, 2, "<?") == 0 || text.compare(pos, 2, "<!") == 0)
+		{
+			size_t end = text.find('>', pos);
+			pos = (end == std::string::npos) ? text.size() : end + 1;
+			continue;
+		}
+
+		size_t tagEnd = text.find('>', pos);
+		if (tagEnd == std::string::npos)
+			break;
+
+		bool isEnd = text[pos + 1] == '/';
+		bool isSelfClosing = text[tagEnd - 1] == '/';
+
+		std::string tag = text.substr(pos + (isEnd ? 2 : 1), tagEnd - pos - (isEnd ? 2 : 1) - (isSelfClosing ? 1 : 0));
+		pos = tagEnd + 1;
+
+		size_t nameEnd = tag.find_first_of(" \t\r\n");
+		std::string name = tag.substr(0, nameEnd);
+
+		// namespace prefixes, e.g. mpd:Period
+		size_t prefix = name.find(':');
+		if (prefix != std::string::npos)
+			name = name.substr(prefix + 1);
+
+		XmlAttributes attributes;
+		if (!isEnd && nameEnd != std::string::npos)
+		{
+			size_t attributePos = nameEnd;
+			while (attributePos < tag.size())
+			{
+				size_t equals = tag.find('=', attributePos);
+				if (equals == std::string::npos || equals + 1 >= tag.size())
+					break;
+
+				char quote = tag[equals + 1];
+				size_t valueEnd = (quote == '"' || quote == '\'') ? tag.find(quote, equals + 2) : std::string::npos;
+				if (valueEnd == std::string::npos)
+					break;
+
+				attributes.push_back(std::make_pair(
+					Trim(tag.substr(attributePos, equals - attributePos)),
+					DecodeXmlEntities(tag.substr(equals + 2, valueEnd - equals - 2))));
+
+				attributePos = valueEnd + 1;
+			}
+		}
+
+		bool isLevel = name == "MPD" || name == "Period" || name == "AdaptationSet" || name == "Representation";
+
+		if (!isEnd)
+		{
+			if (isLevel)
+			{
+				DASH_LEVEL level;
+				if (levels.empty())
+				{
+					level.baseUri = manifestUri;
+					level.segmentTemplate.startNumber = 1;
+					level.segmentTemplate.timescale = 1;
+					level.segmentTemplate.duration = 0;
+					level.segmentTemplate.hasTimeline = false;
+				}
+				else
+				{
+					level = levels.back();
+				}
+
+				level.element = name;
+				level.attributes = attributes;
+				levels.push_back(level);
+
+				if (name == "MPD")
+				{
+					isDynamic = GetXmlAttribute(attributes, "type") == "dynamic";
+					ParseIsoDuration(GetXmlAttribute(attributes, "mediaPresentationDuration"), &presentationDuration);
+				}
+				else if (name == "Period")
+				{
+					periodIndex++;
+
+					INT64 start = 0;
+					ParseIsoDuration(GetXmlAttribute(attributes, "start"), &start);
+					if (!ParseIsoDuration(GetXmlAttribute(attributes, "duration"), &periodDuration))
+						periodDuration = (presentationDuration > start) ? presentationDuration - start : 0;
+				}
+			}
+			else if (name == "SegmentTemplate" && !levels.empty())
+			{
+				DASH_TEMPLATE& segmentTemplate = levels.back().segmentTemplate;
+				UINT64 value = 0;
+
+				std::string media = GetXmlAttribute(attributes, "media");
+				if (!media.empty())
+					segmentTemplate.media = media;
+
+				std::string initialization = GetXmlAttribute(attributes, "initialization");
+				if (!initialization.empty())
+					segmentTemplate.initialization = initialization;
+
+				if (ParseUInt64(GetXmlAttribute(attributes, "startNumber"), &value))
+					segmentTemplate.startNumber = value;
+
+				if (ParseUInt64(GetXmlAttribute(attributes, "timescale"), &value) && value)
+					segmentTemplate.timescale = value;
+
+				if (ParseUInt64(GetXmlAttribute(attributes, "duration"), &value))
+					segmentTemplate.duration = value;
+			}
+			else if (name == "SegmentTimeline" && !levels.empty())
+			{
+				levels.back().segmentTemplate.hasTimeline = true;
+				levels.back().segmentTemplate.timeline.clear();
+				inTimeline = !isSelfClosing;
+			}
+			else if (name == "S" && inTimeline && !levels.empty())
+			{
+				TIMELINE_ENTRY entry;
+				entry.hasTime = ParseUInt64(GetXmlAttribute(attributes, "t"), &entry.time);
+				if (!entry.hasTime)
+					entry.time = 0;
+
+				if (!ParseUInt64(GetXmlAttribute(attributes, "d"), &entry.duration))
+					entry.duration = 0;
+
+				if (!ParseInt64(GetXmlAttribute(attributes, "r"), &entry.repeat))
+					entry.repeat = 0;
+
+				levels.back().segmentTemplate.timeline.push_back(entry);
+			}
+			else if (name == "BaseURL" && !isSelfClosing)
+			{
+				baseUrlTextStart = pos;
+			}
+
+		}
+
+		// the segments of a representation are known once all of its children have been seen
+		if ((isEnd || (isLevel && isSelfClosing)) && name == "Representation" && !levels.empty() && levels.back().element == name && periodIndex >= 0)
+		{
+			AddDashRepresentation(levels.back(), manifestUri, (UINT32)periodIndex, periodDuration, isDynamic, pManifest);
+
+			// the same renditions repeat in every period
+			if (periodIndex == 0)
+			{
+				const DASH_LEVEL* pAdaptationSet = (levels.size() > 1 && levels[levels.size() - 2].element == "AdaptationSet") ? &levels[levels.size() - 2] : nullptr;
+				AddDashRendition(levels.back(), pAdaptationSet, pManifest);
+			}
+		}
+
+		if (isEnd || isSelfClosing)
+		{
+			if (isEnd && name == "BaseURL" && baseUrlTextStart != std::string::npos && !levels.empty())
+			{
+				std::string baseUrl = Trim(DecodeXmlEntities(text.substr(baseUrlTextStart, tagStart - baseUrlTextStart)));
+				levels.back().baseUri = ResolveUri(levels.back().baseUri, Widen(baseUrl));
+				baseUrlTextStart = std::string::npos;
+			}
+			else if (name == "SegmentTimeline")
+			{
+				inTimeline = false;
+			}
+			else if (isLevel && !levels.empty() && levels.back().element == name)
+			{
+				levels.pop_back();
+			}
+		}
+	}
+
+	return S_OK;
+}
+
+
+_Use_decl_annotations_
+HRESULT ParseManifest(const BYTE* pData, size_t size, const std::wstring& manifestUri, MANIFEST* pManifest)
+{
+	NULL_CHK(pData);
+	NULL_CHK(pManifest);
+
+	pManifest->representations.clear();
+	pManifest->playlistUris.clear();
+	pManifest->renditions.clear();
+
+	std::string text((const char*)pData, size);
+
+	// UTF-8 byte order mark
+	if (StartsWith(text, "\xEF\xBB\xBF"))
+		text.erase(0, 3);
+
+	if (StartsWith(Trim(text), "#EXTM3U"))
+		return ParseHlsPlaylist(text, manifestUri, pManifest);
+
+	if (text.find("<MPD") != std::string::npos || text.find(":MPD") != std::string::npos)
+		return ParseDashManifest(text, manifestUri, pManifest);
+
+	return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+}
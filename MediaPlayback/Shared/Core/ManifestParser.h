@@ -0,0 +1,61 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Just enough of HLS playlists and DASH MPDs to know which segments follow the one the media source asks for.
+//
+// HLS: media playlists with #EXTINF, #EXT-X-BYTERANGE and #EXT-X-MAP; master playlists only list the playlists
+// to fetch next. DASH: SegmentTemplate with $Number$ or $Time$ addressing, with or without a SegmentTimeline,
+// inherited from the AdaptationSet. SegmentBase and SegmentList representations are skipped, as are templates
+// of live MPDs that have no timeline, their segment count is open ended.
+// Video renditions (bandwidth, resolution, frame rate, codecs) come from #EXT-X-STREAM-INF and Representations.
+// Segment URIs are resolved to absolute URIs, the way AdaptiveMediaSource reports them.
+
+#include "DecoderCapabilities.h"
+#include "SegmentCache.h"
+
+#include <string>
+#include <vector>
+
+
+typedef struct _MANIFEST_SEGMENT
+{
+	SEGMENT_KEY key;
+	INT64 duration;				// 100ns, 0 for initialization segments
+} MANIFEST_SEGMENT;
+
+typedef struct _MANIFEST_REPRESENTATION
+{
+	std::wstring id;			// HLS: the media playlist URI, DASH: the MPD URI, period and representation id
+	UINT32 bandwidth;
+	std::vector<MANIFEST_SEGMENT> segments;	// in playback order, initialization segments in front of the media segments using them
+} MANIFEST_REPRESENTATION;
+
+typedef struct _MANIFEST
+{
+	std::vector<MANIFEST_REPRESENTATION> representations;
+	std::vector<std::wstring> playlistUris;	// media playlists an HLS master playlist refers to
+	std::vector<RENDITION_INFO> renditions;	// video renditions, in manifest order
+} MANIFEST;
+
+
+// Fails with HRESULT_FROM_WIN32(ERROR_INVALID_DATA) for anything that is neither an HLS playlist nor an MPD
+HRESULT ParseManifest(
+	_In_ const BYTE* pData,
+	_In_ size_t size,
+	_In_ const std::wstring& manifestUri,
+	_Out_ MANIFEST* pManifest);
+
+// RFC 3986 reference resolution, reference may be absolute already
+std::wstring ResolveUri(
+	_In_ const std::wstring& baseUri,
+	_In_ const std::wstring& reference);
@@ -0,0 +1,149 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "MediaDeviceService.h"
+
+
+_Use_decl_annotations_
+CMediaDeviceService::CMediaDeviceService(const std::shared_ptr<IMediaDeviceFactory>& spFactory)
+	: m_spFactory(spFactory)
+	, m_shutdown(false)
+	, m_devicesCreated(0)
+	, m_acquires(0)
+	, m_deviceLosses(0)
+	, m_lastCreationTime(0)
+	, m_maxCreationTime(0)
+{
+}
+
+_Use_decl_annotations_
+HRESULT CMediaDeviceService::Acquire(UINT64 adapterId, std::shared_ptr<IMediaDevice>* pspDevice)
+{
+	NULL_CHK(pspDevice);
+	NULL_CHK(m_spFactory);
+
+	pspDevice->reset();
+
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	if (m_shutdown)
+		return E_ILLEGAL_METHOD_CALL;
+
+	auto it = m_devices.find(adapterId);
+	if (it == m_devices.end())
+	{
+		// players wait for the device on the lock, creating it once is the point
+		INT64 start = CoreNow();
+
+		DEVICE_ENTRY entry = {};
+		IFR(m_spFactory->CreateDevice(adapterId, &entry.spDevice));
+		NULL_CHK(entry.spDevice);
+
+		m_lastCreationTime = CoreNow() - start;
+		if (m_lastCreationTime > m_maxCreationTime)
+			m_maxCreationTime = m_lastCreationTime;
+		m_devicesCreated++;
+
+		it = m_devices.insert(std::make_pair(adapterId, entry)).first;
+	}
+
+	it->second.references++;
+	m_acquires++;
+
+	*pspDevice = it->second.spDevice;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+void CMediaDeviceService::Release(const std::shared_ptr<IMediaDevice>& spDevice)
+{
+	if (!spDevice)
+		return;
+
+	std::shared_ptr<IMediaDevice> spDestroyed;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		auto it = m_devices.find(spDevice->GetAdapterId());
+		if (it == m_devices.end() || it->second.spDevice != spDevice)
+			return;
+
+		if (--it->second.references == 0)
+		{
+			spDestroyed = it->second.spDevice;
+			m_devices.erase(it);
+		}
+	}
+
+	// destroyed outside the lock, other adapters keep going
+	spDestroyed.reset();
+}
+
+void CMediaDeviceService::Shutdown()
+{
+	std::map<UINT64, DEVICE_ENTRY> devices;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		if (!m_shutdown)
+		{
+			m_shutdown = true;
+			m_deviceLosses++;
+		}
+
+		devices.swap(m_devices);
+	}
+
+	devices.clear();
+}
+
+void CMediaDeviceService::Ready()
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	m_shutdown = false;
+}
+
+_Use_decl_annotations_
+void CMediaDeviceService::GetStats(MEDIA_DEVICE_STATS* pStats)
+{
+	if (pStats == nullptr)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	MEDIA_DEVICE_STATS stats = {};
+	stats.devices = (UINT32)m_devices.size();
+	for (auto it = m_devices.begin(); it != m_devices.end(); ++it)
+		stats.references += it->second.references;
+	stats.devicesCreated = m_devicesCreated;
+	stats.acquires = m_acquires;
+	stats.deviceLosses = m_deviceLosses;
+	stats.lastCreationTime = m_lastCreationTime;
+	stats.maxCreationTime = m_maxCreationTime;
+
+	*pStats = stats;
+}
+
+
+_Use_decl_annotations_
+HRESULT CSoftwareMediaDeviceFactory::CreateDevice(UINT64 adapterId, std::shared_ptr<IMediaDevice>* pspDevice)
+{
+	NULL_CHK(pspDevice);
+
+	if (m_failCreation)
+		return E_FAIL;
+
+	*pspDevice = std::make_shared<CSoftwareMediaDevice>(adapterId, m_devicesCreated++);
+
+	return S_OK;
+}
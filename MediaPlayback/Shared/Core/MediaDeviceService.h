@@ -0,0 +1,114 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Media devices shared by every player, one per graphics adapter.
+//
+// The first player acquiring the device of an adapter has it created by the factory, the ones after it get the same
+// device and add a reference; the device is destroyed with its last reference. A graphics device loss is handled
+// here once for all players: Shutdown drops every device, references not released yet included, and makes Acquire
+// fail until Ready, when the first player to reacquire creates the new device. Thread safe.
+
+#include "PlaybackTypes.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+
+struct IMediaDevice
+{
+	virtual ~IMediaDevice() {}
+
+	virtual UINT64 GetAdapterId() const = 0;
+};
+
+struct IMediaDeviceFactory
+{
+	virtual ~IMediaDeviceFactory() {}
+
+	// Creates the media device of an adapter, called under the service lock with no other device of the adapter alive
+	virtual HRESULT CreateDevice(_In_ UINT64 adapterId, _Out_ std::shared_ptr<IMediaDevice>* pspDevice) = 0;
+};
+
+
+class CMediaDeviceService
+{
+public:
+	explicit CMediaDeviceService(_In_ const std::shared_ptr<IMediaDeviceFactory>& spFactory);
+
+	// The device of the adapter, created if no player holds it. Every successful call takes a reference Release drops.
+	HRESULT Acquire(_In_ UINT64 adapterId, _Out_ std::shared_ptr<IMediaDevice>* pspDevice);
+
+	// Drops a reference, the device is destroyed with the last one. Devices Shutdown dropped already are ignored.
+	void Release(_In_ const std::shared_ptr<IMediaDevice>& spDevice);
+
+	// Graphics device loss, every device is dropped and Acquire fails with E_ILLEGAL_METHOD_CALL until Ready
+	void Shutdown();
+	void Ready();
+
+	void GetStats(_Out_ MEDIA_DEVICE_STATS* pStats);
+
+private:
+	typedef struct _DEVICE_ENTRY
+	{
+		std::shared_ptr<IMediaDevice> spDevice;
+		UINT32 references;
+	} DEVICE_ENTRY;
+
+	std::shared_ptr<IMediaDeviceFactory> m_spFactory;
+
+	std::mutex m_lock;
+	std::map<UINT64, DEVICE_ENTRY> m_devices;
+	bool m_shutdown;
+
+	UINT64 m_devicesCreated;
+	UINT64 m_acquires;
+	UINT64 m_deviceLosses;
+	INT64 m_lastCreationTime;
+	INT64 m_maxCreationTime;
+};
+
+
+// Device of the software backend, no graphics resources behind it. Its factory can be made to fail, as the
+// creation does on a removed adapter.
+class CSoftwareMediaDevice
+	: public IMediaDevice
+{
+public:
+	CSoftwareMediaDevice(_In_ UINT64 adapterId, _In_ UINT32 serial) : m_adapterId(adapterId), m_serial(serial) {}
+
+	virtual UINT64 GetAdapterId() const override { return m_adapterId; }
+
+	// devices created by the factory before this one
+	UINT32 GetSerial() const { return m_serial; }
+
+private:
+	UINT64 m_adapterId;
+	UINT32 m_serial;
+};
+
+class CSoftwareMediaDeviceFactory
+	: public IMediaDeviceFactory
+{
+public:
+	CSoftwareMediaDeviceFactory() : m_devicesCreated(0), m_failCreation(false) {}
+
+	UINT32 GetDevicesCreated() const { return m_devicesCreated; }
+	void SetFailCreation(_In_ bool failCreation) { m_failCreation = failCreation; }
+
+	virtual HRESULT CreateDevice(_In_ UINT64 adapterId, _Out_ std::shared_ptr<IMediaDevice>* pspDevice) override;
+
+private:
+	UINT32 m_devicesCreated;
+	bool m_failCreation;
+};
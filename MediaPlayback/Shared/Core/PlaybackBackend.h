@@ -0,0 +1,171 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Abstract backend used by CPlaybackCore.
+// A backend provides decoding sessions (open/play/seek a source) and frame surfaces the session copies decoded frames to.
+// Every player runs the same CPlaybackCore: the plugin plugs in CMediaPlayerBackend (Windows.Media.Playback.MediaPlayer
+// + D3D11), the tests and benchmarks CSoftwarePlaybackBackend (a virtual clock and CPU buffers).
+
+#include "PlaybackTypes.h"
+#include "KeyframeIndex.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+
+struct IThumbnailDecoder;
+
+// What a surface is created for
+enum class SurfaceUsage : UINT32
+{
+	SurfaceUsage_Presented = 0,		// the client samples it, frames of the session are copied to it
+	SurfaceUsage_Copy				// holds a frame copied from another surface, e.g. in the frame cache
+};
+
+typedef struct _PLAYBACK_SURFACE_DESC
+{
+	UINT32 width;
+	UINT32 height;					// of the whole frame, both eyes of stereoscopic ones
+	bool isStereoscopic;
+	FrameFormat format;				// preferred; the backend falls back to one it supports, GetFrameFormat tells
+	SurfaceUsage usage;
+} PLAYBACK_SURFACE_DESC;
+
+// A cue of an application presented subtitle track entering or leaving the screen
+typedef struct _SUBTITLE_CUE
+{
+	std::wstring trackId;
+	std::wstring cueId;
+	std::wstring language;
+	std::vector<std::wstring> lines;
+} SUBTITLE_CUE;
+
+// Seek preview thumbnails of a source, decoded apart from the session playing it
+typedef struct _THUMBNAIL_SOURCE
+{
+	std::shared_ptr<IThumbnailDecoder> decoder;
+	std::wstring sourceKey;			// changes when the content does, e.g. with the size and time of a file
+	std::wstring cachePath;			// of the complete atlas, empty if it is not kept
+} THUMBNAIL_SOURCE;
+
+
+// Frame target owned by the backend
+struct IPlaybackSurface
+{
+	virtual ~IPlaybackSurface() {}
+
+	virtual UINT32 GetWidth() const = 0;
+	virtual UINT32 GetHeight() const = 0;
+	virtual bool IsStereoscopic() const = 0;
+	virtual FrameFormat GetFrameFormat() const = 0;
+};
+
+
+// Events a session raises. They may come from any thread, exactly like MediaPlayer events do.
+struct IPlaybackSessionSink
+{
+	virtual ~IPlaybackSessionSink() {}
+
+	virtual void OnSessionOpened() = 0;
+	virtual void OnSessionStateChanged(PlaybackState state) = 0;
+	virtual void OnSessionEnded() = 0;
+	virtual void OnSessionFailed(HRESULT hr) = 0;
+	virtual void OnSessionSizeChanged() = 0;
+	virtual void OnSessionFrameAvailable() = 0;
+	virtual void OnSessionVideoTracksChanged() = 0;
+	virtual void OnSessionSubtitleTracksChanged() = 0;
+	virtual void OnSessionSubtitleCueEntered(_In_ const SUBTITLE_CUE& cue) = 0;
+	virtual void OnSessionSubtitleCueExited(_In_ const SUBTITLE_CUE& cue) = 0;
+
+	// Position jumps, buffered ranges or the bitrate of an adaptive stream changed
+	virtual void OnSessionStatusChanged() = 0;
+};
+
+
+// A single decoding session, equivalent of MediaPlayer + MediaPlaybackSession
+struct IPlaybackSession
+{
+	virtual ~IPlaybackSession() {}
+
+	virtual HRESULT Open(_In_ const wchar_t* pszContentLocation) = 0;
+	virtual HRESULT Close() = 0;
+	virtual bool HasSource() const = 0;
+
+	virtual HRESULT Play() = 0;
+	virtual HRESULT Pause() = 0;
+	virtual HRESULT Seek(_In_ LONGLONG position) = 0;		// paused sessions present the frame at the new position
+	virtual HRESULT SetVolume(_In_ DOUBLE volume) = 0;
+
+	// Forward rates the decoder plays itself, see CFrameScheduler::IsNativeRate
+	virtual HRESULT SetPlaybackRate(_In_ DOUBLE rate) = 0;
+
+	// Playback wraps from end (the end of the media if 0) back to start instead of ending, with no gap in the frames
+	virtual HRESULT SetLoop(_In_ bool enabled, _In_ LONGLONG start, _In_ LONGLONG end) = 0;
+
+	virtual PlaybackState GetPlaybackState() const = 0;
+	virtual HRESULT GetDurationAndPosition(_Out_ LONGLONG* duration, _Out_ LONGLONG* position) const = 0;
+	virtual HRESULT GetNaturalVideoSize(_Out_ UINT32* width, _Out_ UINT32* height) const = 0;
+	virtual bool CanSeek() const = 0;
+	virtual bool IsStereoscopic() const = 0;
+
+	// adaptive streaming, empty bitrates list for non-adaptive sources
+	virtual HRESULT GetAvailableBitrates(_Out_ std::vector<UINT32>* bitrates) const = 0;
+	virtual HRESULT SetInitialBitrate(_In_ UINT32 bitrate) = 0;
+	virtual HRESULT SetDesiredMaxBitrate(_In_ UINT32 bitrate) = 0;
+	virtual UINT32 GetCurrentBitrate() const = 0;		// 0 if not adaptive
+
+	virtual HRESULT GetBufferedRanges(_Out_ std::vector<MEDIA_TIME_RANGE>* ranges) const = 0;
+
+	// Video renditions in the current item. Adaptive sources report the renditions of their manifest, selecting one
+	// caps the bitrate at it.
+	virtual HRESULT GetVideoTracks(_Out_ std::vector<VIDEO_TRACK_INFO>* tracks, _Out_ INT32* selectedIndex) const = 0;
+	virtual HRESULT SelectVideoTrack(_In_ INT32 index) = 0;
+
+	virtual HRESULT GetSubtitleTracks(_Out_ std::vector<SUBTITLE_TRACK>* tracks) const = 0;
+
+	// Fails with E_PENDING if the surface can not take a frame right now, the frame is dropped
+	virtual HRESULT CopyFrameToSurface(_In_ IPlaybackSurface* pSurface) = 0;
+};
+
+
+// Factory for sessions and surfaces, plus decoder capabilities of the device the backend runs on
+struct IPlaybackBackend
+{
+	virtual ~IPlaybackBackend() {}
+
+	virtual HRESULT CreateSession(
+		_In_ IPlaybackSessionSink* pSink,
+		_Out_ std::shared_ptr<IPlaybackSession>* ppSession) = 0;
+
+	virtual HRESULT CreateSurface(
+		_In_ const PLAYBACK_SURFACE_DESC& desc,
+		_Out_ std::shared_ptr<IPlaybackSurface>* ppSurface) = 0;
+
+	// Between surfaces of the same size and format, frames go in and out of the frame cache this way
+	virtual HRESULT CopySurface(
+		_In_ IPlaybackSurface* pSource,
+		_In_ IPlaybackSurface* pDestination) = 0;
+
+	// Hardware decoders of the device, empty if there are none
+	virtual HRESULT GetDecoderCapabilities(_Out_ CDecoderCapabilities* pCapabilities) = 0;
+
+	// Keyframes of local files, S_FALSE and no index for content the backend does not index
+	virtual HRESULT GetKeyframeIndex(
+		_In_ const wchar_t* pszContentLocation,
+		_Out_ std::shared_ptr<const CKeyframeIndex>* pIndex) = 0;
+
+	virtual HRESULT OpenThumbnailSource(
+		_In_ const wchar_t* pszContentLocation,
+		_Out_ THUMBNAIL_SOURCE* pSource) = 0;
+};
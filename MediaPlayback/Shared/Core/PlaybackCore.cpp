@@ -0,0 +1,1766 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "PlaybackCore.h"
+#include "FrameFormat.h"
+
+#include <algorithm>
+
+
+// Sink of one of the two sessions. The one playing forwards every event to the core, the one opening the next
+// playlist item only reports whether it opened.
+class CPlaybackCore::CSessionSink
+	: public IPlaybackSessionSink
+{
+public:
+	explicit CSessionSink(_In_ CPlaybackCore* pCore)
+		: m_pCore(pCore)
+		, m_active(false)
+	{
+	}
+
+	void SetActive(_In_ bool active) { m_active = active; }
+
+	virtual void OnSessionOpened() override
+	{
+		if (m_active)
+			m_pCore->OnSessionOpened();
+		else
+			m_pCore->OnPrerollOpened();
+	}
+
+	virtual void OnSessionFailed(HRESULT hr) override
+	{
+		if (m_active)
+			m_pCore->OnSessionFailed(hr);
+		else
+			m_pCore->OnPrerollFailed(hr);
+	}
+
+	virtual void OnSessionStateChanged(PlaybackState state) override { if (m_active) m_pCore->OnSessionStateChanged(state); }
+	virtual void OnSessionEnded() override { if (m_active) m_pCore->OnSessionEnded(); }
+	virtual void OnSessionSizeChanged() override { if (m_active) m_pCore->OnSessionSizeChanged(); }
+	virtual void OnSessionFrameAvailable() override { if (m_active) m_pCore->OnSessionFrameAvailable(); }
+	virtual void OnSessionVideoTracksChanged() override { if (m_active) m_pCore->OnSessionVideoTracksChanged(); }
+	virtual void OnSessionSubtitleTracksChanged() override { if (m_active) m_pCore->OnSessionSubtitleTracksChanged(); }
+	virtual void OnSessionSubtitleCueEntered(const SUBTITLE_CUE& cue) override { if (m_active) m_pCore->OnSessionSubtitleCueEntered(cue); }
+	virtual void OnSessionSubtitleCueExited(const SUBTITLE_CUE& cue) override { if (m_active) m_pCore->OnSessionSubtitleCueExited(cue); }
+	virtual void OnSessionStatusChanged() override { if (m_active) m_pCore->OnSessionStatusChanged(); }
+
+private:
+	CPlaybackCore* m_pCore;
+	std::atomic<bool> m_active;
+};
+
+
+CPlaybackCore::CPlaybackCore()
+	: m_prerollItemId(0)
+	, m_prerollOpened(false)
+	, m_switchPending(false)
+	, m_primaryKey()
+	, m_preferredFrameFormat(FrameFormat::FrameFormat_BGRA32)
+	, m_fnStateCallback(nullptr)
+	, m_pClientObject(nullptr)
+	, m_fnSubtitleEntered(nullptr)
+	, m_fnSubtitleExited(nullptr)
+	, m_volume(1.0)
+	, m_pendingLoads(0)
+	, m_bIgnoreEvents(false)
+	, m_readyForFrames(false)
+	, m_createSurfaces(false)
+	, m_deviceReady(true)
+	, m_noHW4KDecoding(false)
+	, m_autoSelectVideoTrack(true)
+	, m_keyframeGeneration(0)
+	, m_thumbnailExtractor([this](const CWorkerPool::Task& task) -> HRESULT
+		{
+			std::lock_guard<std::mutex> lock(m_thumbnailWorkersLock);
+
+			if (!m_thumbnailWorkers)
+				return E_ILLEGAL_METHOD_CALL;
+
+			return m_thumbnailWorkers->Submit(task);
+		})
+	, m_cachedPosition(-1)
+{
+	m_sessionSink.reset(new CSessionSink(this));
+	m_sessionSink->SetActive(true);
+	m_prerollSink.reset(new CSessionSink(this));
+}
+
+CPlaybackCore::~CPlaybackCore()
+{
+	CancelLoadContentAsync();
+	m_thumbnailExtractor.Stop();
+
+	// queued loads and keyframe indexing still reference this object
+	{
+		std::unique_lock<std::mutex> lock(m_pendingLoadsLock);
+		m_pendingLoadsDone.wait(lock, [this]() { return m_pendingLoads == 0; });
+	}
+
+	m_readyForFrames = false;
+	m_bIgnoreEvents = true;
+
+	if (m_session)
+	{
+		m_session->Close();
+		m_session.reset();
+	}
+
+	if (m_prerollSession)
+	{
+		m_prerollSession->Close();
+		m_prerollSession.reset();
+	}
+
+	ReleaseSurfaces();
+}
+
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::Initialize(const std::shared_ptr<IPlaybackBackend>& backend, StateChangedCallback fnCallback, void* pClientObject)
+{
+	NULL_CHK(backend.get());
+
+	m_pClientObject = pClientObject;
+
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_loadLock);
+		IFR(ApplyBackend(backend));
+	}
+
+	m_fnStateCallback = fnCallback;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::SetBackend(const std::shared_ptr<IPlaybackBackend>& backend)
+{
+	NULL_CHK(backend.get());
+
+	std::lock_guard<std::recursive_mutex> lock(m_loadLock);
+
+	if (!GetSession())
+		return E_ILLEGAL_METHOD_CALL;
+
+	m_nextBackend = (backend != GetBackend()) ? backend : nullptr;
+
+	return S_OK;
+}
+
+std::shared_ptr<IPlaybackBackend> CPlaybackCore::GetBackend()
+{
+	std::lock_guard<std::mutex> lock(m_sessionLock);
+	return m_backend;
+}
+
+// Sessions and surfaces of the previous backend are released, the new session takes over the settings that outlive
+// the content
+_Use_decl_annotations_
+HRESULT CPlaybackCore::ApplyBackend(const std::shared_ptr<IPlaybackBackend>& backend)
+{
+	std::shared_ptr<IPlaybackSession> spSession;
+	IFR(backend->CreateSession(m_sessionSink.get(), &spSession));
+
+	spSession->SetVolume(m_volume);
+
+	{
+		std::lock_guard<std::mutex> lock(m_loopLock);
+		if (m_loopTracker.IsEnabled())
+			spSession->SetLoop(true, m_loopTracker.GetStart(), m_loopTracker.GetEnd());
+	}
+
+	std::shared_ptr<IPlaybackSession> spPrevious;
+	std::shared_ptr<IPlaybackSession> spPreviousPreroll;
+	{
+		std::lock_guard<std::mutex> lock(m_sessionLock);
+
+		spPrevious = m_session;
+		spPreviousPreroll = m_prerollSession;
+
+		m_backend = backend;
+		m_session = spSession;
+		m_prerollSession.reset();
+	}
+
+	m_prerollItemId = 0;
+	m_prerollOpened = false;
+
+	if (spPrevious)
+		spPrevious->Close();
+
+	if (spPreviousPreroll)
+		spPreviousPreroll->Close();
+
+	ReleaseSurfaces();
+
+	// backends without hardware decoders report none, every rendition is taken for decodable then
+	CDecoderCapabilities capabilities;
+	if (FAILED(backend->GetDecoderCapabilities(&capabilities)))
+		capabilities = CDecoderCapabilities();
+
+	RENDITION_INFO uhdRendition = { 0, 3840u, 2160u, 0, VideoCodec::VideoCodec_H264, 0, 8 };
+	m_noHW4KDecoding = !capabilities.CanDecode(uhdRendition);
+
+	{
+		std::lock_guard<std::mutex> lock(m_renditionLock);
+		m_renditionSelector.SetCapabilities(capabilities);
+	}
+
+	return S_OK;
+}
+
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::LoadContent(const wchar_t* pszContentLocation)
+{
+	NULL_CHK(pszContentLocation);
+
+	std::lock_guard<std::recursive_mutex> lock(m_loadLock);
+
+	m_loadSequencer.Invalidate();
+	ClearPlaylist();
+
+	return OpenContent(pszContentLocation);
+}
+
+_Use_decl_annotations_
+void CPlaybackCore::SetLoadWorkerPool(const std::shared_ptr<CWorkerPool>& pool)
+{
+	m_loadWorkers = pool;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::LoadContentAsync(const wchar_t* pszContentLocation, UINT32* pRequestId)
+{
+	std::shared_ptr<IPlaybackSession> spSession = GetSession();
+
+	NULL_CHK(pszContentLocation);
+	NULL_CHK(pRequestId);
+
+	if (!spSession || !m_loadWorkers)
+		return E_ILLEGAL_METHOD_CALL;
+
+	std::wstring contentLocation(pszContentLocation);
+	UINT32 requestId = m_loadSequencer.Begin();
+
+	IFR(SubmitLoadTask([this, contentLocation, requestId]()
+	{
+		CompleteLoadContent(contentLocation, requestId);
+	}));
+
+	*pRequestId = requestId;
+
+	return S_OK;
+}
+
+HRESULT CPlaybackCore::CancelLoadContentAsync()
+{
+	m_loadSequencer.Invalidate();
+
+	// wait for a load that is past its last cancellation point
+	std::lock_guard<std::recursive_mutex> lock(m_loadLock);
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+void CPlaybackCore::CompleteLoadContent(const std::wstring& contentLocation, UINT32 requestId)
+{
+	if (!m_loadSequencer.IsCurrent(requestId))
+		return;
+
+	std::lock_guard<std::recursive_mutex> lock(m_loadLock);
+
+	if (!m_loadSequencer.IsCurrent(requestId))
+		return;
+
+	ClearPlaylist();
+
+	HRESULT hr = OpenContent(contentLocation.c_str());
+
+	PLAYBACK_STATE playbackState = MakePlaybackState(StateType::StateType_LoadCompleted, PlaybackState::PlaybackState_None, hr);
+	playbackState.requestId = requestId;
+
+	NotifyState(playbackState);
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::OpenContent(const wchar_t* pszContentLocation)
+{
+	std::shared_ptr<IPlaybackSession> spSession = GetSession();
+
+	if (!spSession)
+		return E_UNEXPECTED;
+
+	if (spSession->HasSource())
+	{
+		IFR(StopPlayback());
+	}
+
+	if (m_nextBackend)
+	{
+		std::shared_ptr<IPlaybackBackend> spBackend;
+		spBackend.swap(m_nextBackend);
+
+		IFR(ApplyBackend(spBackend));
+		spSession = GetSession();
+	}
+
+	m_subtitleTracks.Clear();
+
+	{
+		std::lock_guard<std::mutex> lock(m_loopLock);
+		m_loopTracker.Reset();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_schedulerLock);
+		m_scheduler.Reset();
+	}
+
+	ClearFrameCache();
+
+	IFR(spSession->SetPlaybackRate(1.0));
+	IFR(spSession->Open(pszContentLocation));
+
+	SetContentLocation(pszContentLocation);
+
+	std::vector<UINT32> bitrates;
+	if (SUCCEEDED(spSession->GetAvailableBitrates(&bitrates)))
+	{
+		BITRATE_SELECTION selection = SelectAdaptiveBitrates(bitrates, m_noHW4KDecoding);
+
+		if (selection.initialBitrate)
+			spSession->SetInitialBitrate(selection.initialBitrate);
+
+		if (selection.desiredMaxBitrate)
+			spSession->SetDesiredMaxBitrate(selection.desiredMaxBitrate);
+	}
+
+	return S_OK;
+}
+
+HRESULT CPlaybackCore::Play()
+{
+	std::shared_ptr<IPlaybackSession> spSession = GetSession();
+
+	if (!spSession)
+		return E_ILLEGAL_METHOD_CALL;
+
+	LONGLONG duration = 0;
+	LONGLONG position = 0;
+	GetDurationAndPosition(&duration, &position);
+
+	{
+		// the session stays paused in trick play
+		std::lock_guard<std::mutex> lock(m_schedulerLock);
+		if (m_scheduler.IsTrickPlay())
+		{
+			m_scheduler.SetDuration(duration);
+			m_scheduler.Start(position, CoreNow());
+			return S_OK;
+		}
+	}
+
+	IFR(SeekToCachedPosition(spSession.get()));
+
+	return spSession->Play();
+}
+
+HRESULT CPlaybackCore::Pause()
+{
+	std::shared_ptr<IPlaybackSession> spSession = GetSession();
+
+	if (!spSession)
+		return E_ILLEGAL_METHOD_CALL;
+
+	{
+		std::lock_guard<std::mutex> lock(m_schedulerLock);
+		m_scheduler.Stop();
+	}
+
+	return spSession->Pause();
+}
+
+HRESULT CPlaybackCore::Stop()
+{
+	std::lock_guard<std::recursive_mutex> lock(m_loadLock);
+
+	m_loadSequencer.Invalidate();
+	ClearPlaylist();
+
+	return StopPlayback();
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::PlaylistInsert(UINT32 index, const wchar_t* pszContentLocation, UINT32* pId)
+{
+	NULL_CHK(pszContentLocation);
+	NULL_CHK(pId);
+
+	if (!GetBackend())
+		return E_ILLEGAL_METHOD_CALL;
+
+	std::lock_guard<std::recursive_mutex> lock(m_loadLock);
+
+	UINT32 currentId = m_playlist.GetCurrentId();
+
+	IFR(m_playlist.Insert(index, pszContentLocation, pId));
+
+	if (m_playlist.GetCurrentId() != currentId)
+	{
+		// the playlist takes over from whatever was loaded
+		m_loadSequencer.Invalidate();
+		IFR(SwitchToCurrentItem(false));
+	}
+
+	UpdatePreroll();
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::PlaylistAppend(const wchar_t* pszContentLocation, UINT32* pId)
+{
+	return PlaylistInsert(UINT32_MAX, pszContentLocation, pId);
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::PlaylistRemove(UINT32 id)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_loadLock);
+
+	std::shared_ptr<IPlaybackSession> spSession = GetSession();
+	bool playing = spSession && spSession->GetPlaybackState() == PlaybackState::PlaybackState_Playing;
+
+	bool wasCurrent = false;
+	IFR(m_playlist.Remove(id, &wasCurrent));
+
+	if (wasCurrent)
+	{
+		if (m_playlist.GetCurrentId() != 0)
+		{
+			IFR(SwitchToCurrentItem(playing));
+		}
+		else
+		{
+			IFR(StopPlayback());
+		}
+	}
+
+	UpdatePreroll();
+
+	return S_OK;
+}
+
+HRESULT CPlaybackCore::PlaylistNext()
+{
+	std::lock_guard<std::recursive_mutex> lock(m_loadLock);
+
+	std::shared_ptr<IPlaybackSession> spSession = GetSession();
+	bool playing = spSession && spSession->GetPlaybackState() == PlaybackState::PlaybackState_Playing;
+
+	HRESULT hr = m_playlist.MoveNext();
+	if (hr != S_OK)
+		return hr;
+
+	IFR(SwitchToCurrentItem(playing));
+
+	UpdatePreroll();
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::GetPlaylistStats(PLAYLIST_STATS* pStats)
+{
+	NULL_CHK(pStats);
+
+	std::lock_guard<std::recursive_mutex> lock(m_loadLock);
+
+	m_playlist.GetStats(pStats);
+
+	return S_OK;
+}
+
+// Starts the current playlist item: the pre-rolled session takes over if it has the item open, otherwise the item
+// is opened like LoadContent does. The surfaces stay unless the size of the video changes.
+_Use_decl_annotations_
+HRESULT CPlaybackCore::SwitchToCurrentItem(bool play)
+{
+	PLAYLIST_ENTRY entry;
+	if (!m_playlist.GetCurrent(&entry))
+		return E_UNEXPECTED;
+
+	bool prerolled = (m_prerollSession && m_prerollItemId == entry.id && m_prerollOpened);
+
+	// the first item of a playlist is a plain load, not a switch
+	bool switching = m_session->HasSource();
+	if (switching)
+	{
+		m_playlist.BeginSwitch(CoreNow(), prerolled);
+	}
+
+	if (prerolled)
+	{
+		std::shared_ptr<IPlaybackSession> spPrevious;
+
+		m_sessionSink->SetActive(false);
+		{
+			std::lock_guard<std::mutex> lock(m_sessionLock);
+			spPrevious = m_session;
+			m_session = m_prerollSession;
+			m_prerollSession = spPrevious;
+		}
+		std::swap(m_sessionSink, m_prerollSink);
+		m_sessionSink->SetActive(true);
+
+		spPrevious->Close();
+		m_prerollItemId = 0;
+		m_prerollOpened = false;
+
+		// the new session opened while its events went nowhere, the player catches up on them now
+		m_subtitleTracks.Clear();
+		m_status.Reset();
+
+		{
+			std::lock_guard<std::mutex> lock(m_loopLock);
+			m_loopTracker.Reset();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_schedulerLock);
+			m_scheduler.Reset();
+		}
+
+		ClearFrameCache();
+		m_session->SetPlaybackRate(1.0);
+
+		SetContentLocation(entry.contentLocation);
+
+		OnSessionOpened();
+		OnSessionVideoTracksChanged();
+		OnSessionSubtitleTracksChanged();
+
+		UINT32 width = 0;
+		UINT32 height = 0;
+		m_session->GetNaturalVideoSize(&width, &height);
+
+		std::shared_ptr<IPlaybackSurface> spSurface = GetPlaybackSurface();
+		if (!spSurface || spSurface->GetWidth() != width || spSurface->GetHeight() != GetFrameTextureHeight(height, m_session->IsStereoscopic()) ||
+			spSurface->IsStereoscopic() != m_session->IsStereoscopic())
+		{
+			OnSessionSizeChanged();
+		}
+
+		OnSessionStateChanged(m_session->GetPlaybackState());
+	}
+	else
+	{
+		if (m_prerollItemId == entry.id)
+		{
+			m_prerollSession->Close();
+			m_prerollItemId = 0;
+			m_prerollOpened = false;
+		}
+
+		IFR(OpenContent(entry.contentLocation.c_str()));
+	}
+
+	m_switchPending = switching;
+
+	PLAYBACK_STATE playbackState = MakePlaybackState(StateType::StateType_PlaylistItemChanged, PlaybackState::PlaybackState_NA);
+	playbackState.requestId = entry.id;
+	NotifyState(playbackState);
+
+	if (play)
+	{
+		IFR(GetSession()->Play());
+	}
+
+	return S_OK;
+}
+
+// Opens the item after the current one on the second session, paused, or closes it if there is none
+void CPlaybackCore::UpdatePreroll()
+{
+	PLAYLIST_ENTRY next;
+	if (!m_playlist.GetNext(&next))
+	{
+		if (m_prerollSession && m_prerollItemId != 0)
+			m_prerollSession->Close();
+
+		m_prerollItemId = 0;
+		m_prerollOpened = false;
+		return;
+	}
+
+	if (next.id == m_prerollItemId)
+		return;
+
+	if (!m_prerollSession)
+	{
+		std::shared_ptr<IPlaybackSession> spSession;
+		if (FAILED(GetBackend()->CreateSession(m_prerollSink.get(), &spSession)))
+			return;
+
+		spSession->SetVolume(m_volume);
+
+		{
+			std::lock_guard<std::mutex> lock(m_loopLock);
+			if (m_loopTracker.IsEnabled())
+				spSession->SetLoop(true, m_loopTracker.GetStart(), m_loopTracker.GetEnd());
+		}
+
+		std::lock_guard<std::mutex> lock(m_sessionLock);
+		m_prerollSession = spSession;
+	}
+
+	m_prerollSession->Close();
+	m_prerollOpened = false;
+
+	// an item that fails to open here is opened again when it is due and reports the failure then
+	m_prerollItemId = SUCCEEDED(m_prerollSession->Open(next.contentLocation.c_str())) ? next.id : 0;
+}
+
+void CPlaybackCore::ClearPlaylist()
+{
+	m_playlist.Clear();
+	m_switchPending = false;
+
+	if (m_prerollSession && m_prerollItemId != 0)
+		m_prerollSession->Close();
+
+	m_prerollItemId = 0;
+	m_prerollOpened = false;
+}
+
+void CPlaybackCore::OnPrerollOpened()
+{
+	std::lock_guard<std::recursive_mutex> lock(m_loadLock);
+
+	if (m_prerollItemId != 0)
+		m_prerollOpened = true;
+}
+
+_Use_decl_annotations_
+void CPlaybackCore::OnPrerollFailed(HRESULT)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_loadLock);
+
+	m_prerollItemId = 0;
+	m_prerollOpened = false;
+}
+
+std::shared_ptr<IPlaybackSession> CPlaybackCore::GetSession()
+{
+	std::lock_guard<std::mutex> lock(m_sessionLock);
+	return m_session;
+}
+
+_Use_decl_annotations_
+void CPlaybackCore::SetContentLocation(const std::wstring& contentLocation)
+{
+	UINT32 keyframeGeneration = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_keyframeLock);
+		m_spKeyframeIndex.reset();
+		keyframeGeneration = ++m_keyframeGeneration;
+		m_contentLocation = contentLocation;
+	}
+
+	// thumbnails of the previous content are of no use anymore
+	m_thumbnailExtractor.Stop();
+
+	if (contentLocation.empty())
+		return;
+
+	std::shared_ptr<IPlaybackBackend> spBackend = GetBackend();
+
+	// reading the tables of a file takes a while, it never holds up the load
+	SubmitLoadTask([this, spBackend, contentLocation, keyframeGeneration]()
+	{
+		std::shared_ptr<const CKeyframeIndex> spKeyframeIndex;
+		if (spBackend->GetKeyframeIndex(contentLocation.c_str(), &spKeyframeIndex) != S_OK || !spKeyframeIndex || spKeyframeIndex->IsEmpty())
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(m_keyframeLock);
+			if (m_keyframeGeneration != keyframeGeneration)
+				return;
+
+			m_spKeyframeIndex = spKeyframeIndex;
+		}
+
+		std::lock_guard<std::mutex> lock(m_schedulerLock);
+		m_scheduler.SetKeyframeIndex(spKeyframeIndex);
+	});
+}
+
+// Runs the task on the load workers and keeps this object alive until it has, or right away without workers
+_Use_decl_annotations_
+HRESULT CPlaybackCore::SubmitLoadTask(const CWorkerPool::Task& task)
+{
+	if (!m_loadWorkers)
+	{
+		task();
+		return S_OK;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_pendingLoadsLock);
+		m_pendingLoads++;
+	}
+
+	// the load is done once the task is destroyed, whether it ran, was rejected or was dropped by a pool shutdown
+	std::shared_ptr<CPlaybackCore> spPending(this, [](CPlaybackCore* pCore)
+	{
+		std::lock_guard<std::mutex> lock(pCore->m_pendingLoadsLock);
+		pCore->m_pendingLoads--;
+		pCore->m_pendingLoadsDone.notify_all();
+	});
+
+	return m_loadWorkers->Submit([spPending, task]()
+	{
+		task();
+	});
+}
+
+HRESULT CPlaybackCore::StopPlayback()
+{
+	std::shared_ptr<IPlaybackSession> spSession = GetSession();
+
+	if (!spSession)
+		return E_ILLEGAL_METHOD_CALL;
+
+	m_bIgnoreEvents = true;
+
+	HRESULT hr = spSession->Close();
+
+	m_subtitleTracks.Clear();
+	m_status.Reset();
+
+	SetContentLocation(std::wstring());
+
+	{
+		std::lock_guard<std::mutex> lock(m_schedulerLock);
+		m_scheduler.Reset();
+	}
+
+	ClearFrameCache();
+
+	NotifyState(MakePlaybackState(StateType::StateType_None, PlaybackState::PlaybackState_None));
+
+	m_bIgnoreEvents = false;
+
+	return hr;
+}
+
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::GetDurationAndPosition(LONGLONG* duration, LONGLONG* position)
+{
+	std::shared_ptr<IPlaybackSession> spSession = GetSession();
+
+	if (!spSession)
+		return E_ILLEGAL_METHOD_CALL;
+
+	LONGLONG durationValue = 0;
+	LONGLONG positionValue = 0;
+	IFR(spSession->GetDurationAndPosition(&durationValue, &positionValue));
+
+	// the frame on screen came from the cache, the session has not been sought there yet
+	INT64 cachedPosition = m_cachedPosition;
+	if (cachedPosition >= 0)
+		positionValue = cachedPosition;
+
+	if (duration)
+		*duration = durationValue;
+
+	if (position)
+		*position = positionValue;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::Seek(LONGLONG position)
+{
+	std::shared_ptr<IPlaybackSession> spSession = GetSession();
+
+	if (!spSession)
+		return E_ILLEGAL_METHOD_CALL;
+
+	if (!spSession->CanSeek())
+		return S_FALSE;
+
+	// a seek back is not a wrap of the loop
+	{
+		std::lock_guard<std::mutex> lock(m_loopLock);
+		m_loopTracker.Reset();
+	}
+
+	// trick play goes on from the new position
+	bool trickPlaying = false;
+	{
+		std::lock_guard<std::mutex> lock(m_schedulerLock);
+		trickPlaying = m_scheduler.IsRunning();
+		if (trickPlaying)
+			m_scheduler.Start(position, CoreNow());
+		m_scheduler.OnSeek();
+	}
+
+	// a short rewind while paused may not need the decoder at all
+	if (!trickPlaying && spSession->GetPlaybackState() != PlaybackState::PlaybackState_Playing && PresentCachedFrame(position))
+		return S_OK;
+
+	m_cachedPosition = -1;
+
+	return spSession->Seek(position);
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::SeekWithMode(LONGLONG position, SeekMode mode)
+{
+	if (mode > SeekMode::SeekMode_NearestKeyframe)
+		return E_INVALIDARG;
+
+	std::shared_ptr<const CKeyframeIndex> spKeyframeIndex;
+	{
+		std::lock_guard<std::mutex> lock(m_keyframeLock);
+		spKeyframeIndex = m_spKeyframeIndex;
+	}
+
+	if (spKeyframeIndex)
+		position = spKeyframeIndex->FindSeekPosition(position, mode);
+
+	return Seek(position);
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::SetVolume(DOUBLE volume)
+{
+	std::shared_ptr<IPlaybackSession> spSession;
+	std::shared_ptr<IPlaybackSession> spPrerollSession;
+	{
+		std::lock_guard<std::mutex> lock(m_sessionLock);
+		spSession = m_session;
+		spPrerollSession = m_prerollSession;
+	}
+
+	if (!spSession)
+		return E_ILLEGAL_METHOD_CALL;
+
+	m_volume = volume;
+
+	if (spPrerollSession)
+		spPrerollSession->SetVolume(volume);
+
+	return spSession->SetVolume(volume);
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::SetLoop(BOOL enabled, INT64 start, INT64 end)
+{
+	std::shared_ptr<IPlaybackSession> spSession;
+	std::shared_ptr<IPlaybackSession> spPrerollSession;
+	{
+		std::lock_guard<std::mutex> lock(m_sessionLock);
+		spSession = m_session;
+		spPrerollSession = m_prerollSession;
+	}
+
+	if (!spSession)
+		return E_ILLEGAL_METHOD_CALL;
+
+	{
+		std::lock_guard<std::mutex> lock(m_loopLock);
+		IFR(m_loopTracker.SetLoop(enabled != FALSE, start, end));
+	}
+
+	IFR(spSession->SetLoop(enabled != FALSE, start, end));
+
+	if (spPrerollSession)
+	{
+		IFR(spPrerollSession->SetLoop(enabled != FALSE, start, end));
+	}
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::GetLoopStats(LOOP_STATS* pStats)
+{
+	NULL_CHK(pStats);
+
+	std::lock_guard<std::mutex> lock(m_loopLock);
+	m_loopTracker.GetStats(pStats);
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::SetPlaybackRate(DOUBLE rate)
+{
+	std::shared_ptr<IPlaybackSession> spSession = GetSession();
+
+	if (!spSession)
+		return E_ILLEGAL_METHOD_CALL;
+
+	if (!CFrameScheduler::IsValidRate(rate))
+		return E_INVALIDARG;
+
+	LONGLONG duration = 0;
+	LONGLONG position = 0;
+	GetDurationAndPosition(&duration, &position);
+
+	bool sessionPlaying = (spSession->GetPlaybackState() == PlaybackState::PlaybackState_Playing);
+	bool wasTrickPlaying = false;
+	bool trickPlay = false;
+	{
+		std::lock_guard<std::mutex> lock(m_schedulerLock);
+
+		wasTrickPlaying = m_scheduler.IsRunning();
+		IFR(m_scheduler.SetRate(rate));
+		trickPlay = m_scheduler.IsTrickPlay();
+
+		if (trickPlay && (sessionPlaying || wasTrickPlaying))
+		{
+			m_scheduler.SetDuration(duration);
+			m_scheduler.Start(position, CoreNow());
+		}
+		else if (!trickPlay)
+		{
+			m_scheduler.Stop();
+		}
+	}
+
+	if (trickPlay)
+		return sessionPlaying ? spSession->Pause() : S_OK;
+
+	IFR(spSession->SetPlaybackRate(rate));
+
+	if (!wasTrickPlaying)
+		return S_OK;
+
+	// trick play hands the playback back to the decoder, from the frame on screen
+	IFR(SeekToCachedPosition(spSession.get()));
+
+	return spSession->Play();
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::StepFrame(INT32 frames)
+{
+	std::shared_ptr<IPlaybackSession> spSession = GetSession();
+
+	if (!spSession)
+		return E_ILLEGAL_METHOD_CALL;
+
+	if (!spSession->CanSeek())
+		return S_FALSE;
+
+	if (frames == 0)
+		return S_OK;
+
+	LONGLONG duration = 0;
+	LONGLONG position = 0;
+	IFR(GetDurationAndPosition(&duration, &position));
+
+	INT64 target = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_schedulerLock);
+
+		m_scheduler.Stop();
+		m_scheduler.SetDuration(duration);
+		target = m_scheduler.GetStepTarget(position, frames);
+	}
+
+	if (spSession->GetPlaybackState() == PlaybackState::PlaybackState_Playing)
+	{
+		IFR(spSession->Pause());
+	}
+
+	if (PresentCachedFrame(target))
+		return S_OK;
+
+	m_cachedPosition = -1;
+
+	return spSession->Seek(target);
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::GetFrameSchedulerStats(FRAME_SCHEDULER_STATS* pStats)
+{
+	NULL_CHK(pStats);
+
+	std::lock_guard<std::mutex> lock(m_schedulerLock);
+	m_scheduler.GetStats(pStats);
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::SetFrameCacheBudget(UINT64 budgetBytes)
+{
+	m_frameCache.SetBudget(budgetBytes);
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::GetFrameCacheStats(FRAME_CACHE_STATS* pStats)
+{
+	NULL_CHK(pStats);
+
+	m_frameCache.GetStats(pStats);
+
+	return S_OK;
+}
+
+// Keeps a copy of the frame just copied to the primary surface, reusing the surface of an evicted frame if it can
+_Use_decl_annotations_
+void CPlaybackCore::CacheFrame(INT64 position)
+{
+	if (!m_frameCache.IsEnabled() || !m_primarySurface)
+		return;
+
+	INT64 frameDuration = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_schedulerLock);
+		frameDuration = m_scheduler.GetFrameDuration();
+	}
+
+	PLAYBACK_SURFACE_DESC desc = { m_primarySurface->GetWidth(), m_primarySurface->GetHeight(), m_primarySurface->IsStereoscopic(),
+		m_primarySurface->GetFrameFormat(), SurfaceUsage::SurfaceUsage_Copy };
+
+	FRAME_LAYOUT layout;
+	if (FAILED(GetFrameLayout(desc.format, desc.width, desc.height, &layout)))
+		return;
+
+	std::shared_ptr<IPlaybackBackend> spBackend = GetBackend();
+
+	std::shared_ptr<IPlaybackSurface> spFrame;
+	if (!m_frameCache.Reclaim(position, layout.sizeBytes, &spFrame) && FAILED(spBackend->CreateSurface(desc, &spFrame)))
+		return;
+
+	if (SUCCEEDED(spBackend->CopySurface(m_primarySurface.get(), spFrame.get())))
+	{
+		m_frameCache.Put(position, frameDuration, spFrame, layout.sizeBytes);
+	}
+}
+
+// Shows the cached frame that is on screen at position, if there is one; the session is sought there once it plays
+_Use_decl_annotations_
+bool CPlaybackCore::PresentCachedFrame(INT64 position)
+{
+	std::shared_ptr<IPlaybackSurface> spFrame;
+	if (!m_frameCache.Lookup(position, &spFrame, nullptr))
+		return false;
+
+	{
+		std::lock_guard<std::mutex> lock(m_surfaceLock);
+		if (!m_primarySurface || FAILED(GetBackend()->CopySurface(spFrame.get(), m_primarySurface.get())))
+			return false;
+	}
+
+	m_cachedPosition = position;
+
+	m_status.Update([position](PLAYBACK_STATUS& status)
+	{
+		status.position = position;
+		status.frameCounter++;
+	});
+
+	return true;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::SeekToCachedPosition(IPlaybackSession* pSession)
+{
+	INT64 position = m_cachedPosition.exchange(-1);
+	if (position < 0)
+		return S_OK;
+
+	return pSession->Seek(position);
+}
+
+void CPlaybackCore::ClearFrameCache()
+{
+	m_frameCache.Clear();
+	m_cachedPosition = -1;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::SetRenditionConstraints(UINT32 viewportWidth, UINT32 viewportHeight, PowerBudget powerBudget)
+{
+	if (powerBudget > PowerBudget::PowerBudget_Saver)
+		return E_INVALIDARG;
+
+	{
+		std::lock_guard<std::mutex> lock(m_renditionLock);
+		m_renditionSelector.SetViewport(viewportWidth, viewportHeight);
+		m_renditionSelector.SetPowerBudget(powerBudget);
+	}
+
+	if (m_autoSelectVideoTrack && !m_bIgnoreEvents)
+		SelectVideoTrack();
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::IsHardware4KDecodingSupported(BOOL* pSupportsHardware4KVideoDecoding)
+{
+	NULL_CHK(pSupportsHardware4KVideoDecoding);
+
+	if (!GetBackend())
+		return E_UNEXPECTED;
+
+	*pSupportsHardware4KVideoDecoding = m_noHW4KDecoding ? FALSE : TRUE;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::SetPreferredFrameFormat(FrameFormat format)
+{
+	if (format > FrameFormat::FrameFormat_P010)
+		return E_INVALIDARG;
+
+	if (m_preferredFrameFormat.exchange(format) == format)
+		return S_OK;
+
+	// the surface of the current video is created again on the next render event
+	if (GetPlaybackSurface())
+		m_createSurfaces = true;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::DrainEvents(PLAYBACK_STATE* pEvents, UINT32 capacity, UINT32* pCount)
+{
+	return m_events.Drain(pEvents, capacity, pCount);
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::GetEventQueueStats(EVENT_QUEUE_STATS* pStats)
+{
+	NULL_CHK(pStats);
+
+	m_events.GetStats(pStats);
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::GetSurfacePoolStats(SURFACE_POOL_STATS* pStats)
+{
+	NULL_CHK(pStats);
+
+	m_surfacePool.GetStats(pStats);
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::SetSurfacePoolBudget(UINT64 budgetBytes)
+{
+	m_surfacePool.SetBudget(budgetBytes);
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::GetPlaybackStatus(const PLAYBACK_STATUS** ppStatus)
+{
+	NULL_CHK(ppStatus);
+
+	*ppStatus = m_status.GetShared();
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::GetSubtitlesTrackCount(unsigned int* count)
+{
+	NULL_CHK(count);
+
+	*count = m_subtitleTracks.GetCount();
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::GetSubtitlesTrack(unsigned int index, const wchar_t** trackId, const wchar_t** trackLabel, const wchar_t** trackLanguage)
+{
+	const SUBTITLE_TRACK* pTrack = m_subtitleTracks.GetTrack(index);
+	if (pTrack == nullptr)
+		return E_INVALIDARG;
+
+	*trackId = pTrack->id.data();
+	*trackLabel = pTrack->title.data();
+	*trackLanguage = pTrack->language.data();
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::SetSubtitlesCallbacks(SubtitleItemEnteredCallback fnEnteredCallback, SubtitleItemExitedCallback fnExitedCallback)
+{
+	m_fnSubtitleEntered = fnEnteredCallback;
+	m_fnSubtitleExited = fnExitedCallback;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+void CPlaybackCore::SetThumbnailWorkerPool(const std::shared_ptr<CWorkerPool>& pool)
+{
+	std::lock_guard<std::mutex> lock(m_thumbnailWorkersLock);
+	m_thumbnailWorkers = pool;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::StartThumbnailExtraction(UINT32 tileWidth, UINT32 tileHeight, INT64 interval)
+{
+	if (tileWidth == 0 || tileHeight == 0 || tileWidth > _MaxThumbnailAtlasSize_ || tileHeight > _MaxThumbnailAtlasSize_ || interval <= 0)
+		return E_INVALIDARG;
+
+	std::wstring contentLocation;
+	std::shared_ptr<const CKeyframeIndex> spKeyframeIndex;
+	{
+		std::lock_guard<std::mutex> lock(m_keyframeLock);
+		contentLocation = m_contentLocation;
+		spKeyframeIndex = m_spKeyframeIndex;
+	}
+
+	if (contentLocation.empty())
+		return E_ILLEGAL_METHOD_CALL;
+
+	// the decoder seeks to every tile time itself while the keyframe index is not built yet
+	THUMBNAIL_SOURCE source;
+	IFR(GetBackend()->OpenThumbnailSource(contentLocation.c_str(), &source));
+	if (!source.decoder)
+		return E_UNEXPECTED;
+
+	return m_thumbnailExtractor.Start(source.decoder, source.sourceKey, tileWidth, tileHeight, interval, spKeyframeIndex, source.cachePath);
+}
+
+HRESULT CPlaybackCore::StopThumbnailExtraction()
+{
+	m_thumbnailExtractor.Stop();
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::GetThumbnailAtlasInfo(THUMBNAIL_ATLAS_INFO* pInfo)
+{
+	return m_thumbnailExtractor.GetInfo(pInfo);
+}
+
+_Use_decl_annotations_
+HRESULT CPlaybackCore::GetThumbnailAtlas(BYTE* pBuffer, UINT32 size, THUMBNAIL_ATLAS_INFO* pInfo)
+{
+	return m_thumbnailExtractor.CopyPixels(pBuffer, size, pInfo);
+}
+
+
+void CPlaybackCore::RenderEvent()
+{
+	// surfaces wait for the device to come back
+	bool createSurfaces = true;
+	if (m_deviceReady && m_createSurfaces.compare_exchange_strong(createSurfaces, false))
+	{
+		CreatePlaybackSurfaces();
+	}
+
+	// trick play seeks once per render tick at most, and only after the previous target was presented
+	INT64 target = 0;
+	bool seek = false;
+	{
+		std::lock_guard<std::mutex> lock(m_schedulerLock);
+		seek = m_scheduler.GetNextTarget(CoreNow(), &target);
+	}
+
+	if (seek && PresentCachedFrame(target))
+	{
+		std::lock_guard<std::mutex> lock(m_schedulerLock);
+		m_scheduler.OnFrame(target);
+		return;
+	}
+
+	std::shared_ptr<IPlaybackSession> spSession = GetSession();
+	if (seek && spSession)
+	{
+		m_cachedPosition = -1;
+		spSession->Seek(target);
+	}
+}
+
+void CPlaybackCore::DeviceShutdown()
+{
+	m_deviceReady = false;
+	m_readyForFrames = false;
+
+	NotifyState(MakePlaybackState(StateType::StateType_GraphicsDeviceShutdown, PlaybackState::PlaybackState_None));
+
+	ReleaseSurfaces();
+}
+
+void CPlaybackCore::DeviceReady()
+{
+	if (m_deviceReady.exchange(true))
+		return;
+
+	NotifyState(MakePlaybackState(StateType::StateType_GraphicsDeviceReady, PlaybackState::PlaybackState_None));
+
+	std::shared_ptr<IPlaybackSession> spSession = GetSession();
+
+	UINT32 width = 0;
+	UINT32 height = 0;
+	if (spSession && SUCCEEDED(spSession->GetNaturalVideoSize(&width, &height)) && width && height)
+		m_createSurfaces = true;
+}
+
+std::shared_ptr<IPlaybackSurface> CPlaybackCore::GetPlaybackSurface()
+{
+	std::lock_guard<std::mutex> lock(m_surfaceLock);
+	return m_primarySurface;
+}
+
+
+HRESULT CPlaybackCore::CreatePlaybackSurfaces()
+{
+	std::shared_ptr<IPlaybackSession> spSession = GetSession();
+
+	m_readyForFrames = false;
+
+	RecycleSurfaces();
+
+	if (!spSession)
+		return E_ILLEGAL_METHOD_CALL;
+
+	UINT32 width = 0;
+	UINT32 height = 0;
+	IFR(spSession->GetNaturalVideoSize(&width, &height));
+
+	if (!width || !height)
+		return E_UNEXPECTED;
+
+	bool isStereoscopic = spSession->IsStereoscopic();
+	height = GetFrameTextureHeight(height, isStereoscopic);
+
+	FrameFormat format = m_preferredFrameFormat;
+	SURFACE_POOL_KEY key = { width, height, (UINT32)format, isStereoscopic };
+
+	std::shared_ptr<IPlaybackBackend> spBackend = GetBackend();
+
+	std::shared_ptr<IPlaybackSurface> spSurface;
+	IFR(m_surfacePool.Acquire(key,
+		[&spBackend](const SURFACE_POOL_KEY& poolKey, std::shared_ptr<IPlaybackSurface>* ppSurface)
+		{
+			PLAYBACK_SURFACE_DESC desc = { poolKey.width, poolKey.height, poolKey.isStereoscopic, (FrameFormat)poolKey.format, SurfaceUsage::SurfaceUsage_Presented };
+			return spBackend->CreateSurface(desc, ppSurface);
+		},
+		&spSurface));
+
+	{
+		std::lock_guard<std::mutex> lock(m_surfaceLock);
+		m_primarySurface = spSurface;
+		m_primaryKey = key;
+	}
+
+	LONGLONG duration = 0;
+	LONGLONG position = 0;
+	spSession->GetDurationAndPosition(&duration, &position);
+
+	PLAYBACK_STATE playbackState = MakePlaybackState(StateType::StateType_NewFrameTexture, PlaybackState::PlaybackState_NA);
+	playbackState.description = MakeMediaDescription(width, height, duration, spSession->CanSeek(), isStereoscopic);
+	playbackState.description.frameFormat = spSurface->GetFrameFormat();
+
+	NotifyState(playbackState);
+
+	m_readyForFrames = true;
+
+	return S_OK;
+}
+
+// Keeps the surface of the current size for later, unless the client still holds it
+void CPlaybackCore::RecycleSurfaces()
+{
+	m_readyForFrames = false;
+
+	// cached frames are of the old size
+	m_frameCache.Clear();
+
+	std::shared_ptr<IPlaybackSurface> spSurface;
+	SURFACE_POOL_KEY key;
+	{
+		std::lock_guard<std::mutex> lock(m_surfaceLock);
+		spSurface.swap(m_primarySurface);
+		key = m_primaryKey;
+	}
+
+	if (!spSurface || spSurface.use_count() != 1)
+		return;
+
+	FRAME_LAYOUT layout;
+	if (FAILED(GetFrameLayout(spSurface->GetFrameFormat(), spSurface->GetWidth(), spSurface->GetHeight(), &layout)))
+		return;
+
+	m_surfacePool.Recycle(key, std::move(spSurface), layout.sizeBytes);
+}
+
+void CPlaybackCore::ReleaseSurfaces()
+{
+	m_readyForFrames = false;
+
+	m_frameCache.Clear();
+
+	{
+		std::lock_guard<std::mutex> lock(m_surfaceLock);
+		m_primarySurface.reset();
+	}
+
+	m_surfacePool.Clear();
+}
+
+
+_Use_decl_annotations_
+void CPlaybackCore::NotifyState(const PLAYBACK_STATE& playbackState)
+{
+	if (m_fnStateCallback != nullptr)
+		m_fnStateCallback(m_pClientObject, playbackState);
+	else
+		m_events.Push(playbackState);
+}
+
+
+void CPlaybackCore::OnSessionOpened()
+{
+	std::shared_ptr<IPlaybackSession> spSession = GetSession();
+
+	if (m_bIgnoreEvents)
+		return;
+
+	UINT32 width = 0;
+	UINT32 height = 0;
+	LONGLONG duration = 0;
+	LONGLONG position = 0;
+
+	if (FAILED(spSession->GetNaturalVideoSize(&width, &height)) ||
+		FAILED(spSession->GetDurationAndPosition(&duration, &position)))
+	{
+		return;
+	}
+
+	UpdateStatusFromSession(spSession.get());
+
+	{
+		std::lock_guard<std::mutex> lock(m_schedulerLock);
+		m_scheduler.SetDuration(duration);
+	}
+
+	PLAYBACK_STATE playbackState = MakePlaybackState(StateType::StateType_Opened, PlaybackState::PlaybackState_None);
+	playbackState.description = MakeMediaDescription(width, height, duration, spSession->CanSeek(), spSession->IsStereoscopic());
+
+	NotifyState(playbackState);
+}
+
+void CPlaybackCore::OnSessionStateChanged(PlaybackState state)
+{
+	std::shared_ptr<IPlaybackSession> spSession = GetSession();
+
+	if (m_bIgnoreEvents)
+		return;
+
+	PLAYBACK_STATE playbackState = MakePlaybackState(StateType::StateType_StateChanged, state);
+
+	LONGLONG duration = 0;
+	LONGLONG position = 0;
+	spSession->GetDurationAndPosition(&duration, &position);
+
+	m_status.Update([state](PLAYBACK_STATUS& status)
+	{
+		status.state = state;
+	});
+
+	UpdateStatusFromSession(spSession.get());
+
+	UINT32 width = 0;
+	UINT32 height = 0;
+	if (IsDescribedPlaybackState(state) && SUCCEEDED(spSession->GetNaturalVideoSize(&width, &height)))
+	{
+		bool isStereoscopic = spSession->IsStereoscopic();
+		playbackState.description = MakeMediaDescription(width, GetFrameTextureHeight(height, isStereoscopic), duration, spSession->CanSeek(), isStereoscopic);
+	}
+
+	NotifyState(playbackState);
+}
+
+void CPlaybackCore::OnSessionEnded()
+{
+	if (m_bIgnoreEvents)
+		return;
+
+	{
+		// the next playlist item starts right away, the client only sees the item change
+		std::lock_guard<std::recursive_mutex> lock(m_loadLock);
+
+		if (m_playlist.MoveNext() == S_OK)
+		{
+			HRESULT hr = SwitchToCurrentItem(true);
+			UpdatePreroll();
+
+			if (SUCCEEDED(hr))
+				return;
+
+			NotifyState(MakePlaybackState(StateType::StateType_Failed, PlaybackState::PlaybackState_None, hr));
+		}
+	}
+
+	m_status.Update([](PLAYBACK_STATUS& status)
+	{
+		status.state = PlaybackState::PlaybackState_Ended;
+	});
+
+	NotifyState(MakePlaybackState(StateType::StateType_StateChanged, PlaybackState::PlaybackState_Ended));
+
+	m_subtitleTracks.Clear();
+}
+
+void CPlaybackCore::OnSessionFailed(HRESULT hr)
+{
+	if (m_bIgnoreEvents)
+		return;
+
+	NotifyState(MakePlaybackState(StateType::StateType_Failed, PlaybackState::PlaybackState_None, hr));
+}
+
+void CPlaybackCore::OnSessionSizeChanged()
+{
+	std::shared_ptr<IPlaybackSession> spSession = GetSession();
+
+	UINT32 width = 0;
+	UINT32 height = 0;
+	spSession->GetNaturalVideoSize(&width, &height);
+
+	if (width && height)
+	{
+		RecycleSurfaces();
+
+		// like the D3D11 path, surfaces are created on the next render event
+		m_createSurfaces = true;
+	}
+}
+
+void CPlaybackCore::OnSessionFrameAvailable()
+{
+	std::shared_ptr<IPlaybackSession> spSession = GetSession();
+
+	if (!m_readyForFrames)
+		return;
+
+	LONGLONG duration = 0;
+	LONGLONG position = 0;
+	spSession->GetDurationAndPosition(&duration, &position);
+
+	bool copied = false;
+	{
+		std::lock_guard<std::mutex> lock(m_surfaceLock);
+		if (m_primarySurface)
+		{
+			copied = SUCCEEDED(spSession->CopyFrameToSurface(m_primarySurface.get()));
+		}
+
+		if (copied)
+		{
+			CacheFrame(position);
+		}
+	}
+
+	// the session is at the frame on screen again
+	if (copied)
+		m_cachedPosition = -1;
+
+	m_status.Update([copied, position](PLAYBACK_STATUS& status)
+	{
+		status.position = position;
+		if (copied)
+			status.frameCounter++;
+		else
+			status.droppedFrames++;
+	});
+
+	if (copied)
+	{
+		std::lock_guard<std::mutex> lock(m_loopLock);
+		m_loopTracker.OnFrame(position, CoreNow());
+	}
+
+	if (copied)
+	{
+		std::lock_guard<std::mutex> lock(m_schedulerLock);
+		m_scheduler.OnFrame(position);
+	}
+
+	if (copied && m_switchPending.exchange(false))
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_loadLock);
+		m_playlist.EndSwitch(CoreNow());
+	}
+
+	CheckFrameDrops(spSession.get());
+}
+
+// Frames dropped on their way to the surface lower the pixel rate ceiling of the rendition selector
+_Use_decl_annotations_
+void CPlaybackCore::CheckFrameDrops(IPlaybackSession* pSession)
+{
+	std::vector<VIDEO_TRACK_INFO> tracks;
+	INT32 selected = -1;
+	if (FAILED(pSession->GetVideoTracks(&tracks, &selected)) || selected < 0 || (size_t)selected >= tracks.size())
+		return;
+
+	RENDITION_INFO current = MakeTrackRenditions(tracks)[selected];
+
+	PLAYBACK_STATUS status;
+	m_status.Read(&status);
+
+	bool select = false;
+	{
+		std::lock_guard<std::mutex> lock(m_renditionLock);
+		select = m_renditionSelector.OnFrameStats(status.frameCounter, status.droppedFrames, current);
+	}
+
+	if (select && m_autoSelectVideoTrack && !m_bIgnoreEvents)
+		SelectVideoTrack();
+}
+
+void CPlaybackCore::OnSessionVideoTracksChanged()
+{
+	if (!m_autoSelectVideoTrack || m_bIgnoreEvents)
+		return;
+
+	SelectVideoTrack();
+}
+
+void CPlaybackCore::SelectVideoTrack()
+{
+	std::shared_ptr<IPlaybackSession> spSession = GetSession();
+
+	std::vector<VIDEO_TRACK_INFO> tracks;
+	INT32 selected = -1;
+	if (!spSession || FAILED(spSession->GetVideoTracks(&tracks, &selected)))
+		return;
+
+	INT32 newSelection = -1;
+	{
+		std::lock_guard<std::mutex> lock(m_renditionLock);
+		newSelection = m_renditionSelector.Select(MakeTrackRenditions(tracks));
+	}
+
+	if (newSelection >= 0 && newSelection != selected)
+	{
+		spSession->SelectVideoTrack(newSelection);
+	}
+}
+
+void CPlaybackCore::OnSessionSubtitleTracksChanged()
+{
+	std::shared_ptr<IPlaybackSession> spSession = GetSession();
+
+	std::vector<SUBTITLE_TRACK> tracks;
+	if (FAILED(spSession->GetSubtitleTracks(&tracks)))
+		return;
+
+	m_subtitleTracks.BeginUpdate(TrackListChange::TrackListChange_Reset, 0);
+	for (size_t i = 0; i < tracks.size(); i++)
+	{
+		m_subtitleTracks.AddTrack((UINT32)i, tracks[i]);
+	}
+}
+
+_Use_decl_annotations_
+void CPlaybackCore::OnSessionSubtitleCueEntered(const SUBTITLE_CUE& cue)
+{
+	SubtitleItemEnteredCallback fnEntered = m_fnSubtitleEntered;
+	if (fnEntered == nullptr || m_bIgnoreEvents)
+		return;
+
+	std::vector<const wchar_t*> lines;
+	lines.reserve(cue.lines.size());
+	for (const std::wstring& line : cue.lines)
+	{
+		lines.push_back(line.c_str());
+	}
+
+	fnEntered(m_pClientObject, cue.trackId.c_str(), cue.cueId.c_str(), cue.language.c_str(), lines.data(), (unsigned int)lines.size());
+}
+
+_Use_decl_annotations_
+void CPlaybackCore::OnSessionSubtitleCueExited(const SUBTITLE_CUE& cue)
+{
+	SubtitleItemExitedCallback fnExited = m_fnSubtitleExited;
+	if (fnExited == nullptr || m_bIgnoreEvents)
+		return;
+
+	fnExited(m_pClientObject, cue.trackId.c_str(), cue.cueId.c_str());
+}
+
+void CPlaybackCore::OnSessionStatusChanged()
+{
+	std::shared_ptr<IPlaybackSession> spSession = GetSession();
+
+	if (m_bIgnoreEvents || !spSession)
+		return;
+
+	UpdateStatusFromSession(spSession.get());
+}
+
+// Position, duration, bitrate and buffered ranges; the state and frame counters are written where they change
+_Use_decl_annotations_
+void CPlaybackCore::UpdateStatusFromSession(IPlaybackSession* pSession)
+{
+	LONGLONG duration = 0;
+	LONGLONG position = 0;
+	if (FAILED(pSession->GetDurationAndPosition(&duration, &position)))
+		return;
+
+	// the frame on screen came from the cache, the session has not been sought there yet
+	INT64 cachedPosition = m_cachedPosition;
+	if (cachedPosition >= 0)
+		position = cachedPosition;
+
+	UINT32 bitrate = pSession->GetCurrentBitrate();
+
+	std::vector<MEDIA_TIME_RANGE> ranges;
+	if (FAILED(pSession->GetBufferedRanges(&ranges)))
+		ranges.clear();
+
+	m_status.Update([duration, position, bitrate, &ranges](PLAYBACK_STATUS& status)
+	{
+		status.duration = duration;
+		status.position = position;
+		status.bitrate = bitrate;
+		status.bufferedRangeCount = (UINT32)std::min<size_t>(ranges.size(), _MaxBufferedRanges_);
+		for (UINT32 i = 0; i < status.bufferedRangeCount; i++)
+		{
+			status.bufferedRanges[i] = ranges[i];
+		}
+	});
+}
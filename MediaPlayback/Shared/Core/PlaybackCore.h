@@ -0,0 +1,269 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Platform neutral player: the state machine of every player, driven through IPlaybackBackend. CMediaPlayerPlayback
+// runs it on CMediaPlayerBackend (MediaPlayer + D3D11), the tests headless on CSoftwarePlaybackBackend.
+
+#include "PlaybackBackend.h"
+#include "PlaybackPolicy.h"
+#include "Playlist.h"
+#include "RenditionSelector.h"
+#include "FrameCache.h"
+#include "FrameScheduler.h"
+#include "LoadSequencer.h"
+#include "LoopTracker.h"
+#include "StateEventQueue.h"
+#include "StatusBlock.h"
+#include "SurfacePool.h"
+#include "ThumbnailAtlas.h"
+#include "WorkerPool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+
+
+class CPlaybackCore
+	: public IPlaybackSessionSink
+{
+public:
+	CPlaybackCore();
+	virtual ~CPlaybackCore();
+
+	// Without fnCallback the states are queued for DrainEvents
+	HRESULT Initialize(
+		_In_ const std::shared_ptr<IPlaybackBackend>& backend,
+		_In_opt_ StateChangedCallback fnCallback,
+		_In_ void* pClientObject);
+
+	// Backend the content loaded next plays on, e.g. a CSharedPlaybackBackend wrapping the current one. The session
+	// is created again on it, the surfaces with the next frame size.
+	HRESULT SetBackend(_In_ const std::shared_ptr<IPlaybackBackend>& backend);
+
+	HRESULT LoadContent(_In_ const wchar_t* pszContentLocation);
+
+	// Pool LoadContentAsync runs on; it can be shared between players
+	void SetLoadWorkerPool(_In_ const std::shared_ptr<CWorkerPool>& pool);
+
+	// Returns right away, the content is opened on the load worker pool and StateType_LoadCompleted
+	// reports the result. A newer load (sync or async), Stop or CancelLoadContentAsync supersedes the request;
+	// superseded requests complete silently.
+	HRESULT LoadContentAsync(_In_ const wchar_t* pszContentLocation, _Out_ UINT32* pRequestId);
+	HRESULT CancelLoadContentAsync();
+
+	HRESULT Play();
+	HRESULT Pause();
+	HRESULT Stop();
+
+	// Gapless playlist. While an item plays, the one after it is opened on a second session, so the switch at its
+	// end only starts it on the same surfaces. An item inserted while none is current replaces the content
+	// loaded; LoadContent and Stop clear the playlist.
+	HRESULT PlaylistInsert(_In_ UINT32 index, _In_ const wchar_t* pszContentLocation, _Out_ UINT32* pId);
+	HRESULT PlaylistAppend(_In_ const wchar_t* pszContentLocation, _Out_ UINT32* pId);
+	HRESULT PlaylistRemove(_In_ UINT32 id);
+	HRESULT PlaylistNext();					// S_FALSE at the last item
+	HRESULT GetPlaylistStats(_Out_ PLAYLIST_STATS* pStats);
+
+	HRESULT GetDurationAndPosition(_Out_ LONGLONG* duration, _Out_ LONGLONG* position);
+	HRESULT Seek(_In_ LONGLONG position);
+	HRESULT SetVolume(_In_ DOUBLE volume);
+
+	// Snaps the position to a keyframe once the backend has indexed the content, Seek is SeekMode_Accurate
+	HRESULT SeekWithMode(_In_ LONGLONG position, _In_ SeekMode mode);
+
+	// Seamless loop of the whole media (end 0) or of [start, end); it applies to every item loaded until it is disabled.
+	// A looping item never ends, so the playlist does not move on from it.
+	HRESULT SetLoop(_In_ BOOL enabled, _In_ INT64 start, _In_ INT64 end);
+	HRESULT GetLoopStats(_Out_ LOOP_STATS* pStats);
+
+	// 0.25 <= |rate| <= 4, back to 1 with every item. Rates above _MaxNativePlaybackRate_ and reverse ones are trick
+	// play, the session stays paused (and reports so) while keyframes are sought to from RenderEvent.
+	HRESULT SetPlaybackRate(_In_ DOUBLE rate);
+
+	// Pauses and shows the frame frames away from the current one, negative steps back. Steps within the frame cache
+	// are served from it; beyond it each step is an accurate seek of the session, there is no backward decode.
+	HRESULT StepFrame(_In_ INT32 frames);
+	HRESULT GetFrameSchedulerStats(_Out_ FRAME_SCHEDULER_STATS* pStats);
+
+	// Presented frames are kept around the playhead, so steps, short rewinds while paused and trick play over them
+	// are served without decoding. 0 disables it.
+	HRESULT SetFrameCacheBudget(_In_ UINT64 budgetBytes);
+	HRESULT GetFrameCacheStats(_Out_ FRAME_CACHE_STATS* pStats);
+
+	HRESULT IsHardware4KDecodingSupported(_Out_ BOOL* pSupportsHardware4KVideoDecoding);
+
+	// Applies from the next surface (StateType_NewFrameTexture), the surface of the current video is created again.
+	// The backend falls back to a format it supports, MEDIA_DESCRIPTION::frameFormat tells which one.
+	HRESULT SetPreferredFrameFormat(_In_ FrameFormat format);
+
+	// Viewport the video is shown in (0 if not known) and the decoding power budget, video tracks are selected again
+	HRESULT SetRenditionConstraints(_In_ UINT32 viewportWidth, _In_ UINT32 viewportHeight, _In_ PowerBudget powerBudget);
+
+	HRESULT DrainEvents(_Out_writes_to_(capacity, *pCount) PLAYBACK_STATE* pEvents, _In_ UINT32 capacity, _Out_ UINT32* pCount);
+	HRESULT GetEventQueueStats(_Out_ EVENT_QUEUE_STATS* pStats);
+
+	// The block stays valid and keeps being updated for the lifetime of this object
+	HRESULT GetPlaybackStatus(_Out_ const PLAYBACK_STATUS** ppStatus);
+
+	HRESULT GetSurfacePoolStats(_Out_ SURFACE_POOL_STATS* pStats);
+	HRESULT SetSurfacePoolBudget(_In_ UINT64 budgetBytes);
+
+	HRESULT GetSubtitlesTrackCount(_Out_ unsigned int* count);
+	HRESULT GetSubtitlesTrack(_In_ unsigned int index, _Out_ const wchar_t** trackId, _Out_ const wchar_t** trackLabel, _Out_ const wchar_t** trackLanguage);
+	HRESULT SetSubtitlesCallbacks(_In_opt_ SubtitleItemEnteredCallback fnEnteredCallback, _In_opt_ SubtitleItemExitedCallback fnExitedCallback);
+
+	// Pool thumbnails are decoded on; it can be shared between players
+	void SetThumbnailWorkerPool(_In_ const std::shared_ptr<CWorkerPool>& pool);
+
+	// Seek preview thumbnails of the current content, see CThumbnailExtractor. They stop with the content.
+	HRESULT StartThumbnailExtraction(_In_ UINT32 tileWidth, _In_ UINT32 tileHeight, _In_ INT64 interval);
+	HRESULT StopThumbnailExtraction();
+	HRESULT GetThumbnailAtlasInfo(_Out_ THUMBNAIL_ATLAS_INFO* pInfo);
+	HRESULT GetThumbnailAtlas(_Out_writes_(size) BYTE* pBuffer, _In_ UINT32 size, _Out_ THUMBNAIL_ATLAS_INFO* pInfo);
+
+	// Called on the render thread by Unity's render event, surfaces are (re)created there
+	void RenderEvent();
+
+	// Graphics device loss: the surfaces go with the device, they are created again on the first render event
+	// after DeviceReady
+	void DeviceShutdown();
+	void DeviceReady();
+
+	std::shared_ptr<IPlaybackSurface> GetPlaybackSurface();
+	std::shared_ptr<IPlaybackSession> GetSession();
+
+	// IPlaybackSessionSink
+	virtual void OnSessionOpened() override;
+	virtual void OnSessionStateChanged(PlaybackState state) override;
+	virtual void OnSessionEnded() override;
+	virtual void OnSessionFailed(HRESULT hr) override;
+	virtual void OnSessionSizeChanged() override;
+	virtual void OnSessionFrameAvailable() override;
+	virtual void OnSessionVideoTracksChanged() override;
+	virtual void OnSessionSubtitleTracksChanged() override;
+	virtual void OnSessionSubtitleCueEntered(_In_ const SUBTITLE_CUE& cue) override;
+	virtual void OnSessionSubtitleCueExited(_In_ const SUBTITLE_CUE& cue) override;
+	virtual void OnSessionStatusChanged() override;
+
+private:
+	class CSessionSink;
+
+	std::shared_ptr<IPlaybackBackend> GetBackend();
+	HRESULT ApplyBackend(_In_ const std::shared_ptr<IPlaybackBackend>& backend);	// m_loadLock must be held
+
+	HRESULT OpenContent(_In_ const wchar_t* pszContentLocation);
+	HRESULT StopPlayback();
+	void CompleteLoadContent(_In_ const std::wstring& contentLocation, _In_ UINT32 requestId);
+
+	// The content changed (empty if none): its keyframe index is built and thumbnails of the previous one stop
+	void SetContentLocation(_In_ const std::wstring& contentLocation);
+	HRESULT SubmitLoadTask(_In_ const CWorkerPool::Task& task);
+
+	void UpdateStatusFromSession(_In_ IPlaybackSession* pSession);
+
+	HRESULT CreatePlaybackSurfaces();
+	void RecycleSurfaces();
+	void ReleaseSurfaces();
+
+	void NotifyState(_In_ const PLAYBACK_STATE& playbackState);
+	void SelectVideoTrack();
+	void CheckFrameDrops(_In_ IPlaybackSession* pSession);
+
+	HRESULT SwitchToCurrentItem(_In_ bool play);
+	void UpdatePreroll();
+	void ClearPlaylist();
+	void OnPrerollOpened();
+	void OnPrerollFailed(_In_ HRESULT hr);
+
+	void CacheFrame(_In_ INT64 position);		// m_surfaceLock must be held
+	bool PresentCachedFrame(_In_ INT64 position);
+	HRESULT SeekToCachedPosition(_In_ IPlaybackSession* pSession);
+	void ClearFrameCache();
+
+private:
+	std::shared_ptr<IPlaybackBackend> m_backend;				// under m_sessionLock
+	std::shared_ptr<IPlaybackBackend> m_nextBackend;			// applied by the next load, under m_loadLock
+
+	std::mutex m_sessionLock;				// sessions trade places when a pre-rolled playlist item starts
+	std::shared_ptr<IPlaybackSession> m_session;
+	std::unique_ptr<CSessionSink> m_sessionSink;
+	std::shared_ptr<IPlaybackSession> m_prerollSession;
+	std::unique_ptr<CSessionSink> m_prerollSink;
+
+	// under m_loadLock
+	CPlaylist m_playlist;
+	UINT32 m_prerollItemId;					// playlist item m_prerollSession opens, 0 if none
+	bool m_prerollOpened;
+	std::atomic<bool> m_switchPending;		// waiting for the first frame of the item switched to
+
+	// serializes everybody copying frames to m_primarySurface: the session, the frame cache and trick play
+	std::mutex m_surfaceLock;
+	std::shared_ptr<IPlaybackSurface> m_primarySurface;
+	SURFACE_POOL_KEY m_primaryKey;			// m_primarySurface was acquired for
+	CSurfacePool<std::shared_ptr<IPlaybackSurface>> m_surfacePool;
+	std::atomic<FrameFormat> m_preferredFrameFormat;
+
+	StateChangedCallback m_fnStateCallback;
+	void* m_pClientObject;
+	CStateEventQueue m_events;
+	CStatusBlock m_status;
+
+	CSubtitleTrackList m_subtitleTracks;
+	std::atomic<SubtitleItemEnteredCallback> m_fnSubtitleEntered;
+	std::atomic<SubtitleItemExitedCallback> m_fnSubtitleExited;
+
+	std::atomic<DOUBLE> m_volume;			// carried over to the session of another backend
+
+	std::shared_ptr<CWorkerPool> m_loadWorkers;
+	CLoadSequencer m_loadSequencer;
+	std::recursive_mutex m_loadLock;		// serializes opening content between the caller and the load workers
+	std::mutex m_pendingLoadsLock;
+	std::condition_variable m_pendingLoadsDone;
+	UINT32 m_pendingLoads;
+
+	std::atomic<bool> m_bIgnoreEvents;
+	std::atomic<bool> m_readyForFrames;
+	std::atomic<bool> m_createSurfaces;
+	std::atomic<bool> m_deviceReady;
+	std::atomic<bool> m_noHW4KDecoding;		// derived from the decoder capabilities of the backend
+	bool m_autoSelectVideoTrack;
+
+	// picks the video track, or caps the bitrate of adaptive streams, by decoders, viewport, power budget and frame drops
+	CRenditionSelector m_renditionSelector;
+	std::mutex m_renditionLock;
+
+	// keyframes of the current content, built on the load workers after it was opened
+	std::shared_ptr<const CKeyframeIndex> m_spKeyframeIndex;
+	UINT32 m_keyframeGeneration;			// changes with every content, so indexes of an older one are dropped
+	std::wstring m_contentLocation;			// of the current content, empty if none
+	std::mutex m_keyframeLock;
+
+	// seek preview thumbnails of the current content, decoded on m_thumbnailWorkers
+	std::shared_ptr<CWorkerPool> m_thumbnailWorkers;
+	std::mutex m_thumbnailWorkersLock;
+	CThumbnailExtractor m_thumbnailExtractor;
+
+	CLoopTracker m_loopTracker;
+	std::mutex m_loopLock;
+
+	// never held while calling the session, a paused session presents the frame of a seek right away
+	CFrameScheduler m_scheduler;
+	std::mutex m_schedulerLock;
+
+	// a frame served from the cache leaves the session where it was until it plays again;
+	// m_cachedPosition is where it is sought to then, -1 if the session is at the frame on screen
+	CFrameCache<std::shared_ptr<IPlaybackSurface>> m_frameCache;
+	std::atomic<INT64> m_cachedPosition;
+};
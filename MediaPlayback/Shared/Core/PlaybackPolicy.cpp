@@ -0,0 +1,161 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "PlaybackPolicy.h"
+
+#include <string.h>
+#include <limits.h>
+
+#define _absdiff(x, y) ((x) < (y) ? (y)-(x) : (x)-(y))
+
+static const UINT32 c_noChangedIndex = (UINT32)-1;
+
+
+_Use_decl_annotations_
+PLAYBACK_STATE MakePlaybackState(StateType type, PlaybackState state, HRESULT hresult)
+{
+	PLAYBACK_STATE playbackState;
+	memset(&playbackState, 0, sizeof(playbackState));
+
+	playbackState.type = type;
+	playbackState.state = state;
+	playbackState.hresult = hresult;
+
+	return playbackState;
+}
+
+
+_Use_decl_annotations_
+UINT32 GetFrameTextureHeight(UINT32 naturalHeight, bool isStereoscopic)
+{
+	return isStereoscopic ? naturalHeight * 2 : naturalHeight;
+}
+
+
+_Use_decl_annotations_
+MEDIA_DESCRIPTION MakeMediaDescription(UINT32 width, UINT32 height, LONGLONG duration, bool canSeek, bool isStereoscopic)
+{
+	MEDIA_DESCRIPTION description;
+	memset(&description, 0, sizeof(description));
+
+	description.width = width;
+	description.height = height;
+	description.duration = duration;
+	description.canSeek = canSeek ? 1 : 0;
+	description.isStereoscopic = isStereoscopic ? 1 : 0;
+
+	return description;
+}
+
+
+_Use_decl_annotations_
+bool IsDescribedPlaybackState(PlaybackState state)
+{
+	return state != PlaybackState::PlaybackState_None &&
+		state != PlaybackState::PlaybackState_Opening;
+}
+
+
+_Use_decl_annotations_
+BITRATE_SELECTION SelectAdaptiveBitrates(const std::vector<UINT32>& availableBitrates, bool noHW4KDecoding)
+{
+	BITRATE_SELECTION selection = { 0, 0 };
+
+	if (availableBitrates.size() <= 1)
+		return selection;
+
+	UINT32 maxBR = 0;
+	UINT32 closestTo1080BR = 0;
+	UINT32 _1080Diff = UINT_MAX;
+
+	for (size_t i = 0; i < availableBitrates.size(); i++)
+	{
+		UINT32 uBR = availableBitrates[i];
+		if (!uBR)
+			continue;
+
+		if (uBR > maxBR)
+			maxBR = uBR;
+
+		if (_1080Diff > _absdiff(uBR, _Estimated1080pBitrate_))
+		{
+			closestTo1080BR = uBR;
+			_1080Diff = _absdiff(uBR, _Estimated1080pBitrate_);
+		}
+	}
+
+	if (!noHW4KDecoding && maxBR > 0)
+	{
+		selection.initialBitrate = maxBR;
+	}
+	else if (noHW4KDecoding && closestTo1080BR != 0)
+	{
+		selection.desiredMaxBitrate = closestTo1080BR;
+	}
+
+	return selection;
+}
+
+
+CSubtitleTrackList::CSubtitleTrackList()
+	: m_changedIndex(c_noChangedIndex)
+{
+}
+
+_Use_decl_annotations_
+bool CSubtitleTrackList::BeginUpdate(TrackListChange change, UINT32 changedIndex)
+{
+	if (change == TrackListChange::TrackListChange_ItemInserted)
+	{
+		// a new track only needs its own cue handlers, others have been subscribed already
+		m_changedIndex = changedIndex;
+	}
+	else if (change == TrackListChange::TrackListChange_Reset)
+	{
+		m_changedIndex = c_noChangedIndex;
+	}
+	else
+	{
+		return false;
+	}
+
+	m_tracks.clear();
+
+	return true;
+}
+
+_Use_decl_annotations_
+bool CSubtitleTrackList::AddTrack(UINT32 trackIndex, const SUBTITLE_TRACK& track)
+{
+	m_tracks.push_back(track);
+
+	return m_changedIndex == c_noChangedIndex || m_changedIndex == trackIndex;
+}
+
+void CSubtitleTrackList::Clear()
+{
+	m_tracks.clear();
+	m_changedIndex = c_noChangedIndex;
+}
+
+UINT32 CSubtitleTrackList::GetCount() const
+{
+	return (UINT32)m_tracks.size();
+}
+
+_Use_decl_annotations_
+const SUBTITLE_TRACK* CSubtitleTrackList::GetTrack(UINT32 index) const
+{
+	if (index >= (UINT32)m_tracks.size())
+		return nullptr;
+
+	return &m_tracks[index];
+}
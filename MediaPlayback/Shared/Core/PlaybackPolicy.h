@@ -0,0 +1,90 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Playback decisions of CPlaybackCore: state and media descriptions, frame texture sizes, adaptive bitrates.
+// Nothing here talks to a backend, so the rules are tested on Linux exactly as they run in the plugin.
+
+#include "PlaybackTypes.h"
+
+#include <vector>
+
+#define _Estimated1080pBitrate_ ((UINT32)(13*1000*1000))
+
+
+// Bitrates to apply to an adaptive source right after it has been created. 0 means "leave the default".
+typedef struct _BITRATE_SELECTION
+{
+	UINT32 initialBitrate;
+	UINT32 desiredMaxBitrate;
+} BITRATE_SELECTION;
+
+// Mirrors ABI::Windows::Foundation::Collections::CollectionChange
+enum class TrackListChange : UINT32
+{
+	TrackListChange_Reset = 0,
+	TrackListChange_ItemInserted,
+	TrackListChange_ItemRemoved,
+	TrackListChange_ItemChanged
+};
+
+
+PLAYBACK_STATE MakePlaybackState(
+	_In_ StateType type,
+	_In_ PlaybackState state,
+	_In_ HRESULT hresult = S_OK);
+
+// Height of the frame texture. Stereoscopic frames are always rendered as over/under, so the texture is 2x the natural height.
+UINT32 GetFrameTextureHeight(
+	_In_ UINT32 naturalHeight,
+	_In_ bool isStereoscopic);
+
+MEDIA_DESCRIPTION MakeMediaDescription(
+	_In_ UINT32 width,
+	_In_ UINT32 height,
+	_In_ LONGLONG duration,
+	_In_ bool canSeek,
+	_In_ bool isStereoscopic);
+
+// StateChanged events carry the media description for every state after the source has been opened
+bool IsDescribedPlaybackState(
+	_In_ PlaybackState state);
+
+// Start at the highest available bitrate if 4K+ can be decoded in hardware,
+// otherwise limit the max bitrate to the one closest to _Estimated1080pBitrate_.
+BITRATE_SELECTION SelectAdaptiveBitrates(
+	_In_ const std::vector<UINT32>& availableBitrates,
+	_In_ bool noHW4KDecoding);
+
+
+// Book-keeping of subtitle tracks across TimedMetadataTracksChanged notifications
+class CSubtitleTrackList
+{
+public:
+	CSubtitleTrackList();
+
+	// Returns true if the track list has to be rebuilt for this change (existing entries are dropped)
+	bool BeginUpdate(_In_ TrackListChange change, _In_ UINT32 changedIndex);
+
+	// Adds a subtitle track found at trackIndex of the metadata track list.
+	// Returns true if cue handlers have to be attached to that track.
+	bool AddTrack(_In_ UINT32 trackIndex, _In_ const SUBTITLE_TRACK& track);
+
+	void Clear();
+
+	UINT32 GetCount() const;
+	const SUBTITLE_TRACK* GetTrack(_In_ UINT32 index) const;
+
+private:
+	std::vector<SUBTITLE_TRACK> m_tracks;
+	UINT32 m_changedIndex;
+};
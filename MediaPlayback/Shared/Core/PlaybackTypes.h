@@ -0,0 +1,309 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Types shared between the plugin exports, the Unity scripts and every playback backend
+
+#include "CorePlatform.h"
+#include "DecoderCapabilities.h"
+#include "../Unity/IUnityInterface.h"
+
+#include <string>
+
+
+enum class StateType : UINT32
+{
+    StateType_None = 0,
+    StateType_Opened,
+    StateType_StateChanged,
+    StateType_Failed,
+	StateType_NewFrameTexture,
+	StateType_GraphicsDeviceShutdown,
+	StateType_GraphicsDeviceReady,
+	StateType_LoadCompleted,			// result of LoadContentAsync, hresult and requestId are set
+	StateType_PlaylistItemChanged		// the next playlist item started, requestId is its id
+};
+
+enum class PlaybackState : UINT32
+{
+    PlaybackState_None = 0,
+    PlaybackState_Opening,
+    PlaybackState_Buffering,
+    PlaybackState_Playing,
+    PlaybackState_Paused,
+    PlaybackState_Ended,
+	PlaybackState_NA = 255
+};
+
+// Layout of the frame textures handed to Unity
+enum class FrameFormat : UINT32
+{
+	FrameFormat_BGRA32 = 0,		// one RGB texture, converted by the media pipeline
+	FrameFormat_NV12,			// native 8-bit 4:2:0, luma (R8) and chroma (R8G8) planes, converted by the material
+	FrameFormat_P010			// native 10-bit 4:2:0, luma (R16) and chroma (R16G16) planes
+};
+
+// Who picks the bitrate of adaptive streams while they play
+enum class AbrPolicy : UINT32
+{
+	AbrPolicy_System = 0,		// AdaptiveMediaSource heuristics
+	AbrPolicy_Throughput,		// measured segment download throughput
+	AbrPolicy_Buffer,			// buffer level (BOLA)
+	AbrPolicy_Hybrid			// throughput while the buffer is short, buffer level once it is filled
+};
+
+// How much decoding work video rendition selection may spend, as a ceiling on decoded pixels per second
+enum class PowerBudget : UINT32
+{
+	PowerBudget_Unconstrained = 0,
+	PowerBudget_Balanced,		// up to 1080p60
+	PowerBudget_Saver			// up to 720p30
+};
+
+// Where a seek lands when the position is not on a keyframe. The snapping modes need a keyframe index of the
+// file, without one every seek is accurate.
+enum class SeekMode : UINT32
+{
+	SeekMode_Accurate = 0,		// exactly at the position, decoding from the keyframe before it
+	SeekMode_PreviousKeyframe,	// the keyframe at or before the position, nothing to decode ahead
+	SeekMode_NearestKeyframe	// whichever keyframe is closer
+};
+
+#pragma pack(push, 8)
+typedef struct _MEDIA_DESCRIPTION
+{
+    UINT32 width;
+    UINT32 height;
+    INT64 duration;
+    byte canSeek;
+	byte isStereoscopic;
+	FrameFormat frameFormat;			// set with StateType_NewFrameTexture
+} MEDIA_DESCRIPTION;
+#pragma pack(pop)
+
+#pragma pack(push, 8)
+typedef struct _PLAYBACK_STATE
+{
+    StateType type;
+	PlaybackState state;
+	HRESULT hresult;
+	MEDIA_DESCRIPTION description;
+	UINT32 requestId;					// LoadContentAsync request or playlist item this state belongs to, 0 if none
+} PLAYBACK_STATE;
+#pragma pack(pop)
+
+typedef struct _SUBTITLE_TRACK
+{
+	std::wstring id;
+	std::wstring title;
+	std::wstring language;
+} SUBTITLE_TRACK;
+
+// Video track (rendition) as reported by a playback backend, 0 and VideoCodec_Unknown where it does not tell
+typedef struct _VIDEO_TRACK_INFO
+{
+	UINT32 width;
+	UINT32 height;
+	UINT32 bitrate;
+	UINT32 frameRate;			// rounded up
+	VideoCodec codec;
+	UINT32 profile;
+	UINT32 bitDepth;
+} VIDEO_TRACK_INFO;
+
+#pragma pack(push, 8)
+typedef struct _FRAME_QUEUE_STATS
+{
+	UINT32 capacity;			// number of frame slots
+	UINT32 depth;				// frames published but not picked up by the render thread yet
+	UINT64 publishedFrames;
+	UINT64 presentedFrames;
+	UINT64 droppedFrames;		// frames that never reached the render thread
+	INT64 latestFrameAge;		// 100ns since the latest frame was published, -1 if none
+} FRAME_QUEUE_STATS;
+#pragma pack(pop)
+
+#pragma pack(push, 8)
+typedef struct _EVENT_QUEUE_STATS
+{
+	UINT32 capacity;			// number of records the queue holds
+	UINT32 depth;				// records queued but not drained yet
+	UINT64 queuedEvents;
+	UINT64 deliveredEvents;		// records handed out by DrainEvents
+	UINT64 coalescedEvents;		// StateChanged records replaced by a newer one before being delivered
+	UINT64 droppedEvents;		// records lost because the queue was full
+} EVENT_QUEUE_STATS;
+#pragma pack(pop)
+
+#pragma pack(push, 8)
+typedef struct _SURFACE_POOL_STATS
+{
+	UINT32 pooledSurfaces;		// surface sets waiting to be reused
+	UINT64 pooledBytes;
+	UINT64 budgetBytes;
+	UINT64 hits;				// size changes served from the pool
+	UINT64 misses;				// size changes that allocated
+	UINT64 evictions;			// pooled surfaces destroyed to stay within the budget
+} SURFACE_POOL_STATS;
+#pragma pack(pop)
+
+#pragma pack(push, 8)
+typedef struct _SEGMENT_CACHE_STATS
+{
+	UINT32 entries;				// segments on disk
+	UINT64 sizeBytes;
+	UINT64 budgetBytes;
+	UINT64 hits;				// segment requests served from the cache
+	UINT64 misses;
+	UINT64 bytesSaved;			// download volume served by the hits
+	UINT64 bytesStored;
+	UINT64 evictions;			// segments deleted to stay within the budget
+} SEGMENT_CACHE_STATS;
+#pragma pack(pop)
+
+#pragma pack(push, 8)
+typedef struct _SEGMENT_PREFETCH_STATS
+{
+	INT64 bufferAhead;			// 100ns of downloaded segments right after the one the media source asked for last
+	UINT32 inFlight;			// downloads queued or running
+	UINT32 readySegments;		// downloaded, not asked for yet
+	UINT64 readyBytes;
+	UINT64 hits;				// requests served from a finished download
+	UINT64 joins;				// requests that waited for a download in flight
+	UINT64 misses;				// requests that had to start their download
+	UINT64 bytesFetched;
+	UINT64 bytesWasted;			// downloaded but dropped unused, after seeks and bitrate switches
+} SEGMENT_PREFETCH_STATS;
+#pragma pack(pop)
+
+#pragma pack(push, 8)
+typedef struct _PLAYLIST_STATS
+{
+	UINT32 itemCount;
+	UINT32 currentItemId;		// 0 if none
+	INT32 currentIndex;			// -1 if none
+	UINT32 switchCount;			// items started after the end of the previous one or by PlaylistNext
+	UINT32 prerolledSwitches;	// switches to an item that was already opened while the previous one played
+	INT64 lastSwitchLatency;	// 100ns from the end of the previous item to the first frame of the next, -1 if none yet
+	INT64 maxSwitchLatency;
+} PLAYLIST_STATS;
+#pragma pack(pop)
+
+#pragma pack(push, 8)
+typedef struct _FRAME_SCHEDULER_STATS
+{
+	DOUBLE rate;				// playback rate, negative plays backwards
+	INT64 frameDuration;		// 100ns between two frames of the video, measured while playing at rate 1
+	UINT32 trickPlay;			// the rate is beyond what the decoder plays, frames are shown from keyframe seeks
+	UINT32 trickPlayFrames;		// frames shown in trick play
+	UINT32 skippedKeyframes;	// keyframes trick play passed over because the decoder was still busy
+	UINT32 steps;				// StepFrame calls
+} FRAME_SCHEDULER_STATS;
+#pragma pack(pop)
+
+#pragma pack(push, 8)
+typedef struct _FRAME_CACHE_STATS
+{
+	UINT32 frames;				// presented frames kept around the playhead
+	UINT64 cachedBytes;
+	UINT64 budgetBytes;
+	INT64 firstPosition;		// 100ns, of the first and the last cached frame, -1 if none
+	INT64 lastPosition;
+	UINT64 hits;				// steps, rewinds and trick play frames served without decoding
+	UINT64 misses;				// those that went to the decoder
+	UINT64 evictions;			// frames dropped to stay within the budget
+} FRAME_CACHE_STATS;
+#pragma pack(pop)
+
+#pragma pack(push, 8)
+typedef struct _SHARED_SOURCE_STATS
+{
+	UINT32 sources;				// decode sessions, one per content location open in any player
+	UINT32 views;				// player sessions subscribed to them
+	UINT64 decodedCopies;		// frames copied out of a decoder, once per frame and distinct surface size
+	UINT64 sharedCopies;		// frames players got from a copy made for another player, not from the decoder
+} SHARED_SOURCE_STATS;
+#pragma pack(pop)
+
+#pragma pack(push, 8)
+typedef struct _MEDIA_DEVICE_STATS
+{
+	UINT32 devices;				// media devices alive, one per adapter players render on
+	UINT32 references;			// players holding them
+	UINT64 devicesCreated;
+	UINT64 acquires;			// devices handed to players, created or shared
+	UINT64 deviceLosses;		// graphics device losses that dropped every device
+	INT64 lastCreationTime;		// 100ns
+	INT64 maxCreationTime;		// 100ns
+} MEDIA_DEVICE_STATS;
+#pragma pack(pop)
+
+#pragma pack(push, 8)
+typedef struct _LOOP_STATS
+{
+	UINT32 enabled;
+	UINT32 loopCount;			// wraps from the loop end back to its start
+	INT64 loopStart;			// 100ns
+	INT64 loopEnd;				// 0 loops the whole media
+	INT64 lastLoopGap;			// 100ns between the last frame before a wrap and the first one after it, -1 if none yet
+	INT64 maxLoopGap;
+} LOOP_STATS;
+#pragma pack(pop)
+
+#pragma pack(push, 8)
+typedef struct _THUMBNAIL_ATLAS_INFO
+{
+	UINT32 width;				// BGRA pixels of the whole atlas, rows top down
+	UINT32 height;
+	UINT32 tileWidth;
+	UINT32 tileHeight;
+	UINT32 columns;				// tile i is at column i % columns, row i / columns
+	UINT32 tileCount;			// tile i shows the keyframe at or before i * interval
+	UINT32 readyCount;			// tiles decoded so far, the others are transparent
+	INT64 interval;				// 100ns
+} THUMBNAIL_ATLAS_INFO;
+#pragma pack(pop)
+
+#define _MaxBufferedRanges_ 8
+
+#pragma pack(push, 8)
+typedef struct _MEDIA_TIME_RANGE
+{
+	INT64 start;				// 100ns
+	INT64 end;
+} MEDIA_TIME_RANGE;
+
+// Published by the player through GetPlaybackStatus and read in place by the client, see CStatusBlock
+typedef struct _PLAYBACK_STATUS
+{
+	UINT32 sequence;			// odd while the player is writing; read it before and after the other fields
+	PlaybackState state;
+	INT64 position;				// 100ns
+	INT64 duration;				// 100ns
+	UINT32 bitrate;				// bits per second of the current adaptive stream, 0 if not adaptive
+	UINT32 bufferedRangeCount;
+	MEDIA_TIME_RANGE bufferedRanges[_MaxBufferedRanges_];
+	UINT64 frameCounter;		// frames published by the decoder
+	UINT64 droppedFrames;		// frames that never reached the render thread
+} PLAYBACK_STATUS;
+#pragma pack(pop)
+
+extern "C" typedef void(UNITY_INTERFACE_API *StateChangedCallback)(
+	_In_ void* pClientObject,
+    _In_ PLAYBACK_STATE args);
+
+
+extern "C" typedef void(UNITY_INTERFACE_API *SubtitleItemEnteredCallback)(
+	_In_ void* pClientObject, _In_ const wchar_t* subtitlesTrackId, _In_ const wchar_t* textCueId, _In_ const wchar_t* language, _In_ const wchar_t** textLines, _In_ unsigned int lineCount);
+
+extern "C" typedef void(UNITY_INTERFACE_API *SubtitleItemExitedCallback)(
+	_In_ void* pClientObject, _In_ const wchar_t* subtitlesTrackId, _In_ const wchar_t* textCueId);
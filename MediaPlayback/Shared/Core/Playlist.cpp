@@ -0,0 +1,188 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "Playlist.h"
+
+
+CPlaylist::CPlaylist()
+	: m_currentId(0)
+	, m_nextId(0)
+	, m_switchStart(0)
+	, m_switchCount(0)
+	, m_prerolledSwitches(0)
+	, m_lastSwitchLatency(-1)
+	, m_maxSwitchLatency(-1)
+{
+}
+
+_Use_decl_annotations_
+HRESULT CPlaylist::Insert(UINT32 index, const std::wstring& contentLocation, UINT32* pId)
+{
+	NULL_CHK(pId);
+
+	if (contentLocation.empty())
+		return E_INVALIDARG;
+
+	// 0 stays "no item"
+	UINT32 id = ++m_nextId;
+	if (id == 0)
+		id = ++m_nextId;
+
+	PLAYLIST_ENTRY entry = { id, contentLocation };
+
+	if (index > m_entries.size())
+		index = (UINT32)m_entries.size();
+
+	m_entries.insert(m_entries.begin() + index, entry);
+
+	if (m_currentId == 0)
+		m_currentId = id;
+
+	*pId = id;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaylist::Remove(UINT32 id, bool* pWasCurrent)
+{
+	INT32 index = FindIndex(id);
+	if (index < 0)
+		return E_INVALIDARG;
+
+	bool wasCurrent = (id == m_currentId);
+
+	m_entries.erase(m_entries.begin() + index);
+
+	if (wasCurrent)
+	{
+		m_currentId = ((size_t)index < m_entries.size()) ? m_entries[index].id : 0;
+		m_switchStart = 0;
+	}
+
+	if (pWasCurrent)
+		*pWasCurrent = wasCurrent;
+
+	return S_OK;
+}
+
+void CPlaylist::Clear()
+{
+	m_entries.clear();
+	m_currentId = 0;
+	m_switchStart = 0;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaylist::MoveTo(UINT32 id)
+{
+	if (FindIndex(id) < 0)
+		return E_INVALIDARG;
+
+	m_currentId = id;
+
+	return S_OK;
+}
+
+HRESULT CPlaylist::MoveNext()
+{
+	INT32 index = FindIndex(m_currentId);
+	if (index < 0)
+		return E_ILLEGAL_METHOD_CALL;
+
+	if ((size_t)index + 1 >= m_entries.size())
+		return S_FALSE;
+
+	m_currentId = m_entries[index + 1].id;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+bool CPlaylist::GetCurrent(PLAYLIST_ENTRY* pEntry) const
+{
+	INT32 index = FindIndex(m_currentId);
+	if (index < 0)
+		return false;
+
+	*pEntry = m_entries[index];
+
+	return true;
+}
+
+_Use_decl_annotations_
+bool CPlaylist::GetNext(PLAYLIST_ENTRY* pEntry) const
+{
+	INT32 index = FindIndex(m_currentId);
+	if (index < 0 || (size_t)index + 1 >= m_entries.size())
+		return false;
+
+	*pEntry = m_entries[index + 1];
+
+	return true;
+}
+
+_Use_decl_annotations_
+void CPlaylist::BeginSwitch(INT64 now, bool prerolled)
+{
+	// a switch started before the previous one showed a frame is measured from its own start
+	m_switchStart = (now != 0) ? now : 1;
+	m_switchCount++;
+
+	if (prerolled)
+		m_prerolledSwitches++;
+}
+
+_Use_decl_annotations_
+HRESULT CPlaylist::EndSwitch(INT64 now)
+{
+	if (m_switchStart == 0)
+		return S_FALSE;
+
+	INT64 latency = now - m_switchStart;
+	if (latency < 0)
+		latency = 0;
+
+	m_lastSwitchLatency = latency;
+	if (latency > m_maxSwitchLatency)
+		m_maxSwitchLatency = latency;
+
+	m_switchStart = 0;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+void CPlaylist::GetStats(PLAYLIST_STATS* pStats) const
+{
+	pStats->itemCount = (UINT32)m_entries.size();
+	pStats->currentItemId = m_currentId;
+	pStats->currentIndex = FindIndex(m_currentId);
+	pStats->switchCount = m_switchCount;
+	pStats->prerolledSwitches = m_prerolledSwitches;
+	pStats->lastSwitchLatency = m_lastSwitchLatency;
+	pStats->maxSwitchLatency = m_maxSwitchLatency;
+}
+
+_Use_decl_annotations_
+INT32 CPlaylist::FindIndex(UINT32 id) const
+{
+	if (id == 0)
+		return -1;
+
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		if (m_entries[i].id == id)
+			return (INT32)i;
+	}
+
+	return -1;
+}
@@ -0,0 +1,79 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Items of a gapless playlist and which of them plays. Items keep their id while others are inserted or removed
+// around them. The player opens GetNext() ahead while GetCurrent() plays, so the switch at the end of an item only
+// has to start the next one instead of opening it; BeginSwitch/EndSwitch measure how long that takes.
+//
+// Not thread safe, players guard it with their load lock.
+
+#include "CorePlatform.h"
+#include "PlaybackTypes.h"
+
+#include <string>
+#include <vector>
+
+
+typedef struct _PLAYLIST_ENTRY
+{
+	UINT32 id;
+	std::wstring contentLocation;
+} PLAYLIST_ENTRY;
+
+
+class CPlaylist
+{
+public:
+	CPlaylist();
+
+	// index is clamped to the item count, appending. While no item is current the new one becomes current.
+	HRESULT Insert(_In_ UINT32 index, _In_ const std::wstring& contentLocation, _Out_ UINT32* pId);
+
+	// Removing the current item makes the one after it current, none if it was the last
+	HRESULT Remove(_In_ UINT32 id, _Out_opt_ bool* pWasCurrent);
+
+	void Clear();
+
+	HRESULT MoveTo(_In_ UINT32 id);
+
+	// S_FALSE at the last item, which stays current
+	HRESULT MoveNext();
+
+	bool IsEmpty() const { return m_entries.empty(); }
+	UINT32 GetCount() const { return (UINT32)m_entries.size(); }
+
+	bool GetCurrent(_Out_ PLAYLIST_ENTRY* pEntry) const;
+	bool GetNext(_Out_ PLAYLIST_ENTRY* pEntry) const;
+	UINT32 GetCurrentId() const { return m_currentId; }
+
+	// A switch to the current item started at time now; prerolled if the item was opened already
+	void BeginSwitch(_In_ INT64 now, _In_ bool prerolled);
+
+	// The first frame of the current item arrived, S_FALSE if no switch was pending
+	HRESULT EndSwitch(_In_ INT64 now);
+
+	void GetStats(_Out_ PLAYLIST_STATS* pStats) const;
+
+private:
+	INT32 FindIndex(_In_ UINT32 id) const;
+
+	std::vector<PLAYLIST_ENTRY> m_entries;
+	UINT32 m_currentId;
+	UINT32 m_nextId;
+
+	INT64 m_switchStart;			// 0 if no switch is pending
+	UINT32 m_switchCount;
+	UINT32 m_prerolledSwitches;
+	INT64 m_lastSwitchLatency;
+	INT64 m_maxSwitchLatency;
+};
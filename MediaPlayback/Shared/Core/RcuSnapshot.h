@@ -0,0 +1,130 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Read-copy-update container for data read on hot paths and rarely written.
+//
+// Readers open a CReadScope and see an immutable snapshot: two atomic increments and no lock, they never wait for writers.
+// Writers are serialized by a mutex, modify a private copy and publish it with a pointer swap. Update() returns
+// once every reader that could still see the previous snapshot has left its scope, then the previous snapshot is freed.
+//
+// Readers are tracked by two counters; publishing flips readers to the other counter and waits for the old one to drain.
+// A reader re-checks the counter index after registering, so it either is seen by the writer or reads the new snapshot.
+//
+// Read scopes must be short and must not call Update() (the writer would wait for its own thread).
+
+#include "CorePlatform.h"
+
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <thread>
+
+
+template <typename T>
+class CRcuSnapshot
+{
+public:
+	CRcuSnapshot()
+		: m_current(new T())
+		, m_readIndex(0)
+	{
+		m_readers[0] = 0;
+		m_readers[1] = 0;
+	}
+
+	~CRcuSnapshot()
+	{
+		delete m_current.load();
+	}
+
+	class CReadScope
+	{
+	public:
+		explicit CReadScope(_In_ CRcuSnapshot& owner)
+			: m_owner(owner)
+		{
+			for (;;)
+			{
+				m_index = m_owner.m_readIndex.load();
+				m_owner.m_readers[m_index].fetch_add(1);
+
+				if (m_owner.m_readIndex.load() == m_index)
+					break;
+
+				// a writer flipped the index meanwhile, it may not have seen this reader
+				m_owner.m_readers[m_index].fetch_sub(1);
+			}
+
+			m_pValue = m_owner.m_current.load();
+		}
+
+		~CReadScope()
+		{
+			m_owner.m_readers[m_index].fetch_sub(1);
+		}
+
+		const T& Get() const { return *m_pValue; }
+		const T* operator->() const { return m_pValue; }
+
+	private:
+		CReadScope(const CReadScope&);
+		CReadScope& operator=(const CReadScope&);
+
+		CRcuSnapshot& m_owner;
+		const T* m_pValue;
+		UINT32 m_index;
+	};
+
+	// fnUpdate(T& copy) returns S_OK to publish the modified copy; S_FALSE or a failure leaves the snapshot untouched.
+	// Returns what fnUpdate returned.
+	template <typename TUpdate>
+	HRESULT Update(_In_ const TUpdate& fnUpdate)
+	{
+		std::lock_guard<std::mutex> lock(m_writeLock);
+
+		T* pNext = new (std::nothrow) T(*m_current.load());
+		if (pNext == nullptr)
+			return E_OUTOFMEMORY;
+
+		HRESULT hr = fnUpdate(*pNext);
+		if (hr != S_OK)
+		{
+			delete pNext;
+			return hr;
+		}
+
+		T* pPrevious = m_current.exchange(pNext);
+
+		// readers registering from now on use the other counter and see pNext
+		UINT32 index = m_readIndex.load();
+		m_readIndex.store(index ^ 1);
+
+		while (m_readers[index].load() != 0)
+		{
+			std::this_thread::yield();
+		}
+
+		delete pPrevious;
+
+		return S_OK;
+	}
+
+private:
+	CRcuSnapshot(const CRcuSnapshot&);
+	CRcuSnapshot& operator=(const CRcuSnapshot&);
+
+	std::atomic<T*> m_current;
+	std::atomic<UINT32> m_readIndex;
+	std::atomic<UINT32> m_readers[2];
+	std::mutex m_writeLock;
+};
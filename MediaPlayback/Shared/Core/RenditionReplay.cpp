@@ -0,0 +1,156 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "RenditionReplay.h"
+
+#include <stdlib.h>
+
+#include <sstream>
+
+
+static bool ParseSize(const std::string& value, UINT32* pWidth, UINT32* pHeight)
+{
+	size_t separator = value.find('x');
+	if (separator == std::string::npos)
+		return false;
+
+	*pWidth = (UINT32)strtoul(value.c_str(), nullptr, 10);
+	*pHeight = (UINT32)strtoul(value.c_str() + separator + 1, nullptr, 10);
+
+	return true;
+}
+
+static void AddStep(const CRenditionSelector& selector, const std::vector<RENDITION_INFO>& renditions, UINT32 line, INT32* pSelected, std::vector<RENDITION_REPLAY_STEP>* pSteps)
+{
+	RENDITION_REPLAY_STEP step;
+	step.line = line;
+	step.selectedIndex = selector.Select(renditions);
+	step.pixelRateCeiling = selector.GetPixelRateCeiling();
+
+	pSteps->push_back(step);
+	*pSelected = step.selectedIndex;
+}
+
+
+_Use_decl_annotations_
+HRESULT ReplayRenditionTrace(const std::string& trace, std::vector<RENDITION_REPLAY_STEP>* pSteps, UINT32* pErrorLine)
+{
+	NULL_CHK(pSteps);
+
+	pSteps->clear();
+	if (pErrorLine)
+		*pErrorLine = 0;
+
+	CRenditionSelector selector;
+	CDecoderCapabilities capabilities;
+	std::vector<RENDITION_INFO> renditions;
+	INT32 selected = -1;
+
+	std::istringstream lines(trace);
+	std::string line;
+	UINT32 lineNumber = 0;
+	while (std::getline(lines, line))
+	{
+		lineNumber++;
+
+		size_t comment = line.find('#');
+		if (comment != std::string::npos)
+			line.erase(comment);
+
+		std::istringstream values(line);
+		std::string command;
+		if (!(values >> command))
+			continue;
+
+		bool valid = true;
+
+		if (command == "capability")
+		{
+			CDecoderCapabilities parsed;
+			std::string rest;
+			std::getline(values, rest);
+
+			valid = SUCCEEDED(parsed.Parse(rest)) && !parsed.IsEmpty();
+			if (valid)
+			{
+				capabilities.Add(parsed.GetCapabilities().front());
+				selector.SetCapabilities(capabilities);
+			}
+		}
+		else if (command == "rendition")
+		{
+			RENDITION_INFO rendition = {};
+			rendition.codec = VideoCodec::VideoCodec_Unknown;
+
+			std::string size;
+			std::string codecs;
+			valid = (values >> rendition.bitrate >> size >> rendition.frameRate) && ParseSize(size, &rendition.width, &rendition.height);
+			if (valid && (values >> codecs))
+				ParseCodecList(codecs, &rendition);
+
+			renditions.push_back(rendition);
+		}
+		else if (command == "clear")
+		{
+			renditions.clear();
+			selector.Reset();
+			selected = -1;
+		}
+		else if (command == "viewport")
+		{
+			UINT32 width = 0;
+			UINT32 height = 0;
+			valid = (bool)(values >> width >> height);
+			selector.SetViewport(width, height);
+		}
+		else if (command == "power")
+		{
+			std::string budget;
+			values >> budget;
+
+			if (budget == "unconstrained")
+				selector.SetPowerBudget(PowerBudget::PowerBudget_Unconstrained);
+			else if (budget == "balanced")
+				selector.SetPowerBudget(PowerBudget::PowerBudget_Balanced);
+			else if (budget == "saver")
+				selector.SetPowerBudget(PowerBudget::PowerBudget_Saver);
+			else
+				valid = false;
+		}
+		else if (command == "select")
+		{
+			AddStep(selector, renditions, lineNumber, &selected, pSteps);
+		}
+		else if (command == "frames")
+		{
+			UINT64 presented = 0;
+			UINT64 dropped = 0;
+			valid = (bool)(values >> presented >> dropped);
+
+			if (valid && selected >= 0 && selector.OnFrameStats(presented, dropped, renditions[selected]))
+				AddStep(selector, renditions, lineNumber, &selected, pSteps);
+		}
+		else
+		{
+			valid = false;
+		}
+
+		if (!valid)
+		{
+			if (pErrorLine)
+				*pErrorLine = lineNumber;
+
+			return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+		}
+	}
+
+	return S_OK;
+}
@@ -0,0 +1,45 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Feeds a recorded session through CRenditionSelector, so selection changes can be checked offline
+// (part of the portable core, runs on Linux).
+//
+// A trace is a text file, one command per line, # starts a comment:
+//   capability <codec> <profile> <bitDepth> <maxWidth>x<maxHeight> <maxFrameRate>	(as CDecoderCapabilities::Serialize writes it)
+//   rendition <bitrate> <width>x<height> <frameRate> [<codecs>]	(appended to the rendition list)
+//   clear										(empties the rendition list and resets the selector, a new source)
+//   viewport <width> <height>
+//   power unconstrained|balanced|saver
+//   select										(picks a rendition from the list)
+//   frames <presented> <dropped>				(cumulative counters of the rendition picked last, may pick again)
+
+#include "RenditionSelector.h"
+
+#include <string>
+#include <vector>
+
+
+typedef struct _RENDITION_REPLAY_STEP
+{
+	UINT32 line;				// 1-based line of the select or frames command
+	INT32 selectedIndex;		// into the rendition list, -1 if nothing is decodable
+	UINT64 pixelRateCeiling;	// when the selection was made, 0 if none
+} RENDITION_REPLAY_STEP;
+
+
+// One step per selection made. Fails with HRESULT_FROM_WIN32(ERROR_INVALID_DATA) on a malformed line, its
+// number in pErrorLine; the steps before it are kept.
+HRESULT ReplayRenditionTrace(
+	_In_ const std::string& trace,
+	_Out_ std::vector<RENDITION_REPLAY_STEP>* pSteps,
+	_Out_opt_ UINT32* pErrorLine = nullptr);
@@ -0,0 +1,236 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "RenditionSelector.h"
+
+#define _BalancedPixelRate_ (1920ull * 1080ull * 60ull)
+#define _SaverPixelRate_ (1280ull * 720ull * 30ull)
+
+
+static UINT64 GetPixelRate(const RENDITION_INFO& rendition)
+{
+	UINT32 frameRate = rendition.frameRate ? rendition.frameRate : _RenditionDefaultFrameRate_;
+
+	return (UINT64)rendition.width * rendition.height * frameRate;
+}
+
+// Within the ceiling: more pixels in the viewport, then fewer pixels to decode, then the higher bitrate.
+// Above it: the cheapest to decode.
+static bool IsBetterRendition(const RENDITION_SCORE& score, const RENDITION_INFO& rendition, const RENDITION_SCORE& bestScore, const RENDITION_INFO& best)
+{
+	if (score.withinCeiling != bestScore.withinCeiling)
+		return score.withinCeiling;
+
+	if (score.withinCeiling)
+	{
+		if (score.viewportPixels != bestScore.viewportPixels)
+			return score.viewportPixels > bestScore.viewportPixels;
+
+		if (score.pixelRate != bestScore.pixelRate)
+			return score.pixelRate < bestScore.pixelRate;
+	}
+	else
+	{
+		if (score.pixelRate != bestScore.pixelRate)
+			return score.pixelRate < bestScore.pixelRate;
+
+		if (score.viewportPixels != bestScore.viewportPixels)
+			return score.viewportPixels > bestScore.viewportPixels;
+	}
+
+	return rendition.bitrate > best.bitrate;
+}
+
+
+CRenditionSelector::CRenditionSelector()
+	: m_viewportWidth(0)
+	, m_viewportHeight(0)
+	, m_powerBudget(PowerBudget::PowerBudget_Unconstrained)
+	, m_dropCeiling(0)
+	, m_windowPresentedFrames(0)
+	, m_windowDroppedFrames(0)
+	, m_windowStarted(false)
+	, m_cleanWindows(0)
+	, m_recoveryWindows(_RenditionRecoveryWindows_)
+{
+}
+
+_Use_decl_annotations_
+void CRenditionSelector::SetCapabilities(const CDecoderCapabilities& capabilities)
+{
+	m_capabilities = capabilities;
+}
+
+_Use_decl_annotations_
+void CRenditionSelector::SetViewport(UINT32 width, UINT32 height)
+{
+	m_viewportWidth = width;
+	m_viewportHeight = height;
+}
+
+_Use_decl_annotations_
+void CRenditionSelector::SetPowerBudget(PowerBudget powerBudget)
+{
+	m_powerBudget = powerBudget;
+}
+
+void CRenditionSelector::Reset()
+{
+	m_dropCeiling = 0;
+	m_windowStarted = false;
+	m_cleanWindows = 0;
+	m_recoveryWindows = _RenditionRecoveryWindows_;
+}
+
+UINT64 CRenditionSelector::GetPixelRateCeiling() const
+{
+	UINT64 ceiling = 0;
+	if (m_powerBudget == PowerBudget::PowerBudget_Balanced)
+		ceiling = _BalancedPixelRate_;
+	else if (m_powerBudget == PowerBudget::PowerBudget_Saver)
+		ceiling = _SaverPixelRate_;
+
+	if (m_dropCeiling != 0 && (ceiling == 0 || m_dropCeiling < ceiling))
+		ceiling = m_dropCeiling;
+
+	return ceiling;
+}
+
+_Use_decl_annotations_
+RENDITION_SCORE CRenditionSelector::Score(const RENDITION_INFO& rendition) const
+{
+	RENDITION_SCORE score;
+
+	score.decodable = m_capabilities.IsEmpty() || m_capabilities.CanDecode(rendition);
+	score.pixelRate = GetPixelRate(rendition);
+
+	UINT64 ceiling = GetPixelRateCeiling();
+	score.withinCeiling = ceiling == 0 || score.pixelRate <= ceiling;
+
+	UINT64 width = rendition.width;
+	UINT64 height = rendition.height;
+	if (m_viewportWidth != 0 && m_viewportHeight != 0)
+	{
+		// the frame is scaled to fit the viewport, pixels beyond its size are not seen
+		if (width * m_viewportHeight > height * m_viewportWidth)
+		{
+			if (width > m_viewportWidth)
+			{
+				height = height * m_viewportWidth / width;
+				width = m_viewportWidth;
+			}
+		}
+		else if (height > m_viewportHeight)
+		{
+			width = width * m_viewportHeight / height;
+			height = m_viewportHeight;
+		}
+	}
+	score.viewportPixels = width * height;
+
+	return score;
+}
+
+_Use_decl_annotations_
+INT32 CRenditionSelector::Select(const std::vector<RENDITION_INFO>& renditions) const
+{
+	INT32 bestIndex = -1;
+	RENDITION_SCORE bestScore = {};
+
+	for (size_t i = 0; i < renditions.size(); i++)
+	{
+		RENDITION_SCORE score = Score(renditions[i]);
+		if (!score.decodable)
+			continue;
+
+		if (bestIndex < 0 || IsBetterRendition(score, renditions[i], bestScore, renditions[bestIndex]))
+		{
+			bestIndex = (INT32)i;
+			bestScore = score;
+		}
+	}
+
+	return bestIndex;
+}
+
+_Use_decl_annotations_
+bool CRenditionSelector::OnFrameStats(UINT64 presentedFrames, UINT64 droppedFrames, const RENDITION_INFO& current)
+{
+	// counters start over with every source
+	if (!m_windowStarted || presentedFrames < m_windowPresentedFrames || droppedFrames < m_windowDroppedFrames)
+	{
+		m_windowPresentedFrames = presentedFrames;
+		m_windowDroppedFrames = droppedFrames;
+		m_windowStarted = true;
+		return false;
+	}
+
+	UINT64 presented = presentedFrames - m_windowPresentedFrames;
+	UINT64 dropped = droppedFrames - m_windowDroppedFrames;
+	if (presented + dropped < _RenditionDropWindowFrames_)
+		return false;
+
+	m_windowPresentedFrames = presentedFrames;
+	m_windowDroppedFrames = droppedFrames;
+
+	UINT64 dropPermille = dropped * 1000 / (presented + dropped);
+	UINT64 pixelRate = GetPixelRate(current);
+
+	if (dropPermille >= _RenditionMaxDropPermille_)
+	{
+		m_cleanWindows = 0;
+
+		// nothing cheaper to go to when the size is not known, or a switch below the ceiling is still on its way
+		if (pixelRate == 0 || (m_dropCeiling != 0 && m_dropCeiling < pixelRate))
+			return false;
+
+		m_dropCeiling = pixelRate - 1;
+		return true;
+	}
+
+	if (dropPermille < _RenditionCleanDropPermille_ && m_dropCeiling != 0)
+	{
+		if (++m_cleanWindows >= m_recoveryWindows)
+		{
+			m_dropCeiling = 0;
+			m_cleanWindows = 0;
+
+			// should it drop again, the next try waits longer
+			if (m_recoveryWindows < _RenditionMaxRecoveryWindows_)
+				m_recoveryWindows *= 2;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+_Use_decl_annotations_
+std::vector<RENDITION_INFO> MakeTrackRenditions(const std::vector<VIDEO_TRACK_INFO>& tracks)
+{
+	std::vector<RENDITION_INFO> renditions(tracks.size());
+
+	for (size_t i = 0; i < tracks.size(); i++)
+	{
+		RENDITION_INFO& rendition = renditions[i];
+		rendition.bitrate = tracks[i].bitrate;
+		rendition.width = tracks[i].width;
+		rendition.height = tracks[i].height;
+		rendition.frameRate = tracks[i].frameRate;
+		rendition.codec = tracks[i].codec;
+		rendition.profile = tracks[i].profile;
+		rendition.bitDepth = tracks[i].bitDepth;
+	}
+
+	return renditions;
+}
@@ -0,0 +1,86 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Picks the video rendition (a track of the playback item, or a bitrate of an adaptive stream) to play.
+//
+// Renditions the hardware decoders can not handle are out. Of the rest, the one showing the most pixels in the
+// viewport wins, the cheapest to decode breaking ties, within a ceiling of decoded pixels per second set by the
+// power budget and lowered whenever too many frames are dropped. The ceiling is lifted again after a while
+// without drops, the wait doubling every time it had to be lowered again.
+// Not thread safe, the owner serializes the calls.
+
+#include "DecoderCapabilities.h"
+#include "PlaybackTypes.h"
+
+#include <vector>
+
+#define _RenditionDropWindowFrames_ 120		// frames (presented and dropped) the drop rate is measured over
+#define _RenditionMaxDropPermille_ 50		// drop rate lowering the ceiling below the current rendition
+#define _RenditionCleanDropPermille_ 10		// drop rate a window counts as clean below
+#define _RenditionRecoveryWindows_ 15		// clean windows before the ceiling is lifted the first time
+#define _RenditionMaxRecoveryWindows_ 240
+#define _RenditionDefaultFrameRate_ 30		// assumed for renditions without a frame rate
+
+
+typedef struct _RENDITION_SCORE
+{
+	bool decodable;
+	bool withinCeiling;			// within the power budget and the frame drop ceiling
+	UINT64 viewportPixels;		// pixels of a frame that show in the viewport
+	UINT64 pixelRate;			// pixels decoded per second
+} RENDITION_SCORE;
+
+
+class CRenditionSelector
+{
+public:
+	CRenditionSelector();
+
+	// Without capabilities every rendition is taken as decodable, in software if need be
+	void SetCapabilities(_In_ const CDecoderCapabilities& capabilities);
+	// 0 for a viewport of unknown size, every pixel counts then
+	void SetViewport(_In_ UINT32 width, _In_ UINT32 height);
+	void SetPowerBudget(_In_ PowerBudget powerBudget);
+
+	// A new source, frame drops of the previous one do not count
+	void Reset();
+
+	RENDITION_SCORE Score(_In_ const RENDITION_INFO& rendition) const;
+
+	// Index of the rendition to play, -1 if none is decodable
+	INT32 Select(_In_ const std::vector<RENDITION_INFO>& renditions) const;
+
+	// Cumulative frame counters of the playing rendition. Returns true when the ceiling changed and it is time to Select again.
+	bool OnFrameStats(_In_ UINT64 presentedFrames, _In_ UINT64 droppedFrames, _In_ const RENDITION_INFO& current);
+
+	// 0 if there is none
+	UINT64 GetPixelRateCeiling() const;
+
+private:
+	CDecoderCapabilities m_capabilities;
+	UINT32 m_viewportWidth;
+	UINT32 m_viewportHeight;
+	PowerBudget m_powerBudget;
+
+	UINT64 m_dropCeiling;				// pixel rate, 0 if frames have not been dropped
+	UINT64 m_windowPresentedFrames;		// counters at the start of the current window
+	UINT64 m_windowDroppedFrames;
+	bool m_windowStarted;
+	UINT32 m_cleanWindows;
+	UINT32 m_recoveryWindows;
+};
+
+
+// Video tracks of a playback item as renditions of an unknown codec
+std::vector<RENDITION_INFO> MakeTrackRenditions(
+	_In_ const std::vector<VIDEO_TRACK_INFO>& tracks);
@@ -0,0 +1,676 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "SegmentCache.h"
+#include "FileSystem.h"
+
+#include <string.h>
+#include <wchar.h>
+
+#include <iterator>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define _SegmentIndexMagic_ 0x4353504D	// 'MPSC'
+#define _SegmentIndexVersion_ 1
+#define _SegmentIndexName_ L"index"
+#define _SegmentIndexTempName_ L"index.tmp"
+#define _SegmentFileExtension_ L".seg"
+#define _TempFileExtension_ L".tmp"
+#define _MaxIndexStringLength_ 0x10000
+
+#define _FnvOffsetBasis_ 0xcbf29ce484222325ull
+#define _FnvPrime_ 0x100000001b3ull
+
+
+static bool EndsWith(const std::wstring& value, const wchar_t* suffix)
+{
+	size_t length = wcslen(suffix);
+	return value.size() >= length && value.compare(value.size() - length, length, suffix) == 0;
+}
+
+static std::wstring ToHex(UINT64 value)
+{
+	static const wchar_t digits[] = L"0123456789abcdef";
+
+	std::wstring hex(16, L'0');
+	for (int i = 15; i >= 0; i--)
+	{
+		hex[i] = digits[value & 0xF];
+		value >>= 4;
+	}
+
+	return hex;
+}
+
+static bool ParseHex(const std::wstring& hex, UINT64* pValue)
+{
+	if (hex.size() != 16)
+		return false;
+
+	UINT64 value = 0;
+	for (wchar_t c : hex)
+	{
+		UINT32 digit;
+		if (c >= L'0' && c <= L'9')
+			digit = c - L'0';
+		else if (c >= L'a' && c <= L'f')
+			digit = c - L'a' + 10;
+		else
+			return false;
+
+		value = (value << 4) | digit;
+	}
+
+	*pValue = value;
+
+	return true;
+}
+
+static UINT64 HashBytes(UINT64 hash, const BYTE* pData, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= pData[i];
+		hash *= _FnvPrime_;
+	}
+
+	return hash;
+}
+
+static UINT64 HashString(UINT64 hash, const std::wstring& value)
+{
+	// wchar_t is 2 bytes on Windows and 4 elsewhere, hash every character as 4 bytes
+	for (wchar_t c : value)
+	{
+		UINT32 cp = (UINT32)c;
+		hash = HashBytes(hash, (const BYTE*)&cp, sizeof(cp));
+	}
+
+	return hash;
+}
+
+// Index serialization: little endian on every platform we ship, so plain copies of the values
+
+static void WriteValue(std::vector<BYTE>* pBuffer, const void* pValue, size_t size)
+{
+	const BYTE* pBytes = (const BYTE*)pValue;
+	pBuffer->insert(pBuffer->end(), pBytes, pBytes + size);
+}
+
+static void WriteString(std::vector<BYTE>* pBuffer, const std::wstring& value)
+{
+	UINT32 length = (UINT32)value.size();
+	WriteValue(pBuffer, &length, sizeof(length));
+
+	for (wchar_t c : value)
+	{
+		UINT32 cp = (UINT32)c;
+		WriteValue(pBuffer, &cp, sizeof(cp));
+	}
+}
+
+static bool ReadValue(const std::vector<BYTE>& buffer, size_t* pOffset, void* pValue, size_t size)
+{
+	if (buffer.size() - *pOffset < size)
+		return false;
+
+	memcpy(pValue, buffer.data() + *pOffset, size);
+	*pOffset += size;
+
+	return true;
+}
+
+static bool ReadString(const std::vector<BYTE>& buffer, size_t* pOffset, std::wstring* pValue)
+{
+	UINT32 length = 0;
+	if (!ReadValue(buffer, pOffset, &length, sizeof(length)) || length > _MaxIndexStringLength_)
+		return false;
+
+	pValue->clear();
+	pValue->reserve(length);
+
+	for (UINT32 i = 0; i < length; i++)
+	{
+		UINT32 cp = 0;
+		if (!ReadValue(buffer, pOffset, &cp, sizeof(cp)))
+			return false;
+
+		pValue->push_back((wchar_t)cp);
+	}
+
+	return true;
+}
+
+
+CMappedSegment::CMappedSegment()
+	: m_pData(nullptr)
+	, m_size(0)
+{
+}
+
+CMappedSegment::~CMappedSegment()
+{
+	if (!m_pData)
+		return;
+
+#if defined(_WIN32)
+	UnmapViewOfFile(m_pData);
+#else
+	munmap((void*)m_pData, (size_t)m_size);
+#endif
+}
+
+_Use_decl_annotations_
+HRESULT CMappedSegment::Map(const std::wstring& path, UINT64 expectedSize, std::shared_ptr<CMappedSegment>* pspSegment)
+{
+	NULL_CHK(pspSegment);
+
+	pspSegment->reset();
+
+	// empty files cannot be mapped, Store does not create them
+	if (!expectedSize)
+		return E_INVALIDARG;
+
+	std::shared_ptr<CMappedSegment> spSegment(new (std::nothrow) CMappedSegment());
+	if (!spSegment)
+		return E_OUTOFMEMORY;
+
+#if defined(_WIN32)
+	// FILE_SHARE_DELETE lets the cache evict the segment while it is mapped
+	HANDLE hFile = CreateFile2(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, OPEN_EXISTING, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return HRESULT_FROM_WIN32(GetLastError());
+
+	HRESULT hr = S_OK;
+
+	LARGE_INTEGER size = {};
+	if (!GetFileSizeEx(hFile, &size) || (UINT64)size.QuadPart != expectedSize)
+		hr = HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+
+	HANDLE hMapping = nullptr;
+	if (SUCCEEDED(hr))
+	{
+		hMapping = CreateFileMappingFromApp(hFile, nullptr, PAGE_READONLY, 0, nullptr);
+		if (!hMapping)
+			hr = HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	// the view keeps the mapping and the file open
+	if (SUCCEEDED(hr))
+	{
+		spSegment->m_pData = (const BYTE*)MapViewOfFileFromApp(hMapping, FILE_MAP_READ, 0, 0);
+		if (!spSegment->m_pData)
+			hr = HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	if (hMapping)
+		CloseHandle(hMapping);
+
+	CloseHandle(hFile);
+
+	IFR(hr);
+#else
+	int fd = open(ToNativePath(path).c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return ErrnoToHResult();
+
+	HRESULT hr = S_OK;
+
+	struct stat info = {};
+	if (fstat(fd, &info) != 0 || (UINT64)info.st_size != expectedSize)
+	{
+		hr = HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+	}
+	else
+	{
+		void* pData = mmap(nullptr, (size_t)expectedSize, PROT_READ, MAP_SHARED, fd, 0);
+		if (pData == MAP_FAILED)
+			hr = E_FAIL;
+		else
+			spSegment->m_pData = (const BYTE*)pData;
+	}
+
+	// the mapping keeps the file referenced
+	close(fd);
+
+	IFR(hr);
+#endif
+
+	spSegment->m_size = expectedSize;
+	*pspSegment = spSegment;
+
+	return S_OK;
+}
+
+
+CSegmentCache::CSegmentCache()
+	: m_sizeBytes(0)
+	, m_budgetBytes(0)
+	, m_tempFileCounter(0)
+	, m_isOpen(false)
+	, m_recencyChanged(false)
+	, m_hits(0)
+	, m_misses(0)
+	, m_bytesSaved(0)
+	, m_bytesStored(0)
+	, m_evictions(0)
+{
+}
+
+CSegmentCache::~CSegmentCache()
+{
+	Close();
+}
+
+_Use_decl_annotations_
+HRESULT CSegmentCache::Open(const std::wstring& directory, UINT64 budgetBytes)
+{
+	if (directory.empty() || !budgetBytes)
+		return E_INVALIDARG;
+
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	if (m_isOpen)
+		return E_ILLEGAL_METHOD_CALL;
+
+	m_directory = directory;
+	while (m_directory.size() > 1 && (m_directory.back() == L'/' || m_directory.back() == L'\\'))
+	{
+		m_directory.pop_back();
+	}
+
+	IFR(CreateDirectoryIfMissing(m_directory));
+
+	m_budgetBytes = budgetBytes;
+
+	// a missing or damaged index starts the cache empty, the segments it listed are orphans then
+	if (FAILED(LoadIndex()))
+	{
+		m_entries.clear();
+		m_byLookupKey.clear();
+		m_byContentHash.clear();
+		m_sizeBytes = 0;
+	}
+
+	RemoveUnknownFiles();
+
+	m_isOpen = true;
+
+	// also covers a smaller budget than the previous session had
+	EvictToBudget(m_budgetBytes);
+
+	return SaveIndex();
+}
+
+void CSegmentCache::Close()
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	if (!m_isOpen)
+		return;
+
+	if (m_recencyChanged)
+		SaveIndex();
+
+	m_entries.clear();
+	m_byLookupKey.clear();
+	m_byContentHash.clear();
+	m_sizeBytes = 0;
+	m_isOpen = false;
+}
+
+_Use_decl_annotations_
+HRESULT CSegmentCache::Lookup(const SEGMENT_KEY& key, const std::wstring& etag, std::shared_ptr<CMappedSegment>* pspSegment)
+{
+	NULL_CHK(pspSegment);
+
+	pspSegment->reset();
+
+	std::wstring lookupKey = GetLookupKey(key);
+
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	if (!m_isOpen)
+		return E_ILLEGAL_METHOD_CALL;
+
+	auto it = m_byLookupKey.find(lookupKey);
+	if (it == m_byLookupKey.end() || (!etag.empty() && it->second->etag != etag))
+	{
+		m_misses++;
+		return S_FALSE;
+	}
+
+	EntryList::iterator entry = it->second;
+
+	std::shared_ptr<CMappedSegment> spSegment;
+	if (FAILED(CMappedSegment::Map(GetSegmentPath(entry->contentHash), entry->size, &spSegment)))
+	{
+		// deleted or truncated behind our back
+		RemoveEntry(entry, true);
+		SaveIndex();
+
+		m_misses++;
+		return S_FALSE;
+	}
+
+	m_entries.splice(m_entries.begin(), m_entries, entry);
+	m_recencyChanged = true;
+
+	m_hits++;
+	m_bytesSaved += entry->size;
+
+	*pspSegment = spSegment;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CSegmentCache::Store(const SEGMENT_KEY& key, const std::wstring& etag, const BYTE* pData, UINT64 size)
+{
+	NULL_CHK(pData);
+
+	if (!size)
+		return E_INVALIDARG;
+
+	std::wstring lookupKey = GetLookupKey(key);
+	UINT64 contentHash = GetContentHash(lookupKey, etag);
+
+	std::wstring tempPath;
+	std::wstring segmentPath;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		if (!m_isOpen)
+			return E_ILLEGAL_METHOD_CALL;
+
+		if (size > m_budgetBytes)
+			return S_FALSE;
+
+		segmentPath = GetSegmentPath(contentHash);
+		tempPath = m_directory + _PathSeparator_ + ToHex(contentHash) + L"." + std::to_wstring(m_tempFileCounter++) + _TempFileExtension_;
+	}
+
+	// the slow part runs unlocked, concurrent stores of the same segment write separate temporary files
+	HRESULT hr = WriteWholeFile(tempPath, pData, size);
+	if (FAILED(hr))
+	{
+		RemoveFile(tempPath);
+		return hr;
+	}
+
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	if (!m_isOpen)
+	{
+		RemoveFile(tempPath);
+		return E_ILLEGAL_METHOD_CALL;
+	}
+
+	auto itKey = m_byLookupKey.find(lookupKey);
+	if (itKey != m_byLookupKey.end())
+		RemoveEntry(itKey->second, itKey->second->contentHash != contentHash);
+
+	// another key hashing to the same file name loses its entry, the rename replaces its data
+	auto itHash = m_byContentHash.find(contentHash);
+	if (itHash != m_byContentHash.end())
+		RemoveEntry(itHash->second, false);
+
+	hr = CommitFile(tempPath, segmentPath);
+	if (FAILED(hr))
+	{
+		RemoveFile(tempPath);
+		SaveIndex();
+
+		return hr;
+	}
+
+	SEGMENT_ENTRY entry;
+	entry.lookupKey = lookupKey;
+	entry.etag = etag;
+	entry.contentHash = contentHash;
+	entry.size = size;
+
+	m_entries.push_front(entry);
+	m_byLookupKey[lookupKey] = m_entries.begin();
+	m_byContentHash[contentHash] = m_entries.begin();
+	m_sizeBytes += size;
+	m_bytesStored += size;
+
+	EvictToBudget(m_budgetBytes);
+
+	return SaveIndex();
+}
+
+_Use_decl_annotations_
+HRESULT CSegmentCache::SetBudget(UINT64 budgetBytes)
+{
+	if (!budgetBytes)
+		return E_INVALIDARG;
+
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	m_budgetBytes = budgetBytes;
+
+	if (!m_isOpen || m_sizeBytes <= m_budgetBytes)
+		return S_OK;
+
+	EvictToBudget(m_budgetBytes);
+
+	return SaveIndex();
+}
+
+HRESULT CSegmentCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	if (!m_isOpen)
+		return E_ILLEGAL_METHOD_CALL;
+
+	while (!m_entries.empty())
+	{
+		RemoveEntry(m_entries.begin(), true);
+	}
+
+	return SaveIndex();
+}
+
+_Use_decl_annotations_
+void CSegmentCache::GetStats(SEGMENT_CACHE_STATS* pStats)
+{
+	if (!pStats)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	pStats->entries = (UINT32)m_entries.size();
+	pStats->sizeBytes = m_sizeBytes;
+	pStats->budgetBytes = m_budgetBytes;
+	pStats->hits = m_hits;
+	pStats->misses = m_misses;
+	pStats->bytesSaved = m_bytesSaved;
+	pStats->bytesStored = m_bytesStored;
+	pStats->evictions = m_evictions;
+}
+
+_Use_decl_annotations_
+std::wstring CSegmentCache::GetLookupKey(const SEGMENT_KEY& key)
+{
+	return key.uri + L"|" + std::to_wstring(key.rangeOffset) + L"-" + std::to_wstring(key.rangeLength);
+}
+
+_Use_decl_annotations_
+UINT64 CSegmentCache::GetContentHash(const std::wstring& lookupKey, const std::wstring& etag)
+{
+	UINT64 hash = HashString(_FnvOffsetBasis_, lookupKey);
+
+	UINT32 separator = 0;
+	hash = HashBytes(hash, (const BYTE*)&separator, sizeof(separator));
+
+	return HashString(hash, etag);
+}
+
+_Use_decl_annotations_
+std::wstring CSegmentCache::GetSegmentPath(UINT64 contentHash) const
+{
+	return m_directory + _PathSeparator_ + ToHex(contentHash) + _SegmentFileExtension_;
+}
+
+_Use_decl_annotations_
+void CSegmentCache::RemoveEntry(EntryList::iterator it, bool deleteFile)
+{
+	if (deleteFile)
+		RemoveFile(GetSegmentPath(it->contentHash));
+
+	m_sizeBytes -= it->size;
+	m_byLookupKey.erase(it->lookupKey);
+	m_byContentHash.erase(it->contentHash);
+	m_entries.erase(it);
+}
+
+_Use_decl_annotations_
+void CSegmentCache::EvictToBudget(UINT64 budgetBytes)
+{
+	while (m_sizeBytes > budgetBytes && !m_entries.empty())
+	{
+		RemoveEntry(std::prev(m_entries.end()), true);
+		m_evictions++;
+	}
+}
+
+HRESULT CSegmentCache::LoadIndex()
+{
+	std::vector<BYTE> buffer;
+	IFR(ReadWholeFile(m_directory + _PathSeparator_ + _SegmentIndexName_, &buffer));
+
+	// the checksum covers everything in front of it
+	if (buffer.size() < sizeof(UINT64))
+		return E_FAIL;
+
+	size_t payloadSize = buffer.size() - sizeof(UINT64);
+
+	UINT64 checksum = 0;
+	memcpy(&checksum, buffer.data() + payloadSize, sizeof(checksum));
+	if (checksum != HashBytes(_FnvOffsetBasis_, buffer.data(), payloadSize))
+		return E_FAIL;
+
+	buffer.resize(payloadSize);
+
+	size_t offset = 0;
+	UINT32 magic = 0, version = 0, count = 0;
+	if (!ReadValue(buffer, &offset, &magic, sizeof(magic))
+		|| !ReadValue(buffer, &offset, &version, sizeof(version))
+		|| !ReadValue(buffer, &offset, &count, sizeof(count))
+		|| magic != _SegmentIndexMagic_
+		|| version != _SegmentIndexVersion_)
+	{
+		return E_FAIL;
+	}
+
+	// entries are saved most recently used first
+	for (UINT32 i = 0; i < count; i++)
+	{
+		SEGMENT_ENTRY entry;
+		if (!ReadValue(buffer, &offset, &entry.contentHash, sizeof(entry.contentHash))
+			|| !ReadValue(buffer, &offset, &entry.size, sizeof(entry.size))
+			|| !ReadString(buffer, &offset, &entry.lookupKey)
+			|| !ReadString(buffer, &offset, &entry.etag))
+		{
+			return E_FAIL;
+		}
+
+		if (entry.contentHash != GetContentHash(entry.lookupKey, entry.etag)
+			|| m_byLookupKey.count(entry.lookupKey)
+			|| m_byContentHash.count(entry.contentHash))
+		{
+			continue;
+		}
+
+		// a crash between writing a segment and saving the index can leave a stale entry
+		UINT64 fileSize = 0;
+		if (FAILED(GetFileSizeAt(GetSegmentPath(entry.contentHash), &fileSize)) || fileSize != entry.size || !entry.size)
+			continue;
+
+		m_entries.push_back(entry);
+		m_byLookupKey[entry.lookupKey] = std::prev(m_entries.end());
+		m_byContentHash[entry.contentHash] = std::prev(m_entries.end());
+		m_sizeBytes += entry.size;
+	}
+
+	return S_OK;
+}
+
+HRESULT CSegmentCache::SaveIndex()
+{
+	std::vector<BYTE> buffer;
+
+	UINT32 magic = _SegmentIndexMagic_;
+	UINT32 version = _SegmentIndexVersion_;
+	UINT32 count = (UINT32)m_entries.size();
+	WriteValue(&buffer, &magic, sizeof(magic));
+	WriteValue(&buffer, &version, sizeof(version));
+	WriteValue(&buffer, &count, sizeof(count));
+
+	for (const SEGMENT_ENTRY& entry : m_entries)
+	{
+		WriteValue(&buffer, &entry.contentHash, sizeof(entry.contentHash));
+		WriteValue(&buffer, &entry.size, sizeof(entry.size));
+		WriteString(&buffer, entry.lookupKey);
+		WriteString(&buffer, entry.etag);
+	}
+
+	UINT64 checksum = HashBytes(_FnvOffsetBasis_, buffer.data(), buffer.size());
+	WriteValue(&buffer, &checksum, sizeof(checksum));
+
+	std::wstring tempPath = m_directory + _PathSeparator_ + _SegmentIndexTempName_;
+
+	HRESULT hr = WriteWholeFile(tempPath, buffer.data(), buffer.size());
+	if (SUCCEEDED(hr))
+		hr = CommitFile(tempPath, m_directory + _PathSeparator_ + _SegmentIndexName_);
+
+	if (FAILED(hr))
+	{
+		RemoveFile(tempPath);
+		return hr;
+	}
+
+	m_recencyChanged = false;
+
+	return S_OK;
+}
+
+void CSegmentCache::RemoveUnknownFiles()
+{
+	std::vector<std::wstring> names;
+	ListFiles(m_directory, &names);
+
+	for (const std::wstring& name : names)
+	{
+		if (EndsWith(name, _TempFileExtension_))
+		{
+			// interrupted writes
+			RemoveFile(m_directory + _PathSeparator_ + name);
+		}
+		else if (EndsWith(name, _SegmentFileExtension_))
+		{
+			UINT64 contentHash = 0;
+			std::wstring hex = name.substr(0, name.size() - wcslen(_SegmentFileExtension_));
+			if (!ParseHex(hex, &contentHash) || !m_byContentHash.count(contentHash))
+				RemoveFile(m_directory + _PathSeparator_ + name);
+		}
+	}
+}
@@ -0,0 +1,139 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Persistent cache of HLS/DASH segments, so seeking back or replaying a stream does not download it again.
+//
+// Segments are keyed by URI, byte range and ETag and stored one file per segment, named after a hash of the key.
+// Files are written under a temporary name and renamed once complete, and the index is replaced the same way,
+// so a crash leaves at most orphan files behind; Open drops index entries whose file is missing or truncated
+// and deletes files the index does not know. Hits are served from a read-only mapping of the segment file.
+// The cache is size budgeted and evicts the least recently used segments. Thread safe.
+
+#include "PlaybackTypes.h"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+
+typedef struct _SEGMENT_KEY
+{
+	std::wstring uri;
+	UINT64 rangeOffset;
+	UINT64 rangeLength;			// 0 for the whole resource
+} SEGMENT_KEY;
+
+// Read-only view of a cached segment. Stays valid after the segment is evicted, until the last reference is released.
+class CMappedSegment
+{
+public:
+	~CMappedSegment();
+
+	const BYTE* GetData() const { return m_pData; }
+	UINT64 GetSize() const { return m_size; }
+
+	static HRESULT Map(
+		_In_ const std::wstring& path,
+		_In_ UINT64 expectedSize,
+		_Out_ std::shared_ptr<CMappedSegment>* pspSegment);
+
+private:
+	CMappedSegment();
+
+private:
+	const BYTE* m_pData;
+	UINT64 m_size;
+};
+
+class CSegmentCache
+{
+public:
+	CSegmentCache();
+	~CSegmentCache();
+
+	// Creates the directory if needed and recovers the index left by a previous session
+	HRESULT Open(
+		_In_ const std::wstring& directory,
+		_In_ UINT64 budgetBytes);
+
+	// Persists the recency of the entries. Mapped segments handed out stay valid.
+	void Close();
+
+	// S_FALSE on a miss. If etag is not empty, an entry stored with a different ETag is a miss.
+	HRESULT Lookup(
+		_In_ const SEGMENT_KEY& key,
+		_In_ const std::wstring& etag,
+		_Out_ std::shared_ptr<CMappedSegment>* pspSegment);
+
+	// Replaces the entry of the same URI and range, evicts older segments to stay within the budget.
+	// Segments larger than the budget are not stored (S_FALSE).
+	HRESULT Store(
+		_In_ const SEGMENT_KEY& key,
+		_In_ const std::wstring& etag,
+		_In_ const BYTE* pData,
+		_In_ UINT64 size);
+
+	HRESULT SetBudget(
+		_In_ UINT64 budgetBytes);
+
+	// Deletes all segments
+	HRESULT Clear();
+
+	void GetStats(
+		_Out_ SEGMENT_CACHE_STATS* pStats);
+
+	// URI and range, identifies a segment regardless of its ETag
+	static std::wstring GetLookupKey(_In_ const SEGMENT_KEY& key);
+
+private:
+	typedef struct _SEGMENT_ENTRY
+	{
+		std::wstring lookupKey;	// URI and range
+		std::wstring etag;
+		UINT64 contentHash;		// of URI, range and ETag, names the segment file
+		UINT64 size;
+	} SEGMENT_ENTRY;
+
+	typedef std::list<SEGMENT_ENTRY> EntryList;
+
+	static UINT64 GetContentHash(_In_ const std::wstring& lookupKey, _In_ const std::wstring& etag);
+
+	std::wstring GetSegmentPath(_In_ UINT64 contentHash) const;
+
+	// m_lock must be held by the callers of the methods below
+	void RemoveEntry(_In_ EntryList::iterator it, _In_ bool deleteFile);
+	void EvictToBudget(_In_ UINT64 budgetBytes);
+	HRESULT LoadIndex();
+	HRESULT SaveIndex();
+	void RemoveUnknownFiles();
+
+private:
+	std::mutex m_lock;
+	std::wstring m_directory;
+	EntryList m_entries;		// most recently used first
+	std::unordered_map<std::wstring, EntryList::iterator> m_byLookupKey;
+	std::unordered_map<UINT64, EntryList::iterator> m_byContentHash;
+	UINT64 m_sizeBytes;
+	UINT64 m_budgetBytes;
+	UINT64 m_tempFileCounter;
+	bool m_isOpen;
+	bool m_recencyChanged;		// hits reorder the entries, the index is saved lazily for those
+
+	UINT64 m_hits;
+	UINT64 m_misses;
+	UINT64 m_bytesSaved;
+	UINT64 m_bytesStored;
+	UINT64 m_evictions;
+};
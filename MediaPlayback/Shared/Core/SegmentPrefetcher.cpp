@@ -0,0 +1,353 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "SegmentPrefetcher.h"
+
+#include <string.h>
+
+#include <unordered_set>
+#include <utility>
+
+
+_Use_decl_annotations_
+CSegmentPrefetcher::CSegmentPrefetcher(SubmitTask fnSubmit, FetchSegment fnFetch)
+	: m_fnSubmit(fnSubmit)
+	, m_fnFetch(fnFetch)
+	, m_lookAhead(0)
+	, m_maxInFlight(1)
+	, m_closed(false)
+	, m_inFlight(0)
+	, m_hits(0)
+	, m_joins(0)
+	, m_misses(0)
+	, m_bytesFetched(0)
+	, m_bytesWasted(0)
+{
+}
+
+_Use_decl_annotations_
+void CSegmentPrefetcher::SetWindow(INT64 lookAhead, UINT32 maxInFlight)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	m_lookAhead = (lookAhead > 0) ? lookAhead : 0;
+	m_maxInFlight = maxInFlight ? maxInFlight : 1;
+
+	std::vector<const MANIFEST_SEGMENT*> window;
+	GetWindow(&window);
+	DropOutsideWindow(window);
+
+	Pump();
+}
+
+_Use_decl_annotations_
+void CSegmentPrefetcher::AddManifest(const MANIFEST& manifest)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	for (const MANIFEST_REPRESENTATION& representation : manifest.representations)
+	{
+		auto it = m_representations.find(representation.id);
+		if (it != m_representations.end())
+		{
+			for (const MANIFEST_SEGMENT& segment : it->second)
+			{
+				auto position = m_positions.find(CSegmentCache::GetLookupKey(segment.key));
+				if (position != m_positions.end() && position->second.representationId == representation.id)
+					m_positions.erase(position);
+			}
+		}
+
+		m_representations[representation.id] = representation.segments;
+
+		for (size_t i = 0; i < representation.segments.size(); i++)
+		{
+			SEGMENT_POSITION position;
+			position.representationId = representation.id;
+			position.index = i;
+			m_positions[CSegmentCache::GetLookupKey(representation.segments[i].key)] = position;
+		}
+	}
+
+	// a refreshed live playlist may extend the window
+	Pump();
+}
+
+_Use_decl_annotations_
+HRESULT CSegmentPrefetcher::Request(const SEGMENT_KEY& key, RequestCompleted fnCompleted)
+{
+	if (!fnCompleted)
+		return E_INVALIDARG;
+
+	std::wstring lookupKey = CSegmentCache::GetLookupKey(key);
+	SegmentData data;
+
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		if (m_closed || m_positions.find(lookupKey) == m_positions.end())
+			return S_FALSE;
+
+		m_playheadKey = lookupKey;
+
+		auto it = m_slots.find(lookupKey);
+		if (it == m_slots.end())
+		{
+			PREFETCH_SLOT slot;
+			slot.isReady = false;
+			slot.waiters.push_back(fnCompleted);
+			m_slots[lookupKey] = slot;
+
+			// asked for now, not subject to maxInFlight
+			if (FAILED(StartFetch(lookupKey, key)))
+			{
+				m_slots.erase(lookupKey);
+				return S_FALSE;
+			}
+
+			m_misses++;
+		}
+		else if (!it->second.isReady)
+		{
+			it->second.waiters.push_back(fnCompleted);
+			m_joins++;
+		}
+		else
+		{
+			data = it->second.data;
+			m_slots.erase(it);
+			m_hits++;
+		}
+
+		std::vector<const MANIFEST_SEGMENT*> window;
+		GetWindow(&window);
+		DropOutsideWindow(window);
+
+		Pump();
+	}
+
+	if (data)
+		fnCompleted(S_OK, data);
+
+	return S_OK;
+}
+
+void CSegmentPrefetcher::Close()
+{
+	std::vector<RequestCompleted> waiters;
+
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		m_closed = true;
+
+		for (auto& slot : m_slots)
+		{
+			for (auto& waiter : slot.second.waiters)
+			{
+				waiters.push_back(std::move(waiter));
+			}
+		}
+
+		m_slots.clear();
+		m_representations.clear();
+		m_positions.clear();
+	}
+
+	for (auto& waiter : waiters)
+	{
+		waiter(E_ABORT, nullptr);
+	}
+}
+
+_Use_decl_annotations_
+void CSegmentPrefetcher::GetStats(SEGMENT_PREFETCH_STATS* pStats)
+{
+	if (!pStats)
+		return;
+
+	memset(pStats, 0, sizeof(SEGMENT_PREFETCH_STATS));
+
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	std::vector<const MANIFEST_SEGMENT*> window;
+	GetWindow(&window);
+
+	// contiguous from the playhead, a gap is where the media source would stall
+	for (const MANIFEST_SEGMENT* pSegment : window)
+	{
+		auto it = m_slots.find(CSegmentCache::GetLookupKey(pSegment->key));
+		if (it == m_slots.end() || !it->second.isReady)
+			break;
+
+		pStats->bufferAhead += pSegment->duration;
+	}
+
+	for (const auto& slot : m_slots)
+	{
+		if (slot.second.isReady)
+		{
+			pStats->readySegments++;
+			pStats->readyBytes += slot.second.data->size();
+		}
+	}
+
+	pStats->inFlight = m_inFlight;
+	pStats->hits = m_hits;
+	pStats->joins = m_joins;
+	pStats->misses = m_misses;
+	pStats->bytesFetched = m_bytesFetched;
+	pStats->bytesWasted = m_bytesWasted;
+}
+
+_Use_decl_annotations_
+void CSegmentPrefetcher::CompleteFetch(const std::wstring& lookupKey, const SEGMENT_KEY& key)
+{
+	auto fnIsCancelled = [this, &lookupKey]()
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		return m_closed || m_slots.find(lookupKey) == m_slots.end();
+	};
+
+	SegmentData data;
+	HRESULT hr = fnIsCancelled() ? E_ABORT : m_fnFetch(key, fnIsCancelled, &data);
+	if (SUCCEEDED(hr) && !data)
+		hr = E_UNEXPECTED;
+
+	std::vector<RequestCompleted> waiters;
+
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		m_inFlight--;
+
+		if (SUCCEEDED(hr))
+			m_bytesFetched += data->size();
+
+		auto it = m_slots.find(lookupKey);
+		if (it == m_slots.end() || it->second.isReady)
+		{
+			// dropped meanwhile, or a second download of a segment dropped and wanted again
+			if (SUCCEEDED(hr))
+				m_bytesWasted += data->size();
+		}
+		else if (FAILED(hr) || !it->second.waiters.empty())
+		{
+			waiters.swap(it->second.waiters);
+			m_slots.erase(it);
+		}
+		else
+		{
+			it->second.isReady = true;
+			it->second.data = data;
+		}
+
+		if (!m_closed)
+			Pump();
+	}
+
+	for (auto& waiter : waiters)
+	{
+		waiter(hr, data);
+	}
+}
+
+_Use_decl_annotations_
+HRESULT CSegmentPrefetcher::StartFetch(const std::wstring& lookupKey, const SEGMENT_KEY& key)
+{
+	// the task must not keep the prefetcher alive, its owner closes it when the media source goes away
+	std::weak_ptr<CSegmentPrefetcher> wpThis(shared_from_this());
+
+	IFR(m_fnSubmit([wpThis, lookupKey, key]()
+	{
+		std::shared_ptr<CSegmentPrefetcher> spThis = wpThis.lock();
+		if (spThis)
+			spThis->CompleteFetch(lookupKey, key);
+	}));
+
+	m_inFlight++;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+void CSegmentPrefetcher::GetWindow(std::vector<const MANIFEST_SEGMENT*>* pWindow)
+{
+	pWindow->clear();
+
+	auto position = m_positions.find(m_playheadKey);
+	if (position == m_positions.end())
+		return;
+
+	auto representation = m_representations.find(position->second.representationId);
+	if (representation == m_representations.end())
+		return;
+
+	const std::vector<MANIFEST_SEGMENT>& segments = representation->second;
+
+	INT64 ahead = 0;
+	for (size_t i = position->second.index + 1; i < segments.size() && ahead < m_lookAhead; i++)
+	{
+		pWindow->push_back(&segments[i]);
+		ahead += segments[i].duration;
+	}
+}
+
+_Use_decl_annotations_
+void CSegmentPrefetcher::DropOutsideWindow(const std::vector<const MANIFEST_SEGMENT*>& window)
+{
+	std::unordered_set<std::wstring> wanted;
+	for (const MANIFEST_SEGMENT* pSegment : window)
+	{
+		wanted.insert(CSegmentCache::GetLookupKey(pSegment->key));
+	}
+
+	for (auto it = m_slots.begin(); it != m_slots.end();)
+	{
+		if (!it->second.waiters.empty() || wanted.count(it->first))
+		{
+			++it;
+			continue;
+		}
+
+		// downloads in flight are accounted for when they complete
+		if (it->second.isReady)
+			m_bytesWasted += it->second.data->size();
+
+		it = m_slots.erase(it);
+	}
+}
+
+void CSegmentPrefetcher::Pump()
+{
+	std::vector<const MANIFEST_SEGMENT*> window;
+	GetWindow(&window);
+
+	for (const MANIFEST_SEGMENT* pSegment : window)
+	{
+		if (m_inFlight >= m_maxInFlight)
+			break;
+
+		std::wstring lookupKey = CSegmentCache::GetLookupKey(pSegment->key);
+		if (m_slots.find(lookupKey) != m_slots.end())
+			continue;
+
+		PREFETCH_SLOT slot;
+		slot.isReady = false;
+		m_slots[lookupKey] = slot;
+
+		if (FAILED(StartFetch(lookupKey, pSegment->key)))
+		{
+			m_slots.erase(lookupKey);
+			break;
+		}
+	}
+}
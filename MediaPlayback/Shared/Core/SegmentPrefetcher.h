@@ -0,0 +1,110 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Downloads the segments following the one an adaptive media source asks for before it asks for them.
+//
+// The representations come from the parsed manifests (AddManifest). Each Request moves the playhead to the
+// requested segment of its representation and keeps a look-ahead window of the segments after it downloading,
+// at most maxInFlight at a time; a bitrate switch or a seek moves the window and drops what fell out of it.
+// Requests are answered from a finished download, wait for one in flight, or start one.
+// Downloads run as tasks of the owner's worker pool. Thread safe.
+
+#include "ManifestParser.h"
+#include "WorkerPool.h"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+typedef std::shared_ptr<const std::vector<BYTE>> SegmentData;
+
+class CSegmentPrefetcher : public std::enable_shared_from_this<CSegmentPrefetcher>
+{
+public:
+	// Queues a task on the owner's workers
+	typedef std::function<HRESULT(const CWorkerPool::Task& task)> SubmitTask;
+	// Downloads a whole segment on a worker; fnIsCancelled turns true once the segment is no longer wanted
+	typedef std::function<HRESULT(const SEGMENT_KEY& key, const std::function<bool()>& fnIsCancelled, SegmentData* pData)> FetchSegment;
+	// Answers a Request, inline for finished downloads or on the worker that finished the download
+	typedef std::function<void(HRESULT hr, const SegmentData& data)> RequestCompleted;
+
+	CSegmentPrefetcher(
+		_In_ SubmitTask fnSubmit,
+		_In_ FetchSegment fnFetch);
+
+	// lookAhead in 100ns; 0 only downloads what is requested
+	void SetWindow(
+		_In_ INT64 lookAhead,
+		_In_ UINT32 maxInFlight);
+
+	// Adds the representations of the manifest, replacing earlier versions of them (live playlist refreshes)
+	void AddManifest(
+		_In_ const MANIFEST& manifest);
+
+	// S_FALSE if the segment is not part of a known representation, fnCompleted is not called then
+	HRESULT Request(
+		_In_ const SEGMENT_KEY& key,
+		_In_ RequestCompleted fnCompleted);
+
+	// Fails the requests waiting for downloads with E_ABORT and drops everything downloaded
+	void Close();
+
+	void GetStats(
+		_Out_ SEGMENT_PREFETCH_STATS* pStats);
+
+private:
+	typedef struct _SEGMENT_POSITION
+	{
+		std::wstring representationId;
+		size_t index;
+	} SEGMENT_POSITION;
+
+	typedef struct _PREFETCH_SLOT
+	{
+		bool isReady;
+		SegmentData data;
+		std::vector<RequestCompleted> waiters;
+	} PREFETCH_SLOT;
+
+	void CompleteFetch(_In_ const std::wstring& lookupKey, _In_ const SEGMENT_KEY& key);
+
+	// m_lock must be held by the callers of the methods below
+	HRESULT StartFetch(_In_ const std::wstring& lookupKey, _In_ const SEGMENT_KEY& key);
+	void GetWindow(_Out_ std::vector<const MANIFEST_SEGMENT*>* pWindow);
+	void DropOutsideWindow(_In_ const std::vector<const MANIFEST_SEGMENT*>& window);
+	void Pump();
+
+private:
+	std::mutex m_lock;
+	SubmitTask m_fnSubmit;
+	FetchSegment m_fnFetch;
+	INT64 m_lookAhead;
+	UINT32 m_maxInFlight;
+	bool m_closed;
+
+	std::unordered_map<std::wstring, std::vector<MANIFEST_SEGMENT>> m_representations;
+	std::unordered_map<std::wstring, SEGMENT_POSITION> m_positions;	// by segment lookup key
+	std::unordered_map<std::wstring, PREFETCH_SLOT> m_slots;			// by segment lookup key
+	std::wstring m_playheadKey;		// segment requested last
+	UINT32 m_inFlight;
+
+	UINT64 m_hits;
+	UINT64 m_joins;
+	UINT64 m_misses;
+	UINT64 m_bytesFetched;
+	UINT64 m_bytesWasted;
+};
@@ -0,0 +1,650 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "SharedPlaybackBackend.h"
+
+
+_Use_decl_annotations_
+CSharedPlaybackBackend::CSharedPlaybackBackend(const std::shared_ptr<IPlaybackBackend>& spBackend)
+	: m_spBackend(spBackend)
+	, m_decodedCopies(0)
+	, m_sharedCopies(0)
+{
+}
+
+CSharedPlaybackBackend::~CSharedPlaybackBackend()
+{
+}
+
+_Use_decl_annotations_
+void CSharedPlaybackBackend::GetStats(SHARED_SOURCE_STATS* pStats)
+{
+	std::vector<std::shared_ptr<CSharedSource>> sources;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		for (auto it = m_sources.begin(); it != m_sources.end(); ++it)
+		{
+			std::shared_ptr<CSharedSource> spSource = it->second.lock();
+			if (spSource)
+				sources.push_back(spSource);
+		}
+	}
+
+	pStats->sources = 0;
+	pStats->views = 0;
+
+	for (const auto& spSource : sources)
+	{
+		UINT32 views = spSource->GetViewCount();
+		if (views)
+		{
+			pStats->sources++;
+			pStats->views += views;
+		}
+	}
+
+	pStats->decodedCopies = m_decodedCopies;
+	pStats->sharedCopies = m_sharedCopies;
+}
+
+_Use_decl_annotations_
+HRESULT CSharedPlaybackBackend::GetSource(const std::wstring& contentLocation, std::shared_ptr<CSharedSource>* pspSource)
+{
+	NULL_CHK(pspSource);
+
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	std::shared_ptr<CSharedSource> spSource = m_sources[contentLocation].lock();
+	if (!spSource)
+	{
+		spSource = std::make_shared<CSharedSource>(this, contentLocation);
+		IFR(spSource->Initialize());
+
+		m_sources[contentLocation] = spSource;
+	}
+
+	// sources nobody holds anymore are dropped as new ones come
+	for (auto it = m_sources.begin(); it != m_sources.end(); )
+	{
+		if (it->second.expired())
+			it = m_sources.erase(it);
+		else
+			++it;
+	}
+
+	*pspSource = spSource;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CSharedPlaybackBackend::CreateSession(IPlaybackSessionSink* pSink, std::shared_ptr<IPlaybackSession>* ppSession)
+{
+	NULL_CHK(pSink);
+	NULL_CHK(ppSession);
+
+	*ppSession = std::make_shared<CSharedSessionView>(this, pSink);
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CSharedPlaybackBackend::CreateSurface(const PLAYBACK_SURFACE_DESC& desc, std::shared_ptr<IPlaybackSurface>* ppSurface)
+{
+	return m_spBackend->CreateSurface(desc, ppSurface);
+}
+
+_Use_decl_annotations_
+HRESULT CSharedPlaybackBackend::CopySurface(IPlaybackSurface* pSource, IPlaybackSurface* pDestination)
+{
+	return m_spBackend->CopySurface(pSource, pDestination);
+}
+
+_Use_decl_annotations_
+HRESULT CSharedPlaybackBackend::GetDecoderCapabilities(CDecoderCapabilities* pCapabilities)
+{
+	return m_spBackend->GetDecoderCapabilities(pCapabilities);
+}
+
+_Use_decl_annotations_
+HRESULT CSharedPlaybackBackend::GetKeyframeIndex(const wchar_t* pszContentLocation, std::shared_ptr<const CKeyframeIndex>* pIndex)
+{
+	return m_spBackend->GetKeyframeIndex(pszContentLocation, pIndex);
+}
+
+_Use_decl_annotations_
+HRESULT CSharedPlaybackBackend::OpenThumbnailSource(const wchar_t* pszContentLocation, THUMBNAIL_SOURCE* pSource)
+{
+	return m_spBackend->OpenThumbnailSource(pszContentLocation, pSource);
+}
+
+
+_Use_decl_annotations_
+CSharedSource::CSharedSource(CSharedPlaybackBackend* pBackend, const std::wstring& contentLocation)
+	: m_pBackend(pBackend)
+	, m_contentLocation(contentLocation)
+	, m_openRequested(false)
+	, m_opened(false)
+	, m_frameSerial(0)
+{
+}
+
+CSharedSource::~CSharedSource()
+{
+	if (m_session)
+	{
+		m_session->Close();
+	}
+}
+
+HRESULT CSharedSource::Initialize()
+{
+	return m_pBackend->m_spBackend->CreateSession(this, &m_session);
+}
+
+_Use_decl_annotations_
+HRESULT CSharedSource::AddView(const std::shared_ptr<CSharedSessionView>& spView)
+{
+	bool open = false;
+	bool replay = false;
+
+	{
+		std::lock_guard<std::recursive_mutex> openLock(m_openLock);
+
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+
+			m_views.push_back(spView);
+
+			open = !m_openRequested;
+			replay = m_opened;
+			m_openRequested = true;
+		}
+
+		if (open)
+		{
+			HRESULT hr = m_session->Open(m_contentLocation.c_str());
+			if (FAILED(hr))
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+				m_views.clear();
+				m_openRequested = false;
+
+				return hr;
+			}
+		}
+	}
+
+	if (replay)
+	{
+		// what the view would have seen, had it opened the source itself
+		IPlaybackSessionSink* pSink = spView->GetSink();
+
+		pSink->OnSessionOpened();
+		pSink->OnSessionVideoTracksChanged();
+		pSink->OnSessionSubtitleTracksChanged();
+		pSink->OnSessionSizeChanged();
+		pSink->OnSessionStateChanged(m_session->GetPlaybackState());
+	}
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+void CSharedSource::RemoveView(CSharedSessionView* pView)
+{
+	std::lock_guard<std::recursive_mutex> openLock(m_openLock);
+
+	bool close = false;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		// a view removes itself when it is destroyed, its weak pointer has expired by then
+		for (auto it = m_views.begin(); it != m_views.end(); )
+		{
+			std::shared_ptr<CSharedSessionView> spView = it->lock();
+			if (!spView || spView.get() == pView)
+				it = m_views.erase(it);
+			else
+				++it;
+		}
+
+		close = m_views.empty() && m_openRequested;
+		if (close)
+		{
+			m_openRequested = false;
+			m_opened = false;
+		}
+	}
+
+	if (close)
+	{
+		m_session->Close();
+	}
+
+	std::lock_guard<std::mutex> lock(m_frameLock);
+	m_frameSlots.clear();
+}
+
+UINT32 CSharedSource::GetViewCount()
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	return (UINT32)m_views.size();
+}
+
+_Use_decl_annotations_
+HRESULT CSharedSource::CopyFrameToSurface(IPlaybackSurface* pSurface)
+{
+	NULL_CHK(pSurface);
+
+	if (GetViewCount() <= 1)
+	{
+		IFR(m_session->CopyFrameToSurface(pSurface));
+		m_pBackend->m_decodedCopies++;
+
+		return S_OK;
+	}
+
+	std::lock_guard<std::mutex> lock(m_frameLock);
+
+	UINT64 frameSerial = m_frameSerial;
+
+	SHARED_FRAME_SLOT* pSlot = nullptr;
+	for (auto& slot : m_frameSlots)
+	{
+		if (slot.surface->GetWidth() == pSurface->GetWidth() &&
+			slot.surface->GetHeight() == pSurface->GetHeight() &&
+			slot.surface->IsStereoscopic() == pSurface->IsStereoscopic() &&
+			slot.surface->GetFrameFormat() == pSurface->GetFrameFormat())
+		{
+			pSlot = &slot;
+		}
+	}
+
+	if (pSlot == nullptr)
+	{
+		PLAYBACK_SURFACE_DESC desc = { pSurface->GetWidth(), pSurface->GetHeight(), pSurface->IsStereoscopic(), pSurface->GetFrameFormat(), SurfaceUsage::SurfaceUsage_Copy };
+
+		SHARED_FRAME_SLOT slot = { nullptr, 0 };
+		IFR(m_pBackend->CreateSurface(desc, &slot.surface));
+
+		m_frameSlots.push_back(slot);
+		pSlot = &m_frameSlots.back();
+	}
+
+	// the first view asking for the frame at this size has the decoder copy it, the others share that copy
+	if (pSlot->frameSerial != frameSerial)
+	{
+		IFR(m_session->CopyFrameToSurface(pSlot->surface.get()));
+		pSlot->frameSerial = frameSerial;
+		m_pBackend->m_decodedCopies++;
+	}
+	else
+	{
+		m_pBackend->m_sharedCopies++;
+	}
+
+	return m_pBackend->CopySurface(pSlot->surface.get(), pSurface);
+}
+
+template <typename TEvent>
+void CSharedSource::RaiseEvent(const TEvent& fnEvent)
+{
+	// views can call back into the source from their sinks, it is not locked while they are called
+	std::vector<std::shared_ptr<CSharedSessionView>> views;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		for (const auto& view : m_views)
+		{
+			std::shared_ptr<CSharedSessionView> spView = view.lock();
+			if (spView)
+				views.push_back(spView);
+		}
+	}
+
+	for (const auto& spView : views)
+	{
+		fnEvent(spView->GetSink());
+	}
+}
+
+void CSharedSource::OnSessionOpened()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_opened = m_openRequested;
+	}
+
+	RaiseEvent([](IPlaybackSessionSink* pSink) { pSink->OnSessionOpened(); });
+}
+
+void CSharedSource::OnSessionStateChanged(PlaybackState state)
+{
+	RaiseEvent([state](IPlaybackSessionSink* pSink) { pSink->OnSessionStateChanged(state); });
+}
+
+void CSharedSource::OnSessionEnded()
+{
+	RaiseEvent([](IPlaybackSessionSink* pSink) { pSink->OnSessionEnded(); });
+}
+
+void CSharedSource::OnSessionFailed(HRESULT hr)
+{
+	RaiseEvent([hr](IPlaybackSessionSink* pSink) { pSink->OnSessionFailed(hr); });
+}
+
+void CSharedSource::OnSessionSizeChanged()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_frameLock);
+		m_frameSlots.clear();
+	}
+
+	RaiseEvent([](IPlaybackSessionSink* pSink) { pSink->OnSessionSizeChanged(); });
+}
+
+void CSharedSource::OnSessionFrameAvailable()
+{
+	m_frameSerial++;
+
+	RaiseEvent([](IPlaybackSessionSink* pSink) { pSink->OnSessionFrameAvailable(); });
+}
+
+void CSharedSource::OnSessionVideoTracksChanged()
+{
+	RaiseEvent([](IPlaybackSessionSink* pSink) { pSink->OnSessionVideoTracksChanged(); });
+}
+
+void CSharedSource::OnSessionSubtitleTracksChanged()
+{
+	RaiseEvent([](IPlaybackSessionSink* pSink) { pSink->OnSessionSubtitleTracksChanged(); });
+}
+
+_Use_decl_annotations_
+void CSharedSource::OnSessionSubtitleCueEntered(const SUBTITLE_CUE& cue)
+{
+	RaiseEvent([&cue](IPlaybackSessionSink* pSink) { pSink->OnSessionSubtitleCueEntered(cue); });
+}
+
+_Use_decl_annotations_
+void CSharedSource::OnSessionSubtitleCueExited(const SUBTITLE_CUE& cue)
+{
+	RaiseEvent([&cue](IPlaybackSessionSink* pSink) { pSink->OnSessionSubtitleCueExited(cue); });
+}
+
+void CSharedSource::OnSessionStatusChanged()
+{
+	RaiseEvent([](IPlaybackSessionSink* pSink) { pSink->OnSessionStatusChanged(); });
+}
+
+
+_Use_decl_annotations_
+CSharedSessionView::CSharedSessionView(CSharedPlaybackBackend* pBackend, IPlaybackSessionSink* pSink)
+	: m_pBackend(pBackend)
+	, m_pSink(pSink)
+{
+}
+
+CSharedSessionView::~CSharedSessionView()
+{
+	Close();
+}
+
+std::shared_ptr<CSharedSource> CSharedSessionView::GetSource() const
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	return m_spSource;
+}
+
+std::shared_ptr<IPlaybackSession> CSharedSessionView::GetSourceSession() const
+{
+	std::shared_ptr<CSharedSource> spSource = GetSource();
+	if (!spSource)
+		return nullptr;
+
+	return std::shared_ptr<IPlaybackSession>(spSource, spSource->GetSession());
+}
+
+_Use_decl_annotations_
+HRESULT CSharedSessionView::Open(const wchar_t* pszContentLocation)
+{
+	NULL_CHK(pszContentLocation);
+
+	Close();
+
+	std::shared_ptr<CSharedSource> spSource;
+	IFR(m_pBackend->GetSource(pszContentLocation, &spSource));
+
+	// set before joining, the replayed events query the view
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_spSource = spSource;
+	}
+
+	HRESULT hr = spSource->AddView(shared_from_this());
+	if (FAILED(hr))
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_spSource.reset();
+	}
+
+	return hr;
+}
+
+HRESULT CSharedSessionView::Close()
+{
+	std::shared_ptr<CSharedSource> spSource;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		spSource.swap(m_spSource);
+	}
+
+	if (spSource)
+	{
+		spSource->RemoveView(this);
+	}
+
+	return S_OK;
+}
+
+bool CSharedSessionView::HasSource() const
+{
+	return GetSource() != nullptr;
+}
+
+HRESULT CSharedSessionView::Play()
+{
+	std::shared_ptr<CSharedSource> spSource = GetSource();
+	if (!spSource)
+		return E_ILLEGAL_METHOD_CALL;
+
+	return spSource->GetSession()->Play();
+}
+
+HRESULT CSharedSessionView::Pause()
+{
+	std::shared_ptr<CSharedSource> spSource = GetSource();
+	if (!spSource)
+		return E_ILLEGAL_METHOD_CALL;
+
+	return spSource->GetSession()->Pause();
+}
+
+_Use_decl_annotations_
+HRESULT CSharedSessionView::Seek(LONGLONG position)
+{
+	std::shared_ptr<CSharedSource> spSource = GetSource();
+	if (!spSource)
+		return E_ILLEGAL_METHOD_CALL;
+
+	return spSource->GetSession()->Seek(position);
+}
+
+// Settings made while closed have nothing to apply to, the source keeps what its views set last
+
+_Use_decl_annotations_
+HRESULT CSharedSessionView::SetVolume(DOUBLE volume)
+{
+	std::shared_ptr<CSharedSource> spSource = GetSource();
+	return spSource ? spSource->GetSession()->SetVolume(volume) : S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CSharedSessionView::SetPlaybackRate(DOUBLE rate)
+{
+	std::shared_ptr<CSharedSource> spSource = GetSource();
+	return spSource ? spSource->GetSession()->SetPlaybackRate(rate) : S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CSharedSessionView::SetLoop(bool enabled, LONGLONG start, LONGLONG end)
+{
+	std::shared_ptr<CSharedSource> spSource = GetSource();
+	return spSource ? spSource->GetSession()->SetLoop(enabled, start, end) : S_OK;
+}
+
+PlaybackState CSharedSessionView::GetPlaybackState() const
+{
+	std::shared_ptr<CSharedSource> spSource = GetSource();
+	return spSource ? spSource->GetSession()->GetPlaybackState() : PlaybackState::PlaybackState_None;
+}
+
+_Use_decl_annotations_
+HRESULT CSharedSessionView::GetDurationAndPosition(LONGLONG* duration, LONGLONG* position) const
+{
+	std::shared_ptr<CSharedSource> spSource = GetSource();
+	if (!spSource)
+	{
+		*duration = 0;
+		*position = 0;
+		return S_OK;
+	}
+
+	return spSource->GetSession()->GetDurationAndPosition(duration, position);
+}
+
+_Use_decl_annotations_
+HRESULT CSharedSessionView::GetNaturalVideoSize(UINT32* width, UINT32* height) const
+{
+	std::shared_ptr<CSharedSource> spSource = GetSource();
+	if (!spSource)
+	{
+		*width = 0;
+		*height = 0;
+		return S_OK;
+	}
+
+	return spSource->GetSession()->GetNaturalVideoSize(width, height);
+}
+
+bool CSharedSessionView::CanSeek() const
+{
+	std::shared_ptr<CSharedSource> spSource = GetSource();
+	return spSource ? spSource->GetSession()->CanSeek() : false;
+}
+
+bool CSharedSessionView::IsStereoscopic() const
+{
+	std::shared_ptr<CSharedSource> spSource = GetSource();
+	return spSource ? spSource->GetSession()->IsStereoscopic() : false;
+}
+
+_Use_decl_annotations_
+HRESULT CSharedSessionView::GetAvailableBitrates(std::vector<UINT32>* bitrates) const
+{
+	std::shared_ptr<CSharedSource> spSource = GetSource();
+	if (!spSource)
+	{
+		bitrates->clear();
+		return S_OK;
+	}
+
+	return spSource->GetSession()->GetAvailableBitrates(bitrates);
+}
+
+_Use_decl_annotations_
+HRESULT CSharedSessionView::SetInitialBitrate(UINT32 bitrate)
+{
+	std::shared_ptr<CSharedSource> spSource = GetSource();
+	return spSource ? spSource->GetSession()->SetInitialBitrate(bitrate) : S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CSharedSessionView::SetDesiredMaxBitrate(UINT32 bitrate)
+{
+	std::shared_ptr<CSharedSource> spSource = GetSource();
+	return spSource ? spSource->GetSession()->SetDesiredMaxBitrate(bitrate) : S_OK;
+}
+
+UINT32 CSharedSessionView::GetCurrentBitrate() const
+{
+	std::shared_ptr<CSharedSource> spSource = GetSource();
+	return spSource ? spSource->GetSession()->GetCurrentBitrate() : 0;
+}
+
+_Use_decl_annotations_
+HRESULT CSharedSessionView::GetBufferedRanges(std::vector<MEDIA_TIME_RANGE>* ranges) const
+{
+	std::shared_ptr<CSharedSource> spSource = GetSource();
+	if (!spSource)
+	{
+		ranges->clear();
+		return S_OK;
+	}
+
+	return spSource->GetSession()->GetBufferedRanges(ranges);
+}
+
+_Use_decl_annotations_
+HRESULT CSharedSessionView::GetVideoTracks(std::vector<VIDEO_TRACK_INFO>* tracks, INT32* selectedIndex) const
+{
+	std::shared_ptr<CSharedSource> spSource = GetSource();
+	if (!spSource)
+	{
+		tracks->clear();
+		*selectedIndex = -1;
+		return S_OK;
+	}
+
+	return spSource->GetSession()->GetVideoTracks(tracks, selectedIndex);
+}
+
+_Use_decl_annotations_
+HRESULT CSharedSessionView::SelectVideoTrack(INT32 index)
+{
+	std::shared_ptr<CSharedSource> spSource = GetSource();
+	return spSource ? spSource->GetSession()->SelectVideoTrack(index) : S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CSharedSessionView::GetSubtitleTracks(std::vector<SUBTITLE_TRACK>* tracks) const
+{
+	std::shared_ptr<CSharedSource> spSource = GetSource();
+	if (!spSource)
+	{
+		tracks->clear();
+		return S_OK;
+	}
+
+	return spSource->GetSession()->GetSubtitleTracks(tracks);
+}
+
+_Use_decl_annotations_
+HRESULT CSharedSessionView::CopyFrameToSurface(IPlaybackSurface* pSurface)
+{
+	std::shared_ptr<CSharedSource> spSource = GetSource();
+	if (!spSource)
+		return E_ILLEGAL_METHOD_CALL;
+
+	return spSource->CopyFrameToSurface(pSurface);
+}
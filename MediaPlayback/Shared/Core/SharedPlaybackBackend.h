@@ -0,0 +1,195 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Backend decorator for players that show the same content on several renderers (mirrors, thumbnails, displays).
+//
+// The sessions it hands out are views. Views opened on the same content location subscribe to one session of the
+// wrapped backend, their shared source: it decodes once, the transport calls of any view drive it (the views share
+// one timeline, rate, loop and track selection), and its events go to every view. A view joining a source that is
+// open already gets its state replayed. Every frame is copied out of the decoder once per distinct surface size,
+// which is where the decoder scales, into a frame slot the views copy from; a source with a single view copies
+// straight to its surface. The decoder is closed with its last view. Thread safe.
+
+#include "PlaybackBackend.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+
+
+class CSharedSource;
+class CSharedSessionView;
+
+class CSharedPlaybackBackend
+	: public IPlaybackBackend
+{
+public:
+	explicit CSharedPlaybackBackend(_In_ const std::shared_ptr<IPlaybackBackend>& spBackend);
+	virtual ~CSharedPlaybackBackend();
+
+	void GetStats(_Out_ SHARED_SOURCE_STATS* pStats);
+
+	// The source views of the content location subscribe to, created if no view has it open
+	HRESULT GetSource(_In_ const std::wstring& contentLocation, _Out_ std::shared_ptr<CSharedSource>* pspSource);
+
+	// IPlaybackBackend
+	virtual HRESULT CreateSession(
+		_In_ IPlaybackSessionSink* pSink,
+		_Out_ std::shared_ptr<IPlaybackSession>* ppSession) override;
+
+	virtual HRESULT CreateSurface(
+		_In_ const PLAYBACK_SURFACE_DESC& desc,
+		_Out_ std::shared_ptr<IPlaybackSurface>* ppSurface) override;
+
+	virtual HRESULT CopySurface(
+		_In_ IPlaybackSurface* pSource,
+		_In_ IPlaybackSurface* pDestination) override;
+
+	virtual HRESULT GetDecoderCapabilities(_Out_ CDecoderCapabilities* pCapabilities) override;
+
+	virtual HRESULT GetKeyframeIndex(
+		_In_ const wchar_t* pszContentLocation,
+		_Out_ std::shared_ptr<const CKeyframeIndex>* pIndex) override;
+
+	virtual HRESULT OpenThumbnailSource(
+		_In_ const wchar_t* pszContentLocation,
+		_Out_ THUMBNAIL_SOURCE* pSource) override;
+
+private:
+	friend class CSharedSource;
+
+	std::shared_ptr<IPlaybackBackend> m_spBackend;
+
+	std::mutex m_lock;
+	std::map<std::wstring, std::weak_ptr<CSharedSource>> m_sources;
+
+	std::atomic<UINT64> m_decodedCopies;
+	std::atomic<UINT64> m_sharedCopies;
+};
+
+
+// One decode session of the wrapped backend and the views subscribed to it
+class CSharedSource
+	: public IPlaybackSessionSink
+{
+public:
+	CSharedSource(_In_ CSharedPlaybackBackend* pBackend, _In_ const std::wstring& contentLocation);
+	virtual ~CSharedSource();
+
+	HRESULT Initialize();
+
+	// The first view opens the decoder, later ones get the state of the open source replayed
+	HRESULT AddView(_In_ const std::shared_ptr<CSharedSessionView>& spView);
+	void RemoveView(_In_ CSharedSessionView* pView);
+	UINT32 GetViewCount();
+
+	IPlaybackSession* GetSession() const { return m_session.get(); }
+
+	HRESULT CopyFrameToSurface(_In_ IPlaybackSurface* pSurface);
+
+	// IPlaybackSessionSink, fanned out to the views
+	virtual void OnSessionOpened() override;
+	virtual void OnSessionStateChanged(PlaybackState state) override;
+	virtual void OnSessionEnded() override;
+	virtual void OnSessionFailed(HRESULT hr) override;
+	virtual void OnSessionSizeChanged() override;
+	virtual void OnSessionFrameAvailable() override;
+	virtual void OnSessionVideoTracksChanged() override;
+	virtual void OnSessionSubtitleTracksChanged() override;
+	virtual void OnSessionSubtitleCueEntered(_In_ const SUBTITLE_CUE& cue) override;
+	virtual void OnSessionSubtitleCueExited(_In_ const SUBTITLE_CUE& cue) override;
+	virtual void OnSessionStatusChanged() override;
+
+private:
+	typedef struct _SHARED_FRAME_SLOT
+	{
+		std::shared_ptr<IPlaybackSurface> surface;
+		UINT64 frameSerial;		// of the frame the surface holds
+	} SHARED_FRAME_SLOT;
+
+	template <typename TEvent>
+	void RaiseEvent(_In_ const TEvent& fnEvent);
+
+private:
+	CSharedPlaybackBackend* m_pBackend;
+	std::wstring m_contentLocation;
+	std::shared_ptr<IPlaybackSession> m_session;
+
+	std::recursive_mutex m_openLock;	// serializes opening and closing the decoder as views come and go, views may close from its events
+	std::mutex m_lock;
+	std::vector<std::weak_ptr<CSharedSessionView>> m_views;
+	bool m_openRequested;
+	bool m_opened;
+
+	std::mutex m_frameLock;
+	std::vector<SHARED_FRAME_SLOT> m_frameSlots;	// one per distinct surface size
+	std::atomic<UINT64> m_frameSerial;
+};
+
+
+// Session handed out by CSharedPlaybackBackend, forwards to the source it is subscribed to
+class CSharedSessionView
+	: public IPlaybackSession
+	, public std::enable_shared_from_this<CSharedSessionView>
+{
+public:
+	CSharedSessionView(_In_ CSharedPlaybackBackend* pBackend, _In_ IPlaybackSessionSink* pSink);
+	virtual ~CSharedSessionView();
+
+	IPlaybackSessionSink* GetSink() const { return m_pSink; }
+
+	// Session of the wrapped backend decoding for this view, it keeps the source alive; null while closed
+	std::shared_ptr<IPlaybackSession> GetSourceSession() const;
+
+	// IPlaybackSession
+	virtual HRESULT Open(_In_ const wchar_t* pszContentLocation) override;
+	virtual HRESULT Close() override;
+	virtual bool HasSource() const override;
+
+	virtual HRESULT Play() override;
+	virtual HRESULT Pause() override;
+	virtual HRESULT Seek(_In_ LONGLONG position) override;
+	virtual HRESULT SetVolume(_In_ DOUBLE volume) override;
+	virtual HRESULT SetPlaybackRate(_In_ DOUBLE rate) override;
+	virtual HRESULT SetLoop(_In_ bool enabled, _In_ LONGLONG start, _In_ LONGLONG end) override;
+
+	virtual PlaybackState GetPlaybackState() const override;
+	virtual HRESULT GetDurationAndPosition(_Out_ LONGLONG* duration, _Out_ LONGLONG* position) const override;
+	virtual HRESULT GetNaturalVideoSize(_Out_ UINT32* width, _Out_ UINT32* height) const override;
+	virtual bool CanSeek() const override;
+	virtual bool IsStereoscopic() const override;
+
+	virtual HRESULT GetAvailableBitrates(_Out_ std::vector<UINT32>* bitrates) const override;
+	virtual HRESULT SetInitialBitrate(_In_ UINT32 bitrate) override;
+	virtual HRESULT SetDesiredMaxBitrate(_In_ UINT32 bitrate) override;
+	virtual UINT32 GetCurrentBitrate() const override;
+	virtual HRESULT GetBufferedRanges(_Out_ std::vector<MEDIA_TIME_RANGE>* ranges) const override;
+
+	virtual HRESULT GetVideoTracks(_Out_ std::vector<VIDEO_TRACK_INFO>* tracks, _Out_ INT32* selectedIndex) const override;
+	virtual HRESULT SelectVideoTrack(_In_ INT32 index) override;
+
+	virtual HRESULT GetSubtitleTracks(_Out_ std::vector<SUBTITLE_TRACK>* tracks) const override;
+
+	virtual HRESULT CopyFrameToSurface(_In_ IPlaybackSurface* pSurface) override;
+
+private:
+	std::shared_ptr<CSharedSource> GetSource() const;
+
+private:
+	CSharedPlaybackBackend* m_pBackend;
+	IPlaybackSessionSink* m_pSink;
+
+	mutable std::mutex m_lock;
+	std::shared_ptr<CSharedSource> m_spSource;		// null while closed
+};
@@ -0,0 +1,180 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Generational slot map: O(1) insert, lookup and remove through a handle, values stored densely for iteration.
+//
+// A handle packs a slot index (low 16 bits) and the generation of that slot (high 16 bits). Removing a value
+// bumps the generation of its slot, so handles of removed values are rejected even after the slot has been reused.
+// Handle 0 is never issued. Not thread safe, owners serialize access.
+
+#include "CorePlatform.h"
+
+#include <vector>
+
+#define _SlotMapIndexBits_ 16
+#define _SlotMapMaxCount_ ((UINT32)1 << _SlotMapIndexBits_)
+#define _SlotMapIndexMask_ (_SlotMapMaxCount_ - 1)
+
+
+template <typename T>
+class CSlotMap
+{
+public:
+	typedef UINT32 Handle;
+
+	CSlotMap()
+		: m_freeSlot(c_noSlot)
+	{
+	}
+
+	// Fails with E_OUTOFMEMORY once _SlotMapMaxCount_ values are stored
+	HRESULT Insert(_In_ const T& value, _Out_ Handle* pHandle)
+	{
+		*pHandle = 0;
+
+		UINT32 slotIndex = m_freeSlot;
+		if (slotIndex == c_noSlot)
+		{
+			if (m_slots.size() >= _SlotMapMaxCount_)
+				return E_OUTOFMEMORY;
+
+			SLOT slot = { 1, 0 };
+			m_slots.push_back(slot);
+			slotIndex = (UINT32)m_slots.size() - 1;
+		}
+		else
+		{
+			m_freeSlot = m_slots[slotIndex].denseIndex; // free slots chain through denseIndex
+		}
+
+		m_slots[slotIndex].denseIndex = (UINT32)m_values.size();
+		m_values.push_back(value);
+		m_denseToSlot.push_back(slotIndex);
+
+		*pHandle = MakeHandle(slotIndex, m_slots[slotIndex].generation);
+
+		return S_OK;
+	}
+
+	// Returns false for handles that have already been removed or were never issued
+	bool Remove(_In_ Handle handle)
+	{
+		UINT32 slotIndex = 0;
+		if (!ResolveSlot(handle, &slotIndex))
+			return false;
+
+		// move the last value into the hole to keep the values dense
+		UINT32 denseIndex = m_slots[slotIndex].denseIndex;
+		UINT32 lastIndex = (UINT32)m_values.size() - 1;
+		if (denseIndex != lastIndex)
+		{
+			m_values[denseIndex] = m_values[lastIndex];
+			m_denseToSlot[denseIndex] = m_denseToSlot[lastIndex];
+			m_slots[m_denseToSlot[denseIndex]].denseIndex = denseIndex;
+		}
+
+		m_values.pop_back();
+		m_denseToSlot.pop_back();
+
+		SLOT& slot = m_slots[slotIndex];
+		slot.generation = (slot.generation + 1) & 0xFFFF;
+		if (slot.generation == 0)
+			slot.generation = 1; // keeps every handle non-zero
+		slot.denseIndex = m_freeSlot;
+		m_freeSlot = slotIndex;
+
+		return true;
+	}
+
+	// Returns nullptr for stale or invalid handles
+	T* Get(_In_ Handle handle)
+	{
+		UINT32 slotIndex = 0;
+		if (!ResolveSlot(handle, &slotIndex))
+			return nullptr;
+
+		return &m_values[m_slots[slotIndex].denseIndex];
+	}
+
+	const T* Get(_In_ Handle handle) const
+	{
+		UINT32 slotIndex = 0;
+		if (!ResolveSlot(handle, &slotIndex))
+			return nullptr;
+
+		return &m_values[m_slots[slotIndex].denseIndex];
+	}
+
+	bool IsValid(_In_ Handle handle) const
+	{
+		UINT32 slotIndex = 0;
+		return ResolveSlot(handle, &slotIndex);
+	}
+
+	void Clear()
+	{
+		// removing one by one keeps outstanding handles invalid after the slots get reused
+		while (!m_values.empty())
+		{
+			Remove(GetHandleAt(GetCount() - 1));
+		}
+	}
+
+	// Dense access to the live values, in no particular order. Indices change when values are removed.
+	UINT32 GetCount() const { return (UINT32)m_values.size(); }
+	T& GetAt(_In_ UINT32 index) { return m_values[index]; }
+	const T& GetAt(_In_ UINT32 index) const { return m_values[index]; }
+	Handle GetHandleAt(_In_ UINT32 index) const { return MakeHandle(m_denseToSlot[index], m_slots[m_denseToSlot[index]].generation); }
+
+	typename std::vector<T>::iterator begin() { return m_values.begin(); }
+	typename std::vector<T>::iterator end() { return m_values.end(); }
+	typename std::vector<T>::const_iterator begin() const { return m_values.begin(); }
+	typename std::vector<T>::const_iterator end() const { return m_values.end(); }
+
+private:
+	typedef struct _SLOT
+	{
+		UINT32 generation;		// 1..0xFFFF
+		UINT32 denseIndex;		// index into m_values, or the next free slot while the slot is free
+	} SLOT;
+
+	static const UINT32 c_noSlot = (UINT32)-1;
+
+	static Handle MakeHandle(_In_ UINT32 slotIndex, _In_ UINT32 generation)
+	{
+		return (generation << _SlotMapIndexBits_) | slotIndex;
+	}
+
+	bool ResolveSlot(_In_ Handle handle, _Out_ UINT32* pSlotIndex) const
+	{
+		UINT32 slotIndex = handle & _SlotMapIndexMask_;
+		UINT32 generation = handle >> _SlotMapIndexBits_;
+
+		if (handle == 0 || slotIndex >= m_slots.size() || m_slots[slotIndex].generation != generation)
+			return false;
+
+		// a free slot keeps its generation until it is reused, so check it is actually in use
+		UINT32 denseIndex = m_slots[slotIndex].denseIndex;
+		if (denseIndex >= m_denseToSlot.size() || m_denseToSlot[denseIndex] != slotIndex)
+			return false;
+
+		*pSlotIndex = slotIndex;
+		return true;
+	}
+
+private:
+	std::vector<SLOT> m_slots;
+	std::vector<T> m_values;
+	std::vector<UINT32> m_denseToSlot;
+	UINT32 m_freeSlot;		// head of the free slot chain
+};
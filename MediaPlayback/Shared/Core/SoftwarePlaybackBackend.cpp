@@ -0,0 +1,906 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "SoftwarePlaybackBackend.h"
+#include "KeyframeIndex.h"
+#include "StereoPacking.h"
+
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+
+_Use_decl_annotations_
+CSoftwarePlaybackSurface::CSoftwarePlaybackSurface(UINT32 width, UINT32 height, bool isStereoscopic)
+	: m_width(width)
+	, m_height(height)
+	, m_isStereoscopic(isStereoscopic)
+	, m_frameIndex(0)
+	, m_pixels((size_t)width * height * 4, 0)
+{
+}
+
+
+_Use_decl_annotations_
+CSoftwareThumbnailDecoder::CSoftwareThumbnailDecoder(const SOFTWARE_MEDIA_DESCRIPTION& media)
+	: m_media(media)
+{
+}
+
+_Use_decl_annotations_
+HRESULT CSoftwareThumbnailDecoder::Open(INT64* pDuration)
+{
+	NULL_CHK(pDuration);
+
+	*pDuration = m_media.duration;
+
+	return m_media.openResult;
+}
+
+_Use_decl_annotations_
+HRESULT CSoftwareThumbnailDecoder::DecodeFrame(INT64 position, std::vector<BYTE>* pFrame, UINT32* pWidth, UINT32* pHeight)
+{
+	NULL_CHK(pFrame);
+	NULL_CHK(pWidth);
+	NULL_CHK(pHeight);
+
+	if (!m_media.width || !m_media.height)
+		return E_UNEXPECTED;
+
+	*pWidth = m_media.width;
+	*pHeight = m_media.height;
+
+	pFrame->resize((size_t)m_media.width * m_media.height * 4);
+	for (size_t i = 0; i < pFrame->size(); i += 4)
+	{
+		(*pFrame)[i + 0] = (BYTE)(position / SOFTWARE_TICKS_PER_SECOND);
+		(*pFrame)[i + 1] = 0x40;
+		(*pFrame)[i + 2] = 0x80;
+		(*pFrame)[i + 3] = 0xFF;
+	}
+
+	return S_OK;
+}
+
+
+CSoftwarePlaybackBackend::CSoftwarePlaybackBackend()
+	: m_hw4KDecoding(true)
+	, m_classifySources(true)
+	, m_sourceRequests(0)
+{
+}
+
+CSoftwarePlaybackBackend::~CSoftwarePlaybackBackend()
+{
+}
+
+_Use_decl_annotations_
+void CSoftwarePlaybackBackend::RegisterMedia(const wchar_t* pszContentLocation, const SOFTWARE_MEDIA_DESCRIPTION& description)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	m_media[pszContentLocation] = description;
+}
+
+_Use_decl_annotations_
+bool CSoftwarePlaybackBackend::FindMedia(const wchar_t* pszContentLocation, SOFTWARE_MEDIA_DESCRIPTION* pDescription)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	auto it = m_media.find(pszContentLocation);
+	if (it == m_media.end())
+		return false;
+
+	*pDescription = it->second;
+	return true;
+}
+
+_Use_decl_annotations_
+void CSoftwarePlaybackBackend::OpenSource(const wchar_t* pszContentLocation, const SOFTWARE_MEDIA_DESCRIPTION& media)
+{
+	auto fnRequest = [this, &media]()
+	{
+		m_sourceRequests++;
+
+		if (media.openBlockingTime)
+			std::this_thread::sleep_for(std::chrono::milliseconds(media.openBlockingTime));
+	};
+
+	// S_OK once the adaptive attempt opened the source
+	HRESULT hr = S_FALSE;
+	if (CSourceClassifier::IsHttpUri(pszContentLocation))
+	{
+		if (m_classifySources)
+		{
+			SourceType type = SourceType::SourceType_Unknown;
+			hr = m_classifier.ResolveSource(pszContentLocation,
+				[&](SourceType* pType)
+				{
+					fnRequest();
+					*pType = media.isAdaptive ? SourceType::SourceType_Adaptive : SourceType::SourceType_Progressive;
+					return S_OK;
+				},
+				[&](bool* pNotManifest)
+				{
+					fnRequest();
+					*pNotManifest = !media.isAdaptive;
+					return media.isAdaptive ? S_OK : S_FALSE;
+				},
+				&type);
+		}
+		else
+		{
+			fnRequest();
+			hr = media.isAdaptive ? S_OK : S_FALSE;
+		}
+	}
+
+	// the generic constructor
+	if (hr != S_OK)
+		fnRequest();
+}
+
+_Use_decl_annotations_
+void CSoftwarePlaybackBackend::Advance(LONGLONG ticks)
+{
+	std::vector<std::shared_ptr<CSoftwarePlaybackSession>> sessions;
+
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		sessions.reserve(m_sessions.size());
+		for (auto it = m_sessions.begin(); it != m_sessions.end(); )
+		{
+			auto spSession = it->lock();
+			if (spSession)
+			{
+				sessions.push_back(spSession);
+				++it;
+			}
+			else
+			{
+				it = m_sessions.erase(it);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < sessions.size(); i++)
+	{
+		sessions[i]->Advance(ticks);
+	}
+}
+
+_Use_decl_annotations_
+HRESULT CSoftwarePlaybackBackend::CreateSession(IPlaybackSessionSink* pSink, std::shared_ptr<IPlaybackSession>* ppSession)
+{
+	NULL_CHK(pSink);
+	NULL_CHK(ppSession);
+
+	auto spSession = std::make_shared<CSoftwarePlaybackSession>(this, pSink);
+
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_sessions.push_back(spSession);
+	}
+
+	*ppSession = spSession;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CSoftwarePlaybackBackend::CreateSurface(const PLAYBACK_SURFACE_DESC& desc, std::shared_ptr<IPlaybackSurface>* ppSurface)
+{
+	NULL_CHK(ppSurface);
+
+	if (!desc.width || !desc.height || desc.format > FrameFormat::FrameFormat_P010)
+		return E_INVALIDARG;
+
+	*ppSurface = std::make_shared<CSoftwarePlaybackSurface>(desc.width, desc.height, desc.isStereoscopic);
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CSoftwarePlaybackBackend::CopySurface(IPlaybackSurface* pSource, IPlaybackSurface* pDestination)
+{
+	CSoftwarePlaybackSurface* pSourceSurface = dynamic_cast<CSoftwarePlaybackSurface*>(pSource);
+	NULL_CHK(pSourceSurface);
+
+	CSoftwarePlaybackSurface* pDestinationSurface = dynamic_cast<CSoftwarePlaybackSurface*>(pDestination);
+	NULL_CHK(pDestinationSurface);
+
+	if (pSourceSurface->GetWidth() != pDestinationSurface->GetWidth() || pSourceSurface->GetHeight() != pDestinationSurface->GetHeight())
+		return E_INVALIDARG;
+
+	memcpy(pDestinationSurface->GetPixels(), pSourceSurface->GetPixels(), (size_t)pSourceSurface->GetPitch() * pSourceSurface->GetHeight());
+	pDestinationSurface->SetFrameIndex(pSourceSurface->GetFrameIndex());
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CSoftwarePlaybackBackend::GetDecoderCapabilities(CDecoderCapabilities* pCapabilities)
+{
+	NULL_CHK(pCapabilities);
+
+	*pCapabilities = CDecoderCapabilities();
+	if (m_hw4KDecoding)
+		pCapabilities->Add({ VideoCodec::VideoCodec_H264, 0, 8, 4096, 2304, 0 });
+	else
+		pCapabilities->Add({ VideoCodec::VideoCodec_H264, 0, 8, 1920, 1088, 0 });
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CSoftwarePlaybackBackend::GetKeyframeIndex(const wchar_t* pszContentLocation, std::shared_ptr<const CKeyframeIndex>* pIndex)
+{
+	NULL_CHK(pszContentLocation);
+	NULL_CHK(pIndex);
+
+	pIndex->reset();
+
+	SOFTWARE_MEDIA_DESCRIPTION media;
+	if (!FindMedia(pszContentLocation, &media) || media.keyframeFile.empty())
+		return S_FALSE;
+
+	return GetFileKeyframeIndex(media.keyframeFile, pIndex);
+}
+
+_Use_decl_annotations_
+HRESULT CSoftwarePlaybackBackend::OpenThumbnailSource(const wchar_t* pszContentLocation, THUMBNAIL_SOURCE* pSource)
+{
+	NULL_CHK(pszContentLocation);
+	NULL_CHK(pSource);
+
+	SOFTWARE_MEDIA_DESCRIPTION media;
+	if (!FindMedia(pszContentLocation, &media))
+		return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+
+	pSource->decoder = std::make_shared<CSoftwareThumbnailDecoder>(media);
+	pSource->sourceKey = pszContentLocation;
+	pSource->cachePath.clear();
+
+	return S_OK;
+}
+
+
+_Use_decl_annotations_
+CSoftwarePlaybackSession::CSoftwarePlaybackSession(CSoftwarePlaybackBackend* pBackend, IPlaybackSessionSink* pSink)
+	: m_pBackend(pBackend)
+	, m_pSink(pSink)
+	, m_hasSource(false)
+	, m_opened(false)
+	, m_playRequested(false)
+	, m_state(PlaybackState::PlaybackState_None)
+	, m_position(0)
+	, m_openRemaining(0)
+	, m_frameClock(0)
+	, m_frameIndex(0)
+	, m_currentBitrate(0)
+	, m_maxBitrate(0)
+	, m_selectedVideoTrack(-1)
+	, m_volume(1.0)
+	, m_rate(1.0)
+	, m_loopEnabled(false)
+	, m_loopStart(0)
+	, m_loopEnd(0)
+{
+	m_media.width = 0;
+	m_media.height = 0;
+	m_media.duration = 0;
+	m_media.frameRateNumerator = 30;
+	m_media.frameRateDenominator = 1;
+	m_media.openLatency = 0;
+	m_media.openBlockingTime = 0;
+	m_media.openResult = S_OK;
+	m_media.decodeTime = 0;
+	m_media.canSeek = false;
+	m_media.isStereoscopic = false;
+	m_media.isAdaptive = false;
+}
+
+CSoftwarePlaybackSession::~CSoftwarePlaybackSession()
+{
+}
+
+LONGLONG CSoftwarePlaybackSession::GetFrameDuration() const
+{
+	if (!m_media.frameRateNumerator || !m_media.frameRateDenominator)
+		return SOFTWARE_TICKS_PER_SECOND / 30;
+
+	return SOFTWARE_TICKS_PER_SECOND * m_media.frameRateDenominator / m_media.frameRateNumerator;
+}
+
+_Use_decl_annotations_
+void CSoftwarePlaybackSession::Advance(LONGLONG ticks)
+{
+	std::vector<SESSION_EVENT> events;
+	CUE_EVENTS cueEvents;
+	HRESULT hrOpen = S_OK;
+	UINT32 decodeTime = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		if (!m_hasSource)
+			return;
+
+		decodeTime = m_media.decodeTime;
+
+		if (!m_opened)
+		{
+			m_openRemaining -= ticks;
+			if (m_openRemaining > 0)
+				return;
+
+			hrOpen = m_media.openResult;
+		}
+
+		if (FAILED(hrOpen))
+		{
+			m_hasSource = false;
+			m_state = PlaybackState::PlaybackState_None;
+		}
+		else if (!m_opened)
+		{
+			// whatever is left after the open completes is played
+			ticks = -m_openRemaining;
+			m_openRemaining = 0;
+			m_opened = true;
+			m_state = m_playRequested ? PlaybackState::PlaybackState_Playing : PlaybackState::PlaybackState_Paused;
+
+			events.push_back({ SessionEvent_Opened, m_state });
+			if (!m_media.videoTracks.empty())
+				events.push_back({ SessionEvent_VideoTracksChanged, m_state });
+			if (!m_media.subtitleTracks.empty())
+				events.push_back({ SessionEvent_SubtitleTracksChanged, m_state });
+			events.push_back({ SessionEvent_SizeChanged, m_state });
+			events.push_back({ SessionEvent_StateChanged, m_state });
+			events.push_back({ SessionEvent_StatusChanged, m_state });
+		}
+
+		if (m_state == PlaybackState::PlaybackState_Playing && ticks > 0)
+		{
+			LONGLONG frameDuration = GetFrameDuration();
+
+			// the media advances at the rate, frames keep their media time spacing
+			ticks = (LONGLONG)(ticks * m_rate);
+
+			LONGLONG loopEnd = m_media.duration;
+			if (m_loopEnd != 0 && (loopEnd <= 0 || m_loopEnd < loopEnd))
+				loopEnd = m_loopEnd;
+
+			bool looping = m_loopEnabled && m_media.canSeek && loopEnd > m_loopStart;
+
+			if (looping)
+			{
+				// the loop start is decoded ahead, the frame clock runs on across the wrap
+				m_position += ticks;
+				if (m_position >= loopEnd)
+					m_position = m_loopStart + (m_position - m_loopStart) % (loopEnd - m_loopStart);
+			}
+			else
+			{
+				if (m_media.duration > 0 && ticks > m_media.duration - m_position)
+					ticks = m_media.duration - m_position;
+
+				m_position += ticks;
+			}
+
+			m_frameClock += ticks;
+
+			while (m_frameClock >= frameDuration)
+			{
+				m_frameClock -= frameDuration;
+				m_frameIndex++;
+				events.push_back({ SessionEvent_FrameAvailable, m_state });
+			}
+
+			if (!looping && m_media.duration > 0 && m_position >= m_media.duration)
+			{
+				// MediaPlayer stays paused at the end of the media after MediaEnded
+				m_position = m_media.duration;
+				m_state = PlaybackState::PlaybackState_Paused;
+				m_playRequested = false;
+
+				events.push_back({ SessionEvent_Ended, m_state });
+				events.push_back({ SessionEvent_StateChanged, m_state });
+			}
+		}
+
+		if (m_opened)
+			UpdateCues(&cueEvents);
+	}
+
+	if (FAILED(hrOpen))
+		m_pSink->OnSessionFailed(hrOpen);
+
+	// like a decoder, the frames cost their time before anybody sees them
+	if (decodeTime)
+	{
+		size_t frames = (size_t)std::count_if(events.begin(), events.end(), [](const SESSION_EVENT& event) { return event.type == SessionEvent_FrameAvailable; });
+		INT64 decoded = CoreNow() + (INT64)decodeTime * (INT64)frames * 10;
+
+		while (CoreNow() < decoded)
+		{
+		}
+	}
+
+	RaiseEvents(events);
+	RaiseCueEvents(cueEvents);
+}
+
+_Use_decl_annotations_
+void CSoftwarePlaybackSession::UpdateCues(CUE_EVENTS* pCueEvents)
+{
+	m_activeCues.resize(m_media.subtitleCues.size(), false);
+
+	// exits first, a cue replacing another one at the same time comes after it
+	for (size_t i = 0; i < m_media.subtitleCues.size(); i++)
+	{
+		const SOFTWARE_SUBTITLE_CUE& cue = m_media.subtitleCues[i];
+		bool active = m_hasSource && m_position >= cue.start && m_position < cue.end;
+
+		if (m_activeCues[i] && !active)
+			pCueEvents->exited.push_back(cue.cue);
+		else if (!m_activeCues[i] && active)
+			pCueEvents->entered.push_back(cue.cue);
+
+		m_activeCues[i] = active;
+	}
+}
+
+_Use_decl_annotations_
+void CSoftwarePlaybackSession::RaiseCueEvents(const CUE_EVENTS& cueEvents)
+{
+	for (size_t i = 0; i < cueEvents.exited.size(); i++)
+		m_pSink->OnSessionSubtitleCueExited(cueEvents.exited[i]);
+
+	for (size_t i = 0; i < cueEvents.entered.size(); i++)
+		m_pSink->OnSessionSubtitleCueEntered(cueEvents.entered[i]);
+}
+
+_Use_decl_annotations_
+void CSoftwarePlaybackSession::RaiseEvents(const std::vector<SESSION_EVENT>& events)
+{
+	for (size_t i = 0; i < events.size(); i++)
+	{
+		switch (events[i].type)
+		{
+		case SessionEvent_Opened:
+			m_pSink->OnSessionOpened();
+			break;
+		case SessionEvent_StateChanged:
+			m_pSink->OnSessionStateChanged(events[i].state);
+			break;
+		case SessionEvent_Ended:
+			m_pSink->OnSessionEnded();
+			break;
+		case SessionEvent_SizeChanged:
+			m_pSink->OnSessionSizeChanged();
+			break;
+		case SessionEvent_FrameAvailable:
+			m_pSink->OnSessionFrameAvailable();
+			break;
+		case SessionEvent_VideoTracksChanged:
+			m_pSink->OnSessionVideoTracksChanged();
+			break;
+		case SessionEvent_SubtitleTracksChanged:
+			m_pSink->OnSessionSubtitleTracksChanged();
+			break;
+		case SessionEvent_StatusChanged:
+			m_pSink->OnSessionStatusChanged();
+			break;
+		}
+	}
+}
+
+_Use_decl_annotations_
+HRESULT CSoftwarePlaybackSession::Open(const wchar_t* pszContentLocation)
+{
+	NULL_CHK(pszContentLocation);
+
+	SOFTWARE_MEDIA_DESCRIPTION media;
+	if (!m_pBackend->FindMedia(pszContentLocation, &media))
+		return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+
+	m_pBackend->OpenSource(pszContentLocation, media);
+
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		m_media = media;
+		m_hasSource = true;
+		m_opened = false;
+		m_playRequested = false;
+		m_state = PlaybackState::PlaybackState_Opening;
+		m_position = 0;
+		m_openRemaining = m_media.openLatency;
+		m_frameClock = 0;
+		m_frameIndex = 0;
+		m_maxBitrate = 0;
+		m_currentBitrate = m_media.bitrates.empty() ? 0 : m_media.bitrates.front();
+		m_selectedVideoTrack = m_media.videoTracks.empty() ? -1 : 0;
+		m_activeCues.assign(m_media.subtitleCues.size(), false);
+	}
+
+	std::vector<SESSION_EVENT> events;
+	events.push_back({ SessionEvent_StateChanged, PlaybackState::PlaybackState_Opening });
+	RaiseEvents(events);
+
+	return S_OK;
+}
+
+HRESULT CSoftwarePlaybackSession::Close()
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	m_hasSource = false;
+	m_opened = false;
+	m_playRequested = false;
+	m_state = PlaybackState::PlaybackState_None;
+	m_position = 0;
+	m_frameClock = 0;
+	m_activeCues.assign(m_activeCues.size(), false);
+
+	return S_OK;
+}
+
+bool CSoftwarePlaybackSession::HasSource() const
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	return m_hasSource;
+}
+
+HRESULT CSoftwarePlaybackSession::Play()
+{
+	std::vector<SESSION_EVENT> events;
+
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		if (!m_hasSource)
+			return S_OK;
+
+		if (!m_opened)
+		{
+			m_playRequested = true;
+		}
+		else if (m_state != PlaybackState::PlaybackState_Playing)
+		{
+			if (m_media.duration > 0 && m_position >= m_media.duration)
+				m_position = 0;
+
+			m_state = PlaybackState::PlaybackState_Playing;
+			events.push_back({ SessionEvent_StateChanged, m_state });
+		}
+	}
+
+	RaiseEvents(events);
+
+	return S_OK;
+}
+
+HRESULT CSoftwarePlaybackSession::Pause()
+{
+	std::vector<SESSION_EVENT> events;
+
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		m_playRequested = false;
+
+		if (m_opened && m_state == PlaybackState::PlaybackState_Playing)
+		{
+			m_state = PlaybackState::PlaybackState_Paused;
+			events.push_back({ SessionEvent_StateChanged, m_state });
+		}
+	}
+
+	RaiseEvents(events);
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CSoftwarePlaybackSession::Seek(LONGLONG position)
+{
+	std::vector<SESSION_EVENT> events;
+	CUE_EVENTS cueEvents;
+
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		if (!m_hasSource)
+			return E_ILLEGAL_METHOD_CALL;
+
+		if (!m_media.canSeek)
+			return S_FALSE;
+
+		if (position < 0)
+			position = 0;
+		if (m_media.duration > 0 && position > m_media.duration)
+			position = m_media.duration;
+
+		m_position = position;
+		m_frameClock = 0;
+
+		// like MediaPlayer in frame server mode, a paused session shows the frame it landed on
+		if (m_opened && m_state == PlaybackState::PlaybackState_Paused)
+		{
+			m_frameIndex++;
+			events.push_back({ SessionEvent_FrameAvailable, m_state });
+		}
+
+		if (m_opened)
+		{
+			events.push_back({ SessionEvent_StatusChanged, m_state });
+			UpdateCues(&cueEvents);
+		}
+	}
+
+	RaiseEvents(events);
+	RaiseCueEvents(cueEvents);
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CSoftwarePlaybackSession::SetVolume(DOUBLE volume)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	m_volume = volume;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CSoftwarePlaybackSession::SetPlaybackRate(DOUBLE rate)
+{
+	if (rate <= 0.0)
+		return E_INVALIDARG;
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	m_rate = rate;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CSoftwarePlaybackSession::SetLoop(bool enabled, LONGLONG start, LONGLONG end)
+{
+	if (start < 0 || end < 0 || (end != 0 && start >= end))
+		return E_INVALIDARG;
+
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	m_loopEnabled = enabled;
+	m_loopStart = start;
+	m_loopEnd = end;
+
+	return S_OK;
+}
+
+PlaybackState CSoftwarePlaybackSession::GetPlaybackState() const
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	return m_state;
+}
+
+_Use_decl_annotations_
+HRESULT CSoftwarePlaybackSession::GetDurationAndPosition(LONGLONG* duration, LONGLONG* position) const
+{
+	NULL_CHK(duration);
+	NULL_CHK(position);
+
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	if (!m_hasSource)
+		return E_ILLEGAL_METHOD_CALL;
+
+	*duration = m_media.duration;
+	*position = m_position;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CSoftwarePlaybackSession::GetNaturalVideoSize(UINT32* width, UINT32* height) const
+{
+	NULL_CHK(width);
+	NULL_CHK(height);
+
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	*width = m_opened ? m_media.width : 0;
+	*height = m_opened ? m_media.height : 0;
+
+	if (m_opened && m_selectedVideoTrack >= 0 && (size_t)m_selectedVideoTrack < m_media.videoTracks.size())
+	{
+		*width = m_media.videoTracks[m_selectedVideoTrack].width;
+		*height = m_media.videoTracks[m_selectedVideoTrack].height;
+	}
+
+	return S_OK;
+}
+
+bool CSoftwarePlaybackSession::CanSeek() const
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	return m_opened && m_media.canSeek;
+}
+
+bool CSoftwarePlaybackSession::IsStereoscopic() const
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	return m_media.isStereoscopic;
+}
+
+_Use_decl_annotations_
+HRESULT CSoftwarePlaybackSession::GetAvailableBitrates(std::vector<UINT32>* bitrates) const
+{
+	NULL_CHK(bitrates);
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	*bitrates = m_media.bitrates;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CSoftwarePlaybackSession::SetInitialBitrate(UINT32 bitrate)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	if (m_media.bitrates.empty())
+		return E_ILLEGAL_METHOD_CALL;
+
+	m_currentBitrate = (m_maxBitrate && bitrate > m_maxBitrate) ? m_maxBitrate : bitrate;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CSoftwarePlaybackSession::SetDesiredMaxBitrate(UINT32 bitrate)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	if (m_media.bitrates.empty())
+		return E_ILLEGAL_METHOD_CALL;
+
+	m_maxBitrate = bitrate;
+	if (m_maxBitrate && m_currentBitrate > m_maxBitrate)
+		m_currentBitrate = m_maxBitrate;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CSoftwarePlaybackSession::GetBufferedRanges(std::vector<MEDIA_TIME_RANGE>* ranges) const
+{
+	NULL_CHK(ranges);
+
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	ranges->clear();
+	if (m_opened && m_media.duration > 0)
+		ranges->push_back({ 0, m_media.duration });
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CSoftwarePlaybackSession::GetVideoTracks(std::vector<VIDEO_TRACK_INFO>* tracks, INT32* selectedIndex) const
+{
+	NULL_CHK(tracks);
+	NULL_CHK(selectedIndex);
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	*tracks = m_media.videoTracks;
+	*selectedIndex = m_selectedVideoTrack;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CSoftwarePlaybackSession::SelectVideoTrack(INT32 index)
+{
+	bool sizeChanged = false;
+
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		if (index < 0 || (size_t)index >= m_media.videoTracks.size())
+			return E_INVALIDARG;
+
+		if (m_selectedVideoTrack >= 0)
+		{
+			const VIDEO_TRACK_INFO& current = m_media.videoTracks[m_selectedVideoTrack];
+			const VIDEO_TRACK_INFO& next = m_media.videoTracks[index];
+			sizeChanged = m_opened && (current.width != next.width || current.height != next.height);
+		}
+
+		m_selectedVideoTrack = index;
+	}
+
+	if (sizeChanged)
+	{
+		std::vector<SESSION_EVENT> events;
+		events.push_back({ SessionEvent_SizeChanged, GetPlaybackState() });
+		RaiseEvents(events);
+	}
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CSoftwarePlaybackSession::GetSubtitleTracks(std::vector<SUBTITLE_TRACK>* tracks) const
+{
+	NULL_CHK(tracks);
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	*tracks = m_media.subtitleTracks;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CSoftwarePlaybackSession::CopyFrameToSurface(IPlaybackSurface* pSurface)
+{
+	CSoftwarePlaybackSurface* pSoftwareSurface = dynamic_cast<CSoftwarePlaybackSurface*>(pSurface);
+	NULL_CHK(pSoftwareSurface);
+
+	UINT64 frameIndex = GetFrameIndex();
+
+	// every frame gets a distinct, predictable fill so consumers can tell which frame they are looking at
+	if (!pSoftwareSurface->IsStereoscopic())
+	{
+		memset(pSoftwareSurface->GetPixels(), (int)(frameIndex & 0xFF), (size_t)pSoftwareSurface->GetPitch() * pSoftwareSurface->GetHeight());
+	}
+	else
+	{
+		// stereo content decodes side by side, the left eye gets the fill and the right eye its complement;
+		// the surface is over/under like the one the D3D11 player hands out
+		UINT32 eyeWidth = pSoftwareSurface->GetWidth();
+		UINT32 eyeHeight = pSoftwareSurface->GetHeight() / 2;
+		UINT32 framePitch = eyeWidth * 2 * 4;
+
+		std::lock_guard<std::mutex> lock(m_frameLock);
+
+		m_stereoFrame.resize((size_t)framePitch * eyeHeight);
+		for (UINT32 y = 0; y < eyeHeight; y++)
+		{
+			BYTE* pRow = m_stereoFrame.data() + (size_t)framePitch * y;
+			memset(pRow, (int)(frameIndex & 0xFF), (size_t)eyeWidth * 4);
+			memset(pRow + (size_t)eyeWidth * 4, (int)(~frameIndex & 0xFF), (size_t)eyeWidth * 4);
+		}
+
+		IFR(PackStereoOverUnder(m_stereoFrame.data(), framePitch, eyeWidth * 2, eyeHeight, StereoPacking::StereoPacking_SideBySide, pSoftwareSurface->GetPixels(), pSoftwareSurface->GetPitch()));
+	}
+
+	pSoftwareSurface->SetFrameIndex(frameIndex);
+
+	return S_OK;
+}
+
+UINT32 CSoftwarePlaybackSession::GetCurrentBitrate() const
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	return m_currentBitrate;
+}
+
+UINT64 CSoftwarePlaybackSession::GetFrameIndex() const
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	return m_frameIndex;
+}
@@ -0,0 +1,273 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Deterministic software backend. Media items are registered up front, time only moves when Advance() is called,
+// and every session event is raised synchronously on the thread calling Advance(). Frames are CPU BGRA buffers, the
+// native formats fall back to BGRA like on a device without them.
+// Open() makes the requests CreateMediaSource would for the URI, the source classifier of the backend decides them.
+
+#include "PlaybackBackend.h"
+#include "SourceClassifier.h"
+#include "ThumbnailAtlas.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define SOFTWARE_TICKS_PER_SECOND ((LONGLONG)10000000) // same 100ns units as TimeSpan
+
+
+// A subtitle cue on screen over [start, end) of the media
+typedef struct _SOFTWARE_SUBTITLE_CUE
+{
+	LONGLONG start;
+	LONGLONG end;
+	SUBTITLE_CUE cue;
+} SOFTWARE_SUBTITLE_CUE;
+
+typedef struct _SOFTWARE_MEDIA_DESCRIPTION
+{
+	UINT32 width;
+	UINT32 height;
+	LONGLONG duration;
+	UINT32 frameRateNumerator;
+	UINT32 frameRateDenominator;
+	LONGLONG openLatency;		// virtual time between Open() and the Opened event
+	UINT32 openBlockingTime;	// ms of wall clock time each request of Open() blocks its caller, a round trip for remote sources
+	HRESULT openResult;			// failure raised instead of the Opened event, like a source that turns out unplayable
+	UINT32 decodeTime;			// us of CPU time each frame costs the thread advancing the clock, whether it is copied out or not
+	bool canSeek;
+	bool isStereoscopic;
+	bool isAdaptive;			// a manifest: probes tell it is one, the adaptive attempt opens it
+	std::vector<UINT32> bitrates;
+	std::vector<VIDEO_TRACK_INFO> videoTracks;
+	std::vector<SUBTITLE_TRACK> subtitleTracks;
+	std::vector<SOFTWARE_SUBTITLE_CUE> subtitleCues;
+	std::wstring keyframeFile;	// container the keyframe index is read from like from a local file, empty if none
+} SOFTWARE_MEDIA_DESCRIPTION;
+
+
+class CSoftwarePlaybackSurface
+	: public IPlaybackSurface
+{
+public:
+	CSoftwarePlaybackSurface(_In_ UINT32 width, _In_ UINT32 height, _In_ bool isStereoscopic);
+
+	virtual UINT32 GetWidth() const override { return m_width; }
+	virtual UINT32 GetHeight() const override { return m_height; }
+	virtual bool IsStereoscopic() const override { return m_isStereoscopic; }
+	virtual FrameFormat GetFrameFormat() const override { return FrameFormat::FrameFormat_BGRA32; }
+
+	UINT32 GetPitch() const { return m_width * 4; }
+	BYTE* GetPixels() { return m_pixels.data(); }
+	const BYTE* GetPixels() const { return m_pixels.data(); }
+
+	// index of the last frame copied to this surface
+	UINT64 GetFrameIndex() const { return m_frameIndex; }
+	void SetFrameIndex(_In_ UINT64 frameIndex) { m_frameIndex = frameIndex; }
+
+private:
+	UINT32 m_width;
+	UINT32 m_height;
+	bool m_isStereoscopic;
+	UINT64 m_frameIndex;
+	std::vector<BYTE> m_pixels;
+};
+
+
+// Thumbnails of a registered media item: every frame is a solid color, its blue channel the second it starts at
+class CSoftwareThumbnailDecoder
+	: public IThumbnailDecoder
+{
+public:
+	explicit CSoftwareThumbnailDecoder(_In_ const SOFTWARE_MEDIA_DESCRIPTION& media);
+
+	virtual HRESULT Open(_Out_ INT64* pDuration) override;
+	virtual HRESULT DecodeFrame(
+		_In_ INT64 position,
+		_Inout_ std::vector<BYTE>* pFrame,
+		_Out_ UINT32* pWidth,
+		_Out_ UINT32* pHeight) override;
+
+private:
+	SOFTWARE_MEDIA_DESCRIPTION m_media;
+};
+
+
+class CSoftwarePlaybackSession;
+
+class CSoftwarePlaybackBackend
+	: public IPlaybackBackend
+{
+public:
+	CSoftwarePlaybackBackend();
+	virtual ~CSoftwarePlaybackBackend();
+
+	// Makes pszContentLocation openable by sessions of this backend
+	void RegisterMedia(_In_ const wchar_t* pszContentLocation, _In_ const SOFTWARE_MEDIA_DESCRIPTION& description);
+	bool FindMedia(_In_ const wchar_t* pszContentLocation, _Out_ SOFTWARE_MEDIA_DESCRIPTION* pDescription);
+
+	void SetHardware4KDecodingSupported(_In_ bool supported) { m_hw4KDecoding = supported; }
+
+	// Without classification every remote source gets the adaptive attempt first, as before the classifier
+	void SetClassifySources(_In_ bool classify) { m_classifySources = classify; }
+	CSourceClassifier& GetSourceClassifier() { return m_classifier; }
+
+	// Probes, adaptive attempts and opens made by Open() so far
+	UINT64 GetSourceRequests() const { return m_sourceRequests; }
+
+	// The requests opening the source costs, each blocking for openBlockingTime
+	void OpenSource(_In_ const wchar_t* pszContentLocation, _In_ const SOFTWARE_MEDIA_DESCRIPTION& media);
+
+	// Moves the virtual clock of every live session forward
+	void Advance(_In_ LONGLONG ticks);
+
+	// IPlaybackBackend
+	virtual HRESULT CreateSession(
+		_In_ IPlaybackSessionSink* pSink,
+		_Out_ std::shared_ptr<IPlaybackSession>* ppSession) override;
+
+	virtual HRESULT CreateSurface(
+		_In_ const PLAYBACK_SURFACE_DESC& desc,
+		_Out_ std::shared_ptr<IPlaybackSurface>* ppSurface) override;
+
+	virtual HRESULT CopySurface(
+		_In_ IPlaybackSurface* pSource,
+		_In_ IPlaybackSurface* pDestination) override;
+
+	// 8-bit H.264 up to 4096x2304, or up to 1920x1088 without hardware 4K decoding
+	virtual HRESULT GetDecoderCapabilities(_Out_ CDecoderCapabilities* pCapabilities) override;
+
+	virtual HRESULT GetKeyframeIndex(
+		_In_ const wchar_t* pszContentLocation,
+		_Out_ std::shared_ptr<const CKeyframeIndex>* pIndex) override;
+
+	virtual HRESULT OpenThumbnailSource(
+		_In_ const wchar_t* pszContentLocation,
+		_Out_ THUMBNAIL_SOURCE* pSource) override;
+
+private:
+	std::mutex m_lock;
+	std::map<std::wstring, SOFTWARE_MEDIA_DESCRIPTION> m_media;
+	std::vector<std::weak_ptr<CSoftwarePlaybackSession>> m_sessions;
+	bool m_hw4KDecoding;
+	bool m_classifySources;
+	CSourceClassifier m_classifier;
+	std::atomic<UINT64> m_sourceRequests;
+};
+
+
+class CSoftwarePlaybackSession
+	: public IPlaybackSession
+{
+public:
+	CSoftwarePlaybackSession(_In_ CSoftwarePlaybackBackend* pBackend, _In_ IPlaybackSessionSink* pSink);
+	virtual ~CSoftwarePlaybackSession();
+
+	void Advance(_In_ LONGLONG ticks);
+
+	// IPlaybackSession
+	virtual HRESULT Open(_In_ const wchar_t* pszContentLocation) override;
+	virtual HRESULT Close() override;
+	virtual bool HasSource() const override;
+
+	virtual HRESULT Play() override;
+	virtual HRESULT Pause() override;
+	virtual HRESULT Seek(_In_ LONGLONG position) override;
+	virtual HRESULT SetVolume(_In_ DOUBLE volume) override;
+	virtual HRESULT SetPlaybackRate(_In_ DOUBLE rate) override;
+	virtual HRESULT SetLoop(_In_ bool enabled, _In_ LONGLONG start, _In_ LONGLONG end) override;
+
+	virtual PlaybackState GetPlaybackState() const override;
+	virtual HRESULT GetDurationAndPosition(_Out_ LONGLONG* duration, _Out_ LONGLONG* position) const override;
+	virtual HRESULT GetNaturalVideoSize(_Out_ UINT32* width, _Out_ UINT32* height) const override;
+	virtual bool CanSeek() const override;
+	virtual bool IsStereoscopic() const override;
+
+	virtual HRESULT GetAvailableBitrates(_Out_ std::vector<UINT32>* bitrates) const override;
+	virtual HRESULT SetInitialBitrate(_In_ UINT32 bitrate) override;
+	virtual HRESULT SetDesiredMaxBitrate(_In_ UINT32 bitrate) override;
+	virtual UINT32 GetCurrentBitrate() const override;
+
+	// the whole media once it has opened
+	virtual HRESULT GetBufferedRanges(_Out_ std::vector<MEDIA_TIME_RANGE>* ranges) const override;
+
+	virtual HRESULT GetVideoTracks(_Out_ std::vector<VIDEO_TRACK_INFO>* tracks, _Out_ INT32* selectedIndex) const override;
+	virtual HRESULT SelectVideoTrack(_In_ INT32 index) override;
+
+	virtual HRESULT GetSubtitleTracks(_Out_ std::vector<SUBTITLE_TRACK>* tracks) const override;
+
+	virtual HRESULT CopyFrameToSurface(_In_ IPlaybackSurface* pSurface) override;
+
+	UINT64 GetFrameIndex() const;
+
+private:
+	enum SessionEvent
+	{
+		SessionEvent_Opened,
+		SessionEvent_StateChanged,
+		SessionEvent_Ended,
+		SessionEvent_SizeChanged,
+		SessionEvent_FrameAvailable,
+		SessionEvent_VideoTracksChanged,
+		SessionEvent_SubtitleTracksChanged,
+		SessionEvent_StatusChanged
+	};
+
+	typedef struct _SESSION_EVENT
+	{
+		SessionEvent type;
+		PlaybackState state;
+	} SESSION_EVENT;
+
+	typedef struct _CUE_EVENTS
+	{
+		std::vector<SUBTITLE_CUE> entered;
+		std::vector<SUBTITLE_CUE> exited;
+	} CUE_EVENTS;
+
+	// events are collected under the lock and raised after it is released, so sinks can call back into the session
+	void RaiseEvents(_In_ const std::vector<SESSION_EVENT>& events);
+	void RaiseCueEvents(_In_ const CUE_EVENTS& cueEvents);
+	void UpdateCues(_Inout_ CUE_EVENTS* pCueEvents);	// m_lock must be held
+	LONGLONG GetFrameDuration() const;
+
+private:
+	CSoftwarePlaybackBackend* m_pBackend;
+	IPlaybackSessionSink* m_pSink;
+
+	mutable std::mutex m_lock;
+	bool m_hasSource;
+	bool m_opened;
+	bool m_playRequested;
+	SOFTWARE_MEDIA_DESCRIPTION m_media;
+	PlaybackState m_state;
+	LONGLONG m_position;
+	LONGLONG m_openRemaining;
+	LONGLONG m_frameClock;
+	UINT64 m_frameIndex;
+	UINT32 m_currentBitrate;
+	UINT32 m_maxBitrate;
+	INT32 m_selectedVideoTrack;
+	DOUBLE m_volume;
+	DOUBLE m_rate;
+	bool m_loopEnabled;
+	LONGLONG m_loopStart;
+	LONGLONG m_loopEnd;
+	std::vector<bool> m_activeCues;		// of m_media.subtitleCues
+
+	std::mutex m_frameLock;
+	std::vector<BYTE> m_stereoFrame;	// side by side frame packed into stereoscopic surfaces
+};
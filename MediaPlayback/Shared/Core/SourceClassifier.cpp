@@ -0,0 +1,325 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "SourceClassifier.h"
+
+#include <string.h>
+#include <wctype.h>
+
+#define _TsPacketSize_ 188
+
+typedef struct _URI_PARTS
+{
+	std::wstring scheme;		// empty for plain paths
+	std::wstring host;
+	std::wstring path;
+	std::wstring extension;		// of the last path segment, without the dot
+} URI_PARTS;
+
+static const wchar_t* c_localSchemes[] = { L"file", L"file-access", L"ms-appx", L"ms-appdata" };
+static const wchar_t* c_adaptiveExtensions[] = { L"m3u8", L"m3u", L"mpd" };
+static const wchar_t* c_progressiveExtensions[] =
+{
+	L"mp4", L"m4v", L"m4a", L"mov", L"3gp", L"3g2", L"mkv", L"mka", L"webm", L"ts", L"m2ts", L"mts",
+	L"avi", L"wmv", L"wma", L"asf", L"mp3", L"aac", L"ac3", L"ec3", L"flac", L"wav", L"mpg", L"mpeg"
+};
+static const wchar_t* c_adaptiveContentTypes[] =
+{
+	L"application/vnd.apple.mpegurl", L"application/x-mpegurl", L"audio/mpegurl", L"audio/x-mpegurl",
+	L"application/dash+xml", L"application/vnd.ms-sstr+xml"
+};
+static const wchar_t* c_progressiveContentTypes[] =
+{
+	L"application/mp4", L"application/vnd.ms-asf", L"application/x-matroska"
+};
+
+
+template <size_t N>
+static bool IsOneOf(_In_ const std::wstring& value, _In_ const wchar_t* (&values)[N])
+{
+	for (size_t i = 0; i < N; i++)
+	{
+		if (value == values[i])
+			return true;
+	}
+
+	return false;
+}
+
+static std::wstring ToLower(_In_ const std::wstring& value)
+{
+	std::wstring result(value);
+	for (size_t i = 0; i < result.size(); i++)
+	{
+		result[i] = (wchar_t)towlower(result[i]);
+	}
+
+	return result;
+}
+
+static bool StartsWith(_In_ const BYTE* pData, _In_ UINT32 size, _In_ const char* pszPrefix)
+{
+	size_t length = strlen(pszPrefix);
+	return size >= length && memcmp(pData, pszPrefix, length) == 0;
+}
+
+static bool Contains(_In_ const BYTE* pData, _In_ UINT32 size, _In_ const char* pszText)
+{
+	size_t length = strlen(pszText);
+	for (size_t i = 0; i + length <= size; i++)
+	{
+		if (memcmp(pData + i, pszText, length) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+static URI_PARTS ParseUri(_In_ const wchar_t* pszUri)
+{
+	URI_PARTS parts;
+	std::wstring uri(pszUri);
+
+	// a scheme is at least two characters, "c:\video.mp4" is a path
+	size_t colon = uri.find(L':');
+	size_t rest = 0;
+	if (colon != std::wstring::npos && colon > 1 && uri.find_first_of(L"/\\?#") > colon)
+	{
+		parts.scheme = ToLower(uri.substr(0, colon));
+		rest = colon + 1;
+	}
+
+	if (!parts.scheme.empty() && uri.compare(rest, 2, L"//") == 0)
+	{
+		size_t authorityEnd = uri.find_first_of(L"/?#", rest + 2);
+		if (authorityEnd == std::wstring::npos)
+			authorityEnd = uri.size();
+
+		parts.host = ToLower(uri.substr(rest + 2, authorityEnd - rest - 2));
+		size_t userInfo = parts.host.rfind(L'@');
+		if (userInfo != std::wstring::npos)
+			parts.host.erase(0, userInfo + 1);
+
+		rest = authorityEnd;
+	}
+
+	size_t pathEnd = parts.scheme.empty() ? uri.size() : uri.find_first_of(L"?#", rest);
+	if (pathEnd == std::wstring::npos)
+		pathEnd = uri.size();
+
+	parts.path = ToLower(uri.substr(rest, pathEnd - rest));
+
+	size_t segment = parts.path.find_last_of(L"/\\");
+	segment = (segment == std::wstring::npos) ? 0 : segment + 1;
+	size_t dot = parts.path.rfind(L'.');
+	if (dot != std::wstring::npos && dot >= segment)
+		parts.extension = parts.path.substr(dot + 1);
+
+	return parts;
+}
+
+static bool IsSmoothStreamingPath(_In_ const std::wstring& path)
+{
+	// http://host/video.ism/manifest, optionally followed by (format=...)
+	return path.find(L".ism/manifest") != std::wstring::npos || path.find(L".isml/manifest") != std::wstring::npos;
+}
+
+
+_Use_decl_annotations_
+CSourceClassifier::CSourceClassifier(size_t capacity)
+	: m_outcomes(capacity)
+{
+}
+
+_Use_decl_annotations_
+SourceType CSourceClassifier::ClassifyUri(const wchar_t* pszUri)
+{
+	if (pszUri == nullptr)
+		return SourceType::SourceType_Unknown;
+
+	URI_PARTS parts = ParseUri(pszUri);
+
+	if (IsOneOf(parts.extension, c_adaptiveExtensions) || IsSmoothStreamingPath(parts.path))
+		return SourceType::SourceType_Adaptive;
+
+	if (parts.scheme.empty() || IsOneOf(parts.scheme, c_localSchemes))
+		return SourceType::SourceType_Local;
+
+	if (IsOneOf(parts.extension, c_progressiveExtensions))
+		return SourceType::SourceType_Progressive;
+
+	// adaptive sources only come over http(s), anything else (rtsp, ...) goes to the generic constructor
+	if (parts.scheme != L"http" && parts.scheme != L"https")
+		return SourceType::SourceType_Progressive;
+
+	SourceType type = SourceType::SourceType_Unknown;
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	m_outcomes.Get(GetUriPattern(pszUri), &type);
+
+	return type;
+}
+
+_Use_decl_annotations_
+void CSourceClassifier::RecordOutcome(const wchar_t* pszUri, SourceType type)
+{
+	if (pszUri == nullptr || type == SourceType::SourceType_Unknown || !IsHttpUri(pszUri))
+		return;
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	m_outcomes.Put(GetUriPattern(pszUri), type);
+}
+
+void CSourceClassifier::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	m_outcomes.Clear();
+}
+
+_Use_decl_annotations_
+HRESULT CSourceClassifier::ResolveSource(
+	const wchar_t* pszUri,
+	const ProbeSource& fnProbe,
+	const OpenAdaptiveSource& fnOpenAdaptive,
+	SourceType* pType)
+{
+	NULL_CHK(pszUri);
+	NULL_CHK(pType);
+
+	SourceType type = ClassifyUri(pszUri);
+
+	// a failed probe says nothing, the adaptive attempt decides then
+	if (type == SourceType::SourceType_Unknown && fnProbe)
+	{
+		HRESULT hrProbe = fnProbe(&type);
+		if (hrProbe == HRESULT_FROM_WIN32(ERROR_CANCELLED))
+			return hrProbe;
+
+		if (FAILED(hrProbe))
+			type = SourceType::SourceType_Unknown;
+
+		RecordOutcome(pszUri, type);
+	}
+
+	*pType = type;
+
+	// Only adaptive sources need the (speculative) adaptive attempt, it costs a manifest request. A wrong "progressive"
+	// guess still plays, the generic constructor opens HLS/DASH itself, just without bitrate control.
+	if ((type != SourceType::SourceType_Adaptive && type != SourceType::SourceType_Unknown) || !fnOpenAdaptive)
+		return S_FALSE;
+
+	bool notManifest = false;
+	HRESULT hr = fnOpenAdaptive(&notManifest);
+	IFR(hr);
+
+	if (type == SourceType::SourceType_Unknown)
+	{
+		// network failures say nothing about the content
+		if (hr == S_OK)
+			RecordOutcome(pszUri, SourceType::SourceType_Adaptive);
+		else if (notManifest)
+			RecordOutcome(pszUri, SourceType::SourceType_Progressive);
+	}
+
+	if (hr == S_OK)
+		*pType = SourceType::SourceType_Adaptive;
+
+	return hr;
+}
+
+_Use_decl_annotations_
+SourceType CSourceClassifier::ClassifyContentType(const wchar_t* pszContentType)
+{
+	if (pszContentType == nullptr)
+		return SourceType::SourceType_Unknown;
+
+	std::wstring contentType = ToLower(pszContentType);
+
+	size_t parameters = contentType.find(L';');
+	if (parameters != std::wstring::npos)
+		contentType.erase(parameters);
+
+	size_t end = contentType.find_last_not_of(L" \t");
+	contentType.erase(end == std::wstring::npos ? 0 : end + 1);
+
+	if (IsOneOf(contentType, c_adaptiveContentTypes))
+		return SourceType::SourceType_Adaptive;
+
+	// playlists served as audio/* are caught above, every other audio/video type is a single file
+	if (IsOneOf(contentType, c_progressiveContentTypes) || contentType.compare(0, 6, L"video/") == 0 || contentType.compare(0, 6, L"audio/") == 0)
+		return SourceType::SourceType_Progressive;
+
+	// application/octet-stream, text/plain, ... say nothing
+	return SourceType::SourceType_Unknown;
+}
+
+_Use_decl_annotations_
+SourceType CSourceClassifier::SniffContent(const BYTE* pData, UINT32 size)
+{
+	if (pData == nullptr || size < 4)
+		return SourceType::SourceType_Unknown;
+
+	// binary containers
+	if (size >= 8 && (memcmp(pData + 4, "ftyp", 4) == 0 || memcmp(pData + 4, "styp", 4) == 0 || memcmp(pData + 4, "moov", 4) == 0))
+		return SourceType::SourceType_Progressive;
+
+	static const BYTE c_ebml[] = { 0x1A, 0x45, 0xDF, 0xA3 };
+	static const BYTE c_asf[] = { 0x30, 0x26, 0xB2, 0x75, 0x8E, 0x66, 0xCF, 0x11 };
+
+	if (memcmp(pData, c_ebml, sizeof(c_ebml)) == 0 ||
+		(size >= sizeof(c_asf) && memcmp(pData, c_asf, sizeof(c_asf)) == 0) ||
+		StartsWith(pData, size, "RIFF") || StartsWith(pData, size, "fLaC") || StartsWith(pData, size, "ID3"))
+		return SourceType::SourceType_Progressive;
+
+	if (pData[0] == 0x47 && (size <= _TsPacketSize_ || pData[_TsPacketSize_] == 0x47))
+		return SourceType::SourceType_Progressive;
+
+	// text manifests, possibly after a BOM and white space
+	UINT32 offset = StartsWith(pData, size, "\xEF\xBB\xBF") ? 3 : 0;
+	while (offset < size && (pData[offset] == ' ' || pData[offset] == '\t' || pData[offset] == '\r' || pData[offset] == '\n'))
+		offset++;
+
+	const BYTE* pText = pData + offset;
+	UINT32 textSize = size - offset;
+
+	if (StartsWith(pText, textSize, "#EXTM3U"))
+		return SourceType::SourceType_Adaptive;
+
+	if (StartsWith(pText, textSize, "<") && (Contains(pText, textSize, "<MPD") || Contains(pText, textSize, "<SmoothStreamingMedia")))
+		return SourceType::SourceType_Adaptive;
+
+	return SourceType::SourceType_Unknown;
+}
+
+_Use_decl_annotations_
+bool CSourceClassifier::IsHttpUri(const wchar_t* pszUri)
+{
+	if (pszUri == nullptr)
+		return false;
+
+	URI_PARTS parts = ParseUri(pszUri);
+	return parts.scheme == L"http" || parts.scheme == L"https";
+}
+
+_Use_decl_annotations_
+std::wstring CSourceClassifier::GetUriPattern(const wchar_t* pszUri)
+{
+	URI_PARTS parts = ParseUri(pszUri);
+
+	size_t segment = parts.path.find_last_of(L"/\\");
+	std::wstring directory = (segment == std::wstring::npos) ? std::wstring() : parts.path.substr(0, segment);
+
+	std::wstring pattern = parts.scheme + L"://" + parts.host + directory + L"/*";
+	if (!parts.extension.empty())
+		pattern += L"." + parts.extension;
+
+	return pattern;
+}
@@ -0,0 +1,84 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Decides which source constructor a URI needs before anything is opened, so progressive files and local content
+// don't pay for a speculative adaptive manifest request.
+//
+// Cheapest checks first: the extension (.m3u8, .mpd, .mp4, ...), then the scheme (local content is never adaptive),
+// then the outcome of previous loads from the same host and directory. URIs still unknown after that can be resolved
+// with the Content-Type (ClassifyContentType) or the first bytes of the content (SniffContent) and the result recorded.
+// ResolveSource is the whole decision ahead of opening a source, with the requests it costs left to the caller.
+
+#include "LruCache.h"
+
+#include <functional>
+#include <mutex>
+#include <string>
+
+#define _DefaultSourceClassifierCapacity_ 256
+#define _SourceSniffLength_ 512		// bytes SniffContent needs to recognize every supported container
+
+
+enum class SourceType : UINT32
+{
+	SourceType_Unknown = 0,
+	SourceType_Local,			// file system or app package, opened directly
+	SourceType_Progressive,		// single file over the network (MP4, MKV, TS, ...)
+	SourceType_Adaptive			// HLS, DASH or Smooth Streaming manifest
+};
+
+
+class CSourceClassifier
+{
+public:
+	// Asks the server what the URI is (Content-Type, first bytes), *pType stays SourceType_Unknown if it does not tell
+	typedef std::function<HRESULT(SourceType* pType)> ProbeSource;
+	// Opens the URI as an adaptive source: S_OK if it opened, S_FALSE if not, *pNotManifest when that is because the
+	// content is no manifest rather than unreachable
+	typedef std::function<HRESULT(bool* pNotManifest)> OpenAdaptiveSource;
+
+	explicit CSourceClassifier(_In_ size_t capacity = _DefaultSourceClassifierCapacity_);
+
+	// Returns SourceType_Unknown if the URI alone is not conclusive and nothing has been recorded for its pattern
+	SourceType ClassifyUri(_In_ const wchar_t* pszUri);
+
+	// Remembers how a URI turned out, later URIs with the same pattern are classified the same way
+	void RecordOutcome(_In_ const wchar_t* pszUri, _In_ SourceType type);
+
+	void Clear();
+
+	// Unknown URIs are probed, adaptive ones and the ones the probe could not tell get the adaptive attempt, the
+	// outcomes are recorded. S_OK if the adaptive attempt opened the source, S_FALSE if the caller opens it with the
+	// constructor of *pType. Fails with HRESULT_FROM_WIN32(ERROR_CANCELLED) of the callbacks or the adaptive attempt.
+	HRESULT ResolveSource(
+		_In_ const wchar_t* pszUri,
+		_In_ const ProbeSource& fnProbe,
+		_In_ const OpenAdaptiveSource& fnOpenAdaptive,
+		_Out_ SourceType* pType);
+
+	// MIME type of an HTTP response, parameters (";codecs=...") are ignored
+	static SourceType ClassifyContentType(_In_ const wchar_t* pszContentType);
+
+	// Recognizes manifests and containers by their first bytes
+	static SourceType SniffContent(_In_ const BYTE* pData, _In_ UINT32 size);
+
+	// True for http and https, the only schemes worth probing
+	static bool IsHttpUri(_In_ const wchar_t* pszUri);
+
+	// Lower case scheme://host/directory/*.extension, query and fragment are dropped
+	static std::wstring GetUriPattern(_In_ const wchar_t* pszUri);
+
+private:
+	std::mutex m_lock;
+	CLruCache<std::wstring, SourceType> m_outcomes;
+};
@@ -0,0 +1,105 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "StateEventQueue.h"
+
+#include <string.h>
+
+
+CStateEventQueue::CStateEventQueue()
+	: m_hasPending(false)
+	, m_queuedEvents(0)
+	, m_deliveredEvents(0)
+	, m_coalescedEvents(0)
+	, m_droppedEvents(0)
+{
+	memset(&m_pending, 0, sizeof(m_pending));
+}
+
+_Use_decl_annotations_
+bool CStateEventQueue::Push(const PLAYBACK_STATE& playbackState)
+{
+	if (!m_queue.Push(playbackState))
+	{
+		m_droppedEvents.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	m_queuedEvents.fetch_add(1, std::memory_order_relaxed);
+
+	return true;
+}
+
+_Use_decl_annotations_
+HRESULT CStateEventQueue::Drain(PLAYBACK_STATE* pEvents, UINT32 capacity, UINT32* pCount)
+{
+	NULL_CHK(pCount);
+	if (capacity > 0)
+		NULL_CHK(pEvents);
+
+	*pCount = 0;
+
+	std::lock_guard<std::mutex> lock(m_drainLock);
+
+	UINT32 count = 0;
+	UINT64 coalesced = 0;
+	PLAYBACK_STATE next;
+
+	for (;;)
+	{
+		if (m_hasPending)
+		{
+			next = m_pending;
+			m_hasPending = false;
+		}
+		else if (!m_queue.Pop(&next))
+		{
+			break;
+		}
+
+		// a state change followed by another one is stale by the time the client sees it
+		if (count > 0 && next.type == StateType::StateType_StateChanged && pEvents[count - 1].type == StateType::StateType_StateChanged)
+		{
+			pEvents[count - 1] = next;
+			coalesced++;
+			continue;
+		}
+
+		if (count == capacity)
+		{
+			m_pending = next;
+			m_hasPending = true;
+			break;
+		}
+
+		pEvents[count++] = next;
+	}
+
+	m_deliveredEvents.fetch_add(count, std::memory_order_relaxed);
+	m_coalescedEvents.fetch_add(coalesced, std::memory_order_relaxed);
+
+	*pCount = count;
+
+	return m_hasPending ? S_FALSE : S_OK;
+}
+
+_Use_decl_annotations_
+void CStateEventQueue::GetStats(EVENT_QUEUE_STATS* pStats) const
+{
+	std::lock_guard<std::mutex> lock(m_drainLock);
+
+	pStats->capacity = m_queue.GetCapacity();
+	pStats->depth = m_queue.GetDepth() + (m_hasPending ? 1 : 0);
+	pStats->queuedEvents = m_queuedEvents.load(std::memory_order_relaxed);
+	pStats->deliveredEvents = m_deliveredEvents.load(std::memory_order_relaxed);
+	pStats->coalescedEvents = m_coalescedEvents.load(std::memory_order_relaxed);
+	pStats->droppedEvents = m_droppedEvents.load(std::memory_order_relaxed);
+}
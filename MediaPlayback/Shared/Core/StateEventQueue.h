@@ -0,0 +1,54 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Per player queue of PLAYBACK_STATE records for clients that poll instead of registering a StateChangedCallback.
+// Media pipeline threads push without blocking; the game loop drains everything once per frame with a single call.
+// Consecutive StateChanged records are merged while draining, only the latest one is delivered.
+
+#include "EventQueue.h"
+#include "PlaybackTypes.h"
+
+#include <atomic>
+#include <mutex>
+
+#define _StateEventQueueCapacity_ 64
+
+
+class CStateEventQueue
+{
+public:
+	CStateEventQueue();
+
+	// Any thread. Returns false and counts a dropped event if the queue is full.
+	bool Push(_In_ const PLAYBACK_STATE& playbackState);
+
+	// Copies up to capacity records in the order they were pushed. Returns S_FALSE when more records are waiting.
+	HRESULT Drain(
+		_Out_writes_to_(capacity, *pCount) PLAYBACK_STATE* pEvents,
+		_In_ UINT32 capacity,
+		_Out_ UINT32* pCount);
+
+	void GetStats(_Out_ EVENT_QUEUE_STATS* pStats) const;
+
+private:
+	CEventQueue<PLAYBACK_STATE, _StateEventQueueCapacity_> m_queue;
+
+	mutable std::mutex m_drainLock;		// keeps the queue single consumer if several threads drain
+	PLAYBACK_STATE m_pending;			// popped while looking for a StateChanged to merge, delivered first next time
+	bool m_hasPending;
+
+	std::atomic<UINT64> m_queuedEvents;
+	std::atomic<UINT64> m_deliveredEvents;
+	std::atomic<UINT64> m_coalescedEvents;
+	std::atomic<UINT64> m_droppedEvents;
+};
@@ -0,0 +1,113 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Seqlock protected PLAYBACK_STATUS, written by the media threads and read in place by the client.
+//
+// Writers make the sequence odd, update the fields and make it even again. Readers copy the block and retry
+// if the sequence was odd or has changed meanwhile, so they never block a writer and never see a torn update.
+// The block lives as long as its owner and never moves, the client keeps the pointer GetShared() returns.
+//
+// Managed readers follow the same protocol: read sequence, memory barrier, read fields, memory barrier, read sequence.
+
+#include "PlaybackTypes.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+// Playback.cs reads the block by offset
+static_assert(offsetof(PLAYBACK_STATUS, bufferedRanges) == 32 && offsetof(PLAYBACK_STATUS, droppedFrames) == 168, "PLAYBACK_STATUS layout is mirrored in Playback.cs");
+
+
+class CStatusBlock
+{
+public:
+	CStatusBlock()
+	{
+		memset(&m_status, 0, sizeof(m_status));
+	}
+
+	// fnUpdate(PLAYBACK_STATUS&) modifies the block in place and must not touch the sequence. Writers are serialized.
+	template <typename TUpdate>
+	void Update(_In_ const TUpdate& fnUpdate)
+	{
+		std::lock_guard<std::mutex> lock(m_writeLock);
+
+		UINT32 sequence = LoadSequence(&m_status);
+
+		StoreSequence(sequence + 1);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		fnUpdate(m_status);
+
+		std::atomic_thread_fence(std::memory_order_release);
+		StoreSequence(sequence + 2);
+	}
+
+	// Back to "no media"; the frame counters keep counting across items
+	void Reset()
+	{
+		Update([](PLAYBACK_STATUS& status)
+		{
+			status.state = PlaybackState::PlaybackState_None;
+			status.position = 0;
+			status.duration = 0;
+			status.bitrate = 0;
+			status.bufferedRangeCount = 0;
+			memset(status.bufferedRanges, 0, sizeof(status.bufferedRanges));
+		});
+	}
+
+	// Consistent copy of the block
+	void Read(_Out_ PLAYBACK_STATUS* pStatus) const
+	{
+		Read(&m_status, pStatus);
+	}
+
+	// Consistent copy of a block the client got from GetShared(), what a native client does instead of the managed protocol
+	static void Read(_In_ const PLAYBACK_STATUS* pShared, _Out_ PLAYBACK_STATUS* pStatus)
+	{
+		for (;;)
+		{
+			UINT32 before = LoadSequence(pShared);
+			if ((before & 1) == 0)
+			{
+				std::atomic_thread_fence(std::memory_order_acquire);
+				memcpy(pStatus, pShared, sizeof(PLAYBACK_STATUS));
+				std::atomic_thread_fence(std::memory_order_acquire);
+
+				if (LoadSequence(pShared) == before)
+					return;
+			}
+
+			std::this_thread::yield();
+		}
+	}
+
+	const PLAYBACK_STATUS* GetShared() const { return &m_status; }
+
+private:
+	CStatusBlock(const CStatusBlock&);
+	CStatusBlock& operator=(const CStatusBlock&);
+
+	// the sequence is part of the POD the client reads, so it is accessed as an aligned volatile 32-bit value
+	static UINT32 LoadSequence(_In_ const PLAYBACK_STATUS* pStatus) { return *static_cast<const volatile UINT32*>(&pStatus->sequence); }
+	void StoreSequence(_In_ UINT32 sequence) { *static_cast<volatile UINT32*>(&m_status.sequence) = sequence; }
+
+private:
+	PLAYBACK_STATUS m_status;
+	std::mutex m_writeLock;
+};
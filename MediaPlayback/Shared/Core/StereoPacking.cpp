@@ -0,0 +1,110 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "StereoPacking.h"
+
+#include <string.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define STEREO_PACKING_SSE2
+#elif defined(_M_ARM) || defined(_M_ARM64) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define STEREO_PACKING_NEON
+#endif
+
+
+_Use_decl_annotations_
+void CopyPixelRow(const BYTE* pSource, BYTE* pDestination, UINT32 pixelCount)
+{
+	size_t size = (size_t)pixelCount * 4;
+	size_t offset = 0;
+
+	// 4 x 16 bytes per iteration, unaligned loads and stores (rows of odd widths are not 16 byte aligned)
+#if defined(STEREO_PACKING_SSE2)
+	for (; offset + 64 <= size; offset += 64)
+	{
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + offset));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + offset + 16));
+		__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + offset + 32));
+		__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + offset + 48));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + offset), a);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + offset + 16), b);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + offset + 32), c);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + offset + 48), d);
+	}
+#elif defined(STEREO_PACKING_NEON)
+	for (; offset + 64 <= size; offset += 64)
+	{
+		uint8x16_t a = vld1q_u8(pSource + offset);
+		uint8x16_t b = vld1q_u8(pSource + offset + 16);
+		uint8x16_t c = vld1q_u8(pSource + offset + 32);
+		uint8x16_t d = vld1q_u8(pSource + offset + 48);
+		vst1q_u8(pDestination + offset, a);
+		vst1q_u8(pDestination + offset + 16, b);
+		vst1q_u8(pDestination + offset + 32, c);
+		vst1q_u8(pDestination + offset + 48, d);
+	}
+#endif
+
+	if (offset < size)
+	{
+		memcpy(pDestination + offset, pSource + offset, size - offset);
+	}
+}
+
+_Use_decl_annotations_
+HRESULT PackStereoOverUnder(const BYTE* pSource, UINT32 sourcePitch, UINT32 width, UINT32 height, StereoPacking packing, BYTE* pDestination, UINT32 destinationPitch)
+{
+	NULL_CHK(pSource);
+	NULL_CHK(pDestination);
+
+	if (!width || !height)
+		return E_INVALIDARG;
+
+	switch (packing)
+	{
+	case StereoPacking::StereoPacking_SideBySide:
+	{
+		UINT32 eyeWidth = width / 2;
+		if (!eyeWidth || sourcePitch < width * 4 || destinationPitch < eyeWidth * 4)
+			return E_INVALIDARG;
+
+		// every source row holds a left and a right eye row; they go to the top and the bottom half
+		BYTE* pRightEye = pDestination + (size_t)destinationPitch * height;
+		for (UINT32 y = 0; y < height; y++)
+		{
+			const BYTE* pRow = pSource + (size_t)sourcePitch * y;
+			CopyPixelRow(pRow, pDestination + (size_t)destinationPitch * y, eyeWidth);
+			CopyPixelRow(pRow + (size_t)eyeWidth * 4, pRightEye + (size_t)destinationPitch * y, eyeWidth);
+		}
+
+		return S_OK;
+	}
+
+	case StereoPacking::StereoPacking_TopBottom:
+	{
+		// already over/under
+		if (sourcePitch < width * 4 || destinationPitch < width * 4)
+			return E_INVALIDARG;
+
+		for (UINT32 y = 0; y < height; y++)
+		{
+			CopyPixelRow(pSource + (size_t)sourcePitch * y, pDestination + (size_t)destinationPitch * y, width);
+		}
+
+		return S_OK;
+	}
+
+	default:
+		return E_INVALIDARG;
+	}
+}
@@ -0,0 +1,44 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// CPU reference of the stereo layout the plugin hands to Unity: both eyes stacked over/under in one 32bpp frame.
+// The D3D11 path gets the same result on the GPU (eyes decoded into the slices of a texture array, copied into
+// the halves of the frame texture); this one is used by the software backend and to check the GPU output.
+
+#include "PlaybackTypes.h"
+
+// Mirrors ABI::Windows::Media::MediaProperties::StereoscopicVideoPackingMode
+enum class StereoPacking : UINT32
+{
+	StereoPacking_None = 0,
+	StereoPacking_SideBySide,
+	StereoPacking_TopBottom
+};
+
+// Copies a packed stereo frame of width x height 32bpp pixels into pDestination as over/under (left eye on top).
+// The destination holds one eye width and twice one eye height: (width / 2) x (2 * height) for side by side,
+// width x height for top/bottom. Rows must not overlap.
+HRESULT PackStereoOverUnder(
+	_In_ const BYTE* pSource,
+	_In_ UINT32 sourcePitch,
+	_In_ UINT32 width,
+	_In_ UINT32 height,
+	_In_ StereoPacking packing,
+	_Out_ BYTE* pDestination,
+	_In_ UINT32 destinationPitch);
+
+// Row copy used by the packing, SSE2 or NEON where available
+void CopyPixelRow(
+	_In_ const BYTE* pSource,
+	_Out_ BYTE* pDestination,
+	_In_ UINT32 pixelCount);
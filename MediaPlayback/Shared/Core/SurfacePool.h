@@ -0,0 +1,166 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Pool of video surfaces that are not in use, keyed by (width, height, format, stereo).
+//
+// When the video size changes (adaptive bitrate switch, new content) the player recycles its surfaces into the pool
+// and acquires the ones for the new size, so switching back and forth between renditions does not reallocate.
+// Pooled surfaces are kept in least recently recycled order; the oldest ones are destroyed once the pooled bytes
+// exceed the budget. Surfaces in use are not counted against the budget.
+//
+// TSurface is whatever a player allocates per video size (a set of D3D11 textures, a CPU buffer, ...);
+// it must be movable and release its resources when destroyed. Thread safe.
+
+#include "PlaybackTypes.h"
+
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <utility>
+
+#define _DefaultSurfacePoolBudget_ (256ULL * 1024 * 1024)
+
+
+typedef struct _SURFACE_POOL_KEY
+{
+	UINT32 width;
+	UINT32 height;
+	UINT32 format;				// FrameFormat the surface was asked for, the backend may have fallen back
+	bool isStereoscopic;
+
+	bool operator==(const _SURFACE_POOL_KEY& other) const
+	{
+		return width == other.width && height == other.height && format == other.format && isStereoscopic == other.isStereoscopic;
+	}
+} SURFACE_POOL_KEY;
+
+
+template <typename TSurface>
+class CSurfacePool
+{
+public:
+	explicit CSurfacePool(_In_ UINT64 budgetBytes = _DefaultSurfacePoolBudget_)
+		: m_budgetBytes(budgetBytes)
+		, m_pooledBytes(0)
+		, m_hits(0)
+		, m_misses(0)
+		, m_evictions(0)
+	{
+	}
+
+	// Hands out a pooled surface for the key, or calls fnCreate(const SURFACE_POOL_KEY&, TSurface*) for a new one
+	template <typename TCreate>
+	HRESULT Acquire(_In_ const SURFACE_POOL_KEY& key, _In_ const TCreate& fnCreate, _Out_ TSurface* pSurface)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+
+			for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+			{
+				if (it->key == key)
+				{
+					*pSurface = std::move(it->surface);
+					m_pooledBytes -= it->sizeBytes;
+					m_entries.erase(it);
+					m_hits++;
+
+					return S_OK;
+				}
+			}
+
+			m_misses++;
+		}
+
+		// allocations can be slow, do not hold up other players
+		return fnCreate(key, pSurface);
+	}
+
+	// Keeps a surface that is no longer in use; sizeBytes is what it counts against the budget
+	void Recycle(_In_ const SURFACE_POOL_KEY& key, _Inout_ TSurface&& surface, _In_ UINT64 sizeBytes)
+	{
+		EntryList evicted;
+
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+
+			ENTRY entry = { key, std::move(surface), sizeBytes };
+			m_entries.push_front(std::move(entry));
+			m_pooledBytes += sizeBytes;
+
+			Trim(&evicted);
+		}
+
+		// evicted surfaces are destroyed here, outside of the lock
+	}
+
+	void SetBudget(_In_ UINT64 budgetBytes)
+	{
+		EntryList evicted;
+
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_budgetBytes = budgetBytes;
+		Trim(&evicted);
+	}
+
+	// Destroys every pooled surface, e.g. when the device they belong to goes away
+	void Clear()
+	{
+		EntryList evicted;
+
+		std::lock_guard<std::mutex> lock(m_lock);
+		evicted.swap(m_entries);
+		m_pooledBytes = 0;
+	}
+
+	void GetStats(_Out_ SURFACE_POOL_STATS* pStats) const
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		pStats->pooledSurfaces = (UINT32)m_entries.size();
+		pStats->pooledBytes = m_pooledBytes;
+		pStats->budgetBytes = m_budgetBytes;
+		pStats->hits = m_hits;
+		pStats->misses = m_misses;
+		pStats->evictions = m_evictions;
+	}
+
+private:
+	typedef struct _ENTRY
+	{
+		SURFACE_POOL_KEY key;
+		TSurface surface;
+		UINT64 sizeBytes;
+	} ENTRY;
+
+	typedef std::list<ENTRY> EntryList;
+
+	// Called with m_lock held; moves the least recently recycled surfaces over the budget to pEvicted
+	void Trim(_Inout_ EntryList* pEvicted)
+	{
+		while (m_pooledBytes > m_budgetBytes && !m_entries.empty())
+		{
+			m_pooledBytes -= m_entries.back().sizeBytes;
+			pEvicted->splice(pEvicted->end(), m_entries, std::prev(m_entries.end()));
+			m_evictions++;
+		}
+	}
+
+private:
+	mutable std::mutex m_lock;
+	EntryList m_entries;		// most recently recycled first
+	UINT64 m_budgetBytes;
+	UINT64 m_pooledBytes;
+	UINT64 m_hits;
+	UINT64 m_misses;
+	UINT64 m_evictions;
+};
@@ -0,0 +1,509 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ThumbnailAtlas.h"
+#include "FileSystem.h"
+#include "KeyframeIndex.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <sstream>
+
+#define _AtlasHeader_ "# MediaPlayback thumbnail atlas 1"
+#define _SourcePrefix_ "source "
+
+
+CThumbnailAtlas::CThumbnailAtlas()
+{
+	memset(&m_info, 0, sizeof(m_info));
+}
+
+_Use_decl_annotations_
+HRESULT CThumbnailAtlas::Initialize(UINT32 tileWidth, UINT32 tileHeight, INT64 interval, INT64 duration)
+{
+	if (tileWidth == 0 || tileHeight == 0 || tileWidth > _MaxThumbnailAtlasSize_ || tileHeight > _MaxThumbnailAtlasSize_ ||
+		interval <= 0 || duration <= 0)
+	{
+		return E_INVALIDARG;
+	}
+
+	UINT32 maxColumns = _MaxThumbnailAtlasSize_ / tileWidth;
+	UINT32 maxRows = _MaxThumbnailAtlasSize_ / tileHeight;
+	UINT64 maxTiles = (UINT64)maxColumns * maxRows;
+
+	// long sources get previews further apart rather than an atlas no texture can hold
+	UINT64 tileCount = (UINT64)((duration + interval - 1) / interval);
+	if (tileCount > maxTiles)
+	{
+		interval = (duration + (INT64)maxTiles - 1) / (INT64)maxTiles;
+		tileCount = (UINT64)((duration + interval - 1) / interval);
+	}
+
+	// as square as the tiles allow, so the texture stays small in both directions
+	UINT32 columns = 1;
+	while (columns < maxColumns && (UINT64)columns * tileWidth < ((tileCount + columns - 1) / columns) * tileHeight)
+	{
+		columns++;
+	}
+
+	UINT32 rows = (UINT32)((tileCount + columns - 1) / columns);
+
+	memset(&m_info, 0, sizeof(m_info));
+	m_info.tileWidth = tileWidth;
+	m_info.tileHeight = tileHeight;
+	m_info.columns = columns;
+	m_info.tileCount = (UINT32)tileCount;
+	m_info.width = columns * tileWidth;
+	m_info.height = rows * tileHeight;
+	m_info.interval = interval;
+
+	// transparent until decoded
+	m_pixels.assign((size_t)m_info.width * m_info.height * 4, 0);
+	m_readyTiles.assign(m_info.tileCount, false);
+
+	return S_OK;
+}
+
+BYTE* CThumbnailAtlas::GetTilePixels(UINT32 index)
+{
+	UINT32 x = (index % m_info.columns) * m_info.tileWidth;
+	UINT32 y = (index / m_info.columns) * m_info.tileHeight;
+
+	return m_pixels.data() + ((size_t)y * m_info.width + x) * 4;
+}
+
+void CThumbnailAtlas::MarkReady(UINT32 index)
+{
+	if (!m_readyTiles[index])
+	{
+		m_readyTiles[index] = true;
+		m_info.readyCount++;
+	}
+}
+
+_Use_decl_annotations_
+HRESULT CThumbnailAtlas::SetTile(UINT32 index, const BYTE* pFrame, UINT32 width, UINT32 height, UINT32 pitch)
+{
+	NULL_CHK(pFrame);
+
+	if (index >= m_info.tileCount || width == 0 || height == 0 || pitch < width * 4)
+		return E_INVALIDARG;
+
+	// fit into the tile, the bars stay transparent
+	UINT32 fitWidth = m_info.tileWidth;
+	UINT32 fitHeight = (UINT32)std::max<UINT64>(1, (UINT64)height * m_info.tileWidth / width);
+	if (fitHeight > m_info.tileHeight)
+	{
+		fitHeight = m_info.tileHeight;
+		fitWidth = (UINT32)std::max<UINT64>(1, (UINT64)width * m_info.tileHeight / height);
+	}
+
+	UINT32 offsetX = (m_info.tileWidth - fitWidth) / 2;
+	UINT32 offsetY = (m_info.tileHeight - fitHeight) / 2;
+	BYTE* pTile = GetTilePixels(index);
+
+	for (UINT32 y = 0; y < m_info.tileHeight; y++)
+	{
+		memset(pTile + (size_t)y * m_info.width * 4, 0, (size_t)m_info.tileWidth * 4);
+	}
+
+	// box filter, every source pixel counts once
+	for (UINT32 y = 0; y < fitHeight; y++)
+	{
+		UINT32 sourceTop = (UINT32)((UINT64)y * height / fitHeight);
+		UINT32 sourceBottom = std::max(sourceTop + 1, (UINT32)((UINT64)(y + 1) * height / fitHeight));
+
+		BYTE* pRow = pTile + ((size_t)(offsetY + y) * m_info.width + offsetX) * 4;
+		for (UINT32 x = 0; x < fitWidth; x++)
+		{
+			UINT32 sourceLeft = (UINT32)((UINT64)x * width / fitWidth);
+			UINT32 sourceRight = std::max(sourceLeft + 1, (UINT32)((UINT64)(x + 1) * width / fitWidth));
+
+			UINT64 sum[3] = {};
+			for (UINT32 sy = sourceTop; sy < sourceBottom; sy++)
+			{
+				const BYTE* pSource = pFrame + (size_t)sy * pitch + (size_t)sourceLeft * 4;
+				for (UINT32 sx = sourceLeft; sx < sourceRight; sx++, pSource += 4)
+				{
+					sum[0] += pSource[0];
+					sum[1] += pSource[1];
+					sum[2] += pSource[2];
+				}
+			}
+
+			UINT64 count = (UINT64)(sourceBottom - sourceTop) * (sourceRight - sourceLeft);
+			pRow[x * 4 + 0] = (BYTE)(sum[0] / count);
+			pRow[x * 4 + 1] = (BYTE)(sum[1] / count);
+			pRow[x * 4 + 2] = (BYTE)(sum[2] / count);
+			pRow[x * 4 + 3] = 0xFF;
+		}
+	}
+
+	MarkReady(index);
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CThumbnailAtlas::CopyTile(UINT32 from, UINT32 to)
+{
+	if (from >= m_info.tileCount || to >= m_info.tileCount || !m_readyTiles[from])
+		return E_INVALIDARG;
+
+	const BYTE* pFrom = GetTilePixels(from);
+	BYTE* pTo = GetTilePixels(to);
+	for (UINT32 y = 0; y < m_info.tileHeight; y++)
+	{
+		memcpy(pTo + (size_t)y * m_info.width * 4, pFrom + (size_t)y * m_info.width * 4, (size_t)m_info.tileWidth * 4);
+	}
+
+	MarkReady(to);
+
+	return S_OK;
+}
+
+static std::string EscapeSourceKey(const std::wstring& sourceKey)
+{
+	// paths and URIs may be anything, keep the header one ASCII line
+	std::string escaped;
+	for (wchar_t c : sourceKey)
+	{
+		if (c >= 0x20 && c < 0x7F && c != '\\')
+		{
+			escaped.push_back((char)c);
+		}
+		else
+		{
+			char code[16] = {};
+			snprintf(code, sizeof(code), "\\%x;", (unsigned int)c);
+			escaped += code;
+		}
+	}
+
+	return escaped;
+}
+
+static std::string GetAtlasHeader(const THUMBNAIL_ATLAS_INFO& info, const std::wstring& sourceKey)
+{
+	std::ostringstream header;
+	header << _AtlasHeader_ << "\n" << _SourcePrefix_ << EscapeSourceKey(sourceKey) << "\n";
+	header << info.tileWidth << " " << info.tileHeight << " " << info.columns << " " << info.tileCount << " " << info.interval << "\n";
+
+	return header.str();
+}
+
+_Use_decl_annotations_
+HRESULT CThumbnailAtlas::Load(const std::wstring& path, const std::wstring& sourceKey)
+{
+	if (m_info.tileCount == 0)
+		return E_ILLEGAL_METHOD_CALL;
+
+	std::vector<BYTE> data;
+	if (FAILED(ReadWholeFile(path, &data)))
+		return S_FALSE;
+
+	// written for another source, layout or version of the plugin, extract again
+	std::string expected = GetAtlasHeader(m_info, sourceKey);
+	if (data.size() != expected.size() + m_pixels.size() || memcmp(data.data(), expected.data(), expected.size()) != 0)
+		return S_FALSE;
+
+	memcpy(m_pixels.data(), data.data() + expected.size(), m_pixels.size());
+	m_readyTiles.assign(m_info.tileCount, true);
+	m_info.readyCount = m_info.tileCount;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CThumbnailAtlas::Save(const std::wstring& path, const std::wstring& sourceKey) const
+{
+	if (m_info.tileCount == 0 || m_info.readyCount != m_info.tileCount)
+		return E_ILLEGAL_METHOD_CALL;
+
+	std::string header = GetAtlasHeader(m_info, sourceKey);
+
+	std::vector<BYTE> data(header.begin(), header.end());
+	data.insert(data.end(), m_pixels.begin(), m_pixels.end());
+
+	// other players of the same source may read it meanwhile
+	std::wstring tempPath = path + L".tmp";
+	IFR(WriteWholeFile(tempPath, data.data(), data.size()));
+
+	HRESULT hr = CommitFile(tempPath, path);
+	if (FAILED(hr))
+		RemoveFile(tempPath);
+
+	return hr;
+}
+
+
+_Use_decl_annotations_
+std::vector<UINT32> GetThumbnailOrder(UINT32 tileCount)
+{
+	std::vector<UINT32> order;
+	order.reserve(tileCount);
+
+	UINT32 stride = 1;
+	while (stride <= tileCount / 2)
+	{
+		stride *= 2;
+	}
+
+	// each pass halves the gaps the previous ones left
+	std::vector<bool> added(tileCount, false);
+	for (; stride > 0; stride /= 2)
+	{
+		for (UINT32 i = 0; i < tileCount; i += stride)
+		{
+			if (!added[i])
+			{
+				added[i] = true;
+				order.push_back(i);
+			}
+		}
+	}
+
+	return order;
+}
+
+
+struct CThumbnailExtractor::Extraction
+{
+	std::shared_ptr<IThumbnailDecoder> spDecoder;
+	std::shared_ptr<const CKeyframeIndex> spKeyframeIndex;
+	std::wstring sourceKey;
+	std::wstring cachePath;
+	UINT32 tileWidth;
+	UINT32 tileHeight;
+	INT64 interval;
+
+	std::atomic<bool> stopped;
+	HRESULT hrOpen;							// S_FALSE while opening
+
+	// worker only
+	bool opened;
+	std::vector<UINT32> order;
+	size_t nextTile;
+	std::map<INT64, UINT32> decodedTiles;	// keyframe position, first tile showing it
+	std::vector<BYTE> frame;
+
+	std::mutex lock;
+	CThumbnailAtlas atlas;
+};
+
+_Use_decl_annotations_
+CThumbnailExtractor::CThumbnailExtractor(SubmitTask fnSubmit)
+	: m_fnSubmit(fnSubmit)
+{
+}
+
+CThumbnailExtractor::~CThumbnailExtractor()
+{
+	Stop();
+}
+
+_Use_decl_annotations_
+HRESULT CThumbnailExtractor::Start(
+	const std::shared_ptr<IThumbnailDecoder>& spDecoder,
+	const std::wstring& sourceKey,
+	UINT32 tileWidth,
+	UINT32 tileHeight,
+	INT64 interval,
+	const std::shared_ptr<const CKeyframeIndex>& spKeyframeIndex,
+	const std::wstring& cachePath)
+{
+	NULL_CHK(spDecoder.get());
+
+	if (tileWidth == 0 || tileHeight == 0 || tileWidth > _MaxThumbnailAtlasSize_ || tileHeight > _MaxThumbnailAtlasSize_ || interval <= 0)
+		return E_INVALIDARG;
+
+	Stop();
+
+	std::shared_ptr<Extraction> spExtraction = std::make_shared<Extraction>();
+	spExtraction->spDecoder = spDecoder;
+	spExtraction->spKeyframeIndex = spKeyframeIndex;
+	spExtraction->sourceKey = sourceKey;
+	spExtraction->cachePath = cachePath;
+	spExtraction->tileWidth = tileWidth;
+	spExtraction->tileHeight = tileHeight;
+	spExtraction->interval = interval;
+	spExtraction->stopped = false;
+	spExtraction->hrOpen = S_FALSE;
+	spExtraction->opened = false;
+	spExtraction->nextTile = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_spExtraction = spExtraction;
+	}
+
+	SubmitTask fnSubmit = m_fnSubmit;
+	HRESULT hr = fnSubmit([fnSubmit, spExtraction]() { RunNext(fnSubmit, spExtraction); });
+	if (FAILED(hr))
+		Stop();
+
+	return hr;
+}
+
+void CThumbnailExtractor::Stop()
+{
+	std::shared_ptr<Extraction> spExtraction;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		spExtraction.swap(m_spExtraction);
+	}
+
+	// the task running finishes its tile, the decoder goes with the last task holding it
+	if (spExtraction)
+		spExtraction->stopped = true;
+}
+
+_Use_decl_annotations_
+HRESULT CThumbnailExtractor::GetInfo(THUMBNAIL_ATLAS_INFO* pInfo)
+{
+	NULL_CHK(pInfo);
+
+	memset(pInfo, 0, sizeof(THUMBNAIL_ATLAS_INFO));
+
+	std::shared_ptr<Extraction> spExtraction;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		spExtraction = m_spExtraction;
+	}
+
+	if (!spExtraction)
+		return E_ILLEGAL_METHOD_CALL;
+
+	std::lock_guard<std::mutex> lock(spExtraction->lock);
+	*pInfo = spExtraction->atlas.GetInfo();
+
+	return spExtraction->hrOpen;
+}
+
+_Use_decl_annotations_
+HRESULT CThumbnailExtractor::CopyPixels(BYTE* pBuffer, UINT32 size, THUMBNAIL_ATLAS_INFO* pInfo)
+{
+	NULL_CHK(pBuffer);
+	NULL_CHK(pInfo);
+
+	memset(pInfo, 0, sizeof(THUMBNAIL_ATLAS_INFO));
+
+	std::shared_ptr<Extraction> spExtraction;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		spExtraction = m_spExtraction;
+	}
+
+	if (!spExtraction)
+		return E_ILLEGAL_METHOD_CALL;
+
+	std::lock_guard<std::mutex> lock(spExtraction->lock);
+
+	// the layout is only known once the source is open
+	if (spExtraction->hrOpen != S_OK)
+		return spExtraction->hrOpen;
+
+	const std::vector<BYTE>& pixels = spExtraction->atlas.GetPixels();
+
+	if (size < pixels.size())
+		return E_NOT_SUFFICIENT_BUFFER;
+
+	memcpy(pBuffer, pixels.data(), pixels.size());
+	*pInfo = spExtraction->atlas.GetInfo();
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+void CThumbnailExtractor::RunNext(const SubmitTask& fnSubmit, const std::shared_ptr<Extraction>& spExtraction)
+{
+	if (spExtraction->stopped)
+		return;
+
+	bool more = spExtraction->opened ? DecodeNextTile(spExtraction.get()) : OpenSource(spExtraction.get());
+	if (!more || spExtraction->stopped)
+		return;
+
+	// one tile per task, extractions of other players get their turn in between; a failed submit (shutdown) ends it
+	std::shared_ptr<Extraction> spNext(spExtraction);
+	fnSubmit([fnSubmit, spNext]() { RunNext(fnSubmit, spNext); });
+}
+
+_Use_decl_annotations_
+bool CThumbnailExtractor::OpenSource(Extraction* pExtraction)
+{
+	INT64 duration = 0;
+	CThumbnailAtlas atlas;
+
+	// live sources have no duration to lay the tiles out for
+	HRESULT hr = pExtraction->spDecoder->Open(&duration);
+	if (SUCCEEDED(hr))
+		hr = atlas.Initialize(pExtraction->tileWidth, pExtraction->tileHeight, pExtraction->interval, duration);
+
+	bool cached = SUCCEEDED(hr) && !pExtraction->cachePath.empty() && atlas.Load(pExtraction->cachePath, pExtraction->sourceKey) == S_OK;
+
+	pExtraction->order = GetThumbnailOrder(atlas.GetInfo().tileCount);
+	pExtraction->opened = true;
+
+	std::lock_guard<std::mutex> lock(pExtraction->lock);
+	pExtraction->atlas = std::move(atlas);
+	pExtraction->hrOpen = FAILED(hr) ? hr : S_OK;
+
+	return SUCCEEDED(hr) && !cached;
+}
+
+_Use_decl_annotations_
+bool CThumbnailExtractor::DecodeNextTile(Extraction* pExtraction)
+{
+	if (pExtraction->nextTile >= pExtraction->order.size())
+		return false;
+
+	UINT32 tile = pExtraction->order[pExtraction->nextTile++];
+	INT64 interval = pExtraction->atlas.GetInfo().interval;	// only changed by OpenSource, on this thread
+	INT64 position = (INT64)tile * interval;
+
+	// tiles between sparse keyframes show the same frame, it is decoded once
+	if (pExtraction->spKeyframeIndex)
+		position = pExtraction->spKeyframeIndex->FindSeekPosition(position, SeekMode::SeekMode_PreviousKeyframe);
+
+	auto decoded = pExtraction->decodedTiles.find(position);
+	if (decoded != pExtraction->decodedTiles.end())
+	{
+		std::lock_guard<std::mutex> lock(pExtraction->lock);
+		pExtraction->atlas.CopyTile(decoded->second, tile);
+	}
+	else
+	{
+		UINT32 width = 0, height = 0;
+		// a tile that does not decode stays transparent, the ones after it may still decode
+		HRESULT hr = pExtraction->spDecoder->DecodeFrame(position, &pExtraction->frame, &width, &height);
+		if (SUCCEEDED(hr) && pExtraction->frame.size() >= (size_t)width * height * 4)
+		{
+			std::lock_guard<std::mutex> lock(pExtraction->lock);
+			if (SUCCEEDED(pExtraction->atlas.SetTile(tile, pExtraction->frame.data(), width, height, width * 4)))
+				pExtraction->decodedTiles[position] = tile;
+		}
+	}
+
+	if (pExtraction->nextTile < pExtraction->order.size())
+		return true;
+
+	// atlases with holes are extracted again next time rather than cached
+	std::lock_guard<std::mutex> lock(pExtraction->lock);
+	if (!pExtraction->cachePath.empty() && pExtraction->atlas.GetInfo().readyCount == pExtraction->atlas.GetInfo().tileCount)
+		pExtraction->atlas.Save(pExtraction->cachePath, pExtraction->sourceKey);
+
+	return false;
+}
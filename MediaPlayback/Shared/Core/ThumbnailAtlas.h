@@ -0,0 +1,135 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Seek preview thumbnails of a source, downscaled into one BGRA sprite atlas the scrubbing UI samples from.
+//
+// CThumbnailAtlas is the layout, the downscaling and the on-disk form of an atlas. CThumbnailExtractor fills one in
+// the background: one keyframe per tile, decoded by an IThumbnailDecoder of the platform, a tile per worker task so
+// the extractions of several players take turns. Tiles are decoded coarse to fine (every 8th tile first, then the
+// ones in between, ...) so the whole timeline has previews early.
+
+#include "CorePlatform.h"
+#include "PlaybackTypes.h"
+#include "WorkerPool.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define _MaxThumbnailAtlasSize_ 4096		// texture size every Unity target handles
+
+
+class CKeyframeIndex;
+
+class CThumbnailAtlas
+{
+public:
+	CThumbnailAtlas();
+
+	// Lays out the tiles for the duration; the interval grows if their count does not fit into the max atlas size
+	HRESULT Initialize(_In_ UINT32 tileWidth, _In_ UINT32 tileHeight, _In_ INT64 interval, _In_ INT64 duration);
+
+	const THUMBNAIL_ATLAS_INFO& GetInfo() const { return m_info; }
+	const std::vector<BYTE>& GetPixels() const { return m_pixels; }
+	bool IsTileReady(_In_ UINT32 index) const { return index < m_readyTiles.size() && m_readyTiles[index]; }
+
+	// Downscales a BGRA frame into the tile, letterboxed to keep its aspect ratio
+	HRESULT SetTile(
+		_In_ UINT32 index,
+		_In_reads_(pitch * height) const BYTE* pFrame,
+		_In_ UINT32 width,
+		_In_ UINT32 height,
+		_In_ UINT32 pitch);
+
+	// For tiles showing the same keyframe as a decoded one
+	HRESULT CopyTile(_In_ UINT32 from, _In_ UINT32 to);
+
+	// Complete atlases only. S_FALSE if the file is missing, damaged or holds another source or layout.
+	HRESULT Load(_In_ const std::wstring& path, _In_ const std::wstring& sourceKey);
+	HRESULT Save(_In_ const std::wstring& path, _In_ const std::wstring& sourceKey) const;
+
+private:
+	BYTE* GetTilePixels(_In_ UINT32 index);
+	void MarkReady(_In_ UINT32 index);
+
+	THUMBNAIL_ATLAS_INFO m_info;
+	std::vector<BYTE> m_pixels;
+	std::vector<bool> m_readyTiles;
+};
+
+
+// Tile indexes in the order they are decoded, coarse to fine
+std::vector<UINT32> GetThumbnailOrder(
+	_In_ UINT32 tileCount);
+
+
+// Decodes single frames for the extractor, only ever called on its worker
+struct IThumbnailDecoder
+{
+	virtual ~IThumbnailDecoder() {}
+
+	virtual HRESULT Open(_Out_ INT64* pDuration) = 0;
+
+	// BGRA, rows of width * 4 bytes; the first frame from the keyframe at or before position
+	virtual HRESULT DecodeFrame(
+		_In_ INT64 position,
+		_Inout_ std::vector<BYTE>* pFrame,
+		_Out_ UINT32* pWidth,
+		_Out_ UINT32* pHeight) = 0;
+};
+
+
+class CThumbnailExtractor
+{
+public:
+	typedef std::function<HRESULT(const CWorkerPool::Task& task)> SubmitTask;
+
+	explicit CThumbnailExtractor(_In_ SubmitTask fnSubmit);
+	~CThumbnailExtractor();
+
+	// Stops the extraction running, if any, and starts a new one. Without a keyframe index the decoder seeks to
+	// every tile time itself. A complete atlas of the same source and layout at cachePath (if not empty) is loaded
+	// instead of decoding, and a complete extraction is saved there.
+	HRESULT Start(
+		_In_ const std::shared_ptr<IThumbnailDecoder>& spDecoder,
+		_In_ const std::wstring& sourceKey,
+		_In_ UINT32 tileWidth,
+		_In_ UINT32 tileHeight,
+		_In_ INT64 interval,
+		_In_ const std::shared_ptr<const CKeyframeIndex>& spKeyframeIndex,
+		_In_ const std::wstring& cachePath);
+
+	// Tasks already queued return without decoding
+	void Stop();
+
+	// Zeroed and S_FALSE until the decoder has opened the source, the error if it failed to
+	HRESULT GetInfo(_Out_ THUMBNAIL_ATLAS_INFO* pInfo);
+
+	// size must hold width * height * 4 bytes of GetInfo
+	HRESULT CopyPixels(
+		_Out_writes_(size) BYTE* pBuffer,
+		_In_ UINT32 size,
+		_Out_ THUMBNAIL_ATLAS_INFO* pInfo);
+
+private:
+	struct Extraction;
+
+	static void RunNext(_In_ const SubmitTask& fnSubmit, _In_ const std::shared_ptr<Extraction>& spExtraction);
+	static bool OpenSource(_In_ Extraction* pExtraction);
+	static bool DecodeNextTile(_In_ Extraction* pExtraction);
+
+	SubmitTask m_fnSubmit;
+	std::shared_ptr<Extraction> m_spExtraction;
+	std::mutex m_lock;
+};
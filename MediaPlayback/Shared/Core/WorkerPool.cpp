@@ -0,0 +1,139 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "WorkerPool.h"
+
+
+CWorkerPool::CWorkerPool()
+	: m_shutdown(false)
+{
+}
+
+CWorkerPool::~CWorkerPool()
+{
+	Shutdown();
+}
+
+_Use_decl_annotations_
+HRESULT CWorkerPool::Start(UINT32 threadCount, Task fnThreadStart, Task fnThreadEnd)
+{
+	if (!threadCount)
+		return E_INVALIDARG;
+
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	if (!m_threads.empty() || m_shutdown)
+		return E_ILLEGAL_METHOD_CALL;
+
+	m_fnThreadStart = fnThreadStart;
+	m_fnThreadEnd = fnThreadEnd;
+
+	try
+	{
+		for (UINT32 i = 0; i < threadCount; i++)
+		{
+			m_threads.push_back(std::thread(&CWorkerPool::WorkerThread, this));
+		}
+	}
+	catch (...)
+	{
+		// keep whatever threads have been started
+		if (m_threads.empty())
+			return E_OUTOFMEMORY;
+	}
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CWorkerPool::Submit(Task task)
+{
+	if (!task)
+		return E_INVALIDARG;
+
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		if (m_shutdown || m_threads.empty())
+			return E_ILLEGAL_METHOD_CALL;
+
+		m_tasks.push_back(task);
+	}
+
+	m_taskAvailable.notify_one();
+
+	return S_OK;
+}
+
+void CWorkerPool::Shutdown()
+{
+	std::vector<std::thread> threads;
+
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		m_shutdown = true;
+		m_tasks.clear();
+		threads.swap(m_threads);
+	}
+
+	m_taskAvailable.notify_all();
+
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i].join();
+	}
+}
+
+UINT32 CWorkerPool::GetThreadCount() const
+{
+	return (UINT32)m_threads.size();
+}
+
+UINT32 CWorkerPool::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	return (UINT32)m_tasks.size();
+}
+
+void CWorkerPool::WorkerThread()
+{
+	if (m_fnThreadStart)
+		m_fnThreadStart();
+
+	for (;;)
+	{
+		Task task;
+
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
+			m_taskAvailable.wait(lock, [this]() { return m_shutdown || !m_tasks.empty(); });
+
+			if (m_shutdown)
+				break;
+
+			task = m_tasks.front();
+			m_tasks.pop_front();
+		}
+
+		try
+		{
+			task();
+		}
+		catch (...)
+		{
+			// a failing task must not take the pool down
+		}
+	}
+
+	if (m_fnThreadEnd)
+		m_fnThreadEnd();
+}
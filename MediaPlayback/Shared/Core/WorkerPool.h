@@ -0,0 +1,60 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Fixed size pool of worker threads running queued tasks in FIFO order.
+// Used for everything that must not run on Unity's main or render thread (source resolution, I/O).
+
+#include "CorePlatform.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+class CWorkerPool
+{
+public:
+	typedef std::function<void()> Task;
+
+	CWorkerPool();
+	~CWorkerPool();
+
+	// fnThreadStart/fnThreadEnd run on every worker thread, e.g. to initialize COM or lower the thread priority
+	HRESULT Start(
+		_In_ UINT32 threadCount,
+		_In_opt_ Task fnThreadStart = nullptr,
+		_In_opt_ Task fnThreadEnd = nullptr);
+
+	HRESULT Submit(_In_ Task task);
+
+	// Waits for the running tasks to finish, queued tasks are dropped. Must not be called from a worker thread.
+	void Shutdown();
+
+	UINT32 GetThreadCount() const;
+	UINT32 GetPendingCount();
+
+private:
+	void WorkerThread();
+
+private:
+	std::mutex m_lock;
+	std::condition_variable m_taskAvailable;
+	std::deque<Task> m_tasks;
+	std::vector<std::thread> m_threads;
+	Task m_fnThreadStart;
+	Task m_fnThreadEnd;
+	bool m_shutdown;
+};
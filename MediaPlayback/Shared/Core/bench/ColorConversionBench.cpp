@@ -0,0 +1,107 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ColorConversion.h"
+#include "CoreBench.h"
+
+#include <stdio.h>
+
+#include <vector>
+
+
+static const char* GetKernelName(_In_ ColorConversionKernel kernel)
+{
+	switch (kernel)
+	{
+	case ColorConversionKernel::ColorConversionKernel_SSE41: return "SSE4.1";
+	case ColorConversionKernel::ColorConversionKernel_AVX2: return "AVX2";
+	case ColorConversionKernel::ColorConversionKernel_NEON: return "NEON";
+	default: return "scalar";
+	}
+}
+
+// BGRA output of every kernel the CPU has, in GB/s of BGRA written, for 360 video frames: 1080p, 4K and 8K
+// (stereo frames are over/under, twice the height)
+CORE_BENCH(YuvToBgra)
+{
+	static const struct
+	{
+		const char* name;
+		UINT32 width;
+		UINT32 height;
+	} c_sizes[] =
+	{
+		{ "1080p", 1920, 1080 },
+		{ "4K", 3840, 2160 },
+		{ "4K over/under", 3840, 3840 },
+		{ "8K over/under", 7680, 7680 }
+	};
+
+	static const struct
+	{
+		const char* name;
+		YuvFormat format;
+	} c_formats[] = { { "NV12", YuvFormat::YuvFormat_NV12 }, { "P010", YuvFormat::YuvFormat_P010 } };
+
+	static const ColorConversionKernel c_kernels[] =
+	{
+		ColorConversionKernel::ColorConversionKernel_Scalar,
+		ColorConversionKernel::ColorConversionKernel_SSE41,
+		ColorConversionKernel::ColorConversionKernel_AVX2,
+		ColorConversionKernel::ColorConversionKernel_NEON
+	};
+
+	ColorConversionKernel selected = GetColorConversionKernel();
+
+	for (size_t s = 0; s < sizeof(c_sizes) / sizeof(c_sizes[0]); s++)
+	{
+		UINT32 width = c_sizes[s].width;
+		UINT32 height = c_sizes[s].height;
+		std::vector<BYTE> rgb((size_t)width * height * 4);
+
+		for (size_t f = 0; f < sizeof(c_formats) / sizeof(c_formats[0]); f++)
+		{
+			UINT32 sampleSize = (c_formats[f].format == YuvFormat::YuvFormat_P010) ? 2 : 1;
+			std::vector<BYTE> luma((size_t)width * height * sampleSize, 0x60);
+			std::vector<BYTE> chroma((size_t)width * (height / 2) * sampleSize, 0x80);
+
+			YUV_FRAME frame = {};
+			frame.format = c_formats[f].format;
+			frame.width = width;
+			frame.height = height;
+			frame.planes[0] = luma.data();
+			frame.planes[1] = chroma.data();
+			frame.pitches[0] = width * sampleSize;
+			frame.pitches[1] = width * sampleSize;
+
+			for (ColorConversionKernel kernel : c_kernels)
+			{
+				if (!IsColorConversionKernelSupported(kernel))
+					continue;
+				SetColorConversionKernel(kernel);
+
+				// about 2 GB of output per measurement in a full run
+				UINT64 frames = bench.Scale(2000000000ULL / rgb.size() + 1);
+
+				double start = CCoreBench::Seconds();
+				for (UINT64 i = 0; i < frames; i++)
+					ConvertYuvToRgb(frame, ColorMatrix::ColorMatrix_BT709, ColorRange::ColorRange_Limited, RgbFormat::RgbFormat_BGRA, rgb.data(), width * 4);
+				double elapsed = CCoreBench::Seconds() - start;
+
+				char metric[64];
+				snprintf(metric, sizeof(metric), "%s %s %s", c_sizes[s].name, c_formats[f].name, GetKernelName(kernel));
+				bench.Report(metric, (double)rgb.size() * frames / elapsed / 1e9, "GB/s");
+			}
+		}
+	}
+
+	SetColorConversionKernel(selected);
+}
@@ -0,0 +1,84 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Minimal benchmark harness of the core, nothing beyond the standard library.
+// CORE_BENCH defines a benchmark. It sizes its work with Scale, which is a small fraction of the full run
+// with --quick (what ctest runs, only to keep the benchmarks working), and prints its results with Report.
+// The runner (CoreBenchMain.cpp) runs every benchmark, or the ones whose name contains its argument.
+
+#include "PlaybackTypes.h"
+
+#include <algorithm>
+#include <vector>
+
+
+class CCoreBench;
+
+typedef void (*CoreBenchFunction)(CCoreBench& bench);
+
+typedef struct _CORE_BENCH_CASE
+{
+	const char* name;
+	CoreBenchFunction fnBench;
+} CORE_BENCH_CASE;
+
+std::vector<CORE_BENCH_CASE>& GetCoreBenchCases();
+
+class CCoreBench
+{
+public:
+	CCoreBench(_In_ const char* name, _In_ bool quick) : m_name(name), m_quick(quick) {}
+
+	bool IsQuick() const { return m_quick; }
+
+	// iterations of a full run, 1% of them (at least one) in a quick one
+	UINT64 Scale(_In_ UINT64 iterations) const { return m_quick ? std::max<UINT64>(1, iterations / 100) : iterations; }
+
+	void Report(_In_ const char* metric, _In_ double value, _In_ const char* unit);
+
+	// monotonic time in seconds
+	static double Seconds()
+	{
+		return (double)CoreNow() / 10000000.0;
+	}
+
+	// value at percentile (0-100) of the samples, which get sorted
+	static double Percentile(_Inout_ std::vector<double>& samples, _In_ double percentile)
+	{
+		if (samples.empty())
+			return 0.0;
+
+		std::sort(samples.begin(), samples.end());
+		size_t index = (size_t)(percentile / 100.0 * (samples.size() - 1) + 0.5);
+		return samples[std::min(index, samples.size() - 1)];
+	}
+
+private:
+	const char* m_name;
+	bool m_quick;
+};
+
+class CCoreBenchRegistrar
+{
+public:
+	CCoreBenchRegistrar(_In_ const char* name, _In_ CoreBenchFunction fnBench)
+	{
+		CORE_BENCH_CASE benchCase = { name, fnBench };
+		GetCoreBenchCases().push_back(benchCase);
+	}
+};
+
+#define CORE_BENCH(name) \
+	static void CoreBench_##name(CCoreBench& bench); \
+	static CCoreBenchRegistrar g_coreBenchRegistrar_##name(#name, CoreBench_##name); \
+	static void CoreBench_##name(CCoreBench& bench)
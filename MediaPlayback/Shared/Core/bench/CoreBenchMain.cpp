@@ -0,0 +1,58 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreBench.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+std::vector<CORE_BENCH_CASE>& GetCoreBenchCases()
+{
+	static std::vector<CORE_BENCH_CASE> benchCases;
+	return benchCases;
+}
+
+_Use_decl_annotations_
+void CCoreBench::Report(const char* metric, double value, const char* unit)
+{
+	printf("%-40s %-32s %14.3f %s\n", m_name, metric, value, unit);
+	fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+	bool quick = false;
+	const char* filter = nullptr;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--quick") == 0)
+			quick = true;
+		else
+			filter = argv[i];
+	}
+
+	int runCases = 0;
+
+	const std::vector<CORE_BENCH_CASE>& benchCases = GetCoreBenchCases();
+	for (size_t i = 0; i < benchCases.size(); i++)
+	{
+		if (filter != nullptr && strstr(benchCases[i].name, filter) == nullptr)
+			continue;
+
+		CCoreBench bench(benchCases[i].name, quick);
+		benchCases[i].fnBench(bench);
+		runCases++;
+	}
+
+	return runCases > 0 ? 0 : 1;
+}
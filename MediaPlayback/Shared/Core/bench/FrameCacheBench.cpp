@@ -0,0 +1,102 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreBench.h"
+#include "FrameCache.h"
+#include "SoftwarePlayer.h"
+
+#include <string>
+
+#define SECOND SOFTWARE_TICKS_PER_SECOND
+
+
+// Scrubbing as an editor does it: play a couple of seconds, pause, and seek back to random points of the last two
+// seconds a few times before playing on. The hit rate is that of the seeks back, by cache budget at 1080p.
+static void MeasureScrubbing(_In_ CCoreBench& bench, _In_ UINT64 budgetBytes)
+{
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"clip.mp4", MakeSoftwareMedia(1920, 1080, 60 * 60 * SECOND));
+	player.Initialize();
+	player.GetCore().SetFrameCacheBudget(budgetBytes);
+	player.GetCore().LoadContent(L"clip.mp4");
+	player.Run(TEST_FRAME_DURATION);
+
+	UINT32 random = 12345;
+	UINT64 rounds = bench.Scale(40);
+	std::vector<double> latencies;
+
+	FRAME_CACHE_STATS before = {};
+	player.GetCore().GetFrameCacheStats(&before);
+
+	for (UINT64 round = 0; round < rounds; round++)
+	{
+		player.GetCore().Play();
+		player.Run(2 * SECOND);
+		player.GetCore().Pause();
+
+		LONGLONG position = player.GetPosition();
+		for (int i = 0; i < 5; i++)
+		{
+			random = random * 1664525 + 1013904223;
+			LONGLONG target = position - (LONGLONG)(random >> 8) % (2 * SECOND);
+
+			double start = CCoreBench::Seconds();
+			player.GetCore().Seek(target);
+			latencies.push_back((CCoreBench::Seconds() - start) * 1e6);
+		}
+
+		player.GetCore().Seek(position);
+	}
+
+	FRAME_CACHE_STATS after = {};
+	player.GetCore().GetFrameCacheStats(&after);
+
+	UINT64 lookups = (after.hits - before.hits) + (after.misses - before.misses);
+
+	std::string name = std::to_string(budgetBytes >> 20) + "MB";
+	bench.Report((name + " hit rate").c_str(), lookups ? 100.0 * (after.hits - before.hits) / lookups : 0.0, "%");
+	bench.Report((name + " frames").c_str(), after.frames, "frames");
+	bench.Report((name + " seek p50").c_str(), CCoreBench::Percentile(latencies, 50), "us");
+}
+
+// Put and lookup of the cache itself, frames of 1080p size in a 256MB budget
+CORE_BENCH(FrameCacheOperations)
+{
+	CFrameCache<int> cache(256ULL * 1024 * 1024);
+	const UINT64 frameBytes = 1920ULL * 1080 * 4;
+
+	UINT64 frames = bench.Scale(1000000);
+	int reclaimed = 0;
+	UINT64 hits = 0;
+
+	double start = CCoreBench::Seconds();
+	for (UINT64 i = 0; i < frames; i++)
+	{
+		INT64 position = (INT64)i * TEST_FRAME_DURATION;
+		cache.Reclaim(position, frameBytes, &reclaimed);
+		cache.Put(position, TEST_FRAME_DURATION, (int)i, frameBytes);
+
+		int frame = 0;
+		if (cache.Lookup(position - 10 * TEST_FRAME_DURATION, &frame, nullptr))
+			hits++;
+	}
+	double seconds = CCoreBench::Seconds() - start;
+
+	bench.Report("put and lookup", seconds * 1e9 / frames, "ns");
+	bench.Report("lookup hit rate", 100.0 * hits / frames, "%");
+}
+
+CORE_BENCH(FrameCacheHitRate)
+{
+	MeasureScrubbing(bench, 64ULL * 1024 * 1024);
+	MeasureScrubbing(bench, 256ULL * 1024 * 1024);
+	MeasureScrubbing(bench, 512ULL * 1024 * 1024);
+}
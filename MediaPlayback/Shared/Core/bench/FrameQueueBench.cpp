@@ -0,0 +1,98 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreBench.h"
+#include "FrameQueue.h"
+
+#include <string.h>
+#include <thread>
+
+
+typedef struct _BENCH_FRAME
+{
+	double publishTime;
+	BYTE pixels[4096];
+} BENCH_FRAME;
+
+// Uncontended cost of a frame through the queue, both sides on one thread
+CORE_BENCH(PublishAcquire)
+{
+	CFrameQueue<BENCH_FRAME> queue;
+
+	UINT64 frames = bench.Scale(50000000);
+
+	double start = CCoreBench::Seconds();
+	for (UINT64 i = 0; i < frames; i++)
+	{
+		BENCH_FRAME* pSlot = queue.BeginWrite();
+		if (pSlot != nullptr)
+			queue.Publish(0);
+
+		queue.AcquireLatest();
+	}
+	double elapsed = CCoreBench::Seconds() - start;
+
+	bench.Report("per frame", elapsed * 1e9 / frames, "ns");
+}
+
+// Decoder thread publishing at 240 fps, render thread polling at 90 Hz like a headset: time from Publish to the
+// render thread taking the frame, and how many frames it never saw
+CORE_BENCH(PublishToPresentLatency)
+{
+	CFrameQueue<BENCH_FRAME> queue;
+	std::atomic<bool> stop(false);
+
+	std::thread producer([&]()
+	{
+		double next = CCoreBench::Seconds();
+		while (!stop)
+		{
+			BENCH_FRAME* pSlot = queue.BeginWrite();
+			if (pSlot != nullptr)
+			{
+				memset(pSlot->pixels, 0x80, sizeof(pSlot->pixels));
+				pSlot->publishTime = CCoreBench::Seconds();
+				queue.Publish();
+			}
+
+			next += 1.0 / 240;
+			while (CCoreBench::Seconds() < next && !stop)
+				std::this_thread::yield();
+		}
+	});
+
+	std::vector<double> latencies;
+	UINT64 ticks = bench.Scale(9000);
+
+	double nextTick = CCoreBench::Seconds();
+	for (UINT64 tick = 0; tick < ticks; tick++)
+	{
+		nextTick += 1.0 / 90;
+		while (CCoreBench::Seconds() < nextTick)
+			std::this_thread::yield();
+
+		bool isNew = false;
+		BENCH_FRAME* pSlot = queue.AcquireLatest(&isNew);
+		if (isNew)
+			latencies.push_back(CCoreBench::Seconds() - pSlot->publishTime);
+	}
+
+	stop = true;
+	producer.join();
+
+	FRAME_QUEUE_STATS stats = {};
+	queue.GetStats(&stats);
+
+	bench.Report("p50 latency", CCoreBench::Percentile(latencies, 50) * 1e6, "us");
+	bench.Report("p99 latency", CCoreBench::Percentile(latencies, 99) * 1e6, "us");
+	bench.Report("presented", (double)stats.presentedFrames, "frames");
+	bench.Report("dropped", (double)stats.droppedFrames, "frames");
+}
@@ -0,0 +1,139 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ContainerBuilder.h"
+#include "CoreBench.h"
+#include "FrameScheduler.h"
+#include "SoftwarePlayer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#define TRICK_PLAY_TICK (SOFTWARE_TICKS_PER_SECOND / 60)
+
+
+// Two hours at 60 fps with a keyframe every two seconds
+static std::shared_ptr<const CKeyframeIndex> MakeKeyframeIndex()
+{
+	MP4_TRACK_TABLES tables;
+	tables.timescale = 60000;
+	tables.timeToSample = { { 2 * 60 * 60 * 60, 1000 } };
+	tables.sampleCount = 2 * 60 * 60 * 60;
+	tables.editMediaTime = -1;
+	for (UINT32 sample = 1; sample <= tables.sampleCount; sample += 120)
+		tables.syncSamples.push_back(sample);
+
+	ContainerBytes file = MakeProgressiveMp4(tables);
+	CMemorySource source(file);
+
+	std::shared_ptr<CKeyframeIndex> spIndex = std::make_shared<CKeyframeIndex>();
+	spIndex->Build(&source);
+
+	return spIndex;
+}
+
+// Render ticks of trick play from the middle of the file, the frame of each seek arriving by the next tick
+static void MeasureTrickPlay(_In_ CCoreBench& bench, _In_ const std::shared_ptr<const CKeyframeIndex>& spIndex, _In_ DOUBLE rate)
+{
+	CFrameScheduler scheduler;
+	scheduler.SetKeyframeIndex(spIndex);
+	scheduler.SetDuration(2 * 60 * 60 * SOFTWARE_TICKS_PER_SECOND);
+	scheduler.SetRate(rate);
+
+	UINT64 ticks = bench.Scale(1000000);
+	UINT64 seeks = 0;
+	INT64 now = 0;
+
+	double start = CCoreBench::Seconds();
+	while (ticks > 0)
+	{
+		// passes of 50000 ticks, under an hour of media at x4, from the middle of the file
+		scheduler.Start(60 * 60 * SOFTWARE_TICKS_PER_SECOND, now);
+
+		for (UINT64 i = 0; i < 50000 && i < ticks; i++)
+		{
+			now += TRICK_PLAY_TICK;
+
+			INT64 target = 0;
+			if (scheduler.GetNextTarget(now, &target))
+			{
+				scheduler.OnFrame(target);
+				seeks++;
+			}
+		}
+
+		ticks -= std::min<UINT64>(ticks, 50000);
+	}
+	double seconds = CCoreBench::Seconds() - start;
+
+	UINT64 total = bench.Scale(1000000);
+	FRAME_SCHEDULER_STATS stats;
+	scheduler.GetStats(&stats);
+
+	std::string name = (rate > 0) ? "forward x" : "reverse x";
+	name += std::to_string((int)std::fabs(rate));
+	bench.Report((name + " tick").c_str(), seconds * 1e9 / total, "ns");
+	bench.Report((name + " seeks").c_str(), (double)seeks * 1000 / total, "/1000 ticks");
+	bench.Report((name + " skipped keyframes").c_str(), (double)stats.skippedKeyframes / (seeks ? seeks : 1), "/seek");
+}
+
+// Steps back and forth over the frames just played, with the frame cache serving them or without it. The software
+// session fills a frame rather than decoding a group of pictures, so the uncached steps are the cheapest a seek gets;
+// the difference is what the cache costs over that.
+static void MeasureSteps(_In_ CCoreBench& bench, _In_ UINT64 cacheBudget, _In_ const char* pszName)
+{
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"clip.mp4", MakeSoftwareMedia(256, 144, 60 * SOFTWARE_TICKS_PER_SECOND));
+	player.Initialize();
+	player.GetCore().SetFrameCacheBudget(cacheBudget);
+	player.GetCore().LoadContent(L"clip.mp4");
+	player.Run(TEST_FRAME_DURATION);
+	player.GetCore().Play();
+	player.Run(SOFTWARE_TICKS_PER_SECOND);
+	player.GetCore().Pause();
+
+	FRAME_CACHE_STATS before = {};
+	player.GetCore().GetFrameCacheStats(&before);
+
+	UINT64 steps = bench.Scale(20000);
+	std::vector<double> latencies;
+	latencies.reserve((size_t)steps);
+
+	for (UINT64 i = 0; i < steps; i++)
+	{
+		double start = CCoreBench::Seconds();
+		player.GetCore().StepFrame((i % 2) ? 1 : -1);
+		latencies.push_back((CCoreBench::Seconds() - start) * 1e6);
+	}
+
+	FRAME_CACHE_STATS after = {};
+	player.GetCore().GetFrameCacheStats(&after);
+
+	std::string name(pszName);
+	bench.Report((name + " step p50").c_str(), CCoreBench::Percentile(latencies, 50), "us");
+	bench.Report((name + " step p99").c_str(), CCoreBench::Percentile(latencies, 99), "us");
+	bench.Report((name + " hit rate").c_str(), 100.0 * (after.hits - before.hits) / steps, "%");
+}
+
+CORE_BENCH(TrickPlayTick)
+{
+	std::shared_ptr<const CKeyframeIndex> spIndex = MakeKeyframeIndex();
+
+	MeasureTrickPlay(bench, spIndex, 4.0);
+	MeasureTrickPlay(bench, spIndex, -4.0);
+}
+
+CORE_BENCH(StepFrame)
+{
+	MeasureSteps(bench, 64 * 1024 * 1024, "cached");
+	MeasureSteps(bench, 0, "uncached");
+}
@@ -0,0 +1,84 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ContainerBuilder.h"
+#include "CoreBench.h"
+#include "KeyframeIndex.h"
+
+
+// Two hours at 60 frames per second, a keyframe every two seconds
+#define BENCH_SAMPLES (2 * 3600 * 60)
+#define BENCH_GOP 120
+
+static void MeasureBuild(_In_ CCoreBench& bench, _In_ const ContainerBytes& file, _In_ const char* pszName)
+{
+	UINT64 builds = bench.Scale(200) + 1;
+	size_t keyframes = 0;
+	UINT32 reads = 0;
+
+	double start = CCoreBench::Seconds();
+	for (UINT64 i = 0; i < builds; i++)
+	{
+		CMemorySource source(file);
+		CKeyframeIndex index;
+		index.Build(&source);
+
+		keyframes = index.GetKeyframeTimes().size();
+		reads = source.GetReadCount();
+	}
+	double seconds = (CCoreBench::Seconds() - start) / builds;
+
+	std::string metric(pszName);
+	bench.Report((metric + " build").c_str(), seconds * 1e3, "ms");
+	bench.Report((metric + " keyframes").c_str(), (double)keyframes, "");
+	bench.Report((metric + " reads").c_str(), (double)reads, "");
+}
+
+// Opening a long progressive MP4 with stss and ctts, the common case for a local file
+CORE_BENCH(ProgressiveMp4)
+{
+	MP4_TRACK_TABLES tables;
+	tables.timescale = 60000;
+	tables.timeToSample = { { BENCH_SAMPLES, 1000 } };
+	tables.compositionOffsets = { { BENCH_SAMPLES, 2000 } };
+	tables.sampleCount = BENCH_SAMPLES;
+	tables.editMediaTime = 2000;
+	for (UINT32 sample = 1; sample <= BENCH_SAMPLES; sample += BENCH_GOP)
+		tables.syncSamples.push_back(sample);
+
+	MeasureBuild(bench, MakeProgressiveMp4(tables), "mp4");
+
+	// without stss every sample is a keyframe and nothing is listed
+	tables.syncSamples.clear();
+	MeasureBuild(bench, MakeProgressiveMp4(tables), "mp4 all sync");
+}
+
+CORE_BENCH(MatroskaCues)
+{
+	std::vector<UINT64> cueTimes;
+	for (UINT64 time = 0; time < 2 * 3600 * 1000; time += 2000)
+		cueTimes.push_back(time);
+
+	MeasureBuild(bench, MakeMatroska(1000000, cueTimes), "mkv");
+}
+
+// How quickly a file claiming billions of samples is turned away
+CORE_BENCH(HostileSampleCounts)
+{
+	MP4_TRACK_TABLES tables;
+	tables.timescale = 60000;
+	tables.timeToSample.assign(1000, std::make_pair(0xFFFFFFFFu, 1u));
+	tables.syncSamples = { 1, 0xFFFFFFFF };
+	tables.sampleCount = 0;
+	tables.editMediaTime = -1;
+
+	MeasureBuild(bench, MakeProgressiveMp4(tables), "hostile");
+}
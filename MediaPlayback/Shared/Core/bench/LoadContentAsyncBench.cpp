@@ -0,0 +1,64 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreBench.h"
+#include "SoftwarePlayer.h"
+
+#include <future>
+
+
+// Time the calling (Unity main) thread spends in a load, with sources that take 20ms to resolve like a manifest
+// fetched from a nearby server: LoadContent resolves on the caller, LoadContentAsync on the load workers
+CORE_BENCH(MainThreadStall)
+{
+	std::shared_ptr<CWorkerPool> spPool = std::make_shared<CWorkerPool>();
+	spPool->Start(2);
+
+	CSoftwarePlayer player;
+	SOFTWARE_MEDIA_DESCRIPTION media = MakeSoftwareMedia(256, 144, 10 * SOFTWARE_TICKS_PER_SECOND);
+	media.openBlockingTime = 20;
+	media.isAdaptive = true;
+	player.GetBackend()->RegisterMedia(L"http://localhost/stream.m3u8", media);
+	player.Initialize();
+	player.GetCore().SetLoadWorkerPool(spPool);
+
+	UINT64 loads = bench.Scale(100) + 1;
+
+	std::vector<double> syncStalls;
+	for (UINT64 i = 0; i < loads; i++)
+	{
+		double start = CCoreBench::Seconds();
+		player.GetCore().LoadContent(L"http://localhost/stream.m3u8");
+		syncStalls.push_back(CCoreBench::Seconds() - start);
+	}
+
+	std::vector<double> asyncStalls;
+	for (UINT64 i = 0; i < loads; i++)
+	{
+		UINT32 requestId = 0;
+
+		double start = CCoreBench::Seconds();
+		player.GetCore().LoadContentAsync(L"http://localhost/stream.m3u8", &requestId);
+		asyncStalls.push_back(CCoreBench::Seconds() - start);
+
+		// one load at a time, like a player switching clips
+		std::promise<void> done;
+		spPool->Submit([&done]() { done.set_value(); });
+		done.get_future().wait();
+	}
+
+	bench.Report("LoadContent p50 stall", CCoreBench::Percentile(syncStalls, 50) * 1e3, "ms");
+	bench.Report("LoadContent max stall", CCoreBench::Percentile(syncStalls, 100) * 1e3, "ms");
+	bench.Report("LoadContentAsync p50 stall", CCoreBench::Percentile(asyncStalls, 50) * 1e3, "ms");
+	bench.Report("LoadContentAsync max stall", CCoreBench::Percentile(asyncStalls, 100) * 1e3, "ms");
+
+	spPool->Shutdown();
+}
@@ -0,0 +1,88 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreBench.h"
+#include "SoftwarePlayer.h"
+
+
+static UINT64 GetFrameCounter(_In_ CSoftwarePlayer* pPlayer)
+{
+	const PLAYBACK_STATUS* pStatus = nullptr;
+	pPlayer->GetCore().GetPlaybackStatus(&pStatus);
+
+	return pStatus ? pStatus->frameCounter : 0;
+}
+
+// Plays loops of ten frames, one render step at a time. The seam gap is the wall clock between the last frame
+// before a wrap and the first after it, next to the gap between any two frames; missed frames are render steps
+// without a new frame.
+static void MeasureLoop(_In_ CCoreBench& bench, _In_ LONGLONG duration, _In_ LONGLONG start, _In_ LONGLONG end, _In_ const char* pszName)
+{
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"clip.mp4", MakeSoftwareMedia(256, 144, duration));
+	player.Initialize();
+	player.GetCore().SetFrameCacheBudget(0);
+	player.GetCore().LoadContent(L"clip.mp4");
+	player.Run(TEST_FRAME_DURATION);
+	player.GetCore().SetLoop(TRUE, start, end);
+	player.GetCore().Play();
+
+	// into the range before measuring
+	player.Run(start);
+
+	UINT32 loops = (UINT32)bench.Scale(5000) + 2;
+	UINT64 firstFrame = GetFrameCounter(&player);
+	UINT64 steps = 0;
+
+	std::vector<double> seamGaps;
+	std::vector<double> frameGaps;
+
+	LOOP_STATS stats = {};
+	player.GetCore().GetLoopStats(&stats);
+	UINT32 loopCount = stats.loopCount;
+
+	while (seamGaps.size() < loops)
+	{
+		double stepStart = CCoreBench::Seconds();
+		player.Run(TEST_FRAME_DURATION);
+		double stepSeconds = CCoreBench::Seconds() - stepStart;
+		steps++;
+
+		player.GetCore().GetLoopStats(&stats);
+		if (stats.loopCount != loopCount)
+		{
+			loopCount = stats.loopCount;
+			seamGaps.push_back(stats.lastLoopGap / 10.0);
+		}
+		else
+		{
+			frameGaps.push_back(stepSeconds * 1e6);
+		}
+	}
+
+	UINT64 frames = GetFrameCounter(&player) - firstFrame;
+
+	std::string name(pszName);
+	bench.Report((name + " seam gap p50").c_str(), CCoreBench::Percentile(seamGaps, 50), "us");
+	bench.Report((name + " seam gap p99").c_str(), CCoreBench::Percentile(seamGaps, 99), "us");
+	bench.Report((name + " frame gap p50").c_str(), CCoreBench::Percentile(frameGaps, 50), "us");
+	bench.Report((name + " missed frames").c_str(), (double)(steps > frames ? steps - frames : 0) / loops, "/loop");
+}
+
+CORE_BENCH(WholeFileLoop)
+{
+	MeasureLoop(bench, 10 * TEST_FRAME_DURATION, 0, 0, "whole file");
+}
+
+CORE_BENCH(RangeLoop)
+{
+	MeasureLoop(bench, 60 * SOFTWARE_TICKS_PER_SECOND, 20 * TEST_FRAME_DURATION, 30 * TEST_FRAME_DURATION, "range");
+}
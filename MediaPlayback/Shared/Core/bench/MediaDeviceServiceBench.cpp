@@ -0,0 +1,106 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreBench.h"
+#include "MediaDeviceService.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#define BENCH_CREATION_MS 20 // a video capable D3D11 device with its DXGI device manager
+
+
+// Factory as slow as creating the device on a graphics adapter
+class CSlowMediaDeviceFactory
+	: public CSoftwareMediaDeviceFactory
+{
+public:
+	virtual HRESULT CreateDevice(_In_ UINT64 adapterId, _Out_ std::shared_ptr<IMediaDevice>* pspDevice) override
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_CREATION_MS));
+
+		return CSoftwareMediaDeviceFactory::CreateDevice(adapterId, pspDevice);
+	}
+};
+
+
+static double GetDevicesCreated(_In_ CMediaDeviceService& service)
+{
+	MEDIA_DEVICE_STATS stats = {};
+	service.GetStats(&stats);
+
+	return (double)stats.devicesCreated;
+}
+
+// N players of one adapter starting at once, each creating a device of its own or acquiring the shared one; the time
+// is until the last of them has its device.
+static void MeasureStart(_In_ CCoreBench& bench, _In_ UINT32 playerCount, _In_ bool shared)
+{
+	CMediaDeviceService service(std::make_shared<CSlowMediaDeviceFactory>());
+
+	std::vector<std::shared_ptr<IMediaDevice>> devices(playerCount);
+	std::vector<std::thread> threads;
+
+	double start = CCoreBench::Seconds();
+	for (UINT32 i = 0; i < playerCount; i++)
+	{
+		threads.push_back(std::thread([&, i]()
+		{
+			// per player, each with a factory of its own the way they created their devices before
+			if (shared)
+				service.Acquire(1, &devices[i]);
+			else
+				CSlowMediaDeviceFactory().CreateDevice(1, &devices[i]);
+		}));
+	}
+
+	for (auto& thread : threads)
+		thread.join();
+	double elapsed = CCoreBench::Seconds() - start;
+
+	std::string name = std::to_string(playerCount) + (shared ? " shared" : " per player");
+	bench.Report((name + " start").c_str(), elapsed * 1e3, "ms");
+	bench.Report((name + " devices").c_str(), shared ? GetDevicesCreated(service) : (double)playerCount, "devices");
+}
+
+CORE_BENCH(MediaDeviceStart)
+{
+	const UINT32 playerCounts[] = { 1, 4, 16 };
+
+	for (UINT32 playerCount : playerCounts)
+	{
+		MeasureStart(bench, playerCount, false);
+		MeasureStart(bench, playerCount, true);
+	}
+}
+
+// A player on an adapter whose device is alive already, what every player after the first pays
+CORE_BENCH(MediaDeviceAcquire)
+{
+	CMediaDeviceService service(std::make_shared<CSoftwareMediaDeviceFactory>());
+
+	std::shared_ptr<IMediaDevice> spHeld;
+	service.Acquire(1, &spHeld);
+
+	UINT64 iterations = bench.Scale(1000000);
+
+	double start = CCoreBench::Seconds();
+	for (UINT64 i = 0; i < iterations; i++)
+	{
+		std::shared_ptr<IMediaDevice> spDevice;
+		service.Acquire(1, &spDevice);
+		service.Release(spDevice);
+	}
+	double elapsed = CCoreBench::Seconds() - start;
+
+	bench.Report("acquire and release", elapsed / iterations * 1e9, "ns");
+}
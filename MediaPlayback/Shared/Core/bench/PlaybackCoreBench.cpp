@@ -0,0 +1,105 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreBench.h"
+#include "SoftwarePlayer.h"
+
+#include <stdio.h>
+
+
+// Decoder event to surface copy to state callback, for one player with small frames so the copy does not dominate
+CORE_BENCH(FrameDelivery)
+{
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"clip.mp4", MakeSoftwareMedia(256, 144, 0));
+	player.Initialize();
+	player.GetCore().LoadContent(L"clip.mp4");
+	player.Run(TEST_FRAME_DURATION);
+	player.GetCore().Play();
+
+	UINT64 frames = bench.Scale(200000);
+
+	double start = CCoreBench::Seconds();
+	player.Run((LONGLONG)frames * TEST_FRAME_DURATION);
+	double elapsed = CCoreBench::Seconds() - start;
+
+	bench.Report("per frame", elapsed * 1e6 / frames, "us");
+}
+
+// Play/Pause round trips, each raising a StateChanged callback with the media description
+CORE_BENCH(StateChurn)
+{
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"clip.mp4", MakeSoftwareMedia(256, 144, 0));
+	player.Initialize();
+	player.GetCore().LoadContent(L"clip.mp4");
+	player.Run(TEST_FRAME_DURATION);
+
+	UINT64 iterations = bench.Scale(500000);
+
+	double start = CCoreBench::Seconds();
+	for (UINT64 i = 0; i < iterations; i++)
+	{
+		player.GetCore().Play();
+		player.GetCore().Pause();
+
+		// the recorder would grow without bound
+		if ((i & 0xFFF) == 0)
+			player.GetStates().Clear();
+	}
+	double elapsed = CCoreBench::Seconds() - start;
+
+	bench.Report("state changes", 2.0 * iterations / elapsed, "/s");
+}
+
+// Players sharing one backend, a render tick advances all of them by a frame and delivers it. The frame cache is off,
+// its default budget for hundreds of players would measure the memory of the machine.
+CORE_BENCH(MultiInstanceScaling)
+{
+	const UINT32 playerCounts[] = { 1, 8, 64, 256 };
+
+	for (size_t i = 0; i < sizeof(playerCounts) / sizeof(playerCounts[0]); i++)
+	{
+		std::shared_ptr<CSoftwarePlaybackBackend> spBackend = std::make_shared<CSoftwarePlaybackBackend>();
+		spBackend->RegisterMedia(L"clip.mp4", MakeSoftwareMedia(256, 144, 0));
+
+		std::vector<std::unique_ptr<CSoftwarePlayer>> players;
+		for (UINT32 j = 0; j < playerCounts[i]; j++)
+		{
+			players.emplace_back(new CSoftwarePlayer(spBackend));
+			players.back()->Initialize();
+			players.back()->GetCore().SetFrameCacheBudget(0);
+			players.back()->GetCore().LoadContent(L"clip.mp4");
+		}
+
+		spBackend->Advance(TEST_FRAME_DURATION);
+		for (size_t j = 0; j < players.size(); j++)
+		{
+			players[j]->GetCore().RenderEvent();
+			players[j]->GetCore().Play();
+		}
+
+		UINT64 ticks = bench.Scale(100000 / playerCounts[i] + 100);
+
+		double start = CCoreBench::Seconds();
+		for (UINT64 tick = 0; tick < ticks; tick++)
+		{
+			spBackend->Advance(TEST_FRAME_DURATION);
+			for (size_t j = 0; j < players.size(); j++)
+				players[j]->GetCore().RenderEvent();
+		}
+		double elapsed = CCoreBench::Seconds() - start;
+
+		char metric[64];
+		snprintf(metric, sizeof(metric), "%u players, per player tick", playerCounts[i]);
+		bench.Report(metric, elapsed * 1e6 / ticks / playerCounts[i], "us");
+	}
+}
@@ -0,0 +1,134 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreBench.h"
+#include "SoftwarePlayer.h"
+
+
+// Items of ten frames; a cold open takes three frames of virtual time
+#define BENCH_ITEM_FRAMES 10
+#define BENCH_OPEN_FRAMES 3
+
+static UINT64 GetFrameCounter(_In_ CSoftwarePlayer* pPlayer)
+{
+	const PLAYBACK_STATUS* pStatus = nullptr;
+	pPlayer->GetCore().GetPlaybackStatus(&pStatus);
+
+	return pStatus ? pStatus->frameCounter : 0;
+}
+
+static void Report(_In_ CCoreBench& bench, _In_ const char* pszName, _Inout_ std::vector<double>& latencies, _In_ double gapFrames)
+{
+	std::string name(pszName);
+	bench.Report((name + " latency p50").c_str(), CCoreBench::Percentile(latencies, 50), "us");
+	bench.Report((name + " latency p99").c_str(), CCoreBench::Percentile(latencies, 99), "us");
+	bench.Report((name + " gap").c_str(), gapFrames, "frames");
+}
+
+// Switches at the end of each item to the pre-rolled next one. Latency is wall clock from the end of an item to the
+// first frame of the next, the gap the render steps per switch that showed no new frame.
+CORE_BENCH(GaplessSwitch)
+{
+	SOFTWARE_MEDIA_DESCRIPTION media = MakeSoftwareMedia(256, 144, BENCH_ITEM_FRAMES * TEST_FRAME_DURATION);
+	media.openLatency = BENCH_OPEN_FRAMES * TEST_FRAME_DURATION;
+
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"item.mp4", media);
+	player.Initialize();
+	player.GetCore().SetFrameCacheBudget(0);
+
+	UINT32 switches = (UINT32)bench.Scale(2000) + 1;
+
+	UINT32 id = 0;
+	player.GetCore().PlaylistAppend(L"item.mp4", &id);
+	player.GetCore().PlaylistAppend(L"item.mp4", &id);
+	player.Run(BENCH_OPEN_FRAMES * TEST_FRAME_DURATION);
+	player.GetCore().Play();
+
+	std::vector<double> latencies;
+	UINT64 steps = 0;
+	UINT64 firstFrame = GetFrameCounter(&player);
+
+	for (UINT32 i = 0; i < switches; i++)
+	{
+		PLAYLIST_STATS stats = {};
+		player.GetCore().GetPlaylistStats(&stats);
+		UINT32 currentId = stats.currentItemId;
+
+		// the item after next, so there is always one to pre-roll
+		player.GetCore().PlaylistAppend(L"item.mp4", &id);
+
+		while (stats.currentItemId == currentId)
+		{
+			player.Run(TEST_FRAME_DURATION);
+			player.GetCore().GetPlaylistStats(&stats);
+			steps++;
+		}
+
+		// by now the previous switch has shown its first frame
+		if (i > 0)
+			latencies.push_back(stats.lastSwitchLatency / 10.0);
+
+		player.GetStates().Clear();
+	}
+
+	// every render step should have shown a frame of one item or the next
+	UINT64 frames = GetFrameCounter(&player) - firstFrame;
+	double gap = (double)(steps > frames ? steps - frames : 0) / switches;
+
+	Report(bench, "prerolled", latencies, gap);
+}
+
+// PlaylistNext to an item that has not opened yet: it is opened when due, the way LoadContent would
+CORE_BENCH(ColdSwitch)
+{
+	SOFTWARE_MEDIA_DESCRIPTION media = MakeSoftwareMedia(256, 144, 0);
+	media.openLatency = BENCH_OPEN_FRAMES * TEST_FRAME_DURATION;
+
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"item.mp4", media);
+	player.Initialize();
+	player.GetCore().SetFrameCacheBudget(0);
+
+	UINT32 switches = (UINT32)bench.Scale(2000) + 1;
+
+	UINT32 id = 0;
+	player.GetCore().PlaylistAppend(L"item.mp4", &id);
+	player.Run(BENCH_OPEN_FRAMES * TEST_FRAME_DURATION);
+	player.GetCore().Play();
+
+	std::vector<double> latencies;
+	UINT64 gapSteps = 0;
+
+	for (UINT32 i = 0; i < switches; i++)
+	{
+		player.Run(TEST_FRAME_DURATION);
+		player.GetCore().PlaylistAppend(L"item.mp4", &id);
+		player.GetCore().PlaylistNext();
+
+		UINT64 frames = GetFrameCounter(&player);
+		do
+		{
+			player.Run(TEST_FRAME_DURATION);
+			gapSteps++;
+		} while (GetFrameCounter(&player) == frames);
+
+		// the step that showed the first frame is not part of the gap
+		gapSteps--;
+
+		PLAYLIST_STATS stats = {};
+		player.GetCore().GetPlaylistStats(&stats);
+		latencies.push_back(stats.lastSwitchLatency / 10.0);
+		player.GetStates().Clear();
+	}
+
+	Report(bench, "cold", latencies, (double)gapSteps / switches);
+}
@@ -0,0 +1,173 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreBench.h"
+#include "RcuSnapshot.h"
+#include "SlotMap.h"
+#include "SoftwarePlayer.h"
+
+#include <stdio.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#define BENCH_TICK_SECONDS (1.0 / 90.0)
+#define BENCH_RESIDENT_PLAYERS 16
+
+
+typedef CSlotMap<CSoftwarePlayer*> BenchRegistry;
+
+static CSoftwarePlayer* CreatePlayer()
+{
+	CSoftwarePlayer* pPlayer = new CSoftwarePlayer();
+	pPlayer->Initialize();
+	pPlayer->GetCore().SetFrameCacheBudget(0);
+
+	return pPlayer;
+}
+
+// Registry behind one lock, taken by the render thread every tick like the mutex it replaced
+class CLockedRegistry
+{
+public:
+	void Add(_In_ CSoftwarePlayer* pPlayer, _Out_ BenchRegistry::Handle* pHandle)
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_registry.Insert(pPlayer, pHandle);
+	}
+
+	CSoftwarePlayer* Remove(_In_ BenchRegistry::Handle handle)
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		CSoftwarePlayer* pPlayer = *m_registry.Get(handle);
+		m_registry.Remove(handle);
+
+		return pPlayer;
+	}
+
+	void Tick()
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		for (CSoftwarePlayer* pPlayer : m_registry)
+			pPlayer->GetCore().RenderEvent();
+	}
+
+private:
+	std::mutex m_lock;
+	BenchRegistry m_registry;
+};
+
+class CRcuRegistry
+{
+public:
+	void Add(_In_ CSoftwarePlayer* pPlayer, _Out_ BenchRegistry::Handle* pHandle)
+	{
+		m_registry.Update([pPlayer, pHandle](BenchRegistry& registry) { return registry.Insert(pPlayer, pHandle); });
+	}
+
+	// the player is no longer reachable by the render thread once this returns
+	CSoftwarePlayer* Remove(_In_ BenchRegistry::Handle handle)
+	{
+		CSoftwarePlayer* pPlayer = nullptr;
+		m_registry.Update([handle, &pPlayer](BenchRegistry& registry)
+		{
+			pPlayer = *registry.Get(handle);
+			registry.Remove(handle);
+			return S_OK;
+		});
+
+		return pPlayer;
+	}
+
+	void Tick()
+	{
+		CRcuSnapshot<BenchRegistry>::CReadScope registry(m_registry);
+		for (CSoftwarePlayer* pPlayer : registry.Get())
+			pPlayer->GetCore().RenderEvent();
+	}
+
+private:
+	CRcuSnapshot<BenchRegistry> m_registry;
+};
+
+// Render thread ticking at 90 Hz over the registry while churn threads create and release players as fast as
+// they can; reports the render thread's tick latency
+template <typename TRegistry>
+static void MeasureTicks(_In_ CCoreBench& bench, _In_ const char* name, _In_ UINT32 churnThreads)
+{
+	TRegistry registry;
+	std::vector<CSoftwarePlayer*> resident;
+	for (UINT32 i = 0; i < BENCH_RESIDENT_PLAYERS; i++)
+	{
+		BenchRegistry::Handle handle = 0;
+		resident.push_back(CreatePlayer());
+		registry.Add(resident.back(), &handle);
+	}
+
+	std::atomic<bool> stop(false);
+	std::atomic<UINT64> churned(0);
+
+	std::vector<std::thread> threads;
+	for (UINT32 i = 0; i < churnThreads; i++)
+	{
+		threads.emplace_back([&]()
+		{
+			while (!stop)
+			{
+				BenchRegistry::Handle handle = 0;
+				registry.Add(CreatePlayer(), &handle);
+				delete registry.Remove(handle);
+				churned++;
+			}
+		});
+	}
+
+	UINT64 ticks = bench.Scale(900) + 10;
+	std::vector<double> latencies;
+
+	double next = CCoreBench::Seconds();
+	for (UINT64 tick = 0; tick < ticks; tick++)
+	{
+		while (CCoreBench::Seconds() < next)
+			std::this_thread::yield();
+		next += BENCH_TICK_SECONDS;
+
+		double start = CCoreBench::Seconds();
+		registry.Tick();
+		latencies.push_back(CCoreBench::Seconds() - start);
+	}
+
+	stop = true;
+	for (auto& thread : threads)
+		thread.join();
+
+	char metric[96];
+	snprintf(metric, sizeof(metric), "%s, %u churn threads, p50", name, churnThreads);
+	bench.Report(metric, CCoreBench::Percentile(latencies, 50) * 1e6, "us");
+	snprintf(metric, sizeof(metric), "%s, %u churn threads, p99", name, churnThreads);
+	bench.Report(metric, CCoreBench::Percentile(latencies, 99) * 1e6, "us");
+
+	for (CSoftwarePlayer* pPlayer : resident)
+		delete pPlayer;
+}
+
+CORE_BENCH(RenderTickUnderChurn)
+{
+	const UINT32 threadCounts[] = { 0, 2, 8 };
+
+	for (size_t i = 0; i < sizeof(threadCounts) / sizeof(threadCounts[0]); i++)
+	{
+		MeasureTicks<CLockedRegistry>(bench, "mutex", threadCounts[i]);
+		MeasureTicks<CRcuRegistry>(bench, "RCU", threadCounts[i]);
+	}
+}
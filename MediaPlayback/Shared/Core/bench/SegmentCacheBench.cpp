@@ -0,0 +1,116 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreBench.h"
+#include "SegmentCache.h"
+#include "TestDirectory.h"
+
+#include <stdio.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+
+// Two seconds of 720p at 3 Mbit/s
+#define BENCH_SEGMENT_SIZE (750 * 1024)
+
+static SEGMENT_KEY MakeKey(_In_ UINT64 segment)
+{
+	SEGMENT_KEY key;
+	key.uri = L"https://cdn.example.com/video/720p/segment" + std::to_wstring(segment) + L".m4s";
+	key.rangeOffset = 0;
+	key.rangeLength = 0;
+
+	return key;
+}
+
+// Write and read throughput of the cache itself: every segment stored once, then looked up and read through
+CORE_BENCH(StoreAndLookup)
+{
+	CTestDirectory directory;
+	CSegmentCache cache;
+	if (FAILED(cache.Open(directory.GetPath(), 1024ull * 1024 * 1024)))
+		return;
+
+	UINT64 segments = bench.Scale(400) + 2;
+	std::vector<BYTE> data(BENCH_SEGMENT_SIZE, 0x5a);
+
+	double start = CCoreBench::Seconds();
+	for (UINT64 i = 0; i < segments; i++)
+	{
+		data[0] = (BYTE)i;
+		cache.Store(MakeKey(i), L"\"v1\"", data.data(), data.size());
+	}
+	double storeSeconds = CCoreBench::Seconds() - start;
+
+	volatile UINT64 checksum = 0;
+	start = CCoreBench::Seconds();
+	for (UINT64 i = 0; i < segments; i++)
+	{
+		std::shared_ptr<CMappedSegment> spSegment;
+		if (cache.Lookup(MakeKey(i), L"\"v1\"", &spSegment) != S_OK)
+			continue;
+
+		// touch every page, as the demuxer would
+		const BYTE* pData = spSegment->GetData();
+		for (size_t offset = 0; offset < spSegment->GetSize(); offset += 4096)
+			checksum += pData[offset];
+	}
+	double lookupSeconds = CCoreBench::Seconds() - start;
+
+	double megabytes = (double)segments * BENCH_SEGMENT_SIZE / (1024.0 * 1024.0);
+	bench.Report("store", megabytes / storeSeconds, "MB/s");
+	bench.Report("lookup and read", megabytes / lookupSeconds, "MB/s");
+	bench.Report("lookup per segment", lookupSeconds / segments * 1e6, "us");
+}
+
+// Replaying a VOD title: the first pass fetches every segment over a network stand-in with 40ms of latency and
+// 20 Mbit/s of bandwidth and stores it, the second pass is served from the cache. Time to have each segment in
+// hand, the number a seek or a replay waits on.
+CORE_BENCH(ReplayFromCache)
+{
+	CTestDirectory directory;
+	CSegmentCache cache;
+	if (FAILED(cache.Open(directory.GetPath(), 1024ull * 1024 * 1024)))
+		return;
+
+	const double latencySeconds = 0.040;
+	const double bytesPerSecond = 20.0 * 1000 * 1000 / 8;
+
+	UINT64 segments = bench.Scale(60) + 2;
+	std::vector<BYTE> data(BENCH_SEGMENT_SIZE, 0x3c);
+
+	double fetchSeconds = 0;
+	double hitSeconds = 0;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		double start = CCoreBench::Seconds();
+		for (UINT64 i = 0; i < segments; i++)
+		{
+			std::shared_ptr<CMappedSegment> spSegment;
+			if (cache.Lookup(MakeKey(i), L"", &spSegment) == S_OK)
+				continue;
+
+			std::this_thread::sleep_for(std::chrono::duration<double>(latencySeconds + BENCH_SEGMENT_SIZE / bytesPerSecond));
+			cache.Store(MakeKey(i), L"", data.data(), data.size());
+		}
+		(pass == 0 ? fetchSeconds : hitSeconds) = CCoreBench::Seconds() - start;
+	}
+
+	bench.Report("network per segment", fetchSeconds / segments * 1000, "ms");
+	bench.Report("cached per segment", hitSeconds / segments * 1000, "ms");
+	bench.Report("speedup", fetchSeconds / hitSeconds, "x");
+
+	SEGMENT_CACHE_STATS stats;
+	cache.GetStats(&stats);
+	bench.Report("bytes saved", (double)stats.bytesSaved / (1024.0 * 1024.0), "MB");
+}
@@ -0,0 +1,98 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreBench.h"
+#include "SegmentPrefetcher.h"
+#include "ThrottledOrigin.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// 2s segments played 25 times faster than real time: 80ms to play 96KB, 16 Mbit/s of link and a 20ms round trip
+// take 68ms to download one. The link keeps up, a download on demand does not.
+#define BENCH_SEGMENT_SIZE (96 * 1024)
+#define BENCH_PLAY_MS 80
+#define BENCH_LATENCY_MS 20
+#define BENCH_BYTES_PER_SECOND (2.0 * 1024 * 1024)
+
+
+// ms the player waits for the segment
+static double RequestSegment(_In_ CSegmentPrefetcher& prefetcher, _In_ const SEGMENT_KEY& key)
+{
+	std::mutex lock;
+	std::condition_variable completed;
+	bool done = false;
+
+	double start = CCoreBench::Seconds();
+	HRESULT hr = prefetcher.Request(key, [&](HRESULT, const SegmentData&)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		done = true;
+		completed.notify_all();
+	});
+
+	if (hr != S_OK)
+		return 0;
+
+	std::unique_lock<std::mutex> guard(lock);
+	completed.wait(guard, [&done]() { return done; });
+
+	return (CCoreBench::Seconds() - start) * 1e3;
+}
+
+// A player asking for the segments of 720p one after the other as it plays them, switching to 1080p halfway
+static void MeasurePlayback(_In_ CCoreBench& bench, _In_ bool prefetch)
+{
+	CThrottledOrigin origin(BENCH_SEGMENT_SIZE, BENCH_LATENCY_MS, BENCH_BYTES_PER_SECOND);
+	CWorkerPool pool;
+	pool.Start(4);
+
+	size_t segments = (size_t)bench.Scale(100) + 3;
+
+	std::shared_ptr<CSegmentPrefetcher> spPrefetcher = std::make_shared<CSegmentPrefetcher>(
+		[&pool](const CWorkerPool::Task& task) { return pool.Submit(task); },
+		origin.GetFetch());
+	spPrefetcher->AddManifest(MakeSegmentManifest(segments));
+	spPrefetcher->SetWindow(prefetch ? 3 * TEST_SEGMENT_DURATION : 0, 2);
+
+	std::vector<double> stalls;
+	for (size_t i = 0; i < segments; i++)
+	{
+		const wchar_t* pszRepresentationId = (i < segments / 2) ? L"720p" : L"1080p";
+		stalls.push_back(RequestSegment(*spPrefetcher, MakeSegmentKey(pszRepresentationId, i)));
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_PLAY_MS));
+	}
+
+	SEGMENT_PREFETCH_STATS stats;
+	spPrefetcher->GetStats(&stats);
+	spPrefetcher->Close();
+	pool.Shutdown();
+
+	double stalled = 0;
+	for (double stall : stalls)
+		stalled += stall;
+
+	std::string name = prefetch ? "prefetch" : "on demand";
+	bench.Report((name + " stall p50").c_str(), CCoreBench::Percentile(stalls, 50), "ms");
+	bench.Report((name + " stall max").c_str(), CCoreBench::Percentile(stalls, 100), "ms");
+	bench.Report((name + " stalled").c_str(), stalled / (segments * BENCH_PLAY_MS) * 100, "% of play time");
+	bench.Report((name + " wasted").c_str(), (double)stats.bytesWasted / 1024, "KB");
+}
+
+CORE_BENCH(PrefetchOverCappedLink)
+{
+	MeasurePlayback(bench, false);
+	MeasurePlayback(bench, true);
+}
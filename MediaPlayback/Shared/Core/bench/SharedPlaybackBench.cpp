@@ -0,0 +1,84 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreBench.h"
+#include "SharedPlaybackBackend.h"
+#include "SoftwarePlayer.h"
+
+#include <string>
+
+
+// N players of one 720p clip, each decoding it or all sharing one decode. Every decoded frame costs the session 1ms of
+// CPU, a software H.264 decode of 720p; the time is the CPU time of a render tick for all of them. The decoder copies
+// per tick stand for the GPU work, the video processor blits frames out of the decoder on D3D11 as the session fills
+// them here.
+static void MeasurePlayers(_In_ CCoreBench& bench, _In_ UINT32 playerCount, _In_ bool shared)
+{
+	std::shared_ptr<CSoftwarePlaybackBackend> spBackend = std::make_shared<CSoftwarePlaybackBackend>();
+	SOFTWARE_MEDIA_DESCRIPTION media = MakeSoftwareMedia(1280, 720, 60 * 60 * SOFTWARE_TICKS_PER_SECOND);
+	media.decodeTime = 1000;
+	spBackend->RegisterMedia(L"clip.mp4", media);
+
+	std::shared_ptr<CSharedPlaybackBackend> spShared = std::make_shared<CSharedPlaybackBackend>(spBackend);
+	std::shared_ptr<IPlaybackBackend> spPlayerBackend = shared ? std::static_pointer_cast<IPlaybackBackend>(spShared) : spBackend;
+
+	std::vector<std::unique_ptr<CSoftwarePlayer>> players;
+	for (UINT32 i = 0; i < playerCount; i++)
+	{
+		players.push_back(std::unique_ptr<CSoftwarePlayer>(new CSoftwarePlayer(spBackend, spPlayerBackend)));
+		players.back()->Initialize();
+		players.back()->GetCore().SetFrameCacheBudget(0);
+		players.back()->GetCore().LoadContent(L"clip.mp4");
+	}
+
+	spBackend->Advance(TEST_FRAME_DURATION);
+	for (auto& spPlayer : players)
+	{
+		spPlayer->GetCore().RenderEvent();
+		spPlayer->GetCore().Play();
+	}
+
+	SHARED_SOURCE_STATS before = {};
+	spShared->GetStats(&before);
+
+	UINT64 ticks = bench.Scale(300);
+	std::vector<double> tickTimes;
+	tickTimes.reserve((size_t)ticks);
+
+	for (UINT64 tick = 0; tick < ticks; tick++)
+	{
+		double start = CCoreBench::Seconds();
+		spBackend->Advance(TEST_FRAME_DURATION);
+		for (auto& spPlayer : players)
+			spPlayer->GetCore().RenderEvent();
+		tickTimes.push_back((CCoreBench::Seconds() - start) * 1e6);
+	}
+
+	SHARED_SOURCE_STATS after = {};
+	spShared->GetStats(&after);
+
+	std::string name = std::to_string(playerCount) + (shared ? " shared" : " separate");
+	bench.Report((name + " tick p50").c_str(), CCoreBench::Percentile(tickTimes, 50), "us");
+	bench.Report((name + " decode sessions").c_str(), shared ? after.sources : playerCount, "sessions");
+	bench.Report((name + " decoder copies").c_str(),
+		shared ? (double)(after.decodedCopies - before.decodedCopies) / ticks : (double)playerCount, "/tick");
+}
+
+CORE_BENCH(SharedDecode)
+{
+	const UINT32 playerCounts[] = { 1, 2, 4, 8 };
+
+	for (UINT32 playerCount : playerCounts)
+	{
+		MeasurePlayers(bench, playerCount, false);
+		MeasurePlayers(bench, playerCount, true);
+	}
+}
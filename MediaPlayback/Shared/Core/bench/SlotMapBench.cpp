@@ -0,0 +1,132 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreBench.h"
+#include "SlotMap.h"
+#include "SoftwarePlayer.h"
+
+#include <memory>
+
+#define BENCH_LIVE_PLAYERS 16
+
+
+// A scene that created and destroyed thousands of players and keeps a few: the render event walks the registry
+// every frame. The slot map only holds the live players; the vector it replaced kept a null for every player
+// ever destroyed.
+CORE_BENCH(RenderEventAfterChurn)
+{
+	std::shared_ptr<CSoftwarePlaybackBackend> spBackend = std::make_shared<CSoftwarePlaybackBackend>();
+	spBackend->RegisterMedia(L"clip.mp4", MakeSoftwareMedia(256, 144, 0));
+
+	CSlotMap<CSoftwarePlayer*> registry;
+	std::vector<CSoftwarePlayer*> tombstones;
+
+	UINT64 destroyed = bench.Scale(10000) + BENCH_LIVE_PLAYERS;
+
+	double start = CCoreBench::Seconds();
+	for (UINT64 i = 0; i < destroyed + BENCH_LIVE_PLAYERS; i++)
+	{
+		CSoftwarePlayer* pPlayer = new CSoftwarePlayer(spBackend);
+		pPlayer->Initialize();
+		pPlayer->GetCore().SetFrameCacheBudget(0);
+
+		CSlotMap<CSoftwarePlayer*>::Handle handle = 0;
+		registry.Insert(pPlayer, &handle);
+		tombstones.push_back(pPlayer);
+
+		if (i < destroyed)
+		{
+			registry.Remove(handle);
+			tombstones.back() = nullptr;
+			delete pPlayer;
+		}
+	}
+	double churn = CCoreBench::Seconds() - start;
+
+	bench.Report("create and destroy", churn * 1e6 / (destroyed + BENCH_LIVE_PLAYERS), "us");
+
+	for (CSoftwarePlayer* pPlayer : registry)
+		pPlayer->GetCore().LoadContent(L"clip.mp4");
+
+	spBackend->Advance(TEST_FRAME_DURATION);
+	for (CSoftwarePlayer* pPlayer : registry)
+	{
+		pPlayer->GetCore().RenderEvent();
+		pPlayer->GetCore().Play();
+	}
+
+	UINT64 frames = bench.Scale(100000);
+
+	start = CCoreBench::Seconds();
+	for (UINT64 frame = 0; frame < frames; frame++)
+	{
+		for (CSoftwarePlayer* pPlayer : registry)
+			pPlayer->GetCore().RenderEvent();
+	}
+	double slotMapElapsed = CCoreBench::Seconds() - start;
+
+	start = CCoreBench::Seconds();
+	for (UINT64 frame = 0; frame < frames; frame++)
+	{
+		for (CSoftwarePlayer* pPlayer : tombstones)
+		{
+			if (pPlayer != nullptr)
+				pPlayer->GetCore().RenderEvent();
+		}
+	}
+	double tombstoneElapsed = CCoreBench::Seconds() - start;
+
+	bench.Report("registry entries, slot map", (double)registry.GetCount(), "");
+	bench.Report("registry entries, tombstone vector", (double)tombstones.size(), "");
+	bench.Report("render event, slot map", slotMapElapsed * 1e6 / frames, "us");
+	bench.Report("render event, tombstone vector", tombstoneElapsed * 1e6 / frames, "us");
+
+	for (CSoftwarePlayer* pPlayer : registry)
+		delete pPlayer;
+}
+
+// Handle validation on every export call: lookup of live handles and rejection of stale ones
+CORE_BENCH(HandleLookup)
+{
+	CSlotMap<UINT64> registry;
+	std::vector<CSlotMap<UINT64>::Handle> live;
+	std::vector<CSlotMap<UINT64>::Handle> stale;
+
+	for (UINT64 i = 0; i < 1024; i++)
+	{
+		CSlotMap<UINT64>::Handle handle = 0;
+		registry.Insert(i, &handle);
+		if (i % 2)
+		{
+			registry.Remove(handle);
+			stale.push_back(handle);
+		}
+		else
+		{
+			live.push_back(handle);
+		}
+	}
+
+	UINT64 lookups = bench.Scale(50000000);
+	UINT64 found = 0;
+
+	double start = CCoreBench::Seconds();
+	for (UINT64 i = 0; i < lookups; i++)
+	{
+		const std::vector<CSlotMap<UINT64>::Handle>& handles = (i & 1) ? stale : live;
+		if (registry.Get(handles[(i >> 1) % handles.size()]) != nullptr)
+			found++;
+	}
+	double elapsed = CCoreBench::Seconds() - start;
+
+	bench.Report("per lookup", elapsed * 1e9 / lookups, "ns");
+	bench.Report("live hits", (double)found * 100.0 / lookups, "%");
+}
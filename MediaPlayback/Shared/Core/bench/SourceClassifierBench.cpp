@@ -0,0 +1,136 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreBench.h"
+#include "SoftwarePlayer.h"
+#include "SourceClassifier.h"
+
+#include <stdio.h>
+
+#include <memory>
+
+#define BENCH_ROUND_TRIP_MS 20		// one HTTP request to a nearby server
+
+
+static const wchar_t* c_benchUris[] =
+{
+	L"c:\\videos\\clip.mp4",
+	L"https://cdn.example.com/clips/clip.mp4",
+	L"https://cdn.example.com/live/master.m3u8?token=abc",
+	L"https://cdn.example.com/play?id=42"
+};
+
+// What ClassifyUri costs in front of every load, the recorded outcome lookup included
+CORE_BENCH(ClassifyUri)
+{
+	CSourceClassifier classifier;
+	classifier.RecordOutcome(L"https://cdn.example.com/play?id=1", SourceType::SourceType_Adaptive);
+
+	UINT64 iterations = bench.Scale(2000000);
+	UINT32 adaptive = 0;
+
+	double start = CCoreBench::Seconds();
+	for (UINT64 i = 0; i < iterations; i++)
+	{
+		if (classifier.ClassifyUri(c_benchUris[i % (sizeof(c_benchUris) / sizeof(c_benchUris[0]))]) == SourceType::SourceType_Adaptive)
+			adaptive++;
+	}
+	double elapsed = CCoreBench::Seconds() - start;
+
+	bench.Report("per URI", elapsed * 1e9 / iterations, "ns");
+	bench.Report("adaptive", (double)adaptive * 100.0 / iterations, "%");
+}
+
+// Open to first frame through the software backend, every request its Open() makes the way CreateMediaSource does
+// costing a round trip (openBlockingTime). Speculative is the load path before the classifier: every remote URI got
+// an adaptive attempt first, a wasted request unless it was a manifest. Classified URIs go straight to the
+// constructor they need, unknown ones are probed, and a repeat open of their pattern is an LRU hit without the probe.
+static double OpenToFirstFrame(
+	_In_ const std::shared_ptr<CSoftwarePlaybackBackend>& spBackend,
+	_In_ const wchar_t* pszUri,
+	_Out_ UINT64* pRequests)
+{
+	CSoftwarePlayer player(spBackend);
+	player.Initialize();
+
+	UINT64 requests = spBackend->GetSourceRequests();
+	double start = CCoreBench::Seconds();
+
+	player.GetCore().LoadContent(pszUri);
+	player.GetCore().Play();
+	for (UINT32 i = 0; i < 30 && player.GetPresentedFrame() == 0; i++)
+		player.Run(TEST_FRAME_DURATION, TEST_FRAME_DURATION);
+
+	double elapsed = CCoreBench::Seconds() - start;
+	*pRequests = spBackend->GetSourceRequests() - requests;
+
+	return elapsed;
+}
+
+CORE_BENCH(OpenToFirstFrame)
+{
+	static const struct
+	{
+		const char* name;
+		const wchar_t* pszUri;
+		bool remote;
+		bool adaptive;
+		bool repeat;	// opened again on the same backend, the classifier remembers the pattern
+	} c_sources[] =
+	{
+		{ "local", L"c:\\videos\\clip.mp4", false, false, false },
+		{ "progressive", L"https://cdn.example.com/clips/clip.mp4", true, false, false },
+		{ "HLS", L"https://cdn.example.com/live/master.m3u8", true, true, false },
+		{ "unknown HLS first", L"https://cdn.example.com/play?id=42", true, true, false },
+		{ "unknown HLS repeat", L"https://cdn.example.com/play?id=42", true, true, true },
+		{ "unknown file first", L"https://files.example.com/get?id=7", true, false, false },
+		{ "unknown file repeat", L"https://files.example.com/get?id=7", true, false, true }
+	};
+
+	UINT64 opens = bench.Scale(200) + 1;
+
+	for (size_t source = 0; source < sizeof(c_sources) / sizeof(c_sources[0]); source++)
+	{
+		SOFTWARE_MEDIA_DESCRIPTION media = MakeSoftwareMedia(256, 144, 10 * SOFTWARE_TICKS_PER_SECOND);
+		media.openBlockingTime = c_sources[source].remote ? BENCH_ROUND_TRIP_MS : 0;
+		media.isAdaptive = c_sources[source].adaptive;
+
+		for (int classify = 0; classify < 2; classify++)
+		{
+			std::shared_ptr<CSoftwarePlaybackBackend> spBackend;
+			std::vector<double> samples;
+			UINT64 requests = 0;
+
+			for (UINT64 i = 0; i < opens; i++)
+			{
+				if (!spBackend || !c_sources[source].repeat)
+				{
+					spBackend = std::make_shared<CSoftwarePlaybackBackend>();
+					spBackend->SetClassifySources(classify != 0);
+					spBackend->RegisterMedia(c_sources[source].pszUri, media);
+
+					// the first open teaches the classifier, the repeats are measured
+					if (c_sources[source].repeat)
+						OpenToFirstFrame(spBackend, c_sources[source].pszUri, &requests);
+				}
+
+				samples.push_back(OpenToFirstFrame(spBackend, c_sources[source].pszUri, &requests));
+			}
+
+			char metric[64];
+			snprintf(metric, sizeof(metric), "%s %s p50", c_sources[source].name, classify ? "classified" : "speculative");
+			bench.Report(metric, CCoreBench::Percentile(samples, 50) * 1e3, "ms");
+
+			snprintf(metric, sizeof(metric), "%s %s requests", c_sources[source].name, classify ? "classified" : "speculative");
+			bench.Report(metric, (double)requests, "/open");
+		}
+	}
+}
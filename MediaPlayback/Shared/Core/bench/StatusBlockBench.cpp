@@ -0,0 +1,84 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreBench.h"
+#include "SoftwarePlayer.h"
+#include "StatusBlock.h"
+
+#include <atomic>
+#include <thread>
+
+
+// Reads per second of a playing player's time: one GetDurationAndPosition call per read, as Playback.cs polled,
+// against copying the status block it publishes. The block is read on its own and with a thread updating it.
+CORE_BENCH(StatusReads)
+{
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"clip.mp4", MakeSoftwareMedia(256, 144, 60 * SOFTWARE_TICKS_PER_SECOND));
+	player.Initialize();
+	player.GetCore().SetFrameCacheBudget(0);
+	player.GetCore().LoadContent(L"clip.mp4");
+	player.GetCore().Play();
+	player.Run(TEST_FRAME_DURATION * 2);
+
+	UINT64 reads = bench.Scale(20000000);
+	LONGLONG checksum = 0;
+
+	double start = CCoreBench::Seconds();
+	for (UINT64 i = 0; i < reads; i++)
+	{
+		LONGLONG duration = 0;
+		LONGLONG position = 0;
+		player.GetCore().GetDurationAndPosition(&duration, &position);
+		checksum += position;
+	}
+	double callElapsed = CCoreBench::Seconds() - start;
+
+	const PLAYBACK_STATUS* pShared = nullptr;
+	player.GetCore().GetPlaybackStatus(&pShared);
+
+	start = CCoreBench::Seconds();
+	for (UINT64 i = 0; i < reads; i++)
+	{
+		PLAYBACK_STATUS status;
+		CStatusBlock::Read(pShared, &status);
+		checksum += status.position;
+	}
+	double blockElapsed = CCoreBench::Seconds() - start;
+
+	bench.Report("GetDurationAndPosition", reads / callElapsed / 1e6, "M reads/s");
+	bench.Report("status block", reads / blockElapsed / 1e6, "M reads/s");
+
+	// a media thread publishing as fast as it can, readers retry when they overlap an update
+	CStatusBlock block;
+	std::atomic<bool> stop(false);
+	std::thread writer([&]()
+	{
+		INT64 position = 0;
+		while (!stop)
+			block.Update([&position](PLAYBACK_STATUS& status) { status.position = position++; status.frameCounter++; });
+	});
+
+	start = CCoreBench::Seconds();
+	for (UINT64 i = 0; i < reads; i++)
+	{
+		PLAYBACK_STATUS status;
+		block.Read(&status);
+		checksum += status.position;
+	}
+	double contendedElapsed = CCoreBench::Seconds() - start;
+
+	stop = true;
+	writer.join();
+
+	bench.Report("status block, concurrent writer", reads / contendedElapsed / 1e6, "M reads/s");
+	bench.Report("checksum", (double)(checksum & 0xFF), "");
+}
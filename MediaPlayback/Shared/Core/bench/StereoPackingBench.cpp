@@ -0,0 +1,67 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreBench.h"
+#include "StereoPacking.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+
+// Bytes moved per second packing 32bpp stereo frames into over/under (read + write), next to a plain memcpy of
+// the same frame as the ceiling of the machine.
+CORE_BENCH(PackingBandwidth)
+{
+	static const struct
+	{
+		const char* name;
+		UINT32 width;
+		UINT32 height;
+		StereoPacking packing;
+	} c_frames[] =
+	{
+		{ "1080p side by side", 3840, 1080, StereoPacking::StereoPacking_SideBySide },
+		{ "4K top/bottom", 3840, 3840, StereoPacking::StereoPacking_TopBottom },
+		{ "4K side by side", 7680, 2160, StereoPacking::StereoPacking_SideBySide },
+		{ "8K top/bottom", 7680, 7680, StereoPacking::StereoPacking_TopBottom }
+	};
+
+	for (size_t i = 0; i < sizeof(c_frames) / sizeof(c_frames[0]); i++)
+	{
+		UINT32 width = c_frames[i].width;
+		UINT32 height = c_frames[i].height;
+		size_t frameBytes = (size_t)width * height * 4;
+
+		std::vector<BYTE> source(frameBytes, 0x5A);
+		std::vector<BYTE> destination(frameBytes, 0);
+
+		UINT32 eyeWidth = c_frames[i].packing == StereoPacking::StereoPacking_SideBySide ? width / 2 : width;
+		UINT64 frames = bench.Scale(frameBytes > 100000000 ? 100 : 400);
+
+		double start = CCoreBench::Seconds();
+		for (UINT64 frame = 0; frame < frames; frame++)
+			PackStereoOverUnder(source.data(), width * 4, width, height, c_frames[i].packing, destination.data(), eyeWidth * 4);
+		double packElapsed = CCoreBench::Seconds() - start;
+
+		start = CCoreBench::Seconds();
+		for (UINT64 frame = 0; frame < frames; frame++)
+			memcpy(destination.data(), source.data(), frameBytes);
+		double copyElapsed = CCoreBench::Seconds() - start;
+
+		char metric[64];
+		snprintf(metric, sizeof(metric), "%s, packing", c_frames[i].name);
+		bench.Report(metric, 2.0 * frameBytes * frames / packElapsed / 1e9, "GB/s");
+		snprintf(metric, sizeof(metric), "%s, memcpy", c_frames[i].name);
+		bench.Report(metric, 2.0 * frameBytes * frames / copyElapsed / 1e9, "GB/s");
+	}
+}
@@ -0,0 +1,92 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreBench.h"
+#include "SurfacePool.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+
+// CPU stand-in for a texture set: the allocation is committed, like video memory a driver hands out
+typedef std::shared_ptr<std::vector<BYTE>> BenchSurface;
+
+static HRESULT CreateBenchSurface(_In_ const SURFACE_POOL_KEY& key, _Out_ BenchSurface* pSurface)
+{
+	*pSurface = std::make_shared<std::vector<BYTE>>((size_t)key.width * key.height * 4);
+	memset((*pSurface)->data(), 0, (*pSurface)->size());
+
+	return S_OK;
+}
+
+// An adaptive stream hopping between renditions: every switch recycles the surface of the old size and acquires
+// one for the new size. Per switch cost and hit rate with the pool, with a budget too small for the ladder, and
+// with no pool at all.
+CORE_BENCH(RenditionSwitches)
+{
+	static const SURFACE_POOL_KEY c_ladder[] =
+	{
+		{ 640, 360, 0, false }, { 1280, 720, 0, false }, { 1920, 1080, 0, false }, { 2560, 1440, 0, false }, { 3840, 2160, 0, false }
+	};
+	const size_t ladderSize = sizeof(c_ladder) / sizeof(c_ladder[0]);
+
+	UINT64 ladderBytes = 0;
+	for (size_t i = 0; i < ladderSize; i++)
+		ladderBytes += (UINT64)c_ladder[i].width * c_ladder[i].height * 4;
+
+	static const struct
+	{
+		const char* name;
+		double budgetShare;
+	} c_budgets[] = { { "whole ladder", 1.0 }, { "half the ladder", 0.5 }, { "no pool", 0.0 } };
+
+	UINT64 switches = bench.Scale(5000) + 10;
+
+	for (size_t b = 0; b < sizeof(c_budgets) / sizeof(c_budgets[0]); b++)
+	{
+		CSurfacePool<BenchSurface> pool((UINT64)(ladderBytes * c_budgets[b].budgetShare));
+		std::mt19937 random(9);
+
+		size_t rendition = 0;
+		BenchSurface surface;
+		pool.Acquire(c_ladder[rendition], CreateBenchSurface, &surface);
+
+		double start = CCoreBench::Seconds();
+		for (UINT64 i = 0; i < switches; i++)
+		{
+			// mostly one step up or down, now and then a jump
+			size_t next = (random() % 4 == 0) ? random() % ladderSize : (rendition + ((random() & 1) ? 1 : ladderSize - 1)) % ladderSize;
+			if (next == rendition)
+				next = (rendition + 1) % ladderSize;
+
+			const SURFACE_POOL_KEY& key = c_ladder[rendition];
+			pool.Recycle(key, std::move(surface), (UINT64)key.width * key.height * 4);
+			pool.Acquire(c_ladder[next], CreateBenchSurface, &surface);
+			rendition = next;
+		}
+		double elapsed = CCoreBench::Seconds() - start;
+
+		SURFACE_POOL_STATS stats;
+		pool.GetStats(&stats);
+
+		char metric[64];
+		snprintf(metric, sizeof(metric), "%s, per switch", c_budgets[b].name);
+		bench.Report(metric, elapsed * 1e6 / switches, "us");
+		snprintf(metric, sizeof(metric), "%s, hit rate", c_budgets[b].name);
+		bench.Report(metric, stats.hits * 100.0 / (stats.hits + stats.misses), "%");
+		snprintf(metric, sizeof(metric), "%s, pooled", c_budgets[b].name);
+		bench.Report(metric, stats.pooledBytes / (1024.0 * 1024.0), "MB");
+	}
+}
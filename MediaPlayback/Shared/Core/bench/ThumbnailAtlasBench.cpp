@@ -0,0 +1,107 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreBench.h"
+#include "FakeThumbnailDecoder.h"
+#include "TestDirectory.h"
+#include "ThumbnailAtlas.h"
+
+
+// Hands out the same frame every time, so what is measured is the extractor and the downscaling, not a decoder
+class CStillFrameDecoder : public IThumbnailDecoder
+{
+public:
+	CStillFrameDecoder(_In_ INT64 duration, _In_ UINT32 width, _In_ UINT32 height)
+		: m_duration(duration)
+		, m_width(width)
+		, m_height(height)
+	{
+	}
+
+	HRESULT Open(_Out_ INT64* pDuration) override
+	{
+		*pDuration = m_duration;
+		return S_OK;
+	}
+
+	HRESULT DecodeFrame(_In_ INT64 position, _Inout_ std::vector<BYTE>* pFrame, _Out_ UINT32* pWidth, _Out_ UINT32* pHeight) override
+	{
+		*pWidth = m_width;
+		*pHeight = m_height;
+
+		if (pFrame->size() != (size_t)m_width * m_height * 4)
+		{
+			pFrame->resize((size_t)m_width * m_height * 4);
+			for (size_t i = 0; i < pFrame->size(); i++)
+				(*pFrame)[i] = (BYTE)(i * 7 + position);
+		}
+
+		return S_OK;
+	}
+
+private:
+	INT64 m_duration;
+	UINT32 m_width;
+	UINT32 m_height;
+};
+
+static void MeasureExtraction(_In_ CCoreBench& bench, _In_ UINT32 width, _In_ UINT32 height, _In_ const char* pszName)
+{
+	UINT32 tiles = (UINT32)bench.Scale(1000) + 2;
+
+	CManualTaskQueue queue;
+	CThumbnailExtractor extractor(queue.GetSubmit());
+
+	double start = CCoreBench::Seconds();
+	extractor.Start(std::make_shared<CStillFrameDecoder>(tiles * TEST_SECOND, width, height), L"clip.mp4", 160, 90, TEST_SECOND, nullptr, L"");
+	queue.RunAll();
+	double seconds = CCoreBench::Seconds() - start;
+
+	bench.Report(pszName, tiles / seconds, "thumbnails/s");
+}
+
+// Downscaling decoded frames into 160x90 tiles on one worker, as the extraction runs
+CORE_BENCH(ThumbnailsPerSecond)
+{
+	MeasureExtraction(bench, 1280, 720, "720p");
+	MeasureExtraction(bench, 1920, 1080, "1080p");
+	MeasureExtraction(bench, 3840, 2160, "2160p");
+}
+
+// Opening a two-hour source a second time: the cached atlas at a preview every 10s
+CORE_BENCH(CachedAtlas)
+{
+	CTestDirectory directory;
+	std::wstring path = directory.GetFilePath(L"clip.atlas");
+
+	CManualTaskQueue queue;
+	CThumbnailExtractor extractor(queue.GetSubmit());
+	std::shared_ptr<IThumbnailDecoder> spDecoder = std::make_shared<CStillFrameDecoder>(7200 * TEST_SECOND, 320, 180);
+
+	extractor.Start(spDecoder, L"clip.mp4", 160, 90, 10 * TEST_SECOND, nullptr, path);
+	queue.RunAll();
+
+	UINT64 loads = bench.Scale(200) + 1;
+
+	double start = CCoreBench::Seconds();
+	for (UINT64 i = 0; i < loads; i++)
+	{
+		extractor.Start(spDecoder, L"clip.mp4", 160, 90, 10 * TEST_SECOND, nullptr, path);
+		queue.RunAll();
+	}
+	double seconds = (CCoreBench::Seconds() - start) / loads;
+
+	THUMBNAIL_ATLAS_INFO info;
+	extractor.GetInfo(&info);
+
+	bench.Report("load", seconds * 1e3, "ms");
+	bench.Report("tiles", (double)info.readyCount, "");
+}
@@ -0,0 +1,244 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "AbrSimulator.h"
+#include "CoreTest.h"
+#include "TestData.h"
+
+#define SECONDS(s) ((INT64)((s) * 10000000ll))
+
+
+// Plays the bitrates it is given in turn, the last one from then on
+class CScriptedAbrController : public IAbrController
+{
+public:
+	explicit CScriptedAbrController(_In_ const std::vector<UINT32>& script)
+		: m_script(script)
+		, m_next(0)
+	{
+	}
+
+	virtual void OnSegmentDownloaded(_In_ UINT64 bytes, _In_ INT64 downloadTime) override
+	{
+		m_downloads.push_back(std::make_pair(bytes, downloadTime));
+	}
+
+	virtual UINT32 SelectBitrate(_In_ const std::vector<UINT32>&, _In_ INT64) override
+	{
+		UINT32 bitrate = m_script[m_next];
+		if (m_next + 1 < m_script.size())
+			m_next++;
+
+		return bitrate;
+	}
+
+	const std::vector<std::pair<UINT64, INT64>>& GetDownloads() const { return m_downloads; }
+
+private:
+	std::vector<UINT32> m_script;
+	size_t m_next;
+	std::vector<std::pair<UINT64, INT64>> m_downloads;
+};
+
+// 4 Mbit/s throughout, in one second samples
+static std::vector<BANDWIDTH_SAMPLE> MakeConstantTrace()
+{
+	BANDWIDTH_SAMPLE sample = { SECONDS(1), 4000000 };
+	return std::vector<BANDWIDTH_SAMPLE>(3, sample);
+}
+
+static ABR_SIMULATION_CONFIG MakeConfig(_In_ UINT32 segmentCount)
+{
+	ABR_SIMULATION_CONFIG config;
+	config.bitrates = { 1000000, 2000000, 8000000 };
+	config.segmentDuration = SECONDS(2);
+	config.segmentCount = segmentCount;
+	config.maxBuffer = SECONDS(10);
+	config.startupBuffer = SECONDS(4);
+	config.requestLatency = 0;
+
+	return config;
+}
+
+
+// Segments of 2s at 2 Mbit/s take 1s each at 4 Mbit/s: playback starts after two of them and the buffer fills
+// to its 10s limit without a stall; the last segment plays out 20s after the start
+CORE_TEST(SteadyStreamStartsAndNeverStalls)
+{
+	CScriptedAbrController controller({ 2000000 });
+	ABR_SIMULATION_RESULT result;
+	REQUIRE_HR(SimulateAbr(MakeConstantTrace(), MakeConfig(10), &controller, &result));
+
+	CHECK_EQ(SECONDS(2), result.startupDelay);
+	CHECK_EQ(0ll, (long long)result.rebufferTime);
+	CHECK_EQ((UINT32)0, result.rebufferCount);
+	CHECK_EQ((UINT32)0, result.switches);
+	CHECK_EQ((UINT32)2000000, result.averageBitrate);
+	CHECK_EQ(SECONDS(22), result.totalTime);
+
+	REQUIRE(controller.GetDownloads().size() == 10);
+	CHECK_EQ((UINT64)500000, controller.GetDownloads()[0].first);
+	CHECK_EQ(SECONDS(1), controller.GetDownloads()[0].second);
+}
+
+// Segments of 2s at 8 Mbit/s take 4s: every segment after the first one stalls playback for 2s
+CORE_TEST(StreamAboveTheBandwidthRebuffers)
+{
+	ABR_SIMULATION_CONFIG config = MakeConfig(3);
+	config.startupBuffer = SECONDS(2);
+
+	CScriptedAbrController controller({ 8000000 });
+	ABR_SIMULATION_RESULT result;
+	REQUIRE_HR(SimulateAbr(MakeConstantTrace(), config, &controller, &result));
+
+	CHECK_EQ(SECONDS(4), result.startupDelay);
+	CHECK_EQ(SECONDS(4), result.rebufferTime);
+	CHECK_EQ((UINT32)2, result.rebufferCount);
+	CHECK_EQ(SECONDS(14), result.totalTime);
+}
+
+CORE_TEST(SwitchesAndLatencyAreCounted)
+{
+	ABR_SIMULATION_CONFIG config = MakeConfig(5);
+	config.requestLatency = SECONDS(0.5);
+
+	CScriptedAbrController controller({ 1000000, 2000000, 2000000, 1000000, 0 });
+	ABR_SIMULATION_RESULT result;
+	REQUIRE_HR(SimulateAbr(MakeConstantTrace(), config, &controller, &result));
+
+	// 0 falls back to the lowest bitrate, which is no switch from 1 Mbit/s
+	CHECK_EQ((UINT32)2, result.switches);
+	CHECK_EQ((UINT32)1400000, result.averageBitrate);
+
+	// latency, then 0.5s or 1s of transfer
+	CHECK_EQ(SECONDS(1), controller.GetDownloads()[0].second);
+	CHECK_EQ(SECONDS(1.5), controller.GetDownloads()[1].second);
+	CHECK_EQ(SECONDS(2.5), result.startupDelay);
+}
+
+// Transfers span samples of the trace and wrap around it
+CORE_TEST(TransfersFollowTheTrace)
+{
+	std::vector<BANDWIDTH_SAMPLE> trace = { { SECONDS(1), 1000000 }, { SECONDS(1), 0 }, { SECONDS(1), 3000000 } };
+
+	ABR_SIMULATION_CONFIG config = MakeConfig(2);
+	config.startupBuffer = SECONDS(10);
+
+	// 4 Mbit: 1 in the first second, nothing in the second, 3 in the third; then 1 + 3 again
+	CScriptedAbrController controller({ 2000000 });
+	ABR_SIMULATION_RESULT result;
+	REQUIRE_HR(SimulateAbr(trace, config, &controller, &result));
+
+	REQUIRE(controller.GetDownloads().size() == 2);
+	CHECK_EQ(SECONDS(3), controller.GetDownloads()[0].second);
+	CHECK_EQ(SECONDS(3), controller.GetDownloads()[1].second);
+
+	// the stream ends before the startup buffer is reached, playback starts with the last segment
+	CHECK_EQ(SECONDS(6), result.startupDelay);
+	CHECK_EQ(SECONDS(10), result.totalTime);
+}
+
+CORE_TEST(InvalidSimulationsFail)
+{
+	CScriptedAbrController controller({ 1000000 });
+	ABR_SIMULATION_RESULT result;
+
+	ABR_SIMULATION_CONFIG config = MakeConfig(0);
+	CHECK_EQ(E_INVALIDARG, SimulateAbr(MakeConstantTrace(), config, &controller, &result));
+
+	config = MakeConfig(1);
+	config.bitrates.clear();
+	CHECK_EQ(E_INVALIDARG, SimulateAbr(MakeConstantTrace(), config, &controller, &result));
+
+	config = MakeConfig(1);
+	config.maxBuffer = SECONDS(1);
+	CHECK_EQ(E_INVALIDARG, SimulateAbr(MakeConstantTrace(), config, &controller, &result));
+
+	// a trace that never delivers anything
+	std::vector<BANDWIDTH_SAMPLE> silent = { { SECONDS(1), 0 } };
+	CHECK_EQ(E_INVALIDARG, SimulateAbr(silent, MakeConfig(1), &controller, &result));
+
+	CHECK_EQ(E_INVALIDARG, SimulateAbr(MakeConstantTrace(), MakeConfig(1), nullptr, &result));
+}
+
+CORE_TEST(ParsesBandwidthTraces)
+{
+	std::vector<BANDWIDTH_SAMPLE> trace;
+	REQUIRE_HR(ParseBandwidthTrace("# comment\n0 1.5\r\n\n  2.5 0\n3 4\n", &trace));
+
+	REQUIRE(trace.size() == 3);
+	CHECK_EQ(SECONDS(2.5), trace[0].duration);
+	CHECK_EQ((UINT32)1500000, trace[0].bitsPerSecond);
+	CHECK_EQ(SECONDS(0.5), trace[1].duration);
+	CHECK_EQ((UINT32)0, trace[1].bitsPerSecond);
+
+	// the last sample lasts as long as the one before it
+	CHECK_EQ(SECONDS(0.5), trace[2].duration);
+
+	CHECK_EQ(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), ParseBandwidthTrace("", &trace));
+	CHECK_EQ(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), ParseBandwidthTrace("# only a comment\n", &trace));
+	CHECK_EQ(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), ParseBandwidthTrace("0 1\n0 2\n", &trace));
+	CHECK_EQ(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), ParseBandwidthTrace("0 -1\n", &trace));
+	CHECK_EQ(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), ParseBandwidthTrace("0 fast\n", &trace));
+	CHECK(trace.empty());
+}
+
+// The controllers on the recorded trace in tests/data: start-up, rebuffering and switches are pinned, so a change
+// to a policy shows up here as a change of its numbers. Rebuffering within a millisecond, transfer times are rounded
+// from floating point.
+CORE_TEST(PoliciesOnTheRecordedTrace)
+{
+	std::string text;
+	REQUIRE_HR(LoadTestData("abr-trace.txt", &text));
+
+	std::vector<BANDWIDTH_SAMPLE> trace;
+	REQUIRE_HR(ParseBandwidthTrace(text, &trace));
+	CHECK_EQ((size_t)120, trace.size());
+
+	ABR_SIMULATION_CONFIG config;
+	config.bitrates = { 300000, 750000, 1200000, 1850000, 2850000, 4300000 };
+	config.segmentDuration = SECONDS(4);
+	config.segmentCount = 75;
+	config.maxBuffer = SECONDS(30);
+	config.startupBuffer = SECONDS(4);
+	config.requestLatency = SECONDS(0.05);
+
+	static const struct
+	{
+		AbrPolicy policy;
+		INT64 startupDelay;
+		INT64 rebufferTime;
+		UINT32 rebufferCount;
+		UINT32 switches;
+		UINT32 averageBitrate;
+	} c_expected[] =
+	{
+		{ AbrPolicy::AbrPolicy_Throughput, SECONDS(0.25), SECONDS(10.75), 1, 21, 2862666 },
+		{ AbrPolicy::AbrPolicy_Buffer, SECONDS(0.25), SECONDS(0.8184), 3, 15, 3372666 },
+		{ AbrPolicy::AbrPolicy_Hybrid, SECONDS(0.25), SECONDS(4.804), 3, 18, 3456000 },
+	};
+
+	for (const auto& expected : c_expected)
+	{
+		std::unique_ptr<IAbrController> spController;
+		REQUIRE_HR(CreateAbrController(expected.policy, &spController));
+
+		ABR_SIMULATION_RESULT result;
+		REQUIRE_HR(SimulateAbr(trace, config, spController.get(), &result));
+
+		CHECK_EQ(expected.startupDelay, result.startupDelay);
+		CHECK(result.rebufferTime > expected.rebufferTime - SECONDS(0.001) && result.rebufferTime < expected.rebufferTime + SECONDS(0.001));
+		CHECK_EQ(expected.rebufferCount, result.rebufferCount);
+		CHECK_EQ(expected.switches, result.switches);
+		CHECK_EQ(expected.averageBitrate, result.averageBitrate);
+
+	}
+}
@@ -0,0 +1,311 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ColorConversion.h"
+#include "CoreTest.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <random>
+#include <vector>
+
+
+static const ColorConversionKernel c_kernels[] =
+{
+	ColorConversionKernel::ColorConversionKernel_Scalar,
+	ColorConversionKernel::ColorConversionKernel_SSE41,
+	ColorConversionKernel::ColorConversionKernel_AVX2,
+	ColorConversionKernel::ColorConversionKernel_NEON
+};
+
+// YUV frame with its own planes; rows are padded so kernels reading past the row width would show up in ASan
+class CTestYuvFrame
+{
+public:
+	CTestYuvFrame(_In_ YuvFormat format, _In_ UINT32 width, _In_ UINT32 height)
+	{
+		UINT32 chromaWidth = (width + 1) / 2;
+		UINT32 chromaHeight = (height + 1) / 2;
+		UINT32 sampleSize = (format == YuvFormat::YuvFormat_P010) ? 2 : 1;
+
+		memset(&m_frame, 0, sizeof(m_frame));
+		m_frame.format = format;
+		m_frame.width = width;
+		m_frame.height = height;
+		m_frame.pitches[0] = width * sampleSize + 3;
+		m_planes[0].resize((size_t)m_frame.pitches[0] * height);
+
+		if (format == YuvFormat::YuvFormat_I420)
+		{
+			m_frame.pitches[1] = chromaWidth + 1;
+			m_frame.pitches[2] = chromaWidth + 5;
+			m_planes[1].resize((size_t)m_frame.pitches[1] * chromaHeight);
+			m_planes[2].resize((size_t)m_frame.pitches[2] * chromaHeight);
+		}
+		else
+		{
+			m_frame.pitches[1] = chromaWidth * 2 * sampleSize + 7;
+			m_planes[1].resize((size_t)m_frame.pitches[1] * chromaHeight);
+		}
+	}
+
+	// random samples, P010 samples keep the 6 low bits clear like a decoder writes them
+	void Fill(_Inout_ std::mt19937& random)
+	{
+		for (size_t plane = 0; plane < 3; plane++)
+		{
+			for (size_t i = 0; i < m_planes[plane].size(); i++)
+				m_planes[plane][i] = (BYTE)random();
+
+			if (m_frame.format == YuvFormat::YuvFormat_P010)
+			{
+				for (size_t i = 0; i + 1 < m_planes[plane].size(); i += 2)
+					m_planes[plane][i] &= 0xC0;
+			}
+		}
+	}
+
+	// every pixel the same sample values (8 or 10 bit)
+	void FillConstant(_In_ UINT32 y, _In_ UINT32 u, _In_ UINT32 v)
+	{
+		for (UINT32 row = 0; row < m_frame.height; row++)
+		{
+			for (UINT32 x = 0; x < m_frame.width; x++)
+				SetSample(0, row, x, y);
+		}
+
+		for (UINT32 row = 0; row < (m_frame.height + 1) / 2; row++)
+		{
+			for (UINT32 x = 0; x < (m_frame.width + 1) / 2; x++)
+			{
+				if (m_frame.format == YuvFormat::YuvFormat_I420)
+				{
+					SetSample(1, row, x, u);
+					SetSample(2, row, x, v);
+				}
+				else
+				{
+					SetSample(1, row, x * 2, u);
+					SetSample(1, row, x * 2 + 1, v);
+				}
+			}
+		}
+	}
+
+	YUV_FRAME Get()
+	{
+		for (size_t plane = 0; plane < 3; plane++)
+			m_frame.planes[plane] = m_planes[plane].empty() ? nullptr : m_planes[plane].data();
+
+		return m_frame;
+	}
+
+private:
+	void SetSample(_In_ size_t plane, _In_ UINT32 row, _In_ UINT32 index, _In_ UINT32 value)
+	{
+		BYTE* pRow = &m_planes[plane][(size_t)m_frame.pitches[plane] * row];
+		if (m_frame.format == YuvFormat::YuvFormat_P010)
+		{
+			UINT16 sample = (UINT16)(value << 6);
+			memcpy(pRow + index * 2, &sample, 2);
+		}
+		else
+		{
+			pRow[index] = (BYTE)value;
+		}
+	}
+
+	YUV_FRAME m_frame;
+	std::vector<BYTE> m_planes[3];
+};
+
+static std::vector<BYTE> Convert(
+	_In_ CTestYuvFrame& frame,
+	_In_ UINT32 width,
+	_In_ UINT32 height,
+	_In_ ColorMatrix matrix,
+	_In_ ColorRange range,
+	_In_ RgbFormat rgbFormat,
+	_Out_ HRESULT* pHr)
+{
+	UINT32 pitch = width * 4 + 4;
+	std::vector<BYTE> rgb((size_t)pitch * height, 0);
+	*pHr = ConvertYuvToRgb(frame.Get(), matrix, range, rgbFormat, rgb.data(), pitch);
+
+	return rgb;
+}
+
+static UINT32 FirstPixel(_In_ const std::vector<BYTE>& rgb)
+{
+	UINT32 pixel = 0;
+	memcpy(&pixel, rgb.data(), 4);
+	return pixel;
+}
+
+// Restores the runtime kernel selection when a test is done overriding it
+class CKernelOverride
+{
+public:
+	CKernelOverride() : m_kernel(GetColorConversionKernel()) {}
+	~CKernelOverride() { SetColorConversionKernel(m_kernel); }
+
+private:
+	ColorConversionKernel m_kernel;
+};
+
+
+CORE_TEST(ScalarKernelIsAlwaysSupported)
+{
+	CHECK(IsColorConversionKernelSupported(ColorConversionKernel::ColorConversionKernel_Scalar));
+	CHECK(IsColorConversionKernelSupported(GetColorConversionKernel()));
+
+#if defined(__x86_64__) || defined(_M_X64)
+	CHECK(!IsColorConversionKernelSupported(ColorConversionKernel::ColorConversionKernel_NEON));
+#endif
+	CHECK(!IsColorConversionKernelSupported((ColorConversionKernel)100));
+	CHECK_EQ(E_INVALIDARG, SetColorConversionKernel((ColorConversionKernel)100));
+}
+
+// Every SIMD kernel the CPU has gives exactly the scalar output, for every format, matrix, range and output
+// order, at widths that leave every possible tail and at odd heights
+CORE_TEST(SimdKernelsMatchScalar)
+{
+	CKernelOverride restore;
+	std::mt19937 random(11);
+
+	static const YuvFormat c_formats[] = { YuvFormat::YuvFormat_NV12, YuvFormat::YuvFormat_P010, YuvFormat::YuvFormat_I420 };
+	static const UINT32 c_widths[] = { 1, 2, 3, 7, 8, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127 };
+
+	UINT32 compared = 0;
+	UINT32 mismatches = 0;
+
+	for (YuvFormat format : c_formats)
+	{
+		for (UINT32 width : c_widths)
+		{
+			UINT32 height = 3 + width % 4;
+			CTestYuvFrame frame(format, width, height);
+			frame.Fill(random);
+
+			for (UINT32 matrix = 0; matrix <= (UINT32)ColorMatrix::ColorMatrix_BT2020; matrix++)
+			{
+				for (UINT32 range = 0; range <= (UINT32)ColorRange::ColorRange_Full; range++)
+				{
+					for (UINT32 rgbFormat = 0; rgbFormat <= (UINT32)RgbFormat::RgbFormat_RGBA; rgbFormat++)
+					{
+						HRESULT hr = S_OK;
+						REQUIRE_HR(SetColorConversionKernel(ColorConversionKernel::ColorConversionKernel_Scalar));
+						std::vector<BYTE> reference = Convert(frame, width, height, (ColorMatrix)matrix, (ColorRange)range, (RgbFormat)rgbFormat, &hr);
+						REQUIRE_HR(hr);
+
+						for (ColorConversionKernel kernel : c_kernels)
+						{
+							if (kernel == ColorConversionKernel::ColorConversionKernel_Scalar || !IsColorConversionKernelSupported(kernel))
+								continue;
+
+							REQUIRE_HR(SetColorConversionKernel(kernel));
+							std::vector<BYTE> output = Convert(frame, width, height, (ColorMatrix)matrix, (ColorRange)range, (RgbFormat)rgbFormat, &hr);
+							REQUIRE_HR(hr);
+
+							if (output != reference)
+								mismatches++;
+							compared++;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	CHECK_EQ((UINT32)0, mismatches);
+	if (compared == 0)
+		printf("    no SIMD kernel on this CPU, only the scalar reference was run\n");
+}
+
+CORE_TEST(ReferenceColors)
+{
+	CKernelOverride restore;
+
+	for (ColorConversionKernel kernel : c_kernels)
+	{
+		if (!IsColorConversionKernelSupported(kernel))
+			continue;
+		REQUIRE_HR(SetColorConversionKernel(kernel));
+
+		HRESULT hr = S_OK;
+		CTestYuvFrame nv12(YuvFormat::YuvFormat_NV12, 33, 2);
+
+		// limited range black and white, and what lies beyond them clamps
+		nv12.FillConstant(16, 128, 128);
+		CHECK_EQ((UINT32)0xFF000000, FirstPixel(Convert(nv12, 33, 2, ColorMatrix::ColorMatrix_BT709, ColorRange::ColorRange_Limited, RgbFormat::RgbFormat_BGRA, &hr)));
+		nv12.FillConstant(235, 128, 128);
+		CHECK_EQ((UINT32)0xFFFFFFFF, FirstPixel(Convert(nv12, 33, 2, ColorMatrix::ColorMatrix_BT709, ColorRange::ColorRange_Limited, RgbFormat::RgbFormat_BGRA, &hr)));
+		nv12.FillConstant(0, 128, 128);
+		CHECK_EQ((UINT32)0xFF000000, FirstPixel(Convert(nv12, 33, 2, ColorMatrix::ColorMatrix_BT709, ColorRange::ColorRange_Limited, RgbFormat::RgbFormat_BGRA, &hr)));
+		nv12.FillConstant(255, 128, 128);
+		CHECK_EQ((UINT32)0xFFFFFFFF, FirstPixel(Convert(nv12, 33, 2, ColorMatrix::ColorMatrix_BT709, ColorRange::ColorRange_Limited, RgbFormat::RgbFormat_BGRA, &hr)));
+
+		// full range mid gray
+		nv12.FillConstant(128, 128, 128);
+		CHECK_EQ((UINT32)0xFF808080, FirstPixel(Convert(nv12, 33, 2, ColorMatrix::ColorMatrix_BT601, ColorRange::ColorRange_Full, RgbFormat::RgbFormat_BGRA, &hr)));
+
+		// BT.709 limited range red (Y 63, Cb 102, Cr 240): R saturates, the channel order follows the output format
+		nv12.FillConstant(63, 102, 240);
+		UINT32 bgra = FirstPixel(Convert(nv12, 33, 2, ColorMatrix::ColorMatrix_BT709, ColorRange::ColorRange_Limited, RgbFormat::RgbFormat_BGRA, &hr));
+		UINT32 rgba = FirstPixel(Convert(nv12, 33, 2, ColorMatrix::ColorMatrix_BT709, ColorRange::ColorRange_Limited, RgbFormat::RgbFormat_RGBA, &hr));
+		CHECK_EQ((UINT32)0xFF, (bgra >> 16) & 0xFF);
+		CHECK((bgra & 0xFF) < 4 && ((bgra >> 8) & 0xFF) < 4);
+		CHECK_EQ((UINT32)0xFF, rgba & 0xFF);
+		CHECK_EQ(bgra & 0xFF, (rgba >> 16) & 0xFF);
+
+		// 10-bit limited range white and black
+		CTestYuvFrame p010(YuvFormat::YuvFormat_P010, 17, 2);
+		p010.FillConstant(940, 512, 512);
+		CHECK_EQ((UINT32)0xFFFFFFFF, FirstPixel(Convert(p010, 17, 2, ColorMatrix::ColorMatrix_BT2020, ColorRange::ColorRange_Limited, RgbFormat::RgbFormat_BGRA, &hr)));
+		p010.FillConstant(64, 512, 512);
+		CHECK_EQ((UINT32)0xFF000000, FirstPixel(Convert(p010, 17, 2, ColorMatrix::ColorMatrix_BT2020, ColorRange::ColorRange_Limited, RgbFormat::RgbFormat_BGRA, &hr)));
+
+		CTestYuvFrame i420(YuvFormat::YuvFormat_I420, 9, 3);
+		i420.FillConstant(235, 128, 128);
+		CHECK_EQ((UINT32)0xFFFFFFFF, FirstPixel(Convert(i420, 9, 3, ColorMatrix::ColorMatrix_BT601, ColorRange::ColorRange_Limited, RgbFormat::RgbFormat_RGBA, &hr)));
+		CHECK_HR(hr);
+	}
+}
+
+CORE_TEST(InvalidConversionArguments)
+{
+	CTestYuvFrame frame(YuvFormat::YuvFormat_NV12, 16, 4);
+	YUV_FRAME source = frame.Get();
+	std::vector<BYTE> rgb(16 * 4 * 4);
+
+	CHECK_EQ(E_INVALIDARG, ConvertYuvToRgb(source, ColorMatrix::ColorMatrix_BT709, ColorRange::ColorRange_Limited, RgbFormat::RgbFormat_BGRA, nullptr, 16 * 4));
+	CHECK_EQ(E_INVALIDARG, ConvertYuvToRgb(source, ColorMatrix::ColorMatrix_BT709, ColorRange::ColorRange_Limited, RgbFormat::RgbFormat_BGRA, rgb.data(), 16 * 4 - 1));
+	CHECK_EQ(E_INVALIDARG, ConvertYuvToRgb(source, (ColorMatrix)3, ColorRange::ColorRange_Limited, RgbFormat::RgbFormat_BGRA, rgb.data(), 16 * 4));
+	CHECK_EQ(E_INVALIDARG, ConvertYuvToRgb(source, ColorMatrix::ColorMatrix_BT709, (ColorRange)2, RgbFormat::RgbFormat_BGRA, rgb.data(), 16 * 4));
+	CHECK_EQ(E_INVALIDARG, ConvertYuvToRgb(source, ColorMatrix::ColorMatrix_BT709, ColorRange::ColorRange_Limited, (RgbFormat)2, rgb.data(), 16 * 4));
+
+	YUV_FRAME bad = source;
+	bad.pitches[1] = 15;
+	CHECK_EQ(E_INVALIDARG, ConvertYuvToRgb(bad, ColorMatrix::ColorMatrix_BT709, ColorRange::ColorRange_Limited, RgbFormat::RgbFormat_BGRA, rgb.data(), 16 * 4));
+
+	bad = source;
+	bad.format = YuvFormat::YuvFormat_P010;		// pitches too small for 16-bit samples
+	CHECK_EQ(E_INVALIDARG, ConvertYuvToRgb(bad, ColorMatrix::ColorMatrix_BT709, ColorRange::ColorRange_Limited, RgbFormat::RgbFormat_BGRA, rgb.data(), 16 * 4));
+
+	bad = source;
+	bad.format = YuvFormat::YuvFormat_I420;		// no V plane
+	CHECK_EQ(E_INVALIDARG, ConvertYuvToRgb(bad, ColorMatrix::ColorMatrix_BT709, ColorRange::ColorRange_Limited, RgbFormat::RgbFormat_BGRA, rgb.data(), 16 * 4));
+
+	bad = source;
+	bad.height = 0;
+	CHECK_EQ(E_INVALIDARG, ConvertYuvToRgb(bad, ColorMatrix::ColorMatrix_BT709, ColorRange::ColorRange_Limited, RgbFormat::RgbFormat_BGRA, rgb.data(), 16 * 4));
+}
@@ -0,0 +1,211 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// MP4 boxes and Matroska elements written in memory, just the ones CKeyframeIndex reads, and an IByteSource over
+// them. Enough to build the tables of hours long files, or damaged ones, without media data.
+
+#include "FileSystem.h"
+
+#include <string.h>
+
+#include <initializer_list>
+#include <vector>
+
+
+typedef std::vector<BYTE> ContainerBytes;
+
+class CMemorySource : public IByteSource
+{
+public:
+	explicit CMemorySource(_In_ const ContainerBytes& data) : m_data(data), m_reads(0) {}
+
+	virtual UINT64 GetSize() const override { return m_data.size(); }
+
+	virtual HRESULT Read(_In_ UINT64 offset, _Out_writes_(size) BYTE* pBuffer, _In_ UINT32 size) override
+	{
+		m_reads++;
+
+		if (offset > m_data.size() || size > m_data.size() - offset)
+			return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+
+		if (size > 0)
+			memcpy(pBuffer, m_data.data() + offset, size);
+
+		return S_OK;
+	}
+
+	UINT32 GetReadCount() const { return m_reads; }
+
+private:
+	const ContainerBytes& m_data;
+	UINT32 m_reads;
+};
+
+inline void AppendBigEndian(_Inout_ ContainerBytes* pBytes, _In_ UINT64 value, _In_ UINT32 bytes)
+{
+	for (UINT32 i = bytes; i > 0; i--)
+		pBytes->push_back((BYTE)(value >> ((i - 1) * 8)));
+}
+
+// Big-endian fields of a box payload, in order
+inline ContainerBytes MakeFields(_In_ std::initializer_list<std::pair<UINT64, UINT32>> fields)
+{
+	ContainerBytes bytes;
+	for (const auto& field : fields)
+		AppendBigEndian(&bytes, field.first, field.second);
+
+	return bytes;
+}
+
+inline ContainerBytes Concat(_In_ std::initializer_list<ContainerBytes> parts)
+{
+	ContainerBytes bytes;
+	for (const ContainerBytes& part : parts)
+		bytes.insert(bytes.end(), part.begin(), part.end());
+
+	return bytes;
+}
+
+inline ContainerBytes MakeBox(_In_ const char* pszType, _In_ const ContainerBytes& payload)
+{
+	ContainerBytes box;
+	box.reserve(payload.size() + 8);
+	AppendBigEndian(&box, payload.size() + 8, 4);
+	box.insert(box.end(), pszType, pszType + 4);
+	box.insert(box.end(), payload.begin(), payload.end());
+
+	return box;
+}
+
+
+// A progressive MP4 with one video track. Sample tables are given as (count, value) runs; an empty sync sample
+// list leaves stss out, a sampleCount of 0 leaves stsz out.
+typedef struct _MP4_TRACK_TABLES
+{
+	UINT32 timescale;
+	std::vector<std::pair<UINT32, UINT32>> timeToSample;
+	std::vector<std::pair<UINT32, UINT32>> compositionOffsets;	// written as version 0, negative ones as their two's complement
+	std::vector<UINT32> syncSamples;
+	UINT32 sampleCount;
+	INT64 editMediaTime;										// -1 for no edit list
+} MP4_TRACK_TABLES;
+
+inline ContainerBytes MakeRunTable(_In_ const char* pszType, _In_ const std::vector<std::pair<UINT32, UINT32>>& runs)
+{
+	ContainerBytes payload = MakeFields({ { 0, 4 }, { runs.size(), 4 } });
+	for (const auto& run : runs)
+	{
+		AppendBigEndian(&payload, run.first, 4);
+		AppendBigEndian(&payload, run.second, 4);
+	}
+
+	return MakeBox(pszType, payload);
+}
+
+inline ContainerBytes MakeVideoTrack(_In_ UINT32 trackId, _In_ const MP4_TRACK_TABLES& tables, _In_ const ContainerBytes& extraStbl = ContainerBytes())
+{
+	ContainerBytes stbl = Concat({ MakeRunTable("stts", tables.timeToSample), extraStbl });
+
+	if (!tables.compositionOffsets.empty())
+		stbl = Concat({ stbl, MakeRunTable("ctts", tables.compositionOffsets) });
+
+	if (!tables.syncSamples.empty())
+	{
+		ContainerBytes stss = MakeFields({ { 0, 4 }, { tables.syncSamples.size(), 4 } });
+		for (UINT32 sample : tables.syncSamples)
+			AppendBigEndian(&stss, sample, 4);
+
+		stbl = Concat({ stbl, MakeBox("stss", stss) });
+	}
+
+	if (tables.sampleCount != 0)
+		stbl = Concat({ stbl, MakeBox("stsz", MakeFields({ { 0, 4 }, { 1000, 4 }, { tables.sampleCount, 4 } })) });
+
+	ContainerBytes edts;
+	if (tables.editMediaTime >= 0)
+		edts = MakeBox("edts", MakeBox("elst", MakeFields({ { 0, 4 }, { 1, 4 }, { 1000, 4 }, { (UINT64)tables.editMediaTime, 4 }, { 0x00010000, 4 } })));
+
+	return MakeBox("trak", Concat(
+	{
+		MakeBox("tkhd", MakeFields({ { 0, 4 }, { 0, 4 }, { 0, 4 }, { trackId, 4 }, { 0, 4 }, { 0, 4 } })),
+		edts,
+		MakeBox("mdia", Concat(
+		{
+			MakeBox("mdhd", MakeFields({ { 0, 4 }, { 0, 4 }, { 0, 4 }, { tables.timescale, 4 }, { 0, 4 }, { 0, 4 } })),
+			MakeBox("hdlr", Concat({ MakeFields({ { 0, 4 }, { 0, 4 } }), ContainerBytes({ 'v', 'i', 'd', 'e' }), MakeFields({ { 0, 4 }, { 0, 4 }, { 0, 4 }, { 0, 1 } }) })),
+			MakeBox("minf", MakeBox("stbl", stbl)),
+		})),
+	}));
+}
+
+inline ContainerBytes MakeMovieHeader()
+{
+	// movie timescale 1000
+	return MakeBox("mvhd", MakeFields({ { 0, 4 }, { 0, 4 }, { 0, 4 }, { 1000, 4 }, { 0, 4 }, { 0, 4 } }));
+}
+
+inline ContainerBytes MakeFileType()
+{
+	return MakeBox("ftyp", Concat({ ContainerBytes({ 'i', 's', 'o', 'm' }), MakeFields({ { 0x200, 4 } }), ContainerBytes({ 'i', 's', 'o', 'm', 'a', 'v', 'c', '1' }) }));
+}
+
+inline ContainerBytes MakeProgressiveMp4(_In_ const MP4_TRACK_TABLES& tables)
+{
+	return Concat({ MakeFileType(), MakeBox("moov", Concat({ MakeMovieHeader(), MakeVideoTrack(1, tables) })) });
+}
+
+
+// Matroska: IDs are written with their marker bits, sizes in the 8 byte form
+inline ContainerBytes MakeElement(_In_ UINT32 id, _In_ const ContainerBytes& payload)
+{
+	ContainerBytes element;
+
+	UINT32 idBytes = (id > 0xFFFFFF) ? 4 : (id > 0xFFFF) ? 3 : (id > 0xFF) ? 2 : 1;
+	AppendBigEndian(&element, id, idBytes);
+
+	element.push_back(0x01);
+	AppendBigEndian(&element, payload.size(), 7);
+	element.insert(element.end(), payload.begin(), payload.end());
+
+	return element;
+}
+
+inline ContainerBytes MakeUnsignedElement(_In_ UINT32 id, _In_ UINT64 value)
+{
+	return MakeElement(id, MakeFields({ { value, 8 } }));
+}
+
+// Cue points of track 1 at the given times, in ticks of timecodeScale ns
+inline ContainerBytes MakeMatroska(_In_ UINT64 timecodeScale, _In_ const std::vector<UINT64>& cueTimes)
+{
+	ContainerBytes cues;
+	for (UINT64 time : cueTimes)
+	{
+		cues = Concat({ cues, MakeElement(0xBB, Concat(
+		{
+			MakeUnsignedElement(0xB3, time),
+			MakeElement(0xB7, Concat({ MakeUnsignedElement(0xF7, 1), MakeUnsignedElement(0xF1, 0) })),
+		})) });
+	}
+
+	return Concat(
+	{
+		MakeElement(0x1A45DFA3, MakeElement(0x4282, ContainerBytes({ 'w', 'e', 'b', 'm' }))),
+		MakeElement(0x18538067, Concat(
+		{
+			MakeElement(0x1549A966, MakeUnsignedElement(0x2AD7B1, timecodeScale)),
+			MakeElement(0x1654AE6B, MakeElement(0xAE, Concat({ MakeUnsignedElement(0xD7, 1), MakeUnsignedElement(0x83, 1) }))),
+			MakeElement(0x1C53BB6B, cues),
+		})),
+	});
+}
@@ -0,0 +1,93 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Minimal test harness of the core tests, nothing beyond the standard library.
+// CORE_TEST defines a case. CHECK reports a failure and lets the case go on, REQUIRE ends the case. The runner
+// (CoreTestMain.cpp) runs every case, or the ones whose name contains its argument, and fails if any check did.
+
+#include "PlaybackTypes.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+typedef void (*CoreTestFunction)();
+
+typedef struct _CORE_TEST_CASE
+{
+	const char* name;
+	CoreTestFunction fnTest;
+} CORE_TEST_CASE;
+
+std::vector<CORE_TEST_CASE>& GetCoreTestCases();
+void CoreTestFail(_In_ const char* file, _In_ int line, _In_ const std::string& message);
+
+class CCoreTestRegistrar
+{
+public:
+	CCoreTestRegistrar(_In_ const char* name, _In_ CoreTestFunction fnTest)
+	{
+		CORE_TEST_CASE testCase = { name, fnTest };
+		GetCoreTestCases().push_back(testCase);
+	}
+};
+
+#define CORE_TEST(name) \
+	static void CoreTest_##name(); \
+	static CCoreTestRegistrar g_coreTestRegistrar_##name(#name, CoreTest_##name); \
+	static void CoreTest_##name()
+
+#define CHECK(condition) \
+	do { if (!(condition)) CoreTestFail(__FILE__, __LINE__, #condition); } while (0)
+
+#define REQUIRE(condition) \
+	do { if (!(condition)) { CoreTestFail(__FILE__, __LINE__, #condition); return; } } while (0)
+
+#define CHECK_EQ(expected, actual) \
+	do \
+	{ \
+		auto __expected = (expected); \
+		auto __actual = (actual); \
+		if (!(__expected == __actual)) \
+		{ \
+			std::ostringstream __message; \
+			__message << #actual << " is " << __actual << ", expected " << __expected; \
+			CoreTestFail(__FILE__, __LINE__, __message.str()); \
+		} \
+	} while (0)
+
+#define CHECK_HR(expression) \
+	do \
+	{ \
+		HRESULT __hr = (expression); \
+		if (FAILED(__hr)) \
+		{ \
+			std::ostringstream __message; \
+			__message << #expression << " failed with 0x" << std::hex << (UINT32)__hr; \
+			CoreTestFail(__FILE__, __LINE__, __message.str()); \
+		} \
+	} while (0)
+
+#define REQUIRE_HR(expression) \
+	do \
+	{ \
+		HRESULT __hr = (expression); \
+		if (FAILED(__hr)) \
+		{ \
+			std::ostringstream __message; \
+			__message << #expression << " failed with 0x" << std::hex << (UINT32)__hr; \
+			CoreTestFail(__FILE__, __LINE__, __message.str()); \
+			return; \
+		} \
+	} while (0)
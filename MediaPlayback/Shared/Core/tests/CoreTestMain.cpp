@@ -0,0 +1,60 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreTest.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+static int g_failures = 0;
+
+std::vector<CORE_TEST_CASE>& GetCoreTestCases()
+{
+	static std::vector<CORE_TEST_CASE> testCases;
+	return testCases;
+}
+
+_Use_decl_annotations_
+void CoreTestFail(const char* file, int line, const std::string& message)
+{
+	g_failures++;
+	fprintf(stderr, "%s(%d): check failed: %s\n", file, line, message.c_str());
+}
+
+int main(int argc, char** argv)
+{
+	const char* filter = (argc > 1) ? argv[1] : nullptr;
+
+	int failedCases = 0;
+	int runCases = 0;
+
+	const std::vector<CORE_TEST_CASE>& testCases = GetCoreTestCases();
+	for (size_t i = 0; i < testCases.size(); i++)
+	{
+		if (filter != nullptr && strstr(testCases[i].name, filter) == nullptr)
+			continue;
+
+		int failuresBefore = g_failures;
+		testCases[i].fnTest();
+		runCases++;
+
+		bool passed = (g_failures == failuresBefore);
+		if (!passed)
+			failedCases++;
+
+		printf("[%s] %s\n", passed ? "  OK  " : "FAILED", testCases[i].name);
+	}
+
+	printf("%d of %d cases passed\n", runCases - failedCases, runCases);
+
+	return (failedCases == 0 && runCases > 0) ? 0 : 1;
+}
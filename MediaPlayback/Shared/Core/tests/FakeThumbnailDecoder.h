@@ -0,0 +1,142 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Thumbnail extraction without a platform decoder: frames are a solid color derived from their position, and a task
+// queue the test runs by hand instead of a worker pool.
+
+#include "ThumbnailAtlas.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#define TEST_SECOND 10000000ll
+
+
+// Blue channel of the frames decoded at position, the second it starts at
+inline BYTE GetFakeFrameBlue(_In_ INT64 position)
+{
+	return (BYTE)(position / TEST_SECOND);
+}
+
+class CFakeThumbnailDecoder : public IThumbnailDecoder
+{
+public:
+	CFakeThumbnailDecoder(_In_ INT64 duration, _In_ UINT32 width, _In_ UINT32 height)
+		: m_duration(duration)
+		, m_width(width)
+		, m_height(height)
+		, m_hrOpen(S_OK)
+		, m_decodeCount(0)
+	{
+	}
+
+	HRESULT Open(_Out_ INT64* pDuration) override
+	{
+		*pDuration = m_hrOpen == S_OK ? m_duration : 0;
+		return m_hrOpen;
+	}
+
+	HRESULT DecodeFrame(_In_ INT64 position, _Inout_ std::vector<BYTE>* pFrame, _Out_ UINT32* pWidth, _Out_ UINT32* pHeight) override
+	{
+		*pWidth = m_width;
+		*pHeight = m_height;
+
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_positions.push_back(position);
+		}
+
+		m_decodeCount++;
+
+		for (INT64 failing : m_failingPositions)
+		{
+			if (failing == position)
+				return E_FAIL;
+		}
+
+		pFrame->resize((size_t)m_width * m_height * 4);
+		for (size_t i = 0; i < pFrame->size(); i += 4)
+		{
+			(*pFrame)[i + 0] = GetFakeFrameBlue(position);
+			(*pFrame)[i + 1] = 0x40;
+			(*pFrame)[i + 2] = 0x80;
+			(*pFrame)[i + 3] = 0xFF;
+		}
+
+		return S_OK;
+	}
+
+	void SetOpenResult(_In_ HRESULT hr) { m_hrOpen = hr; }
+	void SetFailingPositions(_In_ const std::vector<INT64>& positions) { m_failingPositions = positions; }
+
+	UINT32 GetDecodeCount() const { return m_decodeCount; }
+
+	std::vector<INT64> GetPositions()
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		return m_positions;
+	}
+
+private:
+	INT64 m_duration;
+	UINT32 m_width;
+	UINT32 m_height;
+	HRESULT m_hrOpen;
+	std::vector<INT64> m_failingPositions;
+	std::atomic<UINT32> m_decodeCount;
+
+	std::mutex m_lock;
+	std::vector<INT64> m_positions;
+};
+
+
+// Tasks submitted by an extractor, run when the test says so
+class CManualTaskQueue
+{
+public:
+	CThumbnailExtractor::SubmitTask GetSubmit()
+	{
+		return [this](const CWorkerPool::Task& task)
+		{
+			m_tasks.push_back(task);
+			return S_OK;
+		};
+	}
+
+	// false once nothing is queued
+	bool RunOne()
+	{
+		if (m_tasks.empty())
+			return false;
+
+		CWorkerPool::Task task = m_tasks.front();
+		m_tasks.pop_front();
+		task();
+
+		return true;
+	}
+
+	UINT32 RunAll()
+	{
+		UINT32 count = 0;
+		while (RunOne())
+			count++;
+
+		return count;
+	}
+
+private:
+	std::deque<CWorkerPool::Task> m_tasks;
+};
@@ -0,0 +1,248 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreTest.h"
+#include "FrameCache.h"
+#include "SoftwarePlayer.h"
+
+#define SECOND SOFTWARE_TICKS_PER_SECOND
+#define FRAME_BYTES (64 * 36 * 4)
+
+
+template <typename TFrame>
+static FRAME_CACHE_STATS GetStats(_In_ const CFrameCache<TFrame>& cache)
+{
+	FRAME_CACHE_STATS stats = {};
+	cache.GetStats(&stats);
+
+	return stats;
+}
+
+static FRAME_CACHE_STATS GetStats(_In_ CSoftwarePlayer* pPlayer)
+{
+	FRAME_CACHE_STATS stats = {};
+	pPlayer->GetCore().GetFrameCacheStats(&stats);
+
+	return stats;
+}
+
+// Frames of 10 bytes, each on screen for 10 ticks, at 0, 10, 20, ...
+static void PutFrames(_Inout_ CFrameCache<int>* pCache, _In_ int first, _In_ int count)
+{
+	for (int i = first; i < first + count; i++)
+		pCache->Put(i * 10, 10, i, 10);
+}
+
+static void PlayClip(_In_ CSoftwarePlayer* pPlayer, _In_ const wchar_t* pszName, _In_ LONGLONG position)
+{
+	pPlayer->GetCore().LoadContent(pszName);
+	pPlayer->Run(TEST_FRAME_DURATION);
+	pPlayer->GetCore().Play();
+	pPlayer->Run(position);
+}
+
+
+CORE_TEST(LookupHitsTheFrameOnScreen)
+{
+	CFrameCache<int> cache(1000);
+	PutFrames(&cache, 0, 2);
+
+	int frame = -1;
+	INT64 framePosition = -1;
+	REQUIRE(cache.Lookup(5, &frame, &framePosition));
+	CHECK_EQ(0, frame);
+	CHECK_EQ(0ll, framePosition);
+
+	REQUIRE(cache.Lookup(19, &frame, nullptr));
+	CHECK_EQ(1, frame);
+
+	CHECK(!cache.Lookup(20, &frame, nullptr));
+	CHECK(!cache.Lookup(-1, &frame, nullptr));
+
+	// a frame put again for the same position replaces the old one
+	cache.Put(10, 10, 7, 10);
+	REQUIRE(cache.Lookup(10, &frame, nullptr));
+	CHECK_EQ(7, frame);
+
+	FRAME_CACHE_STATS stats = GetStats(cache);
+	CHECK_EQ(2u, stats.frames);
+	CHECK_EQ(20ull, stats.cachedBytes);
+	CHECK_EQ(3ull, stats.hits);
+	CHECK_EQ(2ull, stats.misses);
+	CHECK_EQ(0ll, stats.firstPosition);
+	CHECK_EQ(10ll, stats.lastPosition);
+}
+
+// Past the budget the frames farthest from the playhead go first, so what stays is a window around it
+CORE_TEST(BudgetKeepsAWindowAroundThePlayhead)
+{
+	CFrameCache<int> cache(100);
+	PutFrames(&cache, 0, 20);
+
+	FRAME_CACHE_STATS stats = GetStats(cache);
+	CHECK_EQ(10u, stats.frames);
+	CHECK_EQ(100ull, stats.cachedBytes);
+	CHECK_EQ(10ull, stats.evictions);
+	CHECK_EQ(100ll, stats.firstPosition);
+	CHECK_EQ(190ll, stats.lastPosition);
+
+	// stepping back moves the playhead, a smaller budget then keeps the frames after it
+	int frame = -1;
+	REQUIRE(cache.Lookup(120, &frame, nullptr));
+	cache.SetBudget(50);
+
+	stats = GetStats(cache);
+	CHECK_EQ(5u, stats.frames);
+	CHECK_EQ(100ll, stats.firstPosition);
+	CHECK_EQ(140ll, stats.lastPosition);
+
+	// frames larger than the budget are not cached
+	cache.Put(500, 10, 50, 60);
+	CHECK(!cache.Lookup(500, &frame, nullptr));
+
+	cache.SetBudget(0);
+	CHECK(!cache.IsEnabled());
+	CHECK_EQ(0u, GetStats(cache).frames);
+}
+
+// Making room hands out an evicted frame of the same size, to copy the next one into without allocating
+CORE_TEST(ReclaimReusesAnEvictedFrame)
+{
+	CFrameCache<int> cache(30);
+	PutFrames(&cache, 1, 3);
+
+	int frame = -1;
+	REQUIRE(cache.Reclaim(40, 10, &frame));
+	CHECK_EQ(1, frame);
+	CHECK_EQ(2u, GetStats(cache).frames);
+
+	// room enough, nothing to hand out
+	CHECK(!cache.Reclaim(40, 10, &frame));
+
+	// a frame of another size is evicted but not handed out
+	cache.Put(40, 10, 4, 10);
+	CHECK(!cache.Reclaim(50, 20, &frame));
+	CHECK_EQ(1u, GetStats(cache).frames);
+
+	cache.Clear();
+	FRAME_CACHE_STATS stats = GetStats(cache);
+	CHECK_EQ(0u, stats.frames);
+	CHECK_EQ(0ull, stats.cachedBytes);
+	CHECK_EQ(-1ll, stats.firstPosition);
+	CHECK_EQ(3ull, stats.evictions);
+}
+
+// A short rewind while paused shows the cached frame without seeking the decoder; Play then seeks it there
+CORE_TEST(PausedRewindIsServedFromTheCache)
+{
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"clip.mp4", MakeSoftwareMedia(64, 36, 10 * SECOND));
+	player.Initialize();
+	PlayClip(&player, L"clip.mp4", 2 * SECOND);
+	player.GetCore().Pause();
+
+	UINT64 lastDecoded = player.GetPresentedFrame();
+	FRAME_CACHE_STATS before = GetStats(&player);
+	CHECK(before.frames >= 60);
+
+	REQUIRE_HR(player.GetCore().Seek(SECOND));
+	CHECK_EQ(SECOND, player.GetPosition());
+	CHECK_EQ(lastDecoded - 30, player.GetPresentedFrame());
+	CHECK_EQ(before.hits + 1, GetStats(&player).hits);
+
+	// the virtual clock does not move a paused player off the cached frame
+	player.Run(SECOND);
+	CHECK_EQ(SECOND, player.GetPosition());
+
+	REQUIRE_HR(player.GetCore().Play());
+	player.Run(TEST_FRAME_DURATION);
+	CHECK_EQ(SECOND + TEST_FRAME_DURATION, player.GetPosition());
+	CHECK(player.GetPresentedFrame() > lastDecoded);
+}
+
+// Seeks outside the cached window, and any seek while playing, go to the decoder
+CORE_TEST(SeeksPastTheCacheGoToTheDecoder)
+{
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"clip.mp4", MakeSoftwareMedia(64, 36, 10 * SECOND));
+	player.Initialize();
+	player.GetCore().SetFrameCacheBudget(10 * FRAME_BYTES);
+	PlayClip(&player, L"clip.mp4", 2 * SECOND);
+
+	FRAME_CACHE_STATS stats = GetStats(&player);
+	CHECK_EQ(10u, stats.frames);
+	CHECK(stats.evictions >= 50);
+	CHECK(stats.lastPosition - stats.firstPosition < 10 * TEST_FRAME_DURATION);
+
+	// while playing the decoder is sought even into the window
+	UINT64 lastDecoded = player.GetPresentedFrame();
+	REQUIRE_HR(player.GetCore().Seek(2 * SECOND - TEST_FRAME_DURATION));
+	player.Run(TEST_FRAME_DURATION);
+	CHECK(player.GetPresentedFrame() > lastDecoded);
+	CHECK_EQ(stats.hits, GetStats(&player).hits);
+
+	player.GetCore().Pause();
+	lastDecoded = player.GetPresentedFrame();
+	stats = GetStats(&player);
+
+	REQUIRE_HR(player.GetCore().Seek(SECOND));
+	CHECK_EQ(SECOND, player.GetPosition());
+	CHECK_EQ(lastDecoded + 1, player.GetPresentedFrame());
+	CHECK_EQ(stats.misses + 1, GetStats(&player).misses);
+
+	// and the decoded frame is cached like any other, for a frame's time: the seek while playing was not taken for
+	// a frame duration
+	REQUIRE_HR(player.GetCore().Seek(SECOND + TEST_FRAME_DURATION / 2));
+	CHECK_EQ(lastDecoded + 1, player.GetPresentedFrame());
+	CHECK_EQ(stats.hits + 1, GetStats(&player).hits);
+}
+
+// Cached frames belong to a source and a video size; a new item, Stop or a size change drops them
+CORE_TEST(CacheIsDroppedWithTheSourceAndTheSize)
+{
+	SOFTWARE_MEDIA_DESCRIPTION adaptive = MakeSoftwareMedia(64, 36, 10 * SECOND);
+	adaptive.videoTracks = {
+		{ 64, 36, 500000, 30, VideoCodec::VideoCodec_H264, 0, 8 },
+		{ 128, 72, 1000000, 30, VideoCodec::VideoCodec_H264, 0, 8 } };
+
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"first.mp4", MakeSoftwareMedia(64, 36, 10 * SECOND));
+	player.GetBackend()->RegisterMedia(L"adaptive.mp4", adaptive);
+	player.Initialize();
+	player.GetCore().SetRenditionConstraints(64, 36, PowerBudget::PowerBudget_Unconstrained);
+
+	PlayClip(&player, L"first.mp4", SECOND);
+	CHECK(GetStats(&player).frames > 0);
+
+	REQUIRE_HR(player.GetCore().LoadContent(L"adaptive.mp4"));
+	CHECK_EQ(0u, GetStats(&player).frames);
+
+	player.Run(TEST_FRAME_DURATION);
+	player.GetCore().Play();
+	player.Run(SECOND);
+	CHECK_EQ(64u, player.GetCore().GetPlaybackSurface()->GetWidth());
+
+	FRAME_CACHE_STATS stats = GetStats(&player);
+	CHECK(stats.frames > 0);
+	CHECK_EQ((UINT64)stats.frames * FRAME_BYTES, stats.cachedBytes);
+
+	REQUIRE_HR(player.GetCore().SetRenditionConstraints(1920, 1080, PowerBudget::PowerBudget_Unconstrained));
+	CHECK_EQ(0u, GetStats(&player).frames);
+
+	// the new surfaces come with the next render event, frames from then on are cached at their size
+	player.Run(TEST_FRAME_DURATION);
+	CHECK_EQ(128u, player.GetCore().GetPlaybackSurface()->GetWidth());
+	player.Run(2 * TEST_FRAME_DURATION);
+	CHECK_EQ(2 * 4ull * FRAME_BYTES, GetStats(&player).cachedBytes);
+
+	REQUIRE_HR(player.GetCore().Stop());
+	CHECK_EQ(0u, GetStats(&player).frames);
+}
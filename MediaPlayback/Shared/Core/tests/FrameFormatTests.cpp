@@ -0,0 +1,137 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreTest.h"
+#include "FrameFormat.h"
+
+
+static FRAME_FORMAT_SUPPORT MakeSupport(_In_ bool nv12, _In_ bool p010)
+{
+	FRAME_FORMAT_SUPPORT support = { nv12, p010 };
+	return support;
+}
+
+// FrameFormat is not printable, the checks compare its value
+#define CHECK_FORMAT(expected, actual) CHECK_EQ((UINT32)(expected), (UINT32)(actual))
+
+
+CORE_TEST(NativeFormatsFallBack)
+{
+	FRAME_FORMAT_SUPPORT all = MakeSupport(true, true);
+	FRAME_FORMAT_SUPPORT nv12Only = MakeSupport(true, false);
+	FRAME_FORMAT_SUPPORT none = MakeSupport(false, false);
+
+	CHECK_FORMAT(FrameFormat::FrameFormat_P010, SelectFrameFormat(FrameFormat::FrameFormat_P010, all, false));
+	CHECK_FORMAT(FrameFormat::FrameFormat_NV12, SelectFrameFormat(FrameFormat::FrameFormat_P010, nv12Only, false));
+	CHECK_FORMAT(FrameFormat::FrameFormat_BGRA32, SelectFrameFormat(FrameFormat::FrameFormat_P010, none, false));
+
+	CHECK_FORMAT(FrameFormat::FrameFormat_NV12, SelectFrameFormat(FrameFormat::FrameFormat_NV12, all, false));
+	CHECK_FORMAT(FrameFormat::FrameFormat_BGRA32, SelectFrameFormat(FrameFormat::FrameFormat_NV12, MakeSupport(false, true), false));
+
+	CHECK_FORMAT(FrameFormat::FrameFormat_BGRA32, SelectFrameFormat(FrameFormat::FrameFormat_BGRA32, all, false));
+	CHECK_FORMAT(FrameFormat::FrameFormat_BGRA32, SelectFrameFormat((FrameFormat)7, all, false));
+
+	// stereo frames are packed by RGB copies
+	CHECK_FORMAT(FrameFormat::FrameFormat_BGRA32, SelectFrameFormat(FrameFormat::FrameFormat_P010, all, true));
+	CHECK_FORMAT(FrameFormat::FrameFormat_BGRA32, SelectFrameFormat(FrameFormat::FrameFormat_NV12, all, true));
+
+	CHECK(IsNativeFrameFormat(FrameFormat::FrameFormat_NV12));
+	CHECK(IsNativeFrameFormat(FrameFormat::FrameFormat_P010));
+	CHECK(!IsNativeFrameFormat(FrameFormat::FrameFormat_BGRA32));
+}
+
+CORE_TEST(Bgra32LayoutKeepsTheSize)
+{
+	FRAME_LAYOUT layout;
+	REQUIRE_HR(GetFrameLayout(FrameFormat::FrameFormat_BGRA32, 1921, 1081, &layout));
+
+	CHECK_EQ((UINT32)1921, layout.allocatedWidth);
+	CHECK_EQ((UINT32)1081, layout.allocatedHeight);
+	CHECK_EQ((UINT32)1, layout.planeCount);
+	CHECK_EQ((UINT32)1921 * 4, layout.planes[0].pitch);
+	CHECK_EQ((UINT64)0, layout.planes[0].offset);
+	CHECK_EQ((UINT64)1921 * 4 * 1081, layout.sizeBytes);
+}
+
+// Plane sizes, pitches and offsets of the 4:2:0 formats at every combination of odd and even dimensions
+CORE_TEST(YuvLayoutsRoundOddDimensionsUp)
+{
+	static const struct
+	{
+		UINT32 width;
+		UINT32 height;
+		UINT32 allocatedWidth;
+		UINT32 allocatedHeight;
+	} c_sizes[] =
+	{
+		{ 1, 1, 2, 2 },
+		{ 2, 2, 2, 2 },
+		{ 3, 2, 4, 2 },
+		{ 2, 3, 2, 4 },
+		{ 1919, 1079, 1920, 1080 },
+		{ 1920, 1080, 1920, 1080 },
+		{ 3841, 2160, 3842, 2160 },
+		{ 7679, 7681, 7680, 7682 }
+	};
+
+	for (size_t i = 0; i < sizeof(c_sizes) / sizeof(c_sizes[0]); i++)
+	{
+		for (UINT32 bytesPerSample = 1; bytesPerSample <= 2; bytesPerSample++)
+		{
+			FrameFormat format = bytesPerSample == 1 ? FrameFormat::FrameFormat_NV12 : FrameFormat::FrameFormat_P010;
+			UINT32 allocatedWidth = c_sizes[i].allocatedWidth;
+			UINT32 allocatedHeight = c_sizes[i].allocatedHeight;
+
+			FRAME_LAYOUT layout;
+			REQUIRE_HR(GetFrameLayout(format, c_sizes[i].width, c_sizes[i].height, &layout));
+
+			CHECK_FORMAT(format, layout.format);
+			CHECK_EQ(allocatedWidth, layout.allocatedWidth);
+			CHECK_EQ(allocatedHeight, layout.allocatedHeight);
+			CHECK_EQ((UINT32)2, layout.planeCount);
+
+			// luma: one sample per pixel
+			CHECK_EQ(allocatedWidth, layout.planes[0].width);
+			CHECK_EQ(allocatedHeight, layout.planes[0].height);
+			CHECK_EQ(bytesPerSample, layout.planes[0].bytesPerElement);
+			CHECK_EQ(allocatedWidth * bytesPerSample, layout.planes[0].pitch);
+			CHECK_EQ((UINT64)0, layout.planes[0].offset);
+
+			// chroma: one UV pair per 2x2 block, right after the luma rows; the pitch matches luma's
+			CHECK_EQ(allocatedWidth / 2, layout.planes[1].width);
+			CHECK_EQ(allocatedHeight / 2, layout.planes[1].height);
+			CHECK_EQ(bytesPerSample * 2, layout.planes[1].bytesPerElement);
+			CHECK_EQ(layout.planes[0].pitch, layout.planes[1].pitch);
+			CHECK_EQ((UINT64)layout.planes[0].pitch * allocatedHeight, layout.planes[1].offset);
+
+			// 12 bits per pixel of 8-bit 4:2:0, 24 for 16-bit samples
+			CHECK_EQ((UINT64)allocatedWidth * allocatedHeight * 3 / 2 * bytesPerSample, layout.sizeBytes);
+		}
+	}
+}
+
+CORE_TEST(InvalidLayouts)
+{
+	FRAME_LAYOUT layout;
+
+	CHECK_EQ(E_INVALIDARG, GetFrameLayout(FrameFormat::FrameFormat_NV12, 0, 1080, &layout));
+	CHECK_EQ(E_INVALIDARG, GetFrameLayout(FrameFormat::FrameFormat_NV12, 1920, 0, &layout));
+	CHECK_EQ(E_INVALIDARG, GetFrameLayout((FrameFormat)7, 1920, 1080, &layout));
+	CHECK_EQ(E_INVALIDARG, GetFrameLayout(FrameFormat::FrameFormat_NV12, 1920, 1080, nullptr));
+
+	// sizes no texture can have, rounding them up would wrap
+	CHECK_EQ(E_INVALIDARG, GetFrameLayout(FrameFormat::FrameFormat_NV12, 0xFFFFFFFF, 1080, &layout));
+	CHECK_EQ(E_INVALIDARG, GetFrameLayout(FrameFormat::FrameFormat_P010, 1920, _MaxFrameDimension_ + 1, &layout));
+	CHECK_EQ((UINT32)0, layout.planeCount);
+
+	CHECK_HR(GetFrameLayout(FrameFormat::FrameFormat_P010, _MaxFrameDimension_ - 1, _MaxFrameDimension_, &layout));
+	CHECK_EQ((UINT64)_MaxFrameDimension_ * _MaxFrameDimension_ * 3, layout.sizeBytes);
+}
@@ -0,0 +1,259 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreTest.h"
+#include "FrameQueue.h"
+
+#include <thread>
+
+
+// CPU frame: every word holds the frame number, a slot written while being read shows mixed words
+typedef struct _TEST_FRAME
+{
+	UINT64 words[64];
+} TEST_FRAME;
+
+static void WriteFrame(_Out_ TEST_FRAME* pFrame, _In_ UINT64 frame)
+{
+	for (size_t i = 0; i < 64; i++)
+		pFrame->words[i] = frame;
+}
+
+static bool ReadFrame(_In_ const TEST_FRAME* pFrame, _Out_ UINT64* pFrameNumber)
+{
+	*pFrameNumber = pFrame->words[0];
+	for (size_t i = 1; i < 64; i++)
+	{
+		if (pFrame->words[i] != *pFrameNumber)
+			return false;
+	}
+
+	return true;
+}
+
+
+CORE_TEST(EmptyQueueHasNoFrame)
+{
+	CFrameQueue<TEST_FRAME> queue;
+
+	bool isNew = true;
+	CHECK(queue.AcquireLatest(&isNew) == nullptr);
+	CHECK(!isNew);
+
+	FRAME_QUEUE_STATS stats = {};
+	queue.GetStats(&stats);
+	CHECK_EQ(3u, stats.capacity);
+	CHECK_EQ(0u, stats.depth);
+	CHECK_EQ(-1, stats.latestFrameAge);
+}
+
+CORE_TEST(ConsumerGetsTheLatestFrame)
+{
+	CFrameQueue<TEST_FRAME, 4> queue;
+
+	for (UINT64 frame = 1; frame <= 3; frame++)
+	{
+		TEST_FRAME* pSlot = queue.BeginWrite();
+		REQUIRE(pSlot != nullptr);
+		WriteFrame(pSlot, frame);
+		queue.Publish();
+	}
+
+	bool isNew = false;
+	TEST_FRAME* pLatest = queue.AcquireLatest(&isNew);
+	REQUIRE(pLatest != nullptr);
+	CHECK(isNew);
+
+	UINT64 frame = 0;
+	CHECK(ReadFrame(pLatest, &frame));
+	CHECK_EQ(3u, frame);
+
+	// the same slot again, nothing new
+	CHECK(queue.AcquireLatest(&isNew) == pLatest);
+	CHECK(!isNew);
+
+	FRAME_QUEUE_STATS stats = {};
+	queue.GetStats(&stats);
+	CHECK_EQ(3u, stats.publishedFrames);
+	CHECK_EQ(1u, stats.presentedFrames);
+	CHECK_EQ(2u, stats.droppedFrames);
+	CHECK_EQ(0u, stats.depth);
+}
+
+CORE_TEST(ProducerNeverWritesTheConsumerSlot)
+{
+	CFrameQueue<TEST_FRAME> queue;
+
+	WriteFrame(queue.BeginWrite(), 1);
+	queue.Publish();
+
+	TEST_FRAME* pHeld = queue.AcquireLatest();
+	REQUIRE(pHeld != nullptr);
+
+	// two pending frames fill the slots the consumer does not hold
+	TEST_FRAME* pSlots[2] = {};
+	for (UINT64 i = 0; i < 2; i++)
+	{
+		pSlots[i] = queue.BeginWrite();
+		REQUIRE(pSlots[i] != nullptr);
+		CHECK(pSlots[i] != pHeld);
+		WriteFrame(pSlots[i], 2 + i);
+		queue.Publish();
+	}
+
+	CHECK(queue.BeginWrite() == nullptr);
+
+	UINT64 frame = 0;
+	CHECK(ReadFrame(pHeld, &frame));
+	CHECK_EQ(1u, frame);
+
+	FRAME_QUEUE_STATS stats = {};
+	queue.GetStats(&stats);
+	CHECK_EQ(1u, stats.droppedFrames);
+	CHECK_EQ(2u, stats.depth);
+
+	// taking the latest pending frame skips the other one and frees the held slot
+	CHECK(queue.AcquireLatest() == pSlots[1]);
+	CHECK(queue.BeginWrite() == pHeld);
+
+	queue.GetStats(&stats);
+	CHECK_EQ(2u, stats.droppedFrames);
+}
+
+CORE_TEST(BeginWriteWithoutPublishReturnsTheSameSlot)
+{
+	CFrameQueue<TEST_FRAME> queue;
+
+	TEST_FRAME* pSlot = queue.BeginWrite();
+	CHECK(pSlot != nullptr);
+	CHECK(queue.BeginWrite() == pSlot);
+	CHECK(queue.AcquireLatest() == nullptr);
+}
+
+CORE_TEST(ProducerReadsTheLastPublishedSlot)
+{
+	CFrameQueue<TEST_FRAME> queue;
+
+	CHECK(queue.GetLastPublished() == nullptr);
+
+	TEST_FRAME* pFirst = queue.BeginWrite();
+	WriteFrame(pFirst, 1);
+	CHECK(queue.GetLastPublished() == nullptr);
+	queue.Publish();
+	CHECK(queue.GetLastPublished() == pFirst);
+
+	// the consumer holding it changes nothing, the next slot written is another one
+	CHECK(queue.AcquireLatest() == pFirst);
+	CHECK(queue.GetLastPublished() == pFirst);
+	CHECK(queue.BeginWrite() != pFirst);
+
+	WriteFrame(queue.BeginWrite(), 2);
+	queue.Publish();
+
+	UINT64 frame = 0;
+	CHECK(ReadFrame(queue.GetLastPublished(), &frame));
+	CHECK_EQ(2ull, frame);
+
+	queue.Reset();
+	CHECK(queue.GetLastPublished() == nullptr);
+}
+
+CORE_TEST(ResetForgetsPublishedFrames)
+{
+	CFrameQueue<TEST_FRAME> queue;
+
+	WriteFrame(queue.BeginWrite(), 1);
+	queue.Publish();
+	queue.Reset();
+
+	CHECK(queue.AcquireLatest() == nullptr);
+
+	FRAME_QUEUE_STATS stats = {};
+	queue.GetStats(&stats);
+	CHECK_EQ(0u, stats.publishedFrames);
+}
+
+// A decoder thread publishing as fast as it can against a render thread: every frame the consumer sees is whole,
+// newer than the previous one and unchanged for as long as the consumer holds it, every frame is either presented
+// or counted as dropped, and the last one published is the last one presented.
+CORE_TEST(ProducerConsumerStress)
+{
+	const UINT64 attempts = 200000;
+
+	CFrameQueue<TEST_FRAME> queue;
+	std::atomic<bool> producerDone(false);
+	UINT64 lastPublished = 0;
+
+	std::thread producer([&]()
+	{
+		for (UINT64 frame = 1; frame <= attempts; frame++)
+		{
+			TEST_FRAME* pSlot = queue.BeginWrite();
+			if (pSlot == nullptr)
+				continue;
+
+			WriteFrame(pSlot, frame);
+			queue.Publish();
+			lastPublished = frame;
+		}
+
+		producerDone = true;
+	});
+
+	UINT64 tornFrames = 0;
+	UINT64 reusedSlots = 0;
+	UINT64 outOfOrderFrames = 0;
+	UINT64 lastFrame = 0;
+
+	TEST_FRAME* pHeld = nullptr;
+	UINT64 heldFrame = 0;
+
+	for (;;)
+	{
+		bool done = producerDone;
+
+		bool isNew = false;
+		TEST_FRAME* pSlot = queue.AcquireLatest(&isNew);
+
+		// the slot held since the previous call must not have been touched
+		UINT64 frame = 0;
+		if (pHeld != nullptr && (!ReadFrame(pHeld, &frame) || frame != heldFrame))
+			reusedSlots++;
+
+		if (isNew)
+		{
+			if (!ReadFrame(pSlot, &frame))
+				tornFrames++;
+			else if (frame <= lastFrame)
+				outOfOrderFrames++;
+
+			lastFrame = frame;
+			pHeld = pSlot;
+			heldFrame = frame;
+		}
+
+		if (done && !isNew)
+			break;
+	}
+
+	producer.join();
+
+	CHECK_EQ(0u, tornFrames);
+	CHECK_EQ(0u, reusedSlots);
+	CHECK_EQ(0u, outOfOrderFrames);
+
+	FRAME_QUEUE_STATS stats = {};
+	queue.GetStats(&stats);
+	CHECK_EQ(0u, stats.depth);
+	CHECK_EQ(attempts, stats.presentedFrames + stats.droppedFrames);
+	CHECK_EQ(lastPublished, lastFrame);
+	CHECK(stats.presentedFrames > 0);
+}
@@ -0,0 +1,315 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ContainerBuilder.h"
+#include "CoreTest.h"
+#include "FrameScheduler.h"
+#include "SoftwarePlayer.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+#define SECOND SOFTWARE_TICKS_PER_SECOND
+
+
+static FRAME_SCHEDULER_STATS GetStats(_In_ CSoftwarePlayer* pPlayer)
+{
+	FRAME_SCHEDULER_STATS stats = {};
+	pPlayer->GetCore().GetFrameSchedulerStats(&stats);
+
+	return stats;
+}
+
+static FRAME_CACHE_STATS GetCacheStats(_In_ CSoftwarePlayer* pPlayer)
+{
+	FRAME_CACHE_STATS stats = {};
+	pPlayer->GetCore().GetFrameCacheStats(&stats);
+
+	return stats;
+}
+
+// Player with a clip of duration playing from position
+static void PlayClip(_In_ CSoftwarePlayer* pPlayer, _In_ LONGLONG duration, _In_ LONGLONG position, _In_ bool canSeek = true)
+{
+	pPlayer->GetBackend()->RegisterMedia(L"clip.mp4", MakeSoftwareMedia(64, 36, duration, canSeek));
+	pPlayer->Initialize();
+	pPlayer->GetCore().LoadContent(L"clip.mp4");
+	pPlayer->Run(TEST_FRAME_DURATION);
+	pPlayer->GetCore().Play();
+	pPlayer->Run(position);
+}
+
+// Keyframes every two seconds over a minute
+static std::shared_ptr<const CKeyframeIndex> MakeKeyframeIndex()
+{
+	MP4_TRACK_TABLES tables;
+	tables.timescale = 1000;
+	tables.timeToSample = { { 60, 1000 } };
+	tables.sampleCount = 60;
+	tables.editMediaTime = -1;
+	for (UINT32 sample = 1; sample <= 60; sample += 2)
+		tables.syncSamples.push_back(sample);
+
+	ContainerBytes file = MakeProgressiveMp4(tables);
+	CMemorySource source(file);
+
+	std::shared_ptr<CKeyframeIndex> spIndex = std::make_shared<CKeyframeIndex>();
+	spIndex->Build(&source);
+
+	return spIndex;
+}
+
+
+CORE_TEST(RateBounds)
+{
+	CHECK(CFrameScheduler::IsValidRate(0.25));
+	CHECK(CFrameScheduler::IsValidRate(4.0));
+	CHECK(CFrameScheduler::IsValidRate(-0.25));
+	CHECK(CFrameScheduler::IsValidRate(-4.0));
+	CHECK(!CFrameScheduler::IsValidRate(0.0));
+	CHECK(!CFrameScheduler::IsValidRate(0.2));
+	CHECK(!CFrameScheduler::IsValidRate(4.5));
+	CHECK(!CFrameScheduler::IsValidRate(-8.0));
+
+	CHECK(CFrameScheduler::IsNativeRate(0.25));
+	CHECK(CFrameScheduler::IsNativeRate(2.0));
+	CHECK(!CFrameScheduler::IsNativeRate(2.5));
+	CHECK(!CFrameScheduler::IsNativeRate(-1.0));
+
+	CSoftwarePlayer player;
+	CHECK_EQ(E_ILLEGAL_METHOD_CALL, player.GetCore().SetPlaybackRate(1.0));
+
+	PlayClip(&player, 10 * SECOND, SECOND);
+	CHECK_EQ(E_INVALIDARG, player.GetCore().SetPlaybackRate(0.0));
+	CHECK_EQ(E_INVALIDARG, player.GetCore().SetPlaybackRate(4.5));
+	CHECK_EQ(E_INVALIDARG, player.GetCore().SetPlaybackRate(-0.1));
+	CHECK_EQ(1.0, GetStats(&player).rate);
+
+	// native rates are played by the decoder, on its own clock
+	REQUIRE_HR(player.GetCore().SetPlaybackRate(2.0));
+	LONGLONG before = player.GetPosition();
+	player.Run(SECOND);
+	CHECK_EQ(before + 2 * SECOND, player.GetPosition());
+	CHECK_EQ(0u, GetStats(&player).trickPlay);
+
+	REQUIRE_HR(player.GetCore().SetPlaybackRate(0.5));
+	before = player.GetPosition();
+	player.Run(SECOND);
+	CHECK(std::llabs(before + SECOND / 2 - player.GetPosition()) < TEST_FRAME_DURATION);
+}
+
+// Past the native rates the decoder pauses and keyframes are sought per render tick; back at rate 1 it plays on
+// from the frame on screen
+CORE_TEST(TrickPlayEntryAndExit)
+{
+	CSoftwarePlayer player;
+	PlayClip(&player, 60 * SECOND, 30 * SECOND);
+	player.GetCore().SetFrameCacheBudget(0);
+	player.GetStates().Clear();
+
+	REQUIRE_HR(player.GetCore().SetPlaybackRate(-4.0));
+	CHECK_EQ(1u, GetStats(&player).trickPlay);
+	CHECK_EQ(1u, player.GetStates().Count(StateType::StateType_StateChanged, PlaybackState::PlaybackState_Paused));
+
+	// wall clock drives trick play; at -4 a grid step of 0.5s is due every 125ms
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (GetStats(&player).trickPlayFrames < 2 && std::chrono::steady_clock::now() < deadline)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		player.GetCore().RenderEvent();
+	}
+
+	FRAME_SCHEDULER_STATS stats = GetStats(&player);
+	CHECK(stats.trickPlayFrames >= 2);
+	CHECK_EQ(-4.0, stats.rate);
+
+	LONGLONG position = player.GetPosition();
+	CHECK(position < 30 * SECOND);
+	CHECK_EQ(0ll, position % _TrickPlayGrid_);
+
+	// the virtual clock does not move a paused decoder
+	player.Run(SECOND);
+	CHECK(player.GetPosition() <= position);
+
+	REQUIRE_HR(player.GetCore().SetPlaybackRate(1.0));
+	CHECK_EQ(0u, GetStats(&player).trickPlay);
+	CHECK_EQ(1u, player.GetStates().Count(StateType::StateType_StateChanged, PlaybackState::PlaybackState_Playing));
+
+	position = player.GetPosition();
+	player.Run(SECOND);
+	CHECK_EQ(position + SECOND, player.GetPosition());
+}
+
+// Entering trick play while paused only arms it; Play starts it, and it stops at the start of the media
+CORE_TEST(TrickPlayStopsAtTheStart)
+{
+	CSoftwarePlayer player;
+	PlayClip(&player, 10 * SECOND, SECOND);
+	player.GetCore().Pause();
+
+	REQUIRE_HR(player.GetCore().SetPlaybackRate(-4.0));
+	CHECK_EQ(0u, GetStats(&player).trickPlay);
+	CHECK_EQ(-4.0, GetStats(&player).rate);
+
+	REQUIRE_HR(player.GetCore().Play());
+	CHECK_EQ(1u, GetStats(&player).trickPlay);
+
+	// a second back at -4 is over after 250ms
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (GetStats(&player).trickPlay && std::chrono::steady_clock::now() < deadline)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		player.GetCore().RenderEvent();
+	}
+
+	CHECK_EQ(0u, GetStats(&player).trickPlay);
+	CHECK_EQ(0, player.GetPosition());
+}
+
+// Trick play targets land on keyframes, and those passed while the decoder was busy are counted
+CORE_TEST(SchedulerSnapsToKeyframes)
+{
+	CFrameScheduler scheduler;
+	scheduler.SetKeyframeIndex(MakeKeyframeIndex());
+	scheduler.SetDuration(60 * SECOND);
+	REQUIRE_HR(scheduler.SetRate(4.0));
+
+	scheduler.Start(10 * SECOND, 0);
+
+	INT64 target = 0;
+	CHECK(!scheduler.GetNextTarget(SECOND / 10, &target));			// 10.4s, still the keyframe at 10s
+
+	REQUIRE(scheduler.GetNextTarget(SECOND, &target));				// 14s
+	CHECK_EQ(14 * SECOND, target);
+
+	// the frame is not in yet: nothing new until it is, or until it is given up
+	CHECK(!scheduler.GetNextTarget(SECOND + SECOND / 20, &target));
+	scheduler.OnFrame(14 * SECOND);
+
+	REQUIRE(scheduler.GetNextTarget(2 * SECOND, &target));			// 18s, 16s was passed over as 12s was
+	CHECK_EQ(18 * SECOND, target);
+
+	FRAME_SCHEDULER_STATS stats;
+	scheduler.GetStats(&stats);
+	CHECK_EQ(1u, stats.trickPlayFrames);
+	CHECK_EQ(2u, stats.skippedKeyframes);
+
+	// a target whose frame never arrives is given up
+	REQUIRE(scheduler.GetNextTarget(2 * SECOND + _TrickPlayTargetTimeout_, &target));
+
+	// the end of the media ends trick play on its last keyframe
+	CHECK(scheduler.GetNextTarget(60 * SECOND, &target));
+	CHECK_EQ(58 * SECOND, target);
+	CHECK(!scheduler.IsRunning());
+}
+
+CORE_TEST(SchedulerMeasuresTheFrameDuration)
+{
+	CFrameScheduler scheduler;
+	CHECK_EQ(_DefaultFrameDuration_, scheduler.GetFrameDuration());
+
+	// 25 fps
+	scheduler.OnFrame(0);
+	scheduler.OnFrame(400000);
+	CHECK_EQ(400000ll, scheduler.GetFrameDuration());
+
+	// jumps are not frame durations
+	scheduler.OnFrame(10 * SECOND);
+	CHECK_EQ(400000ll, scheduler.GetFrameDuration());
+
+	// nor are the frames either side of a step
+	scheduler.GetStepTarget(10 * SECOND, 1);
+	scheduler.OnFrame(10 * SECOND + 100000);
+	CHECK_EQ(400000ll, scheduler.GetFrameDuration());
+
+	// or of a seek
+	scheduler.OnSeek();
+	scheduler.OnFrame(10 * SECOND + 100020);
+	CHECK_EQ(400000ll, scheduler.GetFrameDuration());
+
+	scheduler.Reset();
+	CHECK_EQ(_DefaultFrameDuration_, scheduler.GetFrameDuration());
+}
+
+// Steps stay within the media: the first frame at the start, the last at the end
+CORE_TEST(StepAtTheEdgesOfTheMedia)
+{
+	CSoftwarePlayer player;
+	PlayClip(&player, 2 * SECOND, 0);
+	player.GetStates().Clear();
+
+	REQUIRE_HR(player.GetCore().StepFrame(-1));
+	CHECK_EQ(0, player.GetPosition());
+	CHECK_EQ(1u, player.GetStates().Count(StateType::StateType_StateChanged, PlaybackState::PlaybackState_Paused));
+
+	REQUIRE_HR(player.GetCore().StepFrame(1));
+	CHECK_EQ(TEST_FRAME_DURATION, player.GetPosition());
+
+	REQUIRE_HR(player.GetCore().StepFrame(1000));
+	CHECK_EQ(2 * SECOND - TEST_FRAME_DURATION, player.GetPosition());
+	REQUIRE_HR(player.GetCore().StepFrame(1));
+	CHECK_EQ(2 * SECOND - TEST_FRAME_DURATION, player.GetPosition());
+	CHECK_EQ(0u, player.GetStates().Count(StateType::StateType_StateChanged, PlaybackState::PlaybackState_Ended));
+
+	REQUIRE_HR(player.GetCore().StepFrame(-1000));
+	CHECK_EQ(0, player.GetPosition());
+
+	CHECK_EQ(S_OK, player.GetCore().StepFrame(0));
+	CHECK_EQ(5u, GetStats(&player).steps);
+
+	CSoftwarePlayer live;
+	PlayClip(&live, 0, SECOND, false);
+	CHECK_EQ(S_FALSE, live.GetCore().StepFrame(-1));
+}
+
+// Steps back within the frames just played come from the frame cache, the decoder is not sought; without the
+// cache every step is a seek
+CORE_TEST(BackwardStepsAreServedFromTheCache)
+{
+	CSoftwarePlayer player;
+	PlayClip(&player, 10 * SECOND, SECOND);
+	player.GetCore().Pause();
+
+	LONGLONG position = player.GetPosition();
+	UINT64 lastDecoded = player.GetPresentedFrame();
+	FRAME_CACHE_STATS before = GetCacheStats(&player);
+
+	for (INT32 i = 1; i <= 10; i++)
+	{
+		REQUIRE_HR(player.GetCore().StepFrame(-1));
+		CHECK_EQ(position - i * TEST_FRAME_DURATION, player.GetPosition());
+		CHECK_EQ(lastDecoded - i, player.GetPresentedFrame());
+	}
+
+	FRAME_CACHE_STATS after = GetCacheStats(&player);
+	CHECK_EQ(before.hits + 10, after.hits);
+	CHECK_EQ(before.misses, after.misses);
+
+	// and forward again over the same frames
+	REQUIRE_HR(player.GetCore().StepFrame(3));
+	CHECK_EQ(position - 7 * TEST_FRAME_DURATION, player.GetPosition());
+	CHECK_EQ(before.hits + 11, GetCacheStats(&player).hits);
+
+	// Play continues from the frame on screen
+	REQUIRE_HR(player.GetCore().Play());
+	player.Run(TEST_FRAME_DURATION);
+	CHECK_EQ(position - 6 * TEST_FRAME_DURATION, player.GetPosition());
+
+	player.GetCore().SetFrameCacheBudget(0);
+	player.GetCore().Pause();
+	UINT64 decoded = player.GetPresentedFrame();
+
+	REQUIRE_HR(player.GetCore().StepFrame(-1));
+	REQUIRE_HR(player.GetCore().StepFrame(-1));
+	CHECK_EQ(decoded + 2, player.GetPresentedFrame());
+	CHECK_EQ(position - 8 * TEST_FRAME_DURATION, player.GetPosition());
+}
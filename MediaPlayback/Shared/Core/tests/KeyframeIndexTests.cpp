@@ -0,0 +1,282 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ContainerBuilder.h"
+#include "CoreTest.h"
+#include "KeyframeIndex.h"
+
+#include <chrono>
+#include <random>
+
+#define MS(ms) ((INT64)(ms) * 10000)
+
+
+// Ten samples of 100ms at timescale 1000, keyframes 1, 5 and 9
+static MP4_TRACK_TABLES MakeTables()
+{
+	MP4_TRACK_TABLES tables;
+	tables.timescale = 1000;
+	tables.timeToSample = { { 10, 100 } };
+	tables.syncSamples = { 1, 5, 9 };
+	tables.sampleCount = 10;
+	tables.editMediaTime = -1;
+
+	return tables;
+}
+
+// Fragmented MP4 of one moof: samples of 100ms at timescale 10000 with the given flags and composition offsets
+static ContainerBytes MakeFragmentedMp4(_In_ const std::vector<std::pair<UINT32, UINT32>>& samples, _In_ UINT64 baseDecodeTime)
+{
+	MP4_TRACK_TABLES tables = MakeTables();
+	tables.timescale = 10000;
+	tables.timeToSample.clear();
+	tables.syncSamples.clear();
+	tables.sampleCount = 0;
+
+	ContainerBytes trun = MakeFields({ { 0x000C00, 4 }, { samples.size(), 4 } });		// version 0, flags and offsets per sample
+	for (const auto& sample : samples)
+	{
+		AppendBigEndian(&trun, sample.first, 4);
+		AppendBigEndian(&trun, sample.second, 4);
+	}
+
+	return Concat(
+	{
+		MakeFileType(),
+		MakeBox("moov", Concat(
+		{
+			MakeMovieHeader(),
+			MakeVideoTrack(1, tables),
+			MakeBox("mvex", MakeBox("trex", MakeFields({ { 0, 4 }, { 1, 4 }, { 1, 4 }, { 1000, 4 }, { 0, 4 }, { 0x00010000, 4 } }))),
+		})),
+		MakeBox("moof", MakeBox("traf", Concat(
+		{
+			MakeBox("tfhd", MakeFields({ { 0, 4 }, { 1, 4 } })),
+			MakeBox("tfdt", MakeFields({ { 0x01000000, 4 }, { baseDecodeTime, 8 } })),
+			MakeBox("trun", trun),
+		}))),
+	});
+}
+
+static HRESULT BuildIndex(_In_ const ContainerBytes& file, _Out_ CKeyframeIndex* pIndex)
+{
+	CMemorySource source(file);
+	return pIndex->Build(&source);
+}
+
+static double MeasureSeconds(_In_ const std::chrono::steady_clock::time_point& start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+CORE_TEST(IndexesSyncSamples)
+{
+	CKeyframeIndex index;
+	REQUIRE_HR(BuildIndex(MakeProgressiveMp4(MakeTables()), &index));
+
+	CHECK(index.GetKeyframeTimes() == std::vector<INT64>({ MS(0), MS(400), MS(800) }));
+	CHECK(!index.IsEverySampleSync());
+
+	CHECK_EQ(MS(400), index.FindSeekPosition(MS(700), SeekMode::SeekMode_PreviousKeyframe));
+	CHECK_EQ(MS(800), index.FindSeekPosition(MS(700), SeekMode::SeekMode_NearestKeyframe));
+	CHECK_EQ(MS(700), index.FindSeekPosition(MS(700), SeekMode::SeekMode_Accurate));
+	CHECK_EQ(MS(800), index.FindSeekPosition(MS(5000), SeekMode::SeekMode_NearestKeyframe));
+	CHECK_EQ(MS(0), index.FindSeekPosition(-MS(10), SeekMode::SeekMode_PreviousKeyframe));
+}
+
+// B-frames: composition offsets move the keyframes, the edit list moves them back
+CORE_TEST(CompositionOffsetsAndEditList)
+{
+	MP4_TRACK_TABLES tables = MakeTables();
+	tables.compositionOffsets = { { 10, 200 } };
+	tables.editMediaTime = 200;
+
+	CKeyframeIndex index;
+	REQUIRE_HR(BuildIndex(MakeProgressiveMp4(tables), &index));
+	CHECK(index.GetKeyframeTimes() == std::vector<INT64>({ MS(0), MS(400), MS(800) }));
+
+	// negative offsets in a version 0 ctts, as writers put them; before the start they are clamped to it
+	tables.compositionOffsets = { { 10, (UINT32)-100 } };
+	tables.editMediaTime = -1;
+	REQUIRE_HR(BuildIndex(MakeProgressiveMp4(tables), &index));
+	CHECK(index.GetKeyframeTimes() == std::vector<INT64>({ MS(0), MS(300), MS(700) }));
+}
+
+// Without stss every sample is a keyframe: nothing is listed and seeks go where they are asked to
+CORE_TEST(EverySampleSyncIsNotListed)
+{
+	MP4_TRACK_TABLES tables = MakeTables();
+	tables.syncSamples.clear();
+	tables.timeToSample = { { 200000000, 1 } };
+	tables.sampleCount = 200000000;
+
+	auto start = std::chrono::steady_clock::now();
+
+	CKeyframeIndex index;
+	CHECK_EQ(S_OK, BuildIndex(MakeProgressiveMp4(tables), &index));
+	CHECK(MeasureSeconds(start) < 1.0);
+
+	CHECK(index.IsEverySampleSync());
+	CHECK(index.IsIndexed());
+	CHECK(index.IsEmpty());
+	CHECK_EQ(MS(1234), index.FindSeekPosition(MS(1234), SeekMode::SeekMode_PreviousKeyframe));
+	CHECK_EQ(MS(1234), index.FindSeekPosition(MS(1234), SeekMode::SeekMode_NearestKeyframe));
+
+	index.Clear();
+	CHECK(!index.IsIndexed());
+}
+
+// stts claiming more samples than stsz, or more than any file has, is not walked
+CORE_TEST(HostileSampleCountsFail)
+{
+	MP4_TRACK_TABLES tables = MakeTables();
+	tables.syncSamples.clear();
+	tables.timeToSample = { { 0xFFFFFFFF, 1 } };
+	tables.sampleCount = 100;
+
+	auto start = std::chrono::steady_clock::now();
+
+	CKeyframeIndex index;
+	CHECK_EQ(E_INVALIDARG, BuildIndex(MakeProgressiveMp4(tables), &index));
+	CHECK(!index.IsIndexed());
+
+	// without stsz, 1000 runs of 4 billion samples
+	tables.timeToSample.assign(1000, std::make_pair(0xFFFFFFFFu, 1u));
+	tables.sampleCount = 0;
+	CHECK_EQ(E_INVALIDARG, BuildIndex(MakeProgressiveMp4(tables), &index));
+
+	// with stss as well
+	tables.syncSamples = { 1, 0x7FFFFFFF, 0xFFFFFFFF };
+	CHECK_EQ(E_INVALIDARG, BuildIndex(MakeProgressiveMp4(tables), &index));
+
+	CHECK(MeasureSeconds(start) < 1.0);
+
+	// sync samples past the end of the track are ignored
+	tables = MakeTables();
+	tables.syncSamples = { 1, 9, 11, 0xFFFFFFFF };
+	REQUIRE_HR(BuildIndex(MakeProgressiveMp4(tables), &index));
+	CHECK(index.GetKeyframeTimes() == std::vector<INT64>({ MS(0), MS(800) }));
+}
+
+// trun composition offsets are signed in version 0 as well, as ctts offsets are
+CORE_TEST(FragmentCompositionOffsetsAreSigned)
+{
+	ContainerBytes file = MakeFragmentedMp4(
+	{
+		{ 0, 2000 },						// sync, +200ms
+		{ 0x00010000, 0 },					// not sync
+		{ 0, (UINT32)-1000 },				// sync at 200ms, -100ms
+	}, 0);
+
+	CKeyframeIndex index;
+	REQUIRE_HR(BuildIndex(file, &index));
+	CHECK(index.GetKeyframeTimes() == std::vector<INT64>({ MS(100), MS(200) }));
+}
+
+CORE_TEST(HostileFragmentTimesFail)
+{
+	CKeyframeIndex index;
+
+	// a tfdt near the end of the 64-bit range
+	CHECK_EQ(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), BuildIndex(MakeFragmentedMp4({ { 0, 0 } }, 0x7FFFFFFFFFFFFF00ull), &index));
+	CHECK(!index.IsIndexed());
+
+	// a large but sane one
+	REQUIRE_HR(BuildIndex(MakeFragmentedMp4({ { 0, 0 } }, 36000ull * 10000 * 24), &index));
+	CHECK(index.GetKeyframeTimes() == std::vector<INT64>({ 36000ll * 10000000 * 24 }));
+
+	// a sidx with an earliest presentation time as large
+	ContainerBytes sidx = Concat({ MakeFileType(), MakeBox("sidx", MakeFields(
+	{
+		{ 0x01000000, 4 }, { 1, 4 }, { 1000, 4 }, { 0xFFFFFFFFFFFFFFF0ull, 8 }, { 0, 8 }, { 0, 2 }, { 1, 2 },
+		{ 100, 4 }, { 2000, 4 }, { 0x90000000, 4 },
+	})) });
+	CHECK_EQ(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), BuildIndex(sidx, &index));
+}
+
+CORE_TEST(IndexesMatroskaCues)
+{
+	CKeyframeIndex index;
+	REQUIRE_HR(BuildIndex(MakeMatroska(1000000, { 0, 2000, 4500 }), &index));
+	CHECK(index.GetKeyframeTimes() == std::vector<INT64>({ MS(0), MS(2000), MS(4500) }));
+
+	// a cue time that overflows nanoseconds is dropped, not wrapped
+	REQUIRE_HR(BuildIndex(MakeMatroska(1000000, { 0, 2000, 0xFFFFFFFFFFFFull }), &index));
+	CHECK(index.GetKeyframeTimes() == std::vector<INT64>({ MS(0), MS(2000) }));
+
+	REQUIRE_HR(BuildIndex(MakeMatroska(1000000000000000ull, { 0, 1000000 }), &index));
+	CHECK(index.GetKeyframeTimes() == std::vector<INT64>({ 0 }));
+
+	// a zero scale is taken for the default one
+	REQUIRE_HR(BuildIndex(MakeMatroska(0, { 0, 2000 }), &index));
+	CHECK(index.GetKeyframeTimes() == std::vector<INT64>({ MS(0), MS(2000) }));
+}
+
+CORE_TEST(NotAContainer)
+{
+	CKeyframeIndex index;
+	CHECK_EQ(S_FALSE, BuildIndex(ContainerBytes(), &index));
+	CHECK_EQ(S_FALSE, BuildIndex(ContainerBytes(100, 0x47), &index));
+	CHECK_EQ(E_INVALIDARG, index.Build(nullptr));
+}
+
+// Every truncation of the files above, and random damage to them, indexes or fails without reading out of bounds;
+// run under the sanitizers
+CORE_TEST(TruncatedAndDamagedFiles)
+{
+	MP4_TRACK_TABLES tables = MakeTables();
+	tables.compositionOffsets = { { 4, 200 }, { 6, (UINT32)-100 } };
+	tables.editMediaTime = 100;
+
+	const ContainerBytes c_files[] =
+	{
+		MakeProgressiveMp4(tables),
+		MakeFragmentedMp4({ { 0, 2000 }, { 0x00010000, 0 }, { 0, (UINT32)-1000 } }, 5000),
+		MakeMatroska(1000000, { 0, 2000, 4500 }),
+	};
+
+	std::mt19937 random(18);
+	auto start = std::chrono::steady_clock::now();
+
+	for (const ContainerBytes& file : c_files)
+	{
+		for (size_t size = 0; size < file.size(); size++)
+		{
+			ContainerBytes truncated(file.begin(), file.begin() + size);
+
+			CKeyframeIndex index;
+			HRESULT hr = BuildIndex(truncated, &index);
+			CHECK(FAILED(hr) || hr == S_FALSE || index.IsIndexed());
+		}
+
+		for (int round = 0; round < 2000; round++)
+		{
+			ContainerBytes damaged = file;
+			for (int i = 0; i < 3; i++)
+			{
+				static const BYTE c_interesting[] = { 0x00, 0x01, 0x7F, 0x80, 0xFF };
+				damaged[random() % damaged.size()] = (random() & 1) ? c_interesting[random() % sizeof(c_interesting)] : (BYTE)random();
+			}
+
+			CKeyframeIndex index;
+			HRESULT hr = BuildIndex(damaged, &index);
+			CHECK(FAILED(hr) || hr == S_FALSE || index.IsIndexed());
+
+			// what was indexed is still ordered and without duplicates
+			const std::vector<INT64>& times = index.GetKeyframeTimes();
+			for (size_t i = 1; i < times.size(); i++)
+				CHECK(times[i] > times[i - 1]);
+		}
+	}
+
+	CHECK(MeasureSeconds(start) < 30.0);
+}
@@ -0,0 +1,280 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreTest.h"
+#include "SoftwarePlayer.h"
+
+#include <condition_variable>
+#include <future>
+#include <thread>
+
+
+// Single worker the test holds at a gate, so requests queue up until it lets them run
+class CGatedWorkers
+{
+public:
+	CGatedWorkers()
+		: m_spPool(std::make_shared<CWorkerPool>())
+		, m_open(false)
+	{
+		m_spPool->Start(1);
+		m_spPool->Submit([this]()
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
+			m_opened.wait(lock, [this]() { return m_open; });
+		});
+	}
+
+	~CGatedWorkers()
+	{
+		Open();
+		m_spPool->Shutdown();
+	}
+
+	const std::shared_ptr<CWorkerPool>& GetPool() { return m_spPool; }
+
+	// Lets the queued requests run and waits for them
+	void Drain()
+	{
+		Open();
+
+		std::promise<void> drained;
+		m_spPool->Submit([&drained]() { drained.set_value(); });
+		drained.get_future().wait();
+	}
+
+private:
+	void Open()
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_open = true;
+		m_opened.notify_all();
+	}
+
+	std::shared_ptr<CWorkerPool> m_spPool;
+	std::mutex m_lock;
+	std::condition_variable m_opened;
+	bool m_open;
+};
+
+static void RegisterClips(_In_ CSoftwarePlayer& player)
+{
+	player.GetBackend()->RegisterMedia(L"first.mp4", MakeSoftwareMedia(64, 64, 1 * SOFTWARE_TICKS_PER_SECOND));
+	player.GetBackend()->RegisterMedia(L"second.mp4", MakeSoftwareMedia(64, 64, 2 * SOFTWARE_TICKS_PER_SECOND));
+	player.GetBackend()->RegisterMedia(L"third.mp4", MakeSoftwareMedia(64, 64, 3 * SOFTWARE_TICKS_PER_SECOND));
+}
+
+static LONGLONG GetLoadedDuration(_In_ CSoftwarePlayer& player)
+{
+	LONGLONG duration = -1;
+	LONGLONG position = 0;
+	if (FAILED(player.GetCore().GetDurationAndPosition(&duration, &position)))
+		return -1;
+
+	return duration;
+}
+
+
+CORE_TEST(AsyncLoadReportsCompletion)
+{
+	CGatedWorkers workers;
+	CSoftwarePlayer player;
+	RegisterClips(player);
+	REQUIRE_HR(player.Initialize());
+	player.GetCore().SetLoadWorkerPool(workers.GetPool());
+
+	UINT32 requestId = 0;
+	REQUIRE_HR(player.GetCore().LoadContentAsync(L"first.mp4", &requestId));
+	CHECK(requestId != 0);
+
+	// nothing happens on the calling thread
+	CHECK_EQ(0u, player.GetStates().Count(StateType::StateType_LoadCompleted));
+	CHECK_EQ(-1, GetLoadedDuration(player));
+
+	workers.Drain();
+
+	PLAYBACK_STATE completed = {};
+	REQUIRE(player.GetStates().FindLast(StateType::StateType_LoadCompleted, &completed));
+	CHECK_EQ(requestId, completed.requestId);
+	CHECK_EQ(S_OK, completed.hresult);
+	CHECK_EQ(1 * SOFTWARE_TICKS_PER_SECOND, GetLoadedDuration(player));
+}
+
+CORE_TEST(AsyncLoadReportsFailure)
+{
+	CGatedWorkers workers;
+	CSoftwarePlayer player;
+	REQUIRE_HR(player.Initialize());
+	player.GetCore().SetLoadWorkerPool(workers.GetPool());
+
+	UINT32 requestId = 0;
+	REQUIRE_HR(player.GetCore().LoadContentAsync(L"missing.mp4", &requestId));
+	workers.Drain();
+
+	PLAYBACK_STATE completed = {};
+	REQUIRE(player.GetStates().FindLast(StateType::StateType_LoadCompleted, &completed));
+	CHECK_EQ(requestId, completed.requestId);
+	CHECK_EQ(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND), completed.hresult);
+}
+
+CORE_TEST(NewerAsyncLoadSupersedes)
+{
+	CGatedWorkers workers;
+	CSoftwarePlayer player;
+	RegisterClips(player);
+	REQUIRE_HR(player.Initialize());
+	player.GetCore().SetLoadWorkerPool(workers.GetPool());
+
+	UINT32 firstId = 0;
+	UINT32 secondId = 0;
+	REQUIRE_HR(player.GetCore().LoadContentAsync(L"first.mp4", &firstId));
+	REQUIRE_HR(player.GetCore().LoadContentAsync(L"second.mp4", &secondId));
+	CHECK(firstId != secondId);
+
+	workers.Drain();
+
+	// the older request completes silently
+	CHECK_EQ(1u, player.GetStates().Count(StateType::StateType_LoadCompleted));
+
+	PLAYBACK_STATE completed = {};
+	REQUIRE(player.GetStates().FindLast(StateType::StateType_LoadCompleted, &completed));
+	CHECK_EQ(secondId, completed.requestId);
+	CHECK_EQ(2 * SOFTWARE_TICKS_PER_SECOND, GetLoadedDuration(player));
+}
+
+CORE_TEST(SyncLoadSupersedes)
+{
+	CGatedWorkers workers;
+	CSoftwarePlayer player;
+	RegisterClips(player);
+	REQUIRE_HR(player.Initialize());
+	player.GetCore().SetLoadWorkerPool(workers.GetPool());
+
+	UINT32 requestId = 0;
+	REQUIRE_HR(player.GetCore().LoadContentAsync(L"first.mp4", &requestId));
+	REQUIRE_HR(player.GetCore().LoadContent(L"second.mp4"));
+
+	workers.Drain();
+
+	CHECK_EQ(0u, player.GetStates().Count(StateType::StateType_LoadCompleted));
+	CHECK_EQ(2 * SOFTWARE_TICKS_PER_SECOND, GetLoadedDuration(player));
+}
+
+CORE_TEST(StopSupersedes)
+{
+	CGatedWorkers workers;
+	CSoftwarePlayer player;
+	RegisterClips(player);
+	REQUIRE_HR(player.Initialize());
+	player.GetCore().SetLoadWorkerPool(workers.GetPool());
+
+	UINT32 requestId = 0;
+	REQUIRE_HR(player.GetCore().LoadContentAsync(L"first.mp4", &requestId));
+	REQUIRE_HR(player.GetCore().Stop());
+
+	workers.Drain();
+
+	CHECK_EQ(0u, player.GetStates().Count(StateType::StateType_LoadCompleted));
+	CHECK_EQ(-1, GetLoadedDuration(player));
+}
+
+CORE_TEST(CancelSupersedesAndKeepsTheLoadedContent)
+{
+	CGatedWorkers workers;
+	CSoftwarePlayer player;
+	RegisterClips(player);
+	REQUIRE_HR(player.Initialize());
+	player.GetCore().SetLoadWorkerPool(workers.GetPool());
+
+	REQUIRE_HR(player.GetCore().LoadContent(L"third.mp4"));
+
+	UINT32 requestId = 0;
+	REQUIRE_HR(player.GetCore().LoadContentAsync(L"first.mp4", &requestId));
+	REQUIRE_HR(player.GetCore().CancelLoadContentAsync());
+
+	workers.Drain();
+
+	CHECK_EQ(0u, player.GetStates().Count(StateType::StateType_LoadCompleted));
+	CHECK_EQ(3 * SOFTWARE_TICKS_PER_SECOND, GetLoadedDuration(player));
+}
+
+CORE_TEST(AsyncLoadNeedsAWorkerPool)
+{
+	CSoftwarePlayer player;
+	RegisterClips(player);
+	REQUIRE_HR(player.Initialize());
+
+	UINT32 requestId = 0;
+	CHECK_EQ(E_ILLEGAL_METHOD_CALL, player.GetCore().LoadContentAsync(L"first.mp4", &requestId));
+}
+
+// A load in progress on the worker when the player goes away is waited for, not left with a dangling player
+CORE_TEST(PlayerOutlivesItsPendingLoads)
+{
+	std::shared_ptr<CWorkerPool> spPool = std::make_shared<CWorkerPool>();
+	REQUIRE_HR(spPool->Start(1));
+
+	{
+		CSoftwarePlayer player;
+		SOFTWARE_MEDIA_DESCRIPTION media = MakeSoftwareMedia(64, 64, SOFTWARE_TICKS_PER_SECOND);
+		media.openBlockingTime = 50;
+		player.GetBackend()->RegisterMedia(L"slow.mp4", media);
+		REQUIRE_HR(player.Initialize());
+		player.GetCore().SetLoadWorkerPool(spPool);
+
+		UINT32 requestId = 0;
+		REQUIRE_HR(player.GetCore().LoadContentAsync(L"slow.mp4", &requestId));
+		REQUIRE_HR(player.GetCore().LoadContentAsync(L"slow.mp4", &requestId));
+	}
+
+	CHECK_EQ(0u, spPool->GetPendingCount());
+	spPool->Shutdown();
+}
+
+// Loads dropped by a pool shutdown never run, the player does not wait for them when it goes away
+CORE_TEST(PlayerOutlivesLoadsDroppedByAPoolShutdown)
+{
+	std::shared_ptr<CWorkerPool> spPool = std::make_shared<CWorkerPool>();
+	REQUIRE_HR(spPool->Start(1));
+
+	// holds the only worker, so the load stays queued
+	std::promise<void> started;
+	std::promise<void> release;
+	std::shared_future<void> released = release.get_future().share();
+	REQUIRE_HR(spPool->Submit([&started, released]()
+	{
+		started.set_value();
+		released.wait();
+	}));
+	started.get_future().wait();
+
+	{
+		CSoftwarePlayer player;
+		RegisterClips(player);
+		REQUIRE_HR(player.Initialize());
+		player.GetCore().SetLoadWorkerPool(spPool);
+
+		UINT32 requestId = 0;
+		REQUIRE_HR(player.GetCore().LoadContentAsync(L"first.mp4", &requestId));
+		CHECK_EQ(1u, spPool->GetPendingCount());
+
+		std::thread shutdown([&spPool]() { spPool->Shutdown(); });
+		while (spPool->GetPendingCount() != 0)
+		{
+			std::this_thread::yield();
+		}
+
+		release.set_value();
+		shutdown.join();
+
+		CHECK_EQ(0u, player.GetStates().Count(StateType::StateType_LoadCompleted));
+	}
+}
@@ -0,0 +1,268 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreTest.h"
+#include "LoopTracker.h"
+#include "SoftwarePlayer.h"
+
+#define SECOND SOFTWARE_TICKS_PER_SECOND
+
+
+static LOOP_STATS GetStats(_In_ const CLoopTracker& tracker)
+{
+	LOOP_STATS stats = {};
+	tracker.GetStats(&stats);
+
+	return stats;
+}
+
+static LOOP_STATS GetStats(_In_ CSoftwarePlayer* pPlayer)
+{
+	LOOP_STATS stats = {};
+	pPlayer->GetCore().GetLoopStats(&stats);
+
+	return stats;
+}
+
+static UINT64 GetFrameCounter(_In_ CSoftwarePlayer* pPlayer)
+{
+	const PLAYBACK_STATUS* pStatus = nullptr;
+	pPlayer->GetCore().GetPlaybackStatus(&pStatus);
+
+	return pStatus ? pStatus->frameCounter : 0;
+}
+
+// Player with a paused clip of duration open and a first frame shown
+static void OpenClip(_In_ CSoftwarePlayer* pPlayer, _In_ LONGLONG duration)
+{
+	pPlayer->GetBackend()->RegisterMedia(L"clip.mp4", MakeSoftwareMedia(64, 36, duration));
+	pPlayer->Initialize();
+	pPlayer->GetCore().LoadContent(L"clip.mp4");
+	pPlayer->Run(TEST_FRAME_DURATION);
+}
+
+
+CORE_TEST(LoopRangesAreValidated)
+{
+	CLoopTracker tracker;
+	CHECK_EQ(E_INVALIDARG, tracker.SetLoop(true, -1, 0));
+	CHECK_EQ(E_INVALIDARG, tracker.SetLoop(true, 0, -1));
+	CHECK_EQ(E_INVALIDARG, tracker.SetLoop(true, SECOND, SECOND));
+	CHECK_EQ(E_INVALIDARG, tracker.SetLoop(true, 2 * SECOND, SECOND));
+	CHECK(!tracker.IsEnabled());
+
+	REQUIRE_HR(tracker.SetLoop(true, SECOND, 0));
+	CHECK(tracker.IsEnabled());
+	CHECK(!tracker.IsRange());
+
+	REQUIRE_HR(tracker.SetLoop(true, SECOND, 2 * SECOND));
+	CHECK(tracker.IsRange());
+
+	// disabling forgets the range
+	REQUIRE_HR(tracker.SetLoop(false, SECOND, 2 * SECOND));
+	CHECK(!tracker.IsEnabled());
+	CHECK_EQ(0ll, tracker.GetStart());
+	CHECK_EQ(0ll, tracker.GetEnd());
+}
+
+// A jump back to the start is a wrap, counted with the time between the frames either side of it
+CORE_TEST(TrackerCountsWrapsAndGaps)
+{
+	CLoopTracker tracker;
+	REQUIRE_HR(tracker.SetLoop(true, 0, 0));
+
+	INT64 now = 1000;
+	for (INT64 position = 0; position < SECOND; position += TEST_FRAME_DURATION)
+	{
+		now += TEST_FRAME_DURATION;
+		CHECK(!tracker.OnFrame(position, now));
+	}
+
+	CHECK(tracker.OnFrame(0, now + 500));
+	CHECK(!tracker.OnFrame(TEST_FRAME_DURATION, now + 500 + TEST_FRAME_DURATION));
+
+	LOOP_STATS stats = GetStats(tracker);
+	CHECK_EQ(1u, stats.enabled);
+	CHECK_EQ(1u, stats.loopCount);
+	CHECK_EQ(500ll, stats.lastLoopGap);
+	CHECK_EQ(500ll, stats.maxLoopGap);
+
+	// a second wrap with a smaller gap keeps the max
+	CHECK(tracker.OnFrame(0, now + 600 + 2 * TEST_FRAME_DURATION));
+	stats = GetStats(tracker);
+	CHECK_EQ(2u, stats.loopCount);
+	CHECK_EQ(100ll + TEST_FRAME_DURATION, stats.lastLoopGap);
+	CHECK_EQ(100ll + TEST_FRAME_DURATION, stats.maxLoopGap);
+}
+
+CORE_TEST(TrackerIgnoresSeeksOfTheClient)
+{
+	CLoopTracker tracker;
+	REQUIRE_HR(tracker.SetLoop(true, SECOND, 3 * SECOND));
+
+	tracker.OnFrame(2 * SECOND, 0);
+	tracker.OnFrame(2 * SECOND + TEST_FRAME_DURATION, TEST_FRAME_DURATION);
+
+	// back, but not to the start
+	CHECK(!tracker.OnFrame(SECOND + 10 * TEST_FRAME_DURATION, 2 * TEST_FRAME_DURATION));
+	CHECK_EQ(0u, GetStats(tracker).loopCount);
+
+	// after a Reset the next frame follows nothing
+	tracker.Reset();
+	CHECK(!tracker.OnFrame(SECOND, 3 * TEST_FRAME_DURATION));
+
+	// without a loop nothing is a wrap
+	REQUIRE_HR(tracker.SetLoop(false, 0, 0));
+	tracker.OnFrame(SECOND + TEST_FRAME_DURATION, 4 * TEST_FRAME_DURATION);
+	CHECK(!tracker.OnFrame(0, 5 * TEST_FRAME_DURATION));
+	CHECK_EQ(0u, GetStats(tracker).loopCount);
+}
+
+// A range asks for the seek to its start once, one frame before its end, and again on the next pass
+CORE_TEST(TrackerSeeksOnceBeforeTheRangeEnd)
+{
+	CLoopTracker tracker;
+	REQUIRE_HR(tracker.SetLoop(true, SECOND, 2 * SECOND));
+
+	// the frame interval is not known before two frames
+	tracker.OnFrame(SECOND, 0);
+	CHECK(!tracker.ShouldSeekToStart(2 * SECOND - TEST_FRAME_DURATION));
+
+	INT64 position = SECOND + TEST_FRAME_DURATION;
+	tracker.OnFrame(position, TEST_FRAME_DURATION);
+
+	UINT32 seeks = 0;
+	INT64 seekPosition = 0;
+	for (; position < 2 * SECOND; position += TEST_FRAME_DURATION)
+	{
+		tracker.OnFrame(position, position);
+		if (tracker.ShouldSeekToStart(position))
+		{
+			seeks++;
+			seekPosition = position;
+		}
+	}
+
+	CHECK_EQ(1u, seeks);
+	CHECK(seekPosition + TEST_FRAME_DURATION >= 2 * SECOND);
+	CHECK(seekPosition < 2 * SECOND);
+
+	CHECK(tracker.OnFrame(SECOND, 3 * SECOND));
+	tracker.OnFrame(SECOND + TEST_FRAME_DURATION, 3 * SECOND + TEST_FRAME_DURATION);
+	CHECK(!tracker.ShouldSeekToStart(SECOND + TEST_FRAME_DURATION));
+	CHECK(tracker.ShouldSeekToStart(seekPosition));
+
+	// the whole media loops natively, there is nothing to seek
+	REQUIRE_HR(tracker.SetLoop(true, 0, 0));
+	CHECK(!tracker.ShouldSeekToStart(seekPosition));
+}
+
+// The whole clip plays over and over: no Ended state, a frame every render step across the seam
+CORE_TEST(WholeFileLoopIsSeamless)
+{
+	CSoftwarePlayer player;
+	OpenClip(&player, SECOND);
+
+	CHECK_EQ(E_INVALIDARG, player.GetCore().SetLoop(TRUE, SECOND, SECOND / 2));
+	REQUIRE_HR(player.GetCore().SetLoop(TRUE, 0, 0));
+	REQUIRE_HR(player.GetCore().Play());
+
+	UINT64 framesBefore = GetFrameCounter(&player);
+	UINT32 steps = 0;
+	LONGLONG lastPosition = player.GetPosition();
+	UINT32 wraps = 0;
+	for (; steps < 105; steps++)
+	{
+		player.Run(TEST_FRAME_DURATION);
+
+		LONGLONG position = player.GetPosition();
+		if (position < lastPosition)
+		{
+			wraps++;
+			CHECK(position < 2 * TEST_FRAME_DURATION);
+		}
+		else
+		{
+			CHECK(position - lastPosition <= TEST_FRAME_DURATION);
+		}
+
+		lastPosition = position;
+	}
+
+	CHECK_EQ(3u, wraps);
+	CHECK_EQ((UINT64)steps, GetFrameCounter(&player) - framesBefore);
+	CHECK_EQ(0u, player.GetStates().Count(StateType::StateType_StateChanged, PlaybackState::PlaybackState_Ended));
+
+	LOOP_STATS stats = GetStats(&player);
+	CHECK_EQ(1u, stats.enabled);
+	CHECK_EQ(3u, stats.loopCount);
+	CHECK_EQ(0ll, stats.loopEnd);
+	CHECK(stats.lastLoopGap >= 0);
+	CHECK(stats.maxLoopGap >= stats.lastLoopGap);
+}
+
+// An A-B range stays within its bounds once reached and counts every pass
+CORE_TEST(RangeLoopStaysInRange)
+{
+	CSoftwarePlayer player;
+	OpenClip(&player, 3 * SECOND);
+
+	REQUIRE_HR(player.GetCore().SetLoop(TRUE, SECOND / 2, SECOND));
+	REQUIRE_HR(player.GetCore().Play());
+
+	player.Run(SECOND / 2);
+
+	UINT64 framesBefore = GetFrameCounter(&player);
+	for (UINT32 step = 0; step < 60; step++)
+	{
+		player.Run(TEST_FRAME_DURATION);
+
+		LONGLONG position = player.GetPosition();
+		CHECK(position >= SECOND / 2);
+		CHECK(position < SECOND);
+	}
+
+	// two seconds of a half second range: the fourth pass is still under way
+	CHECK_EQ(60u, GetFrameCounter(&player) - framesBefore);
+	LOOP_STATS stats = GetStats(&player);
+	CHECK_EQ(3u, stats.loopCount);
+	CHECK_EQ(SECOND / 2, stats.loopStart);
+	CHECK_EQ(SECOND, stats.loopEnd);
+
+	// a seek inside the range is not a pass
+	REQUIRE_HR(player.GetCore().Seek(SECOND * 3 / 4));
+	player.Run(TEST_FRAME_DURATION);
+	CHECK_EQ(3u, GetStats(&player).loopCount);
+}
+
+// Turning the loop off lets the clip play to its end
+CORE_TEST(LoopOffEndsTheClip)
+{
+	CSoftwarePlayer player;
+	OpenClip(&player, SECOND);
+
+	REQUIRE_HR(player.GetCore().SetLoop(TRUE, 0, 0));
+	REQUIRE_HR(player.GetCore().Play());
+	player.Run(SECOND * 3 / 2);
+	CHECK_EQ(1u, GetStats(&player).loopCount);
+
+	REQUIRE_HR(player.GetCore().SetLoop(FALSE, 0, 0));
+	player.Run(SECOND);
+	CHECK_EQ(1u, player.GetStates().Count(StateType::StateType_StateChanged, PlaybackState::PlaybackState_Ended));
+	CHECK_EQ(SECOND, player.GetPosition());
+
+	LOOP_STATS stats = GetStats(&player);
+	CHECK_EQ(0u, stats.enabled);
+	CHECK_EQ(1u, stats.loopCount);
+
+	CSoftwarePlayer unopened;
+	CHECK_EQ(E_ILLEGAL_METHOD_CALL, unopened.GetCore().SetLoop(TRUE, 0, 0));
+}
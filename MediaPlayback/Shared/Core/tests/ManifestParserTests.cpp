@@ -0,0 +1,372 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreTest.h"
+#include "ManifestParser.h"
+
+#include <limits.h>
+
+#include <random>
+#include <string>
+
+
+static HRESULT Parse(_In_ const std::string& text, _In_ const std::wstring& uri, _Out_ MANIFEST* pManifest)
+{
+	return ParseManifest((const BYTE*)text.data(), text.size(), uri, pManifest);
+}
+
+static const char c_hlsMaster[] =
+	"#EXTM3U\n"
+	"#EXT-X-STREAM-INF:BANDWIDTH=800000,RESOLUTION=640x360,FRAME-RATE=29.970,CODECS=\"avc1.64001e,mp4a.40.2\"\n"
+	"360p/index.m3u8\n"
+	"#EXT-X-STREAM-INF:BANDWIDTH=6000000,RESOLUTION=1920x1080,FRAME-RATE=60,CODECS=\"hvc1.2.4.L150.B0,mp4a.40.2\"\n"
+	"https://other.example.com/1080p/index.m3u8\n"
+	"#EXT-X-MEDIA:TYPE=AUDIO,GROUP-ID=\"aac\",NAME=\"English\",URI=\"audio/en.m3u8\"\n";
+
+static const char c_hlsMedia[] =
+	"#EXTM3U\r\n"
+	"#EXT-X-TARGETDURATION:6\r\n"
+	"#EXT-X-MAP:URI=\"init.mp4\"\r\n"
+	"#EXTINF:6.006,\r\n"
+	"segment1.m4s\r\n"
+	"#EXTINF:5.5,title\r\n"
+	"../shared/segment2.m4s?token=abc\r\n"
+	"#EXT-X-BYTERANGE:1000@500\r\n"
+	"#EXTINF:4,\r\n"
+	"all.mp4\r\n"
+	"#EXT-X-BYTERANGE:2000\r\n"
+	"#EXTINF:4,\r\n"
+	"all.mp4\r\n"
+	"#EXT-X-ENDLIST\r\n";
+
+static const char c_dashTemplate[] =
+	"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	"<!-- number addressed, template on the AdaptationSet -->\n"
+	"<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\" type=\"static\" mediaPresentationDuration=\"PT9.5S\">\n"
+	"  <BaseURL>https://cdn.example.com/dash/</BaseURL>\n"
+	"  <Period>\n"
+	"    <AdaptationSet mimeType=\"video/mp4\" codecs=\"avc1.640028\">\n"
+	"      <SegmentTemplate timescale=\"1000\" duration=\"4000\" startNumber=\"5\" media=\"$RepresentationID$/seg-$Number%05d$.m4s\" initialization=\"$RepresentationID$/init.mp4\"/>\n"
+	"      <Representation id=\"720p\" bandwidth=\"3000000\" width=\"1280\" height=\"720\" frameRate=\"30000/1001\"/>\n"
+	"      <Representation id=\"1080p\" bandwidth=\"6000000\" width=\"1920\" height=\"1080\" frameRate=\"30\"></Representation>\n"
+	"    </AdaptationSet>\n"
+	"    <AdaptationSet mimeType=\"audio/mp4\" codecs=\"mp4a.40.2\">\n"
+	"      <SegmentTemplate timescale=\"48000\" duration=\"192000\" media=\"audio/$Number$.m4s\"/>\n"
+	"      <Representation id=\"aac\" bandwidth=\"128000\"/>\n"
+	"    </AdaptationSet>\n"
+	"  </Period>\n"
+	"</MPD>\n";
+
+static const char c_dashTimeline[] =
+	"<mpd:MPD xmlns:mpd=\"urn:mpeg:dash:schema:mpd:2011\" mediaPresentationDuration=\"PT1M\">\n"
+	"  <mpd:Period id=\"main\" duration=\"PT10S\">\n"
+	"    <mpd:AdaptationSet contentType=\"video\">\n"
+	"      <mpd:SegmentTemplate timescale=\"90000\" media=\"v/$Time$.m4s?a=1&amp;b=2\">\n"
+	"        <mpd:SegmentTimeline>\n"
+	"          <mpd:S t=\"900000\" d=\"180000\" r=\"2\"/>\n"
+	"          <mpd:S d=\"90000\"/>\n"
+	"          <mpd:S t=\"1800000\" d=\"180000\" r=\"-1\"/>\n"
+	"        </mpd:SegmentTimeline>\n"
+	"      </mpd:SegmentTemplate>\n"
+	"      <mpd:Representation id=\"v1\" bandwidth=\"2000000\" codecs=\"av01.0.08M.10\" width=\"1280\" height=\"720\"/>\n"
+	"    </mpd:AdaptationSet>\n"
+	"  </mpd:Period>\n"
+	"</mpd:MPD>\n";
+
+
+CORE_TEST(HlsMasterPlaylistListsRenditions)
+{
+	MANIFEST manifest;
+	REQUIRE_HR(Parse(c_hlsMaster, L"https://cdn.example.com/hls/master.m3u8", &manifest));
+
+	CHECK(manifest.representations.empty());
+	REQUIRE(manifest.playlistUris.size() == 3);
+	CHECK(manifest.playlistUris[0] == L"https://cdn.example.com/hls/360p/index.m3u8");
+	CHECK(manifest.playlistUris[1] == L"https://other.example.com/1080p/index.m3u8");
+	CHECK(manifest.playlistUris[2] == L"https://cdn.example.com/hls/audio/en.m3u8");
+
+	REQUIRE(manifest.renditions.size() == 2);
+	CHECK_EQ((UINT32)800000, manifest.renditions[0].bitrate);
+	CHECK_EQ((UINT32)640, manifest.renditions[0].width);
+	CHECK_EQ((UINT32)360, manifest.renditions[0].height);
+	CHECK_EQ((UINT32)30, manifest.renditions[0].frameRate);
+	CHECK_EQ((UINT32)VideoCodec::VideoCodec_H264, (UINT32)manifest.renditions[0].codec);
+	CHECK_EQ((UINT32)1920, manifest.renditions[1].width);
+	CHECK_EQ((UINT32)60, manifest.renditions[1].frameRate);
+	CHECK_EQ((UINT32)VideoCodec::VideoCodec_HEVC, (UINT32)manifest.renditions[1].codec);
+}
+
+CORE_TEST(HlsMediaPlaylistListsSegments)
+{
+	MANIFEST manifest;
+	REQUIRE_HR(Parse(c_hlsMedia, L"https://cdn.example.com/hls/720p/index.m3u8?session=1", &manifest));
+
+	REQUIRE(manifest.representations.size() == 1);
+	const MANIFEST_REPRESENTATION& representation = manifest.representations[0];
+	CHECK(representation.id == L"https://cdn.example.com/hls/720p/index.m3u8?session=1");
+	REQUIRE(representation.segments.size() == 5);
+
+	// the initialization segment in front of the segments using it
+	CHECK(representation.segments[0].key.uri == L"https://cdn.example.com/hls/720p/init.mp4");
+	CHECK_EQ((INT64)0, representation.segments[0].duration);
+
+	CHECK(representation.segments[1].key.uri == L"https://cdn.example.com/hls/720p/segment1.m4s");
+	CHECK_EQ((INT64)60060000, representation.segments[1].duration);
+	CHECK_EQ((UINT64)0, representation.segments[1].key.rangeLength);
+
+	CHECK(representation.segments[2].key.uri == L"https://cdn.example.com/hls/shared/segment2.m4s?token=abc");
+	CHECK_EQ((INT64)55000000, representation.segments[2].duration);
+
+	// a byte range without an offset continues the previous one
+	CHECK_EQ((UINT64)500, representation.segments[3].key.rangeOffset);
+	CHECK_EQ((UINT64)1000, representation.segments[3].key.rangeLength);
+	CHECK_EQ((UINT64)1500, representation.segments[4].key.rangeOffset);
+	CHECK_EQ((UINT64)2000, representation.segments[4].key.rangeLength);
+}
+
+CORE_TEST(HlsMapRepeatsOnlyWhenItChanges)
+{
+	std::string playlist =
+		"\xEF\xBB\xBF#EXTM3U\n"
+		"#EXT-X-MAP:URI=\"init.mp4\",BYTERANGE=\"720@0\"\n"
+		"#EXTINF:2,\na.m4s\n"
+		"#EXT-X-DISCONTINUITY\n"
+		"#EXT-X-MAP:URI=\"init.mp4\",BYTERANGE=\"720@0\"\n"
+		"#EXTINF:2,\nb.m4s\n"
+		"#EXT-X-DISCONTINUITY\n"
+		"#EXT-X-MAP:URI=\"ad-init.mp4\"\n"
+		"#EXTINF:2,\nc.m4s\n";
+
+	MANIFEST manifest;
+	REQUIRE_HR(Parse(playlist, L"http://example.com/p.m3u8", &manifest));
+	REQUIRE(manifest.representations.size() == 1);
+
+	const std::vector<MANIFEST_SEGMENT>& segments = manifest.representations[0].segments;
+	REQUIRE(segments.size() == 5);
+	CHECK(segments[0].key.uri == L"http://example.com/init.mp4");
+	CHECK_EQ((UINT64)720, segments[0].key.rangeLength);
+	CHECK(segments[2].key.uri == L"http://example.com/b.m4s");
+	CHECK(segments[3].key.uri == L"http://example.com/ad-init.mp4");
+}
+
+CORE_TEST(DashNumberTemplate)
+{
+	MANIFEST manifest;
+	REQUIRE_HR(Parse(c_dashTemplate, L"https://origin.example.com/manifests/title.mpd", &manifest));
+
+	// 9.5s in 4s segments is three segments, plus the initialization segment
+	REQUIRE(manifest.representations.size() == 3);
+
+	const MANIFEST_REPRESENTATION& video = manifest.representations[0];
+	CHECK(video.id == L"https://origin.example.com/manifests/title.mpd#0/720p");
+	CHECK_EQ((UINT32)3000000, video.bandwidth);
+	REQUIRE(video.segments.size() == 4);
+	CHECK(video.segments[0].key.uri == L"https://cdn.example.com/dash/720p/init.mp4");
+	CHECK(video.segments[1].key.uri == L"https://cdn.example.com/dash/720p/seg-00005.m4s");
+	CHECK(video.segments[3].key.uri == L"https://cdn.example.com/dash/720p/seg-00007.m4s");
+	CHECK_EQ((INT64)40000000, video.segments[1].duration);
+
+	CHECK(manifest.representations[1].segments[1].key.uri == L"https://cdn.example.com/dash/1080p/seg-00005.m4s");
+
+	// no initialization in the audio template, the number starts at 1
+	const MANIFEST_REPRESENTATION& audio = manifest.representations[2];
+	REQUIRE(audio.segments.size() == 3);
+	CHECK(audio.segments[0].key.uri == L"https://cdn.example.com/dash/audio/1.m4s");
+
+	// video renditions only
+	REQUIRE(manifest.renditions.size() == 2);
+	CHECK_EQ((UINT32)1280, manifest.renditions[0].width);
+	CHECK_EQ((UINT32)30, manifest.renditions[0].frameRate);
+	CHECK_EQ((UINT32)VideoCodec::VideoCodec_H264, (UINT32)manifest.renditions[0].codec);
+	CHECK_EQ((UINT32)6000000, manifest.renditions[1].bitrate);
+}
+
+CORE_TEST(DashTimelineTemplate)
+{
+	MANIFEST manifest;
+	REQUIRE_HR(Parse(c_dashTimeline, L"https://cdn.example.com/live/stream.mpd", &manifest));
+
+	REQUIRE(manifest.representations.size() == 1);
+	const std::vector<MANIFEST_SEGMENT>& segments = manifest.representations[0].segments;
+
+	// three repeats of the first entry, one of the second; the repeat-until-end entry starts after the 10s period
+	// ends and still adds its first segment
+	REQUIRE(segments.size() == 5);
+	CHECK(segments[0].key.uri == L"https://cdn.example.com/live/v/900000.m4s?a=1&b=2");
+	CHECK(segments[2].key.uri == L"https://cdn.example.com/live/v/1260000.m4s?a=1&b=2");
+	CHECK(segments[3].key.uri == L"https://cdn.example.com/live/v/1440000.m4s?a=1&b=2");
+	CHECK_EQ((INT64)10000000, segments[3].duration);
+	CHECK(segments[4].key.uri == L"https://cdn.example.com/live/v/1800000.m4s?a=1&b=2");
+
+	REQUIRE(manifest.renditions.size() == 1);
+	CHECK_EQ((UINT32)VideoCodec::VideoCodec_AV1, (UINT32)manifest.renditions[0].codec);
+}
+
+CORE_TEST(DashSkipsWhatItCannotEnumerate)
+{
+	// a live template without a timeline and a SegmentBase representation
+	std::string mpd =
+		"<MPD type=\"dynamic\">"
+		"<Period><AdaptationSet>"
+		"<SegmentTemplate timescale=\"1\" duration=\"2\" media=\"$Number$.m4s\"/>"
+		"<Representation id=\"a\" bandwidth=\"1\" width=\"640\" height=\"360\"/>"
+		"</AdaptationSet><AdaptationSet>"
+		"<Representation id=\"b\" bandwidth=\"1\"><SegmentBase indexRange=\"0-100\"/></Representation>"
+		"</AdaptationSet></Period></MPD>";
+
+	MANIFEST manifest;
+	REQUIRE_HR(Parse(mpd, L"http://example.com/a.mpd", &manifest));
+	CHECK(manifest.representations.empty());
+	CHECK_EQ((size_t)1, manifest.renditions.size());
+}
+
+CORE_TEST(ResolvesRelativeUris)
+{
+	const std::wstring base = L"https://example.com/a/b/c.m3u8?x=1#frag";
+
+	CHECK(ResolveUri(base, L"d.ts") == L"https://example.com/a/b/d.ts");
+	CHECK(ResolveUri(base, L"./d.ts") == L"https://example.com/a/b/d.ts");
+	CHECK(ResolveUri(base, L"../d.ts") == L"https://example.com/a/d.ts");
+	CHECK(ResolveUri(base, L"../../../../d.ts") == L"https://example.com/d.ts");
+	CHECK(ResolveUri(base, L"/root/d.ts") == L"https://example.com/root/d.ts");
+	CHECK(ResolveUri(base, L"//other.example.com/d.ts") == L"https://other.example.com/d.ts");
+	CHECK(ResolveUri(base, L"http://other.example.com/d.ts") == L"http://other.example.com/d.ts");
+	CHECK(ResolveUri(base, L"?y=2") == L"https://example.com/a/b/c.m3u8?y=2");
+	CHECK(ResolveUri(base, L"d.ts?k=a:b") == L"https://example.com/a/b/d.ts?k=a:b");
+	CHECK(ResolveUri(base, L"") == base);
+	CHECK(ResolveUri(L"https://example.com", L"d.ts") == L"https://example.com/d.ts");
+	CHECK(ResolveUri(L"not a uri", L"d.ts") == L"d.ts");
+}
+
+CORE_TEST(RejectsWhatIsNotAManifest)
+{
+	MANIFEST manifest;
+	CHECK_EQ(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), Parse("", L"http://example.com/x", &manifest));
+	CHECK_EQ(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), Parse("<html><body>404</body></html>", L"http://example.com/x", &manifest));
+	CHECK_EQ(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), Parse(std::string("\0\0\0\x18" "ftypmp42", 12), L"http://example.com/x", &manifest));
+	CHECK_EQ(E_INVALIDARG, ParseManifest(nullptr, 0, L"http://example.com/x", &manifest));
+}
+
+// The previous manifest does not leak into the next parse
+CORE_TEST(ParseReplacesTheManifest)
+{
+	MANIFEST manifest;
+	REQUIRE_HR(Parse(c_hlsMaster, L"https://cdn.example.com/hls/master.m3u8", &manifest));
+	REQUIRE_HR(Parse(c_hlsMedia, L"https://cdn.example.com/hls/720p/index.m3u8", &manifest));
+
+	CHECK(manifest.playlistUris.empty());
+	CHECK(manifest.renditions.empty());
+	CHECK_EQ((size_t)1, manifest.representations.size());
+}
+
+CORE_TEST(MalformedHlsIsTolerated)
+{
+	std::string playlist =
+		"#EXTM3U\n"
+		"#EXTINF:abc,\nbad-duration.ts\n"
+		"#EXTINF:99999999999999999999999,\nhuge-duration.ts\n"
+		"#EXT-X-BYTERANGE:@@\nbad-range.ts\n"
+		"#EXT-X-BYTERANGE:18446744073709551615@18446744073709551615\nwrapping-range.ts\n"
+		"#EXT-X-MAP:URI=\"unterminated\n"
+		"#EXT-X-MAP:BYTERANGE=\"1@2\"\n"
+		"#EXT-X-STREAM-INF:RESOLUTION=99999999999x1,FRAME-RATE=1/0,BANDWIDTH=99999999999\n"
+		"#EXT-X-STREAM-INF:\n"
+		"#EXTINF";
+
+	MANIFEST manifest;
+	REQUIRE_HR(Parse(playlist, L"http://example.com/p.m3u8", &manifest));
+	REQUIRE(manifest.representations.size() == 1);
+
+	const std::vector<MANIFEST_SEGMENT>& segments = manifest.representations[0].segments;
+	REQUIRE(segments.size() == 5);
+	CHECK_EQ((INT64)0, segments[0].duration);
+	CHECK(segments[1].duration >= 0);
+	CHECK_EQ((UINT64)0, segments[2].key.rangeLength);
+
+	REQUIRE(manifest.renditions.size() == 2);
+	CHECK_EQ((UINT32)0, manifest.renditions[0].width);
+	CHECK_EQ((UINT32)0, manifest.renditions[0].frameRate);
+	CHECK_EQ((UINT32)UINT_MAX, manifest.renditions[0].bitrate);
+}
+
+CORE_TEST(MalformedDashIsTolerated)
+{
+	const char* c_documents[] =
+	{
+		"<MPD",
+		"<MPD><",
+		"<MPD></>",
+		"<MPD><Period><AdaptationSet><Representation id=\"a\">",
+		"<MPD></Period></Representation></MPD></MPD>",
+		"<MPD mediaPresentationDuration=\"PT99999999999999999999H\"><Period><SegmentTemplate timescale=\"1\" duration=\"1\" media=\"$Number$\"/><Representation id=\"a\"/></Period></MPD>",
+		"<MPD mediaPresentationDuration=\"P1Y\"><Period duration=\"PTS\"><Representation id=\"a\"/></Period></MPD>",
+		"<MPD><Period duration=\"PT10S\"><SegmentTemplate timescale=\"0\" media=\"$Time$\"><SegmentTimeline><S d=\"0\" r=\"-1\"/><S t=\"18446744073709551615\" d=\"18446744073709551615\" r=\"9223372036854775807\"/><S d=\"1\" r=\"-9223372036854775808\"/></SegmentTimeline></SegmentTemplate><Representation id=\"a\"/></Period></MPD>",
+		"<MPD><Period><SegmentTemplate media=\"$Number%0999999999999999999999d$$$$Unknown$$\"><SegmentTimeline><S d=\"1\" r=\"3\"/></SegmentTimeline></SegmentTemplate><Representation id=\"a\" width=\"x\" bandwidth=\"-1\"/></Period></MPD>",
+		"<MPD><BaseURL>http://a/</BaseURL><BaseURL></BaseURL><Period><BaseURL>",
+		"<MPD><!-- <Period> --><![CDATA[ <Period> ]]><Period attr=unquoted attr2=\"unterminated></Period></MPD>",
+	};
+
+	for (const char* pszDocument : c_documents)
+	{
+		MANIFEST manifest;
+		CHECK_HR(Parse(pszDocument, L"http://example.com/a.mpd", &manifest));
+
+		for (const MANIFEST_REPRESENTATION& representation : manifest.representations)
+			CHECK(representation.segments.size() <= 100001);
+	}
+}
+
+// A huge repeat count is bounded, not enumerated
+CORE_TEST(HostileRepeatIsBounded)
+{
+	std::string mpd =
+		"<MPD><Period><SegmentTemplate timescale=\"1\" media=\"$Number$.m4s\"><SegmentTimeline>"
+		"<S t=\"0\" d=\"1\" r=\"9223372036854775806\"/>"
+		"</SegmentTimeline></SegmentTemplate><Representation id=\"a\"/></Period></MPD>";
+
+	MANIFEST manifest;
+	REQUIRE_HR(Parse(mpd, L"http://example.com/a.mpd", &manifest));
+	REQUIRE(manifest.representations.size() == 1);
+	CHECK_EQ((size_t)100000, manifest.representations[0].segments.size());
+}
+
+// Every truncation and random damage of valid manifests parses or fails cleanly; run under the sanitizers
+CORE_TEST(DamagedManifestsParseOrFail)
+{
+	const char* c_valid[] = { c_hlsMaster, c_hlsMedia, c_dashTemplate, c_dashTimeline };
+	std::mt19937 random(14);
+
+	for (const char* pszValid : c_valid)
+	{
+		std::string valid(pszValid);
+
+		for (size_t size = 0; size <= valid.size(); size++)
+		{
+			MANIFEST manifest;
+			HRESULT hr = Parse(valid.substr(0, size), L"http://example.com/m", &manifest);
+			CHECK(hr == S_OK || hr == HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+		}
+
+		for (int round = 0; round < 500; round++)
+		{
+			std::string damaged = valid;
+			for (int i = 0; i < 4; i++)
+			{
+				static const char c_interesting[] = { '<', '>', '/', '"', '$', '%', '@', '\n', '\0', '9', '-', ':', '#', '=', ',', (char)0xff };
+				damaged[random() % damaged.size()] = c_interesting[random() % sizeof(c_interesting)];
+			}
+
+			MANIFEST manifest;
+			HRESULT hr = Parse(damaged, L"http://example.com/m", &manifest);
+			CHECK(hr == S_OK || hr == HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+		}
+	}
+}
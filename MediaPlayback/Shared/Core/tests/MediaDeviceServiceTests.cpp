@@ -0,0 +1,182 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreTest.h"
+#include "MediaDeviceService.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+static MEDIA_DEVICE_STATS GetStats(_In_ CMediaDeviceService& service)
+{
+	MEDIA_DEVICE_STATS stats = {};
+	service.GetStats(&stats);
+
+	return stats;
+}
+
+static UINT32 GetSerial(_In_ const std::shared_ptr<IMediaDevice>& spDevice)
+{
+	return static_cast<CSoftwareMediaDevice*>(spDevice.get())->GetSerial();
+}
+
+
+CORE_TEST(PlayersOfAnAdapterShareItsDevice)
+{
+	std::shared_ptr<CSoftwareMediaDeviceFactory> spFactory = std::make_shared<CSoftwareMediaDeviceFactory>();
+	CMediaDeviceService service(spFactory);
+
+	std::shared_ptr<IMediaDevice> spFirst;
+	std::shared_ptr<IMediaDevice> spSecond;
+	std::shared_ptr<IMediaDevice> spOther;
+	REQUIRE_HR(service.Acquire(1, &spFirst));
+	REQUIRE_HR(service.Acquire(1, &spSecond));
+	REQUIRE_HR(service.Acquire(2, &spOther));
+
+	CHECK(spFirst == spSecond);
+	CHECK(spFirst != spOther);
+	CHECK_EQ((UINT64)1, spFirst->GetAdapterId());
+	CHECK_EQ((UINT64)2, spOther->GetAdapterId());
+	CHECK_EQ(2u, spFactory->GetDevicesCreated());
+
+	MEDIA_DEVICE_STATS stats = GetStats(service);
+	CHECK_EQ(2u, stats.devices);
+	CHECK_EQ(3u, stats.references);
+	CHECK_EQ((UINT64)2, stats.devicesCreated);
+	CHECK_EQ((UINT64)3, stats.acquires);
+}
+
+CORE_TEST(LastReleaseDestroysTheDevice)
+{
+	std::shared_ptr<CSoftwareMediaDeviceFactory> spFactory = std::make_shared<CSoftwareMediaDeviceFactory>();
+	CMediaDeviceService service(spFactory);
+
+	std::shared_ptr<IMediaDevice> spFirst;
+	std::shared_ptr<IMediaDevice> spSecond;
+	REQUIRE_HR(service.Acquire(1, &spFirst));
+	REQUIRE_HR(service.Acquire(1, &spSecond));
+
+	std::weak_ptr<IMediaDevice> device = spFirst;
+
+	service.Release(spFirst);
+	spFirst.reset();
+	CHECK(!device.expired());
+	CHECK_EQ(1u, GetStats(service).references);
+
+	service.Release(spSecond);
+	spSecond.reset();
+	CHECK(device.expired());
+	CHECK_EQ(0u, GetStats(service).devices);
+
+	// the next player gets a new device
+	REQUIRE_HR(service.Acquire(1, &spFirst));
+	CHECK_EQ(1u, GetSerial(spFirst));
+}
+
+CORE_TEST(ShutdownDropsEveryDeviceUntilReady)
+{
+	std::shared_ptr<CSoftwareMediaDeviceFactory> spFactory = std::make_shared<CSoftwareMediaDeviceFactory>();
+	CMediaDeviceService service(spFactory);
+
+	std::shared_ptr<IMediaDevice> spLost;
+	std::shared_ptr<IMediaDevice> spOther;
+	REQUIRE_HR(service.Acquire(1, &spLost));
+	REQUIRE_HR(service.Acquire(2, &spOther));
+
+	std::weak_ptr<IMediaDevice> other = spOther;
+	spOther.reset();
+
+	// a second shutdown is the same loss
+	service.Shutdown();
+	service.Shutdown();
+	CHECK(other.expired());
+
+	MEDIA_DEVICE_STATS stats = GetStats(service);
+	CHECK_EQ(0u, stats.devices);
+	CHECK_EQ(0u, stats.references);
+	CHECK_EQ((UINT64)1, stats.deviceLosses);
+
+	std::shared_ptr<IMediaDevice> spDevice;
+	CHECK_EQ(E_ILLEGAL_METHOD_CALL, service.Acquire(1, &spDevice));
+	CHECK(!spDevice);
+
+	service.Ready();
+
+	REQUIRE_HR(service.Acquire(1, &spDevice));
+	CHECK(spDevice != spLost);
+	CHECK_EQ(2u, GetSerial(spDevice));
+
+	// the reference of the lost device is gone already, it leaves the new one alone
+	service.Release(spLost);
+	CHECK_EQ(1u, GetStats(service).references);
+}
+
+CORE_TEST(FailedCreationLeavesNothingBehind)
+{
+	std::shared_ptr<CSoftwareMediaDeviceFactory> spFactory = std::make_shared<CSoftwareMediaDeviceFactory>();
+	CMediaDeviceService service(spFactory);
+
+	spFactory->SetFailCreation(true);
+
+	std::shared_ptr<IMediaDevice> spDevice;
+	CHECK_EQ(E_FAIL, service.Acquire(1, &spDevice));
+	CHECK(!spDevice);
+
+	MEDIA_DEVICE_STATS stats = GetStats(service);
+	CHECK_EQ(0u, stats.devices);
+	CHECK_EQ((UINT64)0, stats.devicesCreated);
+	CHECK_EQ((UINT64)0, stats.acquires);
+
+	spFactory->SetFailCreation(false);
+
+	REQUIRE_HR(service.Acquire(1, &spDevice));
+	CHECK_EQ(1u, GetStats(service).references);
+}
+
+CORE_TEST(ConcurrentPlayersCreateADevicePerAdapter)
+{
+	std::shared_ptr<CSoftwareMediaDeviceFactory> spFactory = std::make_shared<CSoftwareMediaDeviceFactory>();
+	CMediaDeviceService service(spFactory);
+
+	// held for the whole run, the devices live as long as the service has them
+	std::shared_ptr<IMediaDevice> spFirst;
+	std::shared_ptr<IMediaDevice> spSecond;
+	REQUIRE_HR(service.Acquire(1, &spFirst));
+	REQUIRE_HR(service.Acquire(2, &spSecond));
+
+	const int threadCount = 4;
+	const int rounds = 2000;
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < threadCount; i++)
+	{
+		threads.push_back(std::thread([&service, i]()
+		{
+			for (int round = 0; round < rounds; round++)
+			{
+				std::shared_ptr<IMediaDevice> spDevice;
+				if (SUCCEEDED(service.Acquire((UINT64)(1 + (i + round) % 2), &spDevice)))
+					service.Release(spDevice);
+			}
+		}));
+	}
+
+	for (auto& thread : threads)
+		thread.join();
+
+	MEDIA_DEVICE_STATS stats = GetStats(service);
+	CHECK_EQ(2u, stats.devices);
+	CHECK_EQ(2u, stats.references);
+	CHECK_EQ((UINT64)2, stats.devicesCreated);
+	CHECK_EQ((UINT64)(2 + threadCount * rounds), stats.acquires);
+}
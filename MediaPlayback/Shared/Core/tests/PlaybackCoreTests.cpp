@@ -0,0 +1,385 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ContainerBuilder.h"
+#include "CoreTest.h"
+#include "FileSystem.h"
+#include "SoftwarePlayer.h"
+#include "TestDirectory.h"
+
+#include <chrono>
+#include <thread>
+
+
+CORE_TEST(OpenPlayToEnd)
+{
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"clip.mp4", MakeSoftwareMedia(640, 360, 2 * SOFTWARE_TICKS_PER_SECOND));
+	REQUIRE_HR(player.Initialize());
+
+	REQUIRE_HR(player.GetCore().LoadContent(L"clip.mp4"));
+	player.Run(TEST_FRAME_DURATION);
+
+	PLAYBACK_STATE opened = {};
+	REQUIRE(player.GetStates().FindLast(StateType::StateType_Opened, &opened));
+	CHECK_EQ(640u, opened.description.width);
+	CHECK_EQ(360u, opened.description.height);
+	CHECK_EQ(2 * SOFTWARE_TICKS_PER_SECOND, opened.description.duration);
+	CHECK(opened.description.canSeek != 0);
+
+	// surfaces come with the first render event after the size is known
+	PLAYBACK_STATE newTexture = {};
+	REQUIRE(player.GetStates().FindLast(StateType::StateType_NewFrameTexture, &newTexture));
+	CHECK_EQ(640u, newTexture.description.width);
+	CHECK_EQ(360u, newTexture.description.height);
+	CHECK_EQ(1u, player.GetStates().Count(StateType::StateType_StateChanged, PlaybackState::PlaybackState_Paused));
+
+	REQUIRE_HR(player.GetCore().Play());
+	CHECK_EQ(1u, player.GetStates().Count(StateType::StateType_StateChanged, PlaybackState::PlaybackState_Playing));
+
+	player.Run(SOFTWARE_TICKS_PER_SECOND);
+	CHECK_EQ(30u, player.GetPresentedFrame());
+	CHECK_EQ(SOFTWARE_TICKS_PER_SECOND, player.GetPosition());
+
+	player.Run(2 * SOFTWARE_TICKS_PER_SECOND);
+	CHECK_EQ(60u, player.GetPresentedFrame());
+	CHECK_EQ(1u, player.GetStates().Count(StateType::StateType_StateChanged, PlaybackState::PlaybackState_Ended));
+
+	const PLAYBACK_STATUS* pStatus = nullptr;
+	REQUIRE_HR(player.GetCore().GetPlaybackStatus(&pStatus));
+	CHECK_EQ(60u, pStatus->frameCounter);
+	CHECK_EQ(0u, pStatus->droppedFrames);
+}
+
+CORE_TEST(LoadUnknownContentFails)
+{
+	CSoftwarePlayer player;
+	REQUIRE_HR(player.Initialize());
+
+	CHECK_EQ(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND), player.GetCore().LoadContent(L"missing.mp4"));
+	CHECK_EQ(0u, player.GetStates().Count(StateType::StateType_Opened));
+}
+
+CORE_TEST(StereoFramesAreOverUnder)
+{
+	SOFTWARE_MEDIA_DESCRIPTION media = MakeSoftwareMedia(320, 240, SOFTWARE_TICKS_PER_SECOND);
+	media.isStereoscopic = true;
+
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"stereo.mp4", media);
+	REQUIRE_HR(player.Initialize());
+	REQUIRE_HR(player.GetCore().LoadContent(L"stereo.mp4"));
+	player.Run(TEST_FRAME_DURATION);
+
+	PLAYBACK_STATE newTexture = {};
+	REQUIRE(player.GetStates().FindLast(StateType::StateType_NewFrameTexture, &newTexture));
+	CHECK_EQ(320u, newTexture.description.width);
+	CHECK_EQ(480u, newTexture.description.height);
+	CHECK(newTexture.description.isStereoscopic != 0);
+
+	std::shared_ptr<IPlaybackSurface> spSurface = player.GetCore().GetPlaybackSurface();
+	REQUIRE(spSurface);
+	CHECK_EQ(480u, spSurface->GetHeight());
+	CHECK(spSurface->IsStereoscopic());
+}
+
+CORE_TEST(PausedSeekPresentsTheFrame)
+{
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"clip.mp4", MakeSoftwareMedia(64, 64, 10 * SOFTWARE_TICKS_PER_SECOND));
+	REQUIRE_HR(player.Initialize());
+	REQUIRE_HR(player.GetCore().LoadContent(L"clip.mp4"));
+	player.Run(TEST_FRAME_DURATION);
+
+	UINT64 framesBefore = player.GetPresentedFrame();
+
+	REQUIRE_HR(player.GetCore().Seek(4 * SOFTWARE_TICKS_PER_SECOND));
+	CHECK_EQ(4 * SOFTWARE_TICKS_PER_SECOND, player.GetPosition());
+	CHECK_EQ(framesBefore + 1, player.GetPresentedFrame());
+}
+
+CORE_TEST(UnseekableContentIgnoresSeek)
+{
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"live", MakeSoftwareMedia(64, 64, 0, false));
+	REQUIRE_HR(player.Initialize());
+	REQUIRE_HR(player.GetCore().LoadContent(L"live"));
+	player.Run(TEST_FRAME_DURATION);
+
+	CHECK_EQ(S_FALSE, player.GetCore().Seek(SOFTWARE_TICKS_PER_SECOND));
+	CHECK_EQ(0, player.GetPosition());
+}
+
+CORE_TEST(StopClosesTheSource)
+{
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"clip.mp4", MakeSoftwareMedia(64, 64, SOFTWARE_TICKS_PER_SECOND));
+	REQUIRE_HR(player.Initialize());
+	REQUIRE_HR(player.GetCore().LoadContent(L"clip.mp4"));
+	player.Run(TEST_FRAME_DURATION);
+	REQUIRE_HR(player.GetCore().Play());
+
+	REQUIRE_HR(player.GetCore().Stop());
+
+	PLAYBACK_STATE last = {};
+	REQUIRE(player.GetStates().FindLast(StateType::StateType_None, &last));
+	CHECK(last.state == PlaybackState::PlaybackState_None);
+
+	// a stopped player has nothing left to report
+	player.GetStates().Clear();
+	player.Run(SOFTWARE_TICKS_PER_SECOND);
+	CHECK_EQ(0u, player.GetStates().GetStates().size());
+	CHECK_EQ(E_ILLEGAL_METHOD_CALL, player.GetCore().GetDurationAndPosition(nullptr, nullptr));
+}
+
+CORE_TEST(FrameFormatFallsBackToTheBackend)
+{
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"clip.mp4", MakeSoftwareMedia(64, 64, SOFTWARE_TICKS_PER_SECOND));
+	REQUIRE_HR(player.Initialize());
+
+	CHECK_EQ(E_INVALIDARG, player.GetCore().SetPreferredFrameFormat((FrameFormat)99));
+	REQUIRE_HR(player.GetCore().SetPreferredFrameFormat(FrameFormat::FrameFormat_NV12));
+	REQUIRE_HR(player.GetCore().LoadContent(L"clip.mp4"));
+	player.Run(TEST_FRAME_DURATION);
+
+	// the software backend only has BGRA surfaces, the texture tells what Unity gets
+	PLAYBACK_STATE newTexture = {};
+	REQUIRE(player.GetStates().FindLast(StateType::StateType_NewFrameTexture, &newTexture));
+	CHECK_EQ((UINT32)FrameFormat::FrameFormat_BGRA32, (UINT32)newTexture.description.frameFormat);
+}
+
+CORE_TEST(DeviceShutdownReleasesSurfaces)
+{
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"clip.mp4", MakeSoftwareMedia(64, 64, 10 * SOFTWARE_TICKS_PER_SECOND));
+	REQUIRE_HR(player.Initialize());
+	REQUIRE_HR(player.GetCore().LoadContent(L"clip.mp4"));
+	player.Run(TEST_FRAME_DURATION);
+	REQUIRE(player.GetCore().GetPlaybackSurface());
+
+	player.GetCore().DeviceShutdown();
+	CHECK(!player.GetCore().GetPlaybackSurface());
+	CHECK_EQ(1u, player.GetStates().Count(StateType::StateType_GraphicsDeviceShutdown));
+
+	// playback goes on without surfaces until the device is back
+	REQUIRE_HR(player.GetCore().Play());
+	player.Run(SOFTWARE_TICKS_PER_SECOND);
+	CHECK(!player.GetCore().GetPlaybackSurface());
+	CHECK_EQ(SOFTWARE_TICKS_PER_SECOND, player.GetPosition());
+
+	player.GetCore().DeviceReady();
+	player.GetCore().DeviceReady();
+	CHECK_EQ(1u, player.GetStates().Count(StateType::StateType_GraphicsDeviceReady));
+
+	player.Run(TEST_FRAME_DURATION);
+	CHECK(player.GetCore().GetPlaybackSurface());
+	CHECK_EQ(2u, player.GetStates().Count(StateType::StateType_NewFrameTexture));
+}
+
+CORE_TEST(StatusHasBitrateAndBufferedRanges)
+{
+	SOFTWARE_MEDIA_DESCRIPTION media = MakeSoftwareMedia(64, 64, 10 * SOFTWARE_TICKS_PER_SECOND);
+	media.bitrates = { 1000000, 2000000 };
+
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"clip.mp4", media);
+	REQUIRE_HR(player.Initialize());
+	REQUIRE_HR(player.GetCore().LoadContent(L"clip.mp4"));
+	player.Run(TEST_FRAME_DURATION);
+
+	const PLAYBACK_STATUS* pStatus = nullptr;
+	REQUIRE_HR(player.GetCore().GetPlaybackStatus(&pStatus));
+	// nothing constrains the renditions, the selector starts at the top one
+	CHECK_EQ(2000000u, pStatus->bitrate);
+	CHECK_EQ(10 * SOFTWARE_TICKS_PER_SECOND, pStatus->duration);
+	REQUIRE(pStatus->bufferedRangeCount == 1);
+	CHECK_EQ(0, pStatus->bufferedRanges[0].start);
+	CHECK_EQ(10 * SOFTWARE_TICKS_PER_SECOND, pStatus->bufferedRanges[0].end);
+
+	REQUIRE_HR(player.GetCore().Seek(3 * SOFTWARE_TICKS_PER_SECOND));
+	CHECK_EQ(3 * SOFTWARE_TICKS_PER_SECOND, pStatus->position);
+}
+
+// Keyframes of the container at 0, 400 and 800ms
+CORE_TEST(SeekWithModeSnapsToKeyframes)
+{
+	MP4_TRACK_TABLES tables;
+	tables.timescale = 1000;
+	tables.timeToSample = { { 10, 100 } };
+	tables.syncSamples = { 1, 5, 9 };
+	tables.sampleCount = 10;
+	tables.editMediaTime = -1;
+
+	CTestDirectory directory;
+	std::wstring path = directory.GetFilePath(L"clip.mp4");
+	ContainerBytes file = MakeProgressiveMp4(tables);
+	REQUIRE_HR(WriteWholeFile(path, file.data(), file.size()));
+
+	SOFTWARE_MEDIA_DESCRIPTION media = MakeSoftwareMedia(64, 64, SOFTWARE_TICKS_PER_SECOND);
+	media.keyframeFile = path;
+
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"indexed.mp4", media);
+	player.GetBackend()->RegisterMedia(L"plain.mp4", MakeSoftwareMedia(64, 64, SOFTWARE_TICKS_PER_SECOND));
+	REQUIRE_HR(player.Initialize());
+	REQUIRE_HR(player.GetCore().LoadContent(L"indexed.mp4"));
+	player.Run(TEST_FRAME_DURATION);
+
+	const LONGLONG c_ms = SOFTWARE_TICKS_PER_SECOND / 1000;
+
+	CHECK_EQ(E_INVALIDARG, player.GetCore().SeekWithMode(0, (SeekMode)3));
+
+	REQUIRE_HR(player.GetCore().SeekWithMode(550 * c_ms, SeekMode::SeekMode_PreviousKeyframe));
+	CHECK_EQ(400 * c_ms, player.GetPosition());
+
+	REQUIRE_HR(player.GetCore().SeekWithMode(700 * c_ms, SeekMode::SeekMode_NearestKeyframe));
+	CHECK_EQ(800 * c_ms, player.GetPosition());
+
+	REQUIRE_HR(player.GetCore().SeekWithMode(550 * c_ms, SeekMode::SeekMode_Accurate));
+	CHECK_EQ(550 * c_ms, player.GetPosition());
+
+	// the index goes with the content, without one every mode seeks exactly
+	REQUIRE_HR(player.GetCore().LoadContent(L"plain.mp4"));
+	player.Run(TEST_FRAME_DURATION);
+	REQUIRE_HR(player.GetCore().SeekWithMode(550 * c_ms, SeekMode::SeekMode_PreviousKeyframe));
+	CHECK_EQ(550 * c_ms, player.GetPosition());
+}
+
+CORE_TEST(ThumbnailsOfTheLoadedContent)
+{
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"clip.mp4", MakeSoftwareMedia(64, 36, 4 * SOFTWARE_TICKS_PER_SECOND));
+	REQUIRE_HR(player.Initialize());
+
+	CHECK_EQ(E_ILLEGAL_METHOD_CALL, player.GetCore().StartThumbnailExtraction(16, 9, SOFTWARE_TICKS_PER_SECOND));
+
+	std::shared_ptr<CWorkerPool> spPool = std::make_shared<CWorkerPool>();
+	REQUIRE_HR(spPool->Start(1));
+	player.GetCore().SetThumbnailWorkerPool(spPool);
+
+	REQUIRE_HR(player.GetCore().LoadContent(L"clip.mp4"));
+	player.Run(TEST_FRAME_DURATION);
+
+	CHECK_EQ(E_INVALIDARG, player.GetCore().StartThumbnailExtraction(0, 9, SOFTWARE_TICKS_PER_SECOND));
+	REQUIRE_HR(player.GetCore().StartThumbnailExtraction(16, 9, SOFTWARE_TICKS_PER_SECOND));
+
+	THUMBNAIL_ATLAS_INFO info = {};
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (std::chrono::steady_clock::now() < deadline)
+	{
+		if (player.GetCore().GetThumbnailAtlasInfo(&info) == S_OK && info.tileCount && info.readyCount == info.tileCount)
+			break;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	REQUIRE(info.tileCount == 4);
+	CHECK_EQ(4u, info.readyCount);
+
+	std::vector<BYTE> atlas((size_t)info.width * info.height * 4);
+	REQUIRE_HR(player.GetCore().GetThumbnailAtlas(atlas.data(), (UINT32)atlas.size(), &info));
+
+	// the software decoder puts the second of the frame in the blue channel
+	for (UINT32 tile = 0; tile < info.tileCount; tile++)
+	{
+		UINT32 x = (tile % info.columns) * info.tileWidth + info.tileWidth / 2;
+		UINT32 y = (tile / info.columns) * info.tileHeight + info.tileHeight / 2;
+		CHECK_EQ((BYTE)tile, atlas[((size_t)y * info.width + x) * 4]);
+	}
+
+	REQUIRE_HR(player.GetCore().StopThumbnailExtraction());
+	spPool->Shutdown();
+}
+
+// What the subtitle callbacks saw, "+id" for entered and "-id" for exited cues
+static std::vector<std::wstring> s_cueLog;
+
+static void UNITY_INTERFACE_API OnCueEntered(void*, const wchar_t*, const wchar_t* cueId, const wchar_t*, const wchar_t** lines, unsigned int count)
+{
+	std::wstring entry = std::wstring(L"+") + cueId;
+	for (unsigned int i = 0; i < count; i++)
+		entry += std::wstring(L" ") + lines[i];
+
+	s_cueLog.push_back(entry);
+}
+
+static void UNITY_INTERFACE_API OnCueExited(void*, const wchar_t*, const wchar_t* cueId)
+{
+	s_cueLog.push_back(std::wstring(L"-") + cueId);
+}
+
+CORE_TEST(SubtitleCuesReachTheCallbacks)
+{
+	SOFTWARE_MEDIA_DESCRIPTION media = MakeSoftwareMedia(64, 64, 10 * SOFTWARE_TICKS_PER_SECOND);
+	media.subtitleCues = {
+		{ 1 * SOFTWARE_TICKS_PER_SECOND, 2 * SOFTWARE_TICKS_PER_SECOND, { L"en", L"1", L"en", { L"one" } } },
+		{ 2 * SOFTWARE_TICKS_PER_SECOND, 3 * SOFTWARE_TICKS_PER_SECOND, { L"en", L"2", L"en", { L"two", L"lines" } } } };
+
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"clip.mp4", media);
+	REQUIRE_HR(player.Initialize());
+	REQUIRE_HR(player.GetCore().SetSubtitlesCallbacks(&OnCueEntered, &OnCueExited));
+
+	s_cueLog.clear();
+	REQUIRE_HR(player.GetCore().LoadContent(L"clip.mp4"));
+	player.Run(TEST_FRAME_DURATION);
+	REQUIRE_HR(player.GetCore().Play());
+	player.Run(5 * SOFTWARE_TICKS_PER_SECOND / 2);
+
+	std::vector<std::wstring> expected = { L"+1 one", L"-1", L"+2 two lines" };
+	CHECK(s_cueLog == expected);
+
+	// seeking away takes the cue off the screen, without callbacks nothing is reported
+	REQUIRE_HR(player.GetCore().Seek(8 * SOFTWARE_TICKS_PER_SECOND));
+	CHECK(s_cueLog.back() == L"-2");
+
+	REQUIRE_HR(player.GetCore().SetSubtitlesCallbacks(nullptr, nullptr));
+	s_cueLog.clear();
+	REQUIRE_HR(player.GetCore().Seek(SOFTWARE_TICKS_PER_SECOND));
+	CHECK(s_cueLog.empty());
+}
+
+// A player moves to another backend with its next content, the content playing stays where it is
+CORE_TEST(SetBackendAppliesAtTheNextLoad)
+{
+	std::shared_ptr<CSoftwarePlaybackBackend> spOther = std::make_shared<CSoftwarePlaybackBackend>();
+	spOther->RegisterMedia(L"other.mp4", MakeSoftwareMedia(32, 32, SOFTWARE_TICKS_PER_SECOND));
+
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"clip.mp4", MakeSoftwareMedia(64, 64, 10 * SOFTWARE_TICKS_PER_SECOND));
+	REQUIRE_HR(player.Initialize());
+
+	CHECK_EQ(E_INVALIDARG, player.GetCore().SetBackend(nullptr));
+
+	REQUIRE_HR(player.GetCore().LoadContent(L"clip.mp4"));
+	player.Run(TEST_FRAME_DURATION);
+	REQUIRE_HR(player.GetCore().Play());
+	REQUIRE_HR(player.GetCore().SetVolume(0.25));
+
+	REQUIRE_HR(player.GetCore().SetBackend(spOther));
+	player.Run(SOFTWARE_TICKS_PER_SECOND);
+	CHECK_EQ(SOFTWARE_TICKS_PER_SECOND, player.GetPosition());
+
+	REQUIRE_HR(player.GetCore().LoadContent(L"other.mp4"));
+	spOther->Advance(TEST_FRAME_DURATION);
+	player.GetCore().RenderEvent();
+
+	PLAYBACK_STATE newTexture = {};
+	REQUIRE(player.GetStates().FindLast(StateType::StateType_NewFrameTexture, &newTexture));
+	CHECK_EQ(32u, newTexture.description.width);
+	CHECK_EQ(2u, player.GetStates().Count(StateType::StateType_Opened));
+
+	// the old backend has nothing left to play for the player
+	player.GetStates().Clear();
+	player.GetBackend()->Advance(SOFTWARE_TICKS_PER_SECOND);
+	CHECK_EQ(0u, player.GetStates().GetStates().size());
+}
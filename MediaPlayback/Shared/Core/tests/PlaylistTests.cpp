@@ -0,0 +1,333 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreTest.h"
+#include "Playlist.h"
+#include "SoftwarePlayer.h"
+
+
+// Player with one-second items a.mp4, b.mp4 and c.mp4 registered, not yet in its playlist
+static void RegisterItems(_In_ CSoftwarePlayer* pPlayer)
+{
+	pPlayer->GetBackend()->RegisterMedia(L"a.mp4", MakeSoftwareMedia(320, 180, SOFTWARE_TICKS_PER_SECOND));
+	pPlayer->GetBackend()->RegisterMedia(L"b.mp4", MakeSoftwareMedia(320, 180, SOFTWARE_TICKS_PER_SECOND));
+	pPlayer->GetBackend()->RegisterMedia(L"c.mp4", MakeSoftwareMedia(320, 180, SOFTWARE_TICKS_PER_SECOND));
+}
+
+static PLAYLIST_STATS GetStats(_In_ CSoftwarePlayer* pPlayer)
+{
+	PLAYLIST_STATS stats = {};
+	pPlayer->GetCore().GetPlaylistStats(&stats);
+
+	return stats;
+}
+
+static std::vector<UINT32> GetItemChanges(_In_ CSoftwarePlayer* pPlayer)
+{
+	std::vector<UINT32> ids;
+	for (const PLAYBACK_STATE& state : pPlayer->GetStates().GetStates())
+	{
+		if (state.type == StateType::StateType_PlaylistItemChanged)
+			ids.push_back(state.requestId);
+	}
+
+	return ids;
+}
+
+
+CORE_TEST(PlaylistKeepsIdsAcrossEdits)
+{
+	CPlaylist playlist;
+	CHECK(playlist.IsEmpty());
+	CHECK_EQ(0u, playlist.GetCurrentId());
+
+	UINT32 a = 0, b = 0, c = 0;
+	REQUIRE_HR(playlist.Insert(0, L"a.mp4", &a));
+	REQUIRE_HR(playlist.Insert(UINT32_MAX, L"c.mp4", &c));
+	REQUIRE_HR(playlist.Insert(1, L"b.mp4", &b));
+	CHECK(a != 0 && b != 0 && c != 0 && a != b && b != c);
+	CHECK_EQ(a, playlist.GetCurrentId());
+	CHECK_EQ(E_INVALIDARG, playlist.Insert(0, L"", &a));
+
+	PLAYLIST_ENTRY entry;
+	REQUIRE(playlist.GetNext(&entry));
+	CHECK_EQ(b, entry.id);
+	CHECK(entry.contentLocation == L"b.mp4");
+
+	REQUIRE_HR(playlist.MoveNext());
+	REQUIRE_HR(playlist.MoveNext());
+	CHECK_EQ(c, playlist.GetCurrentId());
+	CHECK_EQ(S_FALSE, playlist.MoveNext());
+	CHECK_EQ(c, playlist.GetCurrentId());
+	CHECK(!playlist.GetNext(&entry));
+
+	// removing the current item moves to the one after it, or to none after the last
+	bool wasCurrent = false;
+	REQUIRE_HR(playlist.MoveTo(b));
+	REQUIRE_HR(playlist.Remove(b, &wasCurrent));
+	CHECK(wasCurrent);
+	CHECK_EQ(c, playlist.GetCurrentId());
+	REQUIRE_HR(playlist.Remove(a, &wasCurrent));
+	CHECK(!wasCurrent);
+	REQUIRE_HR(playlist.Remove(c, &wasCurrent));
+	CHECK_EQ(0u, playlist.GetCurrentId());
+	CHECK(!playlist.GetCurrent(&entry));
+
+	CHECK_EQ(E_INVALIDARG, playlist.Remove(c, nullptr));
+	CHECK_EQ(E_INVALIDARG, playlist.MoveTo(c));
+	CHECK_EQ(E_ILLEGAL_METHOD_CALL, playlist.MoveNext());
+
+	// ids are not reused
+	UINT32 d = 0;
+	REQUIRE_HR(playlist.Insert(0, L"d.mp4", &d));
+	CHECK(d > c);
+}
+
+CORE_TEST(PlaylistMeasuresSwitches)
+{
+	CPlaylist playlist;
+
+	PLAYLIST_STATS stats;
+	playlist.GetStats(&stats);
+	CHECK_EQ(0u, stats.switchCount);
+	CHECK_EQ(-1ll, stats.lastSwitchLatency);
+	CHECK_EQ(-1, stats.currentIndex);
+	CHECK_EQ(S_FALSE, playlist.EndSwitch(1000));
+
+	playlist.BeginSwitch(1000, true);
+	CHECK_EQ(S_OK, playlist.EndSwitch(1500));
+	CHECK_EQ(S_FALSE, playlist.EndSwitch(2000));
+
+	playlist.BeginSwitch(3000, false);
+	CHECK_EQ(S_OK, playlist.EndSwitch(3200));
+
+	playlist.GetStats(&stats);
+	CHECK_EQ(2u, stats.switchCount);
+	CHECK_EQ(1u, stats.prerolledSwitches);
+	CHECK_EQ(200ll, stats.lastSwitchLatency);
+	CHECK_EQ(500ll, stats.maxSwitchLatency);
+}
+
+// At the end of an item the pre-rolled next one plays on from the same render step, on the same surfaces, without
+// an Ended state in between
+CORE_TEST(SwitchesGaplessly)
+{
+	CSoftwarePlayer player;
+	RegisterItems(&player);
+	REQUIRE_HR(player.Initialize());
+
+	UINT32 a = 0, b = 0;
+	REQUIRE_HR(player.GetCore().PlaylistAppend(L"a.mp4", &a));
+	REQUIRE_HR(player.GetCore().PlaylistAppend(L"b.mp4", &b));
+	player.Run(TEST_FRAME_DURATION);
+	REQUIRE_HR(player.GetCore().Play());
+
+	std::shared_ptr<IPlaybackSurface> spSurface = player.GetCore().GetPlaybackSurface();
+	REQUIRE(spSurface);
+
+	// one step past the end of a.mp4 already shows b.mp4
+	player.Run(SOFTWARE_TICKS_PER_SECOND + TEST_FRAME_DURATION);
+	CHECK(GetItemChanges(&player) == std::vector<UINT32>({ a, b }));
+	CHECK_EQ(0u, player.GetStates().Count(StateType::StateType_StateChanged, PlaybackState::PlaybackState_Ended));
+	CHECK(player.GetPosition() > 0);
+	CHECK(player.GetCore().GetPlaybackSurface() == spSurface);
+	CHECK_EQ(1u, player.GetStates().Count(StateType::StateType_NewFrameTexture));
+
+	PLAYLIST_STATS stats = GetStats(&player);
+	CHECK_EQ(1u, stats.switchCount);
+	CHECK_EQ(1u, stats.prerolledSwitches);
+	CHECK_EQ(b, stats.currentItemId);
+	CHECK_EQ(1, stats.currentIndex);
+	CHECK(stats.lastSwitchLatency >= 0);
+
+	// no frame of b.mp4 is lost to the switch
+	player.Run(SOFTWARE_TICKS_PER_SECOND / 2);
+	CHECK(player.GetPosition() >= SOFTWARE_TICKS_PER_SECOND / 2);
+
+	// the last item ends like a single source does
+	player.Run(SOFTWARE_TICKS_PER_SECOND);
+	CHECK_EQ(1u, player.GetStates().Count(StateType::StateType_StateChanged, PlaybackState::PlaybackState_Ended));
+	CHECK_EQ(1u, GetStats(&player).switchCount);
+}
+
+// An item of another size gets new surfaces, and still plays without an open in between
+CORE_TEST(SwitchToAnotherSizeRecreatesSurfaces)
+{
+	CSoftwarePlayer player;
+	RegisterItems(&player);
+	player.GetBackend()->RegisterMedia(L"wide.mp4", MakeSoftwareMedia(640, 180, SOFTWARE_TICKS_PER_SECOND));
+	REQUIRE_HR(player.Initialize());
+
+	UINT32 id = 0;
+	REQUIRE_HR(player.GetCore().PlaylistAppend(L"a.mp4", &id));
+	REQUIRE_HR(player.GetCore().PlaylistAppend(L"wide.mp4", &id));
+	player.Run(TEST_FRAME_DURATION);
+	REQUIRE_HR(player.GetCore().Play());
+
+	player.Run(SOFTWARE_TICKS_PER_SECOND + 2 * TEST_FRAME_DURATION);
+
+	std::shared_ptr<IPlaybackSurface> spSurface = player.GetCore().GetPlaybackSurface();
+	REQUIRE(spSurface);
+	CHECK_EQ(640u, spSurface->GetWidth());
+	CHECK_EQ(2u, player.GetStates().Count(StateType::StateType_NewFrameTexture));
+	CHECK_EQ(1u, GetStats(&player).prerolledSwitches);
+	CHECK(player.GetPosition() > 0);
+}
+
+// Removing the item pre-rolled opens the one now next instead
+CORE_TEST(RemovingTheNextItemRetargetsThePreroll)
+{
+	CSoftwarePlayer player;
+	RegisterItems(&player);
+	REQUIRE_HR(player.Initialize());
+
+	UINT32 a = 0, b = 0, c = 0;
+	REQUIRE_HR(player.GetCore().PlaylistAppend(L"a.mp4", &a));
+	REQUIRE_HR(player.GetCore().PlaylistAppend(L"b.mp4", &b));
+	REQUIRE_HR(player.GetCore().PlaylistAppend(L"c.mp4", &c));
+	player.Run(TEST_FRAME_DURATION);
+	REQUIRE_HR(player.GetCore().Play());
+	player.Run(SOFTWARE_TICKS_PER_SECOND / 2);
+
+	REQUIRE_HR(player.GetCore().PlaylistRemove(b));
+	player.Run(SOFTWARE_TICKS_PER_SECOND / 2 + 2 * TEST_FRAME_DURATION);
+
+	CHECK(GetItemChanges(&player) == std::vector<UINT32>({ a, c }));
+	PLAYLIST_STATS stats = GetStats(&player);
+	CHECK_EQ(2u, stats.itemCount);
+	CHECK_EQ(1u, stats.prerolledSwitches);
+
+	CHECK_EQ(E_INVALIDARG, player.GetCore().PlaylistRemove(b));
+}
+
+// Removing the item playing starts the next one, playing; removing the last one stops
+CORE_TEST(RemovingTheCurrentItem)
+{
+	CSoftwarePlayer player;
+	RegisterItems(&player);
+	REQUIRE_HR(player.Initialize());
+
+	UINT32 a = 0, b = 0;
+	REQUIRE_HR(player.GetCore().PlaylistAppend(L"a.mp4", &a));
+	REQUIRE_HR(player.GetCore().PlaylistAppend(L"b.mp4", &b));
+	player.Run(TEST_FRAME_DURATION);
+	REQUIRE_HR(player.GetCore().Play());
+	player.Run(SOFTWARE_TICKS_PER_SECOND / 2);
+
+	REQUIRE_HR(player.GetCore().PlaylistRemove(a));
+	CHECK(GetItemChanges(&player) == std::vector<UINT32>({ a, b }));
+	CHECK_EQ(1u, GetStats(&player).prerolledSwitches);
+
+	player.Run(SOFTWARE_TICKS_PER_SECOND / 4);
+	CHECK(player.GetPosition() >= SOFTWARE_TICKS_PER_SECOND / 4 - TEST_FRAME_DURATION);
+
+	player.GetStates().Clear();
+	REQUIRE_HR(player.GetCore().PlaylistRemove(b));
+	CHECK_EQ(1u, player.GetStates().Count(StateType::StateType_None));
+	CHECK_EQ(0u, GetStats(&player).itemCount);
+	CHECK_EQ(0u, GetStats(&player).currentItemId);
+}
+
+CORE_TEST(NextItemOnRequest)
+{
+	CSoftwarePlayer player;
+	RegisterItems(&player);
+	REQUIRE_HR(player.Initialize());
+
+	UINT32 a = 0, b = 0;
+	REQUIRE_HR(player.GetCore().PlaylistAppend(L"a.mp4", &a));
+	REQUIRE_HR(player.GetCore().PlaylistAppend(L"b.mp4", &b));
+	player.Run(TEST_FRAME_DURATION);
+
+	// paused stays paused
+	REQUIRE_HR(player.GetCore().PlaylistNext());
+	player.Run(SOFTWARE_TICKS_PER_SECOND / 2);
+	CHECK_EQ(0, player.GetPosition());
+	CHECK_EQ(b, GetStats(&player).currentItemId);
+	CHECK_EQ(1u, GetStats(&player).prerolledSwitches);
+
+	CHECK_EQ(S_FALSE, player.GetCore().PlaylistNext());
+	CHECK_EQ(b, GetStats(&player).currentItemId);
+
+	// LoadContent takes over from the playlist
+	REQUIRE_HR(player.GetCore().LoadContent(L"c.mp4"));
+	CHECK_EQ(0u, GetStats(&player).itemCount);
+	CHECK_EQ(E_ILLEGAL_METHOD_CALL, player.GetCore().PlaylistNext());
+}
+
+// An item that cannot be opened ahead is opened again when it is due and fails then, as a load would
+CORE_TEST(PrerollFailureSurfacesAtTheSwitch)
+{
+	CSoftwarePlayer player;
+	RegisterItems(&player);
+	REQUIRE_HR(player.Initialize());
+
+	UINT32 a = 0, missing = 0, c = 0;
+	REQUIRE_HR(player.GetCore().PlaylistAppend(L"a.mp4", &a));
+	REQUIRE_HR(player.GetCore().PlaylistAppend(L"missing.mp4", &missing));
+	REQUIRE_HR(player.GetCore().PlaylistAppend(L"c.mp4", &c));
+	player.Run(TEST_FRAME_DURATION);
+	REQUIRE_HR(player.GetCore().Play());
+
+	player.Run(SOFTWARE_TICKS_PER_SECOND / 2);
+	CHECK_EQ(0u, player.GetStates().Count(StateType::StateType_Failed));
+
+	player.Run(SOFTWARE_TICKS_PER_SECOND / 2 + TEST_FRAME_DURATION);
+
+	PLAYBACK_STATE failed = {};
+	REQUIRE(player.GetStates().FindLast(StateType::StateType_Failed, &failed));
+	CHECK_EQ(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND), failed.hresult);
+	CHECK_EQ(1u, player.GetStates().Count(StateType::StateType_StateChanged, PlaybackState::PlaybackState_Ended));
+
+	PLAYLIST_STATS stats = GetStats(&player);
+	CHECK_EQ(missing, stats.currentItemId);
+	CHECK_EQ(0u, stats.prerolledSwitches);
+
+	// the client moves on past it
+	REQUIRE_HR(player.GetCore().PlaylistNext());
+	REQUIRE_HR(player.GetCore().Play());
+	player.Run(SOFTWARE_TICKS_PER_SECOND / 2);
+	CHECK_EQ(c, GetStats(&player).currentItemId);
+	CHECK(player.GetPosition() > 0);
+}
+
+// The same for an item that opens, but fails after a while; the pre-roll failure itself is not reported
+CORE_TEST(LatePrerollFailure)
+{
+	SOFTWARE_MEDIA_DESCRIPTION broken = MakeSoftwareMedia(320, 180, SOFTWARE_TICKS_PER_SECOND);
+	broken.openLatency = SOFTWARE_TICKS_PER_SECOND / 10;
+	broken.openResult = E_ABORT;
+
+	CSoftwarePlayer player;
+	RegisterItems(&player);
+	player.GetBackend()->RegisterMedia(L"broken.mp4", broken);
+	REQUIRE_HR(player.Initialize());
+
+	UINT32 a = 0, b = 0;
+	REQUIRE_HR(player.GetCore().PlaylistAppend(L"a.mp4", &a));
+	REQUIRE_HR(player.GetCore().PlaylistAppend(L"broken.mp4", &b));
+	player.Run(TEST_FRAME_DURATION);
+	REQUIRE_HR(player.GetCore().Play());
+
+	player.Run(SOFTWARE_TICKS_PER_SECOND / 2);
+	CHECK_EQ(0u, player.GetStates().Count(StateType::StateType_Failed));
+
+	player.Run(SOFTWARE_TICKS_PER_SECOND / 2 + TEST_FRAME_DURATION);
+	CHECK(GetItemChanges(&player) == std::vector<UINT32>({ a, b }));
+	CHECK_EQ(0u, GetStats(&player).prerolledSwitches);
+	CHECK_EQ(0u, player.GetStates().Count(StateType::StateType_Failed));
+
+	player.Run(SOFTWARE_TICKS_PER_SECOND / 10);
+
+	PLAYBACK_STATE failed = {};
+	REQUIRE(player.GetStates().FindLast(StateType::StateType_Failed, &failed));
+	CHECK_EQ(E_ABORT, failed.hresult);
+}
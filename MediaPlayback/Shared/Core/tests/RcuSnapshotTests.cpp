@@ -0,0 +1,166 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreTest.h"
+#include "RcuSnapshot.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#define TEST_LIVE_MAGIC 0x5AFE5AFEu
+#define TEST_FREED_MAGIC 0xDEADDEADu
+
+
+// Snapshot a reader can check for consistency: every entry equals the version, and a freed one is marked
+typedef struct _TEST_SNAPSHOT
+{
+	_TEST_SNAPSHOT() : magic(TEST_LIVE_MAGIC), version(0) {}
+	_TEST_SNAPSHOT(const _TEST_SNAPSHOT& other) : magic(TEST_LIVE_MAGIC), version(other.version), entries(other.entries) {}
+	~_TEST_SNAPSHOT() { magic = TEST_FREED_MAGIC; }
+
+	volatile UINT32 magic;
+	UINT64 version;
+	std::vector<UINT64> entries;
+} TEST_SNAPSHOT;
+
+static HRESULT NextVersion(_Inout_ TEST_SNAPSHOT& snapshot)
+{
+	snapshot.version++;
+	snapshot.entries.assign(snapshot.entries.size() % 16 + 1, snapshot.version);
+
+	return S_OK;
+}
+
+
+CORE_TEST(UpdatePublishesTheCopy)
+{
+	CRcuSnapshot<TEST_SNAPSHOT> snapshot;
+
+	{
+		CRcuSnapshot<TEST_SNAPSHOT>::CReadScope reader(snapshot);
+		CHECK_EQ((UINT64)0, reader->version);
+	}
+
+	CHECK_EQ(S_OK, snapshot.Update(NextVersion));
+
+	CRcuSnapshot<TEST_SNAPSHOT>::CReadScope reader(snapshot);
+	CHECK_EQ((UINT64)1, reader->version);
+	CHECK_EQ((size_t)1, reader->entries.size());
+}
+
+CORE_TEST(DeclinedUpdateLeavesTheSnapshot)
+{
+	CRcuSnapshot<TEST_SNAPSHOT> snapshot;
+	snapshot.Update(NextVersion);
+
+	CHECK_EQ(S_FALSE, snapshot.Update([](TEST_SNAPSHOT& copy) { copy.version = 100; return S_FALSE; }));
+	CHECK_EQ(E_INVALIDARG, snapshot.Update([](TEST_SNAPSHOT& copy) { copy.version = 100; return E_INVALIDARG; }));
+
+	CRcuSnapshot<TEST_SNAPSHOT>::CReadScope reader(snapshot);
+	CHECK_EQ((UINT64)1, reader->version);
+}
+
+// A reader keeps its snapshot for the whole scope, the writer waits for it before freeing
+CORE_TEST(UpdateWaitsForReaders)
+{
+	CRcuSnapshot<TEST_SNAPSHOT> snapshot;
+	std::atomic<bool> updated(false);
+
+	CRcuSnapshot<TEST_SNAPSHOT>::CReadScope* pReader = new CRcuSnapshot<TEST_SNAPSHOT>::CReadScope(snapshot);
+
+	std::thread writer([&]()
+	{
+		snapshot.Update(NextVersion);
+		updated = true;
+	});
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	CHECK(!updated);
+	CHECK_EQ(TEST_LIVE_MAGIC, (*pReader)->magic);
+	CHECK_EQ((UINT64)0, (*pReader)->version);
+
+	// readers entering now are not held up by the pending writer and see the new snapshot
+	{
+		CRcuSnapshot<TEST_SNAPSHOT>::CReadScope reader(snapshot);
+		CHECK_EQ((UINT64)1, reader->version);
+	}
+
+	delete pReader;
+	writer.join();
+	CHECK(updated);
+}
+
+// Readers on several threads while writers publish: every snapshot read is live and consistent,
+// and each reader sees the versions in order
+CORE_TEST(ReadersAndWritersStress)
+{
+	CRcuSnapshot<TEST_SNAPSHOT> snapshot;
+	std::atomic<bool> stop(false);
+	std::atomic<UINT32> torn(0);
+	std::atomic<UINT32> freed(0);
+	std::atomic<UINT32> backwards(0);
+	std::atomic<UINT64> reads(0);
+
+	std::vector<std::thread> readers;
+	for (int i = 0; i < 4; i++)
+	{
+		readers.emplace_back([&]()
+		{
+			UINT64 lastVersion = 0;
+			while (!stop)
+			{
+				CRcuSnapshot<TEST_SNAPSHOT>::CReadScope reader(snapshot);
+
+				if (reader->magic != TEST_LIVE_MAGIC)
+					freed++;
+				if (reader->version < lastVersion)
+					backwards++;
+				for (UINT64 entry : reader->entries)
+				{
+					if (entry != reader->version)
+						torn++;
+				}
+
+				lastVersion = reader->version;
+				reads++;
+			}
+		});
+	}
+
+	const UINT64 updatesPerWriter = 5000;
+
+	std::vector<std::thread> writers;
+	for (int i = 0; i < 2; i++)
+	{
+		writers.emplace_back([&]()
+		{
+			for (UINT64 j = 0; j < updatesPerWriter; j++)
+				snapshot.Update(NextVersion);
+		});
+	}
+
+	for (auto& writer : writers)
+		writer.join();
+
+	stop = true;
+	for (auto& reader : readers)
+		reader.join();
+
+	CHECK_EQ((UINT32)0, torn.load());
+	CHECK_EQ((UINT32)0, freed.load());
+	CHECK_EQ((UINT32)0, backwards.load());
+	CHECK(reads > 0);
+
+	// writers are serialized, no update is lost
+	CRcuSnapshot<TEST_SNAPSHOT>::CReadScope reader(snapshot);
+	CHECK_EQ(2 * updatesPerWriter, reader->version);
+}
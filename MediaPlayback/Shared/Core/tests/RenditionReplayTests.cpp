@@ -0,0 +1,99 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreTest.h"
+#include "RenditionReplay.h"
+#include "TestData.h"
+
+
+// The recorded session in tests/data, step by step
+CORE_TEST(ReplaysTheRecordedSession)
+{
+	std::string trace;
+	REQUIRE_HR(LoadTestData("rendition-session.txt", &trace));
+
+	std::vector<RENDITION_REPLAY_STEP> steps;
+	REQUIRE_HR(ReplayRenditionTrace(trace, &steps));
+
+	static const RENDITION_REPLAY_STEP c_expected[] =
+	{
+		{ 11, 2, 0 },								// 1080p60 fills the window, HEVC Main 10 is out
+		{ 13, 1, 1920ull * 1080 * 60 - 1 },			// one in six frames dropped
+		{ 28, 2, 0 },								// after _RenditionRecoveryWindows_ clean windows
+		{ 30, 1, 1280ull * 720 * 30 },				// power saver
+		{ 33, 0, 0 },								// a 360p window, every rendition fills it
+		{ 38, 1, 0 },								// the next source, the UHD track is H.264 as far as we know
+		{ 40, 0, 3840ull * 2160 * 30 - 1 },			// which drops a quarter of its frames
+	};
+	const size_t expectedCount = sizeof(c_expected) / sizeof(c_expected[0]);
+
+	REQUIRE(steps.size() == expectedCount);
+	for (size_t i = 0; i < expectedCount; i++)
+	{
+		CHECK_EQ(c_expected[i].line, steps[i].line);
+		CHECK_EQ(c_expected[i].selectedIndex, steps[i].selectedIndex);
+		CHECK_EQ(c_expected[i].pixelRateCeiling, steps[i].pixelRateCeiling);
+	}
+}
+
+CORE_TEST(ReplaysWithoutCapabilities)
+{
+	std::vector<RENDITION_REPLAY_STEP> steps;
+	REQUIRE_HR(ReplayRenditionTrace(
+		"select	# nothing to select from\n"
+		"rendition 1000000 1280x720 30 vp09.02.10.10\n"
+		"select\n"
+		"capability av1 0 10 8192x4320 0\n"
+		"select\n"
+		"frames 10 10\n", &steps));
+
+	REQUIRE(steps.size() == 3);
+	CHECK_EQ((INT32)-1, steps[0].selectedIndex);
+	CHECK_EQ((UINT32)1, steps[0].line);
+	CHECK_EQ((INT32)0, steps[1].selectedIndex);
+
+	// VP9 on an AV1 only decoder
+	CHECK_EQ((INT32)-1, steps[2].selectedIndex);
+}
+
+CORE_TEST(MalformedLinesAreReported)
+{
+	static const struct
+	{
+		const char* pszTrace;
+		UINT32 line;
+	} c_malformed[] =
+	{
+		{ "select\nzoom 2\n", 2 },
+		{ "rendition 1000000 1280 30\n", 1 },
+		{ "rendition fast 1280x720 30\n", 1 },
+		{ "\n\ncapability mpeg2 0 8 1920x1080 0\n", 3 },
+		{ "capability\n", 1 },
+		{ "viewport 1920\n", 1 },
+		{ "power turbo\n", 1 },
+		{ "frames 10\n", 1 },
+	};
+
+	for (const auto& malformed : c_malformed)
+	{
+		std::vector<RENDITION_REPLAY_STEP> steps;
+		UINT32 errorLine = 0;
+		CHECK_EQ(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), ReplayRenditionTrace(malformed.pszTrace, &steps, &errorLine));
+		CHECK_EQ(malformed.line, errorLine);
+	}
+
+	// steps before the malformed line are kept
+	std::vector<RENDITION_REPLAY_STEP> steps;
+	CHECK_EQ(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), ReplayRenditionTrace("select\nzoom 2\n", &steps));
+	CHECK_EQ((size_t)1, steps.size());
+
+	CHECK_EQ(E_INVALIDARG, ReplayRenditionTrace("select\n", nullptr));
+}
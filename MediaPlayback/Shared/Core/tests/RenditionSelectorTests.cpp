@@ -0,0 +1,361 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreTest.h"
+#include "RenditionSelector.h"
+#include "TestDirectory.h"
+
+
+static RENDITION_INFO MakeRendition(_In_ UINT32 bitrate, _In_ UINT32 width, _In_ UINT32 height, _In_ UINT32 frameRate, _In_ const char* pszCodecs)
+{
+	RENDITION_INFO rendition = {};
+	rendition.bitrate = bitrate;
+	rendition.width = width;
+	rendition.height = height;
+	rendition.frameRate = frameRate;
+	rendition.codec = VideoCodec::VideoCodec_Unknown;
+
+	if (pszCodecs != nullptr)
+		ParseCodecList(pszCodecs, &rendition);
+
+	return rendition;
+}
+
+// A ladder mixing codecs and bit depths, as a multi-codec DASH manifest lists it
+static std::vector<RENDITION_INFO> MakeLadder()
+{
+	return
+	{
+		MakeRendition(800000, 640, 360, 30, "avc1.64001e"),			// 0: H.264 High 8-bit
+		MakeRendition(3000000, 1280, 720, 30, "avc1.64001f"),			// 1
+		MakeRendition(6000000, 1920, 1080, 60, "avc1.64002a"),		// 2
+		MakeRendition(15000000, 3840, 2160, 30, "hvc1.2.4.L150.B0"),	// 3: HEVC Main 10
+		MakeRendition(20000000, 3840, 2160, 60, "av01.0.13M.10"),		// 4: AV1 10-bit
+		MakeRendition(40000000, 7680, 4320, 30, "hvc1.2.4.L180.B0"),	// 5: HEVC Main 10 8K
+	};
+}
+
+static CDecoderCapabilities MakeCapabilities(_In_ const char* pszText)
+{
+	CDecoderCapabilities capabilities;
+	capabilities.Parse(pszText);
+
+	return capabilities;
+}
+
+// HEVC Main (8-bit) and VP9, no AV1
+static const char c_integratedGpu[] =
+	"h264 0 8 4096x2304 0\n"
+	"hevc 1 8 4096x2304 0\n"
+	"vp9 0 8 4096x2304 0\n";
+
+static const char c_discreteGpu[] =
+	"h264 0 8 4096x4096 0\n"
+	"hevc 0 10 8192x4320 0\n"
+	"av1 0 10 8192x4320 0\n";
+
+// H.264 High only, up to 1080p30
+static const char c_oldGpu[] =
+	"h264 100 8 1920x1088 30\n";
+
+static std::vector<size_t> GetDecodableIndices(_In_ const CDecoderCapabilities& capabilities, _In_ const std::vector<RENDITION_INFO>& renditions)
+{
+	std::vector<size_t> indices;
+	for (size_t i = 0; i < renditions.size(); i++)
+	{
+		if (capabilities.CanDecode(renditions[i]))
+			indices.push_back(i);
+	}
+
+	return indices;
+}
+
+// Feeds a window of frames, dropped of them dropped
+static bool FeedWindow(_Inout_ CRenditionSelector* pSelector, _Inout_ UINT64* pPresented, _Inout_ UINT64* pDropped, _In_ UINT64 dropped, _In_ const RENDITION_INFO& current)
+{
+	*pPresented += _RenditionDropWindowFrames_ - dropped;
+	*pDropped += dropped;
+
+	return pSelector->OnFrameStats(*pPresented, *pDropped, current);
+}
+
+
+CORE_TEST(ParsesCodecStrings)
+{
+	std::vector<RENDITION_INFO> ladder = MakeLadder();
+
+	CHECK_EQ((UINT32)VideoCodec::VideoCodec_H264, (UINT32)ladder[0].codec);
+	CHECK_EQ((UINT32)100, ladder[0].profile);
+	CHECK_EQ((UINT32)8, ladder[0].bitDepth);
+	CHECK_EQ((UINT32)VideoCodec::VideoCodec_HEVC, (UINT32)ladder[3].codec);
+	CHECK_EQ((UINT32)2, ladder[3].profile);
+	CHECK_EQ((UINT32)10, ladder[3].bitDepth);
+	CHECK_EQ((UINT32)VideoCodec::VideoCodec_AV1, (UINT32)ladder[4].codec);
+	CHECK_EQ((UINT32)10, ladder[4].bitDepth);
+
+	RENDITION_INFO rendition = MakeRendition(0, 0, 0, 0, nullptr);
+	CHECK(ParseCodecList("mp4a.40.2, vp09.02.10.10.01", &rendition));
+	CHECK_EQ((UINT32)VideoCodec::VideoCodec_VP9, (UINT32)rendition.codec);
+	CHECK_EQ((UINT32)2, rendition.profile);
+	CHECK_EQ((UINT32)10, rendition.bitDepth);
+
+	CHECK(ParseCodecList("avc1.6e0028", &rendition));
+	CHECK_EQ((UINT32)10, rendition.bitDepth);
+	CHECK(ParseCodecList("dvh1.05.06", &rendition));
+	CHECK_EQ((UINT32)10, rendition.bitDepth);
+
+	CHECK(!ParseCodecList("mp4a.40.2,ec-3", &rendition));
+	CHECK(!ParseCodecList("", &rendition));
+
+	CHECK_EQ((UINT32)VideoCodec::VideoCodec_HEVC, (UINT32)GetVideoCodecFromSubtype(L"hevc"));
+	CHECK_EQ((UINT32)VideoCodec::VideoCodec_Unknown, (UINT32)GetVideoCodecFromSubtype(L"MPG2"));
+}
+
+CORE_TEST(CapabilitiesFilterTheLadder)
+{
+	std::vector<RENDITION_INFO> ladder = MakeLadder();
+
+	CHECK(GetDecodableIndices(MakeCapabilities(c_integratedGpu), ladder) == std::vector<size_t>({ 0, 1, 2 }));
+	CHECK(GetDecodableIndices(MakeCapabilities(c_discreteGpu), ladder) == std::vector<size_t>({ 0, 1, 2, 3, 4, 5 }));
+	CHECK(GetDecodableIndices(MakeCapabilities(c_oldGpu), ladder) == std::vector<size_t>({ 0, 1 }));
+
+	// no capabilities decode nothing; the selector takes that for "not probed" instead
+	CHECK(GetDecodableIndices(CDecoderCapabilities(), ladder).empty());
+
+	std::vector<RENDITION_INFO> filtered = FilterRenditions(MakeCapabilities(c_oldGpu), ladder);
+	REQUIRE(filtered.size() == 2);
+	CHECK_EQ((UINT32)3000000, filtered[1].bitrate);
+}
+
+CORE_TEST(CapabilityEdgeCases)
+{
+	CDecoderCapabilities oldGpu = MakeCapabilities(c_oldGpu);
+
+	// an unknown codec is taken for 8-bit H.264 of any profile
+	CHECK(oldGpu.CanDecode(MakeRendition(1000000, 1280, 720, 30, nullptr)));
+	CHECK(!oldGpu.CanDecode(MakeRendition(1000000, 2560, 1440, 30, nullptr)));
+
+	// portrait video fits a decoder of the same area
+	CHECK(oldGpu.CanDecode(MakeRendition(1000000, 1080, 1920, 30, "avc1.640028")));
+
+	// an unknown frame rate always fits
+	CHECK(oldGpu.CanDecode(MakeRendition(1000000, 1920, 1080, 0, "avc1.640028")));
+	CHECK(!oldGpu.CanDecode(MakeRendition(1000000, 1920, 1080, 31, "avc1.640028")));
+
+	// a profile the decoder does not list, and 10-bit H.264
+	CHECK(!oldGpu.CanDecode(MakeRendition(1000000, 640, 360, 30, "avc1.42c01e")));
+	CHECK(!oldGpu.CanDecode(MakeRendition(1000000, 640, 360, 30, "avc1.6e001e")));
+
+	// HEVC Main 10 on a Main only decoder, HEVC Main on it
+	CDecoderCapabilities integratedGpu = MakeCapabilities(c_integratedGpu);
+	CHECK(!integratedGpu.CanDecode(MakeRendition(1000000, 1920, 1080, 30, "hvc1.2.4.L120.B0")));
+	CHECK(integratedGpu.CanDecode(MakeRendition(1000000, 1920, 1080, 30, "hvc1.1.6.L120.90")));
+}
+
+CORE_TEST(CapabilitiesRoundTrip)
+{
+	CDecoderCapabilities capabilities = MakeCapabilities(c_discreteGpu);
+	CHECK(capabilities.Serialize() == c_discreteGpu);
+
+	CDecoderCapabilities parsed;
+	CHECK_EQ(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), parsed.Parse("mpeg2 0 8 1920x1080 0\n"));
+	CHECK_EQ(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), parsed.Parse("h264 0 8 1920 0\n"));
+	CHECK_EQ(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), parsed.Parse("h264 high\n"));
+	CHECK(parsed.IsEmpty());
+
+	CTestDirectory directory;
+	std::wstring path = directory.GetFilePath(L"capabilities.txt");
+
+	CHECK_EQ(S_FALSE, parsed.Load(path, L"VEN_10DE&DEV_2484 31.0.15.3623"));
+	REQUIRE_HR(capabilities.Save(path, L"VEN_10DE&DEV_2484 31.0.15.3623"));
+
+	CHECK_EQ(S_OK, parsed.Load(path, L"VEN_10DE&DEV_2484 31.0.15.3623"));
+	CHECK(parsed.Serialize() == c_discreteGpu);
+
+	// a driver update probes again
+	CDecoderCapabilities updated;
+	CHECK_EQ(S_FALSE, updated.Load(path, L"VEN_10DE&DEV_2484 31.0.15.4601"));
+	CHECK(updated.IsEmpty());
+}
+
+CORE_TEST(SelectsTheMostVisiblePixels)
+{
+	std::vector<RENDITION_INFO> ladder = MakeLadder();
+
+	CRenditionSelector selector;
+	selector.SetCapabilities(MakeCapabilities(c_discreteGpu));
+
+	// every pixel counts without a viewport
+	CHECK_EQ((INT32)5, selector.Select(ladder));
+
+	// 1080p and above all fill a 1080p viewport, the cheapest to decode of them wins
+	selector.SetViewport(1920, 1080);
+	CHECK_EQ((INT32)2, selector.Select(ladder));
+
+	selector.SetViewport(2560, 1440);
+	CHECK_EQ((INT32)3, selector.Select(ladder));
+
+	// a portrait viewport shows the width of the frame only
+	selector.SetViewport(360, 640);
+	CHECK_EQ((INT32)0, selector.Select(ladder));
+
+	// the integrated GPU decodes none of the UHD renditions
+	selector.SetCapabilities(MakeCapabilities(c_integratedGpu));
+	selector.SetViewport(0, 0);
+	CHECK_EQ((INT32)2, selector.Select(ladder));
+
+	// nothing decodable
+	selector.SetCapabilities(MakeCapabilities("vp9 0 8 4096x2304 0\n"));
+	CHECK_EQ((INT32)-1, selector.Select(ladder));
+	CHECK_EQ((INT32)-1, selector.Select(std::vector<RENDITION_INFO>()));
+
+	// without capabilities everything is decodable
+	selector.SetCapabilities(CDecoderCapabilities());
+	CHECK_EQ((INT32)5, selector.Select(ladder));
+}
+
+CORE_TEST(TiesGoToTheHigherBitrate)
+{
+	std::vector<RENDITION_INFO> ladder =
+	{
+		MakeRendition(4000000, 1280, 720, 30, "avc1.64001f"),
+		MakeRendition(6000000, 1280, 720, 30, "avc1.64001f"),
+		MakeRendition(5000000, 1280, 720, 30, "avc1.64001f"),
+	};
+
+	CRenditionSelector selector;
+	CHECK_EQ((INT32)1, selector.Select(ladder));
+}
+
+CORE_TEST(PowerBudgetCapsThePixelRate)
+{
+	std::vector<RENDITION_INFO> ladder = MakeLadder();
+
+	CRenditionSelector selector;
+	selector.SetCapabilities(MakeCapabilities(c_discreteGpu));
+	CHECK_EQ((UINT64)0, selector.GetPixelRateCeiling());
+
+	selector.SetPowerBudget(PowerBudget::PowerBudget_Balanced);
+	CHECK_EQ((UINT64)1920 * 1080 * 60, selector.GetPixelRateCeiling());
+	CHECK_EQ((INT32)2, selector.Select(ladder));
+
+	selector.SetPowerBudget(PowerBudget::PowerBudget_Saver);
+	CHECK_EQ((UINT64)1280 * 720 * 30, selector.GetPixelRateCeiling());
+	CHECK_EQ((INT32)1, selector.Select(ladder));
+
+	RENDITION_SCORE score = selector.Score(ladder[2]);
+	CHECK(score.decodable);
+	CHECK(!score.withinCeiling);
+	CHECK_EQ((UINT64)1920 * 1080 * 60, score.pixelRate);
+
+	// above the ceiling only: the cheapest to decode
+	std::vector<RENDITION_INFO> uhd = { ladder[4], ladder[3], ladder[5] };
+	CHECK_EQ((INT32)1, selector.Select(uhd));
+
+	// renditions without a frame rate count as 30 fps
+	CHECK_EQ((UINT64)1280 * 720 * 30, selector.Score(MakeRendition(1, 1280, 720, 0, nullptr)).pixelRate);
+}
+
+CORE_TEST(FrameDropsLowerTheCeilingAndRecover)
+{
+	std::vector<RENDITION_INFO> ladder = MakeLadder();
+
+	CRenditionSelector selector;
+	selector.SetCapabilities(MakeCapabilities(c_integratedGpu));
+	REQUIRE(selector.Select(ladder) == 2);
+
+	UINT64 presented = 0;
+	UINT64 dropped = 0;
+
+	// the first counters only start the window
+	CHECK(!selector.OnFrameStats(presented, dropped, ladder[2]));
+
+	// one in six frames dropped: below the 1080p60 rendition
+	CHECK(FeedWindow(&selector, &presented, &dropped, 20, ladder[2]));
+	CHECK_EQ((UINT64)1920 * 1080 * 60 - 1, selector.GetPixelRateCeiling());
+	CHECK_EQ((INT32)1, selector.Select(ladder));
+
+	// drops reported while the switch is still on its way do not lower it further
+	CHECK(!FeedWindow(&selector, &presented, &dropped, 20, ladder[2]));
+	CHECK_EQ((INT32)1, selector.Select(ladder));
+
+	// a window below the max drop rate but above clean neither lowers nor counts towards recovery
+	CHECK(!FeedWindow(&selector, &presented, &dropped, 2, ladder[1]));
+
+	// _RenditionRecoveryWindows_ clean windows lift the ceiling
+	for (int i = 1; i < _RenditionRecoveryWindows_; i++)
+		CHECK(!FeedWindow(&selector, &presented, &dropped, 0, ladder[1]));
+	CHECK(FeedWindow(&selector, &presented, &dropped, 0, ladder[1]));
+	CHECK_EQ((UINT64)0, selector.GetPixelRateCeiling());
+	CHECK_EQ((INT32)2, selector.Select(ladder));
+
+	// dropping again waits twice as long
+	CHECK(FeedWindow(&selector, &presented, &dropped, 60, ladder[2]));
+	for (int i = 1; i < 2 * _RenditionRecoveryWindows_; i++)
+		CHECK(!FeedWindow(&selector, &presented, &dropped, 0, ladder[1]));
+	CHECK(FeedWindow(&selector, &presented, &dropped, 0, ladder[1]));
+
+	// a new source starts over
+	CHECK(FeedWindow(&selector, &presented, &dropped, 60, ladder[2]));
+	selector.Reset();
+	CHECK_EQ((UINT64)0, selector.GetPixelRateCeiling());
+}
+
+CORE_TEST(FrameDropCeilingKeepsThePowerBudget)
+{
+	std::vector<RENDITION_INFO> ladder = MakeLadder();
+
+	CRenditionSelector selector;
+	selector.SetCapabilities(MakeCapabilities(c_discreteGpu));
+	selector.SetPowerBudget(PowerBudget::PowerBudget_Balanced);
+
+	UINT64 presented = 1000;
+	UINT64 dropped = 0;
+	selector.OnFrameStats(presented, dropped, ladder[1]);
+
+	// dropping at 720p30 takes the ceiling below the budget
+	CHECK(FeedWindow(&selector, &presented, &dropped, 30, ladder[1]));
+	CHECK_EQ((UINT64)1280 * 720 * 30 - 1, selector.GetPixelRateCeiling());
+	CHECK_EQ((INT32)0, selector.Select(ladder));
+
+	// a rendition of unknown size gives nothing to go below
+	selector.Reset();
+	selector.OnFrameStats(presented, dropped, ladder[1]);
+	CHECK(!FeedWindow(&selector, &presented, &dropped, 60, MakeRendition(1, 0, 0, 0, nullptr)));
+
+	// counters going backwards belong to a new source and restart the window
+	CHECK(!selector.OnFrameStats(10, 10, ladder[1]));
+	CHECK(!selector.OnFrameStats(10 + _RenditionDropWindowFrames_ - 1, 10, ladder[1]));
+	CHECK_EQ((UINT64)1920 * 1080 * 60, selector.GetPixelRateCeiling());
+}
+
+CORE_TEST(TracksBecomeRenditions)
+{
+	std::vector<VIDEO_TRACK_INFO> tracks = {
+		{ 1920, 1080, 6000000, 60, VideoCodec::VideoCodec_HEVC, 2, 10 },
+		{ 1280, 720, 3000000, 0, VideoCodec::VideoCodec_Unknown, 0, 0 } };
+	std::vector<RENDITION_INFO> renditions = MakeTrackRenditions(tracks);
+
+	REQUIRE(renditions.size() == 2);
+	CHECK_EQ((UINT32)VideoCodec::VideoCodec_HEVC, (UINT32)renditions[0].codec);
+	CHECK_EQ((UINT32)60, renditions[0].frameRate);
+	CHECK_EQ((UINT32)10, renditions[0].bitDepth);
+	CHECK_EQ((UINT32)1280, renditions[1].width);
+	CHECK_EQ((UINT32)3000000, renditions[1].bitrate);
+	CHECK_EQ((UINT32)VideoCodec::VideoCodec_Unknown, (UINT32)renditions[1].codec);
+	CHECK_EQ((UINT32)0, renditions[1].frameRate);
+
+	CRenditionSelector selector;
+	selector.SetCapabilities(MakeCapabilities(c_oldGpu));
+	CHECK_EQ((INT32)1, selector.Select(MakeTrackRenditions({
+		{ 3840, 2160, 15000000, 30, VideoCodec::VideoCodec_H264, 0, 8 },
+		{ 1920, 1080, 6000000, 30, VideoCodec::VideoCodec_H264, 0, 8 } })));
+}
@@ -0,0 +1,369 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreTest.h"
+#include "SegmentCache.h"
+#include "TestDirectory.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#define TEST_SEGMENT_SIZE 1000
+
+
+static SEGMENT_KEY MakeKey(_In_ UINT32 segment, _In_ UINT64 rangeOffset = 0, _In_ UINT64 rangeLength = 0)
+{
+	SEGMENT_KEY key;
+	key.uri = L"https://cdn.example.com/video/720p/segment" + std::to_wstring(segment) + L".m4s";
+	key.rangeOffset = rangeOffset;
+	key.rangeLength = rangeLength;
+
+	return key;
+}
+
+static std::vector<BYTE> MakeSegment(_In_ UINT32 segment, _In_ size_t size = TEST_SEGMENT_SIZE)
+{
+	std::vector<BYTE> data(size);
+	for (size_t i = 0; i < size; i++)
+		data[i] = (BYTE)(segment * 31 + i);
+
+	return data;
+}
+
+static HRESULT StoreSegment(_In_ CSegmentCache& cache, _In_ UINT32 segment, _In_ const std::wstring& etag = L"\"v1\"")
+{
+	std::vector<BYTE> data = MakeSegment(segment);
+	return cache.Store(MakeKey(segment), etag, data.data(), data.size());
+}
+
+// S_OK if the segment is cached with the data StoreSegment wrote, S_FALSE on a miss
+static HRESULT LookupSegment(_In_ CSegmentCache& cache, _In_ UINT32 segment, _In_ const std::wstring& etag = std::wstring())
+{
+	std::shared_ptr<CMappedSegment> spSegment;
+	HRESULT hr = cache.Lookup(MakeKey(segment), etag, &spSegment);
+	if (hr != S_OK)
+		return hr;
+
+	std::vector<BYTE> expected = MakeSegment(segment);
+	if (spSegment->GetSize() != expected.size() || memcmp(spSegment->GetData(), expected.data(), expected.size()) != 0)
+		return E_FAIL;
+
+	return S_OK;
+}
+
+static size_t CountFiles(_In_ const CTestDirectory& directory, _In_ const wchar_t* pszExtension)
+{
+	std::vector<std::wstring> names = directory.ListFiles();
+	std::wstring extension(pszExtension);
+
+	return (size_t)std::count_if(names.begin(), names.end(), [&extension](const std::wstring& name)
+	{
+		return name.size() >= extension.size() && name.compare(name.size() - extension.size(), extension.size(), extension) == 0;
+	});
+}
+
+
+CORE_TEST(StoredSegmentIsServed)
+{
+	CTestDirectory directory;
+	CSegmentCache cache;
+	REQUIRE_HR(cache.Open(directory.GetPath(), 1024 * 1024));
+
+	CHECK_EQ(S_FALSE, LookupSegment(cache, 1));
+	CHECK_EQ(S_OK, StoreSegment(cache, 1));
+	CHECK_EQ(S_OK, LookupSegment(cache, 1));
+	CHECK_EQ(S_OK, LookupSegment(cache, 1, L"\"v1\""));
+	CHECK_EQ(S_FALSE, LookupSegment(cache, 2));
+
+	SEGMENT_CACHE_STATS stats;
+	cache.GetStats(&stats);
+	CHECK_EQ((UINT32)1, stats.entries);
+	CHECK_EQ((UINT64)TEST_SEGMENT_SIZE, stats.sizeBytes);
+	CHECK_EQ((UINT64)2, stats.hits);
+	CHECK_EQ((UINT64)2, stats.misses);
+	CHECK_EQ((UINT64)2 * TEST_SEGMENT_SIZE, stats.bytesSaved);
+	CHECK_EQ((UINT64)TEST_SEGMENT_SIZE, stats.bytesStored);
+	CHECK_EQ((size_t)1, CountFiles(directory, L".seg"));
+}
+
+CORE_TEST(EtagAndRangeTellSegmentsApart)
+{
+	CTestDirectory directory;
+	CSegmentCache cache;
+	REQUIRE_HR(cache.Open(directory.GetPath(), 1024 * 1024));
+
+	REQUIRE_HR(StoreSegment(cache, 1, L"\"v1\""));
+
+	// a different ETag is a new version of the resource
+	CHECK_EQ(S_FALSE, LookupSegment(cache, 1, L"\"v2\""));
+
+	// storing it replaces the old version and its file
+	REQUIRE_HR(StoreSegment(cache, 1, L"\"v2\""));
+	CHECK_EQ(S_OK, LookupSegment(cache, 1, L"\"v2\""));
+	CHECK_EQ(S_FALSE, LookupSegment(cache, 1, L"\"v1\""));
+	CHECK_EQ((size_t)1, CountFiles(directory, L".seg"));
+
+	// byte ranges of the same URI are segments of their own
+	std::vector<BYTE> data = MakeSegment(7, 100);
+	REQUIRE_HR(cache.Store(MakeKey(1, 0, 100), L"", data.data(), data.size()));
+	REQUIRE_HR(cache.Store(MakeKey(1, 100, 100), L"", data.data(), data.size()));
+
+	std::shared_ptr<CMappedSegment> spSegment;
+	CHECK_EQ(S_OK, cache.Lookup(MakeKey(1, 0, 100), L"", &spSegment));
+	CHECK_EQ(S_OK, cache.Lookup(MakeKey(1, 100, 100), L"", &spSegment));
+	CHECK_EQ(S_FALSE, cache.Lookup(MakeKey(1, 200, 100), L"", &spSegment));
+	CHECK(spSegment == nullptr);
+
+	SEGMENT_CACHE_STATS stats;
+	cache.GetStats(&stats);
+	CHECK_EQ((UINT32)3, stats.entries);
+}
+
+CORE_TEST(BudgetEvictsTheLeastRecentlyUsed)
+{
+	CTestDirectory directory;
+	CSegmentCache cache;
+	REQUIRE_HR(cache.Open(directory.GetPath(), 3 * TEST_SEGMENT_SIZE));
+
+	REQUIRE_HR(StoreSegment(cache, 1));
+	REQUIRE_HR(StoreSegment(cache, 2));
+	REQUIRE_HR(StoreSegment(cache, 3));
+
+	// 1 is used again, 2 becomes the oldest
+	CHECK_EQ(S_OK, LookupSegment(cache, 1));
+	REQUIRE_HR(StoreSegment(cache, 4));
+
+	CHECK_EQ(S_FALSE, LookupSegment(cache, 2));
+	CHECK_EQ(S_OK, LookupSegment(cache, 1));
+	CHECK_EQ(S_OK, LookupSegment(cache, 3));
+	CHECK_EQ(S_OK, LookupSegment(cache, 4));
+
+	SEGMENT_CACHE_STATS stats;
+	cache.GetStats(&stats);
+	CHECK_EQ((UINT64)1, stats.evictions);
+	CHECK_EQ((UINT64)3 * TEST_SEGMENT_SIZE, stats.sizeBytes);
+	CHECK_EQ((size_t)3, CountFiles(directory, L".seg"));
+
+	// a lower budget evicts right away, oldest first
+	REQUIRE_HR(cache.SetBudget(TEST_SEGMENT_SIZE));
+	CHECK_EQ(S_OK, LookupSegment(cache, 4));
+	CHECK_EQ(S_FALSE, LookupSegment(cache, 1));
+	CHECK_EQ((size_t)1, CountFiles(directory, L".seg"));
+
+	// a segment over the whole budget is not stored and evicts nothing
+	std::vector<BYTE> large = MakeSegment(9, TEST_SEGMENT_SIZE + 1);
+	CHECK_EQ(S_FALSE, cache.Store(MakeKey(9), L"", large.data(), large.size()));
+	CHECK_EQ(S_OK, LookupSegment(cache, 4));
+}
+
+CORE_TEST(MappedSegmentOutlivesEviction)
+{
+	CTestDirectory directory;
+	CSegmentCache cache;
+	REQUIRE_HR(cache.Open(directory.GetPath(), TEST_SEGMENT_SIZE));
+
+	REQUIRE_HR(StoreSegment(cache, 1));
+
+	std::shared_ptr<CMappedSegment> spSegment;
+	REQUIRE(cache.Lookup(MakeKey(1), L"", &spSegment) == S_OK);
+
+	// evicted and deleted while mapped
+	REQUIRE_HR(StoreSegment(cache, 2));
+	REQUIRE_HR(cache.Clear());
+	cache.Close();
+
+	std::vector<BYTE> expected = MakeSegment(1);
+	REQUIRE(spSegment->GetSize() == expected.size());
+	CHECK(memcmp(spSegment->GetData(), expected.data(), expected.size()) == 0);
+}
+
+// Entries, their data and their recency survive a new session
+CORE_TEST(ReopenRecoversTheIndex)
+{
+	CTestDirectory directory;
+
+	{
+		CSegmentCache cache;
+		REQUIRE_HR(cache.Open(directory.GetPath(), 3 * TEST_SEGMENT_SIZE));
+		REQUIRE_HR(StoreSegment(cache, 1));
+		REQUIRE_HR(StoreSegment(cache, 2));
+		REQUIRE_HR(StoreSegment(cache, 3));
+		CHECK_EQ(S_OK, LookupSegment(cache, 1));
+	}
+
+	CSegmentCache cache;
+	REQUIRE_HR(cache.Open(directory.GetPath(), 3 * TEST_SEGMENT_SIZE));
+
+	SEGMENT_CACHE_STATS stats;
+	cache.GetStats(&stats);
+	CHECK_EQ((UINT32)3, stats.entries);
+	CHECK_EQ((UINT64)3 * TEST_SEGMENT_SIZE, stats.sizeBytes);
+
+	// the recency of the previous session decides: 2 is the oldest
+	REQUIRE_HR(StoreSegment(cache, 4));
+	CHECK_EQ(S_FALSE, LookupSegment(cache, 2));
+	CHECK_EQ(S_OK, LookupSegment(cache, 1));
+	CHECK_EQ(S_OK, LookupSegment(cache, 3));
+}
+
+CORE_TEST(ReopenWithASmallerBudgetEvicts)
+{
+	CTestDirectory directory;
+
+	{
+		CSegmentCache cache;
+		REQUIRE_HR(cache.Open(directory.GetPath(), 4 * TEST_SEGMENT_SIZE));
+		for (UINT32 i = 1; i <= 4; i++)
+			REQUIRE_HR(StoreSegment(cache, i));
+	}
+
+	CSegmentCache cache;
+	REQUIRE_HR(cache.Open(directory.GetPath(), 2 * TEST_SEGMENT_SIZE));
+
+	CHECK_EQ(S_OK, LookupSegment(cache, 4));
+	CHECK_EQ(S_OK, LookupSegment(cache, 3));
+	CHECK_EQ(S_FALSE, LookupSegment(cache, 2));
+	CHECK_EQ((size_t)2, CountFiles(directory, L".seg"));
+}
+
+// A damaged index starts the cache empty and the segments it listed are deleted as orphans
+CORE_TEST(CorruptIndexStartsEmpty)
+{
+	CTestDirectory directory;
+
+	{
+		CSegmentCache cache;
+		REQUIRE_HR(cache.Open(directory.GetPath(), 1024 * 1024));
+		REQUIRE_HR(StoreSegment(cache, 1));
+		REQUIRE_HR(StoreSegment(cache, 2));
+	}
+
+	std::vector<BYTE> index;
+	REQUIRE_HR(ReadWholeFile(directory.GetFilePath(L"index"), &index));
+	REQUIRE(index.size() > 20);
+	index[16] ^= 0x01;
+	REQUIRE_HR(WriteWholeFile(directory.GetFilePath(L"index"), index.data(), index.size()));
+
+	CSegmentCache cache;
+	REQUIRE_HR(cache.Open(directory.GetPath(), 1024 * 1024));
+
+	SEGMENT_CACHE_STATS stats;
+	cache.GetStats(&stats);
+	CHECK_EQ((UINT32)0, stats.entries);
+	CHECK_EQ(S_FALSE, LookupSegment(cache, 1));
+	CHECK_EQ((size_t)0, CountFiles(directory, L".seg"));
+
+	// and works as usual from there
+	REQUIRE_HR(StoreSegment(cache, 3));
+	CHECK_EQ(S_OK, LookupSegment(cache, 3));
+}
+
+CORE_TEST(TruncatedIndexStartsEmpty)
+{
+	CTestDirectory directory;
+
+	{
+		CSegmentCache cache;
+		REQUIRE_HR(cache.Open(directory.GetPath(), 1024 * 1024));
+		REQUIRE_HR(StoreSegment(cache, 1));
+	}
+
+	std::vector<BYTE> index;
+	REQUIRE_HR(ReadWholeFile(directory.GetFilePath(L"index"), &index));
+
+	for (size_t size : { (size_t)0, (size_t)3, index.size() / 2, index.size() - 1 })
+	{
+		REQUIRE_HR(WriteWholeFile(directory.GetFilePath(L"index"), index.data(), size));
+
+		CSegmentCache cache;
+		REQUIRE_HR(cache.Open(directory.GetPath(), 1024 * 1024));
+
+		SEGMENT_CACHE_STATS stats;
+		cache.GetStats(&stats);
+		CHECK_EQ((UINT32)0, stats.entries);
+	}
+}
+
+// Files damaged or left behind by a crash are dropped on open, entries whose file went away on lookup
+CORE_TEST(DamagedSegmentFilesAreDropped)
+{
+	CTestDirectory directory;
+
+	{
+		CSegmentCache cache;
+		REQUIRE_HR(cache.Open(directory.GetPath(), 1024 * 1024));
+		REQUIRE_HR(StoreSegment(cache, 1));
+		REQUIRE_HR(StoreSegment(cache, 2));
+	}
+
+	std::vector<std::wstring> names = directory.ListFiles();
+	std::vector<std::wstring> segments;
+	for (const std::wstring& name : names)
+	{
+		if (name.size() > 4 && name.compare(name.size() - 4, 4, L".seg") == 0)
+			segments.push_back(name);
+	}
+	REQUIRE(segments.size() == 2);
+
+	// one segment truncated, an interrupted write and a file of unknown origin next to them
+	std::vector<BYTE> shortData(10, 0);
+	REQUIRE_HR(WriteWholeFile(directory.GetFilePath(segments[0]), shortData.data(), shortData.size()));
+	REQUIRE_HR(WriteWholeFile(directory.GetFilePath(L"0123456789abcdef.3.tmp"), shortData.data(), shortData.size()));
+	REQUIRE_HR(WriteWholeFile(directory.GetFilePath(L"fedcba9876543210.seg"), shortData.data(), shortData.size()));
+
+	CSegmentCache cache;
+	REQUIRE_HR(cache.Open(directory.GetPath(), 1024 * 1024));
+
+	SEGMENT_CACHE_STATS stats;
+	cache.GetStats(&stats);
+	CHECK_EQ((UINT32)1, stats.entries);
+	CHECK_EQ((size_t)0, CountFiles(directory, L".tmp"));
+	CHECK_EQ((size_t)1, CountFiles(directory, L".seg"));
+
+	// the remaining segment deleted behind the cache's back is a miss, and forgotten
+	std::vector<std::wstring> remaining = directory.ListFiles();
+	for (const std::wstring& name : remaining)
+	{
+		if (name.size() > 4 && name.compare(name.size() - 4, 4, L".seg") == 0)
+			RemoveFile(directory.GetFilePath(name));
+	}
+
+	CHECK_EQ(S_FALSE, LookupSegment(cache, 1));
+	CHECK_EQ(S_FALSE, LookupSegment(cache, 2));
+	cache.GetStats(&stats);
+	CHECK_EQ((UINT32)0, stats.entries);
+	CHECK_EQ((UINT64)0, stats.sizeBytes);
+}
+
+CORE_TEST(ClosedCacheRefusesRequests)
+{
+	CTestDirectory directory;
+	CSegmentCache cache;
+	std::shared_ptr<CMappedSegment> spSegment;
+	std::vector<BYTE> data = MakeSegment(1);
+
+	CHECK_EQ(E_ILLEGAL_METHOD_CALL, cache.Lookup(MakeKey(1), L"", &spSegment));
+	CHECK_EQ(E_ILLEGAL_METHOD_CALL, cache.Store(MakeKey(1), L"", data.data(), data.size()));
+	CHECK_EQ(E_ILLEGAL_METHOD_CALL, cache.Clear());
+
+	CHECK_EQ(E_INVALIDARG, cache.Open(L"", 1024));
+	CHECK_EQ(E_INVALIDARG, cache.Open(directory.GetPath(), 0));
+
+	REQUIRE_HR(cache.Open(directory.GetPath(), 1024 * 1024));
+	CHECK_EQ(E_ILLEGAL_METHOD_CALL, cache.Open(directory.GetPath(), 1024 * 1024));
+	CHECK_EQ(E_INVALIDARG, cache.Store(MakeKey(1), L"", data.data(), 0));
+	CHECK_EQ(E_INVALIDARG, cache.SetBudget(0));
+
+	cache.Close();
+	CHECK_EQ(E_ILLEGAL_METHOD_CALL, cache.Lookup(MakeKey(1), L"", &spSegment));
+}
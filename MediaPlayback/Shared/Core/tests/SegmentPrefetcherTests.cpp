@@ -0,0 +1,310 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreTest.h"
+#include "SegmentPrefetcher.h"
+#include "ThrottledOrigin.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#define TEST_SEGMENT_SIZE (64 * 1024)
+
+
+// Outcome of a Request, shared with its callback
+class CRequestResult
+{
+public:
+	CRequestResult() : m_done(false), m_hr(E_PENDING_RESULT), m_size(0) {}
+
+	static CSegmentPrefetcher::RequestCompleted Bind(_In_ const std::shared_ptr<CRequestResult>& spResult)
+	{
+		return [spResult](HRESULT hr, const SegmentData& data)
+		{
+			{
+				std::lock_guard<std::mutex> lock(spResult->m_lock);
+				spResult->m_done = true;
+				spResult->m_hr = hr;
+				spResult->m_size = data ? data->size() : 0;
+			}
+
+			spResult->m_completed.notify_all();
+		};
+	}
+
+	bool IsDone()
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		return m_done;
+	}
+
+	// E_PENDING_RESULT if the request is not answered within 10s
+	HRESULT Wait(_Out_opt_ size_t* pSize = nullptr)
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_completed.wait_for(lock, std::chrono::seconds(10), [this]() { return m_done; });
+
+		if (pSize != nullptr)
+			*pSize = m_size;
+
+		return m_hr;
+	}
+
+	static const HRESULT E_PENDING_RESULT = (HRESULT)0x8000000AL;
+
+private:
+	std::mutex m_lock;
+	std::condition_variable m_completed;
+	bool m_done;
+	HRESULT m_hr;
+	size_t m_size;
+};
+
+// Prefetcher of a 20 segment manifest downloading from a throttled origin on a pool of its own
+class CPrefetchFixture
+{
+public:
+	CPrefetchFixture(_In_ UINT32 latencyMs = 0, _In_ double bytesPerSecond = 0)
+		: m_origin(TEST_SEGMENT_SIZE, latencyMs, bytesPerSecond)
+	{
+		m_pool.Start(4);
+
+		CWorkerPool* pPool = &m_pool;
+		m_spPrefetcher = std::make_shared<CSegmentPrefetcher>(
+			[pPool](const CWorkerPool::Task& task) { return pPool->Submit(task); },
+			m_origin.GetFetch());
+		m_spPrefetcher->AddManifest(MakeSegmentManifest(20));
+	}
+
+	~CPrefetchFixture()
+	{
+		m_origin.Release();
+		m_spPrefetcher->Close();
+		m_pool.Shutdown();
+	}
+
+	CThrottledOrigin& GetOrigin() { return m_origin; }
+	CSegmentPrefetcher& GetPrefetcher() { return *m_spPrefetcher; }
+
+	std::shared_ptr<CRequestResult> Request(_In_ const wchar_t* pszRepresentationId, _In_ size_t index)
+	{
+		std::shared_ptr<CRequestResult> spResult = std::make_shared<CRequestResult>();
+		m_spPrefetcher->Request(MakeSegmentKey(pszRepresentationId, index), CRequestResult::Bind(spResult));
+
+		return spResult;
+	}
+
+	SEGMENT_PREFETCH_STATS GetStats()
+	{
+		SEGMENT_PREFETCH_STATS stats;
+		m_spPrefetcher->GetStats(&stats);
+
+		return stats;
+	}
+
+	bool WaitFor(_In_ const std::function<bool(const SEGMENT_PREFETCH_STATS& stats)>& fnDone)
+	{
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (std::chrono::steady_clock::now() < deadline)
+		{
+			if (fnDone(GetStats()))
+				return true;
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		return false;
+	}
+
+	// every download finished and readySegments of them waiting to be asked for
+	bool WaitForReady(_In_ UINT32 readySegments)
+	{
+		return WaitFor([readySegments](const SEGMENT_PREFETCH_STATS& stats) { return stats.inFlight == 0 && stats.readySegments == readySegments; });
+	}
+
+	bool WaitForActive(_In_ UINT32 active)
+	{
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (m_origin.GetActive() != active)
+		{
+			if (std::chrono::steady_clock::now() > deadline)
+				return false;
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		return true;
+	}
+
+private:
+	CThrottledOrigin m_origin;
+	CWorkerPool m_pool;
+	std::shared_ptr<CSegmentPrefetcher> m_spPrefetcher;
+};
+
+
+CORE_TEST(FillsTheWindowAheadOfTheRequest)
+{
+	CPrefetchFixture fixture;
+	fixture.GetPrefetcher().SetWindow(3 * TEST_SEGMENT_DURATION, 2);
+
+	size_t size = 0;
+	std::shared_ptr<CRequestResult> spFirst = fixture.Request(L"720p", 0);
+	CHECK_HR(spFirst->Wait(&size));
+	CHECK_EQ((size_t)TEST_SEGMENT_SIZE, size);
+
+	REQUIRE(fixture.WaitForReady(3));
+
+	SEGMENT_PREFETCH_STATS stats = fixture.GetStats();
+	CHECK_EQ(3 * TEST_SEGMENT_DURATION, stats.bufferAhead);
+	CHECK_EQ((UINT64)3 * TEST_SEGMENT_SIZE, stats.readyBytes);
+	CHECK_EQ((UINT64)4 * TEST_SEGMENT_SIZE, stats.bytesFetched);
+	CHECK_EQ((UINT64)1, stats.misses);
+
+	// a finished download answers inline, and the window moves on by a segment
+	std::shared_ptr<CRequestResult> spSecond = fixture.Request(L"720p", 1);
+	CHECK(spSecond->IsDone());
+	CHECK_HR(spSecond->Wait());
+
+	REQUIRE(fixture.WaitForReady(3));
+
+	stats = fixture.GetStats();
+	CHECK_EQ((UINT64)1, stats.hits);
+	CHECK_EQ((UINT64)0, stats.bytesWasted);
+	CHECK_EQ((size_t)1, fixture.GetOrigin().CountFetches(MakeSegmentKey(L"720p", 4)));
+
+	// not part of the manifest, left to the media source
+	std::shared_ptr<CRequestResult> spUnknown = std::make_shared<CRequestResult>();
+	SEGMENT_KEY unknown = MakeSegmentKey(L"480p", 0);
+	CHECK_EQ(S_FALSE, fixture.GetPrefetcher().Request(unknown, CRequestResult::Bind(spUnknown)));
+	CHECK(!spUnknown->IsDone());
+}
+
+CORE_TEST(RequestJoinsTheDownloadInFlight)
+{
+	CPrefetchFixture fixture;
+	fixture.GetPrefetcher().SetWindow(2 * TEST_SEGMENT_DURATION, 3);
+	fixture.GetOrigin().Hold();
+
+	std::shared_ptr<CRequestResult> spFirst = fixture.Request(L"720p", 0);
+	REQUIRE(fixture.WaitForActive(3));
+
+	std::shared_ptr<CRequestResult> spSecond = fixture.Request(L"720p", 1);
+	CHECK(!spSecond->IsDone());
+
+	SEGMENT_PREFETCH_STATS stats = fixture.GetStats();
+	CHECK_EQ((UINT64)1, stats.misses);
+	CHECK_EQ((UINT64)1, stats.joins);
+
+	fixture.GetOrigin().Release();
+
+	CHECK_HR(spFirst->Wait());
+	CHECK_HR(spSecond->Wait());
+	CHECK_EQ((size_t)1, fixture.GetOrigin().CountFetches(MakeSegmentKey(L"720p", 1)));
+}
+
+CORE_TEST(SeekDropsTheDownloadedWindow)
+{
+	CPrefetchFixture fixture;
+	fixture.GetPrefetcher().SetWindow(3 * TEST_SEGMENT_DURATION, 3);
+
+	CHECK_HR(fixture.Request(L"720p", 0)->Wait());
+	REQUIRE(fixture.WaitForReady(3));
+
+	// segments 1 to 3 were downloaded for nothing
+	CHECK_HR(fixture.Request(L"720p", 10)->Wait());
+	CHECK_EQ((UINT64)3 * TEST_SEGMENT_SIZE, fixture.GetStats().bytesWasted);
+
+	REQUIRE(fixture.WaitForReady(3));
+
+	SEGMENT_PREFETCH_STATS stats = fixture.GetStats();
+	CHECK_EQ(3 * TEST_SEGMENT_DURATION, stats.bufferAhead);
+	CHECK_EQ((UINT64)2, stats.misses);
+}
+
+CORE_TEST(SwitchCancelsTheOldRepresentation)
+{
+	CPrefetchFixture fixture;
+	fixture.GetPrefetcher().SetWindow(3 * TEST_SEGMENT_DURATION, 3);
+	fixture.GetOrigin().Hold();
+
+	std::shared_ptr<CRequestResult> spOld = fixture.Request(L"720p", 0);
+	REQUIRE(fixture.WaitForActive(3));
+
+	// the segment asked for goes past the cap, the window of the new representation waits for room
+	std::shared_ptr<CRequestResult> spNew = fixture.Request(L"1080p", 1);
+	CHECK_EQ(4u, fixture.GetStats().inFlight);
+
+	fixture.GetOrigin().Release();
+
+	CHECK_HR(spOld->Wait());
+	CHECK_HR(spNew->Wait());
+	REQUIRE(fixture.WaitForReady(3));
+
+	// the 720p look-ahead stopped at its first chunk, nothing of it was delivered
+	SEGMENT_PREFETCH_STATS stats = fixture.GetStats();
+	CHECK_EQ(2u, fixture.GetOrigin().GetCancelled());
+	CHECK_EQ((UINT64)0, stats.bytesWasted);
+	CHECK_EQ((UINT64)5 * TEST_SEGMENT_SIZE, stats.bytesFetched);
+	CHECK_EQ(3 * TEST_SEGMENT_DURATION, stats.bufferAhead);
+}
+
+CORE_TEST(InFlightStaysWithinTheCap)
+{
+	CPrefetchFixture fixture(1, 8.0 * 1024 * 1024);
+	fixture.GetPrefetcher().SetWindow(10 * TEST_SEGMENT_DURATION, 3);
+	fixture.GetOrigin().Hold();
+
+	std::shared_ptr<CRequestResult> spFirst = fixture.Request(L"720p", 0);
+	CHECK_EQ(3u, fixture.GetStats().inFlight);
+	REQUIRE(fixture.WaitForActive(3));
+
+	fixture.GetOrigin().Release();
+
+	CHECK_HR(spFirst->Wait());
+	REQUIRE(fixture.WaitForReady(10));
+
+	CHECK(fixture.GetOrigin().GetMaxActive() <= 3);
+	CHECK_EQ((size_t)11, fixture.GetOrigin().GetFetched().size());
+	CHECK_EQ(10 * TEST_SEGMENT_DURATION, fixture.GetStats().bufferAhead);
+}
+
+CORE_TEST(CloseFailsTheWaitingRequests)
+{
+	CPrefetchFixture fixture;
+	fixture.GetPrefetcher().SetWindow(TEST_SEGMENT_DURATION, 2);
+	fixture.GetOrigin().Hold();
+
+	std::shared_ptr<CRequestResult> spWaiting = fixture.Request(L"720p", 0);
+	REQUIRE(fixture.WaitForActive(2));
+
+	// answered by Close itself, not by the downloads
+	fixture.GetPrefetcher().Close();
+	CHECK(spWaiting->IsDone());
+	CHECK_EQ(E_ABORT, spWaiting->Wait());
+
+	std::shared_ptr<CRequestResult> spLate = std::make_shared<CRequestResult>();
+	CHECK_EQ(S_FALSE, fixture.GetPrefetcher().Request(MakeSegmentKey(L"720p", 1), CRequestResult::Bind(spLate)));
+
+	fixture.GetOrigin().Release();
+
+	REQUIRE(fixture.WaitForReady(0));
+	CHECK_EQ(2u, fixture.GetOrigin().GetCancelled());
+	CHECK(!spLate->IsDone());
+
+	SEGMENT_PREFETCH_STATS stats = fixture.GetStats();
+	CHECK_EQ((UINT64)0, stats.bytesFetched);
+	CHECK_EQ((UINT64)0, stats.readyBytes);
+}
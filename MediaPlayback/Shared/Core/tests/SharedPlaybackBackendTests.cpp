@@ -0,0 +1,360 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreTest.h"
+#include "SharedPlaybackBackend.h"
+#include "SoftwarePlayer.h"
+
+#include <memory>
+#include <vector>
+
+#define SECOND SOFTWARE_TICKS_PER_SECOND
+
+
+// Players on one shared backend, moved by one clock
+class CSharedPlayers
+{
+public:
+	CSharedPlayers()
+		: m_spBackend(std::make_shared<CSoftwarePlaybackBackend>())
+		, m_spShared(std::make_shared<CSharedPlaybackBackend>(m_spBackend))
+	{
+		m_spBackend->RegisterMedia(L"clip.mp4", MakeSoftwareMedia(64, 36, 10 * SECOND));
+		m_spBackend->RegisterMedia(L"other.mp4", MakeSoftwareMedia(64, 36, 10 * SECOND));
+	}
+
+	CSoftwarePlayer* Add()
+	{
+		m_players.push_back(std::unique_ptr<CSoftwarePlayer>(new CSoftwarePlayer(m_spBackend, m_spShared)));
+		m_players.back()->Initialize();
+
+		return m_players.back().get();
+	}
+
+	void Remove(_In_ CSoftwarePlayer* pPlayer)
+	{
+		for (auto it = m_players.begin(); it != m_players.end(); ++it)
+		{
+			if (it->get() == pPlayer)
+			{
+				m_players.erase(it);
+				return;
+			}
+		}
+	}
+
+	// one clock tick, then a render event for every player
+	void Run(_In_ LONGLONG ticks)
+	{
+		while (ticks > 0)
+		{
+			LONGLONG advance = std::min<LONGLONG>(TEST_FRAME_DURATION, ticks);
+			m_spBackend->Advance(advance);
+			for (auto& spPlayer : m_players)
+				spPlayer->GetCore().RenderEvent();
+			ticks -= advance;
+		}
+	}
+
+	SHARED_SOURCE_STATS GetStats()
+	{
+		SHARED_SOURCE_STATS stats = {};
+		m_spShared->GetStats(&stats);
+
+		return stats;
+	}
+
+	std::shared_ptr<CSharedPlaybackBackend>& GetShared() { return m_spShared; }
+
+private:
+	std::shared_ptr<CSoftwarePlaybackBackend> m_spBackend;
+	std::shared_ptr<CSharedPlaybackBackend> m_spShared;
+	std::vector<std::unique_ptr<CSoftwarePlayer>> m_players;
+};
+
+// Sink of a session used without a player
+class CCountingSink
+	: public IPlaybackSessionSink
+{
+public:
+	CCountingSink() : opened(0), frames(0), cues(0) {}
+
+	virtual void OnSessionOpened() override { opened++; }
+	virtual void OnSessionStateChanged(PlaybackState) override {}
+	virtual void OnSessionEnded() override {}
+	virtual void OnSessionFailed(HRESULT) override {}
+	virtual void OnSessionSizeChanged() override {}
+	virtual void OnSessionFrameAvailable() override { frames++; }
+	virtual void OnSessionVideoTracksChanged() override {}
+	virtual void OnSessionSubtitleTracksChanged() override {}
+	virtual void OnSessionSubtitleCueEntered(const SUBTITLE_CUE&) override { cues++; }
+	virtual void OnSessionSubtitleCueExited(const SUBTITLE_CUE&) override {}
+	virtual void OnSessionStatusChanged() override {}
+
+	UINT32 opened;
+	UINT32 frames;
+	UINT32 cues;
+};
+
+
+// Players on the same content show the frames of one decode, in step, whichever of them is driven
+CORE_TEST(PlayersOnTheSameContentShareOneDecode)
+{
+	CSharedPlayers players;
+	CSoftwarePlayer* pFirst = players.Add();
+	CSoftwarePlayer* pSecond = players.Add();
+	CSoftwarePlayer* pThird = players.Add();
+	CSoftwarePlayer* pOther = players.Add();
+
+	REQUIRE_HR(pFirst->GetCore().LoadContent(L"clip.mp4"));
+	REQUIRE_HR(pSecond->GetCore().LoadContent(L"clip.mp4"));
+	REQUIRE_HR(pThird->GetCore().LoadContent(L"clip.mp4"));
+	REQUIRE_HR(pOther->GetCore().LoadContent(L"other.mp4"));
+	players.Run(TEST_FRAME_DURATION);
+
+	SHARED_SOURCE_STATS stats = players.GetStats();
+	CHECK_EQ(2u, stats.sources);
+	CHECK_EQ(4u, stats.views);
+
+	REQUIRE_HR(pSecond->GetCore().Play());
+	CHECK_EQ(1u, pFirst->GetStates().Count(StateType::StateType_StateChanged, PlaybackState::PlaybackState_Playing));
+	CHECK_EQ(1u, pThird->GetStates().Count(StateType::StateType_StateChanged, PlaybackState::PlaybackState_Playing));
+	CHECK_EQ(0u, pOther->GetStates().Count(StateType::StateType_StateChanged, PlaybackState::PlaybackState_Playing));
+
+	SHARED_SOURCE_STATS before = players.GetStats();
+	players.Run(SECOND);
+
+	CHECK_EQ(SECOND, pFirst->GetPosition());
+	CHECK_EQ(pFirst->GetPresentedFrame(), pSecond->GetPresentedFrame());
+	CHECK_EQ(pFirst->GetPresentedFrame(), pThird->GetPresentedFrame());
+	CHECK_EQ(0, pOther->GetPosition());
+
+	// a decoder copy per frame, the other two players share it
+	stats = players.GetStats();
+	CHECK_EQ(before.decodedCopies + 30, stats.decodedCopies);
+	CHECK_EQ(before.sharedCopies + 60, stats.sharedCopies);
+
+	REQUIRE_HR(pThird->GetCore().Seek(5 * SECOND));
+	CHECK_EQ(5 * SECOND, pFirst->GetPosition());
+	CHECK_EQ(5 * SECOND, pSecond->GetPosition());
+}
+
+// A player joining an open source sees what it would have seen opening the content itself
+CORE_TEST(JoiningPlayerGetsTheStateReplayed)
+{
+	CSharedPlayers players;
+	CSoftwarePlayer* pFirst = players.Add();
+	REQUIRE_HR(pFirst->GetCore().LoadContent(L"clip.mp4"));
+	players.Run(TEST_FRAME_DURATION);
+	REQUIRE_HR(pFirst->GetCore().Play());
+	players.Run(2 * SECOND);
+
+	CSoftwarePlayer* pLate = players.Add();
+	REQUIRE_HR(pLate->GetCore().LoadContent(L"clip.mp4"));
+
+	PLAYBACK_STATE opened = {};
+	REQUIRE(pLate->GetStates().FindLast(StateType::StateType_Opened, &opened));
+	CHECK_EQ(10 * SECOND, opened.description.duration);
+	CHECK_EQ(1u, pLate->GetStates().Count(StateType::StateType_StateChanged, PlaybackState::PlaybackState_Playing));
+	CHECK_EQ(2 * SECOND, pLate->GetPosition());
+
+	// surfaces on the next render event, frames from then on
+	players.Run(2 * TEST_FRAME_DURATION);
+	CHECK_EQ(1u, pLate->GetStates().Count(StateType::StateType_NewFrameTexture));
+	CHECK_EQ(pFirst->GetPresentedFrame(), pLate->GetPresentedFrame());
+
+	// the source keeps playing for the others when one stops, it is not a transport call
+	REQUIRE_HR(pLate->GetCore().Stop());
+	CHECK_EQ(1u, players.GetStats().views);
+	players.Run(SECOND);
+	CHECK_EQ(3 * SECOND + 2 * TEST_FRAME_DURATION, pFirst->GetPosition());
+}
+
+// The decoder closes with its last view, stopped or destroyed, and a source reopens when a player comes back to it
+CORE_TEST(SourceClosesWithItsLastView)
+{
+	CSharedPlayers players;
+	CSoftwarePlayer* pFirst = players.Add();
+	CSoftwarePlayer* pSecond = players.Add();
+
+	REQUIRE_HR(pFirst->GetCore().LoadContent(L"clip.mp4"));
+	REQUIRE_HR(pSecond->GetCore().LoadContent(L"clip.mp4"));
+	players.Run(TEST_FRAME_DURATION);
+	REQUIRE_HR(pFirst->GetCore().Play());
+	players.Run(SECOND);
+
+	players.Remove(pFirst);
+	CHECK_EQ(1u, players.GetStats().sources);
+	CHECK_EQ(1u, players.GetStats().views);
+
+	// the survivor goes on with the decode
+	players.Run(SECOND);
+	CHECK_EQ(2 * SECOND, pSecond->GetPosition());
+
+	REQUIRE_HR(pSecond->GetCore().Stop());
+	CHECK_EQ(0u, players.GetStats().sources);
+	CHECK_EQ(0u, players.GetStats().views);
+
+	// the content opens afresh, from the start
+	pSecond->GetStates().Clear();
+	REQUIRE_HR(pSecond->GetCore().LoadContent(L"clip.mp4"));
+	players.Run(TEST_FRAME_DURATION);
+	CHECK_EQ(1u, pSecond->GetStates().Count(StateType::StateType_Opened));
+	CHECK_EQ(0, pSecond->GetPosition());
+
+	// players hold the backend, the backend holds no source nobody views
+	players.Remove(pSecond);
+	CHECK_EQ(0u, players.GetStats().sources);
+	CHECK_EQ(1, (int)players.GetShared().use_count());
+}
+
+// Views hold their source, the backend only tracks it; a source goes with its last view, and its session with it
+CORE_TEST(ViewsHoldTheirSource)
+{
+	std::shared_ptr<CSoftwarePlaybackBackend> spBackend = std::make_shared<CSoftwarePlaybackBackend>();
+	spBackend->RegisterMedia(L"clip.mp4", MakeSoftwareMedia(64, 36, 10 * SECOND));
+	CSharedPlaybackBackend shared(spBackend);
+
+	CCountingSink firstSink;
+	CCountingSink secondSink;
+	std::shared_ptr<IPlaybackSession> spFirst;
+	std::shared_ptr<IPlaybackSession> spSecond;
+	REQUIRE_HR(shared.CreateSession(&firstSink, &spFirst));
+	REQUIRE_HR(shared.CreateSession(&secondSink, &spSecond));
+
+	REQUIRE_HR(spFirst->Open(L"clip.mp4"));
+	REQUIRE_HR(spSecond->Open(L"clip.mp4"));
+
+	std::shared_ptr<CSharedSource> spSource;
+	REQUIRE_HR(shared.GetSource(L"clip.mp4", &spSource));
+	CHECK_EQ(2u, spSource->GetViewCount());
+	CHECK_EQ(3, (int)spSource.use_count());
+
+	std::weak_ptr<CSharedSource> wpSource = spSource;
+	spSource.reset();
+
+	spBackend->Advance(TEST_FRAME_DURATION);
+	CHECK_EQ(1u, firstSink.opened);
+	CHECK_EQ(1u, secondSink.opened);
+
+	spFirst.reset();
+	REQUIRE(!wpSource.expired());
+
+	// its last view closed, the source is gone and a new one opens for the next view
+	REQUIRE_HR(spSecond->Close());
+	CHECK(wpSource.expired());
+	CHECK(!spSecond->HasSource());
+	CHECK_EQ(E_ILLEGAL_METHOD_CALL, spSecond->Play());
+
+	REQUIRE_HR(spSecond->Open(L"clip.mp4"));
+	spBackend->Advance(TEST_FRAME_DURATION);
+	CHECK_EQ(2u, secondSink.opened);
+
+	// opening content that does not exist leaves nothing behind
+	CCountingSink missingSink;
+	std::shared_ptr<IPlaybackSession> spMissing;
+	REQUIRE_HR(shared.CreateSession(&missingSink, &spMissing));
+	CHECK(FAILED(spMissing->Open(L"missing.mp4")));
+	CHECK(!spMissing->HasSource());
+
+	SHARED_SOURCE_STATS stats = {};
+	shared.GetStats(&stats);
+	CHECK_EQ(1u, stats.sources);
+	CHECK_EQ(1u, stats.views);
+}
+
+// A frame is copied out of the decoder once per distinct surface size, the views of that size share the copy
+CORE_TEST(FramesAreCopiedOncePerSize)
+{
+	std::shared_ptr<CSoftwarePlaybackBackend> spBackend = std::make_shared<CSoftwarePlaybackBackend>();
+	spBackend->RegisterMedia(L"clip.mp4", MakeSoftwareMedia(64, 36, 10 * SECOND));
+	CSharedPlaybackBackend shared(spBackend);
+
+	CCountingSink sinks[3];
+	std::shared_ptr<IPlaybackSession> spSessions[3];
+	for (int i = 0; i < 3; i++)
+	{
+		REQUIRE_HR(shared.CreateSession(&sinks[i], &spSessions[i]));
+		REQUIRE_HR(spSessions[i]->Open(L"clip.mp4"));
+	}
+
+	spBackend->Advance(TEST_FRAME_DURATION);
+	REQUIRE_HR(spSessions[0]->Play());
+	spBackend->Advance(TEST_FRAME_DURATION);
+	CHECK_EQ(1u, sinks[2].frames);
+
+	std::shared_ptr<IPlaybackSurface> spFull[2];
+	std::shared_ptr<IPlaybackSurface> spSmall;
+	PLAYBACK_SURFACE_DESC fullDesc = { 64, 36, false, FrameFormat::FrameFormat_BGRA32, SurfaceUsage::SurfaceUsage_Presented };
+	PLAYBACK_SURFACE_DESC smallDesc = { 32, 18, false, FrameFormat::FrameFormat_BGRA32, SurfaceUsage::SurfaceUsage_Presented };
+	REQUIRE_HR(spBackend->CreateSurface(fullDesc, &spFull[0]));
+	REQUIRE_HR(spBackend->CreateSurface(fullDesc, &spFull[1]));
+	REQUIRE_HR(spBackend->CreateSurface(smallDesc, &spSmall));
+
+	REQUIRE_HR(spSessions[0]->CopyFrameToSurface(spFull[0].get()));
+	REQUIRE_HR(spSessions[1]->CopyFrameToSurface(spFull[1].get()));
+	REQUIRE_HR(spSessions[2]->CopyFrameToSurface(spSmall.get()));
+
+	SHARED_SOURCE_STATS stats = {};
+	shared.GetStats(&stats);
+	CHECK_EQ(2ull, stats.decodedCopies);
+	CHECK_EQ(1ull, stats.sharedCopies);
+
+	UINT64 frameIndex = static_cast<CSoftwarePlaybackSurface*>(spFull[0].get())->GetFrameIndex();
+	CHECK_EQ(frameIndex, static_cast<CSoftwarePlaybackSurface*>(spFull[1].get())->GetFrameIndex());
+	CHECK_EQ(frameIndex, static_cast<CSoftwarePlaybackSurface*>(spSmall.get())->GetFrameIndex());
+
+	// the next frame is copied out again
+	spBackend->Advance(TEST_FRAME_DURATION);
+	REQUIRE_HR(spSessions[1]->CopyFrameToSurface(spFull[1].get()));
+	shared.GetStats(&stats);
+	CHECK_EQ(3ull, stats.decodedCopies);
+	CHECK_EQ(frameIndex + 1, static_cast<CSoftwarePlaybackSurface*>(spFull[1].get())->GetFrameIndex());
+
+	// a single view copies straight from the decoder
+	spSessions[1].reset();
+	spSessions[2].reset();
+	REQUIRE_HR(spSessions[0]->CopyFrameToSurface(spFull[0].get()));
+	shared.GetStats(&stats);
+	CHECK_EQ(4ull, stats.decodedCopies);
+	CHECK_EQ(1ull, stats.sharedCopies);
+}
+
+// Subtitle cues of the source reach every view
+CORE_TEST(CuesReachEveryView)
+{
+	SOFTWARE_MEDIA_DESCRIPTION media = MakeSoftwareMedia(64, 36, 10 * SECOND);
+	media.subtitleCues = { { SECOND, 2 * SECOND, { L"en", L"1", L"en", { L"one" } } } };
+
+	std::shared_ptr<CSoftwarePlaybackBackend> spBackend = std::make_shared<CSoftwarePlaybackBackend>();
+	spBackend->RegisterMedia(L"clip.mp4", media);
+	CSharedPlaybackBackend shared(spBackend);
+
+	CCountingSink sinks[2];
+	std::shared_ptr<IPlaybackSession> spSessions[2];
+	for (int i = 0; i < 2; i++)
+	{
+		REQUIRE_HR(shared.CreateSession(&sinks[i], &spSessions[i]));
+		REQUIRE_HR(spSessions[i]->Open(L"clip.mp4"));
+	}
+
+	spBackend->Advance(TEST_FRAME_DURATION);
+	REQUIRE_HR(spSessions[0]->Play());
+	spBackend->Advance(3 * SECOND / 2);
+
+	CHECK_EQ(1u, sinks[0].cues);
+	CHECK_EQ(1u, sinks[1].cues);
+
+	std::vector<MEDIA_TIME_RANGE> ranges;
+	REQUIRE_HR(spSessions[1]->GetBufferedRanges(&ranges));
+	REQUIRE(ranges.size() == 1);
+	CHECK_EQ(10 * SECOND, ranges[0].end);
+}
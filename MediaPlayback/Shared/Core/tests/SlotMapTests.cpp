@@ -0,0 +1,209 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreTest.h"
+#include "SlotMap.h"
+
+#include <map>
+#include <random>
+
+
+CORE_TEST(InsertGetRemove)
+{
+	CSlotMap<int> slotMap;
+	CSlotMap<int>::Handle first = 0;
+	CSlotMap<int>::Handle second = 0;
+
+	REQUIRE_HR(slotMap.Insert(10, &first));
+	REQUIRE_HR(slotMap.Insert(20, &second));
+	CHECK(first != 0);
+	CHECK(first != second);
+	CHECK_EQ((UINT32)2, slotMap.GetCount());
+
+	REQUIRE(slotMap.Get(first) != nullptr);
+	CHECK_EQ(10, *slotMap.Get(first));
+	CHECK_EQ(20, *slotMap.Get(second));
+
+	CHECK(slotMap.Remove(first));
+	CHECK(!slotMap.Remove(first));
+	CHECK(slotMap.Get(first) == nullptr);
+	CHECK(!slotMap.IsValid(first));
+	CHECK_EQ(20, *slotMap.Get(second));
+	CHECK_EQ((UINT32)1, slotMap.GetCount());
+}
+
+CORE_TEST(HandlesNeverIssuedAreRejected)
+{
+	CSlotMap<int> slotMap;
+	CSlotMap<int>::Handle handle = 0;
+	REQUIRE_HR(slotMap.Insert(10, &handle));
+
+	CHECK(slotMap.Get(0) == nullptr);
+	CHECK(slotMap.Get(handle + 1) == nullptr);					// slot that does not exist
+	CHECK(slotMap.Get(handle + (1 << _SlotMapIndexBits_)) == nullptr);	// generation not issued yet
+	CHECK(slotMap.Get(0xFFFFFFFF) == nullptr);
+	CHECK(!slotMap.Remove(0));
+}
+
+CORE_TEST(ReusedSlotRejectsTheOldHandle)
+{
+	CSlotMap<int> slotMap;
+	CSlotMap<int>::Handle old = 0;
+	CSlotMap<int>::Handle reused = 0;
+
+	REQUIRE_HR(slotMap.Insert(10, &old));
+	REQUIRE(slotMap.Remove(old));
+	REQUIRE_HR(slotMap.Insert(20, &reused));
+
+	// same slot, next generation
+	CHECK_EQ(old & _SlotMapIndexMask_, reused & _SlotMapIndexMask_);
+	CHECK_EQ((old >> _SlotMapIndexBits_) + 1, reused >> _SlotMapIndexBits_);
+
+	CHECK(slotMap.Get(old) == nullptr);
+	CHECK(!slotMap.Remove(old));
+	REQUIRE(slotMap.Get(reused) != nullptr);
+	CHECK_EQ(20, *slotMap.Get(reused));
+}
+
+CORE_TEST(GenerationWrapSkipsZero)
+{
+	CSlotMap<int> slotMap;
+	CSlotMap<int>::Handle handle = 0;
+
+	for (UINT32 i = 0; i < 0x10000 + 2; i++)
+	{
+		REQUIRE_HR(slotMap.Insert((int)i, &handle));
+		CHECK(handle != 0);
+		CHECK((handle >> _SlotMapIndexBits_) != 0);
+		REQUIRE(slotMap.Remove(handle));
+	}
+
+	CHECK_EQ((UINT32)0, slotMap.GetCount());
+}
+
+CORE_TEST(RemoveKeepsTheValuesDense)
+{
+	CSlotMap<int> slotMap;
+	CSlotMap<int>::Handle handles[5] = {};
+
+	for (int i = 0; i < 5; i++)
+		REQUIRE_HR(slotMap.Insert(i, &handles[i]));
+
+	REQUIRE(slotMap.Remove(handles[1]));
+	REQUIRE(slotMap.Remove(handles[3]));
+
+	int sum = 0;
+	for (int value : slotMap)
+		sum += value;
+	CHECK_EQ(0 + 2 + 4, sum);
+	CHECK_EQ((UINT32)3, slotMap.GetCount());
+
+	// the dense handles resolve to the dense values
+	for (UINT32 i = 0; i < slotMap.GetCount(); i++)
+	{
+		REQUIRE(slotMap.Get(slotMap.GetHandleAt(i)) != nullptr);
+		CHECK_EQ(slotMap.GetAt(i), *slotMap.Get(slotMap.GetHandleAt(i)));
+	}
+
+	CHECK_EQ(4, *slotMap.Get(handles[4]));
+}
+
+CORE_TEST(ClearInvalidatesEveryHandle)
+{
+	CSlotMap<int> slotMap;
+	std::vector<CSlotMap<int>::Handle> handles(8);
+
+	for (size_t i = 0; i < handles.size(); i++)
+		REQUIRE_HR(slotMap.Insert((int)i, &handles[i]));
+
+	slotMap.Clear();
+	CHECK_EQ((UINT32)0, slotMap.GetCount());
+
+	// refill the same slots, none of the old handles may resolve
+	for (size_t i = 0; i < handles.size(); i++)
+	{
+		CSlotMap<int>::Handle handle = 0;
+		REQUIRE_HR(slotMap.Insert(100, &handle));
+	}
+
+	for (size_t i = 0; i < handles.size(); i++)
+		CHECK(slotMap.Get(handles[i]) == nullptr);
+}
+
+CORE_TEST(FullMapFailsInsert)
+{
+	CSlotMap<int> slotMap;
+	CSlotMap<int>::Handle handle = 0;
+
+	for (UINT32 i = 0; i < _SlotMapMaxCount_; i++)
+		REQUIRE_HR(slotMap.Insert((int)i, &handle));
+
+	CHECK_EQ(E_OUTOFMEMORY, slotMap.Insert(0, &handle));
+	CHECK_EQ((CSlotMap<int>::Handle)0, handle);
+
+	// a removed value frees its slot for the next insert
+	REQUIRE(slotMap.Remove(slotMap.GetHandleAt(0)));
+	CHECK_HR(slotMap.Insert(0, &handle));
+}
+
+// Random inserts and removes against a std::map holding the same values
+CORE_TEST(ChurnMatchesReference)
+{
+	CSlotMap<int> slotMap;
+	std::map<CSlotMap<int>::Handle, int> reference;
+	std::vector<CSlotMap<int>::Handle> removed;
+	std::mt19937 random(5);
+
+	for (int i = 0; i < 100000; i++)
+	{
+		if (reference.empty() || random() % 3 != 0)
+		{
+			CSlotMap<int>::Handle handle = 0;
+			REQUIRE_HR(slotMap.Insert(i, &handle));
+			REQUIRE(reference.find(handle) == reference.end());
+			reference[handle] = i;
+		}
+		else
+		{
+			auto it = reference.begin();
+			std::advance(it, random() % reference.size());
+			REQUIRE(slotMap.Remove(it->first));
+			removed.push_back(it->first);
+			reference.erase(it);
+		}
+
+		if (reference.size() > 1000)
+		{
+			for (auto& entry : reference)
+			{
+				REQUIRE(slotMap.Remove(entry.first));
+				removed.push_back(entry.first);
+			}
+			reference.clear();
+		}
+	}
+
+	CHECK_EQ((UINT32)reference.size(), slotMap.GetCount());
+	for (auto& entry : reference)
+	{
+		REQUIRE(slotMap.Get(entry.first) != nullptr);
+		CHECK_EQ(entry.second, *slotMap.Get(entry.first));
+	}
+
+	// removed handles stay invalid unless the generation of the slot came around again, which takes 65535 reuses
+	size_t resolved = 0;
+	for (CSlotMap<int>::Handle handle : removed)
+	{
+		if (slotMap.IsValid(handle) && reference.find(handle) == reference.end())
+			resolved++;
+	}
+	CHECK_EQ((size_t)0, resolved);
+}
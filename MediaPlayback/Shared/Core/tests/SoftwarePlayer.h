@@ -0,0 +1,177 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Players on the software backend for the tests and benchmarks: media descriptions, a recorder of the states a player
+// reports, and a player bundled with its backend and a render loop.
+
+#include "PlaybackCore.h"
+#include "SoftwarePlaybackBackend.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#define TEST_FRAME_DURATION (SOFTWARE_TICKS_PER_SECOND / 30)
+
+
+inline SOFTWARE_MEDIA_DESCRIPTION MakeSoftwareMedia(
+	_In_ UINT32 width,
+	_In_ UINT32 height,
+	_In_ LONGLONG duration,
+	_In_ bool canSeek = true)
+{
+	SOFTWARE_MEDIA_DESCRIPTION media;
+	media.width = width;
+	media.height = height;
+	media.duration = duration;
+	media.frameRateNumerator = 30;
+	media.frameRateDenominator = 1;
+	media.openLatency = 0;
+	media.openBlockingTime = 0;
+	media.openResult = S_OK;
+	media.decodeTime = 0;
+	media.canSeek = canSeek;
+	media.isStereoscopic = false;
+	media.isAdaptive = false;
+
+	return media;
+}
+
+
+// Target of a player's StateChangedCallback
+class CStateRecorder
+{
+public:
+	static void UNITY_INTERFACE_API OnStateChanged(_In_ void* pClientObject, _In_ PLAYBACK_STATE state)
+	{
+		static_cast<CStateRecorder*>(pClientObject)->Record(state);
+	}
+
+	void Record(_In_ const PLAYBACK_STATE& state)
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_states.push_back(state);
+	}
+
+	void Clear()
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_states.clear();
+	}
+
+	std::vector<PLAYBACK_STATE> GetStates()
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		return m_states;
+	}
+
+	size_t Count(_In_ StateType type)
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		return (size_t)std::count_if(m_states.begin(), m_states.end(), [type](const PLAYBACK_STATE& state) { return state.type == type; });
+	}
+
+	size_t Count(_In_ StateType type, _In_ PlaybackState playbackState)
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		return (size_t)std::count_if(m_states.begin(), m_states.end(),
+			[type, playbackState](const PLAYBACK_STATE& state) { return state.type == type && state.state == playbackState; });
+	}
+
+	// the latest state of the type
+	bool FindLast(_In_ StateType type, _Out_ PLAYBACK_STATE* pState)
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		for (auto it = m_states.rbegin(); it != m_states.rend(); ++it)
+		{
+			if (it->type == type)
+			{
+				*pState = *it;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+private:
+	std::mutex m_lock;
+	std::vector<PLAYBACK_STATE> m_states;
+};
+
+
+// Player with a backend of its own, or one shared with other players. The player may play through a backend wrapping
+// the software one, like CSharedPlaybackBackend; the virtual clock is still that of the software backend.
+class CSoftwarePlayer
+{
+public:
+	explicit CSoftwarePlayer(_In_ const std::shared_ptr<CSoftwarePlaybackBackend>& spBackend = std::make_shared<CSoftwarePlaybackBackend>())
+		: m_spBackend(spBackend)
+		, m_spPlayerBackend(spBackend)
+	{
+	}
+
+	CSoftwarePlayer(_In_ const std::shared_ptr<CSoftwarePlaybackBackend>& spBackend, _In_ const std::shared_ptr<IPlaybackBackend>& spPlayerBackend)
+		: m_spBackend(spBackend)
+		, m_spPlayerBackend(spPlayerBackend)
+	{
+	}
+
+	// without a callback the states are queued for DrainEvents
+	HRESULT Initialize(_In_ bool callback = true)
+	{
+		return m_core.Initialize(m_spPlayerBackend, callback ? &CStateRecorder::OnStateChanged : nullptr, &m_states);
+	}
+
+	CSoftwarePlaybackBackend* GetBackend() { return m_spBackend.get(); }
+	CPlaybackCore& GetCore() { return m_core; }
+	CStateRecorder& GetStates() { return m_states; }
+
+	// Moves the virtual clock in steps of a frame with a render event after each, like Unity's render loop does
+	void Run(_In_ LONGLONG ticks, _In_ LONGLONG step = TEST_FRAME_DURATION)
+	{
+		while (ticks > 0)
+		{
+			LONGLONG advance = std::min(step, ticks);
+			m_spBackend->Advance(advance);
+			m_core.RenderEvent();
+			ticks -= advance;
+		}
+	}
+
+	// index of the frame on the playback surface, 0 if there is no surface
+	UINT64 GetPresentedFrame()
+	{
+		std::shared_ptr<IPlaybackSurface> spSurface = m_core.GetPlaybackSurface();
+		CSoftwarePlaybackSurface* pSurface = dynamic_cast<CSoftwarePlaybackSurface*>(spSurface.get());
+
+		return pSurface ? pSurface->GetFrameIndex() : 0;
+	}
+
+	LONGLONG GetPosition()
+	{
+		LONGLONG duration = 0;
+		LONGLONG position = -1;
+		m_core.GetDurationAndPosition(&duration, &position);
+
+		return position;
+	}
+
+private:
+	CStateRecorder m_states;
+	std::shared_ptr<CSoftwarePlaybackBackend> m_spBackend;
+	std::shared_ptr<IPlaybackBackend> m_spPlayerBackend;
+	CPlaybackCore m_core;
+};
@@ -0,0 +1,386 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreTest.h"
+#include "SourceClassifier.h"
+
+#include <string.h>
+
+
+// SourceType is not printable, the checks compare its value
+static UINT32 Classify(_In_ CSourceClassifier& classifier, _In_ const wchar_t* pszUri)
+{
+	return (UINT32)classifier.ClassifyUri(pszUri);
+}
+
+static UINT32 Sniff(_In_ const char* pszData, _In_ size_t size)
+{
+	return (UINT32)CSourceClassifier::SniffContent(reinterpret_cast<const BYTE*>(pszData), (UINT32)size);
+}
+
+static UINT32 Sniff(_In_ const char* pszData)
+{
+	return Sniff(pszData, strlen(pszData));
+}
+
+#define LOCAL ((UINT32)SourceType::SourceType_Local)
+#define PROGRESSIVE ((UINT32)SourceType::SourceType_Progressive)
+#define ADAPTIVE ((UINT32)SourceType::SourceType_Adaptive)
+#define UNKNOWN ((UINT32)SourceType::SourceType_Unknown)
+
+// Server of ResolveSource: what the probe and the adaptive attempt find, and how often they were made
+class CFakeSourceServer
+{
+public:
+	CFakeSourceServer(_In_ SourceType probed, _In_ HRESULT hrAdaptive, _In_ bool notManifest = false)
+		: probes(0)
+		, attempts(0)
+		, m_probed(probed)
+		, m_hrProbe(S_OK)
+		, m_hrAdaptive(hrAdaptive)
+		, m_notManifest(notManifest)
+	{
+	}
+
+	void FailProbe(_In_ HRESULT hr) { m_hrProbe = hr; }
+
+	// S_OK if the adaptive attempt opened the source
+	HRESULT Resolve(_In_ CSourceClassifier& classifier, _In_ const wchar_t* pszUri, _Out_ UINT32* pType)
+	{
+		SourceType type = SourceType::SourceType_Unknown;
+		HRESULT hr = classifier.ResolveSource(pszUri,
+			[this](SourceType* pProbed)
+			{
+				probes++;
+				*pProbed = m_probed;
+				return m_hrProbe;
+			},
+			[this](bool* pNotManifest)
+			{
+				attempts++;
+				*pNotManifest = m_notManifest;
+				return m_hrAdaptive;
+			},
+			&type);
+
+		*pType = (UINT32)type;
+		return hr;
+	}
+
+	UINT32 probes;
+	UINT32 attempts;
+
+private:
+	SourceType m_probed;
+	HRESULT m_hrProbe;
+	HRESULT m_hrAdaptive;
+	bool m_notManifest;
+};
+
+
+CORE_TEST(LocalContentIsLocal)
+{
+	CSourceClassifier classifier;
+
+	CHECK_EQ(LOCAL, Classify(classifier, L"c:\\videos\\clip.mp4"));
+	CHECK_EQ(LOCAL, Classify(classifier, L"C:/videos/clip"));
+	CHECK_EQ(LOCAL, Classify(classifier, L"\\\\server\\share\\clip.mkv"));
+	CHECK_EQ(LOCAL, Classify(classifier, L"videos/clip.webm"));
+	CHECK_EQ(LOCAL, Classify(classifier, L"file:///c:/videos/clip.mp4"));
+	CHECK_EQ(LOCAL, Classify(classifier, L"ms-appx:///Assets/clip.mp4"));
+	CHECK_EQ(LOCAL, Classify(classifier, L"MS-APPDATA:///local/clip"));
+}
+
+CORE_TEST(ManifestExtensionsAreAdaptive)
+{
+	CSourceClassifier classifier;
+
+	CHECK_EQ(ADAPTIVE, Classify(classifier, L"https://cdn.example.com/live/master.m3u8"));
+	CHECK_EQ(ADAPTIVE, Classify(classifier, L"https://cdn.example.com/live/master.M3U8?token=abc#t=10"));
+	CHECK_EQ(ADAPTIVE, Classify(classifier, L"http://cdn.example.com/vod/stream.mpd"));
+	CHECK_EQ(ADAPTIVE, Classify(classifier, L"http://cdn.example.com/vod/video.ism/manifest"));
+	CHECK_EQ(ADAPTIVE, Classify(classifier, L"http://cdn.example.com/vod/video.isml/Manifest(format=m3u8-aapl)"));
+
+	// a manifest in the app package is still a manifest
+	CHECK_EQ(ADAPTIVE, Classify(classifier, L"ms-appx:///Assets/stream.m3u8"));
+}
+
+CORE_TEST(RemoteFilesAreProgressive)
+{
+	CSourceClassifier classifier;
+
+	CHECK_EQ(PROGRESSIVE, Classify(classifier, L"https://cdn.example.com/clips/clip.mp4"));
+	CHECK_EQ(PROGRESSIVE, Classify(classifier, L"https://cdn.example.com/clips/clip.MKV?sig=1"));
+	CHECK_EQ(PROGRESSIVE, Classify(classifier, L"http://cdn.example.com/clips/clip.ts"));
+
+	// only http(s) can be adaptive
+	CHECK_EQ(PROGRESSIVE, Classify(classifier, L"rtsp://camera.local/stream"));
+}
+
+CORE_TEST(UnknownHttpUrisAreUnknown)
+{
+	CSourceClassifier classifier;
+
+	CHECK_EQ(UNKNOWN, Classify(classifier, L"https://cdn.example.com/play?id=42"));
+	CHECK_EQ(UNKNOWN, Classify(classifier, L"https://cdn.example.com/videos/42"));
+	CHECK_EQ(UNKNOWN, Classify(classifier, L"https://cdn.example.com/videos/42.php"));
+	CHECK_EQ(UNKNOWN, Classify(classifier, nullptr));
+}
+
+CORE_TEST(RecordedOutcomesApplyToThePattern)
+{
+	CSourceClassifier classifier;
+
+	classifier.RecordOutcome(L"https://cdn.example.com/videos/42?token=a", SourceType::SourceType_Adaptive);
+	classifier.RecordOutcome(L"https://cdn.example.com/files/42.php", SourceType::SourceType_Progressive);
+
+	// same host and directory, extension (or lack of one) alike
+	CHECK_EQ(ADAPTIVE, Classify(classifier, L"https://CDN.example.com/videos/43?token=b"));
+	CHECK_EQ(PROGRESSIVE, Classify(classifier, L"https://cdn.example.com/files/43.php"));
+
+	CHECK_EQ(UNKNOWN, Classify(classifier, L"https://cdn.example.com/videos/sub/43"));
+	CHECK_EQ(UNKNOWN, Classify(classifier, L"https://other.example.com/videos/43"));
+	CHECK_EQ(UNKNOWN, Classify(classifier, L"https://cdn.example.com/files/43.aspx"));
+
+	// a later outcome replaces the earlier one
+	classifier.RecordOutcome(L"https://cdn.example.com/videos/44", SourceType::SourceType_Progressive);
+	CHECK_EQ(PROGRESSIVE, Classify(classifier, L"https://cdn.example.com/videos/45"));
+
+	classifier.Clear();
+	CHECK_EQ(UNKNOWN, Classify(classifier, L"https://cdn.example.com/videos/45"));
+}
+
+CORE_TEST(OnlyHttpOutcomesAreRecorded)
+{
+	CSourceClassifier classifier;
+
+	classifier.RecordOutcome(L"https://cdn.example.com/videos/42", SourceType::SourceType_Unknown);
+	CHECK_EQ(UNKNOWN, Classify(classifier, L"https://cdn.example.com/videos/43"));
+
+	classifier.RecordOutcome(L"ftp://cdn.example.com/videos/42", SourceType::SourceType_Adaptive);
+	classifier.RecordOutcome(nullptr, SourceType::SourceType_Adaptive);
+	CHECK_EQ(UNKNOWN, Classify(classifier, L"https://cdn.example.com/videos/43"));
+
+	CHECK(CSourceClassifier::IsHttpUri(L"HTTPS://cdn.example.com/"));
+	CHECK(!CSourceClassifier::IsHttpUri(L"ftp://cdn.example.com/"));
+	CHECK(!CSourceClassifier::IsHttpUri(L"c:\\http\\clip.mp4"));
+}
+
+CORE_TEST(UriPatterns)
+{
+	CHECK(CSourceClassifier::GetUriPattern(L"HTTPS://user@CDN.Example.com:443/Videos/Clip.MP4?x=1#y") == L"https://cdn.example.com:443/videos/*.mp4");
+	CHECK(CSourceClassifier::GetUriPattern(L"http://cdn.example.com/play?id=42") == L"http://cdn.example.com/*");
+	CHECK(CSourceClassifier::GetUriPattern(L"http://cdn.example.com") == L"http://cdn.example.com/*");
+}
+
+CORE_TEST(OutcomesEvictTheLeastRecentlyUsedPattern)
+{
+	CSourceClassifier classifier(2);
+
+	classifier.RecordOutcome(L"https://a.example.com/v/1", SourceType::SourceType_Adaptive);
+	classifier.RecordOutcome(L"https://b.example.com/v/1", SourceType::SourceType_Adaptive);
+
+	// a lookup keeps a in use, the third pattern evicts b
+	CHECK_EQ(ADAPTIVE, Classify(classifier, L"https://a.example.com/v/2"));
+	classifier.RecordOutcome(L"https://c.example.com/v/1", SourceType::SourceType_Adaptive);
+
+	CHECK_EQ(ADAPTIVE, Classify(classifier, L"https://a.example.com/v/3"));
+	CHECK_EQ(UNKNOWN, Classify(classifier, L"https://b.example.com/v/3"));
+	CHECK_EQ(ADAPTIVE, Classify(classifier, L"https://c.example.com/v/3"));
+}
+
+CORE_TEST(ContentTypes)
+{
+	CHECK_EQ(ADAPTIVE, (UINT32)CSourceClassifier::ClassifyContentType(L"application/vnd.apple.mpegurl"));
+	CHECK_EQ(ADAPTIVE, (UINT32)CSourceClassifier::ClassifyContentType(L"Application/X-MpegURL; charset=UTF-8"));
+	CHECK_EQ(ADAPTIVE, (UINT32)CSourceClassifier::ClassifyContentType(L"audio/mpegurl"));
+	CHECK_EQ(ADAPTIVE, (UINT32)CSourceClassifier::ClassifyContentType(L"application/dash+xml "));
+	CHECK_EQ(ADAPTIVE, (UINT32)CSourceClassifier::ClassifyContentType(L"application/vnd.ms-sstr+xml"));
+
+	CHECK_EQ(PROGRESSIVE, (UINT32)CSourceClassifier::ClassifyContentType(L"video/mp4; codecs=\"avc1.640028\""));
+	CHECK_EQ(PROGRESSIVE, (UINT32)CSourceClassifier::ClassifyContentType(L"audio/mpeg"));
+	CHECK_EQ(PROGRESSIVE, (UINT32)CSourceClassifier::ClassifyContentType(L"application/mp4"));
+
+	CHECK_EQ(UNKNOWN, (UINT32)CSourceClassifier::ClassifyContentType(L"application/octet-stream"));
+	CHECK_EQ(UNKNOWN, (UINT32)CSourceClassifier::ClassifyContentType(L"text/plain"));
+	CHECK_EQ(UNKNOWN, (UINT32)CSourceClassifier::ClassifyContentType(L""));
+	CHECK_EQ(UNKNOWN, (UINT32)CSourceClassifier::ClassifyContentType(nullptr));
+}
+
+CORE_TEST(SniffContainers)
+{
+	static const char c_mp4[] = "\0\0\0\x20" "ftypisom";
+	static const char c_fragment[] = "\0\0\0\x18" "stypmsdh";
+	static const char c_moov[] = "\0\0\x10\0" "moov";
+	static const char c_ebml[] = "\x1A\x45\xDF\xA3\x01\0\0\0";
+	static const char c_asf[] = "\x30\x26\xB2\x75\x8E\x66\xCF\x11";
+
+	CHECK_EQ(PROGRESSIVE, Sniff(c_mp4, sizeof(c_mp4) - 1));
+	CHECK_EQ(PROGRESSIVE, Sniff(c_fragment, sizeof(c_fragment) - 1));
+	CHECK_EQ(PROGRESSIVE, Sniff(c_moov, sizeof(c_moov) - 1));
+	CHECK_EQ(PROGRESSIVE, Sniff(c_ebml, sizeof(c_ebml) - 1));
+	CHECK_EQ(PROGRESSIVE, Sniff(c_asf, sizeof(c_asf) - 1));
+	CHECK_EQ(PROGRESSIVE, Sniff("RIFF\0\0\0\0WAVE", 12));
+	CHECK_EQ(PROGRESSIVE, Sniff("fLaC"));
+	CHECK_EQ(PROGRESSIVE, Sniff("ID3\x04"));
+
+	// transport stream: sync byte at every packet
+	char ts[2 * 188] = {};
+	ts[0] = 0x47;
+	ts[188] = 0x47;
+	CHECK_EQ(PROGRESSIVE, Sniff(ts, sizeof(ts)));
+
+	ts[188] = 0x00;
+	CHECK_EQ(UNKNOWN, Sniff(ts, sizeof(ts)));
+}
+
+CORE_TEST(SniffManifests)
+{
+	CHECK_EQ(ADAPTIVE, Sniff("#EXTM3U\n#EXT-X-VERSION:3\n"));
+	CHECK_EQ(ADAPTIVE, Sniff("\xEF\xBB\xBF#EXTM3U\r\n"));
+	CHECK_EQ(ADAPTIVE, Sniff(" \r\n\t#EXTM3U\n"));
+	CHECK_EQ(ADAPTIVE, Sniff("<?xml version=\"1.0\"?>\n<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\">"));
+	CHECK_EQ(ADAPTIVE, Sniff("\xEF\xBB\xBF\n<SmoothStreamingMedia MajorVersion=\"2\">"));
+
+	CHECK_EQ(UNKNOWN, Sniff("<html><body>not found</body></html>"));
+	CHECK_EQ(UNKNOWN, Sniff("EXTM3U\n"));
+	CHECK_EQ(UNKNOWN, Sniff("#EX"));
+	CHECK_EQ(UNKNOWN, (UINT32)CSourceClassifier::SniffContent(nullptr, 64));
+}
+
+CORE_TEST(ResolveSourceSkipsRequestsForKnownUris)
+{
+	CSourceClassifier classifier;
+	CFakeSourceServer server(SourceType::SourceType_Adaptive, S_OK);
+	UINT32 type = UNKNOWN;
+
+	CHECK_EQ(S_FALSE, server.Resolve(classifier, L"c:\\videos\\clip.mp4", &type));
+	CHECK_EQ(LOCAL, type);
+	CHECK_EQ(S_FALSE, server.Resolve(classifier, L"https://cdn.example.com/clips/clip.mp4", &type));
+	CHECK_EQ(PROGRESSIVE, type);
+	CHECK_EQ(0u, server.probes);
+	CHECK_EQ(0u, server.attempts);
+
+	// the attempt is the open of a manifest
+	CHECK_EQ(S_OK, server.Resolve(classifier, L"https://cdn.example.com/live/master.m3u8", &type));
+	CHECK_EQ(ADAPTIVE, type);
+	CHECK_EQ(0u, server.probes);
+	CHECK_EQ(1u, server.attempts);
+}
+
+CORE_TEST(ResolveSourceProbesUnknownUrisOnce)
+{
+	CSourceClassifier classifier;
+	CFakeSourceServer manifests(SourceType::SourceType_Adaptive, S_OK);
+	UINT32 type = UNKNOWN;
+
+	CHECK_EQ(S_OK, manifests.Resolve(classifier, L"https://cdn.example.com/play?id=1", &type));
+	CHECK_EQ(ADAPTIVE, type);
+	CHECK_EQ(S_OK, manifests.Resolve(classifier, L"https://cdn.example.com/play?id=2", &type));
+	CHECK_EQ(1u, manifests.probes);
+	CHECK_EQ(2u, manifests.attempts);
+
+	// a progressive probe saves the attempt as well
+	CFakeSourceServer files(SourceType::SourceType_Progressive, S_FALSE, true);
+	CHECK_EQ(S_FALSE, files.Resolve(classifier, L"https://files.example.com/get?id=1", &type));
+	CHECK_EQ(PROGRESSIVE, type);
+	CHECK_EQ(S_FALSE, files.Resolve(classifier, L"https://files.example.com/get?id=2", &type));
+	CHECK_EQ(1u, files.probes);
+	CHECK_EQ(0u, files.attempts);
+}
+
+CORE_TEST(ResolveSourceLearnsFromTheAdaptiveAttempt)
+{
+	CSourceClassifier classifier;
+	UINT32 type = UNKNOWN;
+
+	// the probe can't tell, the content is no manifest
+	CFakeSourceServer files(SourceType::SourceType_Unknown, S_FALSE, true);
+	CHECK_EQ(S_FALSE, files.Resolve(classifier, L"https://files.example.com/get?id=1", &type));
+	CHECK_EQ(UNKNOWN, type);
+	CHECK_EQ(S_FALSE, files.Resolve(classifier, L"https://files.example.com/get?id=2", &type));
+	CHECK_EQ(PROGRESSIVE, type);
+	CHECK_EQ(1u, files.probes);
+	CHECK_EQ(1u, files.attempts);
+
+	// neither a failed probe nor an unreachable server is recorded
+	CFakeSourceServer offline(SourceType::SourceType_Adaptive, S_FALSE);
+	offline.FailProbe(E_FAIL);
+	CHECK_EQ(S_FALSE, offline.Resolve(classifier, L"https://offline.example.com/play?id=1", &type));
+	CHECK_EQ(S_FALSE, offline.Resolve(classifier, L"https://offline.example.com/play?id=2", &type));
+	CHECK_EQ(2u, offline.probes);
+	CHECK_EQ(2u, offline.attempts);
+	CHECK_EQ(UNKNOWN, Classify(classifier, L"https://offline.example.com/play?id=3"));
+}
+
+CORE_TEST(ResolveSourceStopsWhenCancelled)
+{
+	CSourceClassifier classifier;
+	UINT32 type = UNKNOWN;
+
+	CFakeSourceServer probing(SourceType::SourceType_Adaptive, S_OK);
+	probing.FailProbe(HRESULT_FROM_WIN32(ERROR_CANCELLED));
+	CHECK_EQ(HRESULT_FROM_WIN32(ERROR_CANCELLED), probing.Resolve(classifier, L"https://cdn.example.com/play?id=1", &type));
+	CHECK_EQ(0u, probing.attempts);
+
+	CFakeSourceServer opening(SourceType::SourceType_Adaptive, HRESULT_FROM_WIN32(ERROR_CANCELLED));
+	CHECK_EQ(HRESULT_FROM_WIN32(ERROR_CANCELLED), opening.Resolve(classifier, L"https://cdn.example.com/live/master.m3u8", &type));
+	CHECK_EQ(1u, opening.attempts);
+}
+
+CORE_TEST(LruCacheEvictsTheLeastRecentlyUsedEntry)
+{
+	CLruCache<int, int> cache(3);
+	int value = 0;
+
+	cache.Put(1, 10);
+	cache.Put(2, 20);
+	cache.Put(3, 30);
+	CHECK_EQ((size_t)3, cache.GetCount());
+
+	// 1 is used, 2 is now the oldest
+	CHECK(cache.Get(1, &value));
+	cache.Put(4, 40);
+
+	CHECK(!cache.Get(2, &value));
+	CHECK(cache.Get(3, &value));
+	CHECK(cache.Get(4, &value));
+	CHECK(cache.Get(1, &value));
+	CHECK_EQ(10, value);
+
+	// updating an entry uses it as well
+	cache.Put(3, 31);
+	cache.Put(5, 50);
+	CHECK(!cache.Get(4, &value));
+	CHECK(cache.Get(3, &value));
+	CHECK_EQ(31, value);
+	CHECK_EQ((size_t)3, cache.GetCount());
+}
+
+CORE_TEST(LruCacheRemoveAndClear)
+{
+	CLruCache<int, int> cache(0);
+	int value = 0;
+
+	CHECK_EQ((size_t)1, cache.GetCapacity());
+
+	cache.Put(1, 10);
+	cache.Put(2, 20);
+	CHECK(!cache.Get(1, &value));
+	CHECK(cache.Remove(2));
+	CHECK(!cache.Remove(2));
+	CHECK_EQ((size_t)0, cache.GetCount());
+
+	cache.Put(3, 30);
+	cache.Clear();
+	CHECK(!cache.Get(3, &value));
+	CHECK_EQ((size_t)0, cache.GetCount());
+}
@@ -0,0 +1,282 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreTest.h"
+#include "StateEventQueue.h"
+
+#include <string.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#define TEST_PRODUCERS 4
+
+
+static PLAYBACK_STATE MakeState(_In_ StateType type, _In_ PlaybackState state = PlaybackState::PlaybackState_None, _In_ UINT32 requestId = 0)
+{
+	PLAYBACK_STATE playbackState;
+	memset(&playbackState, 0, sizeof(playbackState));
+	playbackState.type = type;
+	playbackState.state = state;
+	playbackState.requestId = requestId;
+
+	return playbackState;
+}
+
+
+CORE_TEST(EventQueuePushPopInOrder)
+{
+	CEventQueue<UINT32, 4> queue;
+	UINT32 value = 0;
+
+	CHECK(!queue.Pop(&value));
+
+	for (UINT32 i = 1; i <= 4; i++)
+		CHECK(queue.Push(i));
+	CHECK(!queue.Push(5));
+	CHECK_EQ((UINT32)4, queue.GetDepth());
+
+	for (UINT32 i = 1; i <= 4; i++)
+	{
+		REQUIRE(queue.Pop(&value));
+		CHECK_EQ(i, value);
+	}
+
+	CHECK(!queue.Pop(&value));
+	CHECK_EQ((UINT32)0, queue.GetDepth());
+
+	// the cells are reusable after wrapping around
+	for (UINT32 round = 0; round < 10; round++)
+	{
+		CHECK(queue.Push(round));
+		REQUIRE(queue.Pop(&value));
+		CHECK_EQ(round, value);
+	}
+}
+
+// Producers on several threads, one consumer: nothing lost or duplicated, each producer's records in its order
+CORE_TEST(EventQueueMultipleProducers)
+{
+	CEventQueue<UINT32, 256> queue;
+	const UINT32 perProducer = 200000;
+	std::atomic<UINT32> running(TEST_PRODUCERS);
+
+	std::vector<std::thread> producers;
+	for (UINT32 producer = 0; producer < TEST_PRODUCERS; producer++)
+	{
+		producers.emplace_back([&, producer]()
+		{
+			for (UINT32 i = 0; i < perProducer; i++)
+			{
+				while (!queue.Push((producer << 24) | i))
+					std::this_thread::yield();
+			}
+			running--;
+		});
+	}
+
+	UINT32 next[TEST_PRODUCERS] = {};
+	UINT32 outOfOrder = 0;
+	UINT32 received = 0;
+	UINT32 value = 0;
+
+	while (running > 0 || queue.GetDepth() > 0)
+	{
+		if (!queue.Pop(&value))
+			continue;
+
+		UINT32 producer = value >> 24;
+		if (producer >= TEST_PRODUCERS || (value & 0xFFFFFF) != next[producer])
+			outOfOrder++;
+		else
+			next[producer]++;
+		received++;
+	}
+
+	for (auto& thread : producers)
+		thread.join();
+
+	CHECK_EQ((UINT32)0, outOfOrder);
+	CHECK_EQ(TEST_PRODUCERS * perProducer, received);
+	for (UINT32 producer = 0; producer < TEST_PRODUCERS; producer++)
+		CHECK_EQ(perProducer, next[producer]);
+}
+
+CORE_TEST(DrainDeliversInPushOrder)
+{
+	CStateEventQueue events;
+
+	events.Push(MakeState(StateType::StateType_Opened));
+	events.Push(MakeState(StateType::StateType_StateChanged, PlaybackState::PlaybackState_Playing));
+	events.Push(MakeState(StateType::StateType_NewFrameTexture));
+	events.Push(MakeState(StateType::StateType_LoadCompleted, PlaybackState::PlaybackState_None, 7));
+
+	PLAYBACK_STATE drained[8];
+	UINT32 count = 0;
+	CHECK_EQ(S_OK, events.Drain(drained, 8, &count));
+	REQUIRE(count == 4);
+	CHECK(drained[0].type == StateType::StateType_Opened);
+	CHECK(drained[1].type == StateType::StateType_StateChanged);
+	CHECK(drained[2].type == StateType::StateType_NewFrameTexture);
+	CHECK(drained[3].type == StateType::StateType_LoadCompleted);
+	CHECK_EQ((UINT32)7, drained[3].requestId);
+
+	CHECK_EQ(S_OK, events.Drain(drained, 8, &count));
+	CHECK_EQ((UINT32)0, count);
+}
+
+CORE_TEST(ConsecutiveStateChangesCoalesce)
+{
+	CStateEventQueue events;
+
+	events.Push(MakeState(StateType::StateType_StateChanged, PlaybackState::PlaybackState_Opening));
+	events.Push(MakeState(StateType::StateType_StateChanged, PlaybackState::PlaybackState_Buffering));
+	events.Push(MakeState(StateType::StateType_StateChanged, PlaybackState::PlaybackState_Playing));
+	events.Push(MakeState(StateType::StateType_Opened));
+	events.Push(MakeState(StateType::StateType_StateChanged, PlaybackState::PlaybackState_Paused));
+
+	PLAYBACK_STATE drained[8];
+	UINT32 count = 0;
+	CHECK_HR(events.Drain(drained, 8, &count));
+	REQUIRE(count == 3);
+
+	// only the latest of a run survives, a different record in between ends the run
+	CHECK(drained[0].state == PlaybackState::PlaybackState_Playing);
+	CHECK(drained[1].type == StateType::StateType_Opened);
+	CHECK(drained[2].state == PlaybackState::PlaybackState_Paused);
+
+	EVENT_QUEUE_STATS stats;
+	events.GetStats(&stats);
+	CHECK_EQ((UINT64)5, stats.queuedEvents);
+	CHECK_EQ((UINT64)3, stats.deliveredEvents);
+	CHECK_EQ((UINT64)2, stats.coalescedEvents);
+	CHECK_EQ((UINT64)0, stats.droppedEvents);
+}
+
+CORE_TEST(SmallBufferDrainsInBatches)
+{
+	CStateEventQueue events;
+
+	for (UINT32 i = 0; i < 5; i++)
+		events.Push(MakeState(StateType::StateType_PlaylistItemChanged, PlaybackState::PlaybackState_None, i));
+
+	PLAYBACK_STATE drained[2];
+	UINT32 count = 0;
+	UINT32 expected = 0;
+
+	CHECK_EQ(S_FALSE, events.Drain(drained, 2, &count));
+	CHECK_EQ((UINT32)2, count);
+	for (UINT32 i = 0; i < count; i++)
+		CHECK_EQ(expected++, drained[i].requestId);
+
+	// the record held back when the buffer filled up comes first next time
+	CHECK_EQ(S_FALSE, events.Drain(drained, 2, &count));
+	CHECK_EQ((UINT32)2, count);
+	for (UINT32 i = 0; i < count; i++)
+		CHECK_EQ(expected++, drained[i].requestId);
+
+	CHECK_EQ(S_OK, events.Drain(drained, 2, &count));
+	CHECK_EQ((UINT32)1, count);
+	CHECK_EQ(expected, drained[0].requestId);
+
+	// a zero sized drain only tells whether something is waiting
+	events.Push(MakeState(StateType::StateType_Opened));
+	CHECK_EQ(S_FALSE, events.Drain(nullptr, 0, &count));
+	CHECK_EQ((UINT32)0, count);
+	CHECK_EQ(S_OK, events.Drain(drained, 2, &count));
+	CHECK_EQ((UINT32)1, count);
+
+	CHECK_EQ(E_INVALIDARG, events.Drain(drained, 2, nullptr));
+}
+
+CORE_TEST(FullQueueCountsDroppedEvents)
+{
+	CStateEventQueue events;
+
+	for (UINT32 i = 0; i < _StateEventQueueCapacity_; i++)
+		CHECK(events.Push(MakeState(StateType::StateType_NewFrameTexture)));
+	CHECK(!events.Push(MakeState(StateType::StateType_NewFrameTexture)));
+	CHECK(!events.Push(MakeState(StateType::StateType_NewFrameTexture)));
+
+	EVENT_QUEUE_STATS stats;
+	events.GetStats(&stats);
+	CHECK_EQ((UINT32)_StateEventQueueCapacity_, stats.capacity);
+	CHECK_EQ((UINT32)_StateEventQueueCapacity_, stats.depth);
+	CHECK_EQ((UINT64)2, stats.droppedEvents);
+
+	// draining makes room again
+	PLAYBACK_STATE drained[_StateEventQueueCapacity_];
+	UINT32 count = 0;
+	CHECK_EQ(S_OK, events.Drain(drained, _StateEventQueueCapacity_, &count));
+	CHECK_EQ((UINT32)_StateEventQueueCapacity_, count);
+	CHECK(events.Push(MakeState(StateType::StateType_NewFrameTexture)));
+}
+
+// Pipeline threads pushing while the game loop drains: every record is delivered, coalesced or dropped, and the
+// records of each thread arrive in order
+CORE_TEST(ConcurrentPushAndDrain)
+{
+	CStateEventQueue events;
+	const UINT32 perProducer = 50000;
+	std::atomic<UINT32> running(TEST_PRODUCERS);
+
+	std::vector<std::thread> producers;
+	for (UINT32 producer = 0; producer < TEST_PRODUCERS; producer++)
+	{
+		producers.emplace_back([&, producer]()
+		{
+			for (UINT32 i = 0; i < perProducer; i++)
+				events.Push(MakeState(StateType::StateType_NewFrameTexture, PlaybackState::PlaybackState_None, (producer << 24) | (i + 1)));
+			running--;
+		});
+	}
+
+	UINT32 last[TEST_PRODUCERS] = {};
+	UINT32 outOfOrder = 0;
+	UINT64 received = 0;
+	PLAYBACK_STATE drained[16];
+
+	for (;;)
+	{
+		bool done = running == 0;
+
+		UINT32 count = 0;
+		while (events.Drain(drained, 16, &count) == S_FALSE || count > 0)
+		{
+			for (UINT32 i = 0; i < count; i++)
+			{
+				UINT32 producer = drained[i].requestId >> 24;
+				UINT32 sequence = drained[i].requestId & 0xFFFFFF;
+				if (producer >= TEST_PRODUCERS || sequence <= last[producer])
+					outOfOrder++;
+				else
+					last[producer] = sequence;
+			}
+			received += count;
+		}
+
+		if (done)
+			break;
+	}
+
+	for (auto& thread : producers)
+		thread.join();
+
+	EVENT_QUEUE_STATS stats;
+	events.GetStats(&stats);
+
+	CHECK_EQ((UINT32)0, outOfOrder);
+	CHECK_EQ((UINT64)TEST_PRODUCERS * perProducer, stats.queuedEvents + stats.droppedEvents);
+	CHECK_EQ(stats.queuedEvents, stats.deliveredEvents + stats.coalescedEvents);
+	CHECK_EQ(received, stats.deliveredEvents);
+	CHECK_EQ((UINT32)0, stats.depth);
+}
@@ -0,0 +1,170 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreTest.h"
+#include "SoftwarePlayer.h"
+#include "StatusBlock.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+
+// Every field derived from one value, a copy mixing two updates shows different values
+static void WriteStatus(_Inout_ PLAYBACK_STATUS& status, _In_ INT64 value)
+{
+	status.state = (PlaybackState)(value & 3);
+	status.position = value;
+	status.duration = value * 2;
+	status.bitrate = (UINT32)value;
+	status.bufferedRangeCount = (UINT32)(value % _MaxBufferedRanges_);
+	for (UINT32 i = 0; i < _MaxBufferedRanges_; i++)
+	{
+		status.bufferedRanges[i].start = value + i;
+		status.bufferedRanges[i].end = value - i;
+	}
+	status.frameCounter = (UINT64)value;
+	status.droppedFrames = (UINT64)value * 3;
+}
+
+static bool IsConsistent(_In_ const PLAYBACK_STATUS& status)
+{
+	INT64 value = status.position;
+
+	bool consistent = status.state == (PlaybackState)(value & 3) && status.duration == value * 2 && status.bitrate == (UINT32)value &&
+		status.bufferedRangeCount == (UINT32)(value % _MaxBufferedRanges_) && status.frameCounter == (UINT64)value &&
+		status.droppedFrames == (UINT64)value * 3;
+
+	for (UINT32 i = 0; i < _MaxBufferedRanges_; i++)
+		consistent = consistent && status.bufferedRanges[i].start == value + i && status.bufferedRanges[i].end == value - i;
+
+	return consistent && (status.sequence & 1) == 0;
+}
+
+
+CORE_TEST(UpdateMakesTheSequenceEven)
+{
+	CStatusBlock block;
+	const PLAYBACK_STATUS* pShared = block.GetShared();
+
+	CHECK_EQ((UINT32)0, pShared->sequence);
+
+	block.Update([](PLAYBACK_STATUS& status) { status.position = 42; });
+	CHECK_EQ((UINT32)2, pShared->sequence);
+	CHECK_EQ((INT64)42, pShared->position);
+
+	// the callback runs while the sequence is odd
+	UINT32 sequenceDuringUpdate = 0;
+	block.Update([&](PLAYBACK_STATUS& status) { sequenceDuringUpdate = status.sequence; });
+	CHECK_EQ((UINT32)3, sequenceDuringUpdate);
+	CHECK_EQ((UINT32)4, pShared->sequence);
+}
+
+CORE_TEST(ResetKeepsTheFrameCounters)
+{
+	CStatusBlock block;
+	block.Update([](PLAYBACK_STATUS& status) { WriteStatus(status, 5); });
+
+	block.Reset();
+
+	PLAYBACK_STATUS status;
+	block.Read(&status);
+	CHECK(status.state == PlaybackState::PlaybackState_None);
+	CHECK_EQ((INT64)0, status.position);
+	CHECK_EQ((INT64)0, status.duration);
+	CHECK_EQ((UINT32)0, status.bitrate);
+	CHECK_EQ((UINT32)0, status.bufferedRangeCount);
+	CHECK_EQ((UINT64)5, status.frameCounter);
+	CHECK_EQ((UINT64)15, status.droppedFrames);
+}
+
+// Readers copying the block while writers update it never get a copy mixing two updates
+CORE_TEST(ReadersNeverSeeTornUpdates)
+{
+	CStatusBlock block;
+	block.Update([](PLAYBACK_STATUS& status) { WriteStatus(status, 0); });
+
+	std::atomic<bool> stop(false);
+	std::atomic<INT64> nextValue(1);
+
+	std::vector<std::thread> writers;
+	for (int i = 0; i < 2; i++)
+	{
+		writers.emplace_back([&]()
+		{
+			while (!stop)
+			{
+				INT64 value = nextValue++;
+				block.Update([value](PLAYBACK_STATUS& status) { WriteStatus(status, value); });
+			}
+		});
+	}
+
+	UINT32 torn = 0;
+	UINT32 changes = 0;
+	INT64 lastValue = 0;
+
+	// on a loaded machine the writers may not get to run for a while, read until they have updated a few times
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	for (int i = 0; i < 200000 || (changes < 100 && std::chrono::steady_clock::now() < deadline); i++)
+	{
+		PLAYBACK_STATUS status;
+		block.Read(&status);
+
+		if (!IsConsistent(status))
+			torn++;
+		if (status.position != lastValue)
+			changes++;
+		lastValue = status.position;
+	}
+
+	stop = true;
+	for (auto& writer : writers)
+		writer.join();
+
+	CHECK_EQ((UINT32)0, torn);
+	CHECK(changes > 0);
+}
+
+// The block a player hands out follows its playback without further calls
+CORE_TEST(PlayerPublishesItsStatus)
+{
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"clip.mp4", MakeSoftwareMedia(256, 144, SOFTWARE_TICKS_PER_SECOND));
+	REQUIRE_HR(player.Initialize());
+
+	const PLAYBACK_STATUS* pStatus = nullptr;
+	REQUIRE_HR(player.GetCore().GetPlaybackStatus(&pStatus));
+	REQUIRE(pStatus != nullptr);
+	CHECK(pStatus->state == PlaybackState::PlaybackState_None);
+
+	REQUIRE_HR(player.GetCore().LoadContent(L"clip.mp4"));
+	REQUIRE_HR(player.GetCore().Play());
+	player.Run(SOFTWARE_TICKS_PER_SECOND / 2);
+
+	PLAYBACK_STATUS status;
+	memcpy(&status, pStatus, sizeof(status));
+	CHECK(status.state == PlaybackState::PlaybackState_Playing);
+	CHECK_EQ((INT64)SOFTWARE_TICKS_PER_SECOND, status.duration);
+	// the time of the latest frame, the session clock may be a little ahead of it
+	CHECK(status.position <= player.GetPosition() && status.position > player.GetPosition() - TEST_FRAME_DURATION);
+	CHECK(status.frameCounter > 0);
+
+	// the same pointer after the content is gone
+	UINT64 frames = status.frameCounter;
+	player.GetCore().Stop();
+
+	const PLAYBACK_STATUS* pAfterStop = nullptr;
+	REQUIRE_HR(player.GetCore().GetPlaybackStatus(&pAfterStop));
+	CHECK(pAfterStop == pStatus);
+	CHECK(pStatus->state == PlaybackState::PlaybackState_None);
+	CHECK_EQ(frames, pStatus->frameCounter);
+}
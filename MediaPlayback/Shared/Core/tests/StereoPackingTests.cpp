@@ -0,0 +1,175 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreTest.h"
+#include "StereoPacking.h"
+
+#include <string.h>
+
+#include <vector>
+
+#define TEST_PADDING 0xCD
+
+
+// 32bpp pixel telling where it came from
+static UINT32 SourcePixel(_In_ UINT32 x, _In_ UINT32 y)
+{
+	return (y << 16) | x;
+}
+
+static std::vector<BYTE> MakeSource(_In_ UINT32 width, _In_ UINT32 height, _In_ UINT32 pitch)
+{
+	std::vector<BYTE> source((size_t)pitch * height, TEST_PADDING);
+	for (UINT32 y = 0; y < height; y++)
+	{
+		for (UINT32 x = 0; x < width; x++)
+		{
+			UINT32 pixel = SourcePixel(x, y);
+			memcpy(&source[(size_t)pitch * y + x * 4], &pixel, 4);
+		}
+	}
+
+	return source;
+}
+
+static UINT32 PixelAt(_In_ const std::vector<BYTE>& frame, _In_ UINT32 pitch, _In_ UINT32 x, _In_ UINT32 y)
+{
+	UINT32 pixel = 0;
+	memcpy(&pixel, &frame[(size_t)pitch * y + x * 4], 4);
+	return pixel;
+}
+
+
+// Every length around the vector width and source/destination misalignment copies exactly the row
+CORE_TEST(CopyPixelRowMatchesMemcpy)
+{
+	std::vector<BYTE> source(4 * 80 + 16);
+	for (size_t i = 0; i < source.size(); i++)
+		source[i] = (BYTE)(i * 7 + 3);
+
+	UINT32 mismatches = 0;
+	for (UINT32 pixels = 0; pixels <= 70; pixels++)
+	{
+		for (UINT32 misalignment = 0; misalignment < 16; misalignment += 4)
+		{
+			std::vector<BYTE> destination(source.size(), TEST_PADDING);
+			CopyPixelRow(&source[misalignment], &destination[16 - misalignment], pixels);
+
+			for (size_t i = 0; i < destination.size(); i++)
+			{
+				size_t rowOffset = i - (16 - misalignment);
+				bool inRow = i >= 16 - misalignment && rowOffset < (size_t)pixels * 4;
+				BYTE expected = inRow ? source[misalignment + rowOffset] : (BYTE)TEST_PADDING;
+				if (destination[i] != expected)
+					mismatches++;
+			}
+		}
+	}
+
+	CHECK_EQ((UINT32)0, mismatches);
+}
+
+CORE_TEST(SideBySideBecomesOverUnder)
+{
+	const UINT32 width = 70;
+	const UINT32 height = 9;
+	const UINT32 sourcePitch = width * 4 + 24;
+	const UINT32 eyeWidth = width / 2;
+	const UINT32 destinationPitch = eyeWidth * 4 + 8;
+
+	std::vector<BYTE> source = MakeSource(width, height, sourcePitch);
+	std::vector<BYTE> destination((size_t)destinationPitch * height * 2, TEST_PADDING);
+
+	REQUIRE_HR(PackStereoOverUnder(source.data(), sourcePitch, width, height, StereoPacking::StereoPacking_SideBySide, destination.data(), destinationPitch));
+
+	UINT32 wrong = 0;
+	for (UINT32 y = 0; y < height; y++)
+	{
+		for (UINT32 x = 0; x < eyeWidth; x++)
+		{
+			if (PixelAt(destination, destinationPitch, x, y) != SourcePixel(x, y))
+				wrong++;
+			if (PixelAt(destination, destinationPitch, x, height + y) != SourcePixel(eyeWidth + x, y))
+				wrong++;
+		}
+
+		// the row padding of the destination is left alone
+		for (UINT32 i = eyeWidth * 4; i < destinationPitch; i++)
+		{
+			if (destination[(size_t)destinationPitch * y + i] != TEST_PADDING || destination[(size_t)destinationPitch * (height + y) + i] != TEST_PADDING)
+				wrong++;
+		}
+	}
+
+	CHECK_EQ((UINT32)0, wrong);
+}
+
+// An odd width leaves the middle column out, both eyes get width / 2 pixels
+CORE_TEST(SideBySideOddWidth)
+{
+	const UINT32 width = 5;
+	const UINT32 height = 2;
+
+	std::vector<BYTE> source = MakeSource(width, height, width * 4);
+	std::vector<BYTE> destination((size_t)2 * 4 * height * 2, TEST_PADDING);
+
+	REQUIRE_HR(PackStereoOverUnder(source.data(), width * 4, width, height, StereoPacking::StereoPacking_SideBySide, destination.data(), 2 * 4));
+
+	CHECK_EQ(SourcePixel(0, 0), PixelAt(destination, 8, 0, 0));
+	CHECK_EQ(SourcePixel(1, 1), PixelAt(destination, 8, 1, 1));
+	CHECK_EQ(SourcePixel(2, 0), PixelAt(destination, 8, 0, 2));
+	CHECK_EQ(SourcePixel(3, 1), PixelAt(destination, 8, 1, 3));
+}
+
+CORE_TEST(TopBottomIsCopied)
+{
+	const UINT32 width = 33;
+	const UINT32 height = 8;
+	const UINT32 sourcePitch = width * 4 + 12;
+	const UINT32 destinationPitch = width * 4;
+
+	std::vector<BYTE> source = MakeSource(width, height, sourcePitch);
+	std::vector<BYTE> destination((size_t)destinationPitch * height, TEST_PADDING);
+
+	REQUIRE_HR(PackStereoOverUnder(source.data(), sourcePitch, width, height, StereoPacking::StereoPacking_TopBottom, destination.data(), destinationPitch));
+
+	UINT32 wrong = 0;
+	for (UINT32 y = 0; y < height; y++)
+	{
+		for (UINT32 x = 0; x < width; x++)
+		{
+			if (PixelAt(destination, destinationPitch, x, y) != SourcePixel(x, y))
+				wrong++;
+		}
+	}
+
+	CHECK_EQ((UINT32)0, wrong);
+}
+
+CORE_TEST(InvalidPackingArguments)
+{
+	std::vector<BYTE> source(64 * 4 * 4);
+	std::vector<BYTE> destination(64 * 4 * 4);
+
+	CHECK_EQ(E_INVALIDARG, PackStereoOverUnder(nullptr, 64 * 4, 64, 4, StereoPacking::StereoPacking_TopBottom, destination.data(), 64 * 4));
+	CHECK_EQ(E_INVALIDARG, PackStereoOverUnder(source.data(), 64 * 4, 64, 4, StereoPacking::StereoPacking_TopBottom, nullptr, 64 * 4));
+	CHECK_EQ(E_INVALIDARG, PackStereoOverUnder(source.data(), 64 * 4, 0, 4, StereoPacking::StereoPacking_TopBottom, destination.data(), 64 * 4));
+	CHECK_EQ(E_INVALIDARG, PackStereoOverUnder(source.data(), 64 * 4, 64, 0, StereoPacking::StereoPacking_TopBottom, destination.data(), 64 * 4));
+	CHECK_EQ(E_INVALIDARG, PackStereoOverUnder(source.data(), 64 * 4, 64, 4, StereoPacking::StereoPacking_None, destination.data(), 64 * 4));
+
+	// pitches too small for the rows
+	CHECK_EQ(E_INVALIDARG, PackStereoOverUnder(source.data(), 63 * 4, 64, 4, StereoPacking::StereoPacking_TopBottom, destination.data(), 64 * 4));
+	CHECK_EQ(E_INVALIDARG, PackStereoOverUnder(source.data(), 64 * 4, 64, 4, StereoPacking::StereoPacking_TopBottom, destination.data(), 63 * 4));
+	CHECK_EQ(E_INVALIDARG, PackStereoOverUnder(source.data(), 64 * 4, 64, 4, StereoPacking::StereoPacking_SideBySide, destination.data(), 31 * 4));
+
+	// a single column has no eyes to split
+	CHECK_EQ(E_INVALIDARG, PackStereoOverUnder(source.data(), 4, 1, 4, StereoPacking::StereoPacking_SideBySide, destination.data(), 4));
+}
@@ -0,0 +1,265 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CoreTest.h"
+#include "SoftwarePlayer.h"
+#include "SurfacePool.h"
+
+#include <memory>
+
+
+// Surface that tells which allocation it came from; the pool holds shared_ptrs like the core does
+typedef std::shared_ptr<UINT32> TestSurface;
+
+class CTestAllocator
+{
+public:
+	CTestAllocator() : m_created(0) {}
+
+	HRESULT operator()(_In_ const SURFACE_POOL_KEY&, _Out_ TestSurface* pSurface)
+	{
+		*pSurface = std::make_shared<UINT32>(++m_created);
+		return S_OK;
+	}
+
+	UINT32 GetCreated() const { return m_created; }
+
+private:
+	UINT32 m_created;
+};
+
+static SURFACE_POOL_KEY MakeKey(_In_ UINT32 width, _In_ UINT32 height, _In_ UINT32 format = 0, _In_ bool isStereoscopic = false)
+{
+	SURFACE_POOL_KEY key = { width, height, format, isStereoscopic };
+	return key;
+}
+
+static UINT64 SizeOf(_In_ const SURFACE_POOL_KEY& key)
+{
+	return (UINT64)key.width * key.height * 4;
+}
+
+
+CORE_TEST(RecycledSurfaceIsReused)
+{
+	CSurfacePool<TestSurface> pool;
+	CTestAllocator allocator;
+	SURFACE_POOL_KEY key = MakeKey(1920, 1080);
+
+	TestSurface surface;
+	REQUIRE_HR(pool.Acquire(key, std::ref(allocator), &surface));
+	REQUIRE(surface != nullptr);
+	UINT32 first = *surface;
+
+	pool.Recycle(key, std::move(surface), SizeOf(key));
+
+	TestSurface again;
+	REQUIRE_HR(pool.Acquire(key, std::ref(allocator), &again));
+	REQUIRE(again != nullptr);
+	CHECK_EQ(first, *again);
+	CHECK_EQ((UINT32)1, allocator.GetCreated());
+
+	SURFACE_POOL_STATS stats;
+	pool.GetStats(&stats);
+	CHECK_EQ((UINT64)1, stats.hits);
+	CHECK_EQ((UINT64)1, stats.misses);
+	CHECK_EQ((UINT32)0, stats.pooledSurfaces);
+	CHECK_EQ((UINT64)0, stats.pooledBytes);
+}
+
+CORE_TEST(KeysMatchExactly)
+{
+	CSurfacePool<TestSurface> pool;
+	CTestAllocator allocator;
+
+	const SURFACE_POOL_KEY keys[] = { MakeKey(1280, 720), MakeKey(1280, 720, 1), MakeKey(1280, 720, 0, true), MakeKey(1280, 721), MakeKey(1281, 720) };
+	const size_t keyCount = sizeof(keys) / sizeof(keys[0]);
+
+	for (size_t i = 0; i < keyCount; i++)
+	{
+		TestSurface surface;
+		REQUIRE_HR(pool.Acquire(keys[i], std::ref(allocator), &surface));
+		pool.Recycle(keys[i], std::move(surface), SizeOf(keys[i]));
+	}
+	CHECK_EQ((UINT32)keyCount, allocator.GetCreated());
+
+	// each key gets its own surface back
+	for (size_t i = 0; i < keyCount; i++)
+	{
+		TestSurface surface;
+		REQUIRE_HR(pool.Acquire(keys[i], std::ref(allocator), &surface));
+		CHECK_EQ((UINT32)(i + 1), *surface);
+	}
+	CHECK_EQ((UINT32)keyCount, allocator.GetCreated());
+}
+
+CORE_TEST(BudgetEvictsTheLeastRecentlyRecycled)
+{
+	SURFACE_POOL_KEY small = MakeKey(640, 360);
+	SURFACE_POOL_KEY medium = MakeKey(1280, 720);
+	SURFACE_POOL_KEY large = MakeKey(1920, 1080);
+
+	// room for medium and large, not for small on top
+	CSurfacePool<TestSurface> pool(SizeOf(medium) + SizeOf(large));
+	CTestAllocator allocator;
+
+	TestSurface surfaces[3];
+	REQUIRE_HR(pool.Acquire(small, std::ref(allocator), &surfaces[0]));
+	REQUIRE_HR(pool.Acquire(medium, std::ref(allocator), &surfaces[1]));
+	REQUIRE_HR(pool.Acquire(large, std::ref(allocator), &surfaces[2]));
+
+	std::weak_ptr<UINT32> smallSurface = surfaces[0];
+
+	pool.Recycle(small, std::move(surfaces[0]), SizeOf(small));
+	pool.Recycle(medium, std::move(surfaces[1]), SizeOf(medium));
+	pool.Recycle(large, std::move(surfaces[2]), SizeOf(large));
+
+	// small was recycled first, it goes and is destroyed
+	SURFACE_POOL_STATS stats;
+	pool.GetStats(&stats);
+	CHECK_EQ((UINT32)2, stats.pooledSurfaces);
+	CHECK_EQ(SizeOf(medium) + SizeOf(large), stats.pooledBytes);
+	CHECK_EQ((UINT64)1, stats.evictions);
+	CHECK(smallSurface.expired());
+
+	TestSurface surface;
+	REQUIRE_HR(pool.Acquire(medium, std::ref(allocator), &surface));
+	CHECK_EQ((UINT32)2, *surface);
+	REQUIRE_HR(pool.Acquire(small, std::ref(allocator), &surface));
+	CHECK_EQ((UINT32)4, *surface);
+}
+
+CORE_TEST(SurfaceOverTheBudgetIsNotKept)
+{
+	SURFACE_POOL_KEY key = MakeKey(3840, 2160);
+	CSurfacePool<TestSurface> pool(SizeOf(key) - 1);
+	CTestAllocator allocator;
+
+	TestSurface surface;
+	REQUIRE_HR(pool.Acquire(key, std::ref(allocator), &surface));
+	pool.Recycle(key, std::move(surface), SizeOf(key));
+
+	SURFACE_POOL_STATS stats;
+	pool.GetStats(&stats);
+	CHECK_EQ((UINT32)0, stats.pooledSurfaces);
+	CHECK_EQ((UINT64)0, stats.pooledBytes);
+	CHECK_EQ((UINT64)1, stats.evictions);
+}
+
+CORE_TEST(LoweringTheBudgetTrims)
+{
+	CSurfacePool<TestSurface> pool;
+	CTestAllocator allocator;
+
+	for (UINT32 i = 1; i <= 4; i++)
+	{
+		SURFACE_POOL_KEY key = MakeKey(256 * i, 144 * i);
+		TestSurface surface;
+		REQUIRE_HR(pool.Acquire(key, std::ref(allocator), &surface));
+		pool.Recycle(key, std::move(surface), 100);
+	}
+
+	pool.SetBudget(250);
+
+	SURFACE_POOL_STATS stats;
+	pool.GetStats(&stats);
+	CHECK_EQ((UINT32)2, stats.pooledSurfaces);
+	CHECK_EQ((UINT64)200, stats.pooledBytes);
+	CHECK_EQ((UINT64)250, stats.budgetBytes);
+
+	// the two recycled last are left
+	TestSurface surface;
+	REQUIRE_HR(pool.Acquire(MakeKey(256 * 4, 144 * 4), std::ref(allocator), &surface));
+	CHECK_EQ((UINT32)4, *surface);
+
+	pool.Clear();
+	pool.GetStats(&stats);
+	CHECK_EQ((UINT32)0, stats.pooledSurfaces);
+	CHECK_EQ((UINT64)0, stats.pooledBytes);
+}
+
+CORE_TEST(FailedCreationIsReturned)
+{
+	CSurfacePool<TestSurface> pool;
+
+	TestSurface surface;
+	CHECK_EQ(E_OUTOFMEMORY, pool.Acquire(MakeKey(16, 16), [](const SURFACE_POOL_KEY&, TestSurface*) { return E_OUTOFMEMORY; }, &surface));
+	CHECK(surface == nullptr);
+}
+
+// Surfaces are destroyed outside of the pool lock, a destructor may call back into the pool
+CORE_TEST(EvictedSurfacesAreDestroyedOutsideTheLock)
+{
+	struct CALLBACK_SURFACE
+	{
+		CSurfacePool<std::shared_ptr<CALLBACK_SURFACE>>* pPool;
+		UINT32* pStatsRead;
+
+		~CALLBACK_SURFACE()
+		{
+			SURFACE_POOL_STATS stats;
+			pPool->GetStats(&stats);
+			(*pStatsRead)++;
+		}
+	};
+
+	CSurfacePool<std::shared_ptr<CALLBACK_SURFACE>> pool(1);
+	UINT32 statsRead = 0;
+
+	for (UINT32 i = 0; i < 2; i++)
+	{
+		SURFACE_POOL_KEY key = MakeKey(16 + i, 16);
+		std::shared_ptr<CALLBACK_SURFACE> spSurface;
+		REQUIRE_HR(pool.Acquire(key,
+			[&pool, &statsRead](const SURFACE_POOL_KEY&, std::shared_ptr<CALLBACK_SURFACE>* ppSurface)
+			{
+				ppSurface->reset(new CALLBACK_SURFACE());
+				(*ppSurface)->pPool = &pool;
+				(*ppSurface)->pStatsRead = &statsRead;
+				return S_OK;
+			},
+			&spSurface));
+		pool.Recycle(key, std::move(spSurface), 1);
+	}
+
+	pool.SetBudget(0);
+	pool.Clear();
+
+	CHECK_EQ((UINT32)2, statsRead);
+}
+
+// A player going back to a size it played before gets the surface of that size from its pool
+CORE_TEST(PlayerReusesSurfacesAcrossContent)
+{
+	CSoftwarePlayer player;
+	player.GetBackend()->RegisterMedia(L"small.mp4", MakeSoftwareMedia(256, 144, SOFTWARE_TICKS_PER_SECOND));
+	player.GetBackend()->RegisterMedia(L"large.mp4", MakeSoftwareMedia(1280, 720, SOFTWARE_TICKS_PER_SECOND));
+	REQUIRE_HR(player.Initialize());
+
+	const wchar_t* clips[] = { L"small.mp4", L"large.mp4", L"small.mp4", L"large.mp4" };
+	std::weak_ptr<IPlaybackSurface> surfaces[4];	// a surface the client still holds is not recycled
+
+	for (size_t i = 0; i < 4; i++)
+	{
+		REQUIRE_HR(player.GetCore().LoadContent(clips[i]));
+		player.Run(TEST_FRAME_DURATION * 2);
+		surfaces[i] = player.GetCore().GetPlaybackSurface();
+		REQUIRE(!surfaces[i].expired());
+	}
+
+	CHECK(surfaces[2].lock() == surfaces[0].lock());
+	CHECK(surfaces[3].lock() == surfaces[1].lock());
+
+	SURFACE_POOL_STATS stats;
+	REQUIRE_HR(player.GetCore().GetSurfacePoolStats(&stats));
+	CHECK_EQ((UINT64)2, stats.misses);
+	CHECK_EQ((UINT64)2, stats.hits);
+}
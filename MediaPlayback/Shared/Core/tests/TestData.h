@@ -0,0 +1,36 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Recorded traces in tests/data, CORE_TEST_DATA_DIR is set by tests/CMakeLists.txt
+
+#include "CorePlatform.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+
+inline HRESULT LoadTestData(_In_ const char* pszName, _Out_ std::string* pText)
+{
+	pText->clear();
+
+	std::ifstream file(std::string(CORE_TEST_DATA_DIR) + "/" + pszName, std::ios::binary);
+	if (!file)
+		return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+
+	std::ostringstream text;
+	text << file.rdbuf();
+	*pText = text.str();
+
+	return S_OK;
+}
@@ -0,0 +1,62 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Empty directory of its own under the system temporary directory, deleted with everything in it at the end of scope.
+
+#include "FileSystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+
+class CTestDirectory
+{
+public:
+	CTestDirectory()
+	{
+		static std::atomic<UINT32> s_counter(0);
+
+		std::wstring name = L"MediaPlaybackCoreTest-" +
+			std::to_wstring(std::chrono::steady_clock::now().time_since_epoch().count()) + L"-" + std::to_wstring(s_counter++);
+		m_path = std::filesystem::temp_directory_path() / name;
+
+		std::filesystem::create_directories(m_path);
+	}
+
+	~CTestDirectory()
+	{
+		std::error_code error;
+		std::filesystem::remove_all(m_path, error);
+	}
+
+	std::wstring GetPath() const { return m_path.wstring(); }
+
+	std::wstring GetFilePath(_In_ const std::wstring& name) const { return (m_path / name).wstring(); }
+
+	std::vector<std::wstring> ListFiles() const
+	{
+		std::vector<std::wstring> names;
+		::ListFiles(GetPath(), &names);
+
+		return names;
+	}
+
+private:
+	CTestDirectory(const CTestDirectory&) = delete;
+	CTestDirectory& operator=(const CTestDirectory&) = delete;
+
+	std::filesystem::path m_path;
+};
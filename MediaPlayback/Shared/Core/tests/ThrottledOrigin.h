@@ -0,0 +1,199 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Segment origin for the prefetcher without a network, the FetchSegment it runs on its workers.
+//
+// Every download pays a round trip, then moves its bytes in chunks over one link of capped bandwidth the downloads
+// share, checking for cancellation between chunks the way DownloadSegment does. Hold keeps the downloads from
+// starting until Release, so tests decide what is in flight. Manifests are built directly, two representations
+// of fixed size segments.
+
+#include "SegmentPrefetcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define TEST_SEGMENT_DURATION (2 * 10000000ll)	// 2s in 100ns
+#define TEST_CHUNK_SIZE (16 * 1024)
+
+
+inline SEGMENT_KEY MakeSegmentKey(_In_ const std::wstring& representationId, _In_ size_t index)
+{
+	SEGMENT_KEY key;
+	key.uri = L"https://cdn.example.com/" + representationId + L"/segment" + std::to_wstring(index) + L".m4s";
+	key.rangeOffset = 0;
+	key.rangeLength = 0;
+
+	return key;
+}
+
+inline MANIFEST MakeSegmentManifest(_In_ size_t segmentCount)
+{
+	MANIFEST manifest;
+
+	const wchar_t* ids[] = { L"720p", L"1080p" };
+	const UINT32 bandwidths[] = { 3000000, 6000000 };
+	for (int i = 0; i < 2; i++)
+	{
+		MANIFEST_REPRESENTATION representation;
+		representation.id = ids[i];
+		representation.bandwidth = bandwidths[i];
+
+		for (size_t index = 0; index < segmentCount; index++)
+		{
+			MANIFEST_SEGMENT segment;
+			segment.key = MakeSegmentKey(representation.id, index);
+			segment.duration = TEST_SEGMENT_DURATION;
+			representation.segments.push_back(segment);
+		}
+
+		manifest.representations.push_back(representation);
+	}
+
+	return manifest;
+}
+
+
+class CThrottledOrigin
+{
+public:
+	// bytesPerSecond 0 is an unlimited link
+	CThrottledOrigin(_In_ UINT32 segmentSize, _In_ UINT32 latencyMs, _In_ double bytesPerSecond)
+		: m_segmentSize(segmentSize)
+		, m_latencyMs(latencyMs)
+		, m_bytesPerSecond(bytesPerSecond)
+		, m_linkFree(std::chrono::steady_clock::now())
+		, m_held(false)
+		, m_active(0)
+		, m_maxActive(0)
+		, m_cancelled(0)
+	{
+	}
+
+	CSegmentPrefetcher::FetchSegment GetFetch()
+	{
+		return [this](const SEGMENT_KEY& key, const std::function<bool()>& fnIsCancelled, SegmentData* pData)
+		{
+			return Fetch(key, fnIsCancelled, pData);
+		};
+	}
+
+	void Hold()
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_held = true;
+	}
+
+	void Release()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_held = false;
+		}
+
+		m_released.notify_all();
+	}
+
+	// downloads started, finished or not
+	std::vector<std::wstring> GetFetched()
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		return m_fetched;
+	}
+
+	size_t CountFetches(_In_ const SEGMENT_KEY& key)
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		return (size_t)std::count(m_fetched.begin(), m_fetched.end(), key.uri);
+	}
+
+	UINT32 GetActive() { std::lock_guard<std::mutex> lock(m_lock); return m_active; }
+	UINT32 GetMaxActive() { std::lock_guard<std::mutex> lock(m_lock); return m_maxActive; }
+	UINT32 GetCancelled() { std::lock_guard<std::mutex> lock(m_lock); return m_cancelled; }
+
+private:
+	HRESULT Fetch(_In_ const SEGMENT_KEY& key, _In_ const std::function<bool()>& fnIsCancelled, _Out_ SegmentData* pData)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
+
+			m_fetched.push_back(key.uri);
+			m_active++;
+			m_maxActive = std::max(m_maxActive, m_active);
+
+			m_released.wait(lock, [this]() { return !m_held; });
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(m_latencyMs));
+
+		HRESULT hr = S_OK;
+		for (UINT32 sent = 0; sent < m_segmentSize; sent += TEST_CHUNK_SIZE)
+		{
+			if (fnIsCancelled())
+			{
+				hr = E_ABORT;
+				break;
+			}
+
+			UINT32 chunk = std::min<UINT32>(TEST_CHUNK_SIZE, m_segmentSize - sent);
+			std::this_thread::sleep_until(ReserveLink(chunk));
+		}
+
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		m_active--;
+		if (FAILED(hr))
+		{
+			m_cancelled++;
+			return hr;
+		}
+
+		*pData = std::make_shared<std::vector<BYTE>>(m_segmentSize, (BYTE)key.uri.size());
+
+		return S_OK;
+	}
+
+	// the link carries one chunk at a time, the time this one is through
+	std::chrono::steady_clock::time_point ReserveLink(_In_ UINT32 chunk)
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		auto now = std::chrono::steady_clock::now();
+		if (m_bytesPerSecond <= 0)
+			return now;
+
+		m_linkFree = std::max(m_linkFree, now) +
+			std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(chunk / m_bytesPerSecond));
+
+		return m_linkFree;
+	}
+
+private:
+	const UINT32 m_segmentSize;
+	const UINT32 m_latencyMs;
+	const double m_bytesPerSecond;
+
+	std::mutex m_lock;
+	std::condition_variable m_released;
+	std::chrono::steady_clock::time_point m_linkFree;
+	bool m_held;
+	UINT32 m_active;
+	UINT32 m_maxActive;
+	UINT32 m_cancelled;
+	std::vector<std::wstring> m_fetched;
+};
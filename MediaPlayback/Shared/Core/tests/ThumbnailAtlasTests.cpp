@@ -0,0 +1,461 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ContainerBuilder.h"
+#include "CoreTest.h"
+#include "FakeThumbnailDecoder.h"
+#include "FileSystem.h"
+#include "KeyframeIndex.h"
+#include "TestDirectory.h"
+#include "ThumbnailAtlas.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+
+static std::vector<BYTE> MakeSolidFrame(_In_ UINT32 width, _In_ UINT32 height, _In_ BYTE blue, _In_ BYTE green, _In_ BYTE red)
+{
+	std::vector<BYTE> frame((size_t)width * height * 4);
+	for (size_t i = 0; i < frame.size(); i += 4)
+	{
+		frame[i + 0] = blue;
+		frame[i + 1] = green;
+		frame[i + 2] = red;
+		frame[i + 3] = 0xFF;
+	}
+
+	return frame;
+}
+
+static const BYTE* GetPixel(_In_ const CThumbnailAtlas& atlas, _In_ UINT32 tile, _In_ UINT32 x, _In_ UINT32 y)
+{
+	const THUMBNAIL_ATLAS_INFO& info = atlas.GetInfo();
+	UINT32 atlasX = (tile % info.columns) * info.tileWidth + x;
+	UINT32 atlasY = (tile / info.columns) * info.tileHeight + y;
+
+	return atlas.GetPixels().data() + ((size_t)atlasY * info.width + atlasX) * 4;
+}
+
+// Keyframes every four seconds over 30 seconds
+static std::shared_ptr<const CKeyframeIndex> MakeKeyframeIndex()
+{
+	MP4_TRACK_TABLES tables;
+	tables.timescale = 1000;
+	tables.timeToSample = { { 30, 1000 } };
+	tables.syncSamples = { 1, 5, 9, 13, 17, 21, 25, 29 };
+	tables.sampleCount = 30;
+	tables.editMediaTime = -1;
+
+	ContainerBytes file = MakeProgressiveMp4(tables);
+	CMemorySource source(file);
+
+	std::shared_ptr<CKeyframeIndex> spIndex = std::make_shared<CKeyframeIndex>();
+	if (spIndex->Build(&source) != S_OK)
+		return nullptr;
+
+	return spIndex;
+}
+
+static bool WaitForTiles(_In_ CThumbnailExtractor* pExtractor, _In_ UINT32 tileCount)
+{
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (std::chrono::steady_clock::now() < deadline)
+	{
+		THUMBNAIL_ATLAS_INFO info;
+		if (pExtractor->GetInfo(&info) == S_OK && info.readyCount == tileCount)
+			return true;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	return false;
+}
+
+
+CORE_TEST(LaysOutTiles)
+{
+	CThumbnailAtlas atlas;
+	REQUIRE_HR(atlas.Initialize(160, 90, 10 * TEST_SECOND, 95 * TEST_SECOND));
+
+	const THUMBNAIL_ATLAS_INFO& info = atlas.GetInfo();
+	CHECK_EQ(10u, info.tileCount);
+	CHECK_EQ(0u, info.readyCount);
+	CHECK_EQ(10 * TEST_SECOND, info.interval);
+	CHECK_EQ(info.columns * 160, info.width);
+	CHECK_EQ((info.tileCount + info.columns - 1) / info.columns * 90, info.height);
+	CHECK_EQ((size_t)info.width * info.height * 4, atlas.GetPixels().size());
+	CHECK(std::all_of(atlas.GetPixels().begin(), atlas.GetPixels().end(), [](BYTE b) { return b == 0; }));
+
+	// roughly square: 4 columns of 160 against 3 rows of 90 is as close as it gets
+	CHECK_EQ(3u, info.columns);
+}
+
+// Ten hours at one preview a second do not fit; the interval grows to keep the atlas within the max size
+CORE_TEST(LongSourcesGrowTheInterval)
+{
+	CThumbnailAtlas atlas;
+	REQUIRE_HR(atlas.Initialize(160, 90, TEST_SECOND, 36000 * TEST_SECOND));
+
+	const THUMBNAIL_ATLAS_INFO& info = atlas.GetInfo();
+	CHECK(info.interval > TEST_SECOND);
+	CHECK(info.tileCount <= (_MaxThumbnailAtlasSize_ / 160) * (_MaxThumbnailAtlasSize_ / 90));
+	CHECK((INT64)info.tileCount * info.interval >= 36000 * TEST_SECOND);
+	CHECK(info.width <= _MaxThumbnailAtlasSize_);
+	CHECK(info.height <= _MaxThumbnailAtlasSize_);
+}
+
+CORE_TEST(RejectsInvalidLayouts)
+{
+	CThumbnailAtlas atlas;
+	CHECK_EQ(E_INVALIDARG, atlas.Initialize(0, 90, TEST_SECOND, TEST_SECOND));
+	CHECK_EQ(E_INVALIDARG, atlas.Initialize(160, 0, TEST_SECOND, TEST_SECOND));
+	CHECK_EQ(E_INVALIDARG, atlas.Initialize(_MaxThumbnailAtlasSize_ + 1, 90, TEST_SECOND, TEST_SECOND));
+	CHECK_EQ(E_INVALIDARG, atlas.Initialize(160, 90, 0, TEST_SECOND));
+	CHECK_EQ(E_INVALIDARG, atlas.Initialize(160, 90, TEST_SECOND, 0));
+}
+
+CORE_TEST(DownscalesIntoTheTile)
+{
+	CThumbnailAtlas atlas;
+	REQUIRE_HR(atlas.Initialize(16, 9, TEST_SECOND, 4 * TEST_SECOND));
+
+	std::vector<BYTE> frame = MakeSolidFrame(64, 36, 10, 20, 30);
+	REQUIRE_HR(atlas.SetTile(2, frame.data(), 64, 36, 64 * 4));
+	CHECK(atlas.IsTileReady(2));
+	CHECK(!atlas.IsTileReady(1));
+	CHECK_EQ(1u, atlas.GetInfo().readyCount);
+
+	for (UINT32 y = 0; y < 9; y++)
+	{
+		for (UINT32 x = 0; x < 16; x++)
+		{
+			const BYTE* pPixel = GetPixel(atlas, 2, x, y);
+			CHECK(pPixel[0] == 10 && pPixel[1] == 20 && pPixel[2] == 30 && pPixel[3] == 0xFF);
+		}
+	}
+
+	// the neighbours are untouched
+	CHECK_EQ(0u, (UINT32)GetPixel(atlas, 1, 15, 8)[3]);
+	CHECK_EQ(0u, (UINT32)GetPixel(atlas, 3, 0, 0)[3]);
+
+	// every source pixel is averaged in: a 2x2 checker of black and white becomes grey
+	std::vector<BYTE> checker(32 * 18 * 4, 0);
+	for (UINT32 y = 0; y < 18; y++)
+	{
+		for (UINT32 x = 0; x < 32; x++)
+			memset(&checker[((size_t)y * 32 + x) * 4], ((x + y) % 2) ? 0xFF : 0x00, 4);
+	}
+
+	REQUIRE_HR(atlas.SetTile(0, checker.data(), 32, 18, 32 * 4));
+	CHECK_EQ(127u, (UINT32)GetPixel(atlas, 0, 7, 4)[0]);
+	CHECK_EQ(0xFFu, (UINT32)GetPixel(atlas, 0, 7, 4)[3]);
+}
+
+CORE_TEST(LetterboxesOtherAspectRatios)
+{
+	CThumbnailAtlas atlas;
+	REQUIRE_HR(atlas.Initialize(16, 9, TEST_SECOND, TEST_SECOND));
+
+	// 32x4 is wider than 16:9, it fits as 16x2 in the middle rows
+	std::vector<BYTE> wide = MakeSolidFrame(32, 4, 0xFF, 0xFF, 0xFF);
+	REQUIRE_HR(atlas.SetTile(0, wide.data(), 32, 4, 32 * 4));
+
+	for (UINT32 y = 0; y < 9; y++)
+	{
+		bool inside = y >= 3 && y < 5;
+		CHECK_EQ(inside ? 0xFFu : 0u, (UINT32)GetPixel(atlas, 0, 8, y)[3]);
+	}
+
+	// 4x18 is taller, it fits as 2x9 in the middle columns
+	std::vector<BYTE> tall = MakeSolidFrame(4, 18, 0xFF, 0xFF, 0xFF);
+	REQUIRE_HR(atlas.SetTile(0, tall.data(), 4, 18, 4 * 4));
+
+	for (UINT32 x = 0; x < 16; x++)
+	{
+		bool inside = x >= 7 && x < 9;
+		CHECK_EQ(inside ? 0xFFu : 0u, (UINT32)GetPixel(atlas, 0, x, 4)[3]);
+	}
+
+	// a pitch wider than the rows is honoured
+	std::vector<BYTE> padded = MakeSolidFrame(20, 9, 50, 60, 70);
+	REQUIRE_HR(atlas.SetTile(0, padded.data(), 16, 9, 20 * 4));
+	CHECK_EQ(50u, (UINT32)GetPixel(atlas, 0, 15, 8)[0]);
+}
+
+CORE_TEST(RejectsInvalidTiles)
+{
+	CThumbnailAtlas atlas;
+	REQUIRE_HR(atlas.Initialize(16, 9, TEST_SECOND, 2 * TEST_SECOND));
+
+	std::vector<BYTE> frame = MakeSolidFrame(16, 9, 1, 2, 3);
+	CHECK_EQ(E_INVALIDARG, atlas.SetTile(2, frame.data(), 16, 9, 16 * 4));
+	CHECK_EQ(E_INVALIDARG, atlas.SetTile(0, frame.data(), 0, 9, 16 * 4));
+	CHECK_EQ(E_INVALIDARG, atlas.SetTile(0, frame.data(), 16, 9, 15 * 4));
+	CHECK_EQ(E_INVALIDARG, atlas.SetTile(0, nullptr, 16, 9, 16 * 4));
+
+	// only ready tiles are copied
+	CHECK_EQ(E_INVALIDARG, atlas.CopyTile(0, 1));
+	REQUIRE_HR(atlas.SetTile(0, frame.data(), 16, 9, 16 * 4));
+	REQUIRE_HR(atlas.CopyTile(0, 1));
+	CHECK(atlas.IsTileReady(1));
+	CHECK_EQ(3u, (UINT32)GetPixel(atlas, 1, 0, 0)[2]);
+	CHECK_EQ(E_INVALIDARG, atlas.CopyTile(0, 2));
+}
+
+CORE_TEST(OrdersTilesCoarseToFine)
+{
+	CHECK(GetThumbnailOrder(9) == std::vector<UINT32>({ 0, 8, 4, 2, 6, 1, 3, 5, 7 }));
+	CHECK(GetThumbnailOrder(0).empty());
+	CHECK(GetThumbnailOrder(1) == std::vector<UINT32>({ 0 }));
+
+	for (UINT32 count = 1; count < 300; count++)
+	{
+		std::vector<UINT32> order = GetThumbnailOrder(count);
+		CHECK_EQ((size_t)count, order.size());
+
+		std::sort(order.begin(), order.end());
+		for (UINT32 i = 0; i < order.size(); i++)
+			CHECK_EQ(i, order[i]);
+	}
+}
+
+CORE_TEST(SavesAndLoadsCompleteAtlases)
+{
+	CTestDirectory directory;
+	std::wstring path = directory.GetFilePath(L"atlas.bin");
+
+	CThumbnailAtlas atlas;
+	REQUIRE_HR(atlas.Initialize(16, 9, TEST_SECOND, 3 * TEST_SECOND));
+
+	std::vector<BYTE> frame = MakeSolidFrame(16, 9, 1, 2, 3);
+	REQUIRE_HR(atlas.SetTile(0, frame.data(), 16, 9, 16 * 4));
+	CHECK_EQ(E_ILLEGAL_METHOD_CALL, atlas.Save(path, L"C:\\Videos\\clip.mp4"));
+
+	REQUIRE_HR(atlas.CopyTile(0, 1));
+	REQUIRE_HR(atlas.CopyTile(0, 2));
+	REQUIRE_HR(atlas.Save(path, L"C:\\Videos\\clip.mp4"));
+	CHECK(directory.ListFiles() == std::vector<std::wstring>({ L"atlas.bin" }));
+
+	CThumbnailAtlas loaded;
+	REQUIRE_HR(loaded.Initialize(16, 9, TEST_SECOND, 3 * TEST_SECOND));
+	CHECK_EQ(S_OK, loaded.Load(path, L"C:\\Videos\\clip.mp4"));
+	CHECK_EQ(3u, loaded.GetInfo().readyCount);
+	CHECK(loaded.GetPixels() == atlas.GetPixels());
+
+	// another source, another layout, a missing or damaged file: extract again
+	CThumbnailAtlas other;
+	REQUIRE_HR(other.Initialize(16, 9, TEST_SECOND, 3 * TEST_SECOND));
+	CHECK_EQ(S_FALSE, other.Load(path, L"C:\\Videos\\other.mp4"));
+	CHECK_EQ(S_FALSE, other.Load(directory.GetFilePath(L"missing.bin"), L"C:\\Videos\\clip.mp4"));
+	CHECK_EQ(0u, other.GetInfo().readyCount);
+
+	REQUIRE_HR(other.Initialize(32, 18, TEST_SECOND, 3 * TEST_SECOND));
+	CHECK_EQ(S_FALSE, other.Load(path, L"C:\\Videos\\clip.mp4"));
+
+	std::vector<BYTE> data;
+	REQUIRE_HR(ReadWholeFile(path, &data));
+	data.resize(data.size() - 1);
+	REQUIRE_HR(WriteWholeFile(path, data.data(), data.size()));
+	REQUIRE_HR(other.Initialize(16, 9, TEST_SECOND, 3 * TEST_SECOND));
+	CHECK_EQ(S_FALSE, other.Load(path, L"C:\\Videos\\clip.mp4"));
+
+	CThumbnailAtlas empty;
+	CHECK_EQ(E_ILLEGAL_METHOD_CALL, empty.Load(path, L"C:\\Videos\\clip.mp4"));
+}
+
+// One tile per task, coarse to fine, each at its tile time
+CORE_TEST(ExtractsTileByTile)
+{
+	CManualTaskQueue queue;
+	std::shared_ptr<CFakeThumbnailDecoder> spDecoder = std::make_shared<CFakeThumbnailDecoder>(5 * TEST_SECOND, 64, 36);
+
+	CThumbnailExtractor extractor(queue.GetSubmit());
+
+	THUMBNAIL_ATLAS_INFO info;
+	CHECK_EQ(E_ILLEGAL_METHOD_CALL, extractor.GetInfo(&info));
+
+	REQUIRE_HR(extractor.Start(spDecoder, L"clip.mp4", 16, 9, TEST_SECOND, nullptr, L""));
+	CHECK_EQ(S_FALSE, extractor.GetInfo(&info));
+	CHECK_EQ(0u, info.tileCount);
+
+	std::vector<BYTE> pixels(16 * 9 * 4 * 5);
+	CHECK_EQ(S_FALSE, extractor.CopyPixels(pixels.data(), (UINT32)pixels.size(), &info));
+
+	REQUIRE(queue.RunOne());
+	CHECK_EQ(S_OK, extractor.GetInfo(&info));
+	CHECK_EQ(5u, info.tileCount);
+	pixels.resize((size_t)info.width * info.height * 4);
+	CHECK_EQ(0u, spDecoder->GetDecodeCount());
+
+	REQUIRE(queue.RunOne());
+	CHECK_EQ(1u, spDecoder->GetDecodeCount());
+	CHECK_EQ(S_OK, extractor.GetInfo(&info));
+	CHECK_EQ(1u, info.readyCount);
+
+	queue.RunAll();
+	CHECK(spDecoder->GetPositions() == std::vector<INT64>({ 0, 4 * TEST_SECOND, 2 * TEST_SECOND, TEST_SECOND, 3 * TEST_SECOND }));
+
+	REQUIRE_HR(extractor.CopyPixels(pixels.data(), (UINT32)pixels.size(), &info));
+	CHECK_EQ(5u, info.readyCount);
+
+	for (UINT32 tile = 0; tile < 5; tile++)
+	{
+		UINT32 atlasX = (tile % info.columns) * info.tileWidth;
+		UINT32 atlasY = (tile / info.columns) * info.tileHeight;
+		CHECK_EQ((UINT32)GetFakeFrameBlue(tile * TEST_SECOND), (UINT32)pixels[((size_t)atlasY * info.width + atlasX) * 4]);
+	}
+
+	CHECK_EQ(E_NOT_SUFFICIENT_BUFFER, extractor.CopyPixels(pixels.data(), (UINT32)pixels.size() - 1, &info));
+}
+
+// Tiles snap to the keyframe before them; tiles on the same keyframe are copied, not decoded again
+CORE_TEST(DecodesEachKeyframeOnce)
+{
+	std::shared_ptr<const CKeyframeIndex> spIndex = MakeKeyframeIndex();
+	REQUIRE(spIndex != nullptr);
+
+	CManualTaskQueue queue;
+	std::shared_ptr<CFakeThumbnailDecoder> spDecoder = std::make_shared<CFakeThumbnailDecoder>(30 * TEST_SECOND, 64, 36);
+
+	CThumbnailExtractor extractor(queue.GetSubmit());
+	REQUIRE_HR(extractor.Start(spDecoder, L"clip.mp4", 16, 9, TEST_SECOND, spIndex, L""));
+	queue.RunAll();
+
+	CHECK_EQ(8u, spDecoder->GetDecodeCount());
+	for (INT64 position : spDecoder->GetPositions())
+		CHECK_EQ(0ll, position % (4 * TEST_SECOND));
+
+	THUMBNAIL_ATLAS_INFO info;
+	std::vector<BYTE> pixels(4096 * 4096 * 4);
+	REQUIRE_HR(extractor.CopyPixels(pixels.data(), (UINT32)pixels.size(), &info));
+	CHECK_EQ(30u, info.readyCount);
+
+	// tile 7 shows the keyframe at 4s
+	UINT32 atlasX = (7 % info.columns) * info.tileWidth;
+	UINT32 atlasY = (7 / info.columns) * info.tileHeight;
+	CHECK_EQ((UINT32)GetFakeFrameBlue(4 * TEST_SECOND), (UINT32)pixels[((size_t)atlasY * info.width + atlasX) * 4]);
+}
+
+CORE_TEST(StopEndsTheExtraction)
+{
+	CManualTaskQueue queue;
+	std::shared_ptr<CFakeThumbnailDecoder> spDecoder = std::make_shared<CFakeThumbnailDecoder>(30 * TEST_SECOND, 64, 36);
+
+	CThumbnailExtractor extractor(queue.GetSubmit());
+	REQUIRE_HR(extractor.Start(spDecoder, L"clip.mp4", 16, 9, TEST_SECOND, nullptr, L""));
+	queue.RunOne();
+	queue.RunOne();
+	queue.RunOne();
+	CHECK_EQ(2u, spDecoder->GetDecodeCount());
+
+	extractor.Stop();
+	queue.RunAll();
+	CHECK_EQ(2u, spDecoder->GetDecodeCount());
+
+	THUMBNAIL_ATLAS_INFO info;
+	CHECK_EQ(E_ILLEGAL_METHOD_CALL, extractor.GetInfo(&info));
+
+	// a new start replaces the running extraction, whose queued task then does nothing
+	std::shared_ptr<CFakeThumbnailDecoder> spOther = std::make_shared<CFakeThumbnailDecoder>(2 * TEST_SECOND, 64, 36);
+	REQUIRE_HR(extractor.Start(spDecoder, L"clip.mp4", 16, 9, TEST_SECOND, nullptr, L""));
+	queue.RunOne();
+	REQUIRE_HR(extractor.Start(spOther, L"other.mp4", 16, 9, TEST_SECOND, nullptr, L""));
+	queue.RunAll();
+
+	CHECK_EQ(2u, spDecoder->GetDecodeCount());
+	CHECK_EQ(2u, spOther->GetDecodeCount());
+	CHECK_EQ(S_OK, extractor.GetInfo(&info));
+	CHECK_EQ(2u, info.readyCount);
+}
+
+CORE_TEST(ReportsOpenFailures)
+{
+	CManualTaskQueue queue;
+	std::shared_ptr<CFakeThumbnailDecoder> spDecoder = std::make_shared<CFakeThumbnailDecoder>(30 * TEST_SECOND, 64, 36);
+	spDecoder->SetOpenResult(E_NOTIMPL);
+
+	CThumbnailExtractor extractor(queue.GetSubmit());
+	REQUIRE_HR(extractor.Start(spDecoder, L"live.m3u8", 16, 9, TEST_SECOND, nullptr, L""));
+	CHECK_EQ(1u, queue.RunAll());
+
+	THUMBNAIL_ATLAS_INFO info;
+	CHECK_EQ(E_NOTIMPL, extractor.GetInfo(&info));
+	CHECK_EQ(0u, info.tileCount);
+	CHECK_EQ(0u, spDecoder->GetDecodeCount());
+
+	CHECK_EQ(E_INVALIDARG, extractor.Start(spDecoder, L"clip.mp4", 0, 9, TEST_SECOND, nullptr, L""));
+	CHECK_EQ(E_INVALIDARG, extractor.Start(nullptr, L"clip.mp4", 16, 9, TEST_SECOND, nullptr, L""));
+}
+
+// A complete atlas is saved and loaded by the next extraction instead of decoding; one with holes is not saved
+CORE_TEST(CachesCompleteExtractions)
+{
+	CTestDirectory directory;
+	std::wstring path = directory.GetFilePath(L"clip.atlas");
+
+	CManualTaskQueue queue;
+	std::shared_ptr<CFakeThumbnailDecoder> spDecoder = std::make_shared<CFakeThumbnailDecoder>(8 * TEST_SECOND, 64, 36);
+	spDecoder->SetFailingPositions({ 3 * TEST_SECOND });
+
+	CThumbnailExtractor extractor(queue.GetSubmit());
+	REQUIRE_HR(extractor.Start(spDecoder, L"clip.mp4", 16, 9, TEST_SECOND, nullptr, path));
+	queue.RunAll();
+
+	THUMBNAIL_ATLAS_INFO info;
+	CHECK_EQ(S_OK, extractor.GetInfo(&info));
+	CHECK_EQ(7u, info.readyCount);
+	CHECK(directory.ListFiles().empty());
+
+	spDecoder->SetFailingPositions({});
+	REQUIRE_HR(extractor.Start(spDecoder, L"clip.mp4", 16, 9, TEST_SECOND, nullptr, path));
+	queue.RunAll();
+	CHECK(directory.ListFiles() == std::vector<std::wstring>({ L"clip.atlas" }));
+
+	UINT32 decodes = spDecoder->GetDecodeCount();
+	REQUIRE_HR(extractor.Start(spDecoder, L"clip.mp4", 16, 9, TEST_SECOND, nullptr, path));
+	CHECK_EQ(1u, queue.RunAll());
+	CHECK_EQ(decodes, spDecoder->GetDecodeCount());
+	CHECK_EQ(S_OK, extractor.GetInfo(&info));
+	CHECK_EQ(8u, info.readyCount);
+
+	// the same file for another source is not taken
+	REQUIRE_HR(extractor.Start(spDecoder, L"other.mp4", 16, 9, TEST_SECOND, nullptr, path));
+	queue.RunAll();
+	CHECK_EQ(decodes + 8, spDecoder->GetDecodeCount());
+}
+
+// Several extractions sharing a real worker pool all finish; destroying an extractor mid-way is safe
+CORE_TEST(SharesAWorkerPool)
+{
+	CWorkerPool pool;
+	REQUIRE_HR(pool.Start(1));
+	CThumbnailExtractor::SubmitTask fnSubmit = [&pool](const CWorkerPool::Task& task) { return pool.Submit(task); };
+
+	std::shared_ptr<CFakeThumbnailDecoder> spFirst = std::make_shared<CFakeThumbnailDecoder>(40 * TEST_SECOND, 320, 180);
+	std::shared_ptr<CFakeThumbnailDecoder> spSecond = std::make_shared<CFakeThumbnailDecoder>(20 * TEST_SECOND, 320, 180);
+
+	CThumbnailExtractor first(fnSubmit);
+	CThumbnailExtractor second(fnSubmit);
+	{
+		CThumbnailExtractor abandoned(fnSubmit);
+		REQUIRE_HR(abandoned.Start(spFirst, L"abandoned.mp4", 16, 9, TEST_SECOND, nullptr, L""));
+	}
+
+	REQUIRE_HR(first.Start(spFirst, L"first.mp4", 16, 9, TEST_SECOND, nullptr, L""));
+	REQUIRE_HR(second.Start(spSecond, L"second.mp4", 16, 9, TEST_SECOND, nullptr, L""));
+
+	CHECK(WaitForTiles(&first, 40));
+	CHECK(WaitForTiles(&second, 20));
+
+	pool.Shutdown();
+	CHECK(spFirst->GetDecodeCount() <= 41);
+}
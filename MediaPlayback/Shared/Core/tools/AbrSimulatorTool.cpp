@@ -0,0 +1,198 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Plays a stream against a bandwidth trace with each ABR policy and prints start-up delay, rebuffering,
+// switches and average bitrate, e.g.
+//   AbrSimulatorTool norway-bus-1.log --bitrates 300,750,1200,1850,2850,4300 --segments 150
+
+#include "AbrSimulator.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+
+static const struct
+{
+	const char* name;
+	AbrPolicy policy;
+} c_policies[] =
+{
+	{ "throughput", AbrPolicy::AbrPolicy_Throughput },
+	{ "buffer", AbrPolicy::AbrPolicy_Buffer },
+	{ "hybrid", AbrPolicy::AbrPolicy_Hybrid },
+};
+
+static void PrintUsage()
+{
+	fprintf(stderr,
+		"usage: AbrSimulatorTool <trace> [options]\n"
+		"  <trace>              one \"<seconds> <Mbps>\" pair per line\n"
+		"  --policy <name>      throughput, buffer, hybrid or all (default all)\n"
+		"  --bitrates <kbps,..> ascending ladder (default 300,750,1200,1850,2850,4300)\n"
+		"  --segment <seconds>  segment duration (default 4)\n"
+		"  --segments <count>   segments in the stream (default 75)\n"
+		"  --buffer <seconds>   most the player buffers (default 30)\n"
+		"  --startup <seconds>  buffered before playback starts (default 4)\n"
+		"  --latency <ms>       request to first byte (default 50)\n");
+}
+
+static INT64 SecondsToHns(_In_ double seconds)
+{
+	return (INT64)(seconds * 10000000.0 + 0.5);
+}
+
+static bool ParseBitrates(_In_ const char* pszList, _Out_ std::vector<UINT32>* pBitrates)
+{
+	pBitrates->clear();
+
+	std::istringstream values(pszList);
+	std::string value;
+	while (std::getline(values, value, ','))
+	{
+		char* pEnd = nullptr;
+		double kbps = strtod(value.c_str(), &pEnd);
+		if (pEnd == value.c_str() || *pEnd != '\0' || kbps <= 0 || kbps > 4000000.0)
+			return false;
+
+		UINT32 bitrate = (UINT32)(kbps * 1000.0);
+		if (!pBitrates->empty() && bitrate <= pBitrates->back())
+			return false;
+
+		pBitrates->push_back(bitrate);
+	}
+
+	return !pBitrates->empty();
+}
+
+static bool ParsePositive(_In_ const char* pszValue, _Out_ double* pValue)
+{
+	char* pEnd = nullptr;
+	*pValue = strtod(pszValue, &pEnd);
+
+	return pEnd != pszValue && *pEnd == '\0' && *pValue >= 0 && *pValue < 1e9;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2 || argv[1][0] == '-')
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	ABR_SIMULATION_CONFIG config;
+	ParseBitrates("300,750,1200,1850,2850,4300", &config.bitrates);
+	config.segmentDuration = SecondsToHns(4);
+	config.segmentCount = 75;
+	config.maxBuffer = SecondsToHns(30);
+	config.startupBuffer = SecondsToHns(4);
+	config.requestLatency = SecondsToHns(0.05);
+
+	const char* pszPolicy = "all";
+
+	for (int i = 2; i < argc; i++)
+	{
+		const char* pszOption = argv[i];
+		const char* pszValue = (i + 1 < argc) ? argv[++i] : nullptr;
+		double value = 0;
+
+		bool valid = true;
+		if (pszValue == nullptr)
+			valid = false;
+		else if (strcmp(pszOption, "--policy") == 0)
+			pszPolicy = pszValue;
+		else if (strcmp(pszOption, "--bitrates") == 0)
+			valid = ParseBitrates(pszValue, &config.bitrates);
+		else if (strcmp(pszOption, "--segment") == 0 && (valid = ParsePositive(pszValue, &value)))
+			config.segmentDuration = SecondsToHns(value);
+		else if (strcmp(pszOption, "--segments") == 0 && (valid = ParsePositive(pszValue, &value)))
+			config.segmentCount = (UINT32)value;
+		else if (strcmp(pszOption, "--buffer") == 0 && (valid = ParsePositive(pszValue, &value)))
+			config.maxBuffer = SecondsToHns(value);
+		else if (strcmp(pszOption, "--startup") == 0 && (valid = ParsePositive(pszValue, &value)))
+			config.startupBuffer = SecondsToHns(value);
+		else if (strcmp(pszOption, "--latency") == 0 && (valid = ParsePositive(pszValue, &value)))
+			config.requestLatency = SecondsToHns(value / 1000.0);
+		else
+			valid = false;
+
+		if (!valid)
+		{
+			fprintf(stderr, "invalid option %s %s\n", pszOption, pszValue ? pszValue : "");
+			PrintUsage();
+			return 2;
+		}
+	}
+
+	std::ifstream file(argv[1], std::ios::binary);
+	if (!file)
+	{
+		fprintf(stderr, "cannot open %s\n", argv[1]);
+		return 1;
+	}
+
+	std::ostringstream text;
+	text << file.rdbuf();
+
+	std::vector<BANDWIDTH_SAMPLE> trace;
+	if (FAILED(ParseBandwidthTrace(text.str(), &trace)))
+	{
+		fprintf(stderr, "%s is not a bandwidth trace\n", argv[1]);
+		return 1;
+	}
+
+	printf("%-12s %10s %10s %10s %9s %12s\n", "policy", "startup s", "rebuffer s", "rebuffers", "switches", "avg kbps");
+
+	bool simulated = false;
+	for (const auto& entry : c_policies)
+	{
+		if (strcmp(pszPolicy, "all") != 0 && strcmp(pszPolicy, entry.name) != 0)
+			continue;
+
+		std::unique_ptr<IAbrController> spController;
+		HRESULT hr = CreateAbrController(entry.policy, &spController);
+
+		ABR_SIMULATION_RESULT result;
+		if (SUCCEEDED(hr))
+			hr = SimulateAbr(trace, config, spController.get(), &result);
+
+		if (FAILED(hr))
+		{
+			fprintf(stderr, "simulation failed: 0x%08x\n", (unsigned int)hr);
+			return 1;
+		}
+
+		printf("%-12s %10.2f %10.2f %10u %9u %12.0f\n",
+			entry.name,
+			result.startupDelay / 10000000.0,
+			result.rebufferTime / 10000000.0,
+			(unsigned int)result.rebufferCount,
+			(unsigned int)result.switches,
+			result.averageBitrate / 1000.0);
+
+		simulated = true;
+	}
+
+	if (!simulated)
+	{
+		fprintf(stderr, "unknown policy %s\n", pszPolicy);
+		PrintUsage();
+		return 2;
+	}
+
+	return 0;
+}
@@ -0,0 +1,67 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Replays a recorded rendition selection session (the format RenditionReplay.h describes) and prints every
+// selection it makes with the pixel rate ceiling at the time, e.g.
+//   RenditionReplayTool session.txt
+
+#include "RenditionReplay.h"
+
+#include <stdio.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+
+int main(int argc, char** argv)
+{
+	if (argc != 2 || argv[1][0] == '-')
+	{
+		fprintf(stderr, "usage: RenditionReplayTool <session>\n");
+		return 2;
+	}
+
+	std::ifstream file(argv[1], std::ios::binary);
+	if (!file)
+	{
+		fprintf(stderr, "cannot open %s\n", argv[1]);
+		return 1;
+	}
+
+	std::ostringstream text;
+	text << file.rdbuf();
+
+	std::vector<RENDITION_REPLAY_STEP> steps;
+	UINT32 errorLine = 0;
+	if (FAILED(ReplayRenditionTrace(text.str(), &steps, &errorLine)))
+	{
+		fprintf(stderr, "%s(%u): malformed line\n", argv[1], (unsigned int)errorLine);
+		return 1;
+	}
+
+	printf("%6s %10s %16s\n", "line", "rendition", "ceiling px/s");
+
+	for (const RENDITION_REPLAY_STEP& step : steps)
+	{
+		if (step.selectedIndex < 0)
+			printf("%6u %10s", (unsigned int)step.line, "none");
+		else
+			printf("%6u %10d", (unsigned int)step.line, (int)step.selectedIndex);
+
+		if (step.pixelRateCeiling != 0)
+			printf(" %16llu\n", (unsigned long long)step.pixelRateCeiling);
+		else
+			printf(" %16s\n", "-");
+	}
+
+	return 0;
+}
@@ -13,7 +13,11 @@
 
 #include "pch.h"
 #include "MediaHelpers.h"
+#include "Core/SourceClassifier.h"
+#include "Core/SegmentCache.h"
 #include <windows.storage.accesscache.h>
+#include <windows.web.http.h>
+#include <robuffer.h>
 
 using namespace ABI::Windows::Graphics::DirectX::Direct3D11;
 using namespace ABI::Windows::Media::Core;
@@ -49,11 +53,251 @@ using namespace Microsoft::WRL::Wrappers;
 
 #include <ppl.h>
 #include <ppltasks.h>
+#include <algorithm>
+#include <mutex>
+
+#define CANCELLATION_POLL_INTERVAL_MS 50
+
+// Waits for hCompleted. If fnIsCancelled fires first, the operation stored in spAsyncInfo (once there is one) is cancelled
+// and the wait continues until its completion handler has run, so the handler never outlives the caller's stack.
+// Returns true if the operation has been cancelled.
+static bool WaitForAsyncOperation(
+	_In_ HANDLE hCompleted,
+	_In_opt_ const CancellationCheck& fnIsCancelled,
+	_In_ std::mutex& asyncInfoLock,
+	_In_ ComPtr<IAsyncInfo>& spAsyncInfo)
+{
+	if (!fnIsCancelled)
+	{
+		WaitForSingleObject(hCompleted, INFINITE);
+		return false;
+	}
+
+	bool cancelled = false;
+
+	while (WaitForSingleObject(hCompleted, CANCELLATION_POLL_INTERVAL_MS) == WAIT_TIMEOUT)
+	{
+		if (cancelled || !fnIsCancelled())
+			continue;
+
+		std::lock_guard<std::mutex> lock(asyncInfoLock);
+		if (spAsyncInfo)
+		{
+			spAsyncInfo->Cancel();
+			cancelled = true;
+		}
+	}
+
+	return cancelled || fnIsCancelled();
+}
+
+// Starts an IAsyncOperation(WithProgress) with fnStart on the thread pool and waits for its result
+template <typename TOperation, typename THandler, typename TResult, typename TStart>
+static HRESULT RunAsyncOperation(
+	_In_ const TStart& fnStart,
+	_COM_Outptr_ TResult** ppResult,
+	_In_opt_ const CancellationCheck& fnIsCancelled)
+{
+	*ppResult = nullptr;
+
+	ComPtr<TOperation> spOperation;
+	Event operationCompleted(CreateEvent(nullptr, TRUE, FALSE, nullptr));
+	std::mutex asyncInfoLock;
+	ComPtr<IAsyncInfo> spAsyncInfo;
+	HRESULT hrStatus = S_OK;
+
+	auto callback = Callback<THandler>(
+		[&operationCompleted, &hrStatus, ppResult](
+			TOperation* pOp,
+			AsyncStatus status
+			) -> HRESULT
+	{
+		hrStatus = (status == AsyncStatus::Completed) ? pOp->GetResults(ppResult) : E_FAIL;
+
+		SetEvent(operationCompleted.Get());
+		return S_OK;
+	});
+
+	concurrency::create_task([&]() {
+		hrStatus = fnStart(spOperation.GetAddressOf());
+		if (spOperation)
+		{
+			{
+				std::lock_guard<std::mutex> lock(asyncInfoLock);
+				spOperation.As(&spAsyncInfo);
+			}
+			spOperation->put_Completed(callback.Get());
+		}
+		else
+		{
+			SetEvent(operationCompleted.Get());
+		}
+	});
+
+	if (WaitForAsyncOperation(operationCompleted.Get(), fnIsCancelled, asyncInfoLock, spAsyncInfo))
+	{
+		return HRESULT_FROM_WIN32(ERROR_CANCELLED);
+	}
+
+	return hrStatus;
+}
+
+// Decisions of CreateMediaSource, shared by every player
+static CSourceClassifier& GetSourceClassifier()
+{
+	static CSourceClassifier classifier;
+	return classifier;
+}
+
+// HttpClient and a GET request for pszUrl, with a Range header (e.g. "bytes=0-1023") if pszRange is set
+static HRESULT CreateHttpGetRequest(
+	_In_ LPCWSTR pszUrl,
+	_In_opt_ LPCWSTR pszRange,
+	_COM_Outptr_ ABI::Windows::Web::Http::IHttpClient** ppClient,
+	_COM_Outptr_ ABI::Windows::Web::Http::IHttpRequestMessage** ppRequest)
+{
+	using namespace ABI::Windows::Web::Http;
+
+	*ppClient = nullptr;
+	*ppRequest = nullptr;
+
+	ComPtr<IUriRuntimeClassFactory> spUriFactory;
+	IFR(ABI::Windows::Foundation::GetActivationFactory(
+		HStringReference(RuntimeClass_Windows_Foundation_Uri).Get(),
+		&spUriFactory));
+
+	ComPtr<IUriRuntimeClass> spUri;
+	IFR(spUriFactory->CreateUri(HStringReference(pszUrl).Get(), &spUri));
+
+	ComPtr<IHttpClient> spClient;
+	IFR(Windows::Foundation::ActivateInstance(
+		HStringReference(RuntimeClass_Windows_Web_Http_HttpClient).Get(),
+		&spClient));
+
+	ComPtr<IHttpMethodStatics> spMethodStatics;
+	IFR(ABI::Windows::Foundation::GetActivationFactory(
+		HStringReference(RuntimeClass_Windows_Web_Http_HttpMethod).Get(),
+		&spMethodStatics));
+
+	ComPtr<IHttpMethod> spGetMethod;
+	IFR(spMethodStatics->get_Get(&spGetMethod));
+
+	ComPtr<IHttpRequestMessageFactory> spRequestFactory;
+	IFR(ABI::Windows::Foundation::GetActivationFactory(
+		HStringReference(RuntimeClass_Windows_Web_Http_HttpRequestMessage).Get(),
+		&spRequestFactory));
+
+	ComPtr<IHttpRequestMessage> spRequest;
+	IFR(spRequestFactory->Create(spGetMethod.Get(), spUri.Get(), &spRequest));
+
+	if (pszRange != nullptr)
+	{
+		ComPtr<Headers::IHttpRequestHeaderCollection> spRequestHeaders;
+		IFR(spRequest->get_Headers(&spRequestHeaders));
+
+		boolean appended = false;
+		spRequestHeaders->TryAppendWithoutValidation(HStringReference(L"Range").Get(), HStringReference(pszRange).Get(), &appended);
+	}
+
+	*ppClient = spClient.Detach();
+	*ppRequest = spRequest.Detach();
+
+	return S_OK;
+}
+
+// Asks the server what pszUrl is: the Content-Type first, the first bytes of the body if the type says nothing.
+// Only the response headers and at most _SourceSniffLength_ bytes are read. *pType stays SourceType_Unknown if the server does not tell.
+static HRESULT ProbeHttpSourceType(
+	_In_ LPCWSTR pszUrl,
+	_Out_ SourceType* pType,
+	_In_opt_ const CancellationCheck& fnIsCancelled)
+{
+	using namespace ABI::Windows::Web::Http;
+	using namespace ABI::Windows::Storage::Streams;
+
+	*pType = SourceType::SourceType_Unknown;
+
+	// servers ignoring the range still only send as much as is read below before the response is released
+	std::wstring range = L"bytes=0-" + std::to_wstring(_SourceSniffLength_ - 1);
+
+	ComPtr<IHttpClient> spClient;
+	ComPtr<IHttpRequestMessage> spRequest;
+	IFR(CreateHttpGetRequest(pszUrl, range.c_str(), &spClient, &spRequest));
+
+	ComPtr<IHttpResponseMessage> spResponse;
+	IFR((RunAsyncOperation<IAsyncOperationWithProgress<HttpResponseMessage*, HttpProgress>, IAsyncOperationWithProgressCompletedHandler<HttpResponseMessage*, HttpProgress>>(
+		[&](IAsyncOperationWithProgress<HttpResponseMessage*, HttpProgress>** ppOperation)
+		{
+			return spClient->SendRequestWithOptionAsync(spRequest.Get(), HttpCompletionOption::HttpCompletionOption_ResponseHeadersRead, ppOperation);
+		},
+		spResponse.GetAddressOf(), fnIsCancelled)));
+
+	boolean isSuccess = false;
+	spResponse->get_IsSuccessStatusCode(&isSuccess);
+	if (!isSuccess)
+	{
+		// not ours to report, the media source fails with the proper error
+		return S_OK;
+	}
+
+	ComPtr<IHttpContent> spContent;
+	IFR(spResponse->get_Content(&spContent));
+
+	ComPtr<Headers::IHttpContentHeaderCollection> spContentHeaders;
+	ComPtr<Headers::IHttpMediaTypeHeaderValue> spContentType;
+	if (SUCCEEDED(spContent->get_Headers(&spContentHeaders)) && SUCCEEDED(spContentHeaders->get_ContentType(&spContentType)) && spContentType != nullptr)
+	{
+		HString mediaType;
+		spContentType->get_MediaType(mediaType.GetAddressOf());
+
+		*pType = CSourceClassifier::ClassifyContentType(mediaType.GetRawBuffer(nullptr));
+		if (*pType != SourceType::SourceType_Unknown)
+			return S_OK;
+	}
+
+	ComPtr<IInputStream> spStream;
+	IFR((RunAsyncOperation<IAsyncOperationWithProgress<IInputStream*, UINT64>, IAsyncOperationWithProgressCompletedHandler<IInputStream*, UINT64>>(
+		[&](IAsyncOperationWithProgress<IInputStream*, UINT64>** ppOperation)
+		{
+			return spContent->ReadAsInputStreamAsync(ppOperation);
+		},
+		spStream.GetAddressOf(), fnIsCancelled)));
+
+	ComPtr<IBufferFactory> spBufferFactory;
+	IFR(ABI::Windows::Foundation::GetActivationFactory(
+		HStringReference(RuntimeClass_Windows_Storage_Streams_Buffer).Get(),
+		&spBufferFactory));
+
+	ComPtr<IBuffer> spBuffer;
+	IFR(spBufferFactory->Create(_SourceSniffLength_, &spBuffer));
+
+	ComPtr<IBuffer> spReadBuffer;
+	IFR((RunAsyncOperation<IAsyncOperationWithProgress<IBuffer*, UINT32>, IAsyncOperationWithProgressCompletedHandler<IBuffer*, UINT32>>(
+		[&](IAsyncOperationWithProgress<IBuffer*, UINT32>** ppOperation)
+		{
+			return spStream->ReadAsync(spBuffer.Get(), _SourceSniffLength_, InputStreamOptions::InputStreamOptions_Partial, ppOperation);
+		},
+		spReadBuffer.GetAddressOf(), fnIsCancelled)));
 
-void CreateAdaptiveMediaSourceFromUri(
+	UINT32 length = 0;
+	IFR(spReadBuffer->get_Length(&length));
+
+	ComPtr<Windows::Storage::Streams::IBufferByteAccess> spBytes;
+	IFR(spReadBuffer.As(&spBytes));
+
+	byte* pData = nullptr;
+	IFR(spBytes->Buffer(&pData));
+
+	*pType = CSourceClassifier::SniffContent(pData, length);
+
+	return S_OK;
+}
+
+bool CreateAdaptiveMediaSourceFromUri(
 	_In_ PCWSTR szManifestUri,
 	_Outptr_opt_ IAdaptiveMediaSource** ppAdaptiveMediaSource,
-	_Outptr_opt_ IAdaptiveMediaSourceCreationResult** ppCreationResult
+	_Outptr_opt_ IAdaptiveMediaSourceCreationResult** ppCreationResult,
+	_In_opt_ const CancellationCheck& fnIsCancelled
 )
 {
 	HRESULT hr = S_OK;
@@ -87,6 +331,8 @@ void CreateAdaptiveMediaSourceFromUri(
 
 	ComPtr<ICreateAdaptiveMediaSourceOperation> spCreateOperation;
 	Event operationCompleted(CreateEvent(nullptr, TRUE, FALSE, nullptr));
+	std::mutex asyncInfoLock;
+	ComPtr<IAsyncInfo> spAsyncInfo;
 
 	HRESULT hrStatus = S_OK;
 	ComPtr<IAdaptiveMediaSourceCreationResult> spResult;
@@ -117,6 +363,10 @@ void CreateAdaptiveMediaSourceFromUri(
 		);
 		if (spCreateOperation)
 		{
+			{
+				std::lock_guard<std::mutex> lock(asyncInfoLock);
+				spCreateOperation.As(&spAsyncInfo);
+			}
 			spCreateOperation->put_Completed(callback.Get());
 		}
 		else
@@ -126,7 +376,7 @@ void CreateAdaptiveMediaSourceFromUri(
 	});
 
 
-	DWORD result = WaitForSingleObject(operationCompleted.Get(), INFINITE);
+	bool cancelled = WaitForAsyncOperation(operationCompleted.Get(), fnIsCancelled, asyncInfoLock, spAsyncInfo);
 
 	AdaptiveMediaSourceCreationStatus creationStatus = AdaptiveMediaSourceCreationStatus_UnknownFailure;
 	if(spResult)
@@ -147,12 +397,15 @@ void CreateAdaptiveMediaSourceFromUri(
 	{
 		*ppCreationResult = spResult.Detach();
 	}
+
+	return cancelled;
 }
 
 _Use_decl_annotations_
 HRESULT CreateMediaSource(
     LPCWSTR pszUrl,
-    IMediaSource2** ppMediaSource)
+    IMediaSource2** ppMediaSource,
+    const CancellationCheck& fnIsCancelled)
 {
     NULL_CHK(pszUrl);
     NULL_CHK(ppMediaSource);
@@ -205,6 +458,8 @@ HRESULT CreateMediaSource(
 			ComPtr<ABI::Windows::Storage::IStorageFile> file;
 			Event operationCompleted(CreateEvent(nullptr, TRUE, FALSE, nullptr));
 			HRESULT hrResult = S_OK;
+			std::mutex asyncInfoLock;
+			ComPtr<IAsyncInfo> spAsyncInfo;
 
 			auto callback = Callback<ABI::Windows::Foundation::IAsyncOperationCompletedHandler<ABI::Windows::Storage::StorageFile*>>(
 				[&operationCompleted, &file, &hrResult](
@@ -231,6 +486,10 @@ HRESULT CreateMediaSource(
 				hrResult = accList->GetFileAsync(token.Get(), fileOp.GetAddressOf());
 				if (fileOp)
 				{
+					{
+						std::lock_guard<std::mutex> lock(asyncInfoLock);
+						fileOp.As(&spAsyncInfo);
+					}
 					fileOp->put_Completed(callback.Get());
 				}
 				else
@@ -239,7 +498,10 @@ HRESULT CreateMediaSource(
 				}
 			});
 
-			DWORD result = WaitForSingleObject(operationCompleted.Get(), INFINITE);
+			if (WaitForAsyncOperation(operationCompleted.Get(), fnIsCancelled, asyncInfoLock, spAsyncInfo))
+			{
+				return HRESULT_FROM_WIN32(ERROR_CANCELLED);
+			}
 
 			if (file.Get())
 			{
@@ -258,11 +520,41 @@ HRESULT CreateMediaSource(
 	else
 #endif
 	{
-		Microsoft::WRL::ComPtr<ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSource> adaptiveSource;
-		CreateAdaptiveMediaSourceFromUri(pszUrl, adaptiveSource.GetAddressOf(), nullptr);
+		// probe and adaptive attempt as the classifier decides, the core makes the same requests in its software backend
+		SourceType sourceType = SourceType::SourceType_Unknown;
+		HRESULT hr = GetSourceClassifier().ResolveSource(pszUrl,
+			[&](SourceType* pType) -> HRESULT
+			{
+				HRESULT hrProbe = ProbeHttpSourceType(pszUrl, pType, fnIsCancelled);
+				if (hrProbe != HRESULT_FROM_WIN32(ERROR_CANCELLED))
+				{
+					LOG_RESULT(hrProbe);
+				}
 
-		if (adaptiveSource != nullptr)
-			spMediaSourceStatics->CreateFromAdaptiveMediaSource(adaptiveSource.Get(), &spMediaSource2);
+				return hrProbe;
+			},
+			[&](bool* pNotManifest) -> HRESULT
+			{
+				Microsoft::WRL::ComPtr<ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSource> adaptiveSource;
+				Microsoft::WRL::ComPtr<ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSourceCreationResult> creationResult;
+				if (CreateAdaptiveMediaSourceFromUri(pszUrl, adaptiveSource.GetAddressOf(), creationResult.GetAddressOf(), fnIsCancelled))
+				{
+					return HRESULT_FROM_WIN32(ERROR_CANCELLED);
+				}
+
+				if (adaptiveSource != nullptr)
+					spMediaSourceStatics->CreateFromAdaptiveMediaSource(adaptiveSource.Get(), &spMediaSource2);
+
+				AdaptiveMediaSourceCreationStatus creationStatus = AdaptiveMediaSourceCreationStatus_UnknownFailure;
+				if (creationResult != nullptr)
+					creationResult->get_Status(&creationStatus);
+
+				*pNotManifest = creationStatus == AdaptiveMediaSourceCreationStatus_UnsupportedManifestContentType;
+
+				return spMediaSource2.Get() != nullptr ? S_OK : S_FALSE;
+			},
+			&sourceType);
+		IFR(hr);
 
 		if (spMediaSource2.Get() == nullptr)
 		{
@@ -321,6 +613,64 @@ HRESULT CreateAdaptiveMediaSource(
     return S_OK;
 }
 
+_Use_decl_annotations_
+bool GetLocalFilePath(LPCWSTR pszUrl, std::wstring* pPath)
+{
+	if (pszUrl == nullptr || pPath == nullptr)
+		return false;
+
+	std::wstring url(pszUrl);
+
+	// drive letter and UNC paths as they are
+	if ((url.size() > 2 && url[1] == L':' && (url[2] == L'\\' || url[2] == L'/')) || url.compare(0, 2, L"\\\\") == 0)
+	{
+		*pPath = url;
+		return true;
+	}
+
+	if (_wcsnicmp(pszUrl, L"file://", 7) != 0)
+		return false;
+
+	// file:///C:/... is a drive path, file://server/share/... a UNC one
+	size_t start = 7;
+	std::wstring prefix;
+	if (url.size() > start && url[start] == L'/')
+		start++;
+	else
+		prefix = L"\\\\";
+
+	size_t end = url.find_first_of(L"?#", start);
+	std::wstring escaped = url.substr(start, (end == std::wstring::npos) ? std::wstring::npos : end - start);
+
+	// escapes are UTF-8 bytes
+	int utf8Length = WideCharToMultiByte(CP_UTF8, 0, escaped.c_str(), (int)escaped.size(), nullptr, 0, nullptr, nullptr);
+	std::string utf8(utf8Length, '\0');
+	WideCharToMultiByte(CP_UTF8, 0, escaped.c_str(), (int)escaped.size(), &utf8[0], utf8Length, nullptr, nullptr);
+
+	std::string unescaped;
+	for (size_t i = 0; i < utf8.size(); i++)
+	{
+		if (utf8[i] == '%' && i + 2 < utf8.size() && isxdigit((unsigned char)utf8[i + 1]) && isxdigit((unsigned char)utf8[i + 2]))
+		{
+			unescaped.push_back((char)strtoul(utf8.substr(i + 1, 2).c_str(), nullptr, 16));
+			i += 2;
+		}
+		else
+		{
+			unescaped.push_back(utf8[i]);
+		}
+	}
+
+	int length = MultiByteToWideChar(CP_UTF8, 0, unescaped.c_str(), (int)unescaped.size(), nullptr, 0);
+	std::wstring path(length, L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, unescaped.c_str(), (int)unescaped.size(), &path[0], length);
+
+	std::replace(path.begin(), path.end(), L'/', L'\\');
+	*pPath = prefix + path;
+
+	return !path.empty();
+}
+
 _Use_decl_annotations_
 HRESULT CreateMediaPlaybackItem(
     _In_ IMediaSource2* pMediaSource,
@@ -341,41 +691,208 @@ HRESULT CreateMediaPlaybackItem(
 }
 
 _Use_decl_annotations_
-HRESULT CreatePlaylistSource(
-    IMediaSource2* pSource,
-    IMediaPlaybackSource** ppMediaPlaybackSource)
+HRESULT CreateMediaPlaybackList(
+    INT64 maxPrefetchTime,
+    IMediaPlaybackList** ppMediaPlaybackList)
 {
-    NULL_CHK(pSource);
-    NULL_CHK(ppMediaPlaybackSource);
+    NULL_CHK(ppMediaPlaybackList);
 
-    *ppMediaPlaybackSource = nullptr;
+    *ppMediaPlaybackList = nullptr;
 
     ComPtr<IMediaPlaybackList> spPlaylist;
     IFR(Windows::Foundation::ActivateInstance(
         Wrappers::HStringReference(RuntimeClass_Windows_Media_Playback_MediaPlaybackList).Get(),
         &spPlaylist));
 
-    // get the iterator for playlist
-    ComPtr<ABI::Windows::Foundation::Collections::IObservableVector<MediaPlaybackItem*>> spItems;
-    IFR(spPlaylist->get_Items(&spItems));
+    // without IMediaPlaybackList2 the list prefetches by its own default
+    ComPtr<IMediaPlaybackList2> spPlaylist2;
+    if (SUCCEEDED(spPlaylist.As(&spPlaylist2)))
+    {
+        ComPtr<ABI::Windows::Foundation::IReference<ABI::Windows::Foundation::TimeSpan>> spPrefetchTime;
+        CreateTimeSpanReference(maxPrefetchTime, &spPrefetchTime);
 
-    ComPtr<ABI::Windows::Foundation::Collections::IVector<MediaPlaybackItem*>> spItemsVector;
-    IFR(spItems.As(&spItemsVector));
+        if (spPrefetchTime != nullptr)
+        {
+            LOG_RESULT(spPlaylist2->put_MaxPrefetchTime(spPrefetchTime.Get()));
+        }
+    }
 
-    // create playbackitem from source
-    ComPtr<IMediaPlaybackItem> spItem;
-    IFR(CreateMediaPlaybackItem(pSource, &spItem));
+    *ppMediaPlaybackList = spPlaylist.Detach();
 
-    // add to the list
-    IFR(spItemsVector->Append(spItem.Get()));
+    return S_OK;
+}
 
-    // convert to playbackSource
-    ComPtr<IMediaPlaybackSource> spMediaPlaybackSource;
-    IFR(spPlaylist.As(&spMediaPlaybackSource));
+// Read-only IBuffer over segment bytes owned by someone else, the owner stays alive as long as the buffer
+class CSegmentBuffer
+	: public RuntimeClass
+	< RuntimeClassFlags<WinRtClassicComMix>
+	, ABI::Windows::Storage::Streams::IBuffer
+	, Windows::Storage::Streams::IBufferByteAccess
+	, FtmBase>
+{
+	InspectableClass(L"MediaPlayback.SegmentBuffer", BaseTrust)
 
-    *ppMediaPlaybackSource = spMediaPlaybackSource.Detach();
+public:
+	HRESULT RuntimeClassInitialize(_In_ const std::shared_ptr<const void>& spOwner, _In_ const BYTE* pData, _In_ size_t size)
+	{
+		NULL_CHK(spOwner.get());
 
-    return S_OK;
+		if (size > UINT32_MAX)
+			return E_INVALIDARG;
+
+		m_spOwner = spOwner;
+		m_pData = pData;
+		m_size = (UINT32)size;
+
+		return S_OK;
+	}
+
+	IFACEMETHOD(get_Capacity)(_Out_ UINT32* value)
+	{
+		NULL_CHK(value);
+		*value = m_size;
+		return S_OK;
+	}
+
+	IFACEMETHOD(get_Length)(_Out_ UINT32* value)
+	{
+		NULL_CHK(value);
+		*value = m_size;
+		return S_OK;
+	}
+
+	IFACEMETHOD(put_Length)(_In_ UINT32 value)
+	{
+		return (value == m_size) ? S_OK : E_ILLEGAL_METHOD_CALL;
+	}
+
+	// cached pages are mapped read-only, consumers of a filled download result only read them
+	IFACEMETHOD(Buffer)(_Out_ byte** value)
+	{
+		NULL_CHK(value);
+		*value = const_cast<byte*>(m_pData);
+		return S_OK;
+	}
+
+private:
+	std::shared_ptr<const void> m_spOwner;
+	const BYTE* m_pData;
+	UINT32 m_size;
+};
+
+_Use_decl_annotations_
+HRESULT DownloadSegment(
+	LPCWSTR pszUrl,
+	UINT64 rangeOffset,
+	UINT64 rangeLength,
+	ABI::Windows::Storage::Streams::IBuffer** ppBuffer,
+	std::wstring* pETag,
+	const CancellationCheck& fnIsCancelled)
+{
+	using namespace ABI::Windows::Web::Http;
+	using namespace ABI::Windows::Storage::Streams;
+
+	NULL_CHK(pszUrl);
+	NULL_CHK(ppBuffer);
+	NULL_CHK(pETag);
+
+	*ppBuffer = nullptr;
+	pETag->clear();
+
+	bool isRange = rangeOffset != 0 || rangeLength != 0;
+
+	std::wstring range = L"bytes=" + std::to_wstring(rangeOffset) + L"-";
+	if (rangeLength != 0)
+		range += std::to_wstring(rangeOffset + rangeLength - 1);
+
+	ComPtr<IHttpClient> spClient;
+	ComPtr<IHttpRequestMessage> spRequest;
+	IFR(CreateHttpGetRequest(pszUrl, isRange ? range.c_str() : nullptr, &spClient, &spRequest));
+
+	ComPtr<IHttpResponseMessage> spResponse;
+	IFR((RunAsyncOperation<IAsyncOperationWithProgress<HttpResponseMessage*, HttpProgress>, IAsyncOperationWithProgressCompletedHandler<HttpResponseMessage*, HttpProgress>>(
+		[&](IAsyncOperationWithProgress<HttpResponseMessage*, HttpProgress>** ppOperation)
+		{
+			return spClient->SendRequestWithOptionAsync(spRequest.Get(), HttpCompletionOption::HttpCompletionOption_ResponseContentRead, ppOperation);
+		},
+		spResponse.GetAddressOf(), fnIsCancelled)));
+
+	HttpStatusCode statusCode = HttpStatusCode::HttpStatusCode_None;
+	IFR(spResponse->get_StatusCode(&statusCode));
+
+	// a server ignoring the range sends the whole resource, which is not the segment that has been asked for
+	if (isRange ? (statusCode != HttpStatusCode::HttpStatusCode_PartialContent) : (statusCode != HttpStatusCode::HttpStatusCode_Ok))
+		return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+	ComPtr<Headers::IHttpResponseHeaderCollection> spResponseHeaders;
+	ComPtr<ABI::Windows::Foundation::Collections::IMap<HSTRING, HSTRING>> spHeaderMap;
+	if (SUCCEEDED(spResponse->get_Headers(&spResponseHeaders)) && SUCCEEDED(spResponseHeaders.As(&spHeaderMap)))
+	{
+		boolean hasETag = false;
+		HString etag;
+		if (SUCCEEDED(spHeaderMap->HasKey(HStringReference(L"ETag").Get(), &hasETag)) && hasETag
+			&& SUCCEEDED(spHeaderMap->Lookup(HStringReference(L"ETag").Get(), etag.GetAddressOf())))
+		{
+			*pETag = etag.GetRawBuffer(nullptr);
+		}
+	}
+
+	ComPtr<IHttpContent> spContent;
+	IFR(spResponse->get_Content(&spContent));
+
+	ComPtr<IBuffer> spBuffer;
+	IFR((RunAsyncOperation<IAsyncOperationWithProgress<IBuffer*, UINT64>, IAsyncOperationWithProgressCompletedHandler<IBuffer*, UINT64>>(
+		[&](IAsyncOperationWithProgress<IBuffer*, UINT64>** ppOperation)
+		{
+			return spContent->ReadAsBufferAsync(ppOperation);
+		},
+		spBuffer.GetAddressOf(), fnIsCancelled)));
+
+	UINT32 length = 0;
+	IFR(spBuffer->get_Length(&length));
+	if (rangeLength != 0 && length != rangeLength)
+		return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+	*ppBuffer = spBuffer.Detach();
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CreateBufferFromSegment(
+	const std::shared_ptr<CMappedSegment>& spSegment,
+	ABI::Windows::Storage::Streams::IBuffer** ppBuffer)
+{
+	NULL_CHK(ppBuffer);
+
+	*ppBuffer = nullptr;
+
+	NULL_CHK(spSegment.get());
+
+	ComPtr<CSegmentBuffer> spBuffer;
+	IFR(MakeAndInitialize<CSegmentBuffer>(&spBuffer, spSegment, spSegment->GetData(), spSegment->GetSize()));
+
+	*ppBuffer = spBuffer.Detach();
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CreateBufferFromBytes(
+	const std::shared_ptr<const std::vector<BYTE>>& spBytes,
+	ABI::Windows::Storage::Streams::IBuffer** ppBuffer)
+{
+	NULL_CHK(ppBuffer);
+	NULL_CHK(spBytes.get());
+
+	*ppBuffer = nullptr;
+
+	ComPtr<CSegmentBuffer> spBuffer;
+	IFR(MakeAndInitialize<CSegmentBuffer>(&spBuffer, spBytes, spBytes->data(), spBytes->size()));
+
+	*ppBuffer = spBuffer.Detach();
+
+	return S_OK;
 }
 
 _Use_decl_annotations_
@@ -404,6 +921,36 @@ HRESULT GetSurfaceFromTexture(
     return S_OK;
 }
 
+_Use_decl_annotations_
+HRESULT GetSurfaceFromTextureSubresource(
+    ID3D11Texture2D* pTexture,
+    UINT subresource,
+    IDirect3DSurface** ppSurface)
+{
+    NULL_CHK(pTexture);
+    NULL_CHK(ppSurface);
+
+    *ppSurface = nullptr;
+
+    ComPtr<ID3D11Texture2D> spTexture(pTexture);
+
+    ComPtr<IDXGIResource1> dxgiResource;
+    IFR(spTexture.As(&dxgiResource));
+
+    ComPtr<IDXGISurface2> dxgiSurface;
+    IFR(dxgiResource->CreateSubresourceSurface(subresource, &dxgiSurface));
+
+    ComPtr<IInspectable> inspectableSurface;
+    IFR(CreateDirect3D11SurfaceFromDXGISurface(dxgiSurface.Get(), &inspectableSurface));
+
+    ComPtr<IDirect3DSurface> spSurface;
+    IFR(inspectableSurface.As(&spSurface));
+
+    *ppSurface = spSurface.Detach();
+
+    return S_OK;
+}
+
 _Use_decl_annotations_
 HRESULT GetTextureFromSurface(
     IDirect3DSurface* pSurface,
@@ -22,6 +22,9 @@
 #include <wrl.h>
 
 #include <string>
+#include <functional>
+#include <memory>
+#include <vector>
 
 __inline void replaceAll(std::wstring& str, const std::wstring& from, const std::wstring& to) {
 	if (from.empty())
@@ -42,9 +45,21 @@ DECLARE_INTERFACE_IID_(IAdaptiveMediaSourceCompletedCallback, IUnknown, "e25c01d
     STDMETHOD(OnAdaptiveMediaSourceCreated)(ICreateAdaptiveMediaSourceOperation* pOp, AsyncStatus status) PURE;
 };
 
+class CMappedSegment;
+
+// Polled while waiting for asynchronous WinRT operations; returning true cancels the operation
+typedef std::function<bool()> CancellationCheck;
+
+// Blocks until the source has been resolved. Returns HRESULT_FROM_WIN32(ERROR_CANCELLED) if fnIsCancelled fired first.
 HRESULT CreateMediaSource(
     _In_ LPCWSTR pszUrl,
-    _COM_Outptr_ ABI::Windows::Media::Core::IMediaSource2** ppMediaSource);
+    _COM_Outptr_ ABI::Windows::Media::Core::IMediaSource2** ppMediaSource,
+    _In_opt_ const CancellationCheck& fnIsCancelled = nullptr);
+
+// Path of file:// URIs, drive letter and UNC paths; false for every other URI
+bool GetLocalFilePath(
+    _In_ LPCWSTR pszUrl,
+    _Out_ std::wstring* pPath);
 
 HRESULT CreateAdaptiveMediaSource(
     _In_ LPCWSTR pszManifestLocation,
@@ -54,14 +69,42 @@ HRESULT CreateMediaPlaybackItem(
     _In_ ABI::Windows::Media::Core::IMediaSource2* pMediaSource,
     _COM_Outptr_ ABI::Windows::Media::Playback::IMediaPlaybackItem** ppMediaPlaybackItem);
 
-HRESULT CreatePlaylistSource(
-    _In_ ABI::Windows::Media::Core::IMediaSource2* pSource,
-    _COM_Outptr_ ABI::Windows::Media::Playback::IMediaPlaybackSource** ppMediaPlaybackSource);
+// Empty gapless list; the item after the current one is opened once the current one is within maxPrefetchTime
+// (100ns) of its end
+HRESULT CreateMediaPlaybackList(
+    _In_ INT64 maxPrefetchTime,
+    _COM_Outptr_ ABI::Windows::Media::Playback::IMediaPlaybackList** ppMediaPlaybackList);
+
+// Downloads one HLS/DASH segment, the whole resource if rangeOffset and rangeLength are 0.
+// Fails if the server does not honor the range. *pETag is empty if the response has no ETag.
+HRESULT DownloadSegment(
+    _In_ LPCWSTR pszUrl,
+    _In_ UINT64 rangeOffset,
+    _In_ UINT64 rangeLength,
+    _COM_Outptr_ ABI::Windows::Storage::Streams::IBuffer** ppBuffer,
+    _Out_ std::wstring* pETag,
+    _In_opt_ const CancellationCheck& fnIsCancelled = nullptr);
+
+// IBuffer over a segment served by CSegmentCache, without copying it
+HRESULT CreateBufferFromSegment(
+    _In_ const std::shared_ptr<CMappedSegment>& spSegment,
+    _COM_Outptr_ ABI::Windows::Storage::Streams::IBuffer** ppBuffer);
+
+// IBuffer over prefetched segment bytes, without copying them
+HRESULT CreateBufferFromBytes(
+    _In_ const std::shared_ptr<const std::vector<BYTE>>& spBytes,
+    _COM_Outptr_ ABI::Windows::Storage::Streams::IBuffer** ppBuffer);
 
 HRESULT GetSurfaceFromTexture(
     _In_ ID3D11Texture2D* pTexture,
     _COM_Outptr_ ABI::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface** ppSurface);
 
+// Surface over one subresource (mip 0 of one array slice) of the texture, e.g. one eye of a stereo frame
+HRESULT GetSurfaceFromTextureSubresource(
+    _In_ ID3D11Texture2D* pTexture,
+    _In_ UINT subresource,
+    _COM_Outptr_ ABI::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface** ppSurface);
+
 HRESULT GetTextureFromSurface(
     _In_ ABI::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface* pSurface,
     _COM_Outptr_ ID3D11Texture2D** ppTexture);
@@ -90,3 +133,24 @@ __inline void CreateUInt32Reference(
 	spPropertyValueFactory->CreateUInt32(value, &spProperty);
 	spProperty.CopyTo(reference);
 }
+
+__inline void CreateTimeSpanReference(
+	_In_ INT64 value,
+	_Outptr_ ABI::Windows::Foundation::IReference<ABI::Windows::Foundation::TimeSpan>** reference
+)
+{
+	Microsoft::WRL::ComPtr<IActivationFactory> spFactory;
+	Microsoft::WRL::ComPtr<ABI::Windows::Foundation::IPropertyValueStatics> spPropertyValueFactory;
+	Microsoft::WRL::ComPtr<IInspectable> spProperty;
+	*reference = nullptr;
+
+	ABI::Windows::Foundation::GetActivationFactory(
+		Microsoft::WRL::Wrappers::HStringReference(RuntimeClass_Windows_Foundation_PropertyValue).Get(),
+		spFactory.GetAddressOf()
+	);
+	spFactory.As(&spPropertyValueFactory);
+
+	ABI::Windows::Foundation::TimeSpan timeSpan = { value };
+	spPropertyValueFactory->CreateTimeSpan(timeSpan, &spProperty);
+	spProperty.CopyTo(reference);
+}
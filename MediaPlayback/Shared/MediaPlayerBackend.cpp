@@ -0,0 +1,3062 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+#include <ppltasks.h>
+#include <algorithm>
+#include <robuffer.h>
+#include "MediaPlayerBackend.h"
+#include "MediaHelpers.h"
+#include "Core/FileSystem.h"
+#include "Core/ManifestParser.h"
+#include "Core/RenditionSelector.h"
+#include "ThumbnailDecoder.h"
+
+
+#include <initguid.h>
+DEFINE_GUID(D3D11_DECODER_PROFILE_H264_VLD_NOFGT,    0x1b81be68, 0xa0c7, 0x11d3, 0xb9, 0x84, 0x00, 0xc0, 0x4f, 0x2e, 0x73, 0xc5);
+DEFINE_GUID(D3D11_DECODER_PROFILE_HEVC_VLD_MAIN,     0x5b11d51b, 0x2f4c, 0x4452, 0xbc, 0xc3, 0x09, 0xf2, 0xa1, 0x16, 0x0c, 0xc0);
+DEFINE_GUID(D3D11_DECODER_PROFILE_HEVC_VLD_MAIN10,   0x107af0e0, 0xef1a, 0x4d19, 0xab, 0xa8, 0x67, 0xa1, 0x63, 0x07, 0x3d, 0x13);
+DEFINE_GUID(D3D11_DECODER_PROFILE_VP9_VLD_PROFILE0,  0x463707f8, 0xa1d0, 0x4585, 0x87, 0x6d, 0x83, 0xaa, 0x6d, 0x60, 0xb8, 0x9e);
+DEFINE_GUID(D3D11_DECODER_PROFILE_VP9_VLD_10BIT_PROFILE2, 0xa4c749ef, 0x6ecf, 0x48aa, 0x84, 0x48, 0x50, 0xa7, 0xa1, 0x16, 0x5f, 0xf7);
+DEFINE_GUID(D3D11_DECODER_PROFILE_AV1_VLD_PROFILE0,  0xb8be4ccb, 0xcf53, 0x46ba, 0x8d, 0x59, 0xd6, 0xb8, 0xa6, 0xda, 0x5d, 0x2a);
+
+using namespace Microsoft::WRL;
+using namespace ABI::Windows::Graphics::DirectX::Direct3D11;
+using namespace ABI::Windows::Media;
+using namespace ABI::Windows::Media::Core;
+using namespace ABI::Windows::Media::Playback;
+using namespace Windows::Foundation;
+
+static UINT64 GetAdapterId(const LUID& adapterLuid)
+{
+	return ((UINT64)(UINT32)adapterLuid.HighPart << 32) | adapterLuid.LowPart;
+}
+
+// Video capable device of an adapter, shared by the players rendering on it, and the DXGI device manager of its own
+// the players lock it through
+class CD3D11MediaDevice
+	: public IMediaDevice
+{
+public:
+	CD3D11MediaDevice(UINT64 adapterId, ID3D11Device* pDevice, IMFDXGIDeviceManager* pDeviceManager)
+		: m_adapterId(adapterId)
+		, m_spDevice(pDevice)
+		, m_spDeviceManager(pDeviceManager)
+	{
+	}
+
+	virtual UINT64 GetAdapterId() const override { return m_adapterId; }
+
+	ID3D11Device* GetDevice() const { return m_spDevice.Get(); }
+	IMFDXGIDeviceManager* GetDeviceManager() const { return m_spDeviceManager.Get(); }
+
+private:
+	UINT64 m_adapterId;
+	ComPtr<ID3D11Device> m_spDevice;
+	ComPtr<IMFDXGIDeviceManager> m_spDeviceManager;
+};
+
+class CD3D11MediaDeviceFactory
+	: public IMediaDeviceFactory
+{
+public:
+	virtual HRESULT CreateDevice(UINT64 adapterId, std::shared_ptr<IMediaDevice>* pspDevice) override
+	{
+		NULL_CHK(pspDevice);
+
+		ComPtr<IDXGIFactory1> spFactory;
+		IFR(CreateDXGIFactory1(IID_PPV_ARGS(&spFactory)));
+
+		ComPtr<IDXGIAdapter1> spAdapter;
+		for (UINT i = 0; spFactory->EnumAdapters1(i, &spAdapter) != DXGI_ERROR_NOT_FOUND; i++)
+		{
+			DXGI_ADAPTER_DESC1 adapterDesc = {};
+			if (SUCCEEDED(spAdapter->GetDesc1(&adapterDesc)) && GetAdapterId(adapterDesc.AdapterLuid) == adapterId)
+				break;
+
+			spAdapter = nullptr;
+		}
+
+		// the adapter went away, e.g. an external GPU was unplugged
+		if (!spAdapter)
+			return DXGI_ERROR_DEVICE_REMOVED;
+
+		ComPtr<ID3D11Device> spMediaDevice;
+		IFR(CreateMediaDevice(spAdapter.Get(), &spMediaDevice));
+
+		// a manager per adapter; the process wide one holds a single device, resetting it to the device of another
+		// adapter would move the players of this one over to it
+		UINT resetToken = 0;
+		ComPtr<IMFDXGIDeviceManager> spDeviceManager;
+		IFR(MFCreateDXGIDeviceManager(&resetToken, &spDeviceManager));
+		IFR(spDeviceManager->ResetDevice(spMediaDevice.Get(), resetToken));
+
+		*pspDevice = std::make_shared<CD3D11MediaDevice>(adapterId, spMediaDevice.Get(), spDeviceManager.Get());
+
+		return S_OK;
+	}
+};
+
+// The media device locked through its DXGI device manager for as long as the lock lives, frame threads of the
+// players on the adapter take turns on it
+class CMediaDeviceLock
+{
+public:
+	CMediaDeviceLock(IMFDXGIDeviceManager* pDeviceManager, HANDLE hDevice)
+		: m_pDeviceManager(pDeviceManager)
+		, m_hDevice(hDevice)
+		, m_hr(E_HANDLE)
+	{
+		if (m_pDeviceManager != nullptr && m_hDevice != nullptr)
+			m_hr = m_pDeviceManager->LockDevice(m_hDevice, IID_PPV_ARGS(&m_spDevice), TRUE);
+	}
+
+	~CMediaDeviceLock()
+	{
+		if (SUCCEEDED(m_hr))
+			m_pDeviceManager->UnlockDevice(m_hDevice, FALSE);
+	}
+
+	HRESULT GetResult() const { return m_hr; }
+	ID3D11Device* GetDevice() const { return m_spDevice.Get(); }
+
+private:
+	IMFDXGIDeviceManager* m_pDeviceManager;
+	HANDLE m_hDevice;
+	HRESULT m_hr;
+	ComPtr<ID3D11Device> m_spDevice;
+};
+
+std::shared_ptr<CSegmentCache> CMediaPlayerBackend::m_spSegmentCache;
+CWorkerPool* CMediaPlayerBackend::m_pSegmentWorkers = nullptr;
+std::mutex CMediaPlayerBackend::m_segmentCacheMutex;
+std::map<std::wstring, CDecoderCapabilities> CMediaPlayerBackend::m_decoderCapabilityProfiles;
+std::mutex CMediaPlayerBackend::m_decoderCapabilitiesMutex;
+CMediaDeviceService CMediaPlayerBackend::m_mediaDevices(std::make_shared<CD3D11MediaDeviceFactory>());
+std::atomic<UINT32> CMediaPlayerBackend::m_deviceGeneration(0);
+
+#define SEGMENT_WORKER_THREADS 4
+
+#define PREFETCH_MAX_PLAYLISTS 16		// media playlists of an HLS master playlist read when prefetching starts
+
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerBackend::EnableSegmentCache(LPCWSTR pszDirectory, UINT64 budgetBytes)
+{
+	std::lock_guard<std::mutex> lock(m_segmentCacheMutex);
+
+	// closed before the new one opens, it may use the same directory; downloads in flight finish without storing
+	if (m_spSegmentCache)
+	{
+		m_spSegmentCache->Close();
+		m_spSegmentCache.reset();
+	}
+
+	if (pszDirectory == nullptr)
+		return S_OK;
+
+	IFR(StartSegmentWorkers());
+
+	std::shared_ptr<CSegmentCache> spSegmentCache = std::make_shared<CSegmentCache>();
+	IFR(spSegmentCache->Open(pszDirectory, budgetBytes));
+
+	m_spSegmentCache = spSegmentCache;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerBackend::GetSegmentCacheStats(SEGMENT_CACHE_STATS* pStats)
+{
+	NULL_CHK(pStats);
+
+	ZeroMemory(pStats, sizeof(SEGMENT_CACHE_STATS));
+
+	std::lock_guard<std::mutex> lock(m_segmentCacheMutex);
+
+	if (!m_spSegmentCache)
+		return S_FALSE;
+
+	m_spSegmentCache->GetStats(pStats);
+
+	return S_OK;
+}
+
+HRESULT CMediaPlayerBackend::StartSegmentWorkers()
+{
+	if (m_pSegmentWorkers != nullptr)
+		return S_OK;
+
+	std::unique_ptr<CWorkerPool> spSegmentWorkers(new (std::nothrow) CWorkerPool());
+	NULL_CHK_HR(spSegmentWorkers.get(), E_OUTOFMEMORY);
+
+	// downloads use HttpClient, so every worker joins the MTA
+	IFR(spSegmentWorkers->Start(SEGMENT_WORKER_THREADS,
+		[]() { RoInitialize(RO_INIT_MULTITHREADED); },
+		[]() { RoUninitialize(); }));
+
+	m_pSegmentWorkers = spSegmentWorkers.release();
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerBackend::SubmitSegmentTask(const CWorkerPool::Task& task)
+{
+	std::lock_guard<std::mutex> lock(m_segmentCacheMutex);
+
+	// the workers are only started by the API calls, never again once the plugin shuts them down
+	if (m_pSegmentWorkers == nullptr)
+		return E_ILLEGAL_METHOD_CALL;
+
+	return m_pSegmentWorkers->Submit(task);
+}
+
+static HRESULT GetBufferBytes(
+	_In_ ABI::Windows::Storage::Streams::IBuffer* pBuffer,
+	_Outptr_result_bytebuffer_(*pLength) byte** ppData,
+	_Out_ UINT32* pLength)
+{
+	*ppData = nullptr;
+	*pLength = 0;
+
+	ComPtr<ABI::Windows::Storage::Streams::IBuffer> spBuffer(pBuffer);
+	ComPtr<Windows::Storage::Streams::IBufferByteAccess> spBytes;
+	IFR(spBuffer.As(&spBytes));
+	IFR(spBuffer->get_Length(pLength));
+
+	return spBytes->Buffer(ppData);
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerBackend::FetchSegment(const SEGMENT_KEY& key, const std::function<bool()>& fnIsCancelled, SegmentData* pData)
+{
+	NULL_CHK(pData);
+
+	pData->reset();
+
+	std::shared_ptr<CSegmentCache> spSegmentCache;
+	{
+		std::lock_guard<std::mutex> lock(m_segmentCacheMutex);
+		spSegmentCache = m_spSegmentCache;
+	}
+
+	if (spSegmentCache)
+	{
+		std::shared_ptr<CMappedSegment> spSegment;
+		if (spSegmentCache->Lookup(key, std::wstring(), &spSegment) == S_OK)
+		{
+			*pData = std::make_shared<std::vector<BYTE>>(spSegment->GetData(), spSegment->GetData() + spSegment->GetSize());
+			return S_OK;
+		}
+	}
+
+	ComPtr<ABI::Windows::Storage::Streams::IBuffer> spBuffer;
+	std::wstring etag;
+	IFR(DownloadSegment(key.uri.c_str(), key.rangeOffset, key.rangeLength, &spBuffer, &etag, fnIsCancelled));
+
+	byte* pBytes = nullptr;
+	UINT32 length = 0;
+	IFR(GetBufferBytes(spBuffer.Get(), &pBytes, &length));
+
+	*pData = std::make_shared<std::vector<BYTE>>(pBytes, pBytes + length);
+
+	if (spSegmentCache && length > 0)
+	{
+		HRESULT hrStore = spSegmentCache->Store(key, etag, pBytes, length);
+		if (FAILED(hrStore) && hrStore != E_ILLEGAL_METHOD_CALL)
+			Log(Log_Level_Warning, L"Storing a segment in the cache failed - hr=%08x", hrStore);
+	}
+
+	return S_OK;
+}
+
+static HRESULT ParseManifestBuffer(
+	_In_ ABI::Windows::Storage::Streams::IBuffer* pBuffer,
+	_In_ const std::wstring& manifestUri,
+	_Out_ MANIFEST* pManifest)
+{
+	byte* pBytes = nullptr;
+	UINT32 length = 0;
+	IFR(GetBufferBytes(pBuffer, &pBytes, &length));
+
+	return ParseManifest(pBytes, length, manifestUri, pManifest);
+}
+
+// decoder profiles probed, profile 0 stands for every profile of the codec up to the bit depth
+static const struct
+{
+	const GUID* pProfile;
+	DXGI_FORMAT format;
+	VideoCodec codec;
+	UINT32 bitDepth;
+} c_decoderProbes[] =
+{
+	{ &D3D11_DECODER_PROFILE_H264_VLD_NOFGT, DXGI_FORMAT_NV12, VideoCodec::VideoCodec_H264, 8 },
+	{ &D3D11_DECODER_PROFILE_HEVC_VLD_MAIN, DXGI_FORMAT_NV12, VideoCodec::VideoCodec_HEVC, 8 },
+	{ &D3D11_DECODER_PROFILE_HEVC_VLD_MAIN10, DXGI_FORMAT_P010, VideoCodec::VideoCodec_HEVC, 10 },
+	{ &D3D11_DECODER_PROFILE_VP9_VLD_PROFILE0, DXGI_FORMAT_NV12, VideoCodec::VideoCodec_VP9, 8 },
+	{ &D3D11_DECODER_PROFILE_VP9_VLD_10BIT_PROFILE2, DXGI_FORMAT_P010, VideoCodec::VideoCodec_VP9, 10 },
+	{ &D3D11_DECODER_PROFILE_AV1_VLD_PROFILE0, DXGI_FORMAT_NV12, VideoCodec::VideoCodec_AV1, 8 },
+	{ &D3D11_DECODER_PROFILE_AV1_VLD_PROFILE0, DXGI_FORMAT_P010, VideoCodec::VideoCodec_AV1, 10 },
+};
+
+// largest first, the first size a decoder reports configurations for is its maximum
+static const struct
+{
+	UINT32 width;
+	UINT32 height;
+} c_decoderProbeSizes[] =
+{
+	{ 7680u, 4320u },
+	{ 4096u, 2304u },
+	{ 3840u, 2160u },
+	{ 2560u, 1440u },
+	{ 1920u, 1088u },
+	{ 1280u, 720u },
+};
+
+static bool HasDecoderProfile(_In_ ID3D11VideoDevice* pVideoDevice, _In_ const GUID& profile)
+{
+	UINT profileCount = pVideoDevice->GetVideoDecoderProfileCount();
+	for (UINT i = 0; i < profileCount; i++)
+	{
+		GUID decoderProfile = {};
+		if (SUCCEEDED(pVideoDevice->GetVideoDecoderProfile(i, &decoderProfile)) && decoderProfile == profile)
+			return true;
+	}
+
+	return false;
+}
+
+// D3D11 reports no frame rate limits, maxFrameRate stays 0
+static void ProbeDecoderCapabilities(_In_ ID3D11Device* pMediaDevice, _Inout_ CDecoderCapabilities* pCapabilities)
+{
+	ComPtr<ID3D11VideoDevice> spVideoDevice;
+	if (FAILED(pMediaDevice->QueryInterface(IID_PPV_ARGS(&spVideoDevice))))
+		return;
+
+	for (const auto& probe : c_decoderProbes)
+	{
+		BOOL formatSupported = FALSE;
+		if (!HasDecoderProfile(spVideoDevice.Get(), *probe.pProfile) ||
+			FAILED(spVideoDevice->CheckVideoDecoderFormat(probe.pProfile, probe.format, &formatSupported)) || !formatSupported)
+		{
+			continue;
+		}
+
+		for (const auto& size : c_decoderProbeSizes)
+		{
+			D3D11_VIDEO_DECODER_DESC desc = {};
+			desc.Guid = *probe.pProfile;
+			desc.SampleWidth = size.width;
+			desc.SampleHeight = size.height;
+			desc.OutputFormat = probe.format;
+
+			UINT configCount = 0;
+			if (SUCCEEDED(spVideoDevice->GetVideoDecoderConfigCount(&desc, &configCount)) && configCount > 0)
+			{
+				DECODER_CAPABILITY capability = { probe.codec, 0, probe.bitDepth, size.width, size.height, 0 };
+				pCapabilities->Add(capability);
+				break;
+			}
+		}
+	}
+}
+
+// one file per adapter under the temp folder of the app, it outlives the process but not a cleanup
+static std::wstring GetDecoderCapabilitiesPath(_In_ const DXGI_ADAPTER_DESC& adapterDesc)
+{
+	WCHAR tempPath[MAX_PATH + 1] = {};
+	DWORD length = GetTempPathW(ARRAYSIZE(tempPath), tempPath);
+	if (length == 0 || length > MAX_PATH)
+		return std::wstring();
+
+	std::wstring directory = std::wstring(tempPath) + L"MediaPlayback";
+	if (FAILED(CreateDirectoryIfMissing(directory)))
+		return std::wstring();
+
+	WCHAR fileName[64] = {};
+	if (FAILED(StringCchPrintfW(fileName, ARRAYSIZE(fileName), L"\\decoders-%04x-%04x-%08x.txt",
+		adapterDesc.VendorId, adapterDesc.DeviceId, adapterDesc.SubSysId)))
+	{
+		return std::wstring();
+	}
+
+	return directory + fileName;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerBackend::GetDecoderCapabilities(IDXGIAdapter* pAdapter, ID3D11Device* pMediaDevice, CDecoderCapabilities* pCapabilities)
+{
+	NULL_CHK(pAdapter);
+	NULL_CHK(pMediaDevice);
+	NULL_CHK(pCapabilities);
+
+	DXGI_ADAPTER_DESC adapterDesc = {};
+	IFR(pAdapter->GetDesc(&adapterDesc));
+
+	// a driver update can change what the decoders handle, the user mode driver version is part of the key
+	LARGE_INTEGER driverVersion = {};
+	pAdapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion);
+
+	WCHAR driverKey[80] = {};
+	IFR(StringCchPrintfW(driverKey, ARRAYSIZE(driverKey), L"%04x:%04x:%08x:%02x %u.%u.%u.%u",
+		adapterDesc.VendorId, adapterDesc.DeviceId, adapterDesc.SubSysId, adapterDesc.Revision,
+		HIWORD(driverVersion.HighPart), LOWORD(driverVersion.HighPart), HIWORD(driverVersion.LowPart), LOWORD(driverVersion.LowPart)));
+
+	std::lock_guard<std::mutex> lock(m_decoderCapabilitiesMutex);
+
+	auto it = m_decoderCapabilityProfiles.find(driverKey);
+	if (it == m_decoderCapabilityProfiles.end())
+	{
+		CDecoderCapabilities capabilities;
+
+		std::wstring path = GetDecoderCapabilitiesPath(adapterDesc);
+		if (path.empty() || capabilities.Load(path, driverKey) != S_OK)
+		{
+			ProbeDecoderCapabilities(pMediaDevice, &capabilities);
+
+			HRESULT hrSave = path.empty() ? S_FALSE : capabilities.Save(path, driverKey);
+			if (FAILED(hrSave))
+				Log(Log_Level_Warning, L"Saving the decoder capabilities failed - hr=%08x", hrSave);
+		}
+
+		it = m_decoderCapabilityProfiles.insert(std::make_pair(std::wstring(driverKey), capabilities)).first;
+	}
+
+	*pCapabilities = it->second;
+
+	return S_OK;
+}
+
+// static method the plugin core calls when the plugin is being unloaded
+void CMediaPlayerBackend::ShutdownSegmentCache()
+{
+	std::shared_ptr<CSegmentCache> spSegmentCache;
+	CWorkerPool* pSegmentWorkers = nullptr;
+
+	{
+		std::lock_guard<std::mutex> lock(m_segmentCacheMutex);
+		std::swap(spSegmentCache, m_spSegmentCache);
+		std::swap(pSegmentWorkers, m_pSegmentWorkers);
+	}
+
+	if (spSegmentCache)
+		spSegmentCache->Close();
+
+	if (pSegmentWorkers != nullptr)
+	{
+		pSegmentWorkers->Shutdown();
+		delete pSegmentWorkers;
+	}
+}
+
+_Use_decl_annotations_
+void CMediaPlayerBackend::GetMediaDeviceStats(MEDIA_DEVICE_STATS* pStats)
+{
+	m_mediaDevices.GetStats(pStats);
+}
+
+static DXGI_FORMAT GetDxgiFormat(FrameFormat frameFormat)
+{
+	switch (frameFormat)
+	{
+	case FrameFormat::FrameFormat_NV12:
+		return DXGI_FORMAT_NV12;
+	case FrameFormat::FrameFormat_P010:
+		return DXGI_FORMAT_P010;
+	default:
+		return DXGI_FORMAT_B8G8R8A8_UNORM;
+	}
+}
+
+// Views of the luma and chroma planes of a native format texture; the chroma view is DXGI_FORMAT_UNKNOWN for RGB
+static void GetPlaneViewFormats(DXGI_FORMAT format, DXGI_FORMAT* pLumaFormat, DXGI_FORMAT* pChromaFormat)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_NV12:
+		*pLumaFormat = DXGI_FORMAT_R8_UNORM;
+		*pChromaFormat = DXGI_FORMAT_R8G8_UNORM;
+		break;
+	case DXGI_FORMAT_P010:
+		*pLumaFormat = DXGI_FORMAT_R16_UNORM;
+		*pChromaFormat = DXGI_FORMAT_R16G16_UNORM;
+		break;
+	default:
+		*pLumaFormat = format;
+		*pChromaFormat = DXGI_FORMAT_UNKNOWN;
+		break;
+	}
+}
+
+static bool IsFormatSupported(ID3D11Device* pDevice, DXGI_FORMAT format, UINT requiredSupport)
+{
+	UINT support = 0;
+	return SUCCEEDED(pDevice->CheckFormatSupport(format, &support)) && (support & requiredSupport) == requiredSupport;
+}
+
+// Unity samples the planes, the video processor of the media device renders into the frame slots
+static FRAME_FORMAT_SUPPORT GetFrameFormatSupport(ID3D11Device* pD3DDevice, ID3D11Device* pMediaDevice)
+{
+	const UINT unitySupport = D3D11_FORMAT_SUPPORT_TEXTURE2D | D3D11_FORMAT_SUPPORT_SHADER_SAMPLE | D3D11_FORMAT_SUPPORT_RENDER_TARGET;
+	const UINT mediaSupport = D3D11_FORMAT_SUPPORT_TEXTURE2D | D3D11_FORMAT_SUPPORT_RENDER_TARGET;
+
+	FRAME_FORMAT_SUPPORT support;
+	support.nv12 = IsFormatSupported(pD3DDevice, DXGI_FORMAT_NV12, unitySupport) && IsFormatSupported(pMediaDevice, DXGI_FORMAT_NV12, mediaSupport);
+	support.p010 = IsFormatSupported(pD3DDevice, DXGI_FORMAT_P010, unitySupport) && IsFormatSupported(pMediaDevice, DXGI_FORMAT_P010, mediaSupport);
+
+	return support;
+}
+
+// next to the decoder capabilities under the temp folder of the app, named after a hash of the source and layout
+static std::wstring GetThumbnailAtlasPath(_In_ const std::wstring& sourceKey)
+{
+	WCHAR tempPath[MAX_PATH + 1] = {};
+	DWORD length = GetTempPathW(ARRAYSIZE(tempPath), tempPath);
+	if (length == 0 || length > MAX_PATH)
+		return std::wstring();
+
+	std::wstring directory = std::wstring(tempPath) + L"MediaPlayback";
+	if (FAILED(CreateDirectoryIfMissing(directory)))
+		return std::wstring();
+
+	// the key is in the file too, a hash collision only costs an extraction
+	WCHAR fileName[64] = {};
+	if (FAILED(StringCchPrintfW(fileName, ARRAYSIZE(fileName), L"\\thumbnails-%016llx.atlas",
+		(unsigned long long)std::hash<std::wstring>()(sourceKey))))
+	{
+		return std::wstring();
+	}
+
+	return directory + fileName;
+}
+
+// Frames of stereoscopic video are over/under in flat textures and one slice per eye in texture arrays.
+// Array slots only save the eye textures: Unity takes a single Texture2D view (the shaders sample over/under) and
+// a slot is reused while Unity samples the frame texture, so the slices are still copied like mono frames are.
+static void CopyFrameTexture(
+	_In_ ID3D11DeviceContext* pContext,
+	_In_ ID3D11Texture2D* pDestination,
+	_In_ bool isDestinationArray,
+	_In_ ID3D11Texture2D* pSource,
+	_In_ bool isSourceArray)
+{
+	if (isDestinationArray == isSourceArray)
+	{
+		pContext->CopyResource(pDestination, pSource);
+		return;
+	}
+
+	// the slices are one eye high
+	D3D11_TEXTURE2D_DESC arrayDesc = { 0 };
+	(isSourceArray ? pSource : pDestination)->GetDesc(&arrayDesc);
+
+	for (UINT eye = 0; eye < 2; eye++)
+	{
+		if (isSourceArray)
+		{
+			// eye slices go to the halves of the frame texture (we force over/under layout)
+			pContext->CopySubresourceRegion(pDestination, 0, 0, eye * arrayDesc.Height, 0, pSource, D3D11CalcSubresource(0, eye, 1), nullptr);
+		}
+		else
+		{
+			D3D11_BOX eyeBox = { 0, eye * arrayDesc.Height, 0, arrayDesc.Width, (eye + 1) * arrayDesc.Height, 1 };
+			pContext->CopySubresourceRegion(pDestination, D3D11CalcSubresource(0, eye, 1), 0, 0, 0, pSource, 0, &eyeBox);
+		}
+	}
+}
+
+
+_Use_decl_annotations_
+CD3D11PlaybackSurface::CD3D11PlaybackSurface(FrameFormat format, UINT32 deviceGeneration)
+	: m_usage(SurfaceUsage::SurfaceUsage_Presented)
+	, m_format(format)
+	, m_isStereoscopic(false)
+	, m_isStereoArray(false)
+	, m_deviceGeneration(deviceGeneration)
+	, m_hasFrame(false)
+{
+	ZeroMemory(&m_textureDesc, sizeof(m_textureDesc));
+}
+
+CD3D11PlaybackSurface::~CD3D11PlaybackSurface()
+{
+}
+
+_Use_decl_annotations_
+HRESULT CD3D11PlaybackSurface::Initialize(const PLAYBACK_SURFACE_DESC& desc, ID3D11Device* pD3DDevice, ID3D11Device* pMediaDevice, bool isStereoArray)
+{
+	NULL_CHK(pD3DDevice);
+	NULL_CHK(pMediaDevice);
+
+	m_usage = desc.usage;
+	m_isStereoscopic = desc.isStereoscopic;
+	m_isStereoArray = desc.isStereoscopic && isStereoArray;
+
+	FRAME_LAYOUT layout;
+	IFR(GetFrameLayout(m_format, desc.width, desc.height, &layout));
+
+	// create the video texture description based on texture format
+	m_textureDesc = CD3D11_TEXTURE2D_DESC(GetDxgiFormat(m_format), layout.allocatedWidth, layout.allocatedHeight);
+	m_textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+	m_textureDesc.MipLevels = 1;
+	m_textureDesc.ArraySize = 1;
+	m_textureDesc.SampleDesc = { 1, 0 };
+	m_textureDesc.CPUAccessFlags = 0;
+	m_textureDesc.MiscFlags = D3D11_RESOURCE_MISC_SHARED;
+	m_textureDesc.Usage = D3D11_USAGE_DEFAULT;
+
+	// a frame cache entry is a single slot, nothing samples it
+	if (m_usage == SurfaceUsage::SurfaceUsage_Copy)
+		return CreateFrameSlot(pD3DDevice, pMediaDevice, &m_frame);
+
+	// the texture Unity samples is only written by the render thread, so it does not need to be shared
+	CD3D11_TEXTURE2D_DESC primaryTextureDesc = m_textureDesc;
+	primaryTextureDesc.MiscFlags = 0;
+
+	IFR(pD3DDevice->CreateTexture2D(&primaryTextureDesc, nullptr, m_primaryTexture.ReleaseAndGetAddressOf()));
+
+	// native formats are sampled through one view per plane
+	DXGI_FORMAT lumaFormat = DXGI_FORMAT_UNKNOWN;
+	DXGI_FORMAT chromaFormat = DXGI_FORMAT_UNKNOWN;
+	GetPlaneViewFormats(primaryTextureDesc.Format, &lumaFormat, &chromaFormat);
+
+	auto srvDesc = CD3D11_SHADER_RESOURCE_VIEW_DESC(m_primaryTexture.Get(), D3D11_SRV_DIMENSION_TEXTURE2D, lumaFormat);
+	IFR(pD3DDevice->CreateShaderResourceView(m_primaryTexture.Get(), &srvDesc, m_primaryTextureSRV.ReleaseAndGetAddressOf()));
+
+	if (chromaFormat != DXGI_FORMAT_UNKNOWN)
+	{
+		auto chromaSrvDesc = CD3D11_SHADER_RESOURCE_VIEW_DESC(m_primaryTexture.Get(), D3D11_SRV_DIMENSION_TEXTURE2D, chromaFormat);
+		IFR(pD3DDevice->CreateShaderResourceView(m_primaryTexture.Get(), &chromaSrvDesc, m_chromaTextureSRV.ReleaseAndGetAddressOf()));
+	}
+
+	m_frameQueue.Reset();
+	for (UINT32 i = 0; i < m_frameQueue.GetCapacity(); i++)
+	{
+		IFR(CreateFrameSlot(pD3DDevice, pMediaDevice, &m_frameQueue.GetSlot(i)));
+	}
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CD3D11PlaybackSurface::CreateFrameSlot(ID3D11Device* pD3DDevice, ID3D11Device* pMediaDevice, VIDEO_FRAME_SLOT* pSlot)
+{
+	NULL_CHK(pSlot);
+
+	// a stereo array slot has one natural height slice per eye instead of the over/under layout
+	CD3D11_TEXTURE2D_DESC slotDesc = m_textureDesc;
+	if (m_isStereoArray)
+	{
+		slotDesc.Height /= 2;
+		slotDesc.ArraySize = 2;
+	}
+
+	// create the slot texture on unity device
+	ComPtr<ID3D11Texture2D> spTexture;
+	IFR(pD3DDevice->CreateTexture2D(&slotDesc, nullptr, spTexture.ReleaseAndGetAddressOf()));
+
+	// open it on the media device, so MediaPlayer can render frames into it
+	ComPtr<IDXGIResource1> spDXGIResource;
+	IFR(spTexture.As(&spDXGIResource));
+
+	HANDLE sharedHandle = INVALID_HANDLE_VALUE;
+	IFR(spDXGIResource->GetSharedHandle(&sharedHandle));
+
+	ComPtr<ID3D11Device1> spMediaDevice;
+	IFR(ComPtr<ID3D11Device>(pMediaDevice).As(&spMediaDevice));
+
+	ComPtr<ID3D11Texture2D> spMediaTexture;
+	IFR(spMediaDevice->OpenSharedResource(sharedHandle, IID_PPV_ARGS(&spMediaTexture)));
+
+	if (m_isStereoArray)
+	{
+		ComPtr<IDirect3DSurface> spLeftEyeSurface;
+		IFR(GetSurfaceFromTextureSubresource(spMediaTexture.Get(), D3D11CalcSubresource(0, 0, 1), &spLeftEyeSurface));
+
+		ComPtr<IDirect3DSurface> spRightEyeSurface;
+		IFR(GetSurfaceFromTextureSubresource(spMediaTexture.Get(), D3D11CalcSubresource(0, 1, 1), &spRightEyeSurface));
+
+		pSlot->leftEyeSurface.Attach(spLeftEyeSurface.Detach());
+		pSlot->rightEyeSurface.Attach(spRightEyeSurface.Detach());
+	}
+	else
+	{
+		ComPtr<IDirect3DSurface> spMediaSurface;
+		IFR(GetSurfaceFromTexture(spMediaTexture.Get(), &spMediaSurface));
+
+		pSlot->mediaSurface.Attach(spMediaSurface.Detach());
+	}
+
+	pSlot->texture.Attach(spTexture.Detach());
+	pSlot->mediaTexture.Attach(spMediaTexture.Detach());
+
+	return S_OK;
+}
+
+VIDEO_FRAME_SLOT* CD3D11PlaybackSurface::BeginWrite()
+{
+	if (m_usage == SurfaceUsage::SurfaceUsage_Copy)
+		return &m_frame;
+
+	return m_frameQueue.BeginWrite();
+}
+
+void CD3D11PlaybackSurface::Publish()
+{
+	if (m_usage == SurfaceUsage::SurfaceUsage_Copy)
+		m_hasFrame = true;
+	else
+		m_frameQueue.Publish();
+}
+
+const VIDEO_FRAME_SLOT* CD3D11PlaybackSurface::GetFrame()
+{
+	if (m_usage == SurfaceUsage::SurfaceUsage_Copy)
+		return m_hasFrame ? &m_frame : nullptr;
+
+	return m_frameQueue.GetLastPublished();
+}
+
+_Use_decl_annotations_
+HRESULT CD3D11PlaybackSurface::GetEyeTextures(
+	ID3D11Device* pMediaDevice,
+	ID3D11Texture2D** ppLeftEyeTexture,
+	IDirect3DSurface** ppLeftEyeSurface,
+	ID3D11Texture2D** ppRightEyeTexture,
+	IDirect3DSurface** ppRightEyeSurface)
+{
+	NULL_CHK(pMediaDevice);
+
+	// We always render them as over/under, so height must be 2 times less
+	if (!m_leftEyeSurface || !m_rightEyeSurface)
+	{
+		CD3D11_TEXTURE2D_DESC eyeTextureDesc = m_textureDesc;
+		eyeTextureDesc.MiscFlags = 0;
+		eyeTextureDesc.Height /= 2;
+
+		IFR(pMediaDevice->CreateTexture2D(&eyeTextureDesc, nullptr, m_leftEyeTexture.ReleaseAndGetAddressOf()));
+		IFR(GetSurfaceFromTexture(m_leftEyeTexture.Get(), m_leftEyeSurface.ReleaseAndGetAddressOf()));
+
+		IFR(pMediaDevice->CreateTexture2D(&eyeTextureDesc, nullptr, m_rightEyeTexture.ReleaseAndGetAddressOf()));
+		IFR(GetSurfaceFromTexture(m_rightEyeTexture.Get(), m_rightEyeSurface.ReleaseAndGetAddressOf()));
+	}
+
+	IFR(m_leftEyeTexture.CopyTo(ppLeftEyeTexture));
+	IFR(m_leftEyeSurface.CopyTo(ppLeftEyeSurface));
+	IFR(m_rightEyeTexture.CopyTo(ppRightEyeTexture));
+
+	return m_rightEyeSurface.CopyTo(ppRightEyeSurface);
+}
+
+// Called on the render thread: picks up the latest decoded frame, if there is a new one
+void CD3D11PlaybackSurface::Present()
+{
+	if (!m_primaryTexture)
+		return;
+
+	bool isNewFrame = false;
+	const VIDEO_FRAME_SLOT* pSlot = m_frameQueue.AcquireLatest(&isNewFrame);
+
+	if (pSlot == nullptr || !isNewFrame || !pSlot->texture)
+		return;
+
+	ComPtr<ID3D11Device> spDevice;
+	m_primaryTexture->GetDevice(&spDevice);
+
+	ComPtr<ID3D11DeviceContext> context;
+	spDevice->GetImmediateContext(&context);
+
+	if (!context)
+		return;
+
+	CopyFrameTexture(context.Get(), m_primaryTexture.Get(), false, pSlot->texture.Get(), m_isStereoArray);
+}
+
+_Use_decl_annotations_
+void CD3D11PlaybackSurface::GetFrameQueueStats(FRAME_QUEUE_STATS* pStats)
+{
+	m_frameQueue.GetStats(pStats);
+}
+
+
+CMediaPlayerBackend::CMediaPlayerBackend()
+	: m_pUnityGraphics(nullptr)
+	, m_hMediaDevice(nullptr)
+	, m_stereoArrayUnsupported(false)
+	, m_prefetchLookAhead(0)
+	, m_prefetchMaxInFlight(0)
+	, m_abrPolicy(AbrPolicy::AbrPolicy_System)
+{
+}
+
+CMediaPlayerBackend::~CMediaPlayerBackend()
+{
+	std::lock_guard<std::mutex> lock(m_deviceLock);
+
+	ReleaseDevices();
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerBackend::DeviceReady(IUnityGraphicsD3D11* pUnityGraphics)
+{
+	Log(Log_Level_Info, L"CMediaPlayerBackend::DeviceReady()");
+
+	NULL_CHK(pUnityGraphics);
+
+	// ref count passed in device
+	ComPtr<ID3D11Device> spDevice(pUnityGraphics->GetDevice());
+	NULL_CHK_HR(spDevice.Get(), E_UNEXPECTED);
+
+	// make sure creation of the device is on the same adapter
+	ComPtr<IDXGIDevice> spDXGIDevice;
+	IFR(spDevice.As(&spDXGIDevice));
+
+	ComPtr<IDXGIAdapter> spAdapter;
+	IFR(spDXGIDevice->GetAdapter(&spAdapter));
+
+	DXGI_ADAPTER_DESC adapterDesc = {};
+	IFR(spAdapter->GetDesc(&adapterDesc));
+
+	// dx device for media pipeline, created and associated with the dxgi device manager by the first player on
+	// the adapter; acquired before the previous one is released so a device this backend holds alone is not recreated
+	std::shared_ptr<IMediaDevice> spSharedMediaDevice;
+	IFR(m_mediaDevices.Acquire(GetAdapterId(adapterDesc.AdapterLuid), &spSharedMediaDevice));
+
+	CD3D11MediaDevice* pSharedMediaDevice = static_cast<CD3D11MediaDevice*>(spSharedMediaDevice.get());
+
+	// check which video the GPU decodes in hardware, no capabilities means no hardware decoding at all
+	CDecoderCapabilities decoderCapabilities;
+	LOG_RESULT(GetDecoderCapabilities(spAdapter.Get(), pSharedMediaDevice->GetDevice(), &decoderCapabilities));
+
+	{
+		std::lock_guard<std::mutex> lock(m_capabilitiesLock);
+		m_decoderCapabilities = decoderCapabilities;
+	}
+
+	std::lock_guard<std::mutex> lock(m_deviceLock);
+
+	ReleaseDevices();
+
+	m_pUnityGraphics = pUnityGraphics;
+	m_d3dDevice = spDevice;
+	m_mediaDevice = pSharedMediaDevice->GetDevice();
+	m_spSharedMediaDevice = spSharedMediaDevice;
+
+	// the frame threads lock the device through the manager of its adapter
+	HANDLE hMediaDevice = nullptr;
+	IFR(pSharedMediaDevice->GetDeviceManager()->OpenDeviceHandle(&hMediaDevice));
+	m_spDeviceManager = pSharedMediaDevice->GetDeviceManager();
+	m_hMediaDevice = hMediaDevice;
+
+	return S_OK;
+}
+
+void CMediaPlayerBackend::DeviceShutdown()
+{
+	Log(Log_Level_Info, L"CMediaPlayerBackend::DeviceShutdown()");
+
+	// surfaces of Unity's device are neither rendered to nor presented any more, whichever backend created them
+	m_deviceGeneration++;
+
+	std::lock_guard<std::mutex> lock(m_deviceLock);
+
+	ReleaseDevices();
+
+	m_pUnityGraphics = nullptr;
+}
+
+// m_deviceLock must be held
+void CMediaPlayerBackend::ReleaseDevices()
+{
+	m_mediaDevice.Reset();
+
+	// the shared media device goes with the last player on the adapter
+	CloseMediaDeviceHandle();
+	m_mediaDevices.Release(m_spSharedMediaDevice);
+	m_spSharedMediaDevice = nullptr;
+
+	m_d3dDevice.Reset();
+}
+
+void CMediaPlayerBackend::CloseMediaDeviceHandle()
+{
+	if (m_spDeviceManager != nullptr && m_hMediaDevice != nullptr)
+	{
+		LOG_RESULT(m_spDeviceManager->CloseDeviceHandle(m_hMediaDevice));
+	}
+
+	m_hMediaDevice = nullptr;
+	m_spDeviceManager = nullptr;
+}
+
+_Use_decl_annotations_
+void CMediaPlayerBackend::Present(IPlaybackSurface* pSurface)
+{
+	CD3D11PlaybackSurface* pD3D11Surface = dynamic_cast<CD3D11PlaybackSurface*>(pSurface);
+	if (pD3D11Surface == nullptr || pD3D11Surface->GetDeviceGeneration() != m_deviceGeneration)
+		return;
+
+	pD3D11Surface->Present();
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerBackend::RunOnMediaDevice(const std::function<HRESULT(ID3D11Device*, ID3D11DeviceContext*)>& fnRender)
+{
+	std::lock_guard<std::mutex> lock(m_deviceLock);
+
+	// the media device is shared by the players on the adapter
+	CMediaDeviceLock deviceLock(m_spDeviceManager.Get(), m_hMediaDevice);
+	IFR(deviceLock.GetResult());
+
+	ComPtr<ID3D11DeviceContext> context;
+	deviceLock.GetDevice()->GetImmediateContext(&context);
+	NULL_CHK_HR(context.Get(), E_UNEXPECTED);
+
+	HRESULT hr = fnRender(deviceLock.GetDevice(), context.Get());
+
+	// the slot is read on Unity's device, make sure the media device has submitted the frame before publishing it
+	context->Flush();
+
+	return hr;
+}
+
+std::vector<std::shared_ptr<CMediaPlayerSession>> CMediaPlayerBackend::GetSessions()
+{
+	std::lock_guard<std::mutex> lock(m_sessionsLock);
+
+	std::vector<std::shared_ptr<CMediaPlayerSession>> sessions;
+	for (auto it = m_sessions.begin(); it != m_sessions.end();)
+	{
+		std::shared_ptr<CMediaPlayerSession> spSession = it->lock();
+		if (!spSession)
+		{
+			it = m_sessions.erase(it);
+			continue;
+		}
+
+		sessions.push_back(spSession);
+		++it;
+	}
+
+	return sessions;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerBackend::SetSegmentPrefetch(INT64 lookAhead, UINT32 maxInFlight)
+{
+	if (lookAhead < 0)
+		return E_INVALIDARG;
+
+	{
+		std::lock_guard<std::mutex> lock(m_sessionsLock);
+		m_prefetchLookAhead = lookAhead;
+		m_prefetchMaxInFlight = maxInFlight;
+	}
+
+	for (auto& spSession : GetSessions())
+	{
+		spSession->SetSegmentPrefetch(lookAhead, maxInFlight);
+	}
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+void CMediaPlayerBackend::GetSegmentPrefetch(INT64* pLookAhead, UINT32* pMaxInFlight)
+{
+	std::lock_guard<std::mutex> lock(m_sessionsLock);
+
+	*pLookAhead = m_prefetchLookAhead;
+	*pMaxInFlight = m_prefetchMaxInFlight;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerBackend::GetSegmentPrefetchStats(SEGMENT_PREFETCH_STATS* pStats)
+{
+	NULL_CHK(pStats);
+
+	ZeroMemory(pStats, sizeof(SEGMENT_PREFETCH_STATS));
+
+	HRESULT hr = S_FALSE;
+	for (auto& spSession : GetSessions())
+	{
+		SEGMENT_PREFETCH_STATS stats;
+		if (spSession->GetSegmentPrefetchStats(&stats) != S_OK)
+			continue;
+
+		pStats->bufferAhead = std::max(pStats->bufferAhead, stats.bufferAhead);
+		pStats->inFlight += stats.inFlight;
+		pStats->readySegments += stats.readySegments;
+		pStats->readyBytes += stats.readyBytes;
+		pStats->hits += stats.hits;
+		pStats->joins += stats.joins;
+		pStats->misses += stats.misses;
+		pStats->bytesFetched += stats.bytesFetched;
+		pStats->bytesWasted += stats.bytesWasted;
+
+		hr = S_OK;
+	}
+
+	return hr;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerBackend::SetAbrPolicy(AbrPolicy policy)
+{
+	if (policy > AbrPolicy::AbrPolicy_Hybrid)
+		return E_INVALIDARG;
+
+	m_abrPolicy = policy;
+
+	HRESULT hr = S_OK;
+	for (auto& spSession : GetSessions())
+	{
+		HRESULT hrSession = spSession->SetAbrPolicy(policy);
+		if (SUCCEEDED(hr))
+			hr = hrSession;
+	}
+
+	return hr;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerBackend::CreateSession(IPlaybackSessionSink* pSink, std::shared_ptr<IPlaybackSession>* ppSession)
+{
+	NULL_CHK(pSink);
+	NULL_CHK(ppSession);
+
+	ppSession->reset();
+
+	std::shared_ptr<CMediaPlayerSession> spSession = std::make_shared<CMediaPlayerSession>(GetSharedPtr<CMediaPlayerBackend>(), pSink);
+	IFR(spSession->Initialize());
+
+	INT64 lookAhead = 0;
+	UINT32 maxInFlight = 0;
+	GetSegmentPrefetch(&lookAhead, &maxInFlight);
+	spSession->SetSegmentPrefetch(lookAhead, maxInFlight);
+
+	{
+		std::lock_guard<std::mutex> lock(m_sessionsLock);
+		m_sessions.push_back(spSession);
+	}
+
+	*ppSession = spSession;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerBackend::CreateSurface(const PLAYBACK_SURFACE_DESC& desc, std::shared_ptr<IPlaybackSurface>* ppSurface)
+{
+	NULL_CHK(ppSurface);
+
+	ppSurface->reset();
+
+	if (desc.width == 0 || desc.height == 0)
+		return E_INVALIDARG;
+
+	std::lock_guard<std::mutex> lock(m_deviceLock);
+
+	if (!m_d3dDevice || !m_mediaDevice)
+		return E_ILLEGAL_METHOD_CALL;
+
+	auto fnCreate = [this, &desc](FrameFormat format, bool isStereoArray, std::shared_ptr<CD3D11PlaybackSurface>* pspSurface) -> HRESULT
+	{
+		std::shared_ptr<CD3D11PlaybackSurface> spSurface = std::make_shared<CD3D11PlaybackSurface>(format, m_deviceGeneration);
+		IFR(spSurface->Initialize(desc, m_d3dDevice.Get(), m_mediaDevice.Get(), isStereoArray));
+
+		*pspSurface = spSurface;
+
+		return S_OK;
+	};
+
+	FrameFormat frameFormat = SelectFrameFormat(desc.format, GetFrameFormatSupport(m_d3dDevice.Get(), m_mediaDevice.Get()), desc.isStereoscopic);
+
+	// stereoscopic video is decoded straight into the slices of texture array slots, no eye textures are needed
+	bool isStereoArray = desc.isStereoscopic && !m_stereoArrayUnsupported;
+
+	std::shared_ptr<CD3D11PlaybackSurface> spSurface;
+	HRESULT hr = fnCreate(frameFormat, isStereoArray, &spSurface);
+	if (FAILED(hr) && isStereoArray)
+	{
+		Log(Log_Level_Warning, L"CMediaPlayerBackend::CreateSurface() - stereo texture arrays are not supported (0x%08x), using eye textures", hr);
+
+		m_stereoArrayUnsupported = true;
+		isStereoArray = false;
+		hr = fnCreate(frameFormat, isStereoArray, &spSurface);
+	}
+
+	if (FAILED(hr) && IsNativeFrameFormat(frameFormat))
+	{
+		Log(Log_Level_Warning, L"CMediaPlayerBackend::CreateSurface() - native frame textures failed (0x%08x), using BGRA", hr);
+
+		frameFormat = FrameFormat::FrameFormat_BGRA32;
+		hr = fnCreate(frameFormat, isStereoArray, &spSurface);
+	}
+	IFR(hr);
+
+	*ppSurface = spSurface;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerBackend::CopySurface(IPlaybackSurface* pSource, IPlaybackSurface* pDestination)
+{
+	CD3D11PlaybackSurface* pSourceSurface = dynamic_cast<CD3D11PlaybackSurface*>(pSource);
+	NULL_CHK(pSourceSurface);
+
+	CD3D11PlaybackSurface* pDestinationSurface = dynamic_cast<CD3D11PlaybackSurface*>(pDestination);
+	NULL_CHK(pDestinationSurface);
+
+	if (pSourceSurface->GetWidth() != pDestinationSurface->GetWidth() || pSourceSurface->GetHeight() != pDestinationSurface->GetHeight() ||
+		pSourceSurface->GetFrameFormat() != pDestinationSurface->GetFrameFormat())
+	{
+		return E_INVALIDARG;
+	}
+
+	const VIDEO_FRAME_SLOT* pSourceSlot = pSourceSurface->GetFrame();
+	if (pSourceSlot == nullptr)
+		return E_ILLEGAL_METHOD_CALL;
+
+	VIDEO_FRAME_SLOT* pDestinationSlot = pDestinationSurface->BeginWrite();
+	if (pDestinationSlot == nullptr)
+		return E_PENDING;
+
+	// both are written on the media device, like the frames MediaPlayer renders
+	IFR(RunOnMediaDevice([this, pSourceSurface, pSourceSlot, pDestinationSurface, pDestinationSlot](ID3D11Device*, ID3D11DeviceContext* pContext) -> HRESULT
+	{
+		if (pSourceSurface->GetDeviceGeneration() != m_deviceGeneration || pDestinationSurface->GetDeviceGeneration() != m_deviceGeneration)
+			return E_ILLEGAL_METHOD_CALL;
+
+		CopyFrameTexture(pContext, pDestinationSlot->mediaTexture.Get(), pDestinationSurface->IsStereoArray(),
+			pSourceSlot->mediaTexture.Get(), pSourceSurface->IsStereoArray());
+
+		return S_OK;
+	}));
+
+	pDestinationSurface->Publish();
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerBackend::GetDecoderCapabilities(CDecoderCapabilities* pCapabilities)
+{
+	NULL_CHK(pCapabilities);
+
+	std::lock_guard<std::mutex> lock(m_capabilitiesLock);
+	*pCapabilities = m_decoderCapabilities;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerBackend::GetKeyframeIndex(const wchar_t* pszContentLocation, std::shared_ptr<const CKeyframeIndex>* pIndex)
+{
+	NULL_CHK(pszContentLocation);
+	NULL_CHK(pIndex);
+
+	pIndex->reset();
+
+	// streams and package files are not indexed, their seeks stay accurate
+	std::wstring path;
+	if (!GetLocalFilePath(pszContentLocation, &path))
+		return S_FALSE;
+
+	HRESULT hr = GetFileKeyframeIndex(path, pIndex);
+	if (FAILED(hr))
+		Log(Log_Level_Info, L"No keyframe index of %s - hr=%08x", path.c_str(), hr);
+
+	return hr;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerBackend::OpenThumbnailSource(const wchar_t* pszContentLocation, THUMBNAIL_SOURCE* pSource)
+{
+	NULL_CHK(pszContentLocation);
+	NULL_CHK(pSource);
+
+	// the decoder seeks to every tile time itself while the keyframe index is not built yet
+	std::wstring sourceKey = pszContentLocation;
+	std::wstring path;
+	if (GetLocalFilePath(pszContentLocation, &path))
+	{
+		// a file written again under the same name gets new thumbnails
+		CFileReader reader;
+		if (SUCCEEDED(reader.Open(path)))
+			sourceKey += L"|" + std::to_wstring(reader.GetSize()) + L"|" + std::to_wstring(reader.GetLastWriteTime());
+	}
+
+	pSource->decoder = std::make_shared<CSourceReaderThumbnailDecoder>(pszContentLocation);
+	pSource->cachePath = GetThumbnailAtlasPath(sourceKey);
+	pSource->sourceKey = sourceKey;
+
+	return S_OK;
+}
+
+void CMediaPlayerBackend::ShutdownMediaDevices()
+{
+	m_mediaDevices.Shutdown();
+}
+
+void CMediaPlayerBackend::ReadyMediaDevices()
+{
+	m_mediaDevices.Ready();
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerBackend::ServeSegmentFromCache(
+	const SEGMENT_KEY& key,
+	ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSourceDownloadResult* pResult,
+	ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSourceDownloadRequestedDeferral* pDeferral)
+{
+	ComPtr<ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSourceDownloadResult> spResult(pResult);
+	ComPtr<ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSourceDownloadRequestedDeferral> spDeferral(pDeferral);
+
+	std::lock_guard<std::mutex> lock(m_segmentCacheMutex);
+
+	if (!m_spSegmentCache || m_pSegmentWorkers == nullptr)
+	{
+		spDeferral->Complete();
+		return S_OK;
+	}
+
+	// hits are mapped straight from the cache file
+	std::shared_ptr<CMappedSegment> spSegment;
+	if (m_spSegmentCache->Lookup(key, std::wstring(), &spSegment) == S_OK)
+	{
+		ComPtr<ABI::Windows::Storage::Streams::IBuffer> spBuffer;
+		HRESULT hr = CreateBufferFromSegment(spSegment, &spBuffer);
+		if (SUCCEEDED(hr))
+			hr = spResult->put_Buffer(spBuffer.Get());
+
+		if (SUCCEEDED(hr))
+		{
+			spDeferral->Complete();
+			return S_OK;
+		}
+
+		Log(Log_Level_Warning, L"Serving a cached segment failed - hr=%08x", hr);
+	}
+
+	std::shared_ptr<CSegmentCache> spSegmentCache = m_spSegmentCache;
+
+	HRESULT hrSubmit = m_pSegmentWorkers->Submit([spSegmentCache, key, spResult, spDeferral]()
+	{
+		// abandoned once the cache is disabled, the media source then downloads the segment itself
+		auto fnIsCancelled = [spSegmentCache]()
+		{
+			std::lock_guard<std::mutex> lock(m_segmentCacheMutex);
+			return m_spSegmentCache != spSegmentCache;
+		};
+
+		ComPtr<ABI::Windows::Storage::Streams::IBuffer> spBuffer;
+		std::wstring etag;
+		HRESULT hr = DownloadSegment(key.uri.c_str(), key.rangeOffset, key.rangeLength, &spBuffer, &etag, fnIsCancelled);
+
+		if (SUCCEEDED(hr))
+		{
+			byte* pData = nullptr;
+			UINT32 length = 0;
+			if (SUCCEEDED(GetBufferBytes(spBuffer.Get(), &pData, &length)) && length > 0)
+			{
+				HRESULT hrStore = spSegmentCache->Store(key, etag, pData, length);
+				if (FAILED(hrStore) && hrStore != E_ILLEGAL_METHOD_CALL)
+					Log(Log_Level_Warning, L"Storing a segment in the cache failed - hr=%08x", hrStore);
+			}
+
+			hr = spResult->put_Buffer(spBuffer.Get());
+		}
+
+		if (FAILED(hr) && hr != HRESULT_FROM_WIN32(ERROR_CANCELLED))
+			Log(Log_Level_Warning, L"Segment download failed, leaving it to the media source - hr=%08x", hr);
+
+		spDeferral->Complete();
+	});
+
+	if (FAILED(hrSubmit))
+	{
+		spDeferral->Complete();
+		return hrSubmit;
+	}
+
+	return S_OK;
+}
+
+
+// IMediaPlaybackSession2 (SDK 17134+) reports the buffered ranges; before that only the progress of a progressive download is known
+static void GetSessionBufferedRanges(_In_ IMediaPlaybackSession* pSession, _Out_ std::vector<MEDIA_TIME_RANGE>* pRanges)
+{
+	pRanges->clear();
+
+#if WINDOWS_FOUNDATION_UNIVERSALAPICONTRACT_VERSION >= 0x60000
+	ComPtr<IMediaPlaybackSession2> spSession2;
+	ComPtr<ABI::Windows::Foundation::Collections::IVectorView<MediaTimeRange>> spRanges;
+	if (SUCCEEDED(pSession->QueryInterface(IID_PPV_ARGS(&spSession2))) &&
+		SUCCEEDED(spSession2->GetBufferedRanges(&spRanges)) && spRanges != nullptr)
+	{
+		unsigned int size = 0;
+		spRanges->get_Size(&size);
+
+		for (unsigned int i = 0; i < size && pRanges->size() < _MaxBufferedRanges_; i++)
+		{
+			MediaTimeRange range;
+			if (SUCCEEDED(spRanges->GetAt(i, &range)))
+				pRanges->push_back({ range.Start.Duration, range.End.Duration });
+		}
+
+		return;
+	}
+#endif
+
+	ABI::Windows::Foundation::TimeSpan duration = { 0 };
+	DOUBLE progress = 0;
+	if (FAILED(pSession->get_NaturalDuration(&duration)) || duration.Duration <= 0 ||
+		FAILED(pSession->get_DownloadProgress(&progress)) || progress <= 0)
+	{
+		return;
+	}
+
+	pRanges->push_back({ 0, (INT64)(duration.Duration * (progress < 1.0 ? progress : 1.0)) });
+}
+
+// adaptive renditions without sizes leave nothing to choose by, the video tracks of the item are reported then
+static bool HasRenditionSizes(_In_ const std::vector<RENDITION_INFO>& renditions)
+{
+	for (const RENDITION_INFO& rendition : renditions)
+	{
+		if (rendition.width != 0 && rendition.height != 0)
+			return true;
+	}
+
+	return false;
+}
+
+
+template <typename THandler, typename TSender, typename TArgs>
+ComPtr<THandler> CMediaPlayerSession::MakeHandler(HRESULT (CMediaPlayerSession::*pfnHandler)(TSender, TArgs))
+{
+	// WinRT keeps the handler until it is removed, it must not keep the session alive
+	std::weak_ptr<CMediaPlayerSession> wpThis = GetWeakPtr<CMediaPlayerSession>();
+
+	return Microsoft::WRL::Callback<THandler>([wpThis, pfnHandler](TSender sender, TArgs args) -> HRESULT
+	{
+		std::shared_ptr<CMediaPlayerSession> spThis = wpThis.lock();
+		if (!spThis)
+			return S_OK;
+
+		return (spThis.get()->*pfnHandler)(sender, args);
+	});
+}
+
+
+_Use_decl_annotations_
+CMediaPlayerSession::CMediaPlayerSession(const std::shared_ptr<CMediaPlayerBackend>& spBackend, IPlaybackSessionSink* pSink)
+	: m_spBackend(spBackend)
+	, m_pSink(pSink)
+	, m_bIgnoreEvents(false)
+	, m_hasSource(false)
+	, m_volume(1.0)
+	, m_selectedVideoTrack(-1)
+	, m_abrBitrateCap(0)
+	, m_abrBitrate(0)
+	, m_abrPolicy(spBackend->GetAbrPolicy())
+	, m_playingBitrate(0)
+	, m_sourceGeneration(0)
+	, m_prefetchLookAhead(0)
+	, m_prefetchMaxInFlight(0)
+{
+	m_openedEventToken.value = 0;
+	m_endedEventToken.value = 0;
+	m_failedEventToken.value = 0;
+	m_videoFrameAvailableToken.value = 0;
+	m_stateChangedEventToken.value = 0;
+	m_sizeChangedEventToken.value = 0;
+	m_durationChangedEventToken.value = 0;
+	m_positionChangedEventToken.value = 0;
+	m_bufferedRangesChangedEventToken.value = 0;
+	m_videoTracksChangedEventToken.value = 0;
+	m_timedMetadataChangedEventToken.value = 0;
+	m_downloadRequestedEventToken.value = 0;
+	m_bitrateChangedEventToken.value = 0;
+	m_downloadCompletedEventToken.value = 0;
+}
+
+CMediaPlayerSession::~CMediaPlayerSession()
+{
+	m_bIgnoreEvents = true;
+
+	ReleaseMediaPlayer();
+}
+
+HRESULT CMediaPlayerSession::Initialize()
+{
+	return CreateMediaPlayer();
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::GetMediaPlayer(IMediaPlayer** ppMediaPlayer)
+{
+	NULL_CHK(ppMediaPlayer);
+
+	*ppMediaPlayer = nullptr;
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	NULL_CHK_HR(m_mediaPlayer.Get(), E_ILLEGAL_METHOD_CALL);
+
+	return m_mediaPlayer.CopyTo(ppMediaPlayer);
+}
+
+HRESULT CMediaPlayerSession::CreateMediaPlayer()
+{
+	Log(Log_Level_Info, L"CMediaPlayerSession::CreateMediaPlayer()");
+
+	// create media player
+	ComPtr<IMediaPlayer> spMediaPlayer;
+	IFR(ActivateInstance(
+		Wrappers::HStringReference(RuntimeClass_Windows_Media_Playback_MediaPlayer).Get(),
+		&spMediaPlayer));
+
+	spMediaPlayer->put_AutoPlay(false);
+
+	// the player is recreated with every source, the loop mode and the volume carry over
+	{
+		std::lock_guard<std::mutex> lock(m_loopLock);
+		m_loopTracker.Reset();
+		spMediaPlayer->put_IsLoopingEnabled(m_loopTracker.IsEnabled());
+	}
+
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	spMediaPlayer->put_Volume(m_volume);
+
+	// setup callbacks
+	IFR(spMediaPlayer->add_MediaOpened(MakeHandler<IMediaPlayerEventHandler>(&CMediaPlayerSession::OnOpened).Get(), &m_openedEventToken));
+	IFR(spMediaPlayer->add_MediaEnded(MakeHandler<IMediaPlayerEventHandler>(&CMediaPlayerSession::OnEnded).Get(), &m_endedEventToken));
+	IFR(spMediaPlayer->add_MediaFailed(MakeHandler<IFailedEventHandler>(&CMediaPlayerSession::OnFailed).Get(), &m_failedEventToken));
+
+	// frameserver mode is on the IMediaPlayer5 interface
+	ComPtr<IMediaPlayer5> spMediaPlayer5;
+	IFR(spMediaPlayer.As(&spMediaPlayer5));
+
+	// set frameserver mode
+	IFR(spMediaPlayer5->put_IsVideoFrameServerEnabled(true));
+
+	// register for frame available callback
+	IFR(spMediaPlayer5->add_VideoFrameAvailable(MakeHandler<IMediaPlayerEventHandler>(&CMediaPlayerSession::OnVideoFrameAvailable).Get(), &m_videoFrameAvailableToken));
+
+	ComPtr<IMediaPlayer3> spMediaPlayer3;
+	IFR(spMediaPlayer.As(&spMediaPlayer3));
+
+	ComPtr<IMediaPlaybackSession> spSession;
+	IFR(spMediaPlayer3->get_PlaybackSession(&spSession));
+
+	m_mediaPlayer = spMediaPlayer;
+	m_mediaPlayer3 = spMediaPlayer3;
+	m_mediaPlayer5 = spMediaPlayer5;
+	m_mediaPlaybackSession = spSession;
+
+	return AddStateChanged();
+}
+
+void CMediaPlayerSession::ReleaseMediaPlayer()
+{
+	Log(Log_Level_Info, L"CMediaPlayerSession::ReleaseMediaPlayer()");
+
+	StopSegmentPrefetch();
+
+	ComPtr<IMediaPlayer> spMediaPlayer;
+	ComPtr<IMediaPlayer5> spMediaPlayer5;
+	ComPtr<IMediaPlaybackItem> spPlaybackItem;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		ReleaseSubtitleTracks();
+		RemoveStateChanged();
+
+		spMediaPlayer.Swap(m_mediaPlayer);
+		spMediaPlayer5.Swap(m_mediaPlayer5);
+		spPlaybackItem.Swap(m_spPlaybackItem);
+		m_mediaPlayer3.Reset();
+		m_mediaPlaybackSession.Reset();
+
+		m_videoTracks.clear();
+		m_selectedVideoTrack = -1;
+	}
+
+	ComPtr<ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSource> spAdaptiveMediaSource;
+	{
+		std::lock_guard<std::mutex> lock(m_abrLock);
+
+		spAdaptiveMediaSource.Swap(m_spAdaptiveMediaSource);
+		m_spAbrController.reset();
+		m_availableBitrates.clear();
+		m_abrBitrates.clear();
+		m_abrBitrateCap = 0;
+		m_abrBitrate = 0;
+		m_renditions.clear();
+		m_playingBitrate = 0;
+
+		// manifest reads still running are for this source
+		m_sourceGeneration++;
+	}
+
+	// WinRT is called outside the locks, the handlers being removed may be waiting for them
+	if (spAdaptiveMediaSource != nullptr)
+	{
+		LOG_RESULT(spAdaptiveMediaSource->remove_DownloadRequested(m_downloadRequestedEventToken));
+		LOG_RESULT(spAdaptiveMediaSource->remove_PlaybackBitrateChanged(m_bitrateChangedEventToken));
+		LOG_RESULT(spAdaptiveMediaSource->remove_DownloadCompleted(m_downloadCompletedEventToken));
+	}
+
+	if (spPlaybackItem != nullptr)
+	{
+		LOG_RESULT(spPlaybackItem->remove_TimedMetadataTracksChanged(m_timedMetadataChangedEventToken));
+		LOG_RESULT(spPlaybackItem->remove_VideoTracksChanged(m_videoTracksChangedEventToken));
+	}
+
+	if (spMediaPlayer5 != nullptr)
+	{
+		LOG_RESULT(spMediaPlayer5->remove_VideoFrameAvailable(m_videoFrameAvailableToken));
+	}
+
+	if (spMediaPlayer != nullptr)
+	{
+		LOG_RESULT(spMediaPlayer->remove_MediaOpened(m_openedEventToken));
+		LOG_RESULT(spMediaPlayer->remove_MediaEnded(m_endedEventToken));
+		LOG_RESULT(spMediaPlayer->remove_MediaFailed(m_failedEventToken));
+
+		// stop playback
+		ComPtr<IMediaPlayerSource2> spMediaPlayerSource;
+		spMediaPlayer.As(&spMediaPlayerSource);
+		if (spMediaPlayerSource != nullptr)
+			spMediaPlayerSource->put_Source(nullptr);
+	}
+}
+
+HRESULT CMediaPlayerSession::AddStateChanged()
+{
+	if (m_mediaPlaybackSession == nullptr)
+		return S_OK;
+
+	IFR(m_mediaPlaybackSession->add_PlaybackStateChanged(MakeHandler<IMediaPlaybackSessionEventHandler>(&CMediaPlayerSession::OnStateChanged).Get(), &m_stateChangedEventToken));
+	IFR(m_mediaPlaybackSession->add_NaturalVideoSizeChanged(MakeHandler<IMediaPlaybackSessionEventHandler>(&CMediaPlayerSession::OnSizeChanged).Get(), &m_sizeChangedEventToken));
+	IFR(m_mediaPlaybackSession->add_NaturalDurationChanged(MakeHandler<IMediaPlaybackSessionEventHandler>(&CMediaPlayerSession::OnStateChanged).Get(), &m_durationChangedEventToken));
+
+	// seeks and other discontinuities, playback itself is tracked per frame
+	IFR(m_mediaPlaybackSession->add_PositionChanged(MakeHandler<IMediaPlaybackSessionEventHandler>(&CMediaPlayerSession::OnStatusChanged).Get(), &m_positionChangedEventToken));
+
+#if WINDOWS_FOUNDATION_UNIVERSALAPICONTRACT_VERSION >= 0x60000
+	ComPtr<IMediaPlaybackSession2> spSession2;
+	if (SUCCEEDED(m_mediaPlaybackSession.As(&spSession2)))
+	{
+		LOG_RESULT(spSession2->add_BufferedRangesChanged(MakeHandler<IMediaPlaybackSessionEventHandler>(&CMediaPlayerSession::OnStatusChanged).Get(), &m_bufferedRangesChangedEventToken));
+	}
+#endif
+
+	return S_OK;
+}
+
+void CMediaPlayerSession::RemoveStateChanged()
+{
+	// remove playback session callbacks
+	if (m_mediaPlaybackSession == nullptr)
+		return;
+
+	LOG_RESULT(m_mediaPlaybackSession->remove_PlaybackStateChanged(m_stateChangedEventToken));
+	LOG_RESULT(m_mediaPlaybackSession->remove_NaturalVideoSizeChanged(m_sizeChangedEventToken));
+	LOG_RESULT(m_mediaPlaybackSession->remove_NaturalDurationChanged(m_durationChangedEventToken));
+	LOG_RESULT(m_mediaPlaybackSession->remove_PositionChanged(m_positionChangedEventToken));
+
+#if WINDOWS_FOUNDATION_UNIVERSALAPICONTRACT_VERSION >= 0x60000
+	ComPtr<IMediaPlaybackSession2> spSession2;
+	if (SUCCEEDED(m_mediaPlaybackSession.As(&spSession2)))
+	{
+		LOG_RESULT(spSession2->remove_BufferedRangesChanged(m_bufferedRangesChangedEventToken));
+	}
+#endif
+}
+
+void CMediaPlayerSession::ReleaseSubtitleTracks()
+{
+	for (size_t i = 0; i < m_subtitleTrackObjects.size(); i++)
+	{
+		LOG_RESULT(m_subtitleTrackObjects[i]->remove_CueEntered(m_cueEnteredTokens[i]));
+		LOG_RESULT(m_subtitleTrackObjects[i]->remove_CueExited(m_cueExitedTokens[i]));
+	}
+
+	m_subtitleTracks.clear();
+	m_subtitleTrackObjects.clear();
+	m_cueEnteredTokens.clear();
+	m_cueExitedTokens.clear();
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::Open(const wchar_t* pszContentLocation)
+{
+	Log(Log_Level_Info, L"CMediaPlayerSession::Open()");
+
+	NULL_CHK(pszContentLocation);
+
+	if (HasSource())
+		IFR(Close());
+
+	// create the media source for content (fromUri)
+	ComPtr<IMediaSource2> spMediaSource2;
+	HRESULT hr = CreateMediaSource(pszContentLocation, &spMediaSource2);
+	if (SUCCEEDED(hr))
+		hr = SetMediaSource(spMediaSource2.Get(), pszContentLocation);
+
+	// the adaptive source and the item set so far go with the player
+	if (FAILED(hr))
+	{
+		LOG_RESULT(Close());
+		return hr;
+	}
+
+	m_hasSource = true;
+
+	return S_OK;
+}
+
+HRESULT CMediaPlayerSession::Close()
+{
+	Log(Log_Level_Info, L"CMediaPlayerSession::Close()");
+
+	// MediaPlayer reports the source going away, the core knows already
+	m_bIgnoreEvents = true;
+
+	ReleaseMediaPlayer();
+	m_hasSource = false;
+
+	HRESULT hr = CreateMediaPlayer();
+
+	m_bIgnoreEvents = false;
+
+	return hr;
+}
+
+bool CMediaPlayerSession::HasSource() const
+{
+	return m_hasSource;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::SetMediaSource(IMediaSource2* pMediaSource, LPCWSTR pszContentLocation)
+{
+	NULL_CHK(pMediaSource);
+
+	ComPtr<IMediaPlayer> spMediaPlayer;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		spMediaPlayer = m_mediaPlayer;
+	}
+
+	NULL_CHK_HR(spMediaPlayer.Get(), E_UNEXPECTED);
+
+	ComPtr<IMediaPlayerSource2> spPlayerAsMediaPlayerSource;
+	IFR(spMediaPlayer.As(&spPlayerAsMediaPlayerSource));
+
+	ComPtr<IMediaSource2> spMediaSource2(pMediaSource);
+
+	ComPtr<ABI::Windows::Media::Core::IMediaSource4> spMediaSource4;
+	spMediaSource2.As(&spMediaSource4);
+
+	ComPtr<ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSource> spAdaptiveMediaSource;
+	if (spMediaSource4 != nullptr)
+		spMediaSource4->get_AdaptiveMediaSource(&spAdaptiveMediaSource);
+
+	if (spAdaptiveMediaSource != nullptr)
+	{
+		OutputDebugStringW(L"We have an Adaptive Streaming media source!\n");
+
+		// the core picks the initial bitrate and the hardware decoding cap out of these once the source is set
+		std::vector<UINT32> bitrates;
+		ComPtr<ABI::Windows::Foundation::Collections::IVectorView<UINT32>> spAvailableBitrates;
+		spAdaptiveMediaSource->get_AvailableBitrates(&spAvailableBitrates);
+
+		if (spAvailableBitrates != nullptr)
+		{
+			unsigned int size = 0;
+			spAvailableBitrates->get_Size(&size);
+
+			for (unsigned int i = 0; i < size; i++)
+			{
+				UINT32 uBR = 0;
+				spAvailableBitrates->GetAt(i, &uBR);
+				bitrates.push_back(uBR);
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_abrLock);
+
+			assert(m_spAdaptiveMediaSource == nullptr);
+			m_spAdaptiveMediaSource = spAdaptiveMediaSource;
+			m_availableBitrates = bitrates;
+			ResetAbrController(bitrates, 0);
+		}
+
+		IFR(spAdaptiveMediaSource->add_DownloadRequested(MakeHandler<IDownloadRequestedEventHandler>(&CMediaPlayerSession::OnDownloadRequested).Get(), &m_downloadRequestedEventToken));
+		IFR(spAdaptiveMediaSource->add_PlaybackBitrateChanged(MakeHandler<IPlaybackBitrateChangedEventHandler>(&CMediaPlayerSession::OnPlaybackBitrateChanged).Get(), &m_bitrateChangedEventToken));
+		IFR(spAdaptiveMediaSource->add_DownloadCompleted(MakeHandler<IDownloadCompletedEventHandler>(&CMediaPlayerSession::OnDownloadCompleted).Get(), &m_downloadCompletedEventToken));
+
+		// the media source downloads segments itself if prefetching can not start
+		LOG_RESULT(StartManifestRead(pszContentLocation));
+	}
+
+	ComPtr<IMediaPlaybackItem> spPlaybackItem;
+	IFR(CreateMediaPlaybackItem(spMediaSource2.Get(), &spPlaybackItem));
+
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		IFR(spPlaybackItem->add_VideoTracksChanged(MakeHandler<ITracksChangedEventHandler>(&CMediaPlayerSession::OnVideoTracksChanged).Get(), &m_videoTracksChangedEventToken));
+		IFR(spPlaybackItem->add_TimedMetadataTracksChanged(MakeHandler<ITracksChangedEventHandler>(&CMediaPlayerSession::OnTimedMetadataTracksChanged).Get(), &m_timedMetadataChangedEventToken));
+
+		m_spPlaybackItem = spPlaybackItem;
+	}
+
+	ComPtr<IMediaPlaybackSource> spMediaPlaybackSource;
+	IFR(spPlaybackItem.As(&spMediaPlaybackSource));
+
+	return spPlayerAsMediaPlayerSource->put_Source(spMediaPlaybackSource.Get());
+}
+
+HRESULT CMediaPlayerSession::Play()
+{
+	ComPtr<IMediaPlayer> spMediaPlayer;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		spMediaPlayer = m_mediaPlayer;
+	}
+
+	NULL_CHK_HR(spMediaPlayer.Get(), E_ILLEGAL_METHOD_CALL);
+
+	return spMediaPlayer->Play();
+}
+
+HRESULT CMediaPlayerSession::Pause()
+{
+	ComPtr<IMediaPlayer> spMediaPlayer;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		spMediaPlayer = m_mediaPlayer;
+	}
+
+	NULL_CHK_HR(spMediaPlayer.Get(), E_ILLEGAL_METHOD_CALL);
+
+	return spMediaPlayer->Pause();
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::Seek(LONGLONG position)
+{
+	ComPtr<IMediaPlaybackSession> spSession;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		spSession = m_mediaPlaybackSession;
+	}
+
+	NULL_CHK_HR(spSession.Get(), E_ILLEGAL_METHOD_CALL);
+
+	boolean canSeek = false;
+	IFR(spSession->get_CanSeek(&canSeek));
+	if (!canSeek)
+		return S_FALSE;
+
+	// a seek back is not a wrap of the loop
+	{
+		std::lock_guard<std::mutex> lock(m_loopLock);
+		m_loopTracker.Reset();
+	}
+
+	ABI::Windows::Foundation::TimeSpan positionTS;
+	positionTS.Duration = position;
+
+	return spSession->put_Position(positionTS);
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::SetVolume(DOUBLE volume)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	NULL_CHK_HR(m_mediaPlayer.Get(), E_ILLEGAL_METHOD_CALL);
+
+	IFR(m_mediaPlayer->put_Volume(volume));
+	m_volume = volume;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::SetPlaybackRate(DOUBLE rate)
+{
+	ComPtr<IMediaPlaybackSession> spSession;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		spSession = m_mediaPlaybackSession;
+	}
+
+	NULL_CHK_HR(spSession.Get(), E_ILLEGAL_METHOD_CALL);
+
+	return spSession->put_PlaybackRate(rate);
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::SetLoop(bool enabled, LONGLONG start, LONGLONG end)
+{
+	ComPtr<IMediaPlayer> spMediaPlayer;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		spMediaPlayer = m_mediaPlayer;
+	}
+
+	NULL_CHK_HR(spMediaPlayer.Get(), E_UNEXPECTED);
+
+	std::lock_guard<std::mutex> lock(m_loopLock);
+
+	IFR(m_loopTracker.SetLoop(enabled, start, end));
+
+	// MediaPlayer does not end a range either, whatever is left of the media after it plays and wraps
+	return spMediaPlayer->put_IsLoopingEnabled(enabled);
+}
+
+PlaybackState CMediaPlayerSession::GetPlaybackState() const
+{
+	ComPtr<IMediaPlaybackSession> spSession;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		spSession = m_mediaPlaybackSession;
+	}
+
+	MediaPlaybackState state = MediaPlaybackState::MediaPlaybackState_None;
+	if (spSession != nullptr)
+		spSession->get_PlaybackState(&state);
+
+	return static_cast<PlaybackState>(state);
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::GetDurationAndPosition(LONGLONG* duration, LONGLONG* position) const
+{
+	NULL_CHK(duration);
+	NULL_CHK(position);
+
+	ComPtr<IMediaPlaybackSession> spSession;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		spSession = m_mediaPlaybackSession;
+	}
+
+	if (spSession == nullptr || !m_hasSource)
+		return E_ILLEGAL_METHOD_CALL;
+
+	ABI::Windows::Foundation::TimeSpan durationTS = { 0 };
+	IFR(spSession->get_NaturalDuration(&durationTS));
+
+	ABI::Windows::Foundation::TimeSpan positionTS = { 0 };
+	IFR(spSession->get_Position(&positionTS));
+
+	*duration = durationTS.Duration;
+	*position = positionTS.Duration;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::GetNaturalVideoSize(UINT32* width, UINT32* height) const
+{
+	NULL_CHK(width);
+	NULL_CHK(height);
+
+	*width = 0;
+	*height = 0;
+
+	ComPtr<IMediaPlaybackSession> spSession;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		spSession = m_mediaPlaybackSession;
+	}
+
+	NULL_CHK_HR(spSession.Get(), E_ILLEGAL_METHOD_CALL);
+
+	IFR(spSession->get_NaturalVideoWidth(width));
+
+	return spSession->get_NaturalVideoHeight(height);
+}
+
+bool CMediaPlayerSession::CanSeek() const
+{
+	ComPtr<IMediaPlaybackSession> spSession;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		spSession = m_mediaPlaybackSession;
+	}
+
+	boolean canSeek = false;
+	if (spSession != nullptr)
+		spSession->get_CanSeek(&canSeek);
+
+	return canSeek != false;
+}
+
+// OnOpened switches MediaPlayer to stereo rendering for stereoscopic video, the frames are over/under then
+bool CMediaPlayerSession::IsStereoscopic() const
+{
+	ComPtr<IMediaPlayer3> spMediaPlayer3;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		spMediaPlayer3 = m_mediaPlayer3;
+	}
+
+	StereoscopicVideoRenderMode renderMode = StereoscopicVideoRenderMode::StereoscopicVideoRenderMode_Mono;
+	if (spMediaPlayer3 != nullptr)
+		spMediaPlayer3->get_StereoscopicVideoRenderMode(&renderMode);
+
+	return renderMode == StereoscopicVideoRenderMode::StereoscopicVideoRenderMode_Stereo;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::GetAvailableBitrates(std::vector<UINT32>* bitrates) const
+{
+	NULL_CHK(bitrates);
+
+	std::lock_guard<std::mutex> lock(m_abrLock);
+	*bitrates = m_availableBitrates;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::SetInitialBitrate(UINT32 bitrate)
+{
+	std::lock_guard<std::mutex> lock(m_abrLock);
+
+	if (m_spAdaptiveMediaSource == nullptr)
+		return S_FALSE;
+
+	Log(Log_Level_Any, L"Setting initial bitrate to max: %u\n", bitrate);
+
+	return m_spAdaptiveMediaSource->put_InitialBitrate(bitrate);
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::SetDesiredMaxBitrate(UINT32 bitrate)
+{
+	std::lock_guard<std::mutex> lock(m_abrLock);
+
+	if (m_spAdaptiveMediaSource == nullptr)
+		return S_FALSE;
+
+	Log(Log_Level_Any, L"Setting desired max bitrate to %u\n", bitrate);
+
+	return ApplyBitrateCap(bitrate);
+}
+
+UINT32 CMediaPlayerSession::GetCurrentBitrate() const
+{
+	ComPtr<ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSource> spAdaptiveMediaSource;
+	{
+		std::lock_guard<std::mutex> lock(m_abrLock);
+		spAdaptiveMediaSource = m_spAdaptiveMediaSource;
+	}
+
+	UINT32 bitrate = 0;
+	if (spAdaptiveMediaSource != nullptr)
+		spAdaptiveMediaSource->get_CurrentPlaybackBitrate(&bitrate);
+
+	return bitrate;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::GetBufferedRanges(std::vector<MEDIA_TIME_RANGE>* ranges) const
+{
+	NULL_CHK(ranges);
+
+	ranges->clear();
+
+	ComPtr<IMediaPlaybackSession> spSession;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		spSession = m_mediaPlaybackSession;
+	}
+
+	NULL_CHK_HR(spSession.Get(), E_ILLEGAL_METHOD_CALL);
+
+	GetSessionBufferedRanges(spSession.Get(), ranges);
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::GetVideoTracks(std::vector<VIDEO_TRACK_INFO>* tracks, INT32* selectedIndex) const
+{
+	NULL_CHK(tracks);
+	NULL_CHK(selectedIndex);
+
+	tracks->clear();
+	*selectedIndex = -1;
+
+	{
+		std::lock_guard<std::mutex> lock(m_abrLock);
+
+		// the adaptive source can only bound the bitrate, its renditions stand in for the tracks
+		if (m_spAdaptiveMediaSource != nullptr && HasRenditionSizes(m_renditions))
+		{
+			INT32 playing = -1;
+			INT32 capped = -1;
+			INT32 highest = -1;
+
+			for (size_t i = 0; i < m_renditions.size(); i++)
+			{
+				const RENDITION_INFO& rendition = m_renditions[i];
+				tracks->push_back({ rendition.width, rendition.height, rendition.bitrate, rendition.frameRate, rendition.codec, rendition.profile, rendition.bitDepth });
+
+				if (m_playingBitrate != 0 && rendition.bitrate == m_playingBitrate)
+					playing = (INT32)i;
+				if (m_abrBitrateCap != 0 && rendition.bitrate == m_abrBitrateCap)
+					capped = (INT32)i;
+				if (highest < 0 || rendition.bitrate > m_renditions[highest].bitrate)
+					highest = (INT32)i;
+			}
+
+			// the rendition playing, else the one the bitrate is capped at
+			*selectedIndex = (playing >= 0) ? playing : (capped >= 0) ? capped : highest;
+
+			return S_OK;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	*tracks = m_videoTracks;
+	*selectedIndex = m_selectedVideoTrack;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::SelectVideoTrack(INT32 index)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_abrLock);
+
+		if (m_spAdaptiveMediaSource != nullptr && HasRenditionSizes(m_renditions))
+		{
+			if (index < 0 || (size_t)index >= m_renditions.size())
+				return E_INVALIDARG;
+
+			// undecodable renditions below the cap stay selectable, the highest one lifts the cap
+			UINT32 maxBitrate = 0;
+			for (const RENDITION_INFO& rendition : m_renditions)
+				maxBitrate = std::max(maxBitrate, rendition.bitrate);
+
+			UINT32 bitrateCap = m_renditions[index].bitrate;
+			if (bitrateCap >= maxBitrate)
+				bitrateCap = 0;
+
+			if (bitrateCap == m_abrBitrateCap)
+				return S_OK;
+
+			Log(Log_Level_Any, L"Setting desired max bitrate to %u for the selected rendition\n", bitrateCap);
+
+			return ApplyBitrateCap(bitrateCap);
+		}
+	}
+
+	ComPtr<IMediaPlaybackItem> spPlaybackItem;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		if (index < 0 || (size_t)index >= m_videoTracks.size())
+			return E_INVALIDARG;
+
+		spPlaybackItem = m_spPlaybackItem;
+	}
+
+	NULL_CHK_HR(spPlaybackItem.Get(), E_ILLEGAL_METHOD_CALL);
+
+	ComPtr<ABI::Windows::Foundation::Collections::IVectorView<VideoTrack*>> spVideoTracks;
+	ComPtr<ABI::Windows::Media::Core::ISingleSelectMediaTrackList> spTrackList;
+
+	IFR(spPlaybackItem->get_VideoTracks(&spVideoTracks));
+	IFR(spVideoTracks.As(&spTrackList));
+	IFR(spTrackList->put_SelectedIndex(index));
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	m_selectedVideoTrack = index;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::GetSubtitleTracks(std::vector<SUBTITLE_TRACK>* tracks) const
+{
+	NULL_CHK(tracks);
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	*tracks = m_subtitleTracks;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::CopyFrameToSurface(IPlaybackSurface* pSurface)
+{
+	CD3D11PlaybackSurface* pD3D11Surface = dynamic_cast<CD3D11PlaybackSurface*>(pSurface);
+	NULL_CHK(pD3D11Surface);
+
+	ComPtr<IMediaPlayer5> spMediaPlayer5;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		spMediaPlayer5 = m_mediaPlayer5;
+	}
+
+	NULL_CHK_HR(spMediaPlayer5.Get(), E_ILLEGAL_METHOD_CALL);
+
+	// no free slot means the render thread is behind; the frame is dropped (and counted) instead of waiting
+	VIDEO_FRAME_SLOT* pSlot = pD3D11Surface->BeginWrite();
+	if (pSlot == nullptr || !pSlot->mediaTexture)
+		return E_PENDING;
+
+	IFR(m_spBackend->RunOnMediaDevice([this, &spMediaPlayer5, pD3D11Surface, pSlot](ID3D11Device* pMediaDevice, ID3D11DeviceContext* pContext) -> HRESULT
+	{
+		// surfaces of a lost device are about to be released
+		if (pD3D11Surface->GetDeviceGeneration() != m_spBackend->m_deviceGeneration)
+			return E_ILLEGAL_METHOD_CALL;
+
+		return RenderFrame(spMediaPlayer5.Get(), pD3D11Surface, pSlot, pMediaDevice, pContext);
+	}));
+
+	pD3D11Surface->Publish();
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::RenderFrame(
+	IMediaPlayer5* pMediaPlayer5,
+	CD3D11PlaybackSurface* pSurface,
+	VIDEO_FRAME_SLOT* pSlot,
+	ID3D11Device* pMediaDevice,
+	ID3D11DeviceContext* pContext)
+{
+	if (!pSurface->IsStereoscopic())
+		return pMediaPlayer5->CopyFrameToVideoSurface(pSlot->mediaSurface.Get());
+
+	// stereoscopic, eyes go straight to the slices of the slot
+	if (pSurface->IsStereoArray() && !m_spBackend->IsStereoArrayUnsupported())
+	{
+		HRESULT hr = pMediaPlayer5->CopyFrameToStereoscopicVideoSurfaces(pSlot->leftEyeSurface.Get(), pSlot->rightEyeSurface.Get());
+		if (SUCCEEDED(hr))
+			return S_OK;
+
+		Log(Log_Level_Warning, L"CMediaPlayerSession::RenderFrame() - rendering to texture array slices failed (0x%08x), switching to eye textures", hr);
+
+		// surfaces created from now on are over/under
+		m_spBackend->SetStereoArrayUnsupported();
+	}
+
+	ComPtr<ID3D11Texture2D> spLeftEyeTexture;
+	ComPtr<IDirect3DSurface> spLeftEyeSurface;
+	ComPtr<ID3D11Texture2D> spRightEyeTexture;
+	ComPtr<IDirect3DSurface> spRightEyeSurface;
+	IFR(pSurface->GetEyeTextures(pMediaDevice, &spLeftEyeTexture, &spLeftEyeSurface, &spRightEyeTexture, &spRightEyeSurface));
+
+	IFR(pMediaPlayer5->CopyFrameToStereoscopicVideoSurfaces(spLeftEyeSurface.Get(), spRightEyeSurface.Get()));
+
+	D3D11_TEXTURE2D_DESC eyeTextureDesc = { 0 };
+	spRightEyeTexture->GetDesc(&eyeTextureDesc);
+
+	if (pSurface->IsStereoArray())
+	{
+		pContext->CopySubresourceRegion(pSlot->mediaTexture.Get(), D3D11CalcSubresource(0, 0, 1), 0, 0, 0, spLeftEyeTexture.Get(), 0, nullptr);
+		pContext->CopySubresourceRegion(pSlot->mediaTexture.Get(), D3D11CalcSubresource(0, 1, 1), 0, 0, 0, spRightEyeTexture.Get(), 0, nullptr);
+	}
+	else
+	{
+		// once rendered to eye textures, copy them to the frame slot which has 2 times bigger height (we force over/under layout)
+		pContext->CopySubresourceRegion(pSlot->mediaTexture.Get(), 0, 0, 0, 0, spLeftEyeTexture.Get(), 0, nullptr);
+		pContext->CopySubresourceRegion(pSlot->mediaTexture.Get(), 0, 0, eyeTextureDesc.Height, 0, spRightEyeTexture.Get(), 0, nullptr);
+	}
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+void CMediaPlayerSession::SetSegmentPrefetch(INT64 lookAhead, UINT32 maxInFlight)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_segmentPrefetchLock);
+
+		m_prefetchLookAhead = lookAhead;
+		m_prefetchMaxInFlight = maxInFlight;
+
+		if (lookAhead > 0)
+		{
+			if (m_spSegmentPrefetcher)
+				m_spSegmentPrefetcher->SetWindow(lookAhead, maxInFlight);
+
+			return;
+		}
+	}
+
+	StopSegmentPrefetch();
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::GetSegmentPrefetchStats(SEGMENT_PREFETCH_STATS* pStats)
+{
+	NULL_CHK(pStats);
+
+	ZeroMemory(pStats, sizeof(SEGMENT_PREFETCH_STATS));
+
+	std::shared_ptr<CSegmentPrefetcher> spPrefetcher;
+	{
+		std::lock_guard<std::mutex> lock(m_segmentPrefetchLock);
+		spPrefetcher = m_spSegmentPrefetcher;
+	}
+
+	if (!spPrefetcher)
+		return S_FALSE;
+
+	spPrefetcher->GetStats(pStats);
+
+	return S_OK;
+}
+
+void CMediaPlayerSession::StopSegmentPrefetch()
+{
+	std::shared_ptr<CSegmentPrefetcher> spPrefetcher;
+
+	{
+		std::lock_guard<std::mutex> lock(m_segmentPrefetchLock);
+		std::swap(spPrefetcher, m_spSegmentPrefetcher);
+	}
+
+	// segment requests still waiting for a download complete empty, the media source downloads them itself
+	if (spPrefetcher)
+		spPrefetcher->Close();
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::StartManifestRead(LPCWSTR pszManifestLocation)
+{
+	NULL_CHK(pszManifestLocation);
+
+	// local manifests have nothing to wait for
+	if (_wcsnicmp(pszManifestLocation, L"http://", 7) != 0 && _wcsnicmp(pszManifestLocation, L"https://", 8) != 0)
+		return S_OK;
+
+	std::shared_ptr<CSegmentPrefetcher> spPrefetcher;
+
+	{
+		std::lock_guard<std::mutex> lock(m_segmentPrefetchLock);
+
+		if (m_prefetchLookAhead != 0)
+		{
+			spPrefetcher = std::make_shared<CSegmentPrefetcher>(&CMediaPlayerBackend::SubmitSegmentTask, &CMediaPlayerBackend::FetchSegment);
+			spPrefetcher->SetWindow(m_prefetchLookAhead, m_prefetchMaxInFlight);
+
+			m_spSegmentPrefetcher = spPrefetcher;
+		}
+	}
+
+	// the renditions are read even without prefetching
+	{
+		std::lock_guard<std::mutex> workersLock(CMediaPlayerBackend::m_segmentCacheMutex);
+		IFR(CMediaPlayerBackend::StartSegmentWorkers());
+	}
+
+	UINT32 sourceGeneration = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_abrLock);
+		sourceGeneration = ++m_sourceGeneration;
+	}
+
+	// the media source read the manifest before handing out its first DownloadRequested, read it once more
+	std::weak_ptr<CSegmentPrefetcher> wpPrefetcher(spPrefetcher);
+	std::weak_ptr<CMediaPlayerSession> wpThis = GetWeakPtr<CMediaPlayerSession>();
+	std::wstring manifestUri(pszManifestLocation);
+
+	return CMediaPlayerBackend::SubmitSegmentTask([wpThis, wpPrefetcher, sourceGeneration, manifestUri]()
+	{
+		auto fnIsStale = [&wpThis, sourceGeneration]()
+		{
+			std::shared_ptr<CMediaPlayerSession> spThis = wpThis.lock();
+			return !spThis || spThis->m_sourceGeneration != sourceGeneration;
+		};
+		auto fnIsCancelled = [&fnIsStale, &wpPrefetcher]() { return fnIsStale() || wpPrefetcher.expired(); };
+
+		MANIFEST manifest;
+		ComPtr<ABI::Windows::Storage::Streams::IBuffer> spBuffer;
+		std::wstring etag;
+		HRESULT hr = DownloadSegment(manifestUri.c_str(), 0, 0, &spBuffer, &etag, fnIsStale);
+		if (SUCCEEDED(hr))
+			hr = ParseManifestBuffer(spBuffer.Get(), manifestUri, &manifest);
+
+		// renditions are listed by the MPD or the master playlist itself
+		if (SUCCEEDED(hr))
+		{
+			std::shared_ptr<CMediaPlayerSession> spThis = wpThis.lock();
+			if (spThis)
+				spThis->ApplyRenditions(manifest.renditions, sourceGeneration);
+		}
+
+		if (SUCCEEDED(hr) && wpPrefetcher.expired())
+			return;
+
+		// a master playlist only lists its media playlists, the media source may have read some of them already
+		for (size_t i = 0; SUCCEEDED(hr) && i < manifest.playlistUris.size() && i < PREFETCH_MAX_PLAYLISTS; i++)
+		{
+			MANIFEST playlist;
+			if (SUCCEEDED(DownloadSegment(manifest.playlistUris[i].c_str(), 0, 0, spBuffer.ReleaseAndGetAddressOf(), &etag, fnIsCancelled)) &&
+				SUCCEEDED(ParseManifestBuffer(spBuffer.Get(), manifest.playlistUris[i], &playlist)))
+			{
+				manifest.representations.insert(manifest.representations.end(), playlist.representations.begin(), playlist.representations.end());
+			}
+		}
+
+		std::shared_ptr<CSegmentPrefetcher> spPrefetcher = wpPrefetcher.lock();
+		if (SUCCEEDED(hr) && spPrefetcher)
+			spPrefetcher->AddManifest(manifest);
+		else if (FAILED(hr) && hr != HRESULT_FROM_WIN32(ERROR_CANCELLED))
+			Log(Log_Level_Warning, L"Reading the manifest failed - hr=%08x", hr);
+	});
+}
+
+_Use_decl_annotations_
+void CMediaPlayerSession::ApplyRenditions(const std::vector<RENDITION_INFO>& renditions, UINT32 sourceGeneration)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_abrLock);
+
+		if (sourceGeneration != m_sourceGeneration || m_spAdaptiveMediaSource == nullptr)
+			return;
+
+		m_renditions = renditions;
+	}
+
+	// the core selects among them, and caps the bitrate at the one it picks
+	if (!m_bIgnoreEvents)
+		m_pSink->OnSessionVideoTracksChanged();
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::ApplyBitrateCap(UINT32 bitrateCap)
+{
+	// the ABR controller picks its next bitrate under the new cap
+	std::vector<UINT32> bitrates(m_availableBitrates);
+	ResetAbrController(bitrates, bitrateCap);
+
+	ComPtr<ABI::Windows::Foundation::IReference<UINT32>> spMaxBitrate;
+	if (bitrateCap != 0)
+		CreateUInt32Reference(bitrateCap, &spMaxBitrate);
+
+	IFR(m_spAdaptiveMediaSource->put_DesiredMinBitrate(nullptr));
+
+	return m_spAdaptiveMediaSource->put_DesiredMaxBitrate(spMaxBitrate.Get());
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::SetAbrPolicy(AbrPolicy policy)
+{
+	if (policy > AbrPolicy::AbrPolicy_Hybrid)
+		return E_INVALIDARG;
+
+	std::lock_guard<std::mutex> lock(m_abrLock);
+
+	if (m_abrPolicy == policy)
+		return S_OK;
+
+	m_abrPolicy = policy;
+
+	// the bitrate applied last stays until the new controller picks one
+	std::vector<UINT32> bitrates(m_abrBitrates);
+	UINT32 appliedBitrate = m_abrBitrate;
+	ResetAbrController(bitrates, m_abrBitrateCap);
+	m_abrBitrate = appliedBitrate;
+
+	// back to the heuristics of the media source, within the hardware decoding cap
+	if (policy == AbrPolicy::AbrPolicy_System && m_spAdaptiveMediaSource != nullptr)
+	{
+		ComPtr<ABI::Windows::Foundation::IReference<UINT32>> spMaxBitrate;
+		if (m_abrBitrateCap != 0)
+			CreateUInt32Reference(m_abrBitrateCap, &spMaxBitrate);
+
+		IFR(m_spAdaptiveMediaSource->put_DesiredMinBitrate(nullptr));
+		IFR(m_spAdaptiveMediaSource->put_DesiredMaxBitrate(spMaxBitrate.Get()));
+
+		m_abrBitrate = 0;
+	}
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+void CMediaPlayerSession::ResetAbrController(const std::vector<UINT32>& bitrates, UINT32 bitrateCap)
+{
+	m_abrBitrates.clear();
+	for (UINT32 bitrate : bitrates)
+	{
+		if (bitrate != 0 && (bitrateCap == 0 || bitrate <= bitrateCap))
+			m_abrBitrates.push_back(bitrate);
+	}
+
+	std::sort(m_abrBitrates.begin(), m_abrBitrates.end());
+
+	m_abrBitrateCap = bitrateCap;
+	m_abrBitrate = 0;
+
+	// a single bitrate leaves nothing to choose
+	m_spAbrController.reset();
+	if (m_abrBitrates.size() > 1)
+		LOG_RESULT(CreateAbrController(m_abrPolicy, &m_spAbrController));
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::ApplyAbrBitrate(UINT32 bitrate)
+{
+	if (m_spAdaptiveMediaSource == nullptr)
+		return S_FALSE;
+
+	ComPtr<ABI::Windows::Foundation::IReference<UINT32>> spValue;
+	CreateUInt32Reference(bitrate, &spValue);
+
+	// min never goes above max in between
+	if (m_abrBitrate == 0 || bitrate > m_abrBitrate)
+	{
+		IFR(m_spAdaptiveMediaSource->put_DesiredMaxBitrate(spValue.Get()));
+		IFR(m_spAdaptiveMediaSource->put_DesiredMinBitrate(spValue.Get()));
+	}
+	else
+	{
+		IFR(m_spAdaptiveMediaSource->put_DesiredMinBitrate(spValue.Get()));
+		IFR(m_spAdaptiveMediaSource->put_DesiredMaxBitrate(spValue.Get()));
+	}
+
+	m_abrBitrate = bitrate;
+
+	return S_OK;
+}
+
+HRESULT CMediaPlayerSession::UpdateVideoTracks()
+{
+	ComPtr<IMediaPlaybackItem> spPlaybackItem;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		spPlaybackItem = m_spPlaybackItem;
+	}
+
+	NULL_CHK_HR(spPlaybackItem.Get(), E_ILLEGAL_METHOD_CALL);
+
+	ComPtr<ABI::Windows::Foundation::Collections::IVectorView<VideoTrack*>> spVideoTracks;
+	ComPtr<ABI::Windows::Media::Core::ISingleSelectMediaTrackList> spTrackList;
+
+	IFR(spPlaybackItem->get_VideoTracks(&spVideoTracks));
+	IFR(spVideoTracks.As(&spTrackList));
+
+	ComPtr<ABI::Windows::Media::Core::IMediaTrack> track;
+	ComPtr<ABI::Windows::Media::Core::IVideoTrack> vtrack;
+	ComPtr<ABI::Windows::Media::MediaProperties::IVideoEncodingProperties> props;
+
+	INT32 selected = 0;
+	unsigned int size = 0;
+
+	spVideoTracks->get_Size(&size);
+	spTrackList->get_SelectedIndex(&selected);
+
+	std::vector<VIDEO_TRACK_INFO> tracks(size);
+
+	for (unsigned int i = 0; i < size; i++)
+	{
+		VIDEO_TRACK_INFO& info = tracks[i];
+		ZeroMemory(&info, sizeof(info));
+		info.codec = VideoCodec::VideoCodec_Unknown;
+
+		vtrack = nullptr;
+		props = nullptr;
+		spVideoTracks->GetAt(i, track.ReleaseAndGetAddressOf());
+		track.As(&vtrack);
+
+		if (vtrack == nullptr || FAILED(vtrack->GetEncodingProperties(props.ReleaseAndGetAddressOf())))
+			continue;
+
+		props->get_Width(&info.width);
+		props->get_Height(&info.height);
+		props->get_Bitrate(&info.bitrate);
+
+		ComPtr<ABI::Windows::Media::MediaProperties::IMediaRatio> spFrameRate;
+		UINT32 numerator = 0;
+		UINT32 denominator = 0;
+		if (SUCCEEDED(props->get_FrameRate(&spFrameRate)) && spFrameRate != nullptr &&
+			SUCCEEDED(spFrameRate->get_Numerator(&numerator)) && SUCCEEDED(spFrameRate->get_Denominator(&denominator)) && denominator != 0)
+		{
+			info.frameRate = (numerator + denominator - 1) / denominator;
+		}
+
+		// the profile and bit depth are not reported, the codec is checked at its lowest
+		ComPtr<ABI::Windows::Media::MediaProperties::IMediaEncodingProperties> spEncodingProperties;
+		Wrappers::HString subtype;
+		if (SUCCEEDED(props.As(&spEncodingProperties)) && SUCCEEDED(spEncodingProperties->get_Subtype(subtype.GetAddressOf())) && subtype.IsValid())
+		{
+			info.codec = GetVideoCodecFromSubtype(subtype.GetRawBuffer(nullptr));
+			info.bitDepth = 8;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	// the item changed while the tracks were read
+	if (spPlaybackItem != m_spPlaybackItem)
+		return S_FALSE;
+
+	m_videoTracks = tracks;
+	m_selectedVideoTrack = selected;
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::OnOpened(IMediaPlayer* sender, IInspectable* args)
+{
+	if (m_bIgnoreEvents)
+		return S_OK;
+
+	ComPtr<IMediaPlayer3> spMediaPlayer3;
+	ComPtr<IMediaPlaybackSession> spSession;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		spMediaPlayer3 = m_mediaPlayer3;
+		spSession = m_mediaPlaybackSession;
+	}
+
+	NULL_CHK_HR(spSession.Get(), E_UNEXPECTED);
+
+	// stereoscopic video is rendered one eye per surface, IsStereoscopic tells the core
+	MediaProperties::StereoscopicVideoPackingMode packingMode = MediaProperties::StereoscopicVideoPackingMode_None;
+	spSession->get_StereoscopicVideoPackingMode(&packingMode);
+	if (packingMode != MediaProperties::StereoscopicVideoPackingMode_None)
+	{
+		spMediaPlayer3->put_StereoscopicVideoRenderMode(StereoscopicVideoRenderMode::StereoscopicVideoRenderMode_Stereo);
+	}
+
+	m_pSink->OnSessionOpened();
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::OnEnded(IMediaPlayer* sender, IInspectable* args)
+{
+	if (m_bIgnoreEvents)
+		return S_OK;
+
+	m_pSink->OnSessionEnded();
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::OnFailed(IMediaPlayer* sender, IMediaPlayerFailedEventArgs* args)
+{
+	HRESULT hr = S_OK;
+
+	if (m_bIgnoreEvents)
+		return S_OK;
+
+	IFR(args->get_ExtendedErrorCode(&hr));
+
+	SafeString errorMessage;
+	IFR(args->get_ErrorMessage(errorMessage.GetAddressOf()));
+
+	LOG_RESULT_MSG(hr, errorMessage.c_str());
+
+	m_pSink->OnSessionFailed(hr);
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::OnVideoFrameAvailable(IMediaPlayer* sender, IInspectable* arg)
+{
+	if (m_bIgnoreEvents)
+		return S_OK;
+
+	// the core copies the frame to its surface through CopyFrameToSurface
+	m_pSink->OnSessionFrameAvailable();
+
+	ComPtr<IMediaPlaybackSession> spSession;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		spSession = m_mediaPlaybackSession;
+	}
+
+	ABI::Windows::Foundation::TimeSpan position = { 0 };
+	if (spSession == nullptr || FAILED(spSession->get_Position(&position)))
+		return S_OK;
+
+	INT64 loopStart = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_loopLock);
+
+		m_loopTracker.OnFrame(position.Duration, CoreNow());
+
+		if (!m_loopTracker.ShouldSeekToStart(position.Duration))
+			return S_OK;
+
+		loopStart = m_loopTracker.GetStart();
+	}
+
+	// issued while the last frame of the range is still to come, so the start is decoded by the time it has played
+	ABI::Windows::Foundation::TimeSpan positionTS;
+	positionTS.Duration = loopStart;
+	LOG_RESULT(spSession->put_Position(positionTS));
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::OnStateChanged(IMediaPlaybackSession* sender, IInspectable* args)
+{
+	if (m_bIgnoreEvents)
+		return S_OK;
+
+	MediaPlaybackState state;
+	IFR(sender->get_PlaybackState(&state));
+
+	m_pSink->OnSessionStateChanged(static_cast<PlaybackState>(state));
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::OnSizeChanged(IMediaPlaybackSession* sender, IInspectable*)
+{
+	if (m_bIgnoreEvents)
+		return S_OK;
+
+	UINT32 width = 0;
+	UINT32 height = 0;
+
+	sender->get_NaturalVideoWidth(&width);
+	sender->get_NaturalVideoHeight(&height);
+
+	// surfaces are created again on the render thread
+	if (width && height)
+		m_pSink->OnSessionSizeChanged();
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::OnStatusChanged(IMediaPlaybackSession* sender, IInspectable*)
+{
+	if (m_bIgnoreEvents)
+		return S_OK;
+
+	m_pSink->OnSessionStatusChanged();
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::OnPlaybackBitrateChanged(ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSource*, ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSourcePlaybackBitrateChangedEventArgs* args)
+{
+	if (m_bIgnoreEvents)
+		return S_OK;
+
+	UINT32 bitrate = 0;
+	IFR(args->get_NewValue(&bitrate));
+
+	// frame drops count against the rendition playing now
+	{
+		std::lock_guard<std::mutex> lock(m_abrLock);
+		m_playingBitrate = bitrate;
+	}
+
+	m_pSink->OnSessionStatusChanged();
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::OnDownloadCompleted(ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSource*, ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSourceDownloadCompletedEventArgs* args)
+{
+	using namespace ABI::Windows::Media::Streaming::Adaptive;
+
+	if (m_bIgnoreEvents)
+		return S_OK;
+
+	AdaptiveMediaSourceResourceType resourceType;
+	IFR(args->get_ResourceType(&resourceType));
+	if (resourceType != AdaptiveMediaSourceResourceType::AdaptiveMediaSourceResourceType_MediaSegment)
+		return S_OK;
+
+	ComPtr<IMediaPlaybackSession> spSession;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		spSession = m_mediaPlaybackSession;
+	}
+
+	// BOLA goes by the buffer level, read before m_abrLock is taken
+	std::vector<MEDIA_TIME_RANGE> ranges;
+	ABI::Windows::Foundation::TimeSpan position = { 0 };
+	if (spSession != nullptr)
+	{
+		GetSessionBufferedRanges(spSession.Get(), &ranges);
+		spSession->get_Position(&position);
+	}
+
+	std::lock_guard<std::mutex> lock(m_abrLock);
+
+	if (!m_spAbrController)
+		return S_OK;
+
+	// download statistics (SDK 16299+) are what the throughput estimates go by
+#if WINDOWS_FOUNDATION_UNIVERSALAPICONTRACT_VERSION >= 0x50000
+	ComPtr<IAdaptiveMediaSourceDownloadCompletedEventArgs3> spArgs3;
+	ComPtr<IAdaptiveMediaSourceDownloadStatistics> spStatistics;
+	if (SUCCEEDED(args->QueryInterface(IID_PPV_ARGS(&spArgs3))) &&
+		SUCCEEDED(spArgs3->get_Statistics(&spStatistics)) && spStatistics != nullptr)
+	{
+		UINT64 bytes = 0;
+		ComPtr<ABI::Windows::Foundation::IReference<ABI::Windows::Foundation::TimeSpan>> spTimeToLastByte;
+		ABI::Windows::Foundation::TimeSpan timeToLastByte = { 0 };
+
+		if (SUCCEEDED(spStatistics->get_ContentBytesReceivedCount(&bytes)) &&
+			SUCCEEDED(spStatistics->get_TimeToLastByteReceived(&spTimeToLastByte)) && spTimeToLastByte != nullptr &&
+			SUCCEEDED(spTimeToLastByte->get_Value(&timeToLastByte)))
+		{
+			m_spAbrController->OnSegmentDownloaded(bytes, timeToLastByte.Duration);
+		}
+	}
+#endif
+
+	UINT32 bitrate = m_spAbrController->SelectBitrate(m_abrBitrates,
+		GetBufferLevel(ranges.data(), (UINT32)ranges.size(), position.Duration));
+
+	if (bitrate == 0 || bitrate == m_abrBitrate)
+		return S_OK;
+
+	Log(Log_Level_Info, L"ABR switching to %u\n", bitrate);
+
+	return ApplyAbrBitrate(bitrate);
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::OnDownloadRequested(ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSource* sender, ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSourceDownloadRequestedEventArgs* args)
+{
+	using namespace ABI::Windows::Media::Streaming::Adaptive;
+
+	// requests left alone are downloaded by the media source itself
+	AdaptiveMediaSourceResourceType resourceType;
+	IFR(args->get_ResourceType(&resourceType));
+
+	bool isManifest = (resourceType == AdaptiveMediaSourceResourceType::AdaptiveMediaSourceResourceType_Manifest);
+	bool isSegment = (resourceType == AdaptiveMediaSourceResourceType::AdaptiveMediaSourceResourceType_InitializationSegment ||
+		resourceType == AdaptiveMediaSourceResourceType::AdaptiveMediaSourceResourceType_MediaSegment);
+
+	if (!isManifest && !isSegment)
+		return S_OK;
+
+	std::shared_ptr<CSegmentPrefetcher> spPrefetcher;
+	{
+		std::lock_guard<std::mutex> lock(m_segmentPrefetchLock);
+		spPrefetcher = m_spSegmentPrefetcher;
+	}
+
+	if (!spPrefetcher)
+	{
+		std::lock_guard<std::mutex> lock(CMediaPlayerBackend::m_segmentCacheMutex);
+		if (isManifest || !CMediaPlayerBackend::m_spSegmentCache)
+			return S_OK;
+	}
+
+	ComPtr<ABI::Windows::Foundation::IUriRuntimeClass> spUri;
+	IFR(args->get_ResourceUri(&spUri));
+
+	Wrappers::HString uri;
+	IFR(spUri->get_AbsoluteUri(uri.GetAddressOf()));
+
+	SEGMENT_KEY key;
+	key.uri = uri.GetRawBuffer(nullptr);
+	key.rangeOffset = 0;
+	key.rangeLength = 0;
+
+	ComPtr<IAdaptiveMediaSourceDownloadRequestedEventArgs2> spArgs2;
+	if (SUCCEEDED(args->QueryInterface(IID_PPV_ARGS(&spArgs2))))
+	{
+		ComPtr<ABI::Windows::Foundation::IReference<UINT64>> spRangeOffset;
+		if (SUCCEEDED(spArgs2->get_ResourceByteRangeOffset(&spRangeOffset)) && spRangeOffset != nullptr)
+			spRangeOffset->get_Value(&key.rangeOffset);
+
+		ComPtr<ABI::Windows::Foundation::IReference<UINT64>> spRangeLength;
+		if (SUCCEEDED(spArgs2->get_ResourceByteRangeLength(&spRangeLength)) && spRangeLength != nullptr)
+			spRangeLength->get_Value(&key.rangeLength);
+	}
+
+	ComPtr<IAdaptiveMediaSourceDownloadResult> spResult;
+	IFR(args->get_Result(&spResult));
+
+	ComPtr<IAdaptiveMediaSourceDownloadRequestedDeferral> spDeferral;
+	IFR(args->GetDeferral(&spDeferral));
+
+	if (isManifest)
+	{
+		// HLS media playlists and refreshed live manifests tell the prefetcher about segments it has not seen yet
+		std::weak_ptr<CSegmentPrefetcher> wpPrefetcher(spPrefetcher);
+
+		HRESULT hrSubmit = CMediaPlayerBackend::SubmitSegmentTask([wpPrefetcher, key, spResult, spDeferral]()
+		{
+			ComPtr<ABI::Windows::Storage::Streams::IBuffer> spBuffer;
+			std::wstring etag;
+			HRESULT hr = DownloadSegment(key.uri.c_str(), key.rangeOffset, key.rangeLength, &spBuffer, &etag,
+				[&wpPrefetcher]() { return wpPrefetcher.expired(); });
+
+			if (SUCCEEDED(hr))
+				hr = spResult->put_Buffer(spBuffer.Get());
+
+			MANIFEST manifest;
+			std::shared_ptr<CSegmentPrefetcher> spPrefetcher = wpPrefetcher.lock();
+			if (SUCCEEDED(hr) && spPrefetcher && SUCCEEDED(ParseManifestBuffer(spBuffer.Get(), key.uri, &manifest)))
+				spPrefetcher->AddManifest(manifest);
+
+			if (FAILED(hr) && hr != HRESULT_FROM_WIN32(ERROR_CANCELLED))
+				Log(Log_Level_Warning, L"Manifest download failed, leaving it to the media source - hr=%08x", hr);
+
+			spDeferral->Complete();
+		});
+
+		if (FAILED(hrSubmit))
+			spDeferral->Complete();
+
+		return hrSubmit;
+	}
+
+	if (spPrefetcher)
+	{
+		HRESULT hr = spPrefetcher->Request(key, [spResult, spDeferral](HRESULT hr, const SegmentData& data)
+		{
+			ComPtr<ABI::Windows::Storage::Streams::IBuffer> spBuffer;
+			if (SUCCEEDED(hr))
+				hr = CreateBufferFromBytes(data, &spBuffer);
+
+			if (SUCCEEDED(hr))
+				hr = spResult->put_Buffer(spBuffer.Get());
+
+			if (FAILED(hr) && hr != E_ABORT && hr != HRESULT_FROM_WIN32(ERROR_CANCELLED))
+				Log(Log_Level_Warning, L"Segment prefetch failed, leaving it to the media source - hr=%08x", hr);
+
+			spDeferral->Complete();
+		});
+
+		// segments the manifests did not list go through the cache
+		if (hr == S_OK)
+			return S_OK;
+	}
+
+	return CMediaPlayerBackend::ServeSegmentFromCache(key, spResult.Get(), spDeferral.Get());
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::OnVideoTracksChanged(IMediaPlaybackItem* pItem, ABI::Windows::Foundation::Collections::IVectorChangedEventArgs*)
+{
+	if (m_bIgnoreEvents)
+		return S_OK;
+
+	if (UpdateVideoTracks() != S_OK)
+		return S_OK;
+
+	// the core selects the track again
+	m_pSink->OnSessionVideoTracksChanged();
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::OnTimedMetadataTracksChanged(IMediaPlaybackItem* pItem, ABI::Windows::Foundation::Collections::IVectorChangedEventArgs*)
+{
+	NULL_CHK(pItem);
+
+	if (m_bIgnoreEvents)
+		return S_OK;
+
+	ComPtr<ABI::Windows::Foundation::Collections::IVectorView<ABI::Windows::Media::Core::TimedMetadataTrack*>> metadataTracks;
+	ComPtr<ABI::Windows::Media::Playback::IMediaPlaybackTimedMetadataTrackList> spTrackList;
+	unsigned int size = 0;
+
+	IFR(pItem->get_TimedMetadataTracks(&metadataTracks));
+	metadataTracks.As(&spTrackList);
+	metadataTracks->get_Size(&size);
+
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		if (pItem != m_spPlaybackItem.Get())
+			return S_OK;
+
+		// the list is taken whole with every change, the core keeps the indexes of the tracks it has reported
+		ReleaseSubtitleTracks();
+
+		for (unsigned int i = 0; i < size; i++)
+		{
+			ComPtr<ABI::Windows::Media::Core::ITimedMetadataTrack> track;
+
+			metadataTracks->GetAt(i, track.ReleaseAndGetAddressOf());
+			if (track == nullptr)
+				continue;
+
+			TimedMetadataKind kind = TimedMetadataKind::TimedMetadataKind_Custom;
+			track->get_TimedMetadataKind(&kind);
+
+			if (kind != TimedMetadataKind::TimedMetadataKind_Subtitle)
+				continue;
+
+			ComPtr<IMediaTrack> spMediaTrack;
+			track.As(&spMediaTrack);
+
+			Wrappers::HString id, label, language;
+			spMediaTrack->get_Id(id.GetAddressOf());
+			spMediaTrack->get_Label(label.GetAddressOf());
+			spMediaTrack->get_Language(language.GetAddressOf());
+
+			SUBTITLE_TRACK st;
+			st.id = id.GetRawBuffer(nullptr);
+			st.language = language.IsValid() ? language.GetRawBuffer(nullptr) : L"";
+			st.title = label.IsValid() ? label.GetRawBuffer(nullptr) : L"";
+
+			EventRegistrationToken cueEnteredToken = { 0 };
+			EventRegistrationToken cueExitedToken = { 0 };
+			track->add_CueEntered(MakeHandler<IMediaCueEventHandler>(&CMediaPlayerSession::OnCueEntered).Get(), &cueEnteredToken);
+			track->add_CueExited(MakeHandler<IMediaCueEventHandler>(&CMediaPlayerSession::OnCueExited).Get(), &cueExitedToken);
+
+			spTrackList->SetPresentationMode(i, ABI::Windows::Media::Playback::TimedMetadataTrackPresentationMode::TimedMetadataTrackPresentationMode_ApplicationPresented);
+
+			m_subtitleTracks.push_back(st);
+			m_subtitleTrackObjects.push_back(track);
+			m_cueEnteredTokens.push_back(cueEnteredToken);
+			m_cueExitedTokens.push_back(cueExitedToken);
+		}
+	}
+
+	m_pSink->OnSessionSubtitleTracksChanged();
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::OnCueEntered(ABI::Windows::Media::Core::ITimedMetadataTrack* pTrack, ABI::Windows::Media::Core::IMediaCueEventArgs* pArgs)
+{
+	if (m_bIgnoreEvents)
+		return S_OK;
+
+	ComPtr<IMediaCue> spCue;
+	pArgs->get_Cue(&spCue);
+
+	if (!spCue)
+		return E_UNEXPECTED;
+
+	ComPtr<ITimedTextCue> spTextCue;
+	spCue.As(&spTextCue);
+
+	if (!spTextCue)
+		return E_UNEXPECTED;
+
+	ComPtr<IMediaTrack> spMediaTrack;
+	Wrappers::HString language, trackId;
+
+	IFR(pTrack->QueryInterface(IID_IMediaTrack, &spMediaTrack));
+	spMediaTrack->get_Language(language.GetAddressOf());
+	spMediaTrack->get_Id(trackId.GetAddressOf());
+
+	SUBTITLE_CUE cue;
+	cue.trackId = trackId.IsValid() ? trackId.GetRawBuffer(nullptr) : L"";
+	cue.language = language.IsValid() ? language.GetRawBuffer(nullptr) : L"";
+
+	ComPtr<ABI::Windows::Foundation::Collections::IVector<ABI::Windows::Media::Core::TimedTextLine*>> spLines;
+	spTextCue->get_Lines(&spLines);
+
+	unsigned int size = 0;
+	if (spLines)
+		spLines->get_Size(&size);
+
+	for (unsigned int i = 0; i < size; i++)
+	{
+		ComPtr<ITimedTextLine> line;
+		spLines->GetAt(i, &line);
+
+		Wrappers::HString text;
+		if (line)
+			line->get_Text(text.GetAddressOf());
+
+		cue.lines.push_back(text.IsValid() ? text.GetRawBuffer(nullptr) : L"");
+	}
+
+	// cues without an id get one, so the exit can be matched with the entry
+	Wrappers::HString id;
+	spCue->get_Id(id.GetAddressOf());
+	if (!id.IsValid())
+	{
+		FILETIME ft;
+		GetSystemTimeAsFileTime(&ft);
+
+		unsigned __int64 ft64 = ((unsigned __int64)(ft.dwHighDateTime) << 32) + ft.dwLowDateTime;
+
+		wchar_t timeBuffer[32];
+		memset(timeBuffer, 0, sizeof(wchar_t) * 32);
+		_ui64tow_s(ft64, timeBuffer, 32, 10);
+		id.Set(Wrappers::HString::MakeReference(timeBuffer, (unsigned int)wcslen(timeBuffer)).Get());
+
+		spCue->put_Id(id.Get());
+	}
+
+	cue.cueId = id.GetRawBuffer(nullptr);
+
+	m_pSink->OnSessionSubtitleCueEntered(cue);
+
+	return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerSession::OnCueExited(ABI::Windows::Media::Core::ITimedMetadataTrack* pTrack, ABI::Windows::Media::Core::IMediaCueEventArgs* pArgs)
+{
+	if (m_bIgnoreEvents)
+		return S_OK;
+
+	ComPtr<IMediaCue> spCue;
+	pArgs->get_Cue(&spCue);
+
+	if (!spCue)
+		return E_UNEXPECTED;
+
+	ComPtr<IMediaTrack> spMediaTrack;
+	IFR(pTrack->QueryInterface(IID_IMediaTrack, &spMediaTrack));
+
+	Wrappers::HString cueId, trackId;
+	spCue->get_Id(cueId.GetAddressOf());
+	spMediaTrack->get_Id(trackId.GetAddressOf());
+
+	SUBTITLE_CUE cue;
+	cue.trackId = trackId.IsValid() ? trackId.GetRawBuffer(nullptr) : L"";
+	cue.cueId = cueId.IsValid() ? cueId.GetRawBuffer(nullptr) : L"";
+
+	m_pSink->OnSessionSubtitleCueExited(cue);
+
+	return S_OK;
+}
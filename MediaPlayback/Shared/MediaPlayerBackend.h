@@ -0,0 +1,467 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#pragma once
+
+// IPlaybackBackend of the plugin: sessions are Windows.Media.Playback.MediaPlayer in frame server mode, surfaces are
+// D3D11 textures on Unity's device. MediaPlayer renders each frame on the media device of the adapter into a slot of
+// the frame queue of the surface, the render thread copies the latest one to the texture Unity samples.
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <map>
+
+// the core uses std::enable_shared_from_this, which pch.h bans for the plugin code
+#pragma push_macro("enable_shared_from_this")
+#undef enable_shared_from_this
+#include "Core/PlaybackBackend.h"
+#include "Core/PlaybackPolicy.h"
+#include "Core/FrameFormat.h"
+#include "Core/FrameQueue.h"
+#include "Core/WorkerPool.h"
+#include "Core/SegmentCache.h"
+#include "Core/SegmentPrefetcher.h"
+#include "Core/AbrController.h"
+#include "Core/DecoderCapabilities.h"
+#include "Core/LoopTracker.h"
+#include "Core/MediaDeviceService.h"
+#pragma pop_macro("enable_shared_from_this")
+
+
+// One slot of the decoder -> render thread frame queue. The texture lives on Unity's device,
+// the media device renders into it through a shared handle.
+// For stereoscopic video the slot is a 2 slice texture array, MediaPlayer renders each eye straight into its slice
+// (leftEyeSurface, rightEyeSurface) and mediaSurface is not used.
+typedef struct _VIDEO_FRAME_SLOT
+{
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> mediaTexture;
+	Microsoft::WRL::ComPtr<ABI::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface> mediaSurface;
+	Microsoft::WRL::ComPtr<ABI::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface> leftEyeSurface;
+	Microsoft::WRL::ComPtr<ABI::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface> rightEyeSurface;
+} VIDEO_FRAME_SLOT;
+
+typedef ABI::Windows::Foundation::ITypedEventHandler<ABI::Windows::Media::Playback::MediaPlayer*, IInspectable*> IMediaPlayerEventHandler;
+typedef ABI::Windows::Foundation::ITypedEventHandler<ABI::Windows::Media::Playback::MediaPlayer*, ABI::Windows::Media::Playback::MediaPlayerFailedEventArgs*> IFailedEventHandler;
+typedef ABI::Windows::Foundation::ITypedEventHandler<ABI::Windows::Media::Playback::MediaPlaybackSession*, IInspectable*> IMediaPlaybackSessionEventHandler;
+typedef ABI::Windows::Foundation::ITypedEventHandler<ABI::Windows::Media::Streaming::Adaptive::AdaptiveMediaSource*, ABI::Windows::Media::Streaming::Adaptive::AdaptiveMediaSourceDownloadRequestedEventArgs*> IDownloadRequestedEventHandler;
+typedef ABI::Windows::Foundation::ITypedEventHandler<ABI::Windows::Media::Streaming::Adaptive::AdaptiveMediaSource*, ABI::Windows::Media::Streaming::Adaptive::AdaptiveMediaSourcePlaybackBitrateChangedEventArgs*> IPlaybackBitrateChangedEventHandler;
+typedef ABI::Windows::Foundation::ITypedEventHandler<ABI::Windows::Media::Streaming::Adaptive::AdaptiveMediaSource*, ABI::Windows::Media::Streaming::Adaptive::AdaptiveMediaSourceDownloadCompletedEventArgs*> IDownloadCompletedEventHandler;
+typedef ABI::Windows::Foundation::ITypedEventHandler<ABI::Windows::Media::Playback::MediaPlaybackItem*, ABI::Windows::Foundation::Collections::IVectorChangedEventArgs*> ITracksChangedEventHandler;
+typedef ABI::Windows::Foundation::ITypedEventHandler<ABI::Windows::Media::Core::TimedMetadataTrack*, ABI::Windows::Media::Core::MediaCueEventArgs*> IMediaCueEventHandler;
+
+
+// Presented surfaces are the texture Unity samples plus the frame queue feeding it, copy surfaces (frame cache
+// entries) a single slot. Textures are allocated at the frame layout of the format, GetWidth and GetHeight tell it.
+class CD3D11PlaybackSurface
+	: public IPlaybackSurface
+{
+public:
+	CD3D11PlaybackSurface(_In_ FrameFormat format, _In_ UINT32 deviceGeneration);
+	virtual ~CD3D11PlaybackSurface();
+
+	// Stereo slots are 2 slice texture arrays if isStereoArray, over/under textures otherwise
+	HRESULT Initialize(
+		_In_ const PLAYBACK_SURFACE_DESC& desc,
+		_In_ ID3D11Device* pD3DDevice,
+		_In_ ID3D11Device* pMediaDevice,
+		_In_ bool isStereoArray);
+
+	virtual UINT32 GetWidth() const override { return m_textureDesc.Width; }
+	virtual UINT32 GetHeight() const override { return m_textureDesc.Height; }
+	virtual bool IsStereoscopic() const override { return m_isStereoscopic; }
+	virtual FrameFormat GetFrameFormat() const override { return m_format; }
+
+	bool IsStereoArray() const { return m_isStereoArray; }
+	UINT32 GetDeviceGeneration() const { return m_deviceGeneration; }
+
+	// Writers, serialized by the player: the slot the next frame goes to, null if the render thread holds every one
+	VIDEO_FRAME_SLOT* BeginWrite();
+	void Publish();
+
+	// The frame written last, null if there is none; writer side only
+	const VIDEO_FRAME_SLOT* GetFrame();
+
+	// Stereo fallback when MediaPlayer can not render into array slices: eyes go to these and are copied to the slot.
+	// Created on first use, on the media device.
+	HRESULT GetEyeTextures(
+		_In_ ID3D11Device* pMediaDevice,
+		_Outptr_ ID3D11Texture2D** ppLeftEyeTexture,
+		_Outptr_ ABI::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface** ppLeftEyeSurface,
+		_Outptr_ ID3D11Texture2D** ppRightEyeTexture,
+		_Outptr_ ABI::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface** ppRightEyeSurface);
+
+	// Render thread: copies the latest frame to the texture Unity samples, if there is a new one
+	void Present();
+
+	ID3D11ShaderResourceView* GetLumaView() const { return m_primaryTextureSRV.Get(); }
+	ID3D11ShaderResourceView* GetChromaView() const { return m_chromaTextureSRV.Get(); }	// native formats only
+
+	void GetFrameQueueStats(_Out_ FRAME_QUEUE_STATS* pStats);
+
+private:
+	HRESULT CreateFrameSlot(_In_ ID3D11Device* pD3DDevice, _In_ ID3D11Device* pMediaDevice, _Inout_ VIDEO_FRAME_SLOT* pSlot);
+
+private:
+	SurfaceUsage m_usage;
+	FrameFormat m_format;
+	bool m_isStereoscopic;
+	bool m_isStereoArray;
+	UINT32 m_deviceGeneration;
+	CD3D11_TEXTURE2D_DESC m_textureDesc;
+
+	// presented surfaces only, the texture Unity samples is only written by the render thread, so it is not shared
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> m_primaryTexture;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_primaryTextureSRV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_chromaTextureSRV;
+	CFrameQueue<VIDEO_FRAME_SLOT> m_frameQueue;
+
+	// copy surfaces only
+	VIDEO_FRAME_SLOT m_frame;
+	bool m_hasFrame;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> m_leftEyeTexture;
+	Microsoft::WRL::ComPtr<ABI::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface> m_leftEyeSurface;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> m_rightEyeTexture;
+	Microsoft::WRL::ComPtr<ABI::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface> m_rightEyeSurface;
+};
+
+
+class CMediaPlayerSession;
+
+class CMediaPlayerBackend
+	: public IPlaybackBackend
+	, public SharedFromThis
+{
+public:
+	CMediaPlayerBackend();
+	virtual ~CMediaPlayerBackend();
+
+	// Takes the media device of the adapter of Unity's device and reads its decoder capabilities
+	HRESULT DeviceReady(_In_ IUnityGraphicsD3D11* pUnityGraphics);
+	void DeviceShutdown();
+
+	IUnityGraphicsD3D11* GetUnityGraphics() const { return m_pUnityGraphics; }
+
+	// Render thread: shows the latest frame of a surface of any backend, unless it belongs to a lost device
+	static void Present(_In_ IPlaybackSurface* pSurface);
+
+	// Runs fnRender with the media device locked through the DXGI device manager of its adapter, frame threads of the
+	// players on the adapter take turns on it. The device is flushed before the lock is released, Unity's device
+	// reads what was rendered right after.
+	HRESULT RunOnMediaDevice(_In_ const std::function<HRESULT(ID3D11Device*, ID3D11DeviceContext*)>& fnRender);
+
+	// Set once MediaPlayer failed to render into texture array slices: later stereo surfaces are over/under, frames
+	// of the array surfaces created before go through the eye textures
+	bool IsStereoArrayUnsupported() const { return m_stereoArrayUnsupported; }
+	void SetStereoArrayUnsupported() { m_stereoArrayUnsupported = true; }
+
+	// Adaptive streams download lookAhead (100ns) of segments ahead of the media source, at most maxInFlight at a
+	// time, 0 disables it. Applies to the sessions opening content later, and to the current ones if they prefetch.
+	HRESULT SetSegmentPrefetch(_In_ INT64 lookAhead, _In_ UINT32 maxInFlight);
+	void GetSegmentPrefetch(_Out_ INT64* pLookAhead, _Out_ UINT32* pMaxInFlight);
+	// summed over the sessions, bufferAhead is the largest; S_FALSE if none prefetches
+	HRESULT GetSegmentPrefetchStats(_Out_ SEGMENT_PREFETCH_STATS* pStats);
+
+	// Applies to the adaptive streams of every session right away and to the ones opened later
+	HRESULT SetAbrPolicy(_In_ AbrPolicy policy);
+	AbrPolicy GetAbrPolicy() const { return m_abrPolicy; }
+
+	// IPlaybackBackend
+	virtual HRESULT CreateSession(
+		_In_ IPlaybackSessionSink* pSink,
+		_Out_ std::shared_ptr<IPlaybackSession>* ppSession) override;
+
+	// Falls back to BGRA for native formats the devices do not support
+	virtual HRESULT CreateSurface(
+		_In_ const PLAYBACK_SURFACE_DESC& desc,
+		_Out_ std::shared_ptr<IPlaybackSurface>* ppSurface) override;
+
+	// Fails with E_PENDING if the destination has no free slot, like a frame of a session
+	virtual HRESULT CopySurface(
+		_In_ IPlaybackSurface* pSource,
+		_In_ IPlaybackSurface* pDestination) override;
+
+	virtual HRESULT GetDecoderCapabilities(_Out_ CDecoderCapabilities* pCapabilities) override;
+
+	virtual HRESULT GetKeyframeIndex(
+		_In_ const wchar_t* pszContentLocation,
+		_Out_ std::shared_ptr<const CKeyframeIndex>* pIndex) override;
+
+	// Source Reader decoder; a complete atlas is kept under the temp folder of the app
+	virtual HRESULT OpenThumbnailSource(
+		_In_ const wchar_t* pszContentLocation,
+		_Out_ THUMBNAIL_SOURCE* pSource) override;
+
+	// Segment cache shared by all players, disabled if pszDirectory is null
+	static HRESULT EnableSegmentCache(
+		_In_opt_ LPCWSTR pszDirectory,
+		_In_ UINT64 budgetBytes);
+	static HRESULT GetSegmentCacheStats(
+		_Out_ SEGMENT_CACHE_STATS* pStats);
+	static void ShutdownSegmentCache();
+
+	// Media devices shared by all players, one per adapter; dropped on a graphics device loss
+	static void GetMediaDeviceStats(
+		_Out_ MEDIA_DEVICE_STATS* pStats);
+	static void ShutdownMediaDevices();
+	static void ReadyMediaDevices();
+
+private:
+	friend class CMediaPlayerSession;
+
+	void CloseMediaDeviceHandle();
+	void ReleaseDevices();
+	std::vector<std::shared_ptr<CMediaPlayerSession>> GetSessions();
+
+	static HRESULT StartSegmentWorkers();	// m_segmentCacheMutex must be held
+	static HRESULT SubmitSegmentTask(_In_ const CWorkerPool::Task& task);
+	// prefetcher downloads, served from the segment cache when it is enabled and stored in it otherwise
+	static HRESULT FetchSegment(_In_ const SEGMENT_KEY& key, _In_ const std::function<bool()>& fnIsCancelled, _Out_ SegmentData* pData);
+	static HRESULT ServeSegmentFromCache(
+		_In_ const SEGMENT_KEY& key,
+		_In_ ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSourceDownloadResult* pResult,
+		_In_ ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSourceDownloadRequestedDeferral* pDeferral);
+
+	static HRESULT GetDecoderCapabilities(_In_ IDXGIAdapter* pAdapter, _In_ ID3D11Device* pMediaDevice, _Out_ CDecoderCapabilities* pCapabilities);
+
+private:
+	IUnityGraphicsD3D11* m_pUnityGraphics;
+
+	// under m_deviceLock, which frame threads hold while they render
+	std::mutex m_deviceLock;
+	Microsoft::WRL::ComPtr<ID3D11Device> m_d3dDevice;
+	Microsoft::WRL::ComPtr<ID3D11Device> m_mediaDevice;
+	std::shared_ptr<IMediaDevice> m_spSharedMediaDevice;	// the m_mediaDevices reference m_mediaDevice comes from
+	Microsoft::WRL::ComPtr<IMFDXGIDeviceManager> m_spDeviceManager;	// of the adapter of m_mediaDevice
+	HANDLE m_hMediaDevice;									// to m_mediaDevice, opened on m_spDeviceManager
+
+	// hardware decoders of the media device adapter
+	CDecoderCapabilities m_decoderCapabilities;
+	std::mutex m_capabilitiesLock;
+
+	std::atomic<bool> m_stereoArrayUnsupported;
+
+	std::mutex m_sessionsLock;
+	std::vector<std::weak_ptr<CMediaPlayerSession>> m_sessions;
+	INT64 m_prefetchLookAhead;				// under m_sessionsLock
+	UINT32 m_prefetchMaxInFlight;
+	std::atomic<AbrPolicy> m_abrPolicy;
+
+private:
+	// serves AdaptiveMediaSource segment downloads, shared by all players; the workers download cache misses
+	static std::shared_ptr<CSegmentCache> m_spSegmentCache;
+	static CWorkerPool* m_pSegmentWorkers;
+	static std::mutex m_segmentCacheMutex;
+
+	// probed once per adapter and driver, then read from the disk cache by later sessions
+	static std::map<std::wstring, CDecoderCapabilities> m_decoderCapabilityProfiles;
+	static std::mutex m_decoderCapabilitiesMutex;
+
+	// one media device and DXGI device manager registration per adapter instead of one per player
+	static CMediaDeviceService m_mediaDevices;
+
+	// Unity's device is shared by every backend, surfaces of a lost one are not rendered to or presented
+	static std::atomic<UINT32> m_deviceGeneration;
+};
+
+
+// MediaPlayer and the item playing on it. WinRT handlers only hold the session weakly, it goes away with the last
+// reference of the player. Close() releases the MediaPlayer and creates a new one, the session is opened again.
+class CMediaPlayerSession
+	: public IPlaybackSession
+	, public SharedFromThis
+{
+public:
+	CMediaPlayerSession(_In_ const std::shared_ptr<CMediaPlayerBackend>& spBackend, _In_ IPlaybackSessionSink* pSink);
+	virtual ~CMediaPlayerSession();
+
+	HRESULT Initialize();
+
+	HRESULT GetMediaPlayer(_COM_Outptr_ ABI::Windows::Media::Playback::IMediaPlayer** ppMediaPlayer);
+
+	void SetSegmentPrefetch(_In_ INT64 lookAhead, _In_ UINT32 maxInFlight);
+	HRESULT GetSegmentPrefetchStats(_Out_ SEGMENT_PREFETCH_STATS* pStats);
+	HRESULT SetAbrPolicy(_In_ AbrPolicy policy);
+
+	// IPlaybackSession
+	virtual HRESULT Open(_In_ const wchar_t* pszContentLocation) override;
+	virtual HRESULT Close() override;
+	virtual bool HasSource() const override;
+
+	virtual HRESULT Play() override;
+	virtual HRESULT Pause() override;
+	virtual HRESULT Seek(_In_ LONGLONG position) override;
+	virtual HRESULT SetVolume(_In_ DOUBLE volume) override;
+	virtual HRESULT SetPlaybackRate(_In_ DOUBLE rate) override;
+
+	// MediaPlayer loops the whole media itself; a range is sought back to its start one frame before its end
+	virtual HRESULT SetLoop(_In_ bool enabled, _In_ LONGLONG start, _In_ LONGLONG end) override;
+
+	virtual PlaybackState GetPlaybackState() const override;
+	virtual HRESULT GetDurationAndPosition(_Out_ LONGLONG* duration, _Out_ LONGLONG* position) const override;
+	virtual HRESULT GetNaturalVideoSize(_Out_ UINT32* width, _Out_ UINT32* height) const override;
+	virtual bool CanSeek() const override;
+	virtual bool IsStereoscopic() const override;
+
+	// The core sets the bitrates right after Open returns, MediaPlayer is still opening the item asynchronously then
+	virtual HRESULT GetAvailableBitrates(_Out_ std::vector<UINT32>* bitrates) const override;
+	virtual HRESULT SetInitialBitrate(_In_ UINT32 bitrate) override;
+	virtual HRESULT SetDesiredMaxBitrate(_In_ UINT32 bitrate) override;
+	virtual UINT32 GetCurrentBitrate() const override;
+
+	// IMediaPlaybackSession2 (SDK 17134+) reports them; before that only the progress of a progressive download is known
+	virtual HRESULT GetBufferedRanges(_Out_ std::vector<MEDIA_TIME_RANGE>* ranges) const override;
+
+	// The manifest renditions of adaptive streams once it has been read, the rendition playing selected
+	virtual HRESULT GetVideoTracks(_Out_ std::vector<VIDEO_TRACK_INFO>* tracks, _Out_ INT32* selectedIndex) const override;
+	virtual HRESULT SelectVideoTrack(_In_ INT32 index) override;
+
+	virtual HRESULT GetSubtitleTracks(_Out_ std::vector<SUBTITLE_TRACK>* tracks) const override;
+
+	virtual HRESULT CopyFrameToSurface(_In_ IPlaybackSurface* pSurface) override;
+
+private:
+	// Callbacks - IMediaPlayer2
+	HRESULT OnOpened(
+		_In_ ABI::Windows::Media::Playback::IMediaPlayer* sender,
+		_In_ IInspectable* args);
+	HRESULT OnEnded(
+		_In_ ABI::Windows::Media::Playback::IMediaPlayer* sender,
+		_In_ IInspectable* args);
+	HRESULT OnFailed(
+		_In_ ABI::Windows::Media::Playback::IMediaPlayer* sender,
+		_In_ ABI::Windows::Media::Playback::IMediaPlayerFailedEventArgs* args);
+
+	// Callbacks - IMediaPlayer5 - frameserver
+	HRESULT OnVideoFrameAvailable(
+		_In_ ABI::Windows::Media::Playback::IMediaPlayer* sender,
+		_In_ IInspectable* args);
+
+	// Callbacks - IMediaPlaybackSession
+	HRESULT OnStateChanged(
+		_In_ ABI::Windows::Media::Playback::IMediaPlaybackSession* sender,
+		_In_ IInspectable* args);
+	HRESULT OnSizeChanged(
+		_In_ ABI::Windows::Media::Playback::IMediaPlaybackSession* sender,
+		_In_ IInspectable* args);
+	HRESULT OnStatusChanged(
+		_In_ ABI::Windows::Media::Playback::IMediaPlaybackSession* sender,
+		_In_ IInspectable* args);
+
+	HRESULT OnDownloadRequested(
+		_In_ ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSource* sender,
+		_In_ ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSourceDownloadRequestedEventArgs* args);
+	HRESULT OnPlaybackBitrateChanged(
+		_In_ ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSource* sender,
+		_In_ ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSourcePlaybackBitrateChangedEventArgs* args);
+	HRESULT OnDownloadCompleted(
+		_In_ ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSource* sender,
+		_In_ ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSourceDownloadCompletedEventArgs* args);
+
+	HRESULT OnVideoTracksChanged(_In_ ABI::Windows::Media::Playback::IMediaPlaybackItem* pItem, _In_ ABI::Windows::Foundation::Collections::IVectorChangedEventArgs* pArgs);
+	HRESULT OnTimedMetadataTracksChanged(_In_ ABI::Windows::Media::Playback::IMediaPlaybackItem* pItem, _In_ ABI::Windows::Foundation::Collections::IVectorChangedEventArgs* pArgs);
+	HRESULT OnCueEntered(_In_ ABI::Windows::Media::Core::ITimedMetadataTrack* pTrack, _In_ ABI::Windows::Media::Core::IMediaCueEventArgs* pArgs);
+	HRESULT OnCueExited(_In_ ABI::Windows::Media::Core::ITimedMetadataTrack* pTrack, _In_ ABI::Windows::Media::Core::IMediaCueEventArgs* pArgs);
+
+	template <typename THandler, typename TSender, typename TArgs>
+	Microsoft::WRL::ComPtr<THandler> MakeHandler(_In_ HRESULT (CMediaPlayerSession::*pfnHandler)(TSender, TArgs));
+
+private:
+	HRESULT CreateMediaPlayer();
+	void ReleaseMediaPlayer();
+	HRESULT AddStateChanged();				// m_lock must be held
+	void RemoveStateChanged();				// m_lock must be held
+	void ReleaseSubtitleTracks();			// m_lock must be held
+
+	HRESULT SetMediaSource(_In_ ABI::Windows::Media::Core::IMediaSource2* pMediaSource, _In_ LPCWSTR pszContentLocation);
+
+	// media device locked, pSlot is the slot of pSurface the frame goes to
+	HRESULT RenderFrame(
+		_In_ ABI::Windows::Media::Playback::IMediaPlayer5* pMediaPlayer5,
+		_In_ CD3D11PlaybackSurface* pSurface,
+		_In_ VIDEO_FRAME_SLOT* pSlot,
+		_In_ ID3D11Device* pMediaDevice,
+		_In_ ID3D11DeviceContext* pContext);
+
+	HRESULT UpdateVideoTracks();
+	HRESULT StartManifestRead(_In_ LPCWSTR pszManifestLocation);
+	void ApplyRenditions(_In_ const std::vector<RENDITION_INFO>& renditions, _In_ UINT32 sourceGeneration);
+	HRESULT ApplyBitrateCap(_In_ UINT32 bitrateCap);	// m_abrLock must be held
+	void ResetAbrController(_In_ const std::vector<UINT32>& bitrates, _In_ UINT32 bitrateCap);	// m_abrLock must be held
+	HRESULT ApplyAbrBitrate(_In_ UINT32 bitrate);	// m_abrLock must be held
+	void StopSegmentPrefetch();
+
+private:
+	std::shared_ptr<CMediaPlayerBackend> m_spBackend;
+	IPlaybackSessionSink* m_pSink;
+
+	std::atomic<bool> m_bIgnoreEvents;		// while the source is taken away
+	std::atomic<bool> m_hasSource;
+
+	// the players and the item, handlers call WinRT on copies taken under the lock
+	mutable std::mutex m_lock;
+	Microsoft::WRL::ComPtr<ABI::Windows::Media::Playback::IMediaPlayer> m_mediaPlayer;
+	Microsoft::WRL::ComPtr<ABI::Windows::Media::Playback::IMediaPlayer3> m_mediaPlayer3;
+	Microsoft::WRL::ComPtr<ABI::Windows::Media::Playback::IMediaPlayer5> m_mediaPlayer5;
+	Microsoft::WRL::ComPtr<ABI::Windows::Media::Playback::IMediaPlaybackSession> m_mediaPlaybackSession;
+	Microsoft::WRL::ComPtr<ABI::Windows::Media::Playback::IMediaPlaybackItem> m_spPlaybackItem;
+
+	EventRegistrationToken m_openedEventToken;
+	EventRegistrationToken m_endedEventToken;
+	EventRegistrationToken m_failedEventToken;
+	EventRegistrationToken m_videoFrameAvailableToken;
+	EventRegistrationToken m_stateChangedEventToken;
+	EventRegistrationToken m_sizeChangedEventToken;
+	EventRegistrationToken m_durationChangedEventToken;
+	EventRegistrationToken m_positionChangedEventToken;
+	EventRegistrationToken m_bufferedRangesChangedEventToken;
+	EventRegistrationToken m_videoTracksChangedEventToken;
+	EventRegistrationToken m_timedMetadataChangedEventToken;
+
+	DOUBLE m_volume;						// under m_lock, carried over to the next MediaPlayer
+	std::vector<VIDEO_TRACK_INFO> m_videoTracks;	// of the item, under m_lock
+	INT32 m_selectedVideoTrack;
+
+	// application presented subtitle tracks of the item and the cue handlers registered on them, under m_lock
+	std::vector<SUBTITLE_TRACK> m_subtitleTracks;
+	std::vector<Microsoft::WRL::ComPtr<ABI::Windows::Media::Core::ITimedMetadataTrack>> m_subtitleTrackObjects;
+	std::vector<EventRegistrationToken> m_cueEnteredTokens;
+	std::vector<EventRegistrationToken> m_cueExitedTokens;
+
+	// seeks a range loop back to its start, fed with the position of every frame on the frame thread
+	CLoopTracker m_loopTracker;
+	std::mutex m_loopLock;
+
+	// adaptive source, ABR and rendition state
+	Microsoft::WRL::ComPtr<ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSource> m_spAdaptiveMediaSource;
+	EventRegistrationToken m_downloadRequestedEventToken;
+	EventRegistrationToken m_bitrateChangedEventToken;
+	EventRegistrationToken m_downloadCompletedEventToken;
+	std::unique_ptr<IAbrController> m_spAbrController;
+	std::vector<UINT32> m_availableBitrates;	// of the adaptive source, uncapped
+	std::vector<UINT32> m_abrBitrates;		// ascending, up to m_abrBitrateCap
+	UINT32 m_abrBitrateCap;					// bitrate of the selected rendition, 0 if the highest
+	UINT32 m_abrBitrate;					// applied last, 0 if none
+	AbrPolicy m_abrPolicy;
+	std::vector<RENDITION_INFO> m_renditions;	// of the adaptive source manifest, empty until it has been read
+	UINT32 m_playingBitrate;				// 0 while not known
+	std::atomic<UINT32> m_sourceGeneration;	// changes with every manifest read, so reads for an older source are dropped
+	mutable std::mutex m_abrLock;
+
+	// downloads segments of the current adaptive source ahead of it, on the segment workers
+	std::shared_ptr<CSegmentPrefetcher> m_spSegmentPrefetcher;
+	std::mutex m_segmentPrefetchLock;
+	INT64 m_prefetchLookAhead;
+	UINT32 m_prefetchMaxInFlight;
+};
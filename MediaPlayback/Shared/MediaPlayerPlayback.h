@@ -11,82 +11,30 @@
 #pragma once
 
 #include <vector>
-#include <string>
+#include <memory>
 #include <mutex>
 
+#include "MediaPlayerBackend.h"
 
-enum class StateType : UINT32
-{
-    StateType_None = 0,
-    StateType_Opened,
-    StateType_StateChanged,
-    StateType_Failed,
-	StateType_NewFrameTexture,
-	StateType_GraphicsDeviceShutdown,
-	StateType_GraphicsDeviceReady
-};
-
-enum class PlaybackState : UINT32
-{
-    PlaybackState_None = 0,
-    PlaybackState_Opening,
-    PlaybackState_Buffering,
-    PlaybackState_Playing,
-    PlaybackState_Paused,
-    PlaybackState_Ended, 
-	PlaybackState_NA = 255
-};
-
-#pragma pack(push, 8)
-typedef struct _MEDIA_DESCRIPTION
-{
-    UINT32 width;
-    UINT32 height;
-    INT64 duration;
-    byte canSeek;
-	byte isStereoscopic;
-} MEDIA_DESCRIPTION;
-#pragma pack(pop)
-
-#pragma pack(push, 8)
-typedef struct _PLAYBACK_STATE
-{
-    StateType type;
-	PlaybackState state;
-	HRESULT hresult;
-	MEDIA_DESCRIPTION description;
-} PLAYBACK_STATE;
-#pragma pack(pop)
-
-typedef struct _SUBTITLE_TRACK
-{
-	std::wstring id;
-	std::wstring title;
-	std::wstring language;
-} SUBTITLE_TRACK;
+// the core uses std::enable_shared_from_this, which pch.h bans for the plugin code
+#pragma push_macro("enable_shared_from_this")
+#undef enable_shared_from_this
+#include "Core/PlaybackCore.h"
+#include "Core/SharedPlaybackBackend.h"
+#include "Core/SlotMap.h"
+#include "Core/RcuSnapshot.h"
+#pragma pop_macro("enable_shared_from_this")
 
-extern "C" typedef void(UNITY_INTERFACE_API *StateChangedCallback)(
-	_In_ void* pClientObject,
-    _In_ PLAYBACK_STATE args);
 
+// What Unity holds for a player. Handles of released players are rejected, they never reach a freed object.
+typedef UINT_PTR PLAYBACK_HANDLE;
 
-extern "C" typedef void(UNITY_INTERFACE_API *SubtitleItemEnteredCallback)(
-	_In_ void* pClientObject, _In_ const wchar_t* subtitlesTrackId, _In_ const wchar_t* textCueId, _In_ const wchar_t* language, _In_ const wchar_t** textLines, _In_ unsigned int lineCount);
-
-extern "C" typedef void(UNITY_INTERFACE_API *SubtitleItemExitedCallback)(
-	_In_ void* pClientObject, _In_ const wchar_t* subtitlesTrackId, _In_ const wchar_t* textCueId);
-
-
-typedef ABI::Windows::Foundation::ITypedEventHandler<ABI::Windows::Media::Playback::MediaPlayer*, IInspectable*> IMediaPlayerEventHandler;
-typedef ABI::Windows::Foundation::ITypedEventHandler<ABI::Windows::Media::Playback::MediaPlayer*, ABI::Windows::Media::Playback::MediaPlayerFailedEventArgs*> IFailedEventHandler;
-typedef ABI::Windows::Foundation::ITypedEventHandler<ABI::Windows::Media::Playback::MediaPlaybackSession*, IInspectable*> IMediaPlaybackSessionEventHandler;
-typedef ABI::Windows::Foundation::ITypedEventHandler<ABI::Windows::Media::Streaming::Adaptive::AdaptiveMediaSource*, ABI::Windows::Media::Streaming::Adaptive::AdaptiveMediaSourceDownloadRequestedEventArgs*> IDownloadRequestedEventHandler;
-typedef ABI::Windows::Foundation::ITypedEventHandler<ABI::Windows::Media::Playback::MediaPlaybackItem*, ABI::Windows::Foundation::Collections::IVectorChangedEventArgs*> ITracksChangedEventHandler;
-typedef ABI::Windows::Foundation::ITypedEventHandler<ABI::Windows::Media::Core::TimedMetadataTrack*, ABI::Windows::Media::Core::MediaCueEventArgs*> IMediaCueEventHandler;
-
-DECLARE_INTERFACE_IID_(IMediaPlayerPlayback, IUnknown, "9669c78e-42c4-4178-a1e3-75b03d0f8c9a")
+// The vtable grew past that of 9669c78e-42c4-4178-a1e3-75b03d0f8c9a; any change to it takes a new IID
+DECLARE_INTERFACE_IID_(IMediaPlayerPlayback, IUnknown, "9e5b765f-2ee7-436e-a559-8698a8ff340b")
 {
     STDMETHOD(LoadContent)(_In_ LPCWSTR pszContentLocation) PURE;
+    STDMETHOD(LoadContentAsync)(_In_ LPCWSTR pszContentLocation, _Out_ UINT32* pRequestId) PURE;
+    STDMETHOD(CancelLoadContentAsync)() PURE;
     STDMETHOD(Play)() PURE;
     STDMETHOD(Pause)() PURE;
     STDMETHOD(Stop)() PURE;
@@ -99,6 +47,35 @@ DECLARE_INTERFACE_IID_(IMediaPlayerPlayback, IUnknown, "9669c78e-42c4-4178-a1e3-
 	STDMETHOD(GetSubtitlesTrackCount)(_Out_ unsigned int* count) PURE;
 	STDMETHOD(GetSubtitlesTrack)(_In_ unsigned int index, _Out_ const wchar_t** trackId, _Out_ const wchar_t** trackLabel, _Out_ const wchar_t** trackLanguage) PURE;
 	STDMETHOD(SetSubtitlesCallbacks)(_In_ SubtitleItemEnteredCallback fnEnteredCallback, _In_ SubtitleItemExitedCallback fnExitedCallback) PURE;
+	STDMETHOD(GetFrameQueueStats)(_Out_ FRAME_QUEUE_STATS* pStats) PURE;
+	STDMETHOD(DrainEvents)(_Out_writes_to_(capacity, *pCount) PLAYBACK_STATE* pEvents, _In_ UINT32 capacity, _Out_ UINT32* pCount) PURE;
+	STDMETHOD(GetEventQueueStats)(_Out_ EVENT_QUEUE_STATS* pStats) PURE;
+	STDMETHOD(GetPlaybackStatus)(_Out_ const PLAYBACK_STATUS** ppStatus) PURE;
+	STDMETHOD(GetTexturePoolStats)(_Out_ SURFACE_POOL_STATS* pStats) PURE;
+	STDMETHOD(SetTexturePoolBudget)(_In_ UINT64 budgetBytes) PURE;
+	STDMETHOD(SetPreferredFrameFormat)(_In_ FrameFormat format) PURE;
+	STDMETHOD(GetPlaybackPlaneTextures)(_Out_ IUnknown** lumaTexturePtr, _Out_ IUnknown** chromaTexturePtr, _Out_ FrameFormat* pFormat) PURE;
+	STDMETHOD(SetSegmentPrefetch)(_In_ INT64 lookAhead, _In_ UINT32 maxInFlight) PURE;
+	STDMETHOD(GetSegmentPrefetchStats)(_Out_ SEGMENT_PREFETCH_STATS* pStats) PURE;
+	STDMETHOD(SetAbrPolicy)(_In_ AbrPolicy policy) PURE;
+	STDMETHOD(SetRenditionConstraints)(_In_ UINT32 viewportWidth, _In_ UINT32 viewportHeight, _In_ PowerBudget powerBudget) PURE;
+	STDMETHOD(SeekWithMode)(_In_ LONGLONG position, _In_ SeekMode mode) PURE;
+	STDMETHOD(StartThumbnailExtraction)(_In_ UINT32 tileWidth, _In_ UINT32 tileHeight, _In_ INT64 interval) PURE;
+	STDMETHOD(StopThumbnailExtraction)() PURE;
+	STDMETHOD(GetThumbnailAtlasInfo)(_Out_ THUMBNAIL_ATLAS_INFO* pInfo) PURE;
+	STDMETHOD(GetThumbnailAtlas)(_Out_writes_(size) BYTE* pBuffer, _In_ UINT32 size, _Out_ THUMBNAIL_ATLAS_INFO* pInfo) PURE;
+	STDMETHOD(PlaylistInsert)(_In_ UINT32 index, _In_ LPCWSTR pszContentLocation, _Out_ UINT32* pId) PURE;
+	STDMETHOD(PlaylistRemove)(_In_ UINT32 id) PURE;
+	STDMETHOD(PlaylistNext)() PURE;
+	STDMETHOD(GetPlaylistStats)(_Out_ PLAYLIST_STATS* pStats) PURE;
+	STDMETHOD(SetLoop)(_In_ BOOL enabled, _In_ INT64 start, _In_ INT64 end) PURE;
+	STDMETHOD(GetLoopStats)(_Out_ LOOP_STATS* pStats) PURE;
+	STDMETHOD(SetPlaybackRate)(_In_ DOUBLE rate) PURE;
+	STDMETHOD(StepFrame)(_In_ INT32 frames) PURE;
+	STDMETHOD(GetFrameSchedulerStats)(_Out_ FRAME_SCHEDULER_STATS* pStats) PURE;
+	STDMETHOD(SetFrameCacheBudget)(_In_ UINT64 budgetBytes) PURE;
+	STDMETHOD(GetFrameCacheStats)(_Out_ FRAME_CACHE_STATS* pStats) PURE;
+	STDMETHOD(SetSourceSharing)(_In_ BOOL enabled) PURE;
 };
 
 class CMediaPlayerPlayback
@@ -112,24 +89,53 @@ public:
 	static void GraphicsDeviceShutdown();
 	static void GraphicsDeviceReady(IUnityInterfaces* pUnityInterfaces);
 	static void UnityRenderEvent();
+	static void ShutdownLoadWorkers();
+	static void ShutdownThumbnailWorkers();
+
+	// Segment cache shared by all players, disabled if pszDirectory is null
+	static HRESULT EnableSegmentCache(
+		_In_opt_ LPCWSTR pszDirectory,
+		_In_ UINT64 budgetBytes);
+	static HRESULT GetSegmentCacheStats(
+		_Out_ SEGMENT_CACHE_STATS* pStats);
+	static void ShutdownSegmentCache();
+
+	// Media devices shared by all players, one per adapter
+	static void GetMediaDeviceStats(
+		_Out_ MEDIA_DEVICE_STATS* pStats);
+
+	// Decodes shared between players with source sharing enabled
+	static void GetSharedSourceStats(
+		_Out_ SHARED_SOURCE_STATS* pStats);
 
     static HRESULT CreateMediaPlayback(
         _In_ UnityGfxRenderer apiType, 
         _In_ IUnityInterfaces* pUnityInterfaces, 
-        _In_ StateChangedCallback fnCallback,
+        _In_opt_ StateChangedCallback fnCallback,
 		_In_ void* pClientObject, 
-        _COM_Outptr_ IMediaPlayerPlayback** ppMediaPlayback);
+        _Out_ PLAYBACK_HANDLE* phPlayback);
+
+	// Fails with E_HANDLE for released or unknown handles
+	static HRESULT GetPlayback(
+		_In_ PLAYBACK_HANDLE hPlayback,
+		_COM_Outptr_ IMediaPlayerPlayback** ppMediaPlayback);
+
+	// Invalidates the handle and releases the reference CreateMediaPlayback has handed out
+	static HRESULT ReleasePlayback(
+		_In_ PLAYBACK_HANDLE hPlayback);
 
     CMediaPlayerPlayback();
     ~CMediaPlayerPlayback();
 
     HRESULT RuntimeClassInitialize(
-        _In_ StateChangedCallback fnCallback,
+        _In_opt_ StateChangedCallback fnCallback,
 		_In_ void* pClientObject, 
         _In_ IUnityGraphicsD3D11* pUnityDevice);
 
     // IMediaPlayerPlayback
     IFACEMETHOD(LoadContent)(_In_ LPCWSTR pszContentLocation);
+    IFACEMETHOD(LoadContentAsync)(_In_ LPCWSTR pszContentLocation, _Out_ UINT32* pRequestId);
+    IFACEMETHOD(CancelLoadContentAsync)();
 
     IFACEMETHOD(Play)();
     IFACEMETHOD(Pause)();
@@ -148,121 +154,125 @@ public:
 	IFACEMETHOD(GetSubtitlesTrack)(_In_ unsigned int index, _Out_ const wchar_t** trackId, _Out_ const wchar_t** trackLabel, _Out_ const wchar_t** trackLanguage);
 	IFACEMETHOD(SetSubtitlesCallbacks)(_In_ SubtitleItemEnteredCallback fnEnteredCallback, _In_ SubtitleItemExitedCallback fnExitedCallback);
 
-protected:
-    // Callbacks - IMediaPlayer2
-    HRESULT OnOpened(
-        _In_ ABI::Windows::Media::Playback::IMediaPlayer* sender,
-        _In_ IInspectable* args);
-    HRESULT OnEnded(
-        _In_ ABI::Windows::Media::Playback::IMediaPlayer* sender,
-        _In_ IInspectable* args);
-    HRESULT OnFailed(
-        _In_ ABI::Windows::Media::Playback::IMediaPlayer* sender,
-        _In_ ABI::Windows::Media::Playback::IMediaPlayerFailedEventArgs* args);
-
-    // Callbacks - IMediaPlayer5 - frameserver
-    HRESULT OnVideoFrameAvailable(
-        _In_ ABI::Windows::Media::Playback::IMediaPlayer* sender,
-        _In_ IInspectable* args);
-
-    // Callbacks - IMediaPlaybackSession
-    HRESULT OnStateChanged(
-        _In_ ABI::Windows::Media::Playback::IMediaPlaybackSession* sender,
-        _In_ IInspectable* args);
-	HRESULT OnSizeChanged(
-		_In_ ABI::Windows::Media::Playback::IMediaPlaybackSession* sender,
-		_In_ IInspectable* args);
-
-	HRESULT OnDownloadRequested(
-		_In_ ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSource* sender,
-		_In_ ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSourceDownloadRequestedEventArgs* args);
-
-	HRESULT OnVideoTracksChanged(ABI::Windows::Media::Playback::IMediaPlaybackItem* pItem, ABI::Windows::Foundation::Collections::IVectorChangedEventArgs* pArgs);
-	HRESULT OnTimedMetadataTracksChanged(ABI::Windows::Media::Playback::IMediaPlaybackItem* pItem, ABI::Windows::Foundation::Collections::IVectorChangedEventArgs* pArgs);
-	HRESULT OnCueEntered(ABI::Windows::Media::Core::ITimedMetadataTrack* pTrack, ABI::Windows::Media::Core::IMediaCueEventArgs* pArgs);
-	HRESULT OnCueExited(ABI::Windows::Media::Core::ITimedMetadataTrack* pTrack, ABI::Windows::Media::Core::IMediaCueEventArgs* pArgs);
+	IFACEMETHOD(GetFrameQueueStats)(_Out_ FRAME_QUEUE_STATS* pStats);
+
+	// States are queued instead of calling back when the player was created without a StateChangedCallback
+	IFACEMETHOD(DrainEvents)(_Out_writes_to_(capacity, *pCount) PLAYBACK_STATE* pEvents, _In_ UINT32 capacity, _Out_ UINT32* pCount);
+	IFACEMETHOD(GetEventQueueStats)(_Out_ EVENT_QUEUE_STATS* pStats);
+
+	// The block stays valid until the player is released and is updated by the media threads
+	IFACEMETHOD(GetPlaybackStatus)(_Out_ const PLAYBACK_STATUS** ppStatus);
+
+	// Textures of previous video sizes are kept up to the budget (bytes) and reused when the size comes back
+	IFACEMETHOD(GetTexturePoolStats)(_Out_ SURFACE_POOL_STATS* pStats);
+	IFACEMETHOD(SetTexturePoolBudget)(_In_ UINT64 budgetBytes);
+
+	// Native formats leave YUV to RGB to the material. Applies from the next frame texture (StateType_NewFrameTexture),
+	// MEDIA_DESCRIPTION::frameFormat tells which format was picked. GetPlaybackTexture returns the luma plane then.
+	IFACEMETHOD(SetPreferredFrameFormat)(_In_ FrameFormat format);
+	IFACEMETHOD(GetPlaybackPlaneTextures)(_Out_ IUnknown** lumaTexturePtr, _Out_ IUnknown** chromaTexturePtr, _Out_ FrameFormat* pFormat);
+
+	// Adaptive streams download lookAhead (100ns) of segments ahead of the media source, at most maxInFlight at a time.
+	// 0 disables prefetching. Applies to the content loaded next, and to the current one if it is prefetched already.
+	IFACEMETHOD(SetSegmentPrefetch)(_In_ INT64 lookAhead, _In_ UINT32 maxInFlight);
+	IFACEMETHOD(GetSegmentPrefetchStats)(_Out_ SEGMENT_PREFETCH_STATS* pStats);
+
+	// Applies to the current adaptive stream right away and to the ones loaded later
+	IFACEMETHOD(SetAbrPolicy)(_In_ AbrPolicy policy);
+
+	// Size of the viewport the video is shown in (0 if not known) and the decoding power budget.
+	// The video track, or the max bitrate of adaptive streams, is selected again right away.
+	IFACEMETHOD(SetRenditionConstraints)(_In_ UINT32 viewportWidth, _In_ UINT32 viewportHeight, _In_ PowerBudget powerBudget);
+
+	// Snaps the position to a keyframe of local files once their keyframe index has been built, Seek is SeekMode_Accurate
+	IFACEMETHOD(SeekWithMode)(_In_ LONGLONG position, _In_ SeekMode mode);
+
+	// Seek preview thumbnails of the current source, one per interval (100ns), decoded in the background into a BGRA
+	// sprite atlas of tileWidth x tileHeight tiles. Tiles appear coarse to fine as they are decoded; a complete atlas
+	// is kept on disk and loaded the next time the same source asks for the same layout.
+	IFACEMETHOD(StartThumbnailExtraction)(_In_ UINT32 tileWidth, _In_ UINT32 tileHeight, _In_ INT64 interval);
+	IFACEMETHOD(StopThumbnailExtraction)();
+	// S_FALSE while the source is being opened
+	IFACEMETHOD(GetThumbnailAtlasInfo)(_Out_ THUMBNAIL_ATLAS_INFO* pInfo);
+	IFACEMETHOD(GetThumbnailAtlas)(_Out_writes_(size) BYTE* pBuffer, _In_ UINT32 size, _Out_ THUMBNAIL_ATLAS_INFO* pInfo);
+
+	// Gapless playlist: while an item plays, the one after it is opened on a second MediaPlayer, which starts at the end
+	// of the current one on the same frame textures. index is clamped to the item count. An item inserted while none
+	// is current replaces the content loaded; LoadContent and Stop clear the playlist.
+	IFACEMETHOD(PlaylistInsert)(_In_ UINT32 index, _In_ LPCWSTR pszContentLocation, _Out_ UINT32* pId);
+	IFACEMETHOD(PlaylistRemove)(_In_ UINT32 id);
+	// S_FALSE at the last item; the next one starts as soon as it is created, the current one plays until then
+	IFACEMETHOD(PlaylistNext)();
+	IFACEMETHOD(GetPlaylistStats)(_Out_ PLAYLIST_STATS* pStats);
+
+	// Seamless loop of the whole media (end 0) or of [start, end), kept for every item loaded until it is disabled.
+	// MediaPlayer loops the whole media itself; a range is sought back to its start one frame before its end.
+	// A looping item never ends, the playlist does not move on from it.
+	IFACEMETHOD(SetLoop)(_In_ BOOL enabled, _In_ INT64 start, _In_ INT64 end);
+	IFACEMETHOD(GetLoopStats)(_Out_ LOOP_STATS* pStats);
+
+	// 0.25 <= |rate| <= 4, back to 1 with every item. MediaPlayer plays forward rates up to 2 itself; faster and
+	// reverse rates are trick play: the player stays paused (and reports so) while the render thread seeks it from
+	// keyframe to keyframe, the next seek only once the frame of the last one has arrived.
+	IFACEMETHOD(SetPlaybackRate)(_In_ DOUBLE rate);
+
+	// Pauses and shows the frame frames away from the current one, negative steps back. Steps within the frame cache
+	// are served from it; beyond it each step is an accurate seek of the player, there is no backward decode.
+	IFACEMETHOD(StepFrame)(_In_ INT32 frames);
+	IFACEMETHOD(GetFrameSchedulerStats)(_Out_ FRAME_SCHEDULER_STATS* pStats);
+
+	// Presented frames are copied to textures of their own around the playhead, so steps, short rewinds while paused
+	// and trick play over them are presented by the render thread without MediaPlayer decoding anything. 0 disables it.
+	IFACEMETHOD(SetFrameCacheBudget)(_In_ UINT64 budgetBytes);
+	IFACEMETHOD(GetFrameCacheStats)(_Out_ FRAME_CACHE_STATS* pStats);
+
+	// Applies from the next LoadContent or LoadContentAsync. Players with sharing enabled that load the same content
+	// share one MediaPlayer: it decodes once, every frame is copied to the textures of each player, and Play, Pause,
+	// seeks, steps, rate, loop and volume of any of them drive it. It is closed when the last of them stops.
+	// Segment prefetching and the ABR policy of the player do not apply to shared sources.
+	IFACEMETHOD(SetSourceSharing)(_In_ BOOL enabled);
 
 private:
-	HRESULT CreatePlaybackTextures();
-
-    HRESULT CreateMediaPlayer();
-    void ReleaseMediaPlayer();
-
-	HRESULT InitializeDevices();
-
-    void ReleaseTextures();
-
-    HRESULT AddStateChanged();
-    void RemoveStateChanged();
-
-    void ReleaseResources();
+	HRESULT GetMediaPlayerSession(_Out_ std::shared_ptr<CMediaPlayerSession>* pspSession);
+	std::shared_ptr<CD3D11PlaybackSurface> GetPlaybackSurface();
 
 	void DeviceShutdown();
-	HRESULT DeviceReady(IUnityGraphicsD3D11* unityD3D);
-
-private:
-	IUnityGraphicsD3D11*				 m_pUnityGraphics;
-
-    Microsoft::WRL::ComPtr<ID3D11Device> m_d3dDevice;
-    Microsoft::WRL::ComPtr<ID3D11Device> m_mediaDevice;
-	Microsoft::WRL::ComPtr<IMFDXGIDeviceManager> m_spDeviceManager;
-
-    StateChangedCallback m_fnStateCallback;
-	SubtitleItemEnteredCallback m_fnSubtitleEntered;
-	SubtitleItemExitedCallback m_fnSubtitleExited;
-	void* m_pClientObject;
+	HRESULT DeviceReady(_In_ IUnityGraphicsD3D11* pUnityGraphics);
 
-    Microsoft::WRL::ComPtr<ABI::Windows::Media::Playback::IMediaPlayer> m_mediaPlayer;
-	Microsoft::WRL::ComPtr<ABI::Windows::Media::Playback::IMediaPlayer3> m_mediaPlayer3;
-	Microsoft::WRL::ComPtr<ABI::Windows::Media::Playback::IMediaPlayer5> m_mediaPlayer5;
+	typedef CSlotMap<CMediaPlayerPlayback*> PlaybackRegistry;
 
-	Microsoft::WRL::ComPtr<ABI::Windows::Media::Playback::IMediaPlaybackSession> m_mediaPlaybackSession;
+	// Appends an AddRef'ed pointer to every registered player, so they can be used outside of the read scope
+	static void AcquirePlaybackObjects(_Inout_ std::vector<CMediaPlayerPlayback*>& playbackObjects);
+	static void ReleasePlaybackObjects(_Inout_ std::vector<CMediaPlayerPlayback*>& playbackObjects);
 
-	UINT m_uiDeviceResetToken;
-    EventRegistrationToken m_openedEventToken;
-    EventRegistrationToken m_endedEventToken;
-    EventRegistrationToken m_failedEventToken;
-    EventRegistrationToken m_videoFrameAvailableToken;
-	EventRegistrationToken m_downloadRequestedEventToken;
-	EventRegistrationToken m_videoTracksChangedEventToken;
-	EventRegistrationToken m_timedMetadataChangedEventToken;
+	static HRESULT GetLoadWorkers(_Out_ std::shared_ptr<CWorkerPool>* pspLoadWorkers);
+	static HRESULT GetThumbnailWorkers(_Out_ std::shared_ptr<CWorkerPool>* pspThumbnailWorkers);
 
-	bool m_bIgnoreEvents;
-	bool m_firstInitializationDone;
+	// the sources of the players sharing them, on a backend of their own that none of them configures
+	static HRESULT GetSharedSources(_In_ IUnityGraphicsD3D11* pUnityGraphics, _Out_ std::shared_ptr<CSharedPlaybackBackend>* pspSharedSources);
 
-	Microsoft::WRL::ComPtr<ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSource> m_spAdaptiveMediaSource;
-	Microsoft::WRL::ComPtr<ABI::Windows::Media::Playback::IMediaPlaybackItem> m_spPlaybackItem;
-    
-    EventRegistrationToken m_stateChangedEventToken;
-	EventRegistrationToken m_sizeChangedEventToken;
-	EventRegistrationToken m_durationChangedEventToken;
-
-    CD3D11_TEXTURE2D_DESC m_textureDesc;
-    Microsoft::WRL::ComPtr<ID3D11Texture2D> m_primaryTexture;
-    Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_primaryTextureSRV;
-
-
-    HANDLE m_primarySharedHandle;
-    Microsoft::WRL::ComPtr<ID3D11Texture2D> m_primaryMediaTexture;
-    Microsoft::WRL::ComPtr<ABI::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface> m_primaryMediaSurface;
-
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> m_leftEyeMediaTexture;
-	Microsoft::WRL::ComPtr<ABI::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface> m_leftEyeMediaSurface;
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> m_rightEyeMediaTexture;
-	Microsoft::WRL::ComPtr<ABI::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface> m_rightEyeMediaSurface;
-
-
-	std::vector<SUBTITLE_TRACK> m_subtitleTracks;
-
-	bool m_readyForFrames;
-	bool m_noHW4KDecoding;
-	bool m_make1080MaxWhenNoHWDecoding;
-	bool m_releasing;
-	bool m_createTextures;
+private:
+	// the state machine; it plays on m_spBackend, or on m_spSharedSources while source sharing is enabled
+	CPlaybackCore m_core;
+	std::shared_ptr<CMediaPlayerBackend> m_spBackend;
 
 private:
-	static bool m_deviceNotReady;
-	static std::vector<CMediaPlayerPlayback*> m_playbackObjects;
-	static Microsoft::WRL::Wrappers::Mutex m_playbackVectorMutex;
+	// players Unity holds a handle for; the render thread and handle lookups read it without taking a lock.
+	// Creating or releasing a player copies the whole map and waits out the readers, O(n) with an allocation each
+	// time. That is on purpose: a scene holds a handful of players and looks them up every frame, it rarely
+	// creates or releases one.
+	static CRcuSnapshot<PlaybackRegistry> m_playbackObjects;
+
+	// resolves sources for LoadContentAsync and playlist items, shared by all players
+	static std::shared_ptr<CWorkerPool> m_spLoadWorkers;
+	static std::mutex m_loadWorkersMutex;
+
+	// one low priority thread decoding thumbnails for all players, a tile at a time
+	static std::shared_ptr<CWorkerPool> m_spThumbnailWorkers;
+	static std::mutex m_thumbnailWorkersMutex;
+
+	// one decode per content location for the players sharing sources
+	static std::shared_ptr<CMediaPlayerBackend> m_spSharedBackend;
+	static std::shared_ptr<CSharedPlaybackBackend> m_spSharedSources;
+	static std::mutex m_sharedSourcesMutex;
 };
-
@@ -0,0 +1,166 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+#include "ThumbnailDecoder.h"
+
+#pragma comment(lib, "mfreadwrite")
+
+using namespace Microsoft::WRL;
+
+#define THUMBNAIL_MAX_READS 64		// samples read after a seek before giving up on a frame
+
+
+_Use_decl_annotations_
+CSourceReaderThumbnailDecoder::CSourceReaderThumbnailDecoder(const std::wstring& url)
+	: m_url(url)
+	, m_mfStarted(false)
+	, m_width(0)
+	, m_height(0)
+	, m_stride(0)
+{
+}
+
+CSourceReaderThumbnailDecoder::~CSourceReaderThumbnailDecoder()
+{
+	m_spReader.Reset();
+
+	if (m_mfStarted)
+		MFShutdown();
+}
+
+_Use_decl_annotations_
+HRESULT CSourceReaderThumbnailDecoder::Open(INT64* pDuration)
+{
+	NULL_CHK(pDuration);
+
+	*pDuration = 0;
+
+	if (!m_mfStarted)
+	{
+		IFR(MFStartup(MF_VERSION));
+		m_mfStarted = true;
+	}
+
+	// the reader converts to RGB32 itself, there is no device to hand it
+	ComPtr<IMFAttributes> spAttributes;
+	IFR(MFCreateAttributes(&spAttributes, 1));
+	IFR(spAttributes->SetUINT32(MF_SOURCE_READER_ENABLE_VIDEO_PROCESSING, TRUE));
+
+	IFR(MFCreateSourceReaderFromURL(m_url.c_str(), spAttributes.Get(), &m_spReader));
+
+	IFR(m_spReader->SetStreamSelection((DWORD)MF_SOURCE_READER_ALL_STREAMS, FALSE));
+	IFR(m_spReader->SetStreamSelection((DWORD)MF_SOURCE_READER_FIRST_VIDEO_STREAM, TRUE));
+
+	ComPtr<IMFMediaType> spOutputType;
+	IFR(MFCreateMediaType(&spOutputType));
+	IFR(spOutputType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video));
+	IFR(spOutputType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_RGB32));
+	IFR(m_spReader->SetCurrentMediaType((DWORD)MF_SOURCE_READER_FIRST_VIDEO_STREAM, nullptr, spOutputType.Get()));
+
+	IFR(UpdateFrameLayout());
+
+	PROPVARIANT duration;
+	PropVariantInit(&duration);
+	HRESULT hr = m_spReader->GetPresentationAttribute((DWORD)MF_SOURCE_READER_MEDIASOURCE, MF_PD_DURATION, &duration);
+	if (SUCCEEDED(hr) && duration.vt == VT_UI8)
+		*pDuration = (INT64)duration.uhVal.QuadPart;
+	PropVariantClear(&duration);
+
+	return hr;
+}
+
+HRESULT CSourceReaderThumbnailDecoder::UpdateFrameLayout()
+{
+	ComPtr<IMFMediaType> spType;
+	IFR(m_spReader->GetCurrentMediaType((DWORD)MF_SOURCE_READER_FIRST_VIDEO_STREAM, &spType));
+	IFR(MFGetAttributeSize(spType.Get(), MF_MT_FRAME_SIZE, &m_width, &m_height));
+
+	UINT32 stride = 0;
+	if (SUCCEEDED(spType->GetUINT32(MF_MT_DEFAULT_STRIDE, &stride)))
+		m_stride = (LONG)stride;
+	else
+		m_stride = (LONG)(m_width * 4);
+
+	return (m_width != 0 && m_height != 0) ? S_OK : MF_E_INVALIDMEDIATYPE;
+}
+
+_Use_decl_annotations_
+HRESULT CSourceReaderThumbnailDecoder::DecodeFrame(INT64 position, std::vector<BYTE>* pFrame, UINT32* pWidth, UINT32* pHeight)
+{
+	NULL_CHK(pFrame);
+	NULL_CHK(pWidth);
+	NULL_CHK(pHeight);
+
+	if (m_spReader == nullptr)
+		return E_ILLEGAL_METHOD_CALL;
+
+	// the reader seeks to the keyframe at or before the position and its first sample is that keyframe
+	PROPVARIANT seekPosition;
+	PropVariantInit(&seekPosition);
+	seekPosition.vt = VT_I8;
+	seekPosition.hVal.QuadPart = position;
+	IFR(m_spReader->SetCurrentPosition(GUID_NULL, seekPosition));
+
+	ComPtr<IMFSample> spSample;
+	for (UINT32 i = 0; i < THUMBNAIL_MAX_READS && spSample == nullptr; i++)
+	{
+		DWORD streamFlags = 0;
+		LONGLONG timestamp = 0;
+		IFR(m_spReader->ReadSample((DWORD)MF_SOURCE_READER_FIRST_VIDEO_STREAM, 0, nullptr, &streamFlags, &timestamp, &spSample));
+
+		if (streamFlags & MF_SOURCE_READERF_CURRENTMEDIATYPECHANGED)
+			IFR(UpdateFrameLayout());
+
+		if (streamFlags & (MF_SOURCE_READERF_ENDOFSTREAM | MF_SOURCE_READERF_ERROR))
+			return MF_E_END_OF_STREAM;
+	}
+
+	if (spSample == nullptr)
+		return MF_E_END_OF_STREAM;
+
+	ComPtr<IMFMediaBuffer> spBuffer;
+	IFR(spSample->ConvertToContiguousBuffer(&spBuffer));
+
+	BYTE* pData = nullptr;
+	DWORD length = 0;
+	IFR(spBuffer->Lock(&pData, nullptr, &length));
+
+	UINT32 rowBytes = m_width * 4;
+	UINT32 absStride = (UINT32)abs(m_stride);
+	if (absStride < rowBytes || (UINT64)absStride * (m_height - 1) + rowBytes > length)
+	{
+		spBuffer->Unlock();
+		return MF_E_BUFFERTOOSMALL;
+	}
+
+	pFrame->resize((size_t)rowBytes * m_height);
+	for (UINT32 y = 0; y < m_height; y++)
+	{
+		// bottom up frames start with their last row
+		const BYTE* pRow = pData + (size_t)absStride * ((m_stride < 0) ? (m_height - 1 - y) : y);
+		BYTE* pTarget = pFrame->data() + (size_t)rowBytes * y;
+		memcpy(pTarget, pRow, rowBytes);
+
+		// RGB32 leaves the alpha byte undefined
+		for (UINT32 x = 3; x < rowBytes; x += 4)
+		{
+			pTarget[x] = 0xFF;
+		}
+	}
+
+	spBuffer->Unlock();
+
+	*pWidth = m_width;
+	*pHeight = m_height;
+
+	return S_OK;
+}
@@ -0,0 +1,48 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "Core/ThumbnailAtlas.h"
+
+#include <mfreadwrite.h>
+#include <wrl.h>
+
+#include <string>
+#include <vector>
+
+// Thumbnail frames from a Media Foundation source reader of its own. It decodes in software, on the thumbnail worker,
+// so the hardware decoder and the media device of the player are left to playback.
+class CSourceReaderThumbnailDecoder
+	: public IThumbnailDecoder
+{
+public:
+	explicit CSourceReaderThumbnailDecoder(_In_ const std::wstring& url);
+	virtual ~CSourceReaderThumbnailDecoder();
+
+	// IThumbnailDecoder
+	virtual HRESULT Open(_Out_ INT64* pDuration) override;
+	virtual HRESULT DecodeFrame(
+		_In_ INT64 position,
+		_Inout_ std::vector<BYTE>* pFrame,
+		_Out_ UINT32* pWidth,
+		_Out_ UINT32* pHeight) override;
+
+private:
+	HRESULT UpdateFrameLayout();
+
+	std::wstring m_url;
+	bool m_mfStarted;
+	Microsoft::WRL::ComPtr<IMFSourceReader> m_spReader;
+	UINT32 m_width;
+	UINT32 m_height;
+	LONG m_stride;			// negative for bottom up frames
+};
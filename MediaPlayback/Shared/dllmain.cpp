@@ -56,118 +56,298 @@ STDAPI DllCanUnloadNow()
     return module.GetObjectCount() == 0 ? S_OK : S_FALSE;
 }
 
-extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CreateMediaPlayback(_In_ StateChangedCallback fnCallback, void* clientObject, void** p_spMediaPlayback)
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CreateMediaPlayback(_In_opt_ StateChangedCallback fnCallback, void* clientObject, _Out_ PLAYBACK_HANDLE* phPlayback)
 {
-    ComPtr<IMediaPlayerPlayback> spPlayerPlayback;
-    IFR(CMediaPlayerPlayback::CreateMediaPlayback(s_DeviceType, s_UnityInterfaces, fnCallback, clientObject, &spPlayerPlayback));
+    NULL_CHK(phPlayback);
 
-	*p_spMediaPlayback = spPlayerPlayback.Detach();
-
-    return S_OK;
+    return CMediaPlayerPlayback::CreateMediaPlayback(s_DeviceType, s_UnityInterfaces, fnCallback, clientObject, phPlayback);
 }
 
-extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API ReleaseMediaPlayback(IMediaPlayerPlayback* spMediaPlayback)
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API ReleaseMediaPlayback(_In_ PLAYBACK_HANDLE hPlayback)
 {
-    if (spMediaPlayback != nullptr)
+    if (hPlayback != 0)
     {
-		spMediaPlayback->Release();
+		LOG_RESULT(CMediaPlayerPlayback::ReleasePlayback(hPlayback));
     }
 }
 
 
-extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API LoadContent(_In_ IMediaPlayerPlayback* spMediaPlayback, _In_ LPCWSTR pszContentLocation)
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API LoadContent(_In_ PLAYBACK_HANDLE hPlayback, _In_ LPCWSTR pszContentLocation)
 {
     NULL_CHK(pszContentLocation);
-    NULL_CHK(spMediaPlayback);
+    ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+    IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
     
     return spMediaPlayback->LoadContent(pszContentLocation);
 }
 
-extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API Play(_In_ IMediaPlayerPlayback* spMediaPlayback)
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API LoadContentAsync(_In_ PLAYBACK_HANDLE hPlayback, _In_ LPCWSTR pszContentLocation, _Out_ UINT32* pRequestId)
+{
+    NULL_CHK(pszContentLocation);
+    NULL_CHK(pRequestId);
+    ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+    IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+    return spMediaPlayback->LoadContentAsync(pszContentLocation, pRequestId);
+}
+
+// The pending LoadContentAsync request completes silently, without StateType_LoadCompleted
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CancelLoadContentAsync(_In_ PLAYBACK_HANDLE hPlayback)
+{
+    ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+    IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+    return spMediaPlayback->CancelLoadContentAsync();
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API Play(_In_ PLAYBACK_HANDLE hPlayback)
 {
-    NULL_CHK(spMediaPlayback);
+    ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+    IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
 
     return spMediaPlayback->Play();
 }
 
-extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API Pause(_In_ IMediaPlayerPlayback* spMediaPlayback)
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API Pause(_In_ PLAYBACK_HANDLE hPlayback)
 {
-    NULL_CHK(spMediaPlayback);
+    ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+    IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
 
     return spMediaPlayback->Pause();
 }
 
-extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API Stop(_In_ IMediaPlayerPlayback* spMediaPlayback)
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API Stop(_In_ PLAYBACK_HANDLE hPlayback)
 {
-    NULL_CHK(spMediaPlayback);
+    ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+    IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
 
     return spMediaPlayback->Stop();
 }
 
 
-extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetPlaybackTexture(_In_ IMediaPlayerPlayback* spMediaPlayback, _Out_ IUnknown** d3d11TexturePtr, _Out_ LPBYTE isStereoscopic)
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetPlaybackTexture(_In_ PLAYBACK_HANDLE hPlayback, _Out_ IUnknown** d3d11TexturePtr, _Out_ LPBYTE isStereoscopic)
 {
-	NULL_CHK(spMediaPlayback);
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
 
 	return spMediaPlayback->GetPlaybackTexture(d3d11TexturePtr, isStereoscopic);
 }
 
 
-extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetDurationAndPosition(_In_ IMediaPlayerPlayback* spMediaPlayback, _Out_ LONGLONG* duration, _Out_ LONGLONG* position)
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetDurationAndPosition(_In_ PLAYBACK_HANDLE hPlayback, _Out_ LONGLONG* duration, _Out_ LONGLONG* position)
 {
-	NULL_CHK(spMediaPlayback);
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
 
 	return spMediaPlayback->GetDurationAndPosition(duration, position);
 }
 
-extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API Seek(_In_ IMediaPlayerPlayback* spMediaPlayback, _In_ LONGLONG position)
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API Seek(_In_ PLAYBACK_HANDLE hPlayback, _In_ LONGLONG position)
 {
-	NULL_CHK(spMediaPlayback);
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
 
 	return spMediaPlayback->Seek(position);
 }
 
-extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetVolume(_In_ IMediaPlayerPlayback* spMediaPlayback, _In_ DOUBLE volume)
+// Lands on a keyframe of local files for the snapping modes, Seek is SeekMode_Accurate
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SeekWithMode(_In_ PLAYBACK_HANDLE hPlayback, _In_ LONGLONG position, _In_ SeekMode mode)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->SeekWithMode(position, mode);
+}
+
+// Seek preview thumbnails decoded in the background; poll GetThumbnailAtlasInfo and copy when readyCount grows
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API StartThumbnailExtraction(_In_ PLAYBACK_HANDLE hPlayback, _In_ UINT32 tileWidth, _In_ UINT32 tileHeight, _In_ INT64 interval)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->StartThumbnailExtraction(tileWidth, tileHeight, interval);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API StopThumbnailExtraction(_In_ PLAYBACK_HANDLE hPlayback)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->StopThumbnailExtraction();
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetThumbnailAtlasInfo(_In_ PLAYBACK_HANDLE hPlayback, _Out_ THUMBNAIL_ATLAS_INFO* pInfo)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->GetThumbnailAtlasInfo(pInfo);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetThumbnailAtlas(_In_ PLAYBACK_HANDLE hPlayback, _Out_writes_(size) BYTE* pBuffer, _In_ UINT32 size, _Out_ THUMBNAIL_ATLAS_INFO* pInfo)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->GetThumbnailAtlas(pBuffer, size, pInfo);
+}
+
+// Gapless playlist; StateType_PlaylistItemChanged reports the item that starts playing, StateType_Failed one that could not be opened
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlaylistAppend(_In_ PLAYBACK_HANDLE hPlayback, _In_ LPCWSTR pszContentLocation, _Out_ UINT32* pId)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->PlaylistInsert(UINT32_MAX, pszContentLocation, pId);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlaylistInsert(_In_ PLAYBACK_HANDLE hPlayback, _In_ UINT32 index, _In_ LPCWSTR pszContentLocation, _Out_ UINT32* pId)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->PlaylistInsert(index, pszContentLocation, pId);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlaylistRemove(_In_ PLAYBACK_HANDLE hPlayback, _In_ UINT32 id)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->PlaylistRemove(id);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlaylistNext(_In_ PLAYBACK_HANDLE hPlayback)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->PlaylistNext();
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetPlaylistStats(_In_ PLAYBACK_HANDLE hPlayback, _Out_ PLAYLIST_STATS* pStats)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->GetPlaylistStats(pStats);
+}
+
+// Seamless loop of the whole media (end 0) or of [start, end), in 100ns
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetLoop(_In_ PLAYBACK_HANDLE hPlayback, _In_ BOOL enabled, _In_ INT64 start, _In_ INT64 end)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->SetLoop(enabled, start, end);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetLoopStats(_In_ PLAYBACK_HANDLE hPlayback, _Out_ LOOP_STATS* pStats)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->GetLoopStats(pStats);
+}
+
+// 0.25 <= |rate| <= 4, faster and reverse rates play keyframes only
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetPlaybackRate(_In_ PLAYBACK_HANDLE hPlayback, _In_ DOUBLE rate)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->SetPlaybackRate(rate);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API StepFrame(_In_ PLAYBACK_HANDLE hPlayback, _In_ INT32 frames)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->StepFrame(frames);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetFrameSchedulerStats(_In_ PLAYBACK_HANDLE hPlayback, _Out_ FRAME_SCHEDULER_STATS* pStats)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->GetFrameSchedulerStats(pStats);
+}
+
+// Budget of the cache of presented frames around the playhead, 0 disables it
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetFrameCacheBudget(_In_ PLAYBACK_HANDLE hPlayback, _In_ UINT64 budgetBytes)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->SetFrameCacheBudget(budgetBytes);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetFrameCacheStats(_In_ PLAYBACK_HANDLE hPlayback, _Out_ FRAME_CACHE_STATS* pStats)
 {
-	NULL_CHK(spMediaPlayback);
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->GetFrameCacheStats(pStats);
+}
+
+// Players loading the same content with sharing enabled decode it once, the later ones mirror the first
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetSourceSharing(_In_ PLAYBACK_HANDLE hPlayback, _In_ BOOL enabled)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->SetSourceSharing(enabled);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetVolume(_In_ PLAYBACK_HANDLE hPlayback, _In_ DOUBLE volume)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
 
 	return spMediaPlayback->SetVolume(volume);
 }
 
-extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetMediaPlayer(_In_ IMediaPlayerPlayback* spMediaPlayback, _Out_ IUnknown** pIUnkForMediaPlayer)
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetMediaPlayer(_In_ PLAYBACK_HANDLE hPlayback, _Out_ IUnknown** pIUnkForMediaPlayer)
 {
-	NULL_CHK(spMediaPlayback);
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
 
 	return spMediaPlayback->GetIUnknown(pIUnkForMediaPlayer);
 }
 
-extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API IsHardware4KDecodingSupported(_In_ IMediaPlayerPlayback* spMediaPlayback, _Out_ BOOL* pSupportsHardware4KVideoDecoding)
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API IsHardware4KDecodingSupported(_In_ PLAYBACK_HANDLE hPlayback, _Out_ BOOL* pSupportsHardware4KVideoDecoding)
 {
-	NULL_CHK(spMediaPlayback);
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
 
 	return spMediaPlayback->IsHardware4KDecodingSupported(pSupportsHardware4KVideoDecoding);
 }
 
 
-extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetSubtitlesCallbacks(_In_ IMediaPlayerPlayback* spMediaPlayback, _In_ SubtitleItemEnteredCallback fnEnteredCallback, _In_ SubtitleItemExitedCallback fnExitedCallback)
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetSubtitlesCallbacks(_In_ PLAYBACK_HANDLE hPlayback, _In_ SubtitleItemEnteredCallback fnEnteredCallback, _In_ SubtitleItemExitedCallback fnExitedCallback)
 {
-	NULL_CHK(spMediaPlayback);
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
 
 	return spMediaPlayback->SetSubtitlesCallbacks(fnEnteredCallback, fnExitedCallback);
 }
 
-extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetSubtitlesTracksCount(_In_ IMediaPlayerPlayback* spMediaPlayback, _Out_ unsigned int* count)
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetSubtitlesTracksCount(_In_ PLAYBACK_HANDLE hPlayback, _Out_ unsigned int* count)
 {
-	NULL_CHK(spMediaPlayback);
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
 	NULL_CHK(count);
 
 	return spMediaPlayback->GetSubtitlesTrackCount(count);
 }
 
 
-extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetSubtitlesTrack(_In_ IMediaPlayerPlayback* spMediaPlayback, _In_ unsigned int index, _Out_ const wchar_t** trackId, _Out_ const wchar_t** trackLabel, _Out_ const wchar_t** trackLanguage)
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetSubtitlesTrack(_In_ PLAYBACK_HANDLE hPlayback, _In_ unsigned int index, _Out_ const wchar_t** trackId, _Out_ const wchar_t** trackLabel, _Out_ const wchar_t** trackLanguage)
 {
-	NULL_CHK(spMediaPlayback);
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
 
 	unsigned int count = 0;
 	spMediaPlayback->GetSubtitlesTrackCount(&count);
@@ -179,6 +359,155 @@ extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetSubtitlesTrack(
 	return spMediaPlayback->GetSubtitlesTrack(index, trackId, trackLabel, trackLanguage);
 }
 
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetFrameQueueStats(_In_ PLAYBACK_HANDLE hPlayback, _Out_ FRAME_QUEUE_STATS* pStats)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+	NULL_CHK(pStats);
+
+	return spMediaPlayback->GetFrameQueueStats(pStats);
+}
+
+// Without a StateChangedCallback the player queues its states, call once per frame
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API DrainEvents(_In_ PLAYBACK_HANDLE hPlayback, _Out_writes_to_(capacity, *pCount) PLAYBACK_STATE* pEvents, _In_ UINT32 capacity, _Out_ UINT32* pCount)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->DrainEvents(pEvents, capacity, pCount);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetEventQueueStats(_In_ PLAYBACK_HANDLE hPlayback, _Out_ EVENT_QUEUE_STATS* pStats)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+	NULL_CHK(pStats);
+
+	return spMediaPlayback->GetEventQueueStats(pStats);
+}
+
+// The block is updated in place until ReleaseMediaPlayback, read it with the sequence protocol described in PLAYBACK_STATUS
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetPlaybackStatus(_In_ PLAYBACK_HANDLE hPlayback, _Out_ const PLAYBACK_STATUS** ppStatus)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+	NULL_CHK(ppStatus);
+
+	return spMediaPlayback->GetPlaybackStatus(ppStatus);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetTexturePoolStats(_In_ PLAYBACK_HANDLE hPlayback, _Out_ SURFACE_POOL_STATS* pStats)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+	NULL_CHK(pStats);
+
+	return spMediaPlayback->GetTexturePoolStats(pStats);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetTexturePoolBudget(_In_ PLAYBACK_HANDLE hPlayback, _In_ UINT64 budgetBytes)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->SetTexturePoolBudget(budgetBytes);
+}
+
+// Takes effect with the next StateType_NewFrameTexture, the format used is in its MEDIA_DESCRIPTION
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetPreferredFrameFormat(_In_ PLAYBACK_HANDLE hPlayback, _In_ FrameFormat format)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->SetPreferredFrameFormat(format);
+}
+
+// Luma and chroma plane views of native format frame textures; chroma is null for FrameFormat_BGRA32
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetPlaybackPlaneTextures(_In_ PLAYBACK_HANDLE hPlayback, _Out_ IUnknown** lumaTexturePtr, _Out_ IUnknown** chromaTexturePtr, _Out_ FrameFormat* pFormat)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+	NULL_CHK(lumaTexturePtr);
+	NULL_CHK(chromaTexturePtr);
+	NULL_CHK(pFormat);
+
+	return spMediaPlayback->GetPlaybackPlaneTextures(lumaTexturePtr, chromaTexturePtr, pFormat);
+}
+
+// Caches HLS/DASH segments of every player in pszDirectory, within budgetBytes; a null directory disables the cache.
+// Segments already on disk from earlier sessions are reused.
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API EnableSegmentCache(_In_opt_ LPCWSTR pszDirectory, _In_ UINT64 budgetBytes)
+{
+	return CMediaPlayerPlayback::EnableSegmentCache(pszDirectory, budgetBytes);
+}
+
+// S_FALSE and zeroed stats while the cache is disabled
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetSegmentCacheStats(_Out_ SEGMENT_CACHE_STATS* pStats)
+{
+	NULL_CHK(pStats);
+
+	return CMediaPlayerPlayback::GetSegmentCacheStats(pStats);
+}
+
+// Media devices all players share, one per graphics adapter
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetMediaDeviceStats(_Out_ MEDIA_DEVICE_STATS* pStats)
+{
+	NULL_CHK(pStats);
+
+	CMediaPlayerPlayback::GetMediaDeviceStats(pStats);
+
+	return S_OK;
+}
+
+// Decodes shared between the players with source sharing enabled
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetSharedSourceStats(_Out_ SHARED_SOURCE_STATS* pStats)
+{
+	NULL_CHK(pStats);
+
+	CMediaPlayerPlayback::GetSharedSourceStats(pStats);
+
+	return S_OK;
+}
+
+// Downloads lookAhead (100ns) of HLS/DASH segments ahead of the player, at most maxInFlight at a time; 0 disables it.
+// Prefetched segments go through the segment cache when it is enabled.
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetSegmentPrefetch(_In_ PLAYBACK_HANDLE hPlayback, _In_ INT64 lookAhead, _In_ UINT32 maxInFlight)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->SetSegmentPrefetch(lookAhead, maxInFlight);
+}
+
+// S_FALSE and zeroed stats while the current content is not prefetched
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetSegmentPrefetchStats(_In_ PLAYBACK_HANDLE hPlayback, _Out_ SEGMENT_PREFETCH_STATS* pStats)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+	NULL_CHK(pStats);
+
+	return spMediaPlayback->GetSegmentPrefetchStats(pStats);
+}
+
+// AbrPolicy_System leaves the bitrate of adaptive streams to the media source; the others set DesiredMin/MaxBitrate
+// for every media segment from the download throughput and/or the buffer level
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetAbrPolicy(_In_ PLAYBACK_HANDLE hPlayback, _In_ AbrPolicy policy)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->SetAbrPolicy(policy);
+}
+
+// Video renditions are picked to fit the viewport (0x0 if not known) and the power budget, within what the hardware decodes
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetRenditionConstraints(_In_ PLAYBACK_HANDLE hPlayback, _In_ UINT32 viewportWidth, _In_ UINT32 viewportHeight, _In_ PowerBudget powerBudget)
+{
+	ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+	IFR(CMediaPlayerPlayback::GetPlayback(hPlayback, &spMediaPlayback));
+
+	return spMediaPlayback->SetRenditionConstraints(viewportWidth, viewportHeight, powerBudget);
+}
+
 // --------------------------------------------------------------------------
 // UnitySetInterfaces
 
@@ -214,6 +543,10 @@ extern "C" void	UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginLoad(IUnit
 extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginUnload()
 {
     s_Graphics->UnregisterDeviceEventCallback(OnGraphicsDeviceEvent);
+
+    CMediaPlayerPlayback::ShutdownLoadWorkers();
+    CMediaPlayerPlayback::ShutdownThumbnailWorkers();
+    CMediaPlayerPlayback::ShutdownSegmentCache();
 }
 
 
@@ -11,6 +11,7 @@
 
 using System;
 using System.Collections;
+using System.Collections.Generic;
 using System.Runtime.InteropServices;
 using System.Text;
 using UnityEngine;
@@ -41,6 +42,122 @@ namespace MediaPlayer
     }
 
 
+    // Snapshot of the status block the plugin keeps up to date for every player, times are in 100ns units
+    public struct PlaybackStatus
+    {
+        public PlaybackState state;
+        public long position;
+        public long duration;
+        public uint bitrate;
+        public ulong frameCounter;
+        public ulong droppedFrames;
+    }
+
+    // Layout of the frame textures, NV12 and P010 hand the decoded planes to the material which converts YUV to RGB
+    public enum FrameFormat
+    {
+        BGRA32 = 0,
+        NV12,   // luma R8, chroma R8G8 at half resolution
+        P010    // luma R16, chroma R16G16 at half resolution
+    };
+
+    // Who picks the bitrate of adaptive streams while they play
+    public enum AbrPolicy
+    {
+        System = 0, // AdaptiveMediaSource heuristics
+        Throughput, // measured segment download throughput
+        Buffer,     // buffer level (BOLA)
+        Hybrid      // throughput while the buffer is short, buffer level once it is filled
+    };
+
+    // How much decoding work the choice of the video rendition may spend
+    public enum PowerBudget
+    {
+        Unconstrained = 0,
+        Balanced,   // up to 1080p60
+        Saver       // up to 720p30
+    };
+
+    // Where a seek lands when the position is not on a keyframe; local files only, streams always seek accurately
+    public enum SeekMode
+    {
+        Accurate = 0,       // exactly at the position
+        PreviousKeyframe,   // the keyframe at or before the position, fastest
+        NearestKeyframe     // whichever keyframe is closer
+    };
+
+    // Layout of the seek preview atlas, THUMBNAIL_ATLAS_INFO of the plugin; times are in 100ns units
+    [StructLayout(LayoutKind.Sequential, Pack = 8)]
+    public struct ThumbnailAtlasInfo
+    {
+        public uint width;
+        public uint height;
+        public uint tileWidth;
+        public uint tileHeight;
+        public uint columns;        // tile i is at column i % columns, row i / columns from the top
+        public uint tileCount;      // tile i shows the keyframe at or before i * interval
+        public uint readyCount;     // tiles decoded so far
+        public long interval;
+    }
+
+    // Gapless playlist, PLAYLIST_STATS of the plugin; latencies are in 100ns units, -1 until a switch has shown a frame
+    [StructLayout(LayoutKind.Sequential, Pack = 8)]
+    public struct PlaylistStats
+    {
+        public uint itemCount;
+        public uint currentItemId;
+        public int currentIndex;
+        public uint switchCount;
+        public uint prerolledSwitches;  // switches to an item that was opened ahead
+        public long lastSwitchLatency;  // from the switch to the first frame of the next item
+        public long maxSwitchLatency;
+    }
+
+    // Loop mode, LOOP_STATS of the plugin; times are in 100ns units
+    [StructLayout(LayoutKind.Sequential, Pack = 8)]
+    public struct LoopStats
+    {
+        public uint enabled;
+        public uint loopCount;
+        public long loopStart;
+        public long loopEnd;        // 0 loops the whole media
+        public long lastLoopGap;    // between the last frame before a wrap and the first one after it, -1 if none yet
+        public long maxLoopGap;
+    }
+
+    // Playback rate and frame steps, FRAME_SCHEDULER_STATS of the plugin; times are in 100ns units
+    [StructLayout(LayoutKind.Sequential, Pack = 8)]
+    public struct FrameSchedulerStats
+    {
+        public double rate;
+        public long frameDuration;      // measured during playback at rate 1
+        public uint trickPlay;          // the rate is played keyframe by keyframe
+        public uint trickPlayFrames;
+        public uint skippedKeyframes;   // keyframes trick play went past without showing them
+        public uint steps;
+    }
+
+    // Cache of presented frames around the playhead, FRAME_CACHE_STATS of the plugin; times are in 100ns units
+    [StructLayout(LayoutKind.Sequential, Pack = 8)]
+    public struct FrameCacheStats
+    {
+        public uint frames;
+        public ulong cachedBytes;
+        public ulong budgetBytes;
+        public long firstPosition;      // -1 if the cache is empty
+        public long lastPosition;
+        public ulong hits;              // steps, rewinds and trick play frames served without decoding
+        public ulong misses;
+        public ulong evictions;
+    }
+
+    public struct PlaybackTimeRange
+    {
+        public long start;
+        public long end;
+    }
+
+
     public class Playback : MonoBehaviour
     {
         // state handling
@@ -49,12 +166,14 @@ namespace MediaPlayer
         public delegate void TextureUpdatedHandler(object sender, Texture2D newVideoTexture, bool isStereoscopic);
         public delegate void SubtitleItemEnteredHandler(object sender, string subtitlesTrackId, string textCueId, string language, string[] textLines);
         public delegate void SubtitleItemExitedHandler(object sender, string subtitlesTrackId, string textCueId);
+        public delegate void PlaylistItemChangedHandler(object sender, uint itemId);
 
         public event PlaybackStateChangedHandler PlaybackStateChanged;
         public event PlaybackFailedHandler PlaybackFailed;
         public event TextureUpdatedHandler TextureUpdated;
         public event SubtitleItemEnteredHandler SubtitleItemEntered;
         public event SubtitleItemExitedHandler SubtitleItemExited;
+        public event PlaylistItemChangedHandler PlaylistItemChanged;
 
         [Tooltip("Renderer component to the object the frame will be rendered to")]
         public Renderer targetRenderer;
@@ -68,6 +187,18 @@ namespace MediaPlayer
         [Tooltip("If true, the material's shader will be forced to render frames as stereoscopic")]
         public bool forceStereo = false;
 
+        [Tooltip("Frame format to ask for. NV12/P010 skip the RGB conversion of the media pipeline, the material's shader must convert YUV to RGB. Stereoscopic video is always BGRA32")]
+        public FrameFormat preferredFrameFormat = FrameFormat.BGRA32;
+
+        [Tooltip("Bitrate selection for adaptive streams (HLS, DASH, Smooth Streaming). System leaves it to Windows")]
+        public AbrPolicy abrPolicy = AbrPolicy.System;
+
+        [Tooltip("Decoding power budget for picking the video track or the max bitrate of adaptive streams, together with the viewport size (see SetViewportSize)")]
+        public PowerBudget powerBudget = PowerBudget.Unconstrained;
+
+        [Tooltip("Texture to set the chroma plane of NV12/P010 frames to (must be material's shader variable name), the luma plane goes to Target Renderer Texture Name")]
+        public string targetRendererChromaTextureName = "_ChromaTex";
+
         public bool isStereo
         {
             get
@@ -105,6 +236,23 @@ namespace MediaPlayer
             get
             {
                 return playbackTexture;
+            }
+        }
+
+        // chroma plane of NV12/P010 frames (currentVideoTexture holds luma then), null for BGRA32
+        public Texture2D currentChromaTexture
+        {
+            get
+            {
+                return chromaTexture;
+            }
+        }
+
+        public FrameFormat currentFrameFormat
+        {
+            get
+            {
+                return frameFormat;
             }
         }
 
@@ -147,32 +295,90 @@ namespace MediaPlayer
         private uint textureWidth = 0;
         private uint textureHeight = 0;
         private Texture2D playbackTexture = null;
+        private Texture2D chromaTexture = null;
+        private Texture2D thumbnailTexture = null;
+        private byte[] thumbnailPixels = null;
+        private uint thumbnailReadyCount = 0;
+        private FrameFormat frameFormat = FrameFormat.BGRA32;
         private bool needToUpdateTexture = false;
 
         private bool isStereoVideo = false;
 
         private IntPtr pluginInstance = IntPtr.Zero;
+        private IntPtr statusBlock = IntPtr.Zero;
         private GCHandle thisObject;
         private bool hw4KDecodingSupported = true;
+        private uint viewportWidth = 0;
+        private uint viewportHeight = 0;
 
         private string currentItem = string.Empty;
 
         private PlaybackState currentState = PlaybackState.None;
         private PlaybackState previousState = PlaybackState.None;
 
-        private Plugin.StateChangedCallback stateCallback = new Plugin.StateChangedCallback(MediaPlayback_Changed);
         private Plugin.SubtitleItemEnteredCallback subtitleEnteredCallback = new Plugin.SubtitleItemEnteredCallback(MediaPlayback_SubtitleItemEntered);
         private Plugin.SubtitleItemExitedCallback subtitleExitedCallback = new Plugin.SubtitleItemExitedCallback(MediaPlayback_SubtitleItemExited);
 
+        // states the plugin queued since the previous frame, drained once per frame
+        private const int StateEventBatchSize = 16;
+        private Plugin.PLAYBACK_STATE[] stateEvents = new Plugin.PLAYBACK_STATE[StateEventBatchSize];
+
         private bool loaded = false;
+        private uint pendingLoadRequestId = 0;
+        private string pendingItem = string.Empty;
+        private bool playWhenLoaded = false;
+        private Dictionary<uint, string> playlistItems = new Dictionary<uint, string>();
         private Plugin.MEDIA_DESCRIPTION currentMediaDescription = new Plugin.MEDIA_DESCRIPTION();
 
         private bool needToGoBackToRoomScale = false;
 
         public void Load(string uriOrPath)
         {
-            Stop();
+            string uriStr = PrepareLoad(uriOrPath);
+
+            loaded = (0 == CheckHR(Plugin.LoadContent(pluginInstance, uriStr)));
+            if (loaded)
+            {
+                currentItem = uriOrPath;
+            }
+        }
+
+        // Returns right away, the item is opened in the background. 
+        // Loading another item or calling Stop before it has been opened cancels the load. 
+        public void LoadAsync(string uriOrPath)
+        {
+            LoadAsync(uriOrPath, false);
+        }
 
+        private void LoadAsync(string uriOrPath, bool play)
+        {
+            string uriStr = PrepareLoad(uriOrPath);
+
+            uint requestId = 0;
+            if (0 == CheckHR(Plugin.LoadContentAsync(pluginInstance, uriStr, out requestId)))
+            {
+                pendingLoadRequestId = requestId;
+                pendingItem = uriOrPath;
+                playWhenLoaded = play;
+            }
+        }
+
+        // Drops the item LoadAsync is opening, whatever was loaded before stays
+        public void CancelLoadAsync()
+        {
+            if (pendingLoadRequestId == 0)
+            {
+                return;
+            }
+
+            CheckHR(Plugin.CancelLoadContentAsync(pluginInstance));
+            pendingLoadRequestId = 0;
+            pendingItem = string.Empty;
+            playWhenLoaded = false;
+        }
+
+        private static string ToContentUri(string uriOrPath)
+        {
             string uriStr = uriOrPath.Trim();
 
             if (uriStr.ToLower().StartsWith("file:///") || Uri.IsWellFormedUriString(uriOrPath, UriKind.Absolute))
@@ -188,6 +394,14 @@ namespace MediaPlayer
                 uriStr = "file:///" + System.IO.Path.Combine(Application.streamingAssetsPath, uriOrPath);
             }
 
+            return uriStr;
+        }
+
+        private string PrepareLoad(string uriOrPath)
+        {
+            Stop();
+
+            string uriStr = ToContentUri(uriOrPath);
 
             needToGoBackToRoomScale = false;
             bool isXR =
@@ -222,11 +436,7 @@ namespace MediaPlayer
 #endif
             }
 
-            loaded = (0 == CheckHR(Plugin.LoadContent(pluginInstance, uriStr)));
-            if (loaded)
-            {
-                currentItem = uriOrPath;
-            }
+            return uriStr;
         }
 
         public void Play()
@@ -240,7 +450,11 @@ namespace MediaPlayer
 
             if (!string.IsNullOrEmpty(item) && currentItem != item)
             {
-                Load(item);
+                if (pendingLoadRequestId == 0 || pendingItem != item)
+                {
+                    LoadAsync(item, true); // starts playing once the item has been opened
+                }
+                return;
             }
 
             if (loaded)
@@ -250,6 +464,104 @@ namespace MediaPlayer
         }
 
 
+        // Gapless playlist: the item after the current one is opened while the current one plays and starts on the same
+        // texture at its end. The first item added replaces what was loaded; Load and Stop clear the playlist.
+        // Returns the id of the item, 0 if it could not be added.
+        public uint PlaylistAppend(string uriOrPath)
+        {
+            uint itemId = 0;
+            if (0 == CheckHR(Plugin.PlaylistAppend(pluginInstance, ToContentUri(uriOrPath), out itemId)))
+            {
+                playlistItems[itemId] = uriOrPath;
+            }
+            return itemId;
+        }
+
+        public uint PlaylistInsert(uint index, string uriOrPath)
+        {
+            uint itemId = 0;
+            if (0 == CheckHR(Plugin.PlaylistInsert(pluginInstance, index, ToContentUri(uriOrPath), out itemId)))
+            {
+                playlistItems[itemId] = uriOrPath;
+            }
+            return itemId;
+        }
+
+        public void PlaylistRemove(uint itemId)
+        {
+            CheckHR(Plugin.PlaylistRemove(pluginInstance, itemId));
+            playlistItems.Remove(itemId);
+        }
+
+        // false at the last item
+        public bool PlaylistNext()
+        {
+            long hr = Plugin.PlaylistNext(pluginInstance);
+            return hr == 0 || (hr != 1 && CheckHR(hr) == 0);
+        }
+
+        public PlaylistStats GetPlaylistStats()
+        {
+            PlaylistStats stats = new PlaylistStats();
+            CheckHR(Plugin.GetPlaylistStats(pluginInstance, out stats));
+            return stats;
+        }
+
+        // Loops the whole media (loopEnd 0) or [loopStart, loopEnd) in 100ns units without ending or reopening it,
+        // the texture and the subtitles stay as they are. It is kept for the items loaded afterwards.
+        public void SetLoop(bool enabled, long loopStart = 0, long loopEnd = 0)
+        {
+            CheckHR(Plugin.SetLoop(pluginInstance, enabled, loopStart, loopEnd));
+        }
+
+        public LoopStats GetLoopStats()
+        {
+            LoopStats stats = new LoopStats();
+            CheckHR(Plugin.GetLoopStats(pluginInstance, out stats));
+            return stats;
+        }
+
+        // 0.25 to 4 either way, back to 1 with every item. Rates above 2 and reverse ones show keyframes only
+        // and keep the player paused, Play and Pause go on working as usual.
+        public void SetPlaybackRate(double rate)
+        {
+            CheckHR(Plugin.SetPlaybackRate(pluginInstance, rate));
+        }
+
+        // Pauses and shows the frame that many frames away, negative steps go back
+        public void StepFrame(int frames)
+        {
+            CheckHR(Plugin.StepFrame(pluginInstance, frames));
+        }
+
+        public FrameSchedulerStats GetFrameSchedulerStats()
+        {
+            FrameSchedulerStats stats = new FrameSchedulerStats();
+            CheckHR(Plugin.GetFrameSchedulerStats(pluginInstance, out stats));
+            return stats;
+        }
+
+        // Presented frames are kept around the playhead up to this many bytes of video memory, so stepping back and
+        // short rewinds while paused show up without decoding; 0 turns it off
+        public void SetFrameCacheBudget(ulong budgetBytes)
+        {
+            CheckHR(Plugin.SetFrameCacheBudget(pluginInstance, budgetBytes));
+        }
+
+        public FrameCacheStats GetFrameCacheStats()
+        {
+            FrameCacheStats stats = new FrameCacheStats();
+            CheckHR(Plugin.GetFrameCacheStats(pluginInstance, out stats));
+            return stats;
+        }
+
+        // Players loading the same content with sharing on decode it once: the first one decodes, the later ones show
+        // its frames and their Play, Pause and seeks go to it. Applies from the next Load.
+        public void SetSourceSharing(bool enabled)
+        {
+            CheckHR(Plugin.SetSourceSharing(pluginInstance, enabled));
+        }
+
         public void Pause()
         {
             CheckHR(Plugin.Pause(pluginInstance));
@@ -261,6 +573,10 @@ namespace MediaPlayer
             currentMediaDescription = new Plugin.MEDIA_DESCRIPTION();
             State = PlaybackState.None;
             currentItem = string.Empty;
+            pendingLoadRequestId = 0;
+            pendingItem = string.Empty;
+            playWhenLoaded = false;
+            playlistItems.Clear();
             isStereoVideo = false;
 
             if (needToGoBackToRoomScale)
@@ -308,6 +624,16 @@ namespace MediaPlayer
 
             bool isStereoscopic = isStereoscopicByte > 0 ? true : false;
 
+            // native formats: the texture above is the luma plane, chroma is a second view of the same texture
+            IntPtr nativeChromaTexture = IntPtr.Zero;
+            uint nativeFrameFormat = 0;
+            if (currentMediaDescription.frameFormat != (uint)FrameFormat.BGRA32)
+            {
+                CheckHR(Plugin.GetPlaybackPlaneTextures(pluginInstance, out nativeTexture, out nativeChromaTexture, out nativeFrameFormat));
+            }
+            frameFormat = (FrameFormat)nativeFrameFormat;
+            TextureFormat lumaFormat = frameFormat == FrameFormat.P010 ? TextureFormat.R16 : (frameFormat == FrameFormat.NV12 ? TextureFormat.R8 : TextureFormat.BGRA32);
+
             isStereoVideo = isStereoscopic;
             bool makeStereo = forceStereo || isStereoVideo;
 
@@ -315,10 +641,10 @@ namespace MediaPlayer
             {
                 var oldTexture = playbackTexture;
 
-                if (playbackTexture == null || playbackTexture.width != (int)this.textureWidth || playbackTexture.height != (int)this.textureHeight)
+                if (playbackTexture == null || playbackTexture.width != (int)this.textureWidth || playbackTexture.height != (int)this.textureHeight || playbackTexture.format != lumaFormat)
                 {
                     // create a new Unity texture2d 
-                    this.playbackTexture = Texture2D.CreateExternalTexture((int)this.textureWidth, (int)this.textureHeight, TextureFormat.BGRA32, false, false, nativeTexture);
+                    this.playbackTexture = Texture2D.CreateExternalTexture((int)this.textureWidth, (int)this.textureHeight, lumaFormat, false, false, nativeTexture);
                 }
                 else
                 {
@@ -343,6 +669,11 @@ namespace MediaPlayer
                     {
                         targetMaterial.mainTexture = playbackTexture;
                     }
+
+                    if (!string.IsNullOrEmpty(targetRendererChromaTextureName) && targetMaterial.HasProperty(targetRendererChromaTextureName))
+                    {
+                        targetMaterial.SetTexture(targetRendererChromaTextureName, UpdateChromaTexture(nativeChromaTexture));
+                    }
                     
                     if (!string.IsNullOrEmpty(isStereoShaderParameterName))
                     {
@@ -368,6 +699,12 @@ namespace MediaPlayer
 
         public long GetDuration()
         {
+            PlaybackStatus status;
+            if (GetStatus(out status))
+            {
+                return status.duration;
+            }
+
             long duration = 0;
             long position = 0;
 
@@ -378,6 +715,13 @@ namespace MediaPlayer
 
         public long GetPosition()
         {
+            // the block follows the position on every video frame; audio only content keeps asking the player
+            PlaybackStatus status;
+            if (GetStatus(out status) && (status.frameCounter != 0 || status.state != PlaybackState.Playing))
+            {
+                return status.position;
+            }
+
             long duration = 0;
             long position = 0;
 
@@ -385,16 +729,163 @@ namespace MediaPlayer
             return position;
         }
 
+
+        // Reads the status block in place, no call into the plugin
+        public bool GetStatus(out PlaybackStatus status)
+        {
+            status = new PlaybackStatus();
+
+            if (statusBlock == IntPtr.Zero)
+            {
+                return false;
+            }
+
+            for (;;)
+            {
+                int sequence = BeginStatusRead();
+
+                status.state = (PlaybackState)Marshal.ReadInt32(statusBlock, Plugin.PlaybackStatusLayout.State);
+                status.position = Marshal.ReadInt64(statusBlock, Plugin.PlaybackStatusLayout.Position);
+                status.duration = Marshal.ReadInt64(statusBlock, Plugin.PlaybackStatusLayout.Duration);
+                status.bitrate = (uint)Marshal.ReadInt32(statusBlock, Plugin.PlaybackStatusLayout.Bitrate);
+                status.frameCounter = (ulong)Marshal.ReadInt64(statusBlock, Plugin.PlaybackStatusLayout.FrameCounter);
+                status.droppedFrames = (ulong)Marshal.ReadInt64(statusBlock, Plugin.PlaybackStatusLayout.DroppedFrames);
+
+                if (EndStatusRead(sequence))
+                {
+                    return true;
+                }
+            }
+        }
+
+
+        // Fills ranges with the buffered parts of the media, returns how many were written
+        public int GetBufferedRanges(PlaybackTimeRange[] ranges)
+        {
+            if (statusBlock == IntPtr.Zero || ranges == null)
+            {
+                return 0;
+            }
+
+            for (;;)
+            {
+                int sequence = BeginStatusRead();
+
+                int count = Math.Min(Marshal.ReadInt32(statusBlock, Plugin.PlaybackStatusLayout.BufferedRangeCount), Math.Min(ranges.Length, Plugin.PlaybackStatusLayout.MaxBufferedRanges));
+                for (int i = 0; i < count; i++)
+                {
+                    int offset = Plugin.PlaybackStatusLayout.BufferedRanges + i * Plugin.PlaybackStatusLayout.TimeRangeSize;
+                    ranges[i].start = Marshal.ReadInt64(statusBlock, offset);
+                    ranges[i].end = Marshal.ReadInt64(statusBlock, offset + 8);
+                }
+
+                if (EndStatusRead(sequence))
+                {
+                    return count;
+                }
+            }
+        }
+
+
+        // seqlock: an odd sequence means the plugin is writing, a changed one means the fields may be torn
+        private int BeginStatusRead()
+        {
+            int sequence = Marshal.ReadInt32(statusBlock, Plugin.PlaybackStatusLayout.Sequence);
+            while ((sequence & 1) != 0)
+            {
+                System.Threading.Thread.Sleep(0);
+                sequence = Marshal.ReadInt32(statusBlock, Plugin.PlaybackStatusLayout.Sequence);
+            }
+
+            System.Threading.Thread.MemoryBarrier();
+            return sequence;
+        }
+
+        private bool EndStatusRead(int sequence)
+        {
+            System.Threading.Thread.MemoryBarrier();
+            return Marshal.ReadInt32(statusBlock, Plugin.PlaybackStatusLayout.Sequence) == sequence;
+        }
+
         public void Seek(long position)
         {
             CheckHR(Plugin.Seek(pluginInstance, position));
         }
 
+        public void Seek(long position, SeekMode mode)
+        {
+            CheckHR(Plugin.SeekWithMode(pluginInstance, position, (uint)mode));
+        }
+
+        // Starts decoding seek preview thumbnails of the current media in the background, one every interval (100ns)
+        public void StartThumbnails(uint tileWidth, uint tileHeight, long interval)
+        {
+            thumbnailReadyCount = 0;
+            CheckHR(Plugin.StartThumbnailExtraction(pluginInstance, tileWidth, tileHeight, interval));
+        }
+
+        public void StopThumbnails()
+        {
+            CheckHR(Plugin.StopThumbnailExtraction(pluginInstance));
+        }
+
+        // The atlas with the tiles decoded so far, null until the media is opened. The texture is only uploaded again
+        // when new tiles arrived. Its rows are top down, so the tile of a time is sampled with v flipped.
+        public Texture2D GetThumbnailAtlas(out ThumbnailAtlasInfo info)
+        {
+            info = new ThumbnailAtlasInfo();
+
+            if (pluginInstance == IntPtr.Zero || Plugin.GetThumbnailAtlasInfo(pluginInstance, out info) != 0 || info.width == 0)
+            {
+                return thumbnailTexture;
+            }
+
+            if (thumbnailTexture != null && info.readyCount == thumbnailReadyCount &&
+                thumbnailTexture.width == (int)info.width && thumbnailTexture.height == (int)info.height)
+            {
+                return thumbnailTexture;
+            }
+
+            int size = (int)(info.width * info.height * 4);
+            if (thumbnailPixels == null || thumbnailPixels.Length != size)
+            {
+                thumbnailPixels = new byte[size];
+            }
+
+            if (Plugin.GetThumbnailAtlas(pluginInstance, thumbnailPixels, (uint)size, out info) != 0)
+            {
+                return thumbnailTexture;
+            }
+
+            if (thumbnailTexture == null || thumbnailTexture.width != (int)info.width || thumbnailTexture.height != (int)info.height)
+            {
+                thumbnailTexture = new Texture2D((int)info.width, (int)info.height, TextureFormat.BGRA32, false);
+            }
+
+            thumbnailTexture.LoadRawTextureData(thumbnailPixels);
+            thumbnailTexture.Apply(false);
+            thumbnailReadyCount = info.readyCount;
+
+            return thumbnailTexture;
+        }
+
         public void SetVolume(float volume)
         {
             CheckHR(Plugin.SetVolume(pluginInstance, volume));
         }
 
+        // Size in pixels the video shows at on screen, 0x0 if not known. Renditions larger than that are not picked.
+        public void SetViewportSize(uint width, uint height)
+        {
+            viewportWidth = width;
+            viewportHeight = height;
+
+            if (pluginInstance != IntPtr.Zero)
+            {
+                CheckHR(Plugin.SetRenditionConstraints(pluginInstance, viewportWidth, viewportHeight, (uint)powerBudget));
+            }
+        }
+
 
         public uint GetVideoWidth()
         {
@@ -439,6 +930,8 @@ namespace MediaPlayer
 
         private void Update()
         {
+            DrainStateEvents();
+
             if(needToUpdateTexture)
             {
                 needToUpdateTexture = false;
@@ -451,6 +944,72 @@ namespace MediaPlayer
         }
 
 
+        private void DrainStateEvents()
+        {
+            if (pluginInstance == IntPtr.Zero)
+            {
+                return;
+            }
+
+            int hr = 0;
+            do
+            {
+                uint count = 0;
+                hr = (int)Plugin.DrainEvents(pluginInstance, stateEvents, (uint)stateEvents.Length, out count);
+                if (hr < 0)
+                {
+                    CheckHR(hr);
+                    return;
+                }
+
+                for (uint i = 0; i < count; i++)
+                {
+                    OnStateChanged(stateEvents[i]);
+
+                    // a handler may have released the player
+                    if (pluginInstance == IntPtr.Zero)
+                    {
+                        return;
+                    }
+                }
+            }
+            while (hr == 1); // S_FALSE, more events are waiting
+        }
+
+
+        // Unity is only told a format to size the texture; the shader samples through the plugin's R8G8 / R16G16 view
+        private Texture2D UpdateChromaTexture(IntPtr nativeChromaTexture)
+        {
+            if (nativeChromaTexture == IntPtr.Zero)
+            {
+                if (chromaTexture != null)
+                {
+                    Destroy(chromaTexture);
+                    chromaTexture = null;
+                }
+                return null;
+            }
+
+            int chromaWidth = (int)textureWidth / 2;
+            int chromaHeight = (int)textureHeight / 2;
+            TextureFormat chromaFormat = frameFormat == FrameFormat.P010 ? TextureFormat.RG32 : TextureFormat.RG16;
+
+            if (chromaTexture == null || chromaTexture.width != chromaWidth || chromaTexture.height != chromaHeight || chromaTexture.format != chromaFormat)
+            {
+                if (chromaTexture != null)
+                {
+                    Destroy(chromaTexture);
+                }
+                chromaTexture = Texture2D.CreateExternalTexture(chromaWidth, chromaHeight, chromaFormat, false, true, nativeChromaTexture);
+            }
+            else
+            {
+                chromaTexture.UpdateExternalTexture(nativeChromaTexture);
+            }
+
+            return chromaTexture;
+        }
+
         private void SendTextureUpdated()
         {
             if (TextureUpdated != null)
@@ -480,11 +1039,18 @@ namespace MediaPlayer
             thisObject = GCHandle.Alloc(this, GCHandleType.Normal);
             IntPtr thisObjectPtr = GCHandle.ToIntPtr(thisObject);
 
-            // create media playback
-            CheckHR(Plugin.CreateMediaPlayback(this.stateCallback, thisObjectPtr, out pluginInstance));
+            // create media playback, without a state callback the plugin queues states for DrainEvents
+            CheckHR(Plugin.CreateMediaPlayback(null, thisObjectPtr, out pluginInstance));
+
+            // stays valid until ReleaseMediaPlayback
+            CheckHR(Plugin.GetPlaybackStatus(pluginInstance, out statusBlock));
 
             Plugin.IsHardware4KDecodingSupported(pluginInstance, out hw4KDecodingSupported);
 
+            CheckHR(Plugin.SetPreferredFrameFormat(pluginInstance, (uint)preferredFrameFormat));
+            CheckHR(Plugin.SetAbrPolicy(pluginInstance, (uint)abrPolicy));
+            CheckHR(Plugin.SetRenditionConstraints(pluginInstance, viewportWidth, viewportHeight, (uint)powerBudget));
+
             Debug.LogFormat("MediaPlayback has been created. Hardware decoding of 4K+ is {0}.", hw4KDecodingSupported ? "supported" : "not supported");
 
             CheckHR(Plugin.SetSubtitlesCallbacks(pluginInstance, subtitleEnteredCallback, subtitleExitedCallback));
@@ -503,6 +1069,7 @@ namespace MediaPlayer
                     }
                     catch { }
                 }
+                statusBlock = IntPtr.Zero;
                 Plugin.ReleaseMediaPlayback(pluginInstance);
                 pluginInstance = IntPtr.Zero;
             }
@@ -525,43 +1092,28 @@ namespace MediaPlayer
                 }
                 catch { }
             }
-        }
 
-        [AOT.MonoPInvokeCallback(typeof(Plugin.StateChangedCallback))]
-        private static void MediaPlayback_Changed(IntPtr thisObjectPtr, Plugin.PLAYBACK_STATE args)
-        {
-            if (thisObjectPtr == IntPtr.Zero)
+            if (chromaTexture != null)
             {
-                Debug.LogError("MediaPlayback_Changed: requires thisObjectPtr.");
-                return;
-            }
-
-            var handle = GCHandle.FromIntPtr(thisObjectPtr);
-            Playback thisObject = handle.Target as Playback;
-            if (thisObject == null)
-            {
-                Debug.LogError("MediaPlayback_Changed: thisObjectPtr is not null, but seems invalid.");
-                return;
+                try
+                {
+                    Destroy(chromaTexture);
+                    chromaTexture = null;
+                }
+                catch { }
             }
 
-#if UNITY_WSA_10_0
-            if (!UnityEngine.WSA.Application.RunningOnAppThread())
+            if (thumbnailTexture != null)
             {
-                UnityEngine.WSA.Application.InvokeOnAppThread(() =>
+                try
                 {
-                    thisObject.OnStateChanged(args);
-                }, false);
-            }
-            else
-            {
-                thisObject.OnStateChanged(args);
+                    Destroy(thumbnailTexture);
+                    thumbnailTexture = null;
+                }
+                catch { }
             }
-#else
-            thisObject.OnStateChanged(args);
-#endif
         }
 
-
         [AOT.MonoPInvokeCallback(typeof(Plugin.SubtitleItemEnteredCallback))]
         private static void MediaPlayback_SubtitleItemEntered(IntPtr thisObjectPtr, [MarshalAs(UnmanagedType.LPWStr)] string subtitleTrackId, 
                                                                                     [MarshalAs(UnmanagedType.LPWStr)] string textCueId,
@@ -701,6 +1253,7 @@ namespace MediaPlayer
                     currentMediaDescription.height = args.description.height;
                     currentMediaDescription.isSeekable = args.description.isSeekable;
                     currentMediaDescription.isStereoscopic = args.description.isStereoscopic;
+                    currentMediaDescription.frameFormat = args.description.frameFormat;
                     needToUpdateTexture = true;
                     break;
 
@@ -756,6 +1309,35 @@ namespace MediaPlayer
                 case Plugin.StateType.StateType_GraphicsDeviceReady:
                     Debug.LogWarning("Graphics device was restored! Recreating the playback texture!");
                     break;
+                case Plugin.StateType.StateType_LoadCompleted:
+                    if (args.requestId != pendingLoadRequestId)
+                        break; // superseded by a newer load
+
+                    pendingLoadRequestId = 0;
+                    loaded = (0 == CheckHR(args.hresult));
+                    if (loaded)
+                    {
+                        currentItem = pendingItem;
+                        if (playWhenLoaded)
+                        {
+                            CheckHR(Plugin.Play(pluginInstance));
+                        }
+                    }
+                    else if (this.PlaybackFailed != null)
+                    {
+                        PlaybackFailed(this, args.hresult);
+                    }
+                    pendingItem = string.Empty;
+                    playWhenLoaded = false;
+                    break;
+                case Plugin.StateType.StateType_PlaylistItemChanged:
+                    loaded = true;
+                    playlistItems.TryGetValue(args.requestId, out currentItem);
+                    if (this.PlaylistItemChanged != null)
+                    {
+                        PlaylistItemChanged(this, args.requestId);
+                    }
+                    break;
                 default:
                     break;
             }
@@ -799,7 +1381,9 @@ namespace MediaPlayer
                 StateType_Failed,
                 StateType_NewFrameTexture,
                 StateType_GraphicsDeviceShutdown,
-                StateType_GraphicsDeviceReady
+                StateType_GraphicsDeviceReady,
+                StateType_LoadCompleted,
+                StateType_PlaylistItemChanged
             };
 
             [StructLayout(LayoutKind.Sequential, Pack = 8)]
@@ -810,6 +1394,7 @@ namespace MediaPlayer
                 public Int64 duration;
                 public byte isSeekable;
                 public byte isStereoscopic;
+                public UInt32 frameFormat;
 
                 public override string ToString()
                 {
@@ -819,6 +1404,7 @@ namespace MediaPlayer
                     sb.AppendLine("duration: " + duration);
                     sb.AppendLine("canSeek: " + isSeekable);
                     sb.AppendLine("isStereoscopic: " + isStereoscopic);
+                    sb.AppendLine("frameFormat: " + (FrameFormat)frameFormat);
 
                     return sb.ToString();
                 }
@@ -831,6 +1417,23 @@ namespace MediaPlayer
                 public UInt32 state;
                 public Int64 hresult;
                 public MEDIA_DESCRIPTION description;
+                public UInt32 requestId;
+            };
+
+            // byte offsets in PLAYBACK_STATUS (PlaybackTypes.h)
+            public static class PlaybackStatusLayout
+            {
+                public const int Sequence = 0;
+                public const int State = 4;
+                public const int Position = 8;
+                public const int Duration = 16;
+                public const int Bitrate = 24;
+                public const int BufferedRangeCount = 28;
+                public const int BufferedRanges = 32;
+                public const int TimeRangeSize = 16;
+                public const int MaxBufferedRanges = 8;
+                public const int FrameCounter = BufferedRanges + MaxBufferedRanges * TimeRangeSize;
+                public const int DroppedFrames = FrameCounter + 8;
             };
 
             public delegate void StateChangedCallback(IntPtr thisObjectPtr, PLAYBACK_STATE args);
@@ -850,6 +1453,18 @@ namespace MediaPlayer
             [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "LoadContent")]
             internal static extern long LoadContent(IntPtr pluginInstance, [MarshalAs(UnmanagedType.LPWStr)] string sourceURL);
 
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "LoadContentAsync")]
+            internal static extern long LoadContentAsync(IntPtr pluginInstance, [MarshalAs(UnmanagedType.LPWStr)] string sourceURL, out uint requestId);
+
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "CancelLoadContentAsync")]
+            internal static extern long CancelLoadContentAsync(IntPtr pluginInstance);
+
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "DrainEvents")]
+            internal static extern long DrainEvents(IntPtr pluginInstance, [Out] PLAYBACK_STATE[] events, uint capacity, out uint count);
+
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "GetPlaybackStatus")]
+            internal static extern long GetPlaybackStatus(IntPtr pluginInstance, out IntPtr status);
+
             [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "Play")]
             internal static extern long Play(IntPtr pluginInstance);
 
@@ -862,12 +1477,78 @@ namespace MediaPlayer
             [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "GetPlaybackTexture")]
             internal static extern long GetPlaybackTexture(IntPtr pluginInstance, out IntPtr playbackTexture, out byte isStereoscopic);
 
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "GetPlaybackPlaneTextures")]
+            internal static extern long GetPlaybackPlaneTextures(IntPtr pluginInstance, out IntPtr lumaTexture, out IntPtr chromaTexture, out uint frameFormat);
+
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "SetPreferredFrameFormat")]
+            internal static extern long SetPreferredFrameFormat(IntPtr pluginInstance, uint frameFormat);
+
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "SetAbrPolicy")]
+            internal static extern long SetAbrPolicy(IntPtr pluginInstance, uint abrPolicy);
+
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "SetRenditionConstraints")]
+            internal static extern long SetRenditionConstraints(IntPtr pluginInstance, uint viewportWidth, uint viewportHeight, uint powerBudget);
+
             [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "GetDurationAndPosition")]
             internal static extern long GetDurationAndPosition(IntPtr pluginInstance, ref long duration, ref long position);
 
             [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "Seek")]
             internal static extern long Seek(IntPtr pluginInstance, long position);
 
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "SeekWithMode")]
+            internal static extern long SeekWithMode(IntPtr pluginInstance, long position, uint mode);
+
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "StartThumbnailExtraction")]
+            internal static extern long StartThumbnailExtraction(IntPtr pluginInstance, uint tileWidth, uint tileHeight, long interval);
+
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "StopThumbnailExtraction")]
+            internal static extern long StopThumbnailExtraction(IntPtr pluginInstance);
+
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "GetThumbnailAtlasInfo")]
+            internal static extern long GetThumbnailAtlasInfo(IntPtr pluginInstance, out ThumbnailAtlasInfo info);
+
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "GetThumbnailAtlas")]
+            internal static extern long GetThumbnailAtlas(IntPtr pluginInstance, [Out] byte[] buffer, uint size, out ThumbnailAtlasInfo info);
+
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlaylistAppend")]
+            internal static extern long PlaylistAppend(IntPtr pluginInstance, [MarshalAs(UnmanagedType.LPWStr)] string sourceURL, out uint itemId);
+
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlaylistInsert")]
+            internal static extern long PlaylistInsert(IntPtr pluginInstance, uint index, [MarshalAs(UnmanagedType.LPWStr)] string sourceURL, out uint itemId);
+
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlaylistRemove")]
+            internal static extern long PlaylistRemove(IntPtr pluginInstance, uint itemId);
+
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlaylistNext")]
+            internal static extern long PlaylistNext(IntPtr pluginInstance);
+
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "GetPlaylistStats")]
+            internal static extern long GetPlaylistStats(IntPtr pluginInstance, out PlaylistStats stats);
+
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "SetLoop")]
+            internal static extern long SetLoop(IntPtr pluginInstance, [MarshalAs(UnmanagedType.Bool)] bool enabled, long loopStart, long loopEnd);
+
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "GetLoopStats")]
+            internal static extern long GetLoopStats(IntPtr pluginInstance, out LoopStats stats);
+
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "SetPlaybackRate")]
+            internal static extern long SetPlaybackRate(IntPtr pluginInstance, double rate);
+
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "StepFrame")]
+            internal static extern long StepFrame(IntPtr pluginInstance, int frames);
+
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "GetFrameSchedulerStats")]
+            internal static extern long GetFrameSchedulerStats(IntPtr pluginInstance, out FrameSchedulerStats stats);
+
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "SetFrameCacheBudget")]
+            internal static extern long SetFrameCacheBudget(IntPtr pluginInstance, ulong budgetBytes);
+
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "GetFrameCacheStats")]
+            internal static extern long GetFrameCacheStats(IntPtr pluginInstance, out FrameCacheStats stats);
+
+            [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "SetSourceSharing")]
+            internal static extern long SetSourceSharing(IntPtr pluginInstance, [MarshalAs(UnmanagedType.Bool)] bool enabled);
+
             [DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "SetVolume")]
             internal static extern long SetVolume(IntPtr pluginInstance, double volume);
 